@@ -0,0 +1,182 @@
+/*
+ * GStreamer AVTP Plugin
+ * Copyright (C) 2019 Intel Corporation
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later
+ * version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA
+ */
+
+#include <errno.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+
+#include "gstavtpring.h"
+
+/* Maximum time, in milliseconds, the kernel keeps a partially filled RX
+ * block before handing it to userspace. */
+#define RX_BLOCK_TIMEOUT 1
+
+typedef struct
+{
+  GstAvtpRing *ring;
+  guint block;
+} GstAvtpRingPacket;
+
+/* Switches @fd to TPACKET_V3 and maps a ring of @ring_type (PACKET_RX_RING
+ * or PACKET_TX_RING) into memory. @block_size must be a multiple of the page
+ * size and @frame_size a multiple of TPACKET_ALIGNMENT. Returns NULL with
+ * errno set on failure, in which case @fd is left without a ring. */
+GstAvtpRing *
+gst_avtp_ring_new (int fd, int ring_type, guint n_blocks, guint block_size,
+    guint frame_size)
+{
+  int version = TPACKET_V3;
+  struct tpacket_req3 req = { 0 };
+  GstAvtpRing *ring;
+  void *map;
+
+  if (setsockopt (fd, SOL_PACKET, PACKET_VERSION, &version,
+          sizeof (version)) < 0)
+    return NULL;
+
+  req.tp_block_size = block_size;
+  req.tp_block_nr = n_blocks;
+  req.tp_frame_size = frame_size;
+  req.tp_frame_nr = (block_size / frame_size) * n_blocks;
+  if (ring_type == PACKET_RX_RING)
+    req.tp_retire_blk_tov = RX_BLOCK_TIMEOUT;
+
+  if (setsockopt (fd, SOL_PACKET, ring_type, &req, sizeof (req)) < 0)
+    return NULL;
+
+  map = mmap (NULL, (gsize) block_size * n_blocks, PROT_READ | PROT_WRITE,
+      MAP_SHARED, fd, 0);
+  if (map == MAP_FAILED) {
+    int err = errno;
+
+    /* tear the ring down again so that plain socket I/O keeps working */
+    memset (&req, 0, sizeof (req));
+    setsockopt (fd, SOL_PACKET, ring_type, &req, sizeof (req));
+    errno = err;
+    return NULL;
+  }
+
+  ring = g_new0 (GstAvtpRing, 1);
+  ring->refcount = 1;
+  ring->map = map;
+  ring->map_size = (gsize) block_size * n_blocks;
+  ring->block_size = block_size;
+  ring->n_blocks = n_blocks;
+  ring->frame_size = frame_size;
+  ring->n_frames = req.tp_frame_nr;
+
+  if (ring_type == PACKET_RX_RING)
+    ring->block_refs = g_new0 (gint, n_blocks);
+
+  return ring;
+}
+
+GstAvtpRing *
+gst_avtp_ring_ref (GstAvtpRing * ring)
+{
+  g_atomic_int_inc (&ring->refcount);
+
+  return ring;
+}
+
+void
+gst_avtp_ring_unref (GstAvtpRing * ring)
+{
+  if (!g_atomic_int_dec_and_test (&ring->refcount))
+    return;
+
+  munmap (ring->map, ring->map_size);
+  g_free (ring->block_refs);
+  g_free (ring);
+}
+
+/* Takes a reference on RX ring @block for the reader if the kernel handed it
+ * over since the reader last took a block. A block still referenced from the
+ * previous lap is TP_STATUS_USER as well, so the status alone would deliver
+ * its frames again; the sequence number the kernel gives every block it
+ * retires tells fresh blocks apart. */
+gboolean
+gst_avtp_ring_take_block (GstAvtpRing * ring, guint block)
+{
+  struct tpacket_block_desc *desc = gst_avtp_ring_get_block (ring, block);
+
+  if (!(*(volatile guint32 *) & desc->hdr.bh1.block_status & TP_STATUS_USER))
+    return FALSE;
+  __sync_synchronize ();
+
+  if (desc->hdr.bh1.seq_num <= ring->rx_seq_num)
+    return FALSE;
+
+  ring->rx_seq_num = desc->hdr.bh1.seq_num;
+  gst_avtp_ring_block_ref (ring, block);
+
+  return TRUE;
+}
+
+void
+gst_avtp_ring_block_ref (GstAvtpRing * ring, guint block)
+{
+  g_atomic_int_inc (&ring->block_refs[block]);
+}
+
+void
+gst_avtp_ring_block_unref (GstAvtpRing * ring, guint block)
+{
+  struct tpacket_block_desc *desc;
+
+  if (!g_atomic_int_dec_and_test (&ring->block_refs[block]))
+    return;
+
+  /* all reads of the block data must be done before the kernel may
+   * overwrite it */
+  desc = gst_avtp_ring_get_block (ring, block);
+  __sync_synchronize ();
+  desc->hdr.bh1.block_status = TP_STATUS_KERNEL;
+}
+
+static void
+gst_avtp_ring_packet_free (gpointer user_data)
+{
+  GstAvtpRingPacket *packet = user_data;
+
+  gst_avtp_ring_block_unref (packet->ring, packet->block);
+  gst_avtp_ring_unref (packet->ring);
+  g_slice_free (GstAvtpRingPacket, packet);
+}
+
+/* Wraps @size bytes at @data, which live in RX ring @block, into a read-only
+ * memory. The block is not handed back to the kernel before the memory is
+ * freed. */
+GstMemory *
+gst_avtp_ring_wrap_packet (GstAvtpRing * ring, guint block, guint8 * data,
+    gsize size)
+{
+  GstAvtpRingPacket *packet;
+
+  packet = g_slice_new (GstAvtpRingPacket);
+  packet->ring = gst_avtp_ring_ref (ring);
+  packet->block = block;
+  gst_avtp_ring_block_ref (ring, block);
+
+  return gst_memory_new_wrapped (GST_MEMORY_FLAG_READONLY, data, size, 0,
+      size, packet, gst_avtp_ring_packet_free);
+}
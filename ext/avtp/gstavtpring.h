@@ -0,0 +1,99 @@
+/*
+ * GStreamer AVTP Plugin
+ * Copyright (C) 2019 Intel Corporation
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later
+ * version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA
+ */
+
+#ifndef __GST_AVTP_RING_H__
+#define __GST_AVTP_RING_H__
+
+#include <gst/gst.h>
+#include <linux/if_packet.h>
+
+G_BEGIN_DECLS
+
+/* Offset of the packet data inside a TX ring frame */
+#define GST_AVTP_RING_TX_DATA_OFFSET \
+  (TPACKET_ALIGN (sizeof (struct tpacket3_hdr)))
+
+typedef struct _GstAvtpRing GstAvtpRing;
+
+/* A TPACKET_V3 ring memory-mapped from an AF_PACKET socket. The mapping
+ * outlives the socket for as long as references are held, so buffers
+ * wrapping RX ring frames stay valid after the element stopped. */
+struct _GstAvtpRing
+{
+  gint refcount;
+
+  guint8 *map;
+  gsize map_size;
+
+  guint block_size;
+  guint n_blocks;
+  guint frame_size;
+  guint n_frames;
+
+  /* RX ring only: references held on each block by the reader and by the
+   * memories wrapping its frames. The block is handed back to the kernel
+   * when the last one is dropped. */
+  gint *block_refs;
+  /* RX ring only: sequence number of the last block taken by the reader */
+  guint64 rx_seq_num;
+};
+
+GstAvtpRing * gst_avtp_ring_new (int fd, int ring_type, guint n_blocks,
+    guint block_size, guint frame_size);
+
+GstAvtpRing * gst_avtp_ring_ref (GstAvtpRing * ring);
+
+void gst_avtp_ring_unref (GstAvtpRing * ring);
+
+static inline struct tpacket_block_desc *
+gst_avtp_ring_get_block (GstAvtpRing * ring, guint block)
+{
+  return (struct tpacket_block_desc *) (ring->map + block * ring->block_size);
+}
+
+static inline struct tpacket3_hdr *
+gst_avtp_ring_get_frame (GstAvtpRing * ring, guint frame)
+{
+  guint frames_per_block = ring->block_size / ring->frame_size;
+
+  return (struct tpacket3_hdr *) (ring->map +
+      (frame / frames_per_block) * ring->block_size +
+      (frame % frames_per_block) * ring->frame_size);
+}
+
+gboolean gst_avtp_ring_take_block (GstAvtpRing * ring, guint block);
+
+static inline gboolean
+gst_avtp_ring_block_held (GstAvtpRing * ring, guint block)
+{
+  return g_atomic_int_get (&ring->block_refs[block]) > 0;
+}
+
+void gst_avtp_ring_block_ref (GstAvtpRing * ring, guint block);
+
+void gst_avtp_ring_block_unref (GstAvtpRing * ring, guint block);
+
+GstMemory * gst_avtp_ring_wrap_packet (GstAvtpRing * ring, guint block,
+    guint8 * data, gsize size);
+
+G_END_DECLS
+
+#endif /* __GST_AVTP_RING_H__ */
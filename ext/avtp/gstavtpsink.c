@@ -34,6 +34,16 @@
  * application after the element transitions to PAUSED state if wanted.
  * </note>
  *
+ * By default each AVTPDU is sent with its own sendto() call. Setting
+ * #GstAvtpSink:ring-frames writes AVTPDUs into a TPACKET_V3 TX ring shared
+ * with the kernel instead, where buffer lists are written as a whole and
+ * handed to the kernel with a single system call when the first buffer of
+ * the list is due. This only pays off when upstream pushes buffer lists:
+ * single buffers are still sent at their own time, with one system call
+ * each and an additional copy into the ring. When the kernel has not sent
+ * the AVTPDUs of the whole ring yet, the element waits a little for a free
+ * frame and drops the AVTPDU after that, posting a QoS message.
+ *
  * <refsect2>
  * <title>Example pipeline</title>
  * |[
@@ -61,6 +71,16 @@ GST_DEBUG_CATEGORY_STATIC (avtpsink_debug);
 #define DEFAULT_IFNAME "eth0"
 #define DEFAULT_ADDRESS "01:AA:AA:AA:AA:AA"
 #define DEFAULT_PRIORITY 0
+#define DEFAULT_RING_FRAMES 0
+
+#define MAX_AVTPDU_SIZE 1500
+
+#define RING_FRAME_SIZE \
+  (TPACKET_ALIGN (GST_AVTP_RING_TX_DATA_OFFSET + MAX_AVTPDU_SIZE))
+
+/* How long to wait for the kernel to release a frame of a full TX ring
+ * before dropping the AVTPDU, well above the transmission time of a frame */
+#define RING_FULL_WAIT GST_MSECOND
 
 enum
 {
@@ -68,6 +88,7 @@ enum
   PROP_IFNAME,
   PROP_ADDRESS,
   PROP_PRIORITY,
+  PROP_RING_FRAMES,
 };
 
 static GstStaticPadTemplate sink_template = GST_STATIC_PAD_TEMPLATE ("sink",
@@ -87,8 +108,12 @@ static void gst_avtp_sink_get_property (GObject * object, guint prop_id,
 
 static gboolean gst_avtp_sink_start (GstBaseSink * basesink);
 static gboolean gst_avtp_sink_stop (GstBaseSink * basesink);
+static gboolean gst_avtp_sink_unlock (GstBaseSink * basesink);
+static gboolean gst_avtp_sink_unlock_stop (GstBaseSink * basesink);
 static GstFlowReturn gst_avtp_sink_render (GstBaseSink * basesink, GstBuffer *
     buffer);
+static GstFlowReturn gst_avtp_sink_render_list (GstBaseSink * basesink,
+    GstBufferList * list);
 
 static void
 gst_avtp_sink_class_init (GstAvtpSinkClass * klass)
@@ -116,6 +141,12 @@ gst_avtp_sink_class_init (GstAvtpSinkClass * klass)
           "Priority configured into socket (SO_PRIORITY)", 0, G_MAXINT,
           DEFAULT_PRIORITY, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS |
           GST_PARAM_MUTABLE_READY));
+  g_object_class_install_property (object_class, PROP_RING_FRAMES,
+      g_param_spec_uint ("ring-frames", "Ring frames",
+          "Number of AVTPDUs the memory-mapped TX ring can hold "
+          "(0 = send each AVTPDU with sendto())", 0, 65536, DEFAULT_RING_FRAMES,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS |
+          GST_PARAM_MUTABLE_READY));
 
   gst_element_class_add_static_pad_template (element_class, &sink_template);
 
@@ -126,7 +157,10 @@ gst_avtp_sink_class_init (GstAvtpSinkClass * klass)
 
   basesink_class->start = GST_DEBUG_FUNCPTR (gst_avtp_sink_start);
   basesink_class->stop = GST_DEBUG_FUNCPTR (gst_avtp_sink_stop);
+  basesink_class->unlock = GST_DEBUG_FUNCPTR (gst_avtp_sink_unlock);
+  basesink_class->unlock_stop = GST_DEBUG_FUNCPTR (gst_avtp_sink_unlock_stop);
   basesink_class->render = GST_DEBUG_FUNCPTR (gst_avtp_sink_render);
+  basesink_class->render_list = GST_DEBUG_FUNCPTR (gst_avtp_sink_render_list);
 
   GST_DEBUG_CATEGORY_INIT (avtpsink_debug, "avtpsink", 0, "AVTP Sink");
 }
@@ -139,6 +173,7 @@ gst_avtp_sink_init (GstAvtpSink * avtpsink)
   avtpsink->ifname = g_strdup (DEFAULT_IFNAME);
   avtpsink->address = g_strdup (DEFAULT_ADDRESS);
   avtpsink->priority = DEFAULT_PRIORITY;
+  avtpsink->ring_frames = DEFAULT_RING_FRAMES;
   avtpsink->sk_fd = -1;
   memset (&avtpsink->sk_addr, 0, sizeof (avtpsink->sk_addr));
 }
@@ -174,6 +209,9 @@ gst_avtp_sink_set_property (GObject * object, guint prop_id,
     case PROP_PRIORITY:
       avtpsink->priority = g_value_get_int (value);
       break;
+    case PROP_RING_FRAMES:
+      avtpsink->ring_frames = g_value_get_uint (value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -198,6 +236,9 @@ gst_avtp_sink_get_property (GObject * object, guint prop_id,
     case PROP_PRIORITY:
       g_value_set_int (value, avtpsink->priority);
       break;
+    case PROP_RING_FRAMES:
+      g_value_set_uint (value, avtpsink->ring_frames);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -249,6 +290,33 @@ gst_avtp_sink_start (GstBaseSink * basesink)
   sk_addr.sll_pkttype = 0;
   memcpy (sk_addr.sll_addr, addr, ETH_ALEN);
 
+  if (avtpsink->ring_frames > 0) {
+    guint page_size = sysconf (_SC_PAGESIZE);
+    guint block_size, frames_per_block;
+
+    /* smallest block holding at least one frame */
+    block_size = (RING_FRAME_SIZE + page_size - 1) / page_size * page_size;
+    frames_per_block = block_size / RING_FRAME_SIZE;
+
+    avtpsink->ring = gst_avtp_ring_new (fd, PACKET_TX_RING,
+        (avtpsink->ring_frames + frames_per_block - 1) / frames_per_block,
+        block_size, RING_FRAME_SIZE);
+    if (avtpsink->ring == NULL)
+      GST_WARNING_OBJECT (avtpsink, "Failed to set up TX ring, falling back "
+          "to sendto(): %s", strerror (errno));
+    avtpsink->ring_frame = 0;
+    avtpsink->ring_pending = 0;
+  }
+  avtpsink->processed = 0;
+  avtpsink->dropped = 0;
+
+  /* only polled for a free frame when the TX ring is full */
+  avtpsink->poll = gst_poll_new (TRUE);
+  gst_poll_fd_init (&avtpsink->pfd);
+  avtpsink->pfd.fd = fd;
+  gst_poll_add_fd (avtpsink->poll, &avtpsink->pfd);
+  gst_poll_fd_ctl_write (avtpsink->poll, &avtpsink->pfd, TRUE);
+
   avtpsink->sk_fd = fd;
   avtpsink->sk_addr = sk_addr;
 
@@ -265,18 +333,47 @@ gst_avtp_sink_stop (GstBaseSink * basesink)
 {
   GstAvtpSink *avtpsink = GST_AVTP_SINK (basesink);
 
+  if (avtpsink->ring) {
+    gst_avtp_ring_unref (avtpsink->ring);
+    avtpsink->ring = NULL;
+  }
+
+  gst_poll_free (avtpsink->poll);
+  avtpsink->poll = NULL;
+
   close (avtpsink->sk_fd);
 
   GST_DEBUG_OBJECT (avtpsink, "AVTP sink stopped");
   return TRUE;
 }
 
+static gboolean
+gst_avtp_sink_unlock (GstBaseSink * basesink)
+{
+  GstAvtpSink *avtpsink = GST_AVTP_SINK (basesink);
+
+  if (avtpsink->poll)
+    gst_poll_set_flushing (avtpsink->poll, TRUE);
+
+  return TRUE;
+}
+
+static gboolean
+gst_avtp_sink_unlock_stop (GstBaseSink * basesink)
+{
+  GstAvtpSink *avtpsink = GST_AVTP_SINK (basesink);
+
+  if (avtpsink->poll)
+    gst_poll_set_flushing (avtpsink->poll, FALSE);
+
+  return TRUE;
+}
+
 static GstFlowReturn
-gst_avtp_sink_render (GstBaseSink * basesink, GstBuffer * buffer)
+gst_avtp_sink_send (GstAvtpSink * avtpsink, GstBuffer * buffer)
 {
   ssize_t n;
   GstMapInfo info;
-  GstAvtpSink *avtpsink = GST_AVTP_SINK (basesink);
 
   if (!gst_buffer_map (buffer, &info, GST_MAP_READ)) {
     GST_ERROR_OBJECT (avtpsink, "Failed to map buffer");
@@ -299,6 +396,160 @@ out:
   return GST_FLOW_OK;
 }
 
+/* Hands all AVTPDUs queued in the TX ring to the kernel */
+static void
+gst_avtp_sink_ring_flush (GstAvtpSink * avtpsink)
+{
+  ssize_t n;
+
+  if (avtpsink->ring_pending == 0)
+    return;
+
+  n = sendto (avtpsink->sk_fd, NULL, 0, MSG_DONTWAIT,
+      (struct sockaddr *) &avtpsink->sk_addr, sizeof (avtpsink->sk_addr));
+  if (n < 0) {
+    /* the frames stay queued and go out with the next flush */
+    GST_INFO_OBJECT (avtpsink, "Failed to send AVTPDUs: %s", strerror (errno));
+    return;
+  }
+
+  avtpsink->ring_pending = 0;
+}
+
+/* Waits until the kernel released a TX ring frame or RING_FULL_WAIT
+ * expired */
+static GstFlowReturn
+gst_avtp_sink_ring_wait (GstAvtpSink * avtpsink)
+{
+  gint res;
+
+  do {
+    res = gst_poll_wait (avtpsink->poll, RING_FULL_WAIT);
+  } while (res < 0 && (errno == EINTR || errno == EAGAIN));
+
+  if (res < 0) {
+    if (errno == EBUSY)
+      return GST_FLOW_FLUSHING;
+
+    GST_ELEMENT_ERROR (avtpsink, RESOURCE, WRITE, (NULL),
+        ("Failed to poll socket: %s", strerror (errno)));
+    return GST_FLOW_ERROR;
+  }
+
+  return GST_FLOW_OK;
+}
+
+/* Counts @buffer as dropped and tells the application about it */
+static void
+gst_avtp_sink_ring_drop (GstAvtpSink * avtpsink, GstBuffer * buffer)
+{
+  GstSegment *segment = &GST_BASE_SINK (avtpsink)->segment;
+  GstClockTime ts = GST_BUFFER_PTS (buffer);
+  GstMessage *msg;
+
+  avtpsink->dropped++;
+  GST_WARNING_OBJECT (avtpsink, "TX ring full, dropping AVTPDU (%"
+      G_GUINT64_FORMAT " dropped)", avtpsink->dropped);
+
+  msg = gst_message_new_qos (GST_OBJECT_CAST (avtpsink), TRUE,
+      gst_segment_to_running_time (segment, GST_FORMAT_TIME, ts),
+      gst_segment_to_stream_time (segment, GST_FORMAT_TIME, ts), ts,
+      GST_BUFFER_DURATION (buffer));
+  gst_message_set_qos_stats (msg, GST_FORMAT_BUFFERS, avtpsink->processed,
+      avtpsink->dropped);
+  gst_element_post_message (GST_ELEMENT_CAST (avtpsink), msg);
+}
+
+static GstFlowReturn
+gst_avtp_sink_ring_queue (GstAvtpSink * avtpsink, GstBuffer * buffer)
+{
+  GstAvtpRing *ring = avtpsink->ring;
+  struct tpacket3_hdr *hdr;
+  GstFlowReturn ret;
+  gsize size;
+  guint32 status;
+
+  size = gst_buffer_get_size (buffer);
+  if (G_UNLIKELY (size > ring->frame_size - GST_AVTP_RING_TX_DATA_OFFSET)) {
+    gst_avtp_sink_ring_flush (avtpsink);
+    return gst_avtp_sink_send (avtpsink, buffer);
+  }
+
+  hdr = gst_avtp_ring_get_frame (ring, avtpsink->ring_frame);
+  status = *(volatile guint32 *) & hdr->tp_status;
+  if (status != TP_STATUS_AVAILABLE && !(status & TP_STATUS_WRONG_FORMAT)) {
+    /* kick the kernel in case the frame is waiting for us to do so, and
+     * give it some time to send it */
+    gst_avtp_sink_ring_flush (avtpsink);
+    status = *(volatile guint32 *) & hdr->tp_status;
+    if (status != TP_STATUS_AVAILABLE && !(status & TP_STATUS_WRONG_FORMAT)) {
+      ret = gst_avtp_sink_ring_wait (avtpsink);
+      if (ret != GST_FLOW_OK)
+        return ret;
+      status = *(volatile guint32 *) & hdr->tp_status;
+    }
+    if (status != TP_STATUS_AVAILABLE && !(status & TP_STATUS_WRONG_FORMAT)) {
+      gst_avtp_sink_ring_drop (avtpsink, buffer);
+      return GST_FLOW_OK;
+    }
+  }
+  if (G_UNLIKELY (status & TP_STATUS_WRONG_FORMAT))
+    GST_INFO_OBJECT (avtpsink, "Kernel rejected previous AVTPDU in frame %u",
+        avtpsink->ring_frame);
+
+  __sync_synchronize ();
+  gst_buffer_extract (buffer, 0, (guint8 *) hdr + GST_AVTP_RING_TX_DATA_OFFSET,
+      size);
+  hdr->tp_len = size;
+  hdr->tp_next_offset = 0;
+  __sync_synchronize ();
+  hdr->tp_status = TP_STATUS_SEND_REQUEST;
+
+  avtpsink->ring_frame = (avtpsink->ring_frame + 1) % ring->n_frames;
+  avtpsink->ring_pending++;
+  avtpsink->processed++;
+
+  return GST_FLOW_OK;
+}
+
+static GstFlowReturn
+gst_avtp_sink_render (GstBaseSink * basesink, GstBuffer * buffer)
+{
+  GstAvtpSink *avtpsink = GST_AVTP_SINK (basesink);
+  GstFlowReturn ret;
+
+  if (!avtpsink->ring)
+    return gst_avtp_sink_send (avtpsink, buffer);
+
+  ret = gst_avtp_sink_ring_queue (avtpsink, buffer);
+  gst_avtp_sink_ring_flush (avtpsink);
+
+  return ret;
+}
+
+static GstFlowReturn
+gst_avtp_sink_render_list (GstBaseSink * basesink, GstBufferList * list)
+{
+  GstAvtpSink *avtpsink = GST_AVTP_SINK (basesink);
+  GstFlowReturn ret = GST_FLOW_OK;
+  guint i, len;
+
+  len = gst_buffer_list_length (list);
+  for (i = 0; i < len && ret == GST_FLOW_OK; i++) {
+    GstBuffer *buffer = gst_buffer_list_get (list, i);
+
+    if (avtpsink->ring)
+      ret = gst_avtp_sink_ring_queue (avtpsink, buffer);
+    else
+      ret = gst_avtp_sink_send (avtpsink, buffer);
+  }
+
+  if (avtpsink->ring)
+    gst_avtp_sink_ring_flush (avtpsink);
+
+  return ret;
+}
+
 gboolean
 gst_avtp_sink_plugin_init (GstPlugin * plugin)
 {
@@ -26,6 +26,8 @@
 #include <gst/gst.h>
 #include <linux/if_packet.h>
 
+#include "gstavtpring.h"
+
 G_BEGIN_DECLS
 
 #define GST_TYPE_AVTP_SINK (gst_avtp_sink_get_type())
@@ -48,9 +50,21 @@ struct _GstAvtpSink
   gchar * ifname;
   gchar * address;
   gint priority;
+  guint ring_frames;
 
   int sk_fd;
   struct sockaddr_ll sk_addr;
+
+  /* TX ring, NULL when sending with sendto() */
+  GstAvtpRing *ring;
+  guint ring_frame;
+  guint ring_pending;
+  GstPoll *poll;
+  GstPollFD pfd;
+
+  /* AVTPDUs written to the TX ring and dropped because it was full */
+  guint64 processed;
+  guint64 dropped;
 };
 
 struct _GstAvtpSinkClass
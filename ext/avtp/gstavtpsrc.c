@@ -32,6 +32,13 @@
  * this element. See avtpsink documentation for further information.
  * </note>
  *
+ * By default AVTPDUs are read from a TPACKET_V3 ring shared with the kernel
+ * instead of with one recv() call per AVTPDU. The output buffers then
+ * reference the ring memory directly, and a ring block is only handed back
+ * to the kernel once all buffers referencing it have been freed, so
+ * downstream elements holding on to buffers for long reduce the space left
+ * for new AVTPDUs. Setting #GstAvtpSrc:ring-blocks to 0 disables the ring.
+ *
  * <refsect2>
  * <title>Example pipeline</title>
  * |[
@@ -46,6 +53,7 @@
 #include <net/ethernet.h>
 #include <net/if.h>
 #include <stdio.h>
+#include <string.h>
 #include <sys/ioctl.h>
 #include <sys/socket.h>
 #include <unistd.h>
@@ -57,14 +65,25 @@ GST_DEBUG_CATEGORY_STATIC (avtpsrc_debug);
 
 #define DEFAULT_IFNAME "eth0"
 #define DEFAULT_ADDRESS "01:AA:AA:AA:AA:AA"
+#define DEFAULT_RING_BLOCKS 32
 
 #define MAX_AVTPDU_SIZE 1500
 
+/* Size of each RX ring block. The kernel hands a block over when it is full
+ * or after 1ms, so a block holds at most 1ms worth of AVTPDUs. */
+#define RING_BLOCK_SIZE (1 << 16)
+#define RING_FRAME_SIZE (TPACKET_ALIGN (TPACKET3_HDRLEN + MAX_AVTPDU_SIZE))
+
+/* How long to wait for the next RX ring block while polling the socket is of
+ * no use, matching the time after which the kernel hands a block over */
+#define RING_HELD_WAIT GST_MSECOND
+
 enum
 {
   PROP_0,
   PROP_IFNAME,
   PROP_ADDRESS,
+  PROP_RING_BLOCKS,
 };
 
 static GstStaticPadTemplate src_template = GST_STATIC_PAD_TEMPLATE ("src",
@@ -84,6 +103,10 @@ static void gst_avtp_src_get_property (GObject * object, guint prop_id,
 
 static gboolean gst_avtp_src_start (GstBaseSrc * basesrc);
 static gboolean gst_avtp_src_stop (GstBaseSrc * basesrc);
+static gboolean gst_avtp_src_unlock (GstBaseSrc * basesrc);
+static gboolean gst_avtp_src_unlock_stop (GstBaseSrc * basesrc);
+static GstFlowReturn gst_avtp_src_create (GstPushSrc * pushsrc,
+    GstBuffer ** buffer);
 static GstFlowReturn gst_avtp_src_fill (GstPushSrc * pushsrc, GstBuffer *
     buffer);
 
@@ -109,6 +132,12 @@ gst_avtp_src_class_init (GstAvtpSrcClass * klass)
           "Destination MAC address to listen to",
           DEFAULT_ADDRESS, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS |
           GST_PARAM_MUTABLE_READY));
+  g_object_class_install_property (object_class, PROP_RING_BLOCKS,
+      g_param_spec_uint ("ring-blocks", "Ring blocks",
+          "Number of 64 KiB blocks of the memory-mapped RX ring "
+          "(0 = receive with recv())", 0, 1024, DEFAULT_RING_BLOCKS,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS |
+          GST_PARAM_MUTABLE_READY));
 
   gst_element_class_add_static_pad_template (element_class, &src_template);
 
@@ -119,6 +148,9 @@ gst_avtp_src_class_init (GstAvtpSrcClass * klass)
 
   basesrc_class->start = GST_DEBUG_FUNCPTR (gst_avtp_src_start);
   basesrc_class->stop = GST_DEBUG_FUNCPTR (gst_avtp_src_stop);
+  basesrc_class->unlock = GST_DEBUG_FUNCPTR (gst_avtp_src_unlock);
+  basesrc_class->unlock_stop = GST_DEBUG_FUNCPTR (gst_avtp_src_unlock_stop);
+  pushsrc_class->create = GST_DEBUG_FUNCPTR (gst_avtp_src_create);
   pushsrc_class->fill = GST_DEBUG_FUNCPTR (gst_avtp_src_fill);
 
   GST_DEBUG_CATEGORY_INIT (avtpsrc_debug, "avtpsrc", 0, "AVTP Source");
@@ -133,6 +165,7 @@ gst_avtp_src_init (GstAvtpSrc * avtpsrc)
 
   avtpsrc->ifname = g_strdup (DEFAULT_IFNAME);
   avtpsrc->address = g_strdup (DEFAULT_ADDRESS);
+  avtpsrc->ring_blocks = DEFAULT_RING_BLOCKS;
   avtpsrc->sk_fd = -1;
 }
 
@@ -164,6 +197,9 @@ gst_avtp_src_set_property (GObject * object, guint prop_id,
       g_free (avtpsrc->address);
       avtpsrc->address = g_value_dup_string (value);
       break;
+    case PROP_RING_BLOCKS:
+      avtpsrc->ring_blocks = g_value_get_uint (value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -185,6 +221,9 @@ gst_avtp_src_get_property (GObject * object, guint prop_id,
     case PROP_ADDRESS:
       g_value_set_string (value, avtpsrc->address);
       break;
+    case PROP_RING_BLOCKS:
+      g_value_set_uint (value, avtpsrc->ring_blocks);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -243,6 +282,23 @@ gst_avtp_src_start (GstBaseSrc * basesrc)
     goto err;
   }
 
+  if (avtpsrc->ring_blocks > 0) {
+    avtpsrc->ring = gst_avtp_ring_new (fd, PACKET_RX_RING,
+        avtpsrc->ring_blocks, RING_BLOCK_SIZE, RING_FRAME_SIZE);
+    if (avtpsrc->ring == NULL)
+      GST_WARNING_OBJECT (avtpsrc, "Failed to set up RX ring, falling back "
+          "to recv(): %s", strerror (errno));
+    avtpsrc->ring_block = 0;
+    avtpsrc->ring_pkts_left = 0;
+    avtpsrc->ring_pkt = NULL;
+  }
+
+  avtpsrc->poll = gst_poll_new (TRUE);
+  gst_poll_fd_init (&avtpsrc->pfd);
+  avtpsrc->pfd.fd = fd;
+  gst_poll_add_fd (avtpsrc->poll, &avtpsrc->pfd);
+  gst_poll_fd_ctl_read (avtpsrc->poll, &avtpsrc->pfd, TRUE);
+
   avtpsrc->sk_fd = fd;
 
   GST_DEBUG_OBJECT (avtpsrc, "AVTP source started");
@@ -258,18 +314,160 @@ gst_avtp_src_stop (GstBaseSrc * basesrc)
 {
   GstAvtpSrc *avtpsrc = GST_AVTP_SRC (basesrc);
 
+  if (avtpsrc->ring) {
+    /* buffers still referencing the ring keep it mapped */
+    if (avtpsrc->ring_pkt != NULL)
+      gst_avtp_ring_block_unref (avtpsrc->ring, avtpsrc->ring_block);
+    gst_avtp_ring_unref (avtpsrc->ring);
+    avtpsrc->ring = NULL;
+    avtpsrc->ring_pkt = NULL;
+  }
+
+  gst_poll_free (avtpsrc->poll);
+  avtpsrc->poll = NULL;
+
   close (avtpsrc->sk_fd);
+  avtpsrc->sk_fd = -1;
 
   GST_DEBUG_OBJECT (avtpsrc, "AVTP source stopped");
   return TRUE;
 }
 
+static gboolean
+gst_avtp_src_unlock (GstBaseSrc * basesrc)
+{
+  GstAvtpSrc *avtpsrc = GST_AVTP_SRC (basesrc);
+
+  if (avtpsrc->poll)
+    gst_poll_set_flushing (avtpsrc->poll, TRUE);
+
+  return TRUE;
+}
+
+static gboolean
+gst_avtp_src_unlock_stop (GstBaseSrc * basesrc)
+{
+  GstAvtpSrc *avtpsrc = GST_AVTP_SRC (basesrc);
+
+  if (avtpsrc->poll)
+    gst_poll_set_flushing (avtpsrc->poll, FALSE);
+
+  return TRUE;
+}
+
+/* Waits until the socket is readable or, with a valid @timeout, until
+ * @timeout expired without looking at the socket */
+static GstFlowReturn
+gst_avtp_src_wait (GstAvtpSrc * avtpsrc, GstClockTime timeout)
+{
+  gboolean timed = GST_CLOCK_TIME_IS_VALID (timeout);
+  gint res;
+
+  if (timed)
+    gst_poll_fd_ctl_read (avtpsrc->poll, &avtpsrc->pfd, FALSE);
+
+  do {
+    res = gst_poll_wait (avtpsrc->poll, timeout);
+  } while (res < 0 && (errno == EINTR || errno == EAGAIN));
+
+  if (timed)
+    gst_poll_fd_ctl_read (avtpsrc->poll, &avtpsrc->pfd, TRUE);
+
+  if (res < 0) {
+    if (errno == EBUSY)
+      return GST_FLOW_FLUSHING;
+
+    GST_ELEMENT_ERROR (avtpsrc, RESOURCE, READ, (NULL),
+        ("Failed to poll socket: %s", strerror (errno)));
+    return GST_FLOW_ERROR;
+  }
+
+  return GST_FLOW_OK;
+}
+
+static GstFlowReturn
+gst_avtp_src_ring_create (GstAvtpSrc * avtpsrc, GstBuffer ** buffer)
+{
+  GstAvtpRing *ring = avtpsrc->ring;
+  struct tpacket_block_desc *desc;
+  struct tpacket3_hdr *pkt;
+  GstFlowReturn ret;
+
+  while (avtpsrc->ring_pkts_left == 0) {
+    if (avtpsrc->ring_pkt != NULL) {
+      /* Done with the current block. It goes back to the kernel as soon as
+       * the buffers referencing it are gone. */
+      gst_avtp_ring_block_unref (ring, avtpsrc->ring_block);
+      avtpsrc->ring_block = (avtpsrc->ring_block + 1) % ring->n_blocks;
+      avtpsrc->ring_pkt = NULL;
+    }
+
+    if (!gst_avtp_ring_take_block (ring, avtpsrc->ring_block)) {
+      guint prev = (avtpsrc->ring_block + ring->n_blocks - 1) % ring->n_blocks;
+      GstClockTime timeout = GST_CLOCK_TIME_NONE;
+
+      /* The socket polls readable for as long as the block before the one
+       * the kernel fills is not back, and the kernel can't fill a block
+       * that is not back. Both happen while buffers from these blocks are
+       * held downstream, so wait a bit instead of spinning on poll(). */
+      if (gst_avtp_ring_block_held (ring, prev) ||
+          gst_avtp_ring_block_held (ring, avtpsrc->ring_block))
+        timeout = RING_HELD_WAIT;
+
+      ret = gst_avtp_src_wait (avtpsrc, timeout);
+      if (ret != GST_FLOW_OK)
+        return ret;
+      continue;
+    }
+
+    desc = gst_avtp_ring_get_block (ring, avtpsrc->ring_block);
+    avtpsrc->ring_pkts_left = desc->hdr.bh1.num_pkts;
+    avtpsrc->ring_pkt = (struct tpacket3_hdr *) ((guint8 *) desc +
+        desc->hdr.bh1.offset_to_first_pkt);
+  }
+
+  pkt = avtpsrc->ring_pkt;
+  *buffer = gst_buffer_new ();
+  gst_buffer_append_memory (*buffer, gst_avtp_ring_wrap_packet (ring,
+          avtpsrc->ring_block, (guint8 *) pkt + pkt->tp_mac,
+          pkt->tp_snaplen));
+
+  if (--avtpsrc->ring_pkts_left > 0)
+    avtpsrc->ring_pkt =
+        (struct tpacket3_hdr *) ((guint8 *) pkt + pkt->tp_next_offset);
+
+  return GST_FLOW_OK;
+}
+
+static GstFlowReturn
+gst_avtp_src_create (GstPushSrc * pushsrc, GstBuffer ** buffer)
+{
+  GstBaseSrc *basesrc = GST_BASE_SRC (pushsrc);
+  GstAvtpSrc *avtpsrc = GST_AVTP_SRC (pushsrc);
+  GstFlowReturn ret;
+
+  if (avtpsrc->ring)
+    return gst_avtp_src_ring_create (avtpsrc, buffer);
+
+  ret = GST_BASE_SRC_CLASS (parent_class)->alloc (basesrc, -1,
+      gst_base_src_get_blocksize (basesrc), buffer);
+  if (ret != GST_FLOW_OK)
+    return ret;
+
+  ret = gst_avtp_src_fill (pushsrc, *buffer);
+  if (ret != GST_FLOW_OK)
+    gst_buffer_replace (buffer, NULL);
+
+  return ret;
+}
+
 static GstFlowReturn
 gst_avtp_src_fill (GstPushSrc * pushsrc, GstBuffer * buffer)
 {
   GstMapInfo map;
   gsize buffer_size;
   ssize_t n = MAX_AVTPDU_SIZE;
+  GstFlowReturn ret;
   GstAvtpSrc *avtpsrc = GST_AVTP_SRC (pushsrc);
 
   buffer_size = gst_buffer_get_size (buffer);
@@ -286,10 +484,16 @@ gst_avtp_src_fill (GstPushSrc * pushsrc, GstBuffer * buffer)
   }
 
 retry:
+  ret = gst_avtp_src_wait (avtpsrc, GST_CLOCK_TIME_NONE);
+  if (ret != GST_FLOW_OK) {
+    gst_buffer_unmap (buffer, &map);
+    return ret;
+  }
+
   errno = 0;
-  n = recv (avtpsrc->sk_fd, map.data, n, 0);
+  n = recv (avtpsrc->sk_fd, map.data, n, MSG_DONTWAIT);
   if (n < 0) {
-    if (errno == EINTR) {
+    if (errno == EINTR || errno == EAGAIN) {
       goto retry;
     }
     GST_ELEMENT_ERROR (avtpsrc, RESOURCE, READ, (NULL),
@@ -300,6 +504,7 @@ retry:
   }
 
   gst_buffer_unmap (buffer, &map);
+  gst_buffer_resize (buffer, 0, n);
 
   return GST_FLOW_OK;
 }
@@ -25,6 +25,8 @@
 #include <gst/gst.h>
 #include <gst/base/gstpushsrc.h>
 
+#include "gstavtpring.h"
+
 G_BEGIN_DECLS
 
 #define GST_TYPE_AVTP_SRC (gst_avtp_src_get_type())
@@ -46,8 +48,17 @@ struct _GstAvtpSrc
 
   gchar * ifname;
   gchar * address;
+  guint ring_blocks;
 
   int sk_fd;
+  GstPoll *poll;
+  GstPollFD pfd;
+
+  /* RX ring, NULL when receiving with recv() */
+  GstAvtpRing *ring;
+  guint ring_block;
+  guint ring_pkts_left;
+  struct tpacket3_hdr *ring_pkt;
 };
 
 struct _GstAvtpSrcClass
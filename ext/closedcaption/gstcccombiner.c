@@ -54,16 +54,23 @@ static GstStaticPadTemplate captiontemplate =
 G_DEFINE_TYPE (GstCCCombiner, gst_cc_combiner, GST_TYPE_AGGREGATOR);
 #define parent_class gst_cc_combiner_parent_class
 
-typedef struct
+enum
 {
-  GstVideoCaptionType caption_type;
-  GstBuffer *buffer;
-} CaptionData;
+  PROP_0,
+  PROP_LOW_LATENCY,
+  PROP_ADDED_LATENCY,
+};
+
+#define DEFAULT_LOW_LATENCY FALSE
 
 static void
-caption_data_clear (CaptionData * data)
+gst_cc_combiner_clear_captions (GstCCCombiner * self)
 {
-  gst_buffer_unref (data->buffer);
+  guint i;
+
+  for (i = 0; i < self->n_current_frame_captions; i++)
+    gst_buffer_replace (&self->current_frame_captions[i].buffer, NULL);
+  self->n_current_frame_captions = 0;
 }
 
 static void
@@ -71,12 +78,52 @@ gst_cc_combiner_finalize (GObject * object)
 {
   GstCCCombiner *self = GST_CCCOMBINER (object);
 
-  g_array_unref (self->current_frame_captions);
-  self->current_frame_captions = NULL;
+  gst_cc_combiner_clear_captions (self);
 
   G_OBJECT_CLASS (parent_class)->finalize (object);
 }
 
+static void
+gst_cc_combiner_set_property (GObject * object, guint prop_id,
+    const GValue * value, GParamSpec * pspec)
+{
+  GstCCCombiner *self = GST_CCCOMBINER (object);
+
+  switch (prop_id) {
+    case PROP_LOW_LATENCY:
+      GST_OBJECT_LOCK (self);
+      self->low_latency = g_value_get_boolean (value);
+      GST_OBJECT_UNLOCK (self);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+}
+
+static void
+gst_cc_combiner_get_property (GObject * object, guint prop_id,
+    GValue * value, GParamSpec * pspec)
+{
+  GstCCCombiner *self = GST_CCCOMBINER (object);
+
+  switch (prop_id) {
+    case PROP_LOW_LATENCY:
+      GST_OBJECT_LOCK (self);
+      g_value_set_boolean (value, self->low_latency);
+      GST_OBJECT_UNLOCK (self);
+      break;
+    case PROP_ADDED_LATENCY:
+      GST_OBJECT_LOCK (self);
+      g_value_set_uint64 (value, self->added_latency);
+      GST_OBJECT_UNLOCK (self);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+}
+
 #define GST_FLOW_NEED_DATA GST_FLOW_CUSTOM_SUCCESS
 
 static GstFlowReturn
@@ -105,13 +152,22 @@ gst_cc_combiner_collect_captions (GstCCCombiner * self, gboolean timeout)
   do {
     GstBuffer *caption_buf;
     GstClockTime caption_time;
-    CaptionData caption_data;
+    CaptionData *caption_data;
+
+    if (self->n_current_frame_captions == GST_CC_COMBINER_MAX_CAPTIONS) {
+      GST_WARNING_OBJECT (self, "Too many captions for one video buffer, "
+          "keeping the remaining ones for the next");
+      break;
+    }
 
     caption_buf = gst_aggregator_pad_peek_buffer (caption_pad);
     if (!caption_buf) {
       if (gst_aggregator_pad_is_eos (caption_pad)) {
         GST_DEBUG_OBJECT (self, "Caption pad is EOS, we're done");
         break;
+      } else if (self->low_latency) {
+        GST_DEBUG_OBJECT (self, "No more caption data yet, not waiting");
+        break;
       } else if (!timeout) {
         GST_DEBUG_OBJECT (self, "Need more caption data");
         gst_object_unref (caption_pad);
@@ -149,7 +205,8 @@ gst_cc_combiner_collect_captions (GstCCCombiner * self, gboolean timeout)
     if (caption_time >= self->current_video_running_time_end) {
       gst_buffer_unref (caption_buf);
       break;
-    } else if (caption_time < self->current_video_running_time) {
+    } else if (caption_time < self->current_video_running_time
+        && !self->low_latency) {
       GST_DEBUG_OBJECT (self,
           "Caption buffer before current video frame, dropping");
 
@@ -162,23 +219,23 @@ gst_cc_combiner_collect_captions (GstCCCombiner * self, gboolean timeout)
     GST_LOG_OBJECT (self,
         "Collecting caption buffer %p %" GST_TIME_FORMAT " for video buffer %p",
         caption_buf, GST_TIME_ARGS (caption_time), self->current_video_buffer);
-    caption_data.caption_type = self->current_caption_type;
-    caption_data.buffer = caption_buf;
-    g_array_append_val (self->current_frame_captions, caption_data);
+    caption_data =
+        &self->current_frame_captions[self->n_current_frame_captions++];
+    caption_data->caption_type = self->current_caption_type;
+    caption_data->buffer = caption_buf;
     gst_aggregator_pad_drop_buffer (caption_pad);
   } while (TRUE);
 
-  if (self->current_frame_captions->len > 0) {
+  if (self->n_current_frame_captions > 0) {
     guint i;
 
     GST_LOG_OBJECT (self, "Attaching %u captions to buffer %p",
-        self->current_frame_captions->len, self->current_video_buffer);
+        self->n_current_frame_captions, self->current_video_buffer);
     video_buf = gst_buffer_make_writable (self->current_video_buffer);
     self->current_video_buffer = NULL;
 
-    for (i = 0; i < self->current_frame_captions->len; i++) {
-      CaptionData *caption_data =
-          &g_array_index (self->current_frame_captions, CaptionData, i);
+    for (i = 0; i < self->n_current_frame_captions; i++) {
+      CaptionData *caption_data = &self->current_frame_captions[i];
       GstMapInfo map;
 
       gst_buffer_map (caption_data->buffer, &map, GST_MAP_READ);
@@ -187,7 +244,7 @@ gst_cc_combiner_collect_captions (GstCCCombiner * self, gboolean timeout)
       gst_buffer_unmap (caption_data->buffer, &map);
     }
 
-    g_array_set_size (self->current_frame_captions, 0);
+    gst_cc_combiner_clear_captions (self);
   } else {
     GST_LOG_OBJECT (self, "No captions for buffer %p",
         self->current_video_buffer);
@@ -305,6 +362,10 @@ gst_cc_combiner_aggregate (GstAggregator * aggregator, gboolean timeout)
         self->current_video_running_time_end =
             gst_segment_to_running_time (&video_pad->segment, GST_FORMAT_TIME,
             end_time);
+      } else if (self->low_latency) {
+        /* Don't wait for the next video buffer to know where this one
+         * ends, only take the captions that are due by its start */
+        self->current_video_running_time_end = video_start + 1;
       } else {
         self->current_video_running_time_end = GST_CLOCK_TIME_NONE;
       }
@@ -366,8 +427,17 @@ gst_cc_combiner_sink_event (GstAggregator * aggregator,
         if (fps_n != self->video_fps_n || fps_d != self->video_fps_d) {
           GstClockTime latency;
 
-          latency = gst_util_uint64_scale (GST_SECOND, fps_d, fps_n);
+          /* In low latency mode we never wait for captions covering the
+           * whole frame, so no latency is added */
+          if (self->low_latency || fps_n == 0)
+            latency = 0;
+          else
+            latency = gst_util_uint64_scale (GST_SECOND, fps_d, fps_n);
           gst_aggregator_set_latency (aggregator, latency, latency);
+
+          GST_OBJECT_LOCK (self);
+          self->added_latency = latency;
+          GST_OBJECT_UNLOCK (self);
         }
 
         self->video_fps_n = fps_n;
@@ -396,9 +466,13 @@ gst_cc_combiner_stop (GstAggregator * aggregator)
       GST_CLOCK_TIME_NONE;
   gst_buffer_replace (&self->current_video_buffer, NULL);
 
-  g_array_set_size (self->current_frame_captions, 0);
+  gst_cc_combiner_clear_captions (self);
   self->current_caption_type = GST_VIDEO_CAPTION_TYPE_UNKNOWN;
 
+  GST_OBJECT_LOCK (self);
+  self->added_latency = 0;
+  GST_OBJECT_UNLOCK (self);
+
   return TRUE;
 }
 
@@ -413,7 +487,7 @@ gst_cc_combiner_flush (GstAggregator * aggregator)
       GST_CLOCK_TIME_NONE;
   gst_buffer_replace (&self->current_video_buffer, NULL);
 
-  g_array_set_size (self->current_frame_captions, 0);
+  gst_cc_combiner_clear_captions (self);
 
   src_pad->segment.position = GST_CLOCK_TIME_NONE;
 
@@ -558,6 +632,28 @@ gst_cc_combiner_class_init (GstCCCombinerClass * klass)
   aggregator_class = (GstAggregatorClass *) klass;
 
   gobject_class->finalize = gst_cc_combiner_finalize;
+  gobject_class->set_property = gst_cc_combiner_set_property;
+  gobject_class->get_property = gst_cc_combiner_get_property;
+
+  /**
+   * GstCCCombiner:low-latency:
+   *
+   * Output each video buffer as soon as it is due, with whatever captions
+   * are available by then, instead of waiting for captions covering its
+   * whole duration. Captions arriving after their video buffer was output
+   * are attached to the next one.
+   */
+  g_object_class_install_property (gobject_class, PROP_LOW_LATENCY,
+      g_param_spec_boolean ("low-latency", "Low Latency",
+          "Don't wait for captions covering the whole video frame",
+          DEFAULT_LOW_LATENCY,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS |
+          GST_PARAM_MUTABLE_READY));
+
+  g_object_class_install_property (gobject_class, PROP_ADDED_LATENCY,
+      g_param_spec_uint64 ("added-latency", "Added Latency",
+          "Latency added by waiting for captions, in nanoseconds", 0,
+          G_MAXUINT64, 0, G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
 
   gst_element_class_set_static_metadata (gstelement_class,
       "Closed Caption Combiner",
@@ -598,10 +694,9 @@ gst_cc_combiner_init (GstCCCombiner * self)
   gst_object_unref (templ);
   gst_element_add_pad (GST_ELEMENT_CAST (self), GST_PAD_CAST (agg_pad));
 
-  self->current_frame_captions =
-      g_array_new (FALSE, FALSE, sizeof (CaptionData));
-  g_array_set_clear_func (self->current_frame_captions,
-      (GDestroyNotify) caption_data_clear);
+  self->n_current_frame_captions = 0;
+  self->low_latency = DEFAULT_LOW_LATENCY;
+  self->added_latency = 0;
 
   self->current_video_running_time = self->current_video_running_time_end =
       GST_CLOCK_TIME_NONE;
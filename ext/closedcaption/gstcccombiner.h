@@ -40,6 +40,15 @@ G_BEGIN_DECLS
 typedef struct _GstCCCombiner GstCCCombiner;
 typedef struct _GstCCCombinerClass GstCCCombinerClass;
 
+/* Maximum number of caption buffers attached to a single video buffer */
+#define GST_CC_COMBINER_MAX_CAPTIONS 64
+
+typedef struct
+{
+  GstVideoCaptionType caption_type;
+  GstBuffer *buffer;
+} CaptionData;
+
 struct _GstCCCombiner
 {
   GstAggregator parent;
@@ -49,8 +58,16 @@ struct _GstCCCombiner
   GstClockTime current_video_running_time_end;
   GstBuffer *current_video_buffer;
 
-  GArray *current_frame_captions;
+  /* captions collected for the current video buffer, preallocated so that
+   * nothing is allocated per frame */
+  CaptionData current_frame_captions[GST_CC_COMBINER_MAX_CAPTIONS];
+  guint n_current_frame_captions;
   GstVideoCaptionType current_caption_type;
+
+  /* properties */
+  gboolean low_latency;
+
+  GstClockTime added_latency;
 };
 
 struct _GstCCCombinerClass
@@ -33,6 +33,8 @@
 GST_DEBUG_CATEGORY_STATIC (gst_cc_converter_debug);
 #define GST_CAT_DEFAULT gst_cc_converter_debug
 
+#define MAX_CDP_PACKET_LEN 256
+
 /* Ordered by the amount of information they can contain */
 #define CC_CAPS \
         "closedcaption/x-cea-708,format=(string) cdp; " \
@@ -66,7 +68,7 @@ gst_cc_converter_transform_size (GstBaseTransform * base,
    * downsize the buffer as needed. The worst-case is one CDP packet, which
    * can be up to 256 bytes large */
 
-  *othersize = 256;
+  *othersize = MAX_CDP_PACKET_LEN;
 
   return TRUE;
 }
@@ -426,6 +428,9 @@ gst_cc_converter_set_caps (GstBaseTransform * base, GstCaps * incaps,
   /* Caps can be different but we can passthrough as long as they can
    * intersect, i.e. have same caps name and format */
   passthrough = gst_caps_can_intersect (incaps, outcaps);
+  self->convert =
+      passthrough ? NULL :
+      converters[self->input_caption_type][self->output_caption_type];
   gst_base_transform_set_passthrough (base, passthrough);
 
   GST_DEBUG_OBJECT (self,
@@ -444,7 +449,7 @@ invalid_caps:
 }
 
 /* Converts raw CEA708 cc_data and an optional timecode into CDP */
-static guint
+static gint
 convert_cea708_cc_data_cea708_cdp_internal (GstCCConverter * self,
     const guint8 * cc_data, guint cc_data_len, guint8 * cdp, guint cdp_len,
     const GstVideoTimeCodeMeta * tc_meta)
@@ -561,7 +566,7 @@ convert_cea708_cc_data_cea708_cdp_internal (GstCCConverter * self,
 /* Converts CDP into raw CEA708 cc_data */
 static guint
 convert_cea708_cdp_cea708_cc_data_internal (GstCCConverter * self,
-    const guint8 * cdp, guint cdp_len, guint8 cc_data[256],
+    const guint8 * cdp, guint cdp_len, guint8 cc_data[MAX_CDP_PACKET_LEN],
     GstVideoTimeCode * tc)
 {
   GstByteReader br;
@@ -699,397 +704,307 @@ convert_cea708_cdp_cea708_cc_data_internal (GstCCConverter * self,
 }
 
 
-static GstFlowReturn
-convert_cea608_raw_cea608_s334_1a (GstCCConverter * self, GstBuffer * inbuf,
-    GstBuffer * outbuf)
+/* The converters below all work on caller-provided memory: @in holds one
+ * packet of the input caption type, and the output is written to @out which
+ * has room for @out_len bytes (at least MAX_CDP_PACKET_LEN). They return the
+ * number of bytes written, or -1 on error. Timecodes found in CDP input are
+ * returned in @tc, which is otherwise left untouched. */
+
+static gint
+convert_cea608_raw_cea608_s334_1a (GstCCConverter * self, const guint8 * in,
+    guint in_len, guint8 * out, guint out_len,
+    const GstVideoTimeCodeMeta * tc_meta, GstVideoTimeCode * tc)
 {
-  GstMapInfo in, out;
   guint i, n;
 
-  n = gst_buffer_get_size (inbuf);
+  n = in_len;
   if (n & 1) {
     GST_ERROR_OBJECT (self, "Invalid raw CEA608 buffer size");
-    return GST_FLOW_ERROR;
+    return -1;
   }
 
   n /= 2;
 
   if (n > 3) {
     GST_ERROR_OBJECT (self, "Too many CEA608 pairs %u", n);
-    return GST_FLOW_ERROR;
+    return -1;
   }
 
-  gst_buffer_set_size (outbuf, 3 * n);
-
-  gst_buffer_map (inbuf, &in, GST_MAP_READ);
-  gst_buffer_map (outbuf, &out, GST_MAP_WRITE);
-
   /* We have to assume that each value is from the first field and
    * don't know from which line offset it originally is */
   for (i = 0; i < n; i++) {
-    out.data[i * 3] = 0x80;
-    out.data[i * 3 + 1] = in.data[i * 2];
-    out.data[i * 3 + 2] = in.data[i * 2 + 1];
+    out[i * 3] = 0x80;
+    out[i * 3 + 1] = in[i * 2];
+    out[i * 3 + 2] = in[i * 2 + 1];
   }
 
-  gst_buffer_unmap (inbuf, &in);
-  gst_buffer_unmap (outbuf, &out);
-
-  return GST_FLOW_OK;
+  return 3 * n;
 }
 
-static GstFlowReturn
-convert_cea608_raw_cea708_cc_data (GstCCConverter * self, GstBuffer * inbuf,
-    GstBuffer * outbuf)
+static gint
+convert_cea608_raw_cea708_cc_data (GstCCConverter * self, const guint8 * in,
+    guint in_len, guint8 * out, guint out_len,
+    const GstVideoTimeCodeMeta * tc_meta, GstVideoTimeCode * tc)
 {
-  GstMapInfo in, out;
   guint i, n;
 
-  n = gst_buffer_get_size (inbuf);
+  n = in_len;
   if (n & 1) {
     GST_ERROR_OBJECT (self, "Invalid raw CEA608 buffer size");
-    return GST_FLOW_ERROR;
+    return -1;
   }
 
   n /= 2;
 
   if (n > 3) {
     GST_ERROR_OBJECT (self, "Too many CEA608 pairs %u", n);
-    return GST_FLOW_ERROR;
+    return -1;
   }
 
-  gst_buffer_set_size (outbuf, 3 * n);
-
-  gst_buffer_map (inbuf, &in, GST_MAP_READ);
-  gst_buffer_map (outbuf, &out, GST_MAP_WRITE);
-
   /* We have to assume that each value is from the first field and
    * don't know from which line offset it originally is */
   for (i = 0; i < n; i++) {
-    out.data[i * 3] = 0xfc;
-    out.data[i * 3 + 1] = in.data[i * 2];
-    out.data[i * 3 + 2] = in.data[i * 2 + 1];
+    out[i * 3] = 0xfc;
+    out[i * 3 + 1] = in[i * 2];
+    out[i * 3 + 2] = in[i * 2 + 1];
   }
 
-  gst_buffer_unmap (inbuf, &in);
-  gst_buffer_unmap (outbuf, &out);
-
-  return GST_FLOW_OK;
+  return 3 * n;
 }
 
-static GstFlowReturn
-convert_cea608_raw_cea708_cdp (GstCCConverter * self, GstBuffer * inbuf,
-    GstBuffer * outbuf)
+static gint
+convert_cea608_raw_cea708_cdp (GstCCConverter * self, const guint8 * in,
+    guint in_len, guint8 * out, guint out_len,
+    const GstVideoTimeCodeMeta * tc_meta, GstVideoTimeCode * tc)
 {
-  GstMapInfo in, out;
-  guint i, n, len;
-  guint8 cc_data[256];
+  guint i, n;
+  guint8 cc_data[MAX_CDP_PACKET_LEN];
 
-  n = gst_buffer_get_size (inbuf);
+  n = in_len;
   if (n & 1) {
     GST_ERROR_OBJECT (self, "Invalid raw CEA608 buffer size");
-    return GST_FLOW_ERROR;
+    return -1;
   }
 
   n /= 2;
 
   if (n > 3) {
     GST_ERROR_OBJECT (self, "Too many CEA608 pairs %u", n);
-    return GST_FLOW_ERROR;
+    return -1;
   }
 
-  gst_buffer_map (inbuf, &in, GST_MAP_READ);
-  gst_buffer_map (outbuf, &out, GST_MAP_WRITE);
-
   for (i = 0; i < n; i++) {
     cc_data[i * 3] = 0xfc;
-    cc_data[i * 3 + 1] = in.data[i * 2];
-    cc_data[i * 3 + 2] = in.data[i * 2 + 1];
+    cc_data[i * 3 + 1] = in[i * 2];
+    cc_data[i * 3 + 2] = in[i * 2 + 1];
   }
 
-  len =
-      convert_cea708_cc_data_cea708_cdp_internal (self, cc_data, n * 3,
-      out.data, out.size, gst_buffer_get_video_time_code_meta (inbuf));
-
-  gst_buffer_unmap (inbuf, &in);
-  gst_buffer_unmap (outbuf, &out);
-
-  if (len == -1)
-    return GST_FLOW_ERROR;
-
-  gst_buffer_set_size (outbuf, len);
-
-  return GST_FLOW_OK;
+  return convert_cea708_cc_data_cea708_cdp_internal (self, cc_data, n * 3,
+      out, out_len, tc_meta);
 }
 
-static GstFlowReturn
-convert_cea608_s334_1a_cea608_raw (GstCCConverter * self, GstBuffer * inbuf,
-    GstBuffer * outbuf)
+static gint
+convert_cea608_s334_1a_cea608_raw (GstCCConverter * self, const guint8 * in,
+    guint in_len, guint8 * out, guint out_len,
+    const GstVideoTimeCodeMeta * tc_meta, GstVideoTimeCode * tc)
 {
-  GstMapInfo in, out;
   guint i, n;
   guint cea608 = 0;
 
-  n = gst_buffer_get_size (inbuf);
+  n = in_len;
   if (n % 3 != 0) {
     GST_ERROR_OBJECT (self, "Invalid S334-1A CEA608 buffer size");
-    return GST_FLOW_ERROR;
+    return -1;
   }
 
   n /= 3;
 
   if (n > 3) {
     GST_ERROR_OBJECT (self, "Too many S334-1A CEA608 triplets %u", n);
-    return GST_FLOW_ERROR;
+    return -1;
   }
 
-  gst_buffer_map (inbuf, &in, GST_MAP_READ);
-  gst_buffer_map (outbuf, &out, GST_MAP_WRITE);
-
   for (i = 0; i < n; i++) {
-    if (in.data[i * 3] & 0x80) {
-      out.data[i * 2] = in.data[i * 3 + 1];
-      out.data[i * 2 + 1] = in.data[i * 3 + 2];
+    if (in[i * 3] & 0x80) {
+      out[cea608 * 2] = in[i * 3 + 1];
+      out[cea608 * 2 + 1] = in[i * 3 + 2];
       cea608++;
     }
   }
 
-  gst_buffer_unmap (inbuf, &in);
-  gst_buffer_unmap (outbuf, &out);
-
-  gst_buffer_set_size (outbuf, 2 * cea608);
-
-  return GST_FLOW_OK;
+  return 2 * cea608;
 }
 
-static GstFlowReturn
-convert_cea608_s334_1a_cea708_cc_data (GstCCConverter * self, GstBuffer * inbuf,
-    GstBuffer * outbuf)
+static gint
+convert_cea608_s334_1a_cea708_cc_data (GstCCConverter * self,
+    const guint8 * in, guint in_len, guint8 * out, guint out_len,
+    const GstVideoTimeCodeMeta * tc_meta, GstVideoTimeCode * tc)
 {
-  GstMapInfo in, out;
   guint i, n;
 
-  n = gst_buffer_get_size (inbuf);
+  n = in_len;
   if (n % 3 != 0) {
     GST_ERROR_OBJECT (self, "Invalid S334-1A CEA608 buffer size");
-    return GST_FLOW_ERROR;
+    return -1;
   }
 
   n /= 3;
 
   if (n > 3) {
     GST_ERROR_OBJECT (self, "Too many S334-1A CEA608 triplets %u", n);
-    return GST_FLOW_ERROR;
+    return -1;
   }
 
-  gst_buffer_set_size (outbuf, 3 * n);
-
-  gst_buffer_map (inbuf, &in, GST_MAP_READ);
-  gst_buffer_map (outbuf, &out, GST_MAP_WRITE);
-
   for (i = 0; i < n; i++) {
-    out.data[i * 3] = (in.data[i * 3] & 0x80) ? 0xfc : 0xfd;
-    out.data[i * 3 + 1] = in.data[i * 3 + 1];
-    out.data[i * 3 + 2] = in.data[i * 3 + 2];
+    out[i * 3] = (in[i * 3] & 0x80) ? 0xfc : 0xfd;
+    out[i * 3 + 1] = in[i * 3 + 1];
+    out[i * 3 + 2] = in[i * 3 + 2];
   }
 
-  gst_buffer_unmap (inbuf, &in);
-  gst_buffer_unmap (outbuf, &out);
-
-  return GST_FLOW_OK;
+  return 3 * n;
 }
 
-static GstFlowReturn
-convert_cea608_s334_1a_cea708_cdp (GstCCConverter * self, GstBuffer * inbuf,
-    GstBuffer * outbuf)
+static gint
+convert_cea608_s334_1a_cea708_cdp (GstCCConverter * self, const guint8 * in,
+    guint in_len, guint8 * out, guint out_len,
+    const GstVideoTimeCodeMeta * tc_meta, GstVideoTimeCode * tc)
 {
-  GstMapInfo in, out;
-  guint i, n, len;
-  guint8 cc_data[256];
+  guint i, n;
+  guint8 cc_data[MAX_CDP_PACKET_LEN];
 
-  n = gst_buffer_get_size (inbuf);
+  n = in_len;
   if (n % 3 != 0) {
     GST_ERROR_OBJECT (self, "Invalid S334-1A CEA608 buffer size");
-    return GST_FLOW_ERROR;
+    return -1;
   }
 
   n /= 3;
 
   if (n > 3) {
     GST_ERROR_OBJECT (self, "Too many S334-1A CEA608 triplets %u", n);
-    return GST_FLOW_ERROR;
+    return -1;
   }
 
-  gst_buffer_map (inbuf, &in, GST_MAP_READ);
-  gst_buffer_map (outbuf, &out, GST_MAP_WRITE);
-
   for (i = 0; i < n; i++) {
-    cc_data[i * 3] = (in.data[i * 3] & 0x80) ? 0xfc : 0xfd;
-    cc_data[i * 3 + 1] = in.data[i * 3 + 1];
-    cc_data[i * 3 + 2] = in.data[i * 3 + 2];
+    cc_data[i * 3] = (in[i * 3] & 0x80) ? 0xfc : 0xfd;
+    cc_data[i * 3 + 1] = in[i * 3 + 1];
+    cc_data[i * 3 + 2] = in[i * 3 + 2];
   }
 
-  len =
-      convert_cea708_cc_data_cea708_cdp_internal (self, cc_data, n * 3,
-      out.data, out.size, gst_buffer_get_video_time_code_meta (inbuf));
-
-  gst_buffer_unmap (inbuf, &in);
-  gst_buffer_unmap (outbuf, &out);
-
-  if (len == -1)
-    return GST_FLOW_ERROR;
-
-  gst_buffer_set_size (outbuf, len);
-
-  return GST_FLOW_OK;
+  return convert_cea708_cc_data_cea708_cdp_internal (self, cc_data, n * 3,
+      out, out_len, tc_meta);
 }
 
-static GstFlowReturn
-convert_cea708_cc_data_cea608_raw (GstCCConverter * self, GstBuffer * inbuf,
-    GstBuffer * outbuf)
+static gint
+convert_cea708_cc_data_cea608_raw (GstCCConverter * self, const guint8 * in,
+    guint in_len, guint8 * out, guint out_len,
+    const GstVideoTimeCodeMeta * tc_meta, GstVideoTimeCode * tc)
 {
-  GstMapInfo in, out;
   guint i, n;
   guint cea608 = 0;
 
-  n = gst_buffer_get_size (inbuf);
+  n = in_len;
   if (n % 3 != 0) {
     GST_ERROR_OBJECT (self, "Invalid raw CEA708 buffer size");
-    return GST_FLOW_ERROR;
+    return -1;
   }
 
   n /= 3;
 
   if (n > 25) {
     GST_ERROR_OBJECT (self, "Too many CEA708 triplets %u", n);
-    return GST_FLOW_ERROR;
+    return -1;
   }
 
-  gst_buffer_map (inbuf, &in, GST_MAP_READ);
-  gst_buffer_map (outbuf, &out, GST_MAP_WRITE);
-
   for (i = 0; i < n; i++) {
     /* We can only really copy the first field here as there can't be any
      * signalling in raw CEA608 and we must not mix the streams of different
      * fields
      */
-    if (in.data[i * 3] == 0xfc) {
-      out.data[cea608 * 2] = in.data[i * 3 + 1];
-      out.data[cea608 * 2 + 1] = in.data[i * 3 + 2];
+    if (in[i * 3] == 0xfc) {
+      out[cea608 * 2] = in[i * 3 + 1];
+      out[cea608 * 2 + 1] = in[i * 3 + 2];
       cea608++;
     }
   }
 
-  gst_buffer_unmap (inbuf, &in);
-  gst_buffer_unmap (outbuf, &out);
-
-  gst_buffer_set_size (outbuf, 2 * cea608);
-
-  return GST_FLOW_OK;
+  return 2 * cea608;
 }
 
-static GstFlowReturn
-convert_cea708_cc_data_cea608_s334_1a (GstCCConverter * self, GstBuffer * inbuf,
-    GstBuffer * outbuf)
+static gint
+convert_cea708_cc_data_cea608_s334_1a (GstCCConverter * self,
+    const guint8 * in, guint in_len, guint8 * out, guint out_len,
+    const GstVideoTimeCodeMeta * tc_meta, GstVideoTimeCode * tc)
 {
-  GstMapInfo in, out;
   guint i, n;
   guint cea608 = 0;
 
-  n = gst_buffer_get_size (inbuf);
+  n = in_len;
   if (n % 3 != 0) {
     GST_ERROR_OBJECT (self, "Invalid raw CEA708 buffer size");
-    return GST_FLOW_ERROR;
+    return -1;
   }
 
   n /= 3;
 
   if (n > 25) {
     GST_ERROR_OBJECT (self, "Too many CEA708 triplets %u", n);
-    return GST_FLOW_ERROR;
+    return -1;
   }
 
-  gst_buffer_map (inbuf, &in, GST_MAP_READ);
-  gst_buffer_map (outbuf, &out, GST_MAP_WRITE);
-
   for (i = 0; i < n; i++) {
-    if (in.data[i * 3] == 0xfc || in.data[i * 3] == 0xfd) {
+    if (in[i * 3] == 0xfc || in[i * 3] == 0xfd) {
       /* We have to assume a line offset of 0 */
-      out.data[cea608 * 3] = in.data[i * 3] == 0xfc ? 0x80 : 0x00;
-      out.data[cea608 * 3 + 1] = in.data[i * 3 + 1];
-      out.data[cea608 * 3 + 2] = in.data[i * 3 + 2];
+      out[cea608 * 3] = in[i * 3] == 0xfc ? 0x80 : 0x00;
+      out[cea608 * 3 + 1] = in[i * 3 + 1];
+      out[cea608 * 3 + 2] = in[i * 3 + 2];
       cea608++;
     }
   }
 
-  gst_buffer_unmap (inbuf, &in);
-  gst_buffer_unmap (outbuf, &out);
-
-  gst_buffer_set_size (outbuf, 3 * cea608);
-
-  return GST_FLOW_OK;
+  return 3 * cea608;
 }
 
-static GstFlowReturn
-convert_cea708_cc_data_cea708_cdp (GstCCConverter * self, GstBuffer * inbuf,
-    GstBuffer * outbuf)
+static gint
+convert_cea708_cc_data_cea708_cdp (GstCCConverter * self, const guint8 * in,
+    guint in_len, guint8 * out, guint out_len,
+    const GstVideoTimeCodeMeta * tc_meta, GstVideoTimeCode * tc)
 {
-  GstMapInfo in, out;
   guint n;
-  guint len;
 
-  n = gst_buffer_get_size (inbuf);
+  n = in_len;
   if (n % 3 != 0) {
     GST_ERROR_OBJECT (self, "Invalid raw CEA708 buffer size");
-    return GST_FLOW_ERROR;
+    return -1;
   }
 
   n /= 3;
 
   if (n > 25) {
     GST_ERROR_OBJECT (self, "Too many CEA708 triplets %u", n);
-    return GST_FLOW_ERROR;
+    return -1;
   }
 
-  gst_buffer_map (inbuf, &in, GST_MAP_READ);
-  gst_buffer_map (outbuf, &out, GST_MAP_WRITE);
-
-  len =
-      convert_cea708_cc_data_cea708_cdp_internal (self, in.data, in.size,
-      out.data, out.size, gst_buffer_get_video_time_code_meta (inbuf));
-
-  gst_buffer_unmap (inbuf, &in);
-  gst_buffer_unmap (outbuf, &out);
-
-  if (len == -1)
-    return GST_FLOW_ERROR;
-
-  gst_buffer_set_size (outbuf, len);
-
-  return GST_FLOW_OK;
+  return convert_cea708_cc_data_cea708_cdp_internal (self, in, in_len,
+      out, out_len, tc_meta);
 }
 
-static GstFlowReturn
-convert_cea708_cdp_cea608_raw (GstCCConverter * self, GstBuffer * inbuf,
-    GstBuffer * outbuf)
+static gint
+convert_cea708_cdp_cea608_raw (GstCCConverter * self, const guint8 * in,
+    guint in_len, guint8 * out, guint out_len,
+    const GstVideoTimeCodeMeta * tc_meta, GstVideoTimeCode * tc)
 {
-  GstMapInfo in, out;
   guint i;
-  GstVideoTimeCode tc;
-  guint8 cc_data[256];
+  guint8 cc_data[MAX_CDP_PACKET_LEN];
   guint len, cea608 = 0;
 
-  gst_buffer_map (inbuf, &in, GST_MAP_READ);
-  gst_buffer_map (outbuf, &out, GST_MAP_WRITE);
-
-  len =
-      convert_cea708_cdp_cea708_cc_data_internal (self, in.data, in.size,
-      cc_data, &tc);
+  len = convert_cea708_cdp_cea708_cc_data_internal (self, in, in_len,
+      cc_data, tc);
   len /= 3;
 
   if (len > 25) {
     GST_ERROR_OBJECT (self, "Too many cc_data triples in CDP packet %u", len);
-    return GST_FLOW_ERROR;
+    return -1;
   }
 
   for (i = 0; i < len; i++) {
@@ -1098,97 +1013,139 @@ convert_cea708_cdp_cea608_raw (GstCCConverter * self, GstBuffer * inbuf,
      * fields
      */
     if (cc_data[i * 3] == 0xfc) {
-      out.data[cea608 * 2] = cc_data[i * 3 + 1];
-      out.data[cea608 * 2 + 1] = cc_data[i * 3 + 2];
+      out[cea608 * 2] = cc_data[i * 3 + 1];
+      out[cea608 * 2 + 1] = cc_data[i * 3 + 2];
       cea608++;
     }
   }
 
-  gst_buffer_unmap (inbuf, &in);
-  gst_buffer_unmap (outbuf, &out);
-
-  gst_buffer_set_size (outbuf, 2 * cea608);
-
-  if (tc.config.fps_n != 0 && !gst_buffer_get_video_time_code_meta (inbuf))
-    gst_buffer_add_video_time_code_meta (outbuf, &tc);
-
-  return GST_FLOW_OK;
+  return 2 * cea608;
 }
 
-static GstFlowReturn
-convert_cea708_cdp_cea608_s334_1a (GstCCConverter * self, GstBuffer * inbuf,
-    GstBuffer * outbuf)
+static gint
+convert_cea708_cdp_cea608_s334_1a (GstCCConverter * self, const guint8 * in,
+    guint in_len, guint8 * out, guint out_len,
+    const GstVideoTimeCodeMeta * tc_meta, GstVideoTimeCode * tc)
 {
-  GstMapInfo in, out;
   guint i;
-  GstVideoTimeCode tc;
-  guint8 cc_data[256];
+  guint8 cc_data[MAX_CDP_PACKET_LEN];
   guint len, cea608 = 0;
 
-  gst_buffer_map (inbuf, &in, GST_MAP_READ);
-  gst_buffer_map (outbuf, &out, GST_MAP_WRITE);
-
-  len =
-      convert_cea708_cdp_cea708_cc_data_internal (self, in.data, in.size,
-      cc_data, &tc);
+  len = convert_cea708_cdp_cea708_cc_data_internal (self, in, in_len,
+      cc_data, tc);
   len /= 3;
 
   if (len > 25) {
     GST_ERROR_OBJECT (self, "Too many cc_data triples in CDP packet %u", len);
-    return GST_FLOW_ERROR;
+    return -1;
   }
 
   for (i = 0; i < len; i++) {
     if (cc_data[i * 3] == 0xfc || cc_data[i * 3] == 0xfd) {
       /* We have to assume a line offset of 0 */
-      out.data[cea608 * 3] = cc_data[i * 3] == 0xfc ? 0x80 : 0x00;
-      out.data[cea608 * 3 + 1] = cc_data[i * 3 + 1];
-      out.data[cea608 * 3 + 2] = cc_data[i * 3 + 2];
+      out[cea608 * 3] = cc_data[i * 3] == 0xfc ? 0x80 : 0x00;
+      out[cea608 * 3 + 1] = cc_data[i * 3 + 1];
+      out[cea608 * 3 + 2] = cc_data[i * 3 + 2];
       cea608++;
     }
   }
 
-  gst_buffer_unmap (inbuf, &in);
-  gst_buffer_unmap (outbuf, &out);
+  return 3 * cea608;
+}
 
-  gst_buffer_set_size (outbuf, 3 * cea608);
+static gint
+convert_cea708_cdp_cea708_cc_data (GstCCConverter * self, const guint8 * in,
+    guint in_len, guint8 * out, guint out_len,
+    const GstVideoTimeCodeMeta * tc_meta, GstVideoTimeCode * tc)
+{
+  guint len;
 
-  if (tc.config.fps_n != 0 && !gst_buffer_get_video_time_code_meta (inbuf))
-    gst_buffer_add_video_time_code_meta (outbuf, &tc);
+  len = convert_cea708_cdp_cea708_cc_data_internal (self, in, in_len,
+      out, tc);
 
-  return GST_FLOW_OK;
+  if (len / 3 > 25) {
+    GST_ERROR_OBJECT (self, "Too many cc_data triples in CDP packet %u",
+        len / 3);
+    return -1;
+  }
+
+  return len;
 }
 
+/* Indexed by input and output GstVideoCaptionType, NULL for passthrough */
+static const GstCCConverterFunc converters[5][5] = {
+  [GST_VIDEO_CAPTION_TYPE_CEA608_RAW] = {
+        [GST_VIDEO_CAPTION_TYPE_CEA608_S334_1A] =
+        convert_cea608_raw_cea608_s334_1a,
+        [GST_VIDEO_CAPTION_TYPE_CEA708_RAW] = convert_cea608_raw_cea708_cc_data,
+        [GST_VIDEO_CAPTION_TYPE_CEA708_CDP] = convert_cea608_raw_cea708_cdp,
+      },
+  [GST_VIDEO_CAPTION_TYPE_CEA608_S334_1A] = {
+        [GST_VIDEO_CAPTION_TYPE_CEA608_RAW] = convert_cea608_s334_1a_cea608_raw,
+        [GST_VIDEO_CAPTION_TYPE_CEA708_RAW] =
+        convert_cea608_s334_1a_cea708_cc_data,
+        [GST_VIDEO_CAPTION_TYPE_CEA708_CDP] = convert_cea608_s334_1a_cea708_cdp,
+      },
+  [GST_VIDEO_CAPTION_TYPE_CEA708_RAW] = {
+        [GST_VIDEO_CAPTION_TYPE_CEA608_RAW] = convert_cea708_cc_data_cea608_raw,
+        [GST_VIDEO_CAPTION_TYPE_CEA608_S334_1A] =
+        convert_cea708_cc_data_cea608_s334_1a,
+        [GST_VIDEO_CAPTION_TYPE_CEA708_CDP] = convert_cea708_cc_data_cea708_cdp,
+      },
+  [GST_VIDEO_CAPTION_TYPE_CEA708_CDP] = {
+        [GST_VIDEO_CAPTION_TYPE_CEA608_RAW] = convert_cea708_cdp_cea608_raw,
+        [GST_VIDEO_CAPTION_TYPE_CEA608_S334_1A] =
+        convert_cea708_cdp_cea608_s334_1a,
+        [GST_VIDEO_CAPTION_TYPE_CEA708_RAW] = convert_cea708_cdp_cea708_cc_data,
+      },
+};
+
+/* Converts @inbuf into @outbuf, which must be writable and at least
+ * MAX_CDP_PACKET_LEN bytes large. Both buffers are mapped only once. */
 static GstFlowReturn
-convert_cea708_cdp_cea708_cc_data (GstCCConverter * self, GstBuffer * inbuf,
+gst_cc_converter_convert_buffer (GstCCConverter * self, GstBuffer * inbuf,
     GstBuffer * outbuf)
 {
+  GstVideoTimeCodeMeta *tc_meta = gst_buffer_get_video_time_code_meta (inbuf);
   GstMapInfo in, out;
   GstVideoTimeCode tc;
-  guint len;
+  gint len;
+
+  GST_LOG_OBJECT (self, "Converting %" GST_PTR_FORMAT " from %u to %u", inbuf,
+      self->input_caption_type, self->output_caption_type);
 
-  gst_buffer_map (inbuf, &in, GST_MAP_READ);
-  gst_buffer_map (outbuf, &out, GST_MAP_WRITE);
+  tc.config.fps_n = 0;
 
-  len =
-      convert_cea708_cdp_cea708_cc_data_internal (self, in.data, in.size,
-      out.data, &tc);
+  if (!gst_buffer_map (inbuf, &in, GST_MAP_READ))
+    goto map_failed;
+  if (!gst_buffer_map (outbuf, &out, GST_MAP_WRITE)) {
+    gst_buffer_unmap (inbuf, &in);
+    goto map_failed;
+  }
+
+  len = self->convert (self, in.data, in.size, out.data, out.size, tc_meta,
+      &tc);
 
   gst_buffer_unmap (inbuf, &in);
   gst_buffer_unmap (outbuf, &out);
 
-  if (len / 3 > 25) {
-    GST_ERROR_OBJECT (self, "Too many cc_data triples in CDP packet %u",
-        len / 3);
+  if (len < 0)
     return GST_FLOW_ERROR;
-  }
 
   gst_buffer_set_size (outbuf, len);
 
-  if (tc.config.fps_n != 0 && !gst_buffer_get_video_time_code_meta (inbuf))
+  if (tc_meta)
+    gst_buffer_add_video_time_code_meta (outbuf, &tc_meta->tc);
+  else if (tc.config.fps_n != 0)
     gst_buffer_add_video_time_code_meta (outbuf, &tc);
 
   return GST_FLOW_OK;
+
+map_failed:
+  {
+    GST_ERROR_OBJECT (self, "Failed to map buffer");
+    return GST_FLOW_ERROR;
+  }
 }
 
 static GstFlowReturn
@@ -1196,104 +1153,156 @@ gst_cc_converter_transform (GstBaseTransform * base, GstBuffer * inbuf,
     GstBuffer * outbuf)
 {
   GstCCConverter *self = GST_CCCONVERTER (base);
-  GstVideoTimeCodeMeta *tc_meta = gst_buffer_get_video_time_code_meta (inbuf);
+  GstFlowReturn ret;
+
+  ret = gst_cc_converter_convert_buffer (self, inbuf, outbuf);
+  if (ret != GST_FLOW_OK)
+    return ret;
+
+  GST_DEBUG_OBJECT (self, "Converted to %" GST_PTR_FORMAT, outbuf);
+
+  return gst_buffer_get_size (outbuf) >
+      0 ? GST_FLOW_OK : GST_BASE_TRANSFORM_FLOW_DROPPED;
+}
+
+/* Whether output buffers from @pool can hold any converted packet */
+static gboolean
+gst_cc_converter_pool_is_usable (GstBufferPool * pool)
+{
+  GstStructure *config;
+  guint size;
+  gboolean ret;
+
+  config = gst_buffer_pool_get_config (pool);
+  ret = gst_buffer_pool_config_get_params (config, NULL, &size, NULL, NULL)
+      && size >= MAX_CDP_PACKET_LEN;
+  gst_structure_free (config);
+
+  return ret;
+}
+
+/* Converts a whole buffer list into a new list of buffers from the
+ * negotiated pool and pushes it downstream in one go */
+static GstFlowReturn
+gst_cc_converter_chain_list (GstPad * pad, GstObject * parent,
+    GstBufferList * list)
+{
+  GstBaseTransform *base = GST_BASE_TRANSFORM (parent);
+  GstCCConverter *self = GST_CCCONVERTER (parent);
+  GstBufferPool *pool;
+  GstBufferList *outlist;
   GstFlowReturn ret = GST_FLOW_OK;
+  guint i, n;
 
-  GST_DEBUG_OBJECT (base, "Converting %" GST_PTR_FORMAT " from %u to %u", inbuf,
-      self->input_caption_type, self->output_caption_type);
+  n = gst_buffer_list_length (list);
+  pool = gst_base_transform_get_buffer_pool (base);
+
+  /* Let the base class handle the buffers one by one when it has more to do
+   * than converting them: setting up allocation, renegotiating, passing
+   * them through or dropping late ones. Also when the pool buffers might be
+   * too small to hold a converted packet */
+  if (pool == NULL || self->convert == NULL
+      || gst_base_transform_is_passthrough (base)
+      || gst_base_transform_is_qos_enabled (base)
+      || gst_pad_needs_reconfigure (base->srcpad)
+      || !gst_cc_converter_pool_is_usable (pool)) {
+    for (i = 0; i < n; i++) {
+      GstBuffer *buf = gst_buffer_list_get (list, i);
+
+      ret = self->chain (pad, parent, gst_buffer_ref (buf));
+      if (ret != GST_FLOW_OK)
+        break;
+    }
+    if (pool)
+      gst_object_unref (pool);
+    gst_buffer_list_unref (list);
+    return ret;
+  }
 
-  switch (self->input_caption_type) {
-    case GST_VIDEO_CAPTION_TYPE_CEA608_RAW:
-
-      switch (self->output_caption_type) {
-        case GST_VIDEO_CAPTION_TYPE_CEA608_S334_1A:
-          ret = convert_cea608_raw_cea608_s334_1a (self, inbuf, outbuf);
-          break;
-        case GST_VIDEO_CAPTION_TYPE_CEA708_RAW:
-          ret = convert_cea608_raw_cea708_cc_data (self, inbuf, outbuf);
-          break;
-        case GST_VIDEO_CAPTION_TYPE_CEA708_CDP:
-          ret = convert_cea608_raw_cea708_cdp (self, inbuf, outbuf);
-          break;
-        case GST_VIDEO_CAPTION_TYPE_CEA608_RAW:
-        default:
-          g_assert_not_reached ();
-          break;
-      }
+  outlist = gst_buffer_list_new_sized (n);
+  for (i = 0; i < n; i++) {
+    GstBuffer *inbuf = gst_buffer_list_get (list, i);
+    GstBuffer *outbuf = NULL;
 
+    ret = gst_buffer_pool_acquire_buffer (pool, &outbuf, NULL);
+    if (ret != GST_FLOW_OK)
       break;
-    case GST_VIDEO_CAPTION_TYPE_CEA608_S334_1A:
-
-      switch (self->output_caption_type) {
-        case GST_VIDEO_CAPTION_TYPE_CEA608_RAW:
-          ret = convert_cea608_s334_1a_cea608_raw (self, inbuf, outbuf);
-          break;
-        case GST_VIDEO_CAPTION_TYPE_CEA708_RAW:
-          ret = convert_cea608_s334_1a_cea708_cc_data (self, inbuf, outbuf);
-          break;
-        case GST_VIDEO_CAPTION_TYPE_CEA708_CDP:
-          ret = convert_cea608_s334_1a_cea708_cdp (self, inbuf, outbuf);
-          break;
-        case GST_VIDEO_CAPTION_TYPE_CEA608_S334_1A:
-        default:
-          g_assert_not_reached ();
-          break;
-      }
 
+    ret = gst_cc_converter_convert_buffer (self, inbuf, outbuf);
+    if (ret != GST_FLOW_OK) {
+      gst_buffer_unref (outbuf);
       break;
-    case GST_VIDEO_CAPTION_TYPE_CEA708_RAW:
-
-      switch (self->output_caption_type) {
-        case GST_VIDEO_CAPTION_TYPE_CEA608_RAW:
-          ret = convert_cea708_cc_data_cea608_raw (self, inbuf, outbuf);
-          break;
-        case GST_VIDEO_CAPTION_TYPE_CEA608_S334_1A:
-          ret = convert_cea708_cc_data_cea608_s334_1a (self, inbuf, outbuf);
-          break;
-        case GST_VIDEO_CAPTION_TYPE_CEA708_CDP:
-          ret = convert_cea708_cc_data_cea708_cdp (self, inbuf, outbuf);
-          break;
-        case GST_VIDEO_CAPTION_TYPE_CEA708_RAW:
-        default:
-          g_assert_not_reached ();
-          break;
-      }
+    }
 
-      break;
-    case GST_VIDEO_CAPTION_TYPE_CEA708_CDP:
-
-      switch (self->output_caption_type) {
-        case GST_VIDEO_CAPTION_TYPE_CEA608_RAW:
-          ret = convert_cea708_cdp_cea608_raw (self, inbuf, outbuf);
-          break;
-        case GST_VIDEO_CAPTION_TYPE_CEA608_S334_1A:
-          ret = convert_cea708_cdp_cea608_s334_1a (self, inbuf, outbuf);
-          break;
-        case GST_VIDEO_CAPTION_TYPE_CEA708_RAW:
-          ret = convert_cea708_cdp_cea708_cc_data (self, inbuf, outbuf);
-          break;
-        case GST_VIDEO_CAPTION_TYPE_CEA708_CDP:
-        default:
-          g_assert_not_reached ();
-          break;
-      }
+    if (gst_buffer_get_size (outbuf) == 0) {
+      gst_buffer_unref (outbuf);
+      continue;
+    }
 
-      break;
-    default:
-      g_assert_not_reached ();
-      break;
+    gst_buffer_copy_into (outbuf, inbuf,
+        GST_BUFFER_COPY_FLAGS | GST_BUFFER_COPY_TIMESTAMPS, 0, -1);
+    gst_buffer_list_add (outlist, outbuf);
   }
 
-  if (ret != GST_FLOW_OK)
-    return ret;
+  gst_object_unref (pool);
+  gst_buffer_list_unref (list);
 
-  if (tc_meta)
-    gst_buffer_add_video_time_code_meta (outbuf, &tc_meta->tc);
+  if (gst_buffer_list_length (outlist) > 0) {
+    GstFlowReturn push_ret = gst_pad_push_list (base->srcpad, outlist);
 
-  GST_DEBUG_OBJECT (self, "Converted to %" GST_PTR_FORMAT, outbuf);
+    if (ret == GST_FLOW_OK)
+      ret = push_ret;
+  } else {
+    gst_buffer_list_unref (outlist);
+  }
 
-  return gst_buffer_get_size (outbuf) >
-      0 ? GST_FLOW_OK : GST_BASE_TRANSFORM_FLOW_DROPPED;
+  return ret;
+}
+
+static gboolean
+gst_cc_converter_decide_allocation (GstBaseTransform * base, GstQuery * query)
+{
+  GstBufferPool *pool;
+  guint size, min, max;
+
+  if (gst_query_get_n_allocation_pools (query) == 0) {
+    /* Downstream usually has no pool for caption buffers. Provide our own
+     * so output buffers are recycled instead of allocated per packet */
+    GstStructure *config;
+    GstCaps *caps;
+
+    gst_query_parse_allocation (query, &caps, NULL);
+
+    pool = gst_buffer_pool_new ();
+    config = gst_buffer_pool_get_config (pool);
+    gst_buffer_pool_config_set_params (config, caps, MAX_CDP_PACKET_LEN, 0, 0);
+    if (!gst_buffer_pool_set_config (pool, config)
+        && !gst_cc_converter_pool_is_usable (pool)) {
+      GST_DEBUG_OBJECT (base, "pool does not accept %u bytes buffers",
+          MAX_CDP_PACKET_LEN);
+      gst_object_unref (pool);
+      pool = NULL;
+    }
+
+    if (pool) {
+      config = gst_buffer_pool_get_config (pool);
+      gst_buffer_pool_config_get_params (config, NULL, &size, NULL, NULL);
+      gst_structure_free (config);
+      gst_query_add_allocation_pool (query, pool, size, 0, 0);
+      gst_object_unref (pool);
+    }
+  } else {
+    /* every output buffer must be able to hold the largest packet */
+    gst_query_parse_nth_allocation_pool (query, 0, &pool, &size, &min, &max);
+    if (size < MAX_CDP_PACKET_LEN)
+      gst_query_set_nth_allocation_pool (query, 0, pool, MAX_CDP_PACKET_LEN,
+          min, max);
+    if (pool)
+      gst_object_unref (pool);
+  }
+
+  return GST_BASE_TRANSFORM_CLASS (parent_class)->decide_allocation (base,
+      query);
 }
 
 static gboolean
@@ -1335,6 +1344,8 @@ gst_cc_converter_class_init (GstCCConverterClass * klass)
   basetransform_class->set_caps = GST_DEBUG_FUNCPTR (gst_cc_converter_set_caps);
   basetransform_class->transform =
       GST_DEBUG_FUNCPTR (gst_cc_converter_transform);
+  basetransform_class->decide_allocation =
+      GST_DEBUG_FUNCPTR (gst_cc_converter_decide_allocation);
   basetransform_class->passthrough_on_same_caps = TRUE;
 
   GST_DEBUG_CATEGORY_INIT (gst_cc_converter_debug, "ccconverter",
@@ -1344,4 +1355,11 @@ gst_cc_converter_class_init (GstCCConverterClass * klass)
 static void
 gst_cc_converter_init (GstCCConverter * self)
 {
+  GstBaseTransform *base = GST_BASE_TRANSFORM (self);
+
+  /* Keep the base class chain function for buffers that arrive before
+   * allocation is decided, and handle buffer lists ourselves */
+  self->chain = GST_PAD_CHAINFUNC (base->sinkpad);
+  gst_pad_set_chain_list_function (base->sinkpad,
+      GST_DEBUG_FUNCPTR (gst_cc_converter_chain_list));
 }
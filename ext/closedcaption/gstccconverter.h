@@ -40,6 +40,10 @@ G_BEGIN_DECLS
 typedef struct _GstCCConverter GstCCConverter;
 typedef struct _GstCCConverterClass GstCCConverterClass;
 
+typedef gint (*GstCCConverterFunc) (GstCCConverter * self, const guint8 * in,
+    guint in_len, guint8 * out, guint out_len,
+    const GstVideoTimeCodeMeta * tc_meta, GstVideoTimeCode * tc);
+
 struct _GstCCConverter
 {
   GstBaseTransform parent;
@@ -51,6 +55,12 @@ struct _GstCCConverter
   guint16 cdp_hdr_sequence_cntr;
 
   gint fps_n, fps_d;
+
+  /* converter for the negotiated caption types, NULL in passthrough */
+  GstCCConverterFunc convert;
+
+  /* base class chain function, for buffer lists before allocation */
+  GstPadChainFunction chain;
 };
 
 struct _GstCCConverterClass
@@ -73,6 +73,7 @@ static GParamSpec *properties[NUM_PROPERTIES];
 #define MAX_SCTP_PORT 65535
 #define MAX_GST_SCTP_ASSOCIATION_ID 65535
 #define MAX_STREAM_ID 65535
+#define MAX_MESSAGES_PER_PUSH 64
 
 GType gst_sctp_dec_pad_get_type (void);
 
@@ -377,10 +378,34 @@ gst_sctp_data_srcpad_loop (GstPad * pad)
   GstDataQueueItem *item;
 
   if (gst_data_queue_pop (sctpdec_pad->packet_queue, &item)) {
+    GstBuffer *buffer = GST_BUFFER (item->object);
+    GstBufferList *list = NULL;
     GstFlowReturn flow_ret;
 
-    flow_ret = gst_pad_push (pad, GST_BUFFER (item->object));
     item->object = NULL;
+    item->destroy (item);
+
+    /* Deliver all messages that arrived meanwhile as one buffer list */
+    while (!gst_data_queue_is_empty (sctpdec_pad->packet_queue)
+        && (!list || gst_buffer_list_length (list) < MAX_MESSAGES_PER_PUSH)) {
+      if (!gst_data_queue_pop (sctpdec_pad->packet_queue, &item))
+        break;
+
+      if (!list) {
+        list = gst_buffer_list_new ();
+        gst_buffer_list_add (list, buffer);
+        buffer = NULL;
+      }
+      gst_buffer_list_add (list, GST_BUFFER (item->object));
+      item->object = NULL;
+      item->destroy (item);
+    }
+
+    if (list)
+      flow_ret = gst_pad_push_list (pad, list);
+    else
+      flow_ret = gst_pad_push (pad, buffer);
+
     if (G_UNLIKELY (flow_ret == GST_FLOW_FLUSHING
             || flow_ret == GST_FLOW_NOT_LINKED)) {
       GST_DEBUG_OBJECT (pad, "Push failed on packet source pad. Error: %s",
@@ -396,8 +421,6 @@ gst_sctp_data_srcpad_loop (GstPad * pad)
       gst_data_queue_flush (sctpdec_pad->packet_queue);
       gst_pad_pause_task (pad);
     }
-
-    item->destroy (item);
   } else {
     GST_DEBUG_OBJECT (pad, "Pausing task because we're flushing");
     gst_pad_pause_task (pad);
@@ -61,6 +61,7 @@ enum
   PROP_GST_SCTP_ASSOCIATION_ID,
   PROP_REMOTE_SCTP_PORT,
   PROP_USE_SOCK_STREAM,
+  PROP_SEND_BUFFER_SIZE,
 
   NUM_PROPERTIES
 };
@@ -72,8 +73,10 @@ static GParamSpec *properties[NUM_PROPERTIES];
 #define DEFAULT_GST_SCTP_ORDERED TRUE
 #define DEFAULT_SCTP_PPID 1
 #define DEFAULT_USE_SOCK_STREAM FALSE
+#define DEFAULT_SEND_BUFFER_SIZE 0
 
 #define BUFFER_FULL_SLEEP_TIME 100000
+#define MAX_PACKETS_PER_PUSH 64
 
 GType gst_sctp_enc_pad_get_type (void);
 
@@ -145,6 +148,8 @@ static void gst_sctp_enc_release_pad (GstElement * element, GstPad * pad);
 static void gst_sctp_enc_srcpad_loop (GstPad * pad);
 static GstFlowReturn gst_sctp_enc_sink_chain (GstPad * pad, GstObject * parent,
     GstBuffer * buffer);
+static GstFlowReturn gst_sctp_enc_sink_chain_list (GstPad * pad,
+    GstObject * parent, GstBufferList * list);
 static gboolean gst_sctp_enc_sink_event (GstPad * pad, GstObject * parent,
     GstEvent * event);
 static gboolean gst_sctp_enc_src_event (GstPad * pad, GstObject * parent,
@@ -155,6 +160,8 @@ static void on_sctp_association_state_changed (GstSctpAssociation *
 static gboolean configure_association (GstSctpEnc * self);
 static void on_sctp_packet_out (GstSctpAssociation * sctp_association,
     const guint8 * buf, gsize length, gpointer user_data);
+static void on_sctp_buffer_available (GstSctpAssociation * sctp_association,
+    gpointer user_data);
 static void stop_srcpad_task (GstPad * pad, GstSctpEnc * self);
 static void sctpenc_cleanup (GstSctpEnc * self);
 static void get_config_from_caps (const GstCaps * caps, gboolean * ordered,
@@ -211,6 +218,14 @@ gst_sctp_enc_class_init (GstSctpEncClass * klass)
       "When TRUE the partial reliability parameters of the channel are ignored.",
       DEFAULT_USE_SOCK_STREAM, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
 
+  properties[PROP_SEND_BUFFER_SIZE] =
+      g_param_spec_uint ("send-buffer-size",
+      "Send buffer size",
+      "Size in bytes of the SCTP send buffer. Sink pads block once it is full "
+      "until the remote side has acknowledged enough data (0 = default).",
+      0, G_MAXINT, DEFAULT_SEND_BUFFER_SIZE,
+      G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
+
   g_object_class_install_properties (gobject_class, NUM_PROPERTIES, properties);
 
   signals[SIGNAL_SCTP_ASSOCIATION_ESTABLISHED] =
@@ -257,6 +272,7 @@ gst_sctp_enc_init (GstSctpEnc * self)
 {
   self->sctp_association_id = DEFAULT_GST_SCTP_ASSOCIATION_ID;
   self->remote_sctp_port = DEFAULT_REMOTE_SCTP_PORT;
+  self->send_buffer_size = DEFAULT_SEND_BUFFER_SIZE;
 
   self->sctp_association = NULL;
   self->outbound_sctp_packet_queue =
@@ -298,6 +314,9 @@ gst_sctp_enc_set_property (GObject * object, guint prop_id,
     case PROP_USE_SOCK_STREAM:
       self->use_sock_stream = g_value_get_boolean (value);
       break;
+    case PROP_SEND_BUFFER_SIZE:
+      self->send_buffer_size = g_value_get_uint (value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (self, prop_id, pspec);
       break;
@@ -320,6 +339,9 @@ gst_sctp_enc_get_property (GObject * object, guint prop_id, GValue * value,
     case PROP_USE_SOCK_STREAM:
       g_value_set_boolean (value, self->use_sock_stream);
       break;
+    case PROP_SEND_BUFFER_SIZE:
+      g_value_set_uint (value, self->send_buffer_size);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (self, prop_id, pspec);
       break;
@@ -414,6 +436,8 @@ gst_sctp_enc_request_new_pad (GstElement * element, GstPadTemplate * template,
       template->direction, "template", template, NULL);
   gst_pad_set_chain_function (new_pad,
       GST_DEBUG_FUNCPTR (gst_sctp_enc_sink_chain));
+  gst_pad_set_chain_list_function (new_pad,
+      GST_DEBUG_FUNCPTR (gst_sctp_enc_sink_chain_list));
   gst_pad_set_event_function (new_pad,
       GST_DEBUG_FUNCPTR (gst_sctp_enc_sink_event));
 
@@ -500,8 +524,32 @@ gst_sctp_enc_srcpad_loop (GstPad * pad)
   }
 
   if (gst_data_queue_pop (self->outbound_sctp_packet_queue, &item)) {
-    flow_ret = gst_pad_push (self->src_pad, GST_BUFFER (item->object));
+    GstBuffer *buffer = GST_BUFFER (item->object);
+    GstBufferList *list = NULL;
+
     item->object = NULL;
+    item->destroy (item);
+
+    /* Push all packets that were queued meanwhile in one go */
+    while (!gst_data_queue_is_empty (self->outbound_sctp_packet_queue)
+        && (!list || gst_buffer_list_length (list) < MAX_PACKETS_PER_PUSH)) {
+      if (!gst_data_queue_pop (self->outbound_sctp_packet_queue, &item))
+        break;
+
+      if (!list) {
+        list = gst_buffer_list_new ();
+        gst_buffer_list_add (list, buffer);
+        buffer = NULL;
+      }
+      gst_buffer_list_add (list, GST_BUFFER (item->object));
+      item->object = NULL;
+      item->destroy (item);
+    }
+
+    if (list)
+      flow_ret = gst_pad_push_list (self->src_pad, list);
+    else
+      flow_ret = gst_pad_push (self->src_pad, buffer);
 
     if (G_UNLIKELY (flow_ret == GST_FLOW_FLUSHING
             || flow_ret == GST_FLOW_NOT_LINKED)) {
@@ -518,83 +566,92 @@ gst_sctp_enc_srcpad_loop (GstPad * pad)
       gst_data_queue_flush (self->outbound_sctp_packet_queue);
       gst_pad_pause_task (pad);
     }
-
-    item->destroy (item);
   } else {
     GST_DEBUG_OBJECT (pad, "Pausing task because we're flushing");
     gst_pad_pause_task (pad);
   }
 }
 
-static GstFlowReturn
-gst_sctp_enc_sink_chain (GstPad * pad, GstObject * parent, GstBuffer * buffer)
+static void
+get_message_from_buffer (GstSctpEncPad * sctpenc_pad, GstBuffer * buffer,
+    GstMapInfo * map, GstSctpAssociationMessage * message)
 {
-  GstSctpEnc *self = GST_SCTP_ENC (parent);
-  GstSctpEncPad *sctpenc_pad = GST_SCTP_ENC_PAD (pad);
-  GstMapInfo map;
-  guint32 ppid;
-  gboolean ordered;
-  GstSctpAssociationPartialReliability pr;
-  guint32 pr_param;
   gpointer state = NULL;
   GstMeta *meta;
   const GstMetaInfo *meta_info = GST_SCTP_SEND_META_INFO;
-  GstFlowReturn flow_ret = GST_FLOW_ERROR;
 
-  ppid = sctpenc_pad->ppid;
-  ordered = sctpenc_pad->ordered;
-  pr = sctpenc_pad->reliability;
-  pr_param = sctpenc_pad->reliability_param;
+  message->data = map->data;
+  message->length = map->size;
+  message->stream_id = sctpenc_pad->stream_id;
+  message->ppid = sctpenc_pad->ppid;
+  message->ordered = sctpenc_pad->ordered;
+  message->pr = sctpenc_pad->reliability;
+  message->reliability_param = sctpenc_pad->reliability_param;
 
   while ((meta = gst_buffer_iterate_meta (buffer, &state))) {
     if (meta->info->api == meta_info->api) {
       GstSctpSendMeta *sctp_send_meta = (GstSctpSendMeta *) meta;
 
-      ppid = sctp_send_meta->ppid;
-      ordered = sctp_send_meta->ordered;
-      pr_param = sctp_send_meta->pr_param;
+      message->ppid = sctp_send_meta->ppid;
+      message->ordered = sctp_send_meta->ordered;
+      message->reliability_param = sctp_send_meta->pr_param;
       switch (sctp_send_meta->pr) {
         case GST_SCTP_SEND_META_PARTIAL_RELIABILITY_NONE:
-          pr = GST_SCTP_ASSOCIATION_PARTIAL_RELIABILITY_NONE;
+          message->pr = GST_SCTP_ASSOCIATION_PARTIAL_RELIABILITY_NONE;
           break;
         case GST_SCTP_SEND_META_PARTIAL_RELIABILITY_RTX:
-          pr = GST_SCTP_ASSOCIATION_PARTIAL_RELIABILITY_RTX;
+          message->pr = GST_SCTP_ASSOCIATION_PARTIAL_RELIABILITY_RTX;
           break;
         case GST_SCTP_SEND_META_PARTIAL_RELIABILITY_BUF:
-          pr = GST_SCTP_ASSOCIATION_PARTIAL_RELIABILITY_BUF;
+          message->pr = GST_SCTP_ASSOCIATION_PARTIAL_RELIABILITY_BUF;
           break;
         case GST_SCTP_SEND_META_PARTIAL_RELIABILITY_TTL:
-          pr = GST_SCTP_ASSOCIATION_PARTIAL_RELIABILITY_TTL;
+          message->pr = GST_SCTP_ASSOCIATION_PARTIAL_RELIABILITY_TTL;
           break;
       }
       break;
     }
   }
+}
 
-  if (!gst_buffer_map (buffer, &map, GST_MAP_READ)) {
-    g_warning ("Could not map GstBuffer");
-    goto error;
-  }
+/* Sends all messages, blocking while the association's send buffer is full */
+static GstFlowReturn
+send_messages (GstSctpEnc * self, GstSctpEncPad * sctpenc_pad,
+    const GstSctpAssociationMessage * messages, guint n_messages)
+{
+  GstFlowReturn flow_ret;
+  guint n_sent = 0;
 
   g_mutex_lock (&sctpenc_pad->lock);
   while (!sctpenc_pad->flushing) {
-    gboolean data_sent = FALSE;
+    guint buffer_available_count, n, i;
+
+    GST_OBJECT_LOCK (self);
+    buffer_available_count = self->buffer_available_count;
+    GST_OBJECT_UNLOCK (self);
 
     g_mutex_unlock (&sctpenc_pad->lock);
 
-    data_sent =
-        gst_sctp_association_send_data (self->sctp_association, map.data,
-        map.size, sctpenc_pad->stream_id, ppid, ordered, pr, pr_param);
+    n = gst_sctp_association_send_data_list (self->sctp_association,
+        messages + n_sent, n_messages - n_sent);
 
     g_mutex_lock (&sctpenc_pad->lock);
-    if (data_sent) {
-      sctpenc_pad->bytes_sent += map.size;
+    for (i = 0; i < n; i++)
+      sctpenc_pad->bytes_sent += messages[n_sent + i].length;
+    n_sent += n;
+
+    if (n_sent == n_messages) {
       break;
     } else if (!sctpenc_pad->flushing) {
       gint64 end_time = g_get_monotonic_time () + BUFFER_FULL_SLEEP_TIME;
 
-      /* The buffer was probably full. Retry in a while */
+      /* The send buffer is full. Wait until the association reports free
+       * space again, unless that already happened while we were sending */
       GST_OBJECT_LOCK (self);
+      if (buffer_available_count != self->buffer_available_count) {
+        GST_OBJECT_UNLOCK (self);
+        continue;
+      }
       g_queue_push_tail (&self->pending_pads, sctpenc_pad);
       GST_OBJECT_UNLOCK (self);
 
@@ -608,12 +665,71 @@ gst_sctp_enc_sink_chain (GstPad * pad, GstObject * parent, GstBuffer * buffer)
   flow_ret = sctpenc_pad->flushing ? GST_FLOW_FLUSHING : GST_FLOW_OK;
   g_mutex_unlock (&sctpenc_pad->lock);
 
+  return flow_ret;
+}
+
+static GstFlowReturn
+gst_sctp_enc_sink_chain (GstPad * pad, GstObject * parent, GstBuffer * buffer)
+{
+  GstSctpEnc *self = GST_SCTP_ENC (parent);
+  GstSctpEncPad *sctpenc_pad = GST_SCTP_ENC_PAD (pad);
+  GstSctpAssociationMessage message;
+  GstMapInfo map;
+  GstFlowReturn flow_ret = GST_FLOW_ERROR;
+
+  if (!gst_buffer_map (buffer, &map, GST_MAP_READ)) {
+    g_warning ("Could not map GstBuffer");
+    goto error;
+  }
+
+  get_message_from_buffer (sctpenc_pad, buffer, &map, &message);
+  flow_ret = send_messages (self, sctpenc_pad, &message, 1);
+
   gst_buffer_unmap (buffer, &map);
 error:
   gst_buffer_unref (buffer);
   return flow_ret;
 }
 
+static GstFlowReturn
+gst_sctp_enc_sink_chain_list (GstPad * pad, GstObject * parent,
+    GstBufferList * list)
+{
+  GstSctpEnc *self = GST_SCTP_ENC (parent);
+  GstSctpEncPad *sctpenc_pad = GST_SCTP_ENC_PAD (pad);
+  GstSctpAssociationMessage *messages;
+  GstMapInfo *maps;
+  GstFlowReturn flow_ret = GST_FLOW_ERROR;
+  guint i, n_mapped, len;
+
+  len = gst_buffer_list_length (list);
+  messages = g_new (GstSctpAssociationMessage, len);
+  maps = g_new (GstMapInfo, len);
+
+  for (n_mapped = 0; n_mapped < len; n_mapped++) {
+    GstBuffer *buffer = gst_buffer_list_get (list, n_mapped);
+
+    if (!gst_buffer_map (buffer, &maps[n_mapped], GST_MAP_READ)) {
+      g_warning ("Could not map GstBuffer");
+      goto error;
+    }
+    get_message_from_buffer (sctpenc_pad, buffer, &maps[n_mapped],
+        &messages[n_mapped]);
+  }
+
+  /* All messages of the list are handed to the association under a single
+   * lock so that it can bundle them into as few packets as possible */
+  flow_ret = send_messages (self, sctpenc_pad, messages, len);
+
+error:
+  for (i = 0; i < n_mapped; i++)
+    gst_buffer_unmap (gst_buffer_list_get (list, i), &maps[i]);
+  g_free (maps);
+  g_free (messages);
+  gst_buffer_list_unref (list);
+  return flow_ret;
+}
+
 static gboolean
 gst_sctp_enc_sink_event (GstPad * pad, GstObject * parent, GstEvent * event)
 {
@@ -755,6 +871,12 @@ configure_association (GstSctpEnc * self)
   g_object_bind_property (self, "use-sock-stream", self->sctp_association,
       "use-sock-stream", G_BINDING_SYNC_CREATE);
 
+  g_object_bind_property (self, "send-buffer-size", self->sctp_association,
+      "send-buffer-size", G_BINDING_SYNC_CREATE);
+
+  gst_sctp_association_set_on_buffer_available (self->sctp_association,
+      on_sctp_buffer_available, self);
+
   gst_sctp_association_set_on_packet_out (self->sctp_association,
       on_sctp_packet_out, self);
 
@@ -807,8 +929,6 @@ on_sctp_packet_out (GstSctpAssociation * _association, const guint8 * buf,
   GstSctpEnc *self = user_data;
   GstBuffer *gstbuf;
   GstDataQueueItem *item;
-  GList *pending_pads, *l;
-  GstSctpEncPad *sctpenc_pad;
 
   gstbuf = gst_buffer_new_wrapped (g_memdup (buf, length), length);
 
@@ -822,9 +942,19 @@ on_sctp_packet_out (GstSctpAssociation * _association, const guint8 * buf,
     item->destroy (item);
     GST_DEBUG_OBJECT (self, "Failed to push item because we're flushing");
   }
+}
+
+static void
+on_sctp_buffer_available (GstSctpAssociation * _association,
+    gpointer user_data)
+{
+  GstSctpEnc *self = user_data;
+  GList *pending_pads, *l;
+  GstSctpEncPad *sctpenc_pad;
 
   /* Wake up pads in the order they waited, oldest pad first */
   GST_OBJECT_LOCK (self);
+  self->buffer_available_count++;
   pending_pads = NULL;
   while ((sctpenc_pad = g_queue_pop_tail (&self->pending_pads))) {
     pending_pads = g_list_prepend (pending_pads, sctpenc_pad);
@@ -50,11 +50,13 @@ struct _GstSctpEnc
   guint32 sctp_association_id;
   guint16 remote_sctp_port;
   gboolean use_sock_stream;
+  guint32 send_buffer_size;
 
   GstSctpAssociation *sctp_association;
   GstDataQueue *outbound_sctp_packet_queue;
 
   GQueue pending_pads;
+  guint buffer_available_count;
 
   gulong signal_handler_state_changed;
 };
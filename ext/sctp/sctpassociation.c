@@ -80,6 +80,7 @@ enum
   PROP_REMOTE_PORT,
   PROP_STATE,
   PROP_USE_SOCK_STREAM,
+  PROP_SEND_BUFFER_SIZE,
 
   NUM_PROPERTIES
 };
@@ -91,6 +92,7 @@ static GParamSpec *properties[NUM_PROPERTIES];
 #define DEFAULT_NUMBER_OF_SCTP_STREAMS 1024
 #define DEFAULT_LOCAL_SCTP_PORT 0
 #define DEFAULT_REMOTE_SCTP_PORT 0
+#define DEFAULT_SEND_BUFFER_SIZE 0
 
 static GHashTable *associations = NULL;
 G_LOCK_DEFINE_STATIC (associations_lock);
@@ -114,6 +116,10 @@ static int sctp_packet_out (void *addr, void *buffer, size_t length, guint8 tos,
 static int receive_cb (struct socket *sock, union sctp_sockstore addr,
     void *data, size_t datalen, struct sctp_rcvinfo rcv_info, gint flags,
     void *ulp_info);
+static void socket_upcall (struct socket *sock, void *arg, int flags);
+static gboolean send_message (GstSctpAssociation * self,
+    const GstSctpAssociationMessage * message,
+    struct sockaddr_conn *remote_addr);
 static void handle_notification (GstSctpAssociation * self,
     const union sctp_notification *notification, size_t length);
 static void handle_association_changed (GstSctpAssociation * self,
@@ -168,6 +174,13 @@ gst_sctp_association_class_init (GstSctpAssociationClass * klass)
       "When TRUE the partial reliability parameters of the channel is ignored.",
       FALSE, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
 
+  properties[PROP_SEND_BUFFER_SIZE] =
+      g_param_spec_uint ("send-buffer-size", "Send buffer size",
+      "Size in bytes of the socket send buffer. Sending blocks once it is "
+      "full until the peer has acknowledged enough data (0 = usrsctp default)",
+      0, G_MAXINT, DEFAULT_SEND_BUFFER_SIZE,
+      G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
+
   g_object_class_install_properties (gobject_class, NUM_PROPERTIES, properties);
 }
 
@@ -196,6 +209,7 @@ gst_sctp_association_init (GstSctpAssociation * self)
   self->state = GST_SCTP_ASSOCIATION_STATE_NEW;
 
   self->use_sock_stream = FALSE;
+  self->send_buffer_size = DEFAULT_SEND_BUFFER_SIZE;
 
   usrsctp_register_address ((void *) self);
 }
@@ -233,6 +247,7 @@ gst_sctp_association_set_property (GObject * object, guint prop_id,
     switch (prop_id) {
       case PROP_LOCAL_PORT:
       case PROP_REMOTE_PORT:
+      case PROP_SEND_BUFFER_SIZE:
         g_warning ("These properties cannot be set in this state");
         goto error;
     }
@@ -254,6 +269,9 @@ gst_sctp_association_set_property (GObject * object, guint prop_id,
     case PROP_USE_SOCK_STREAM:
       self->use_sock_stream = g_value_get_boolean (value);
       break;
+    case PROP_SEND_BUFFER_SIZE:
+      self->send_buffer_size = g_value_get_uint (value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (self, prop_id, pspec);
       break;
@@ -315,6 +333,9 @@ gst_sctp_association_get_property (GObject * object, guint prop_id,
     case PROP_USE_SOCK_STREAM:
       g_value_set_boolean (value, self->use_sock_stream);
       break;
+    case PROP_SEND_BUFFER_SIZE:
+      g_value_set_uint (value, self->send_buffer_size);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (self, prop_id, pspec);
       break;
@@ -426,6 +447,23 @@ gst_sctp_association_set_on_packet_received (GstSctpAssociation * self,
   maybe_set_state_to_ready (self);
 }
 
+void
+gst_sctp_association_set_on_buffer_available (GstSctpAssociation * self,
+    GstSctpAssociationBufferAvailableCb buffer_available_cb,
+    gpointer user_data)
+{
+  g_return_if_fail (GST_SCTP_IS_ASSOCIATION (self));
+
+  g_mutex_lock (&self->association_mutex);
+  if (self->state == GST_SCTP_ASSOCIATION_STATE_NEW) {
+    self->buffer_available_cb = buffer_available_cb;
+    self->buffer_available_user_data = user_data;
+  } else {
+    g_warning ("It is not possible to change buffer callback in this state");
+  }
+  g_mutex_unlock (&self->association_mutex);
+}
+
 void
 gst_sctp_association_incoming_packet (GstSctpAssociation * self, guint8 * buf,
     guint32 length)
@@ -438,57 +476,46 @@ gst_sctp_association_send_data (GstSctpAssociation * self, guint8 * buf,
     guint32 length, guint16 stream_id, guint32 ppid, gboolean ordered,
     GstSctpAssociationPartialReliability pr, guint32 reliability_param)
 {
-  struct sctp_sendv_spa spa;
-  gint32 bytes_sent;
-  gboolean result = FALSE;
+  GstSctpAssociationMessage message;
+
+  message.data = buf;
+  message.length = length;
+  message.stream_id = stream_id;
+  message.ppid = ppid;
+  message.ordered = ordered;
+  message.pr = pr;
+  message.reliability_param = reliability_param;
+
+  return gst_sctp_association_send_data_list (self, &message, 1) == 1;
+}
+
+/* Sends the messages in order, which may be on different streams, under a
+ * single lock. Returns how many were sent; fewer than @n_messages means the
+ * send buffer is full and the buffer available callback is called once the
+ * rest can be retried. */
+guint
+gst_sctp_association_send_data_list (GstSctpAssociation * self,
+    const GstSctpAssociationMessage * messages, guint n_messages)
+{
   struct sockaddr_conn remote_addr;
+  guint i = 0;
 
   g_mutex_lock (&self->association_mutex);
   if (self->state != GST_SCTP_ASSOCIATION_STATE_CONNECTED)
     goto end;
 
-  memset (&spa, 0, sizeof (spa));
-
-  spa.sendv_sndinfo.snd_ppid = g_htonl (ppid);
-  spa.sendv_sndinfo.snd_sid = stream_id;
-  spa.sendv_sndinfo.snd_flags = ordered ? 0 : SCTP_UNORDERED;
-  spa.sendv_sndinfo.snd_context = 0;
-  spa.sendv_sndinfo.snd_assoc_id = 0;
-  spa.sendv_flags = SCTP_SEND_SNDINFO_VALID;
-  if (pr != GST_SCTP_ASSOCIATION_PARTIAL_RELIABILITY_NONE) {
-    spa.sendv_flags |= SCTP_SEND_PRINFO_VALID;
-    spa.sendv_prinfo.pr_value = g_htonl (reliability_param);
-    if (pr == GST_SCTP_ASSOCIATION_PARTIAL_RELIABILITY_TTL)
-      spa.sendv_prinfo.pr_policy = SCTP_PR_SCTP_TTL;
-    else if (pr == GST_SCTP_ASSOCIATION_PARTIAL_RELIABILITY_RTX)
-      spa.sendv_prinfo.pr_policy = SCTP_PR_SCTP_RTX;
-    else if (pr == GST_SCTP_ASSOCIATION_PARTIAL_RELIABILITY_BUF)
-      spa.sendv_prinfo.pr_policy = SCTP_PR_SCTP_BUF;
-  }
-
   remote_addr = get_sctp_socket_address (self, self->remote_port);
-  bytes_sent =
-      usrsctp_sendv (self->sctp_ass_sock, buf, length,
-      (struct sockaddr *) &remote_addr, 1, (void *) &spa,
-      (socklen_t) sizeof (struct sctp_sendv_spa), SCTP_SENDV_SPA, 0);
-  if (bytes_sent < 0) {
-    if (errno == EAGAIN || errno == EWOULDBLOCK) {
-      /* Resending this buffer is taken care of by the gstsctpenc */
-      goto end;
-    } else {
-      g_warning ("Error sending data on stream %u: (%u) %s", stream_id, errno,
-          strerror (errno));
-      goto end;
-    }
+
+  for (i = 0; i < n_messages; i++) {
+    if (!send_message (self, &messages[i], &remote_addr))
+      break;
   }
 
-  result = TRUE;
 end:
   g_mutex_unlock (&self->association_mutex);
-  return result;
+  return i;
 }
 
-
 void
 gst_sctp_association_reset_stream (GstSctpAssociation * self, guint16 stream_id)
 {
@@ -521,6 +548,58 @@ gst_sctp_association_force_close (GstSctpAssociation * self)
   g_mutex_unlock (&self->association_mutex);
 }
 
+static gboolean
+send_message (GstSctpAssociation * self,
+    const GstSctpAssociationMessage * message,
+    struct sockaddr_conn *remote_addr)
+{
+  struct sctp_sendv_spa spa;
+  gint32 bytes_sent;
+
+  memset (&spa, 0, sizeof (spa));
+
+  spa.sendv_sndinfo.snd_ppid = g_htonl (message->ppid);
+  spa.sendv_sndinfo.snd_sid = message->stream_id;
+  spa.sendv_sndinfo.snd_flags = message->ordered ? 0 : SCTP_UNORDERED;
+  spa.sendv_sndinfo.snd_context = 0;
+  spa.sendv_sndinfo.snd_assoc_id = 0;
+  spa.sendv_flags = SCTP_SEND_SNDINFO_VALID;
+  if (message->pr != GST_SCTP_ASSOCIATION_PARTIAL_RELIABILITY_NONE) {
+    spa.sendv_flags |= SCTP_SEND_PRINFO_VALID;
+    spa.sendv_prinfo.pr_value = g_htonl (message->reliability_param);
+    if (message->pr == GST_SCTP_ASSOCIATION_PARTIAL_RELIABILITY_TTL)
+      spa.sendv_prinfo.pr_policy = SCTP_PR_SCTP_TTL;
+    else if (message->pr == GST_SCTP_ASSOCIATION_PARTIAL_RELIABILITY_RTX)
+      spa.sendv_prinfo.pr_policy = SCTP_PR_SCTP_RTX;
+    else if (message->pr == GST_SCTP_ASSOCIATION_PARTIAL_RELIABILITY_BUF)
+      spa.sendv_prinfo.pr_policy = SCTP_PR_SCTP_BUF;
+  }
+
+  /* Flag the send as blocked before trying it. The socket can become
+   * writable again before usrsctp_sendv() returns EAGAIN, and the upcall
+   * for that would be lost if the flag was only set afterwards */
+  g_atomic_int_set (&self->send_blocked, TRUE);
+
+  bytes_sent =
+      usrsctp_sendv (self->sctp_ass_sock, message->data, message->length,
+      (struct sockaddr *) remote_addr, 1, (void *) &spa,
+      (socklen_t) sizeof (struct sctp_sendv_spa), SCTP_SENDV_SPA, 0);
+  if (bytes_sent < 0) {
+    /* On EAGAIN, resending this buffer is taken care of by the gstsctpenc
+     * once the socket becomes writable again */
+    if (errno != EAGAIN && errno != EWOULDBLOCK) {
+      g_atomic_int_set (&self->send_blocked, FALSE);
+      g_warning ("Error sending data on stream %u: (%u) %s",
+          message->stream_id, errno, strerror (errno));
+    }
+    return FALSE;
+  }
+
+  g_atomic_int_set (&self->send_blocked, FALSE);
+
+  return TRUE;
+}
+
 static struct socket *
 create_sctp_socket (GstSctpAssociation * self)
 {
@@ -557,6 +636,20 @@ create_sctp_socket (GstSctpAssociation * self)
     goto error;
   }
 
+  if (self->send_buffer_size > 0) {
+    int size = self->send_buffer_size;
+
+    if (usrsctp_setsockopt (sock, SOL_SOCKET, SO_SNDBUF, &size,
+            sizeof (int)) < 0)
+      g_warning ("Could not set SO_SNDBUF to %d", size);
+  }
+
+  /* Notifies about the send buffer draining, see socket_upcall() */
+  if (usrsctp_set_upcall (sock, socket_upcall, (void *) self) < 0) {
+    g_warning ("Could not set the upcall on SCTP socket");
+    goto error;
+  }
+
   memset (&l, 0, sizeof (l));
   l.l_onoff = 1;
   l.l_linger = 0;
@@ -700,6 +793,25 @@ receive_cb (struct socket *sock, union sctp_sockstore addr, void *data,
   return 1;
 }
 
+static void
+socket_upcall (struct socket *sock, void *arg, int flags)
+{
+  GstSctpAssociation *self = GST_SCTP_ASSOCIATION (arg);
+
+  /* Only bother the encoder if a send failed or is in progress, the upcall
+   * happens for every acknowledgement otherwise */
+  if (!g_atomic_int_get (&self->send_blocked))
+    return;
+
+  if (!(usrsctp_get_events (sock) & SCTP_EVENT_WRITE))
+    return;
+
+  if (g_atomic_int_compare_and_exchange (&self->send_blocked, TRUE, FALSE)
+      && self->buffer_available_cb) {
+    self->buffer_available_cb (self, self->buffer_available_user_data);
+  }
+}
+
 static void
 handle_notification (GstSctpAssociation * self,
     const union sctp_notification *notification, size_t length)
@@ -67,6 +67,19 @@ typedef void (*GstSctpAssociationPacketReceivedCb) (GstSctpAssociation *
     guint ppid, gpointer user_data);
 typedef void (*GstSctpAssociationPacketOutCb) (GstSctpAssociation *
     sctp_association, const guint8 * data, gsize length, gpointer user_data);
+typedef void (*GstSctpAssociationBufferAvailableCb) (GstSctpAssociation *
+    sctp_association, gpointer user_data);
+
+typedef struct
+{
+  const guint8 *data;
+  guint32 length;
+  guint16 stream_id;
+  guint32 ppid;
+  gboolean ordered;
+  GstSctpAssociationPartialReliability pr;
+  guint32 reliability_param;
+} GstSctpAssociationMessage;
 
 struct _GstSctpAssociation
 {
@@ -76,6 +89,7 @@ struct _GstSctpAssociation
   guint16 local_port;
   guint16 remote_port;
   gboolean use_sock_stream;
+  guint32 send_buffer_size;
   struct socket *sctp_ass_sock;
 
   GMutex association_mutex;
@@ -89,6 +103,10 @@ struct _GstSctpAssociation
 
   GstSctpAssociationPacketOutCb packet_out_cb;
   gpointer packet_out_user_data;
+
+  GstSctpAssociationBufferAvailableCb buffer_available_cb;
+  gpointer buffer_available_user_data;
+  gint send_blocked;
 };
 
 struct _GstSctpAssociationClass
@@ -108,12 +126,17 @@ void gst_sctp_association_set_on_packet_out (GstSctpAssociation * self,
     GstSctpAssociationPacketOutCb packet_out_cb, gpointer user_data);
 void gst_sctp_association_set_on_packet_received (GstSctpAssociation * self,
     GstSctpAssociationPacketReceivedCb packet_received_cb, gpointer user_data);
+void gst_sctp_association_set_on_buffer_available (GstSctpAssociation * self,
+    GstSctpAssociationBufferAvailableCb buffer_available_cb,
+    gpointer user_data);
 void gst_sctp_association_incoming_packet (GstSctpAssociation * self,
     guint8 * buf, guint32 length);
 gboolean gst_sctp_association_send_data (GstSctpAssociation * self,
     guint8 * buf, guint32 length, guint16 stream_id, guint32 ppid,
     gboolean ordered, GstSctpAssociationPartialReliability pr,
     guint32 reliability_param);
+guint gst_sctp_association_send_data_list (GstSctpAssociation * self,
+    const GstSctpAssociationMessage * messages, guint n_messages);
 void gst_sctp_association_reset_stream (GstSctpAssociation * self,
     guint16 stream_id);
 void gst_sctp_association_force_close (GstSctpAssociation * self);
@@ -207,6 +207,10 @@ static GstFlowReturn gst_srtp_dec_chain_rtp (GstPad * pad,
     GstObject * parent, GstBuffer * buf);
 static GstFlowReturn gst_srtp_dec_chain_rtcp (GstPad * pad,
     GstObject * parent, GstBuffer * buf);
+static GstFlowReturn gst_srtp_dec_chain_list_rtp (GstPad * pad,
+    GstObject * parent, GstBufferList * buf_list);
+static GstFlowReturn gst_srtp_dec_chain_list_rtcp (GstPad * pad,
+    GstObject * parent, GstBufferList * buf_list);
 
 static GstStateChangeReturn gst_srtp_dec_change_state (GstElement * element,
     GstStateChange transition);
@@ -379,6 +383,8 @@ gst_srtp_dec_init (GstSrtpDec * filter)
       GST_DEBUG_FUNCPTR (gst_srtp_dec_iterate_internal_links_rtp));
   gst_pad_set_chain_function (filter->rtp_sinkpad,
       GST_DEBUG_FUNCPTR (gst_srtp_dec_chain_rtp));
+  gst_pad_set_chain_list_function (filter->rtp_sinkpad,
+      GST_DEBUG_FUNCPTR (gst_srtp_dec_chain_list_rtp));
 
   filter->rtp_srcpad =
       gst_pad_new_from_static_template (&rtp_src_template, "rtp_src");
@@ -402,6 +408,8 @@ gst_srtp_dec_init (GstSrtpDec * filter)
       GST_DEBUG_FUNCPTR (gst_srtp_dec_iterate_internal_links_rtcp));
   gst_pad_set_chain_function (filter->rtcp_sinkpad,
       GST_DEBUG_FUNCPTR (gst_srtp_dec_chain_rtcp));
+  gst_pad_set_chain_list_function (filter->rtcp_sinkpad,
+      GST_DEBUG_FUNCPTR (gst_srtp_dec_chain_list_rtcp));
 
   filter->rtcp_srcpad =
       gst_pad_new_from_static_template (&rtcp_src_template, "rtcp_src");
@@ -517,6 +525,8 @@ gst_srtp_dec_remove_stream (GstSrtpDec * filter, guint ssrc)
   stream = g_hash_table_lookup (filter->streams, GUINT_TO_POINTER (ssrc));
 
   if (stream) {
+    if (filter->last_stream == stream)
+      filter->last_stream = NULL;
     srtp_remove_stream (filter->session, ssrc);
     g_hash_table_remove (filter->streams, GUINT_TO_POINTER (ssrc));
   }
@@ -525,7 +535,20 @@ gst_srtp_dec_remove_stream (GstSrtpDec * filter, guint ssrc)
 static GstSrtpDecSsrcStream *
 find_stream_by_ssrc (GstSrtpDec * filter, guint32 ssrc)
 {
-  return g_hash_table_lookup (filter->streams, GUINT_TO_POINTER (ssrc));
+  GstSrtpDecSsrcStream *stream;
+
+  /* Packets mostly come in runs from the same source, avoid the hash
+   * table lookup for those */
+  if (filter->last_stream && filter->last_ssrc == ssrc)
+    return filter->last_stream;
+
+  stream = g_hash_table_lookup (filter->streams, GUINT_TO_POINTER (ssrc));
+  if (stream) {
+    filter->last_ssrc = ssrc;
+    filter->last_stream = stream;
+  }
+
+  return stream;
 }
 
 #ifdef HAVE_SRTP2
@@ -784,6 +807,7 @@ init_session_stream (GstSrtpDec * filter, guint32 ssrc,
 #endif
 
     filter->first_session = FALSE;
+    filter->last_stream = NULL;
     g_hash_table_insert (filter->streams, GUINT_TO_POINTER (stream->ssrc),
         stream);
   }
@@ -966,6 +990,7 @@ gst_srtp_dec_clear_streams (GstSrtpDec * filter)
     filter->session = NULL;
   }
 
+  filter->last_stream = NULL;
   if (filter->streams)
     nb = g_hash_table_foreach_remove (filter->streams, remove_yes, NULL);
 
@@ -1318,19 +1343,20 @@ gst_srtp_dec_push_early_events (GstSrtpDec * filter, GstPad * pad,
  * This function should be called while holding the filter lock
  */
 static gboolean
-gst_srtp_dec_decode_buffer (GstSrtpDec * filter, GstPad * pad, GstBuffer * buf,
-    gboolean is_rtcp, guint32 ssrc)
+gst_srtp_dec_decode_buffer (GstSrtpDec * filter, GstPad * pad,
+    GstBuffer ** buf_ptr, gboolean is_rtcp, guint32 ssrc)
 {
   GstMapInfo map;
   srtp_err_status_t err;
   gint size;
+  GstBuffer *buf;
 
   GST_LOG_OBJECT (pad, "Received %s buffer of size %" G_GSIZE_FORMAT
-      " with SSRC = %u", is_rtcp ? "RTCP" : "RTP", gst_buffer_get_size (buf),
-      ssrc);
+      " with SSRC = %u", is_rtcp ? "RTCP" : "RTP",
+      gst_buffer_get_size (*buf_ptr), ssrc);
 
   /* Change buffer to remove protection */
-  buf = gst_buffer_make_writable (buf);
+  buf = *buf_ptr = gst_buffer_make_writable (*buf_ptr);
 
   gst_buffer_map (buf, &map, GST_MAP_READWRITE);
   size = map.size;
@@ -1440,6 +1466,25 @@ err:
   return FALSE;
 }
 
+/* Return the source pad for the given packet type, making sure the
+ * required sticky events were sent on it
+ */
+static GstPad *
+gst_srtp_dec_get_src_pad (GstSrtpDec * filter, gboolean is_rtcp)
+{
+  if (is_rtcp) {
+    if (!filter->rtcp_has_segment)
+      gst_srtp_dec_push_early_events (filter, filter->rtcp_srcpad,
+          filter->rtp_srcpad, TRUE);
+    return filter->rtcp_srcpad;
+  } else {
+    if (!filter->rtp_has_segment)
+      gst_srtp_dec_push_early_events (filter, filter->rtp_srcpad,
+          filter->rtcp_srcpad, FALSE);
+    return filter->rtp_srcpad;
+  }
+}
+
 static GstFlowReturn
 gst_srtp_dec_chain (GstPad * pad, GstObject * parent, GstBuffer * buf,
     gboolean is_rtcp)
@@ -1465,7 +1510,7 @@ gst_srtp_dec_chain (GstPad * pad, GstObject * parent, GstBuffer * buf,
     goto push_out;
   }
 
-  if (!gst_srtp_dec_decode_buffer (filter, pad, buf, is_rtcp, ssrc)) {
+  if (!gst_srtp_dec_decode_buffer (filter, pad, &buf, is_rtcp, ssrc)) {
     GST_OBJECT_UNLOCK (filter);
     goto drop_buffer;
   }
@@ -1478,17 +1523,7 @@ gst_srtp_dec_chain (GstPad * pad, GstObject * parent, GstBuffer * buf,
 
 push_out:
   /* Push buffer to source pad */
-  if (is_rtcp) {
-    otherpad = filter->rtcp_srcpad;
-    if (!filter->rtcp_has_segment)
-      gst_srtp_dec_push_early_events (filter, filter->rtcp_srcpad,
-          filter->rtp_srcpad, TRUE);
-  } else {
-    otherpad = filter->rtp_srcpad;
-    if (!filter->rtp_has_segment)
-      gst_srtp_dec_push_early_events (filter, filter->rtp_srcpad,
-          filter->rtcp_srcpad, FALSE);
-  }
+  otherpad = gst_srtp_dec_get_src_pad (filter, is_rtcp);
   ret = gst_pad_push (otherpad, buf);
 
   return ret;
@@ -1513,6 +1548,121 @@ gst_srtp_dec_chain_rtcp (GstPad * pad, GstObject * parent, GstBuffer * buf)
   return gst_srtp_dec_chain (pad, parent, buf, TRUE);
 }
 
+typedef struct
+{
+  GstSrtpDec *filter;
+  GstPad *pad;
+  gboolean is_rtcp;
+  GstBufferList *out_lists[2];
+  gboolean soft_limit_reached;
+  guint32 soft_limit_ssrc;
+} DecodeListData;
+
+/*
+ * Called with the filter lock for each buffer of an incoming list. Takes
+ * the buffer out of the list and adds it to the output list for its
+ * packet type if it could be decoded.
+ */
+static gboolean
+decode_buffer_it (GstBuffer ** buffer, guint index, gpointer user_data)
+{
+  DecodeListData *data = user_data;
+  GstSrtpDec *filter = data->filter;
+  GstSrtpDecSsrcStream *stream;
+  GstBuffer *buf = *buffer;
+  gboolean is_rtcp = data->is_rtcp;
+  guint32 ssrc = 0;
+
+  *buffer = NULL;
+
+  if (!(stream = validate_buffer (filter, buf, &ssrc, &is_rtcp))) {
+    GST_WARNING_OBJECT (filter, "Invalid buffer, dropping");
+    gst_buffer_unref (buf);
+    return TRUE;
+  }
+
+  if (STREAM_HAS_CRYPTO (stream)) {
+    if (!gst_srtp_dec_decode_buffer (filter, data->pad, &buf, is_rtcp, ssrc)) {
+      gst_buffer_unref (buf);
+      return TRUE;
+    }
+
+    if (gst_srtp_get_soft_limit_reached ()) {
+      data->soft_limit_reached = TRUE;
+      data->soft_limit_ssrc = ssrc;
+    }
+  }
+
+  if (!data->out_lists[is_rtcp])
+    data->out_lists[is_rtcp] = gst_buffer_list_new ();
+  gst_buffer_list_add (data->out_lists[is_rtcp], buf);
+
+  return TRUE;
+}
+
+static GstFlowReturn
+gst_srtp_dec_chain_list (GstPad * pad, GstObject * parent,
+    GstBufferList * buf_list, gboolean is_rtcp)
+{
+  GstSrtpDec *filter = GST_SRTP_DEC (parent);
+  GstFlowReturn ret = GST_FLOW_OK;
+  DecodeListData data;
+  gint i;
+
+  GST_LOG_OBJECT (pad, "Buffer chain with list of %d",
+      gst_buffer_list_length (buf_list));
+
+  data.filter = filter;
+  data.pad = pad;
+  data.is_rtcp = is_rtcp;
+  data.out_lists[0] = data.out_lists[1] = NULL;
+  data.soft_limit_reached = FALSE;
+  data.soft_limit_ssrc = 0;
+
+  /* Decode the whole list with a single lock acquisition */
+  buf_list = gst_buffer_list_make_writable (buf_list);
+
+  GST_OBJECT_LOCK (filter);
+  gst_buffer_list_foreach (buf_list, decode_buffer_it, &data);
+  GST_OBJECT_UNLOCK (filter);
+
+  gst_buffer_list_unref (buf_list);
+
+  if (data.soft_limit_reached)
+    request_key_with_signal (filter, data.soft_limit_ssrc, SIGNAL_SOFT_LIMIT);
+
+  /* Push the packets of the pad's own type first */
+  for (i = 0; i < 2; i++) {
+    gboolean list_is_rtcp = (i == 0) ? is_rtcp : !is_rtcp;
+    GstBufferList *out_list = data.out_lists[list_is_rtcp];
+    GstFlowReturn push_ret;
+
+    if (!out_list)
+      continue;
+
+    push_ret = gst_pad_push_list (gst_srtp_dec_get_src_pad (filter,
+            list_is_rtcp), out_list);
+    if (i == 0 || ret == GST_FLOW_OK)
+      ret = push_ret;
+  }
+
+  return ret;
+}
+
+static GstFlowReturn
+gst_srtp_dec_chain_list_rtp (GstPad * pad, GstObject * parent,
+    GstBufferList * buf_list)
+{
+  return gst_srtp_dec_chain_list (pad, parent, buf_list, FALSE);
+}
+
+static GstFlowReturn
+gst_srtp_dec_chain_list_rtcp (GstPad * pad, GstObject * parent,
+    GstBufferList * buf_list)
+{
+  return gst_srtp_dec_chain_list (pad, parent, buf_list, TRUE);
+}
+
 static GstStateChangeReturn
 gst_srtp_dec_change_state (GstElement * element, GstStateChange transition)
 {
@@ -1526,6 +1676,7 @@ gst_srtp_dec_change_state (GstElement * element, GstStateChange transition)
     case GST_STATE_CHANGE_READY_TO_PAUSED:
       filter->streams = g_hash_table_new_full (g_direct_hash, g_direct_equal,
           NULL, (GDestroyNotify) free_stream);
+      filter->last_stream = NULL;
       filter->rtp_has_segment = FALSE;
       filter->rtcp_has_segment = FALSE;
       break;
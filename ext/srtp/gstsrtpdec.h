@@ -80,6 +80,10 @@ struct _GstSrtpDec
   gboolean first_session;
   GHashTable *streams;
 
+  /* stream of the last looked up SSRC, reset whenever streams changes */
+  guint32 last_ssrc;
+  GstSrtpDecSsrcStream *last_stream;
+
   gboolean rtp_has_segment;
   gboolean rtcp_has_segment;
 
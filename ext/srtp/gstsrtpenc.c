@@ -160,14 +160,12 @@ enum
   PROP_MKI
 };
 
-typedef struct ProcessBufferItData
-{
-  GstSrtpEnc *filter;
-  GstPad *pad;
-  GstBufferList *out_list;
-  GstFlowReturn flowret;
-  gboolean is_rtcp;
-} ProcessBufferItData;
+/* Room needed after the payload for the authentication tag and MKI */
+#define SRTP_TRAILER_ROOM (SRTP_MAX_TRAILER_LEN + 10)
+
+/* Size of the buffers of the internal pool, large enough for a packet
+ * filling an ethernet MTU */
+#define POOL_BUFFER_SIZE (1500 + SRTP_TRAILER_ROOM)
 
 /* the capabilities of the inputs and outputs.
  *
@@ -975,6 +973,34 @@ gst_srtp_enc_sink_query (GstPad * pad, GstObject * parent, GstQuery * query,
 
       return TRUE;
     }
+    case GST_QUERY_ALLOCATION:
+    {
+      GstAllocationParams params;
+      GstAllocator *allocator;
+      guint i, n;
+
+      /* keep whatever downstream proposes, the query failing there is
+       * fine too */
+      gst_pad_query_default (pad, parent, query);
+
+      /* Ask upstream to leave room after each packet so that it can be
+       * protected in place */
+      n = gst_query_get_n_allocation_params (query);
+      for (i = 0; i < n; i++) {
+        gst_query_parse_nth_allocation_param (query, i, &allocator, &params);
+        params.padding += SRTP_TRAILER_ROOM;
+        gst_query_set_nth_allocation_param (query, i, allocator, &params);
+        if (allocator)
+          gst_object_unref (allocator);
+      }
+      if (n == 0) {
+        gst_allocation_params_init (&params);
+        params.padding = SRTP_TRAILER_ROOM;
+        gst_query_add_allocation_param (query, NULL, &params);
+      }
+
+      return TRUE;
+    }
     default:
       return gst_pad_query_default (pad, parent, query);
   }
@@ -1097,83 +1123,146 @@ gst_srtp_enc_check_set_caps (GstSrtpEnc * filter, GstPad * pad,
   return GST_FLOW_OK;
 }
 
-static GstFlowReturn
-gst_srtp_enc_process_buffer (GstSrtpEnc * filter, GstPad * pad,
-    GstBuffer * buf, gboolean is_rtcp, GstBuffer ** outbuf_ptr)
+/* Whether the packet can be protected without copying it: it must be the
+ * only user of its single memory and have enough room after the data */
+static gboolean
+gst_srtp_enc_has_tail_room (GstBuffer * buf)
+{
+  gsize size, offset, maxsize;
+
+  if (!gst_buffer_is_writable (buf) || gst_buffer_n_memory (buf) != 1 ||
+      !gst_buffer_is_all_memory_writable (buf))
+    return FALSE;
+
+  size = gst_buffer_get_sizes (buf, &offset, &maxsize);
+
+  return maxsize - offset - size >= SRTP_TRAILER_ROOM;
+}
+
+/* Takes ownership of @buf and returns a writable buffer containing its data
+ * followed by room for the SRTP trailer */
+static GstBuffer *
+gst_srtp_enc_prepare_buffer (GstSrtpEnc * filter, GstBuffer * buf)
 {
-  GstFlowReturn ret = GST_FLOW_OK;
-  gint size_max, size;
   GstBuffer *bufout = NULL;
-  GstMapInfo mapout;
-  srtp_err_status_t err;
+  GstMapInfo map;
+  gsize size;
 
-  /* Create a bigger buffer to add protection */
   size = gst_buffer_get_size (buf);
-  size_max = size + SRTP_MAX_TRAILER_LEN + 10;
-  bufout = gst_buffer_new_allocate (NULL, size_max, NULL);
 
-  gst_buffer_map (bufout, &mapout, GST_MAP_READWRITE);
+  if (gst_srtp_enc_has_tail_room (buf)) {
+    gst_buffer_set_size (buf, size + SRTP_TRAILER_ROOM);
+    return buf;
+  }
 
-  gst_buffer_extract (buf, 0, mapout.data, size);
+  if (filter->pool && size + SRTP_TRAILER_ROOM <= POOL_BUFFER_SIZE) {
+    if (gst_buffer_pool_acquire_buffer (filter->pool, &bufout,
+            NULL) == GST_FLOW_OK)
+      gst_buffer_set_size (bufout, size + SRTP_TRAILER_ROOM);
+    else
+      bufout = NULL;
+  }
 
-  GST_OBJECT_LOCK (filter);
+  if (!bufout)
+    bufout = gst_buffer_new_allocate (NULL, size + SRTP_TRAILER_ROOM, NULL);
 
-  gst_srtp_init_event_reporter ();
+  gst_buffer_map (bufout, &map, GST_MAP_WRITE);
+  gst_buffer_extract (buf, 0, map.data, size);
+  gst_buffer_unmap (bufout, &map);
+
+  gst_buffer_copy_into (bufout, buf, GST_BUFFER_COPY_METADATA, 0, -1);
+  gst_buffer_unref (buf);
+
+  return bufout;
+}
+
+/* Must be called with the object lock. @buf comes from
+ * gst_srtp_enc_prepare_buffer() and is resized to the protected packet */
+static srtp_err_status_t
+gst_srtp_enc_protect_locked (GstSrtpEnc * filter, GstBuffer * buf,
+    gboolean is_rtcp)
+{
+  GstMapInfo map;
+  srtp_err_status_t err;
+  gint size;
+
+  size = gst_buffer_get_size (buf) - SRTP_TRAILER_ROOM;
+
+  gst_buffer_map (buf, &map, GST_MAP_READWRITE);
 
-  if (filter->session == NULL) {
-    /* The rtcp session disappeared (element shutting down) */
-    GST_OBJECT_UNLOCK (filter);
-    ret = GST_FLOW_FLUSHING;
-    goto fail;
-  }
 #ifdef HAVE_SRTP2
   if (is_rtcp)
-    err = srtp_protect_rtcp_mki (filter->session, mapout.data, &size,
+    err = srtp_protect_rtcp_mki (filter->session, map.data, &size,
         (filter->mki != NULL), 0);
   else
-    err = srtp_protect_mki (filter->session, mapout.data, &size,
+    err = srtp_protect_mki (filter->session, map.data, &size,
         (filter->mki != NULL), 0);
 #else
   if (is_rtcp)
-    err = srtp_protect_rtcp (filter->session, mapout.data, &size);
+    err = srtp_protect_rtcp (filter->session, map.data, &size);
   else
-    err = srtp_protect (filter->session, mapout.data, &size);
+    err = srtp_protect (filter->session, map.data, &size);
 #endif
 
-  GST_OBJECT_UNLOCK (filter);
-
-  gst_buffer_unmap (bufout, &mapout);
-
-  if (err == srtp_err_status_ok) {
-    /* Buffer protected */
-    gst_buffer_set_size (bufout, size);
-    gst_buffer_copy_into (bufout, buf, GST_BUFFER_COPY_METADATA, 0, -1);
+  gst_buffer_unmap (buf, &map);
 
-    GST_LOG_OBJECT (pad, "Encoding %s buffer of size %d",
-        is_rtcp ? "RTCP" : "RTP", size);
+  if (err == srtp_err_status_ok)
+    gst_buffer_set_size (buf, size);
 
-  } else if (err == srtp_err_status_key_expired) {
+  return err;
+}
 
+static GstFlowReturn
+gst_srtp_enc_handle_protect_error (GstSrtpEnc * filter, srtp_err_status_t err)
+{
+  if (err == srtp_err_status_key_expired) {
     GST_ELEMENT_ERROR (GST_ELEMENT_CAST (filter), STREAM, ENCODE,
         ("Key usage limit has been reached"),
         ("Unable to protect buffer (hard key usage limit reached)"));
-    ret = GST_FLOW_ERROR;
-    goto fail;
-
   } else {
     /* srtp_protect failed */
     GST_ELEMENT_ERROR (filter, LIBRARY, FAILED, (NULL),
         ("Unable to protect buffer (protect failed) code %d", err));
-    ret = GST_FLOW_ERROR;
-    goto fail;
   }
 
-  *outbuf_ptr = bufout;
-  return ret;
+  return GST_FLOW_ERROR;
+}
 
-fail:
-  gst_buffer_unref (bufout);
-  return ret;
+/* Takes ownership of @buf */
+static GstFlowReturn
+gst_srtp_enc_process_buffer (GstSrtpEnc * filter, GstPad * pad,
+    GstBuffer * buf, gboolean is_rtcp, GstBuffer ** outbuf_ptr)
+{
+  GstBuffer *bufout;
+  srtp_err_status_t err;
+
+  bufout = gst_srtp_enc_prepare_buffer (filter, buf);
+
+  GST_OBJECT_LOCK (filter);
+
+  gst_srtp_init_event_reporter ();
+
+  if (filter->session == NULL) {
+    /* The rtcp session disappeared (element shutting down) */
+    GST_OBJECT_UNLOCK (filter);
+    gst_buffer_unref (bufout);
+    return GST_FLOW_FLUSHING;
+  }
+
+  err = gst_srtp_enc_protect_locked (filter, bufout, is_rtcp);
+
+  GST_OBJECT_UNLOCK (filter);
+
+  if (err != srtp_err_status_ok) {
+    gst_buffer_unref (bufout);
+    return gst_srtp_enc_handle_protect_error (filter, err);
+  }
+
+  GST_LOG_OBJECT (pad, "Encoding %s buffer of size %" G_GSIZE_FORMAT,
+      is_rtcp ? "RTCP" : "RTP", gst_buffer_get_size (bufout));
+
+  *outbuf_ptr = bufout;
+  return GST_FLOW_OK;
 }
 
 static GstFlowReturn
@@ -1200,6 +1289,7 @@ gst_srtp_enc_chain (GstPad * pad, GstObject * parent, GstBuffer * buf,
   GST_OBJECT_UNLOCK (filter);
 
   ret = gst_srtp_enc_process_buffer (filter, pad, buf, is_rtcp, &bufout);
+  buf = NULL;
   if (ret != GST_FLOW_OK)
     goto out;
 
@@ -1224,25 +1314,17 @@ gst_srtp_enc_chain (GstPad * pad, GstObject * parent, GstBuffer * buf,
   GST_OBJECT_UNLOCK (filter);
 
 out:
-  gst_buffer_unref (buf);
+  if (buf)
+    gst_buffer_unref (buf);
   return ret;
 }
 
 static gboolean
-process_buffer_it (GstBuffer ** buffer, guint index, gpointer user_data)
+prepare_buffer_it (GstBuffer ** buffer, guint index, gpointer user_data)
 {
-  ProcessBufferItData *data = user_data;
-  GstBuffer *bufout;
-  GstFlowReturn ret;
-
-  ret = gst_srtp_enc_process_buffer (data->filter, data->pad, *buffer,
-      data->is_rtcp, &bufout);
-  if (ret != GST_FLOW_OK) {
-    data->flowret = ret;
-    return FALSE;
-  }
+  GstSrtpEnc *filter = user_data;
 
-  gst_buffer_list_add (data->out_list, bufout);
+  *buffer = gst_srtp_enc_prepare_buffer (filter, *buffer);
 
   return TRUE;
 }
@@ -1254,8 +1336,8 @@ gst_srtp_enc_chain_list (GstPad * pad, GstObject * parent,
   GstSrtpEnc *filter = GST_SRTP_ENC (parent);
   GstFlowReturn ret = GST_FLOW_OK;
   GstPad *otherpad;
-  GstBufferList *out_list = NULL;
-  ProcessBufferItData process_data;
+  srtp_err_status_t err = srtp_err_status_ok;
+  guint i, len;
 
   GST_LOG_OBJECT (pad, "Buffer chain with list of %d",
       gst_buffer_list_length (buf_list));
@@ -1276,30 +1358,45 @@ gst_srtp_enc_chain_list (GstPad * pad, GstObject * parent,
 
   GST_OBJECT_UNLOCK (filter);
 
-  out_list = gst_buffer_list_new ();
+  /* Make room for the trailers outside of the lock, in place in the list
+   * when possible */
+  buf_list = gst_buffer_list_make_writable (buf_list);
 
-  process_data.filter = filter;
-  process_data.pad = pad;
-  process_data.is_rtcp = is_rtcp;
-  process_data.out_list = out_list;
-  process_data.flowret = GST_FLOW_OK;
+  gst_buffer_list_foreach (buf_list, prepare_buffer_it, filter);
 
-  if (!gst_buffer_list_foreach (buf_list, process_buffer_it, &process_data)) {
-    ret = process_data.flowret;
+  /* Protect the whole list with a single lock acquisition */
+  len = gst_buffer_list_length (buf_list);
+
+  GST_OBJECT_LOCK (filter);
+
+  gst_srtp_init_event_reporter ();
+
+  if (filter->session == NULL) {
+    /* The rtcp session disappeared (element shutting down) */
+    GST_OBJECT_UNLOCK (filter);
+    ret = GST_FLOW_FLUSHING;
     goto out;
   }
 
-  if (!gst_buffer_list_length (out_list)) {
-    gst_buffer_list_unref (out_list);
-    ret = GST_FLOW_OK;
+  for (i = 0; i < len; i++) {
+    err = gst_srtp_enc_protect_locked (filter, gst_buffer_list_get (buf_list,
+            i), is_rtcp);
+    if (err != srtp_err_status_ok)
+      break;
+  }
+
+  GST_OBJECT_UNLOCK (filter);
+
+  if (err != srtp_err_status_ok) {
+    ret = gst_srtp_enc_handle_protect_error (filter, err);
     goto out;
   }
 
   /* Push buffer to source pad */
   otherpad = get_rtp_other_pad (pad);
-  GST_LOG_OBJECT (pad, "Pushing buffer chain of %d",
-      gst_buffer_list_length (buf_list));
-  ret = gst_pad_push_list (otherpad, out_list);
+  GST_LOG_OBJECT (pad, "Pushing buffer chain of %d", len);
+  ret = gst_pad_push_list (otherpad, buf_list);
+  buf_list = NULL;
 
   if (ret != GST_FLOW_OK) {
     goto out;
@@ -1319,7 +1416,8 @@ gst_srtp_enc_chain_list (GstPad * pad, GstObject * parent,
 
 out:
 
-  gst_buffer_list_unref (buf_list);
+  if (buf_list)
+    gst_buffer_list_unref (buf_list);
 
   return ret;
 }
@@ -1394,7 +1492,21 @@ gst_srtp_enc_change_state (GstElement * element, GstStateChange transition)
       GST_OBJECT_UNLOCK (filter);
       break;
     case GST_STATE_CHANGE_READY_TO_PAUSED:
+    {
+      GstStructure *config;
+
+      /* Output buffers for packets that can't be protected in place */
+      filter->pool = gst_buffer_pool_new ();
+      config = gst_buffer_pool_get_config (filter->pool);
+      gst_buffer_pool_config_set_params (config, NULL, POOL_BUFFER_SIZE, 0, 0);
+      if (!gst_buffer_pool_set_config (filter->pool, config) ||
+          !gst_buffer_pool_set_active (filter->pool, TRUE)) {
+        GST_WARNING_OBJECT (filter, "Failed to set up buffer pool");
+        gst_object_unref (filter->pool);
+        filter->pool = NULL;
+      }
       break;
+    }
     case GST_STATE_CHANGE_PAUSED_TO_PLAYING:
       break;
     default:
@@ -1409,6 +1521,11 @@ gst_srtp_enc_change_state (GstElement * element, GstStateChange transition)
       break;
     case GST_STATE_CHANGE_PAUSED_TO_READY:
       gst_srtp_enc_reset (filter);
+      if (filter->pool) {
+        gst_buffer_pool_set_active (filter->pool, FALSE);
+        gst_object_unref (filter->pool);
+        filter->pool = NULL;
+      }
       break;
     case GST_STATE_CHANGE_READY_TO_NULL:
       break;
@@ -86,6 +86,9 @@ struct _GstSrtpEnc
   gboolean allow_repeat_tx;
 
   GHashTable *ssrcs_set;
+
+  /* output buffers for packets without room for the SRTP trailer */
+  GstBufferPool *pool;
 };
 
 struct _GstSrtpEncClass
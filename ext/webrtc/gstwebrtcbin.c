@@ -49,6 +49,12 @@
 #define PC_COND_BROADCAST(w) (g_cond_broadcast(PC_GET_COND(w)))
 #define PC_COND_SIGNAL(w) (g_cond_signal(PC_GET_COND(w)))
 
+/* Number of operations a bin runs on a shared pool thread before letting
+ * the other bins queued on the pool run */
+#define SHARED_OPS_MAX_PER_TURN 16
+
+#define DEFAULT_STATS_INTERVAL 100
+
 /*
  * This webrtcbin implements the majority of the W3's peerconnection API and
  * implementation guide where possible. Generating offers, answers and setting
@@ -328,6 +334,8 @@ enum
   ON_ICE_CANDIDATE_SIGNAL,
   ON_NEW_TRANSCEIVER_SIGNAL,
   GET_STATS_SIGNAL,
+  GET_STATS_FILTERED_SIGNAL,
+  GET_STATS_SNAPSHOT_SIGNAL,
   ADD_TRANSCEIVER_SIGNAL,
   GET_TRANSCEIVER_SIGNAL,
   GET_TRANSCEIVERS_SIGNAL,
@@ -354,6 +362,8 @@ enum
   PROP_TURN_SERVER,
   PROP_BUNDLE_POLICY,
   PROP_ICE_TRANSPORT_POLICY,
+  PROP_SHARED_OPS_POOL,
+  PROP_STATS_INTERVAL,
 };
 
 static guint gst_webrtc_bin_signals[LAST_SIGNAL] = { 0 };
@@ -699,10 +709,75 @@ _gst_pc_thread (GstWebRTCBin * webrtc)
   return NULL;
 }
 
+static gboolean _execute_op (GstWebRTCBinTask * op);
+static void _free_op (GstWebRTCBinTask * op);
+static void _shared_ops_func (GstWebRTCBin * webrtc, gpointer unused);
+
+static GThreadPool *
+_get_shared_ops_pool (void)
+{
+  static GThreadPool *pool = NULL;
+
+  if (g_once_init_enter (&pool)) {
+    GThreadPool *p;
+
+    /* Bounded by the number of CPUs, the threads are idle most of the time
+     * and only needed to run the short operations of each bin */
+    p = g_thread_pool_new ((GFunc) _shared_ops_func, NULL,
+        MAX (2, g_get_num_processors ()), FALSE, NULL);
+    g_once_init_leave (&pool, p);
+  }
+
+  return pool;
+}
+
+/* Runs the queued operations of one bin. A bin is pushed to the pool at
+ * most once at a time so its operations keep their order */
+static void
+_shared_ops_func (GstWebRTCBin * webrtc, gpointer unused)
+{
+  guint n_ops = 0;
+
+  while (TRUE) {
+    GstWebRTCBinTask *op;
+
+    g_mutex_lock (&webrtc->priv->ops_lock);
+    if (g_queue_is_empty (&webrtc->priv->ops)) {
+      webrtc->priv->ops_scheduled = FALSE;
+      g_cond_broadcast (&webrtc->priv->ops_cond);
+      g_mutex_unlock (&webrtc->priv->ops_lock);
+      break;
+    }
+
+    if (n_ops++ == SHARED_OPS_MAX_PER_TURN) {
+      /* give the other bins a chance, our reference moves along */
+      g_mutex_unlock (&webrtc->priv->ops_lock);
+      g_thread_pool_push (_get_shared_ops_pool (), webrtc, NULL);
+      return;
+    }
+
+    op = g_queue_pop_head (&webrtc->priv->ops);
+    g_mutex_unlock (&webrtc->priv->ops_lock);
+
+    _execute_op (op);
+    _free_op (op);
+  }
+
+  gst_object_unref (webrtc);
+}
+
 static void
 _start_thread (GstWebRTCBin * webrtc)
 {
   PC_LOCK (webrtc);
+  webrtc->priv->ops_shared = webrtc->priv->shared_ops_pool;
+  if (webrtc->priv->ops_shared) {
+    /* operations are run on the shared pool, no thread of our own */
+    webrtc->priv->is_closed = FALSE;
+    PC_UNLOCK (webrtc);
+    return;
+  }
+
   webrtc->priv->thread = g_thread_new ("gst-pc-ops",
       (GThreadFunc) _gst_pc_thread, webrtc);
 
@@ -717,6 +792,18 @@ _stop_thread (GstWebRTCBin * webrtc)
 {
   PC_LOCK (webrtc);
   webrtc->priv->is_closed = TRUE;
+  if (webrtc->priv->ops_shared) {
+    PC_UNLOCK (webrtc);
+
+    /* wait for the queued operations to be flushed, they are skipped now
+     * that we're closed */
+    g_mutex_lock (&webrtc->priv->ops_lock);
+    while (webrtc->priv->ops_scheduled)
+      g_cond_wait (&webrtc->priv->ops_cond, &webrtc->priv->ops_lock);
+    g_mutex_unlock (&webrtc->priv->ops_lock);
+    return;
+  }
+
   g_main_loop_quit (webrtc->priv->loop);
   while (webrtc->priv->loop)
     PC_COND_WAIT (webrtc);
@@ -771,6 +858,22 @@ gst_webrtc_bin_enqueue_task (GstWebRTCBin * webrtc, GstWebRTCBinFunc func,
   op->data = data;
   op->notify = notify;
 
+  if (webrtc->priv->ops_shared) {
+    gboolean schedule;
+
+    g_mutex_lock (&webrtc->priv->ops_lock);
+    g_queue_push_tail (&webrtc->priv->ops, op);
+    schedule = !webrtc->priv->ops_scheduled;
+    webrtc->priv->ops_scheduled = TRUE;
+    g_mutex_unlock (&webrtc->priv->ops_lock);
+
+    /* the pool thread keeps the bin alive until the queue is empty */
+    if (schedule)
+      g_thread_pool_push (_get_shared_ops_pool (), gst_object_ref (webrtc),
+          NULL);
+    return;
+  }
+
   source = g_idle_source_new ();
   g_source_set_priority (source, G_PRIORITY_DEFAULT);
   g_source_set_callback (source, (GSourceFunc) _execute_op, op,
@@ -4373,18 +4476,44 @@ _on_ice_candidate (GstWebRTCICE * ice, guint session_id,
 
 /* https://www.w3.org/TR/webrtc/#dfn-stats-selection-algorithm */
 static GstStructure *
-_get_stats_from_selector (GstWebRTCBin * webrtc, gpointer selector)
+_get_stats_from_selector (GstWebRTCBin * webrtc, gpointer selector,
+    guint types)
 {
+  GstStructure *s;
+
   if (selector)
     GST_FIXME_OBJECT (webrtc, "Implement stats selection");
 
-  return gst_structure_copy (webrtc->priv->stats);
+  GST_OBJECT_LOCK (webrtc);
+  s = gst_webrtc_stats_filter (webrtc->priv->stats, types);
+  GST_OBJECT_UNLOCK (webrtc);
+
+  return s;
+}
+
+static gpointer
+_get_stats_selector_for_pad (GstPad * pad)
+{
+  GstWebRTCBinPad *wpad;
+
+  if (!pad)
+    return NULL;
+
+  wpad = GST_WEBRTC_BIN_PAD (pad);
+  if (!wpad->trans)
+    return NULL;
+
+  if (GST_PAD_DIRECTION (wpad) == GST_PAD_SRC)
+    return wpad->trans->receiver;
+  else
+    return wpad->trans->sender;
 }
 
 struct get_stats
 {
   GstPad *pad;
   GstPromise *promise;
+  guint types;
 };
 
 static void
@@ -4402,29 +4531,18 @@ static void
 _get_stats_task (GstWebRTCBin * webrtc, struct get_stats *stats)
 {
   GstStructure *s;
-  gpointer selector = NULL;
-
-  gst_webrtc_bin_update_stats (webrtc);
-
-  if (stats->pad) {
-    GstWebRTCBinPad *wpad = GST_WEBRTC_BIN_PAD (stats->pad);
+  gpointer selector;
 
-    if (wpad->trans) {
-      if (GST_PAD_DIRECTION (wpad) == GST_PAD_SRC) {
-        selector = wpad->trans->receiver;
-      } else {
-        selector = wpad->trans->sender;
-      }
-    }
-  }
+  gst_webrtc_bin_update_stats (webrtc, stats->types);
 
-  s = _get_stats_from_selector (webrtc, selector);
+  selector = _get_stats_selector_for_pad (stats->pad);
+  s = _get_stats_from_selector (webrtc, selector, stats->types);
   gst_promise_reply (stats->promise, s);
 }
 
 static void
-gst_webrtc_bin_get_stats (GstWebRTCBin * webrtc, GstPad * pad,
-    GstPromise * promise)
+gst_webrtc_bin_get_stats_filtered (GstWebRTCBin * webrtc, GstPad * pad,
+    const gchar * const *types, GstPromise * promise)
 {
   struct get_stats *stats;
 
@@ -4433,6 +4551,7 @@ gst_webrtc_bin_get_stats (GstWebRTCBin * webrtc, GstPad * pad,
 
   stats = g_new0 (struct get_stats, 1);
   stats->promise = gst_promise_ref (promise);
+  stats->types = gst_webrtc_stats_types_from_strv (types);
   /* FIXME: check that pad exists in element */
   if (pad)
     stats->pad = gst_object_ref (pad);
@@ -4441,6 +4560,23 @@ gst_webrtc_bin_get_stats (GstWebRTCBin * webrtc, GstPad * pad,
       stats, (GDestroyNotify) _free_get_stats);
 }
 
+static void
+gst_webrtc_bin_get_stats (GstWebRTCBin * webrtc, GstPad * pad,
+    GstPromise * promise)
+{
+  gst_webrtc_bin_get_stats_filtered (webrtc, pad, NULL, promise);
+}
+
+static GstStructure *
+gst_webrtc_bin_get_stats_snapshot (GstWebRTCBin * webrtc, GstPad * pad,
+    const gchar * const *types)
+{
+  g_return_val_if_fail (pad == NULL || GST_IS_WEBRTC_BIN_PAD (pad), NULL);
+
+  return _get_stats_from_selector (webrtc, _get_stats_selector_for_pad (pad),
+      gst_webrtc_stats_types_from_strv (types));
+}
+
 static GstWebRTCRTPTransceiver *
 gst_webrtc_bin_add_transceiver (GstWebRTCBin * webrtc,
     GstWebRTCRTPTransceiverDirection direction, GstCaps * caps)
@@ -5332,6 +5468,16 @@ gst_webrtc_bin_set_property (GObject * object, guint prop_id,
           webrtc->ice_transport_policy ==
           GST_WEBRTC_ICE_TRANSPORT_POLICY_RELAY ? TRUE : FALSE, NULL);
       break;
+    case PROP_SHARED_OPS_POOL:
+      PC_LOCK (webrtc);
+      webrtc->priv->shared_ops_pool = g_value_get_boolean (value);
+      PC_UNLOCK (webrtc);
+      break;
+    case PROP_STATS_INTERVAL:
+      GST_OBJECT_LOCK (webrtc);
+      webrtc->priv->stats_interval = g_value_get_uint (value);
+      GST_OBJECT_UNLOCK (webrtc);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -5396,6 +5542,14 @@ gst_webrtc_bin_get_property (GObject * object, guint prop_id,
     case PROP_ICE_TRANSPORT_POLICY:
       g_value_set_enum (value, webrtc->ice_transport_policy);
       break;
+    case PROP_SHARED_OPS_POOL:
+      g_value_set_boolean (value, webrtc->priv->shared_ops_pool);
+      break;
+    case PROP_STATS_INTERVAL:
+      GST_OBJECT_LOCK (webrtc);
+      g_value_set_uint (value, webrtc->priv->stats_interval);
+      GST_OBJECT_UNLOCK (webrtc);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -5490,9 +5644,14 @@ gst_webrtc_bin_finalize (GObject * object)
   if (webrtc->priv->stats)
     gst_structure_free (webrtc->priv->stats);
   webrtc->priv->stats = NULL;
+  if (webrtc->priv->session_stats)
+    g_hash_table_unref (webrtc->priv->session_stats);
+  webrtc->priv->session_stats = NULL;
 
   g_mutex_clear (PC_GET_LOCK (webrtc));
   g_cond_clear (PC_GET_COND (webrtc));
+  g_mutex_clear (&webrtc->priv->ops_lock);
+  g_cond_clear (&webrtc->priv->ops_cond);
 
   G_OBJECT_CLASS (parent_class)->finalize (object);
 }
@@ -5638,6 +5797,38 @@ gst_webrtc_bin_class_init (GstWebRTCBinClass * klass)
           GST_WEBRTC_ICE_TRANSPORT_POLICY_ALL,
           G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+  /**
+   * GstWebRTCBin:shared-ops-pool:
+   *
+   * Run the peerconnection operations on a thread pool shared by all the
+   * webrtcbin instances of the process, bounded by the number of CPUs,
+   * instead of on a dedicated thread per instance. Operations of each
+   * instance are still executed one at a time and in order.
+   *
+   * Takes effect on the next transition to the READY state.
+   */
+  g_object_class_install_property (gobject_class,
+      PROP_SHARED_OPS_POOL,
+      g_param_spec_boolean ("shared-ops-pool", "Shared Operations Pool",
+          "Run operations on a thread pool shared between all instances",
+          FALSE, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS |
+          GST_PARAM_MUTABLE_READY));
+
+  /**
+   * GstWebRTCBin:stats-interval:
+   *
+   * Minimum time in milliseconds between two updates of the same type of
+   * statistics. Requesting statistics more often returns the previously
+   * generated values of those types, the statistics of the RTP sessions
+   * are kept for as long. 0 updates them on every request.
+   */
+  g_object_class_install_property (gobject_class,
+      PROP_STATS_INTERVAL,
+      g_param_spec_uint ("stats-interval", "Stats Interval",
+          "Minimum time in milliseconds between two statistics updates",
+          0, G_MAXUINT, DEFAULT_STATS_INTERVAL,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
   /**
    * GstWebRTCBin::create-offer:
    * @object: the #webrtcbin
@@ -5771,6 +5962,13 @@ gst_webrtc_bin_class_init (GstWebRTCBinClass * klass)
    *
    *  "local-id"            G_TYPE_STRING               identifier for the associated RTCInboundRTPSTreamStats
    *
+   * RTCTransportStats supported fields (https://w3c.github.io/webrtc-stats/#transportstats-dict*)
+   *
+   *  "packets-sent"        G_TYPE_UINT64               number of packets sent on the transport, counted as they are sent
+   *  "packets-received"    G_TYPE_UINT64               number of packets received on the transport, counted as they are received
+   *  "bytes-sent"          G_TYPE_UINT64               number of bytes sent on the transport
+   *  "bytes-received"      G_TYPE_UINT64               number of bytes received on the transport
+   *
    */
   gst_webrtc_bin_signals[GET_STATS_SIGNAL] =
       g_signal_new_class_handler ("get-stats",
@@ -5779,6 +5977,47 @@ gst_webrtc_bin_class_init (GstWebRTCBinClass * klass)
       g_cclosure_marshal_generic, G_TYPE_NONE, 2, GST_TYPE_PAD,
       GST_TYPE_PROMISE);
 
+  /**
+   * GstWebRTCBin::get-stats-filtered:
+   * @object: the #webrtcbin
+   * @pad: (nullable): A #GstPad to get the stats for, or %NULL for all
+   * @types: (nullable): %NULL terminated array of the statistics types to
+   *     retrieve, e.g. "inbound-rtp" or "transport", or %NULL for all
+   * @promise: a #GstPromise for the result
+   *
+   * Like #GstWebRTCBin::get-stats but only updates and returns the statistics
+   * of @types. Not requesting the RTP stream statistics avoids querying the
+   * RTP sessions.
+   */
+  gst_webrtc_bin_signals[GET_STATS_FILTERED_SIGNAL] =
+      g_signal_new_class_handler ("get-stats-filtered",
+      G_TYPE_FROM_CLASS (klass), G_SIGNAL_RUN_LAST | G_SIGNAL_ACTION,
+      G_CALLBACK (gst_webrtc_bin_get_stats_filtered), NULL, NULL,
+      g_cclosure_marshal_generic, G_TYPE_NONE, 3, GST_TYPE_PAD, G_TYPE_STRV,
+      GST_TYPE_PROMISE);
+
+  /**
+   * GstWebRTCBin::get-stats-snapshot:
+   * @object: the #webrtcbin
+   * @pad: (nullable): A #GstPad to get the stats for, or %NULL for all
+   * @types: (nullable): %NULL terminated array of the statistics types to
+   *     retrieve, or %NULL for all
+   *
+   * Returns the statistics generated by the last #GstWebRTCBin::get-stats or
+   * #GstWebRTCBin::get-stats-filtered request without updating them. This
+   * does not wait for the pending operations and can be called from any
+   * thread.
+   *
+   * Returns: (transfer full): the statistics in the same format as
+   *     #GstWebRTCBin::get-stats
+   */
+  gst_webrtc_bin_signals[GET_STATS_SNAPSHOT_SIGNAL] =
+      g_signal_new_class_handler ("get-stats-snapshot",
+      G_TYPE_FROM_CLASS (klass), G_SIGNAL_RUN_LAST | G_SIGNAL_ACTION,
+      G_CALLBACK (gst_webrtc_bin_get_stats_snapshot), NULL, NULL,
+      g_cclosure_marshal_generic, GST_TYPE_STRUCTURE, 2, GST_TYPE_PAD,
+      G_TYPE_STRV);
+
   /**
    * GstWebRTCBin::on-negotiation-needed:
    * @object: the #webrtcbin
@@ -5939,6 +6178,9 @@ gst_webrtc_bin_init (GstWebRTCBin * webrtc)
   webrtc->priv = gst_webrtc_bin_get_instance_private (webrtc);
   g_mutex_init (PC_GET_LOCK (webrtc));
   g_cond_init (PC_GET_COND (webrtc));
+  g_mutex_init (&webrtc->priv->ops_lock);
+  g_cond_init (&webrtc->priv->ops_cond);
+  g_queue_init (&webrtc->priv->ops);
 
   webrtc->rtpbin = _create_rtpbin (webrtc);
   gst_bin_add (GST_BIN (webrtc), webrtc->rtpbin);
@@ -5975,6 +6217,8 @@ gst_webrtc_bin_init (GstWebRTCBin * webrtc)
   g_array_set_clear_func (webrtc->priv->pending_ice_candidates,
       (GDestroyNotify) _clear_ice_candidate_item);
 
+  webrtc->priv->stats_interval = DEFAULT_STATS_INTERVAL;
+
   /* we start off closed until we move to READY */
   webrtc->priv->is_closed = TRUE;
 }
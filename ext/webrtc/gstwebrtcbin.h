@@ -122,6 +122,15 @@ struct _GstWebRTCBinPrivate
   GMutex pc_lock;
   GCond pc_cond;
 
+  /* operations queued for the shared thread pool, executed in order by at
+   * most one pool thread at a time */
+  gboolean shared_ops_pool;
+  gboolean ops_shared;
+  GMutex ops_lock;
+  GCond ops_cond;
+  GQueue ops;
+  gboolean ops_scheduled;
+
   gboolean running;
   gboolean async_pending;
 
@@ -136,7 +145,15 @@ struct _GstWebRTCBinPrivate
   GstWebRTCSessionDescription *last_generated_offer;
   GstWebRTCSessionDescription *last_generated_answer;
 
+  /* last generated reports, protected by the object lock */
   GstStructure *stats;
+  /* minimum time in ms between two updates of the same report type */
+  guint stats_interval;
+  /* monotonic time of the last update of each report type */
+  gint64 stats_update_time[GST_WEBRTC_STATS_CERTIFICATE + 1];
+  /* session id -> rtpsession stats, reused for stats-interval as well */
+  GHashTable *session_stats;
+  gint64 session_stats_time;
 };
 
 typedef void (*GstWebRTCBinFunc) (GstWebRTCBin * webrtc, gpointer data);
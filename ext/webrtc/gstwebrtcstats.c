@@ -34,6 +34,18 @@
 #define GST_CAT_DEFAULT gst_webrtc_stats_debug
 GST_DEBUG_CATEGORY_STATIC (GST_CAT_DEFAULT);
 
+typedef struct
+{
+  GstStructure *s;
+  /* report types to generate */
+  guint types;
+  /* session id -> rtpsession stats, so bundled pads only query once, owned
+   * by the webrtcbin */
+  GHashTable *session_stats;
+} StatsUpdate;
+
+#define WANT_STATS(types,t) (((types) & STATS_TYPE_MASK (t)) != 0)
+
 static void
 _init_debug (void)
 {
@@ -46,12 +58,6 @@ _init_debug (void)
   }
 }
 
-static double
-monotonic_time_as_double_milliseconds (void)
-{
-  return g_get_monotonic_time () / 1000.0;
-}
-
 static void
 _set_base_stats (GstStructure * s, GstWebRTCStatsType type, double ts,
     const char *id)
@@ -88,7 +94,7 @@ _get_peer_connection_stats (GstWebRTCBin * webrtc)
 static void
 _get_stats_from_rtp_source_stats (GstWebRTCBin * webrtc,
     const GstStructure * source_stats, const gchar * codec_id,
-    const gchar * transport_id, GstStructure * s)
+    const gchar * transport_id, guint types, GstStructure * s)
 {
   GstStructure *in, *out, *r_in, *r_out;
   gchar *in_id, *out_id, *r_in_id, *r_out_id;
@@ -262,10 +268,14 @@ _get_stats_from_rtp_source_stats (GstWebRTCBin * webrtc,
 
   gst_structure_set (r_out, "local-id", G_TYPE_STRING, in_id, NULL);
 
-  gst_structure_set (s, in_id, GST_TYPE_STRUCTURE, in, NULL);
-  gst_structure_set (s, out_id, GST_TYPE_STRUCTURE, out, NULL);
-  gst_structure_set (s, r_in_id, GST_TYPE_STRUCTURE, r_in, NULL);
-  gst_structure_set (s, r_out_id, GST_TYPE_STRUCTURE, r_out, NULL);
+  if (WANT_STATS (types, GST_WEBRTC_STATS_INBOUND_RTP))
+    gst_structure_set (s, in_id, GST_TYPE_STRUCTURE, in, NULL);
+  if (WANT_STATS (types, GST_WEBRTC_STATS_OUTBOUND_RTP))
+    gst_structure_set (s, out_id, GST_TYPE_STRUCTURE, out, NULL);
+  if (WANT_STATS (types, GST_WEBRTC_STATS_REMOTE_INBOUND_RTP))
+    gst_structure_set (s, r_in_id, GST_TYPE_STRUCTURE, r_in, NULL);
+  if (WANT_STATS (types, GST_WEBRTC_STATS_REMOTE_OUTBOUND_RTP))
+    gst_structure_set (s, r_out_id, GST_TYPE_STRUCTURE, r_out, NULL);
 
   gst_structure_free (in);
   gst_structure_free (out);
@@ -278,20 +288,39 @@ _get_stats_from_rtp_source_stats (GstWebRTCBin * webrtc,
   g_free (r_out_id);
 }
 
+/* packets and bytes counted on the data path of the RTP ICE transport */
+static void
+_set_transport_counters (GstStructure * stats, TransportStream * stream)
+{
+  GST_OBJECT_LOCK (stream);
+  gst_structure_set (stats,
+      "packets-sent", G_TYPE_UINT64, stream->packets_sent,
+      "packets-received", G_TYPE_UINT64, stream->packets_received,
+      "bytes-sent", G_TYPE_UINT64, stream->bytes_sent,
+      "bytes-received", G_TYPE_UINT64, stream->bytes_received, NULL);
+  GST_OBJECT_UNLOCK (stream);
+}
+
 /* https://www.w3.org/TR/webrtc-stats/#candidatepair-dict* */
 static gchar *
 _get_stats_from_ice_transport (GstWebRTCBin * webrtc,
-    GstWebRTCICETransport * transport, GstStructure * s)
+    GstWebRTCICETransport * transport, TransportStream * stream,
+    GstStructure * s)
 {
   GstStructure *stats;
   gchar *id;
   double ts;
 
+  id = g_strdup_printf ("ice-candidate-pair_%s", GST_OBJECT_NAME (transport));
+  /* already reported through another bundled pad */
+  if (gst_structure_has_field (s, id))
+    return id;
+
   gst_structure_get_double (s, "timestamp", &ts);
 
-  id = g_strdup_printf ("ice-candidate-pair_%s", GST_OBJECT_NAME (transport));
   stats = gst_structure_new_empty (id);
   _set_base_stats (stats, GST_WEBRTC_STATS_TRANSPORT, ts, id);
+  _set_transport_counters (stats, stream);
 
 /* XXX: RTCIceCandidatePairStats
     DOMString                     transportId;
@@ -300,10 +329,6 @@ _get_stats_from_ice_transport (GstWebRTCBin * webrtc,
     RTCStatsIceCandidatePairState state;
     unsigned long long            priority;
     boolean                       nominated;
-    unsigned long                 packetsSent;
-    unsigned long                 packetsReceived;
-    unsigned long long            bytesSent;
-    unsigned long long            bytesReceived;
     DOMHighResTimeStamp           lastPacketSentTimestamp;
     DOMHighResTimeStamp           lastPacketReceivedTimestamp;
     DOMHighResTimeStamp           firstRequestTimestamp;
@@ -348,24 +373,26 @@ _get_stats_from_ice_transport (GstWebRTCBin * webrtc,
 /* https://www.w3.org/TR/webrtc-stats/#dom-rtctransportstats */
 static gchar *
 _get_stats_from_dtls_transport (GstWebRTCBin * webrtc,
-    GstWebRTCDTLSTransport * transport, GstStructure * s)
+    GstWebRTCDTLSTransport * transport, TransportStream * stream, guint types,
+    GstStructure * s)
 {
   GstStructure *stats;
   gchar *id;
   double ts;
   gchar *ice_id;
 
+  id = g_strdup_printf ("transport-stats_%s", GST_OBJECT_NAME (transport));
+  if (!WANT_STATS (types, GST_WEBRTC_STATS_TRANSPORT)
+      || gst_structure_has_field (s, id))
+    return id;
+
   gst_structure_get_double (s, "timestamp", &ts);
 
-  id = g_strdup_printf ("transport-stats_%s", GST_OBJECT_NAME (transport));
   stats = gst_structure_new_empty (id);
   _set_base_stats (stats, GST_WEBRTC_STATS_TRANSPORT, ts, id);
+  _set_transport_counters (stats, stream);
 
 /* XXX: RTCTransportStats
-    unsigned long         packetsSent;
-    unsigned long         packetsReceived;
-    unsigned long long    bytesSent;
-    unsigned long long    bytesReceived;
     DOMString             rtcpTransportStatsId;
     RTCIceRole            iceRole;
     RTCDtlsTransportState dtlsState;
@@ -396,51 +423,79 @@ _get_stats_from_dtls_transport (GstWebRTCBin * webrtc,
   gst_structure_set (s, id, GST_TYPE_STRUCTURE, stats, NULL);
   gst_structure_free (stats);
 
-  ice_id = _get_stats_from_ice_transport (webrtc, transport->transport, s);
+  ice_id = _get_stats_from_ice_transport (webrtc, transport->transport,
+      stream, s);
   g_free (ice_id);
 
   return id;
 }
 
+static const GValueArray *
+_get_rtp_source_stats (GstWebRTCBin * webrtc, guint session_id,
+    GHashTable * session_stats)
+{
+  GstStructure *rtp_stats;
+  const GValue *val;
+
+  rtp_stats = g_hash_table_lookup (session_stats, GUINT_TO_POINTER (session_id));
+  if (!rtp_stats) {
+    GObject *rtp_session;
+
+    g_signal_emit_by_name (webrtc->rtpbin, "get-internal-session",
+        session_id, &rtp_session);
+    g_object_get (rtp_session, "stats", &rtp_stats, NULL);
+    g_object_unref (rtp_session);
+
+    g_hash_table_insert (session_stats, GUINT_TO_POINTER (session_id),
+        rtp_stats);
+  }
+
+  val = gst_structure_get_value (rtp_stats, "source-stats");
+  if (!val)
+    return NULL;
+
+  return g_value_get_boxed (val);
+}
+
 static void
 _get_stats_from_transport_channel (GstWebRTCBin * webrtc,
     TransportStream * stream, const gchar * codec_id, guint ssrc,
-    GstStructure * s)
+    StatsUpdate * update)
 {
   GstWebRTCDTLSTransport *transport;
-  GObject *rtp_session;
-  GstStructure *rtp_stats;
-  GValueArray *source_stats;
+  const GValueArray *source_stats;
   gchar *transport_id;
-  double ts;
   int i;
 
-  gst_structure_get_double (s, "timestamp", &ts);
-
   transport = stream->transport;
-  if (!transport)
-    transport = stream->transport;
   if (!transport)
     return;
 
-  g_signal_emit_by_name (webrtc->rtpbin, "get-internal-session",
-      stream->session_id, &rtp_session);
-  g_object_get (rtp_session, "stats", &rtp_stats, NULL);
+  transport_id = _get_stats_from_dtls_transport (webrtc, transport, stream,
+      update->types, update->s);
 
-  gst_structure_get (rtp_stats, "source-stats", G_TYPE_VALUE_ARRAY,
-      &source_stats, NULL);
+  /* nothing to retrieve from the rtp session */
+  if (!(update->types & (STATS_TYPE_MASK (GST_WEBRTC_STATS_INBOUND_RTP) |
+              STATS_TYPE_MASK (GST_WEBRTC_STATS_OUTBOUND_RTP) |
+              STATS_TYPE_MASK (GST_WEBRTC_STATS_REMOTE_INBOUND_RTP) |
+              STATS_TYPE_MASK (GST_WEBRTC_STATS_REMOTE_OUTBOUND_RTP))))
+    goto out;
+
+  source_stats = _get_rtp_source_stats (webrtc, stream->session_id,
+      update->session_stats);
+  if (!source_stats)
+    goto out;
 
   GST_DEBUG_OBJECT (webrtc, "retrieving rtp stream stats from transport %"
-      GST_PTR_FORMAT " rtp session %" GST_PTR_FORMAT " with %u rtp sources, "
-      "transport %" GST_PTR_FORMAT, stream, rtp_session, source_stats->n_values,
+      GST_PTR_FORMAT " rtp session %u with %u rtp sources, transport %"
+      GST_PTR_FORMAT, stream, stream->session_id, source_stats->n_values,
       transport);
 
-  transport_id = _get_stats_from_dtls_transport (webrtc, transport, s);
-
   /* construct stats objects */
   for (i = 0; i < source_stats->n_values; i++) {
     const GstStructure *stats;
-    const GValue *val = g_value_array_get_nth (source_stats, i);
+    const GValue *val = g_value_array_get_nth ((GValueArray *) source_stats,
+        i);
     gboolean internal;
     guint stats_ssrc = 0;
 
@@ -453,19 +508,18 @@ _get_stats_from_transport_channel (GstWebRTCBin * webrtc,
     if (internal || (ssrc && stats_ssrc && ssrc != stats_ssrc))
       continue;
 
-    _get_stats_from_rtp_source_stats (webrtc, stats, codec_id, transport_id, s);
+    _get_stats_from_rtp_source_stats (webrtc, stats, codec_id, transport_id,
+        update->types, update->s);
   }
 
-  g_object_unref (rtp_session);
-  gst_structure_free (rtp_stats);
-  g_value_array_free (source_stats);
+out:
   g_free (transport_id);
 }
 
 /* https://www.w3.org/TR/webrtc-stats/#codec-dict* */
 static void
 _get_codec_stats_from_pad (GstWebRTCBin * webrtc, GstPad * pad,
-    GstStructure * s, gchar ** out_id, guint * out_ssrc)
+    guint types, GstStructure * s, gchar ** out_id, guint * out_ssrc)
 {
   GstStructure *stats;
   GstCaps *caps;
@@ -499,7 +553,8 @@ _get_codec_stats_from_pad (GstWebRTCBin * webrtc, GstPad * pad,
   if (caps)
     gst_caps_unref (caps);
 
-  gst_structure_set (s, id, GST_TYPE_STRUCTURE, stats, NULL);
+  if (WANT_STATS (types, GST_WEBRTC_STATS_CODEC))
+    gst_structure_set (s, id, GST_TYPE_STRUCTURE, stats, NULL);
   gst_structure_free (stats);
 
   if (out_id)
@@ -512,14 +567,16 @@ _get_codec_stats_from_pad (GstWebRTCBin * webrtc, GstPad * pad,
 }
 
 static gboolean
-_get_stats_from_pad (GstWebRTCBin * webrtc, GstPad * pad, GstStructure * s)
+_get_stats_from_pad (GstWebRTCBin * webrtc, GstPad * pad,
+    StatsUpdate * update)
 {
   GstWebRTCBinPad *wpad = GST_WEBRTC_BIN_PAD (pad);
   TransportStream *stream;
   gchar *codec_id;
   guint ssrc;
 
-  _get_codec_stats_from_pad (webrtc, pad, s, &codec_id, &ssrc);
+  _get_codec_stats_from_pad (webrtc, pad, update->types, update->s, &codec_id,
+      &ssrc);
 
   if (!wpad->trans)
     goto out;
@@ -528,43 +585,179 @@ _get_stats_from_pad (GstWebRTCBin * webrtc, GstPad * pad, GstStructure * s)
   if (!stream)
     goto out;
 
-  _get_stats_from_transport_channel (webrtc, stream, codec_id, ssrc, s);
+  _get_stats_from_transport_channel (webrtc, stream, codec_id, ssrc, update);
 
 out:
   g_free (codec_id);
   return TRUE;
 }
 
+/* keeps the reports from the previous update that weren't regenerated */
+static gboolean
+_merge_stats_func (GQuark field_id, const GValue * value, StatsUpdate * update)
+{
+  const GstStructure *stats;
+  gint type;
+
+  if (gst_structure_id_has_field (update->s, field_id))
+    return TRUE;
+  if (!GST_VALUE_HOLDS_STRUCTURE (value))
+    return TRUE;
+
+  stats = gst_value_get_structure (value);
+  if (gst_structure_get_enum (stats, "type", GST_TYPE_WEBRTC_STATS_TYPE,
+          &type) && WANT_STATS (update->types, type))
+    return TRUE;
+
+  gst_structure_id_set_value (update->s, field_id, value);
+
+  return TRUE;
+}
+
+/*
+ * Only the report types in @types that are older than the stats-interval
+ * property are regenerated, reports of other types are kept from the
+ * previous update.
+ */
 void
-gst_webrtc_bin_update_stats (GstWebRTCBin * webrtc)
+gst_webrtc_bin_update_stats (GstWebRTCBin * webrtc, guint types)
 {
-  GstStructure *s = gst_structure_new_empty ("application/x-webrtc-stats");
-  double ts = monotonic_time_as_double_milliseconds ();
-  GstStructure *pc_stats;
+  GstWebRTCBinPrivate *priv = webrtc->priv;
+  gint64 now = g_get_monotonic_time ();
+  double ts = now / 1000.0;
+  GstStructure *pc_stats, *old_stats;
+  StatsUpdate update;
+  gint64 interval;
+  guint stale = 0;
+  gint i;
 
   _init_debug ();
 
-  gst_structure_set (s, "timestamp", G_TYPE_DOUBLE, ts, NULL);
+  GST_OBJECT_LOCK (webrtc);
+  interval = priv->stats_interval * (gint64) 1000;
+  GST_OBJECT_UNLOCK (webrtc);
+
+  for (i = GST_WEBRTC_STATS_CODEC; i <= GST_WEBRTC_STATS_CERTIFICATE; i++) {
+    if (!WANT_STATS (types, i))
+      continue;
+    if (!priv->stats || now - priv->stats_update_time[i] >= interval)
+      stale |= STATS_TYPE_MASK (i);
+  }
+
+  if (!stale) {
+    GST_LOG_OBJECT (webrtc, "stats are recent enough, not updating");
+    return;
+  }
+
+  /* The rtpsession stats are the most expensive to get, reuse them between
+   * updates of the different RTP report types within the interval */
+  if (!priv->session_stats)
+    priv->session_stats = g_hash_table_new_full (NULL, NULL, NULL,
+        (GDestroyNotify) gst_structure_free);
+  if (now - priv->session_stats_time >= interval) {
+    g_hash_table_remove_all (priv->session_stats);
+    priv->session_stats_time = now;
+  }
+
+  update.s = gst_structure_new_empty ("application/x-webrtc-stats");
+  update.types = stale;
+  update.session_stats = priv->session_stats;
+
+  gst_structure_set (update.s, "timestamp", G_TYPE_DOUBLE, ts, NULL);
 
   /* FIXME: better unique IDs */
-  /* FIXME: rate limitting stat updates? */
   /* FIXME: all stats need to be kept forever */
 
-  GST_DEBUG_OBJECT (webrtc, "updating stats at time %f", ts);
+  GST_DEBUG_OBJECT (webrtc, "updating stats 0x%x at time %f", stale, ts);
 
-  if ((pc_stats = _get_peer_connection_stats (webrtc))) {
+  if (WANT_STATS (stale, GST_WEBRTC_STATS_PEER_CONNECTION)
+      && (pc_stats = _get_peer_connection_stats (webrtc))) {
     const gchar *id = "peer-connection-stats";
     _set_base_stats (pc_stats, GST_WEBRTC_STATS_PEER_CONNECTION, ts, id);
-    gst_structure_set (s, id, GST_TYPE_STRUCTURE, pc_stats, NULL);
+    gst_structure_set (update.s, id, GST_TYPE_STRUCTURE, pc_stats, NULL);
     gst_structure_free (pc_stats);
   }
 
   gst_element_foreach_pad (GST_ELEMENT (webrtc),
-      (GstElementForeachPadFunc) _get_stats_from_pad, s);
+      (GstElementForeachPadFunc) _get_stats_from_pad, &update);
+
+  gst_structure_remove_field (update.s, "timestamp");
+
+  if (priv->stats && stale != STATS_TYPE_MASK_ALL)
+    gst_structure_foreach (priv->stats,
+        (GstStructureForeachFunc) _merge_stats_func, &update);
+
+  for (i = GST_WEBRTC_STATS_CODEC; i <= GST_WEBRTC_STATS_CERTIFICATE; i++) {
+    if (WANT_STATS (stale, i))
+      priv->stats_update_time[i] = now;
+  }
+
+  GST_OBJECT_LOCK (webrtc);
+  old_stats = priv->stats;
+  priv->stats = update.s;
+  GST_OBJECT_UNLOCK (webrtc);
+
+  if (old_stats)
+    gst_structure_free (old_stats);
+}
+
+static gboolean
+_filter_stats_func (GQuark field_id, GValue * value, guint * types)
+{
+  const GstStructure *stats;
+  gint type;
+
+  if (!GST_VALUE_HOLDS_STRUCTURE (value))
+    return TRUE;
+
+  stats = gst_value_get_structure (value);
+  if (!gst_structure_get_enum (stats, "type", GST_TYPE_WEBRTC_STATS_TYPE,
+          &type))
+    return TRUE;
+
+  return WANT_STATS (*types, type);
+}
+
+/* Returns a copy of @stats only containing the reports of @types */
+GstStructure *
+gst_webrtc_stats_filter (const GstStructure * stats, guint types)
+{
+  GstStructure *s;
+
+  if (!stats)
+    return gst_structure_new_empty ("application/x-webrtc-stats");
 
-  gst_structure_remove_field (s, "timestamp");
+  s = gst_structure_copy (stats);
+  if (types != STATS_TYPE_MASK_ALL)
+    gst_structure_filter_and_map_in_place (s,
+        (GstStructureFilterMapFunc) _filter_stats_func, &types);
+
+  return s;
+}
+
+/* Converts a list of report type names as used for the structure names of
+ * the reports (e.g. "inbound-rtp") to a mask, %NULL meaning all types */
+guint
+gst_webrtc_stats_types_from_strv (const gchar * const *types)
+{
+  GEnumClass *enum_class;
+  guint mask = 0;
+
+  if (!types)
+    return STATS_TYPE_MASK_ALL;
+
+  _init_debug ();
+
+  enum_class = g_type_class_ref (GST_TYPE_WEBRTC_STATS_TYPE);
+  for (; *types; types++) {
+    GEnumValue *enum_value = g_enum_get_value_by_nick (enum_class, *types);
+
+    if (enum_value)
+      mask |= STATS_TYPE_MASK (enum_value->value);
+    else
+      GST_WARNING ("Unknown stats type \"%s\"", *types);
+  }
+  g_type_class_unref (enum_class);
 
-  if (webrtc->priv->stats)
-    gst_structure_free (webrtc->priv->stats);
-  webrtc->priv->stats = s;
+  return mask;
 }
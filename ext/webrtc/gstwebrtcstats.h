@@ -27,8 +27,18 @@
 
 G_BEGIN_DECLS
 
+/* bitmask of GstWebRTCStatsType values */
+#define STATS_TYPE_MASK(t) (1U << (t))
+#define STATS_TYPE_MASK_ALL (~0U)
+
+G_GNUC_INTERNAL
+void        gst_webrtc_bin_update_stats         (GstWebRTCBin * webrtc,
+                                                 guint types);
+G_GNUC_INTERNAL
+guint       gst_webrtc_stats_types_from_strv    (const gchar * const * types);
 G_GNUC_INTERNAL
-void        gst_webrtc_bin_update_stats         (GstWebRTCBin * webrtc);
+GstStructure * gst_webrtc_stats_filter          (const GstStructure * stats,
+                                                 guint types);
 
 G_END_DECLS
 
@@ -161,11 +161,84 @@ transport_stream_get_property (GObject * object, guint prop_id,
   GST_OBJECT_UNLOCK (stream);
 }
 
+static void
+_probe_size (GstPadProbeInfo * info, guint * packets, guint64 * bytes)
+{
+  if (GST_PAD_PROBE_INFO_TYPE (info) & GST_PAD_PROBE_TYPE_BUFFER_LIST) {
+    GstBufferList *list = GST_PAD_PROBE_INFO_BUFFER_LIST (info);
+    guint i;
+
+    *packets = gst_buffer_list_length (list);
+    *bytes = 0;
+    for (i = 0; i < *packets; i++)
+      *bytes += gst_buffer_get_size (gst_buffer_list_get (list, i));
+  } else {
+    *packets = 1;
+    *bytes = gst_buffer_get_size (GST_PAD_PROBE_INFO_BUFFER (info));
+  }
+}
+
+static GstPadProbeReturn
+_count_sent (GstPad * pad, GstPadProbeInfo * info, TransportStream * stream)
+{
+  guint packets;
+  guint64 bytes;
+
+  _probe_size (info, &packets, &bytes);
+
+  GST_OBJECT_LOCK (stream);
+  stream->packets_sent += packets;
+  stream->bytes_sent += bytes;
+  GST_OBJECT_UNLOCK (stream);
+
+  return GST_PAD_PROBE_OK;
+}
+
+static GstPadProbeReturn
+_count_received (GstPad * pad, GstPadProbeInfo * info,
+    TransportStream * stream)
+{
+  guint packets;
+  guint64 bytes;
+
+  _probe_size (info, &packets, &bytes);
+
+  GST_OBJECT_LOCK (stream);
+  stream->packets_received += packets;
+  stream->bytes_received += bytes;
+  GST_OBJECT_UNLOCK (stream);
+
+  return GST_PAD_PROBE_OK;
+}
+
+static void
+_remove_count_probe (GstElement * element, const gchar * pad_name,
+    gulong * probe_id)
+{
+  GstPad *pad;
+
+  if (!*probe_id)
+    return;
+
+  pad = gst_element_get_static_pad (element, pad_name);
+  gst_pad_remove_probe (pad, *probe_id);
+  gst_object_unref (pad);
+  *probe_id = 0;
+}
+
 static void
 transport_stream_dispose (GObject * object)
 {
   TransportStream *stream = TRANSPORT_STREAM (object);
 
+  /* the ICE elements may outlive the stream */
+  if (stream->transport) {
+    _remove_count_probe (stream->transport->transport->sink, "sink",
+        &stream->sent_probe_id);
+    _remove_count_probe (stream->transport->transport->src, "src",
+        &stream->received_probe_id);
+  }
+
   if (stream->send_bin)
     gst_object_unref (stream->send_bin);
   stream->send_bin = NULL;
@@ -212,6 +285,7 @@ transport_stream_constructed (GObject * object)
   TransportStream *stream = TRANSPORT_STREAM (object);
   GstWebRTCBin *webrtc;
   GstWebRTCICETransport *ice_trans;
+  GstPad *pad;
 
   stream->transport = gst_webrtc_dtls_transport_new (stream->session_id, FALSE);
   stream->rtcp_transport =
@@ -242,6 +316,20 @@ transport_stream_constructed (GObject * object)
   gst_webrtc_dtls_transport_set_transport (stream->transport, ice_trans);
   gst_object_unref (ice_trans);
 
+  /* count what goes over the wire, DTLS and SCTP included, for the
+   * transport statistics */
+  pad = gst_element_get_static_pad (stream->transport->transport->sink,
+      "sink");
+  stream->sent_probe_id = gst_pad_add_probe (pad,
+      GST_PAD_PROBE_TYPE_BUFFER | GST_PAD_PROBE_TYPE_BUFFER_LIST,
+      (GstPadProbeCallback) _count_sent, stream, NULL);
+  gst_object_unref (pad);
+  pad = gst_element_get_static_pad (stream->transport->transport->src, "src");
+  stream->received_probe_id = gst_pad_add_probe (pad,
+      GST_PAD_PROBE_TYPE_BUFFER | GST_PAD_PROBE_TYPE_BUFFER_LIST,
+      (GstPadProbeCallback) _count_received, stream, NULL);
+  gst_object_unref (pad);
+
   ice_trans =
       gst_webrtc_ice_find_transport (webrtc->priv->ice, stream->stream,
       GST_WEBRTC_ICE_COMPONENT_RTCP);
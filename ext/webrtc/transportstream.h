@@ -65,6 +65,15 @@ struct _TransportStream
 
   GstElement               *rtxsend;
   GstElement               *rtxreceive;
+
+  /* counted on the data path of the RTP ICE transport for the transport
+   * statistics, protected by the object lock */
+  guint64                   packets_sent;
+  guint64                   bytes_sent;
+  guint64                   packets_received;
+  guint64                   bytes_received;
+  gulong                    sent_probe_id;
+  gulong                    received_probe_id;
 };
 
 struct _TransportStreamClass
@@ -61,7 +61,9 @@ enum
   SIGNAL_ON_MESSAGE_DATA,
   SIGNAL_ON_MESSAGE_STRING,
   SIGNAL_ON_BUFFERED_AMOUNT_LOW,
+  SIGNAL_ON_BUFFERED_AMOUNT_HIGH,
   SIGNAL_SEND_DATA,
+  SIGNAL_SEND_DATA_LIST,
   SIGNAL_SEND_STRING,
   SIGNAL_CLOSE,
   LAST_SIGNAL,
@@ -81,6 +83,7 @@ enum
   PROP_READY_STATE,
   PROP_BUFFERED_AMOUNT,
   PROP_BUFFERED_AMOUNT_LOW_THRESHOLD,
+  PROP_BUFFERED_AMOUNT_HIGH_THRESHOLD,
 };
 
 static guint gst_webrtc_data_channel_signals[LAST_SIGNAL] = { 0 };
@@ -286,6 +289,9 @@ _channel_enqueue_task (GstWebRTCDataChannel * channel, ChannelTask func,
       (GstWebRTCBinFunc) _execute_task, task, (GDestroyNotify) _free_task);
 }
 
+static void _close_procedure (GstWebRTCDataChannel * channel,
+    gpointer user_data);
+
 static void
 _channel_store_error (GstWebRTCDataChannel * channel, GError * error)
 {
@@ -311,6 +317,42 @@ _maybe_emit_on_error (GstWebRTCDataChannel * channel, GError * error)
   }
 }
 
+static void
+_emit_high_threshold (GstWebRTCDataChannel * channel, gpointer user_data)
+{
+  GST_LOG_OBJECT (channel, "High threshold reached");
+  g_signal_emit (channel,
+      gst_webrtc_data_channel_signals[SIGNAL_ON_BUFFERED_AMOUNT_HIGH], 0);
+}
+
+static void
+_channel_add_buffered_amount (GstWebRTCDataChannel * channel, guint64 size)
+{
+  guint64 prev_amount;
+
+  CHANNEL_LOCK (channel);
+  prev_amount = channel->buffered_amount;
+  channel->buffered_amount += size;
+  if (channel->buffered_amount_high_threshold > 0 &&
+      prev_amount < channel->buffered_amount_high_threshold &&
+      channel->buffered_amount >= channel->buffered_amount_high_threshold) {
+    _channel_enqueue_task (channel, (ChannelTask) _emit_high_threshold,
+        NULL, NULL);
+  }
+  CHANNEL_UNLOCK (channel);
+}
+
+static void
+_channel_fail (GstWebRTCDataChannel * channel, const gchar * message)
+{
+  GError *error = NULL;
+
+  g_set_error_literal (&error, GST_WEBRTC_BIN_ERROR,
+      GST_WEBRTC_BIN_ERROR_DATA_CHANNEL_FAILURE, message);
+  _channel_store_error (channel, error);
+  _channel_enqueue_task (channel, (ChannelTask) _close_procedure, NULL, NULL);
+}
+
 static void
 _emit_on_open (GstWebRTCDataChannel * channel, gpointer user_data)
 {
@@ -516,9 +558,7 @@ _parse_control_packet (GstWebRTCDataChannel * channel, guint8 * data,
     GST_INFO_OBJECT (channel, "Sending channel ack");
     buffer = construct_ack_packet (channel);
 
-    CHANNEL_LOCK (channel);
-    channel->buffered_amount += gst_buffer_get_size (buffer);
-    CHANNEL_UNLOCK (channel);
+    _channel_add_buffered_amount (channel, gst_buffer_get_size (buffer));
 
     ret = gst_app_src_push_buffer (GST_APP_SRC (channel->appsrc), buffer);
     if (ret != GST_FLOW_OK) {
@@ -634,10 +674,13 @@ _data_channel_have_sample (GstWebRTCDataChannel * channel, GstSample * sample,
     case DATA_CHANNEL_PPID_WEBRTC_BINARY:
     case DATA_CHANNEL_PPID_WEBRTC_BINARY_PARTIAL:{
       struct map_info *info = g_new0 (struct map_info, 1);
+      /* the GBytes borrows the memory of the buffer, which is kept mapped
+       * until the application drops it */
       if (!gst_buffer_map (buffer, &info->map_info, GST_MAP_READ)) {
         g_set_error (error, GST_WEBRTC_BIN_ERROR,
             GST_WEBRTC_BIN_ERROR_DATA_CHANNEL_FAILURE,
             "Failed to map received buffer");
+        g_free (info);
         ret = GST_FLOW_ERROR;
       } else {
         GBytes *data = g_bytes_new_with_free_func (info->map_info.data,
@@ -740,9 +783,7 @@ gst_webrtc_data_channel_start_negotiation (GstWebRTCDataChannel * channel)
       "label %s protocol %s ordered %s", channel->id, channel->label,
       channel->protocol, channel->ordered ? "true" : "false");
 
-  CHANNEL_LOCK (channel);
-  channel->buffered_amount += gst_buffer_get_size (buffer);
-  CHANNEL_UNLOCK (channel);
+  _channel_add_buffered_amount (channel, gst_buffer_get_size (buffer));
 
   if (gst_app_src_push_buffer (GST_APP_SRC (channel->appsrc),
           buffer) == GST_FLOW_OK) {
@@ -780,15 +821,15 @@ _is_within_max_message_size (GstWebRTCDataChannel * channel, gsize size)
   return size <= channel->sctp_transport->max_message_size;
 }
 
-static void
-gst_webrtc_data_channel_send_data (GstWebRTCDataChannel * channel,
-    GBytes * bytes)
+/* Wraps @bytes without copying, returns %NULL and fails the channel if it
+ * can't be sent */
+static GstBuffer *
+_buffer_from_bytes (GstWebRTCDataChannel * channel, GBytes * bytes)
 {
   GstSctpSendMetaPartiallyReliability reliability;
   guint rel_param;
   guint32 ppid;
   GstBuffer *buffer;
-  GstFlowReturn ret;
 
   if (!bytes) {
     buffer = gst_buffer_new ();
@@ -798,16 +839,10 @@ gst_webrtc_data_channel_send_data (GstWebRTCDataChannel * channel,
     guint8 *data;
 
     data = (guint8 *) g_bytes_get_data (bytes, &size);
-    g_return_if_fail (data != NULL);
+    g_return_val_if_fail (data != NULL, NULL);
     if (!_is_within_max_message_size (channel, size)) {
-      GError *error = NULL;
-      g_set_error (&error, GST_WEBRTC_BIN_ERROR,
-          GST_WEBRTC_BIN_ERROR_DATA_CHANNEL_FAILURE,
-          "Requested to send data that is too large");
-      _channel_store_error (channel, error);
-      _channel_enqueue_task (channel, (ChannelTask) _close_procedure, NULL,
-          NULL);
-      return;
+      _channel_fail (channel, "Requested to send data that is too large");
+      return NULL;
     }
 
     buffer = gst_buffer_new_wrapped_full (GST_MEMORY_FLAG_READONLY, data, size,
@@ -819,22 +854,68 @@ gst_webrtc_data_channel_send_data (GstWebRTCDataChannel * channel,
   gst_sctp_buffer_add_send_meta (buffer, ppid, channel->ordered, reliability,
       rel_param);
 
+  return buffer;
+}
+
+static void
+gst_webrtc_data_channel_send_data (GstWebRTCDataChannel * channel,
+    GBytes * bytes)
+{
+  GstBuffer *buffer;
+  GstFlowReturn ret;
+
+  buffer = _buffer_from_bytes (channel, bytes);
+  if (!buffer)
+    return;
+
   GST_LOG_OBJECT (channel, "Sending data using buffer %" GST_PTR_FORMAT,
       buffer);
 
-  CHANNEL_LOCK (channel);
-  channel->buffered_amount += gst_buffer_get_size (buffer);
-  CHANNEL_UNLOCK (channel);
+  _channel_add_buffered_amount (channel, gst_buffer_get_size (buffer));
 
   ret = gst_app_src_push_buffer (GST_APP_SRC (channel->appsrc), buffer);
 
-  if (ret != GST_FLOW_OK) {
-    GError *error = NULL;
-    g_set_error (&error, GST_WEBRTC_BIN_ERROR,
-        GST_WEBRTC_BIN_ERROR_DATA_CHANNEL_FAILURE, "Failed to send data");
-    _channel_store_error (channel, error);
-    _channel_enqueue_task (channel, (ChannelTask) _close_procedure, NULL, NULL);
+  if (ret != GST_FLOW_OK)
+    _channel_fail (channel, "Failed to send data");
+}
+
+static void
+gst_webrtc_data_channel_send_data_list (GstWebRTCDataChannel * channel,
+    GPtrArray * data)
+{
+  GstBufferList *list;
+  guint64 size = 0;
+  GstFlowReturn ret;
+  guint i;
+
+  g_return_if_fail (data != NULL);
+
+  if (data->len == 0)
+    return;
+
+  list = gst_buffer_list_new_sized (data->len);
+  for (i = 0; i < data->len; i++) {
+    GstBuffer *buffer;
+
+    buffer = _buffer_from_bytes (channel, g_ptr_array_index (data, i));
+    if (!buffer) {
+      gst_buffer_list_unref (list);
+      return;
+    }
+
+    size += gst_buffer_get_size (buffer);
+    gst_buffer_list_add (list, buffer);
   }
+
+  GST_LOG_OBJECT (channel, "Sending %u messages of %" G_GUINT64_FORMAT
+      " bytes", data->len, size);
+
+  _channel_add_buffered_amount (channel, size);
+
+  ret = gst_app_src_push_buffer_list (GST_APP_SRC (channel->appsrc), list);
+
+  if (ret != GST_FLOW_OK)
+    _channel_fail (channel, "Failed to send data");
 }
 
 static void
@@ -882,19 +963,12 @@ gst_webrtc_data_channel_send_string (GstWebRTCDataChannel * channel,
   GST_TRACE_OBJECT (channel, "Sending string using buffer %" GST_PTR_FORMAT,
       buffer);
 
-  CHANNEL_LOCK (channel);
-  channel->buffered_amount += gst_buffer_get_size (buffer);
-  CHANNEL_UNLOCK (channel);
+  _channel_add_buffered_amount (channel, gst_buffer_get_size (buffer));
 
   ret = gst_app_src_push_buffer (GST_APP_SRC (channel->appsrc), buffer);
 
-  if (ret != GST_FLOW_OK) {
-    GError *error = NULL;
-    g_set_error (&error, GST_WEBRTC_BIN_ERROR,
-        GST_WEBRTC_BIN_ERROR_DATA_CHANNEL_FAILURE, "Failed to send string");
-    _channel_store_error (channel, error);
-    _channel_enqueue_task (channel, (ChannelTask) _close_procedure, NULL, NULL);
-  }
+  if (ret != GST_FLOW_OK)
+    _channel_fail (channel, "Failed to send string");
 }
 
 static void
@@ -954,6 +1028,9 @@ gst_webrtc_data_channel_set_property (GObject * object, guint prop_id,
     case PROP_BUFFERED_AMOUNT_LOW_THRESHOLD:
       channel->buffered_amount_low_threshold = g_value_get_uint64 (value);
       break;
+    case PROP_BUFFERED_AMOUNT_HIGH_THRESHOLD:
+      channel->buffered_amount_high_threshold = g_value_get_uint64 (value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -1002,6 +1079,9 @@ gst_webrtc_data_channel_get_property (GObject * object, guint prop_id,
     case PROP_BUFFERED_AMOUNT_LOW_THRESHOLD:
       g_value_set_uint64 (value, channel->buffered_amount_low_threshold);
       break;
+    case PROP_BUFFERED_AMOUNT_HIGH_THRESHOLD:
+      g_value_set_uint64 (value, channel->buffered_amount_high_threshold);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -1037,7 +1117,7 @@ on_appsrc_data (GstPad * pad, GstPadProbeInfo * info, gpointer user_data)
     prev_amount = channel->buffered_amount;
     channel->buffered_amount -= size;
     if (prev_amount > channel->buffered_amount_low_threshold &&
-        channel->buffered_amount < channel->buffered_amount_low_threshold) {
+        channel->buffered_amount <= channel->buffered_amount_low_threshold) {
       _channel_enqueue_task (channel, (ChannelTask) _emit_low_threshold,
           NULL, NULL);
     }
@@ -1206,6 +1286,14 @@ gst_webrtc_data_channel_class_init (GstWebRTCDataChannelClass * klass)
           "the buffered-amount-low signal is emitted",
           0, G_MAXUINT64, 0, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+  g_object_class_install_property (gobject_class,
+      PROP_BUFFERED_AMOUNT_HIGH_THRESHOLD,
+      g_param_spec_uint64 ("buffered-amount-high-threshold",
+          "Buffered Amount High Threshold",
+          "The threshold at which the buffered amount is considered high and "
+          "the buffered-amount-high signal is emitted (0 = disabled)",
+          0, G_MAXUINT64, 0, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
   /**
    * GstWebRTCDataChannel::on-open:
    * @object: the #GstWebRTCDataChannel
@@ -1263,6 +1351,20 @@ gst_webrtc_data_channel_class_init (GstWebRTCDataChannelClass * klass)
       G_SIGNAL_RUN_LAST, 0, NULL, NULL, g_cclosure_marshal_generic,
       G_TYPE_NONE, 0);
 
+  /**
+   * GstWebRTCDataChannel::on-buffered-amount-high:
+   * @object: the #GstWebRTCDataChannel
+   *
+   * Emitted when the buffered amount rises to or above
+   * #GstWebRTCDataChannel:buffered-amount-high-threshold. Senders should stop
+   * queueing data until #GstWebRTCDataChannel::on-buffered-amount-low is
+   * emitted.
+   */
+  gst_webrtc_data_channel_signals[SIGNAL_ON_BUFFERED_AMOUNT_HIGH] =
+      g_signal_new ("on-buffered-amount-high", G_TYPE_FROM_CLASS (klass),
+      G_SIGNAL_RUN_LAST, 0, NULL, NULL, g_cclosure_marshal_generic,
+      G_TYPE_NONE, 0);
+
   /**
    * GstWebRTCDataChannel::send-data:
    * @object: the #GstWebRTCDataChannel
@@ -1274,6 +1376,21 @@ gst_webrtc_data_channel_class_init (GstWebRTCDataChannelClass * klass)
       G_CALLBACK (gst_webrtc_data_channel_send_data), NULL, NULL,
       g_cclosure_marshal_generic, G_TYPE_NONE, 1, G_TYPE_BYTES);
 
+  /**
+   * GstWebRTCDataChannel::send-data-list:
+   * @object: the #GstWebRTCDataChannel
+   * @data: (element-type GBytes): a #GPtrArray of #GBytes, each sent as a
+   *     separate message
+   *
+   * Sends several messages at once. The data is not copied, the #GBytes are
+   * referenced until they have been handed to the SCTP stack.
+   */
+  gst_webrtc_data_channel_signals[SIGNAL_SEND_DATA_LIST] =
+      g_signal_new_class_handler ("send-data-list", G_TYPE_FROM_CLASS (klass),
+      G_SIGNAL_RUN_LAST | G_SIGNAL_ACTION,
+      G_CALLBACK (gst_webrtc_data_channel_send_data_list), NULL, NULL,
+      g_cclosure_marshal_generic, G_TYPE_NONE, 1, G_TYPE_PTR_ARRAY);
+
   /**
    * GstWebRTCDataChannel::send-string:
    * @object: the #GstWebRTCDataChannel
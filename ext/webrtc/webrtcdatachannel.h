@@ -58,6 +58,7 @@ struct _GstWebRTCDataChannel
   GstWebRTCDataChannelState         ready_state;
   guint64                           buffered_amount;
   guint64                           buffered_amount_low_threshold;
+  guint64                           buffered_amount_high_threshold;
 
   GstWebRTCBin                     *webrtcbin;
   gboolean                          opened;
@@ -0,0 +1,124 @@
+/* GStreamer Video Library
+ * Copyright (C) 2020 GStreamer developers
+ *
+ * gstvideoanalysemeta.c: metadata with the statistics of a video frame
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/**
+ * SECTION:gstvideoanalysemeta
+ * @title: GstVideoAnalyseMeta
+ * @short_description: Per-frame statistics computed by videoanalyse
+ *
+ * The GstVideoAnalyseMeta carries the statistics of a video frame so that
+ * they travel with the buffer instead of being posted on the bus.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <string.h>
+
+#include "gstvideoanalysemeta.h"
+
+GType
+gst_video_analyse_meta_api_get_type (void)
+{
+  static volatile GType type;
+  static const gchar *tags[] = { NULL };
+
+  if (g_once_init_enter (&type)) {
+    GType _type = gst_meta_api_type_register ("GstVideoAnalyseMetaAPI", tags);
+    g_once_init_leave (&type, _type);
+  }
+  return type;
+}
+
+static gboolean
+gst_video_analyse_meta_init (GstMeta * meta, gpointer params,
+    GstBuffer * buffer)
+{
+  GstVideoAnalyseMeta *analyse_meta = (GstVideoAnalyseMeta *) meta;
+
+  analyse_meta->luma_average = 0.0;
+  analyse_meta->luma_variance = 0.0;
+  analyse_meta->luma_difference = -1.0;
+  analyse_meta->frozen = FALSE;
+  analyse_meta->has_histogram = FALSE;
+
+  return TRUE;
+}
+
+static gboolean
+gst_video_analyse_meta_transform (GstBuffer * dest, GstMeta * meta,
+    GstBuffer * buffer, GQuark type, gpointer data)
+{
+  GstVideoAnalyseMeta *smeta = (GstVideoAnalyseMeta *) meta;
+  GstVideoAnalyseMeta *dmeta;
+
+  /* the statistics only stay valid if the frame content is unchanged */
+  if (!GST_META_TRANSFORM_IS_COPY (type))
+    return FALSE;
+
+  dmeta = gst_buffer_add_video_analyse_meta (dest);
+  if (!dmeta)
+    return FALSE;
+
+  dmeta->luma_average = smeta->luma_average;
+  dmeta->luma_variance = smeta->luma_variance;
+  dmeta->luma_difference = smeta->luma_difference;
+  dmeta->frozen = smeta->frozen;
+  dmeta->has_histogram = smeta->has_histogram;
+  if (smeta->has_histogram)
+    memcpy (dmeta->histogram, smeta->histogram, sizeof (smeta->histogram));
+
+  return TRUE;
+}
+
+const GstMetaInfo *
+gst_video_analyse_meta_get_info (void)
+{
+  static const GstMetaInfo *video_analyse_meta_info = NULL;
+
+  if (g_once_init_enter (&video_analyse_meta_info)) {
+    const GstMetaInfo *meta =
+        gst_meta_register (GST_VIDEO_ANALYSE_META_API_TYPE,
+        "GstVideoAnalyseMeta", sizeof (GstVideoAnalyseMeta),
+        gst_video_analyse_meta_init, (GstMetaFreeFunction) NULL,
+        gst_video_analyse_meta_transform);
+    g_once_init_leave (&video_analyse_meta_info, meta);
+  }
+  return video_analyse_meta_info;
+}
+
+/**
+ * gst_buffer_add_video_analyse_meta:
+ * @buffer: (transfer none): a #GstBuffer
+ *
+ * Attaches an empty #GstVideoAnalyseMeta to @buffer.
+ *
+ * Returns: the added #GstVideoAnalyseMeta
+ */
+GstVideoAnalyseMeta *
+gst_buffer_add_video_analyse_meta (GstBuffer * buffer)
+{
+  g_return_val_if_fail (GST_IS_BUFFER (buffer), NULL);
+
+  return (GstVideoAnalyseMeta *) gst_buffer_add_meta (buffer,
+      GST_VIDEO_ANALYSE_META_INFO, NULL);
+}
@@ -0,0 +1,80 @@
+/* GStreamer Video Library
+ * Copyright (C) 2020 GStreamer developers
+ *
+ * gstvideoanalysemeta.h: metadata with the statistics of a video frame
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __GST_VIDEO_ANALYSE_META_H__
+#define __GST_VIDEO_ANALYSE_META_H__
+
+#ifndef GST_USE_UNSTABLE_API
+#warning "The video analyse meta from gst-plugins-bad is unstable API and may change in future."
+#warning "You can define GST_USE_UNSTABLE_API to avoid this warning."
+#endif
+
+#include <gst/gst.h>
+#include <gst/video/video-bad-prelude.h>
+
+G_BEGIN_DECLS
+
+typedef struct _GstVideoAnalyseMeta GstVideoAnalyseMeta;
+
+/**
+ * GstVideoAnalyseMeta:
+ * @meta: The parent #GstMeta.
+ * @luma_average: the average brightness of the frame. Range: 0.0-1.0
+ * @luma_variance: the brightness variance of the frame.
+ * @luma_difference: the average absolute brightness difference with the
+ *   previous frame. Range: 0.0-1.0, or -1.0 if not computed.
+ * @frozen: whether the frame was detected as a repeat of the previous one.
+ * @has_histogram: whether @histogram is filled in.
+ * @histogram: number of analysed pixels for each luma value.
+ *
+ * Metadata attached to each buffer by videoanalyse when its
+ * #GstVideoAnalyse:meta property is %TRUE.
+ */
+struct _GstVideoAnalyseMeta {
+  GstMeta meta;
+
+  gdouble luma_average;
+  gdouble luma_variance;
+  gdouble luma_difference;
+  gboolean frozen;
+
+  gboolean has_histogram;
+  guint32 histogram[256];
+};
+
+GST_VIDEO_BAD_API
+GType gst_video_analyse_meta_api_get_type (void);
+#define GST_VIDEO_ANALYSE_META_API_TYPE (gst_video_analyse_meta_api_get_type())
+
+#define gst_buffer_get_video_analyse_meta(b) \
+    ((GstVideoAnalyseMeta*)gst_buffer_get_meta ((b), GST_VIDEO_ANALYSE_META_API_TYPE))
+
+#define GST_VIDEO_ANALYSE_META_INFO (gst_video_analyse_meta_get_info())
+
+GST_VIDEO_BAD_API
+const GstMetaInfo * gst_video_analyse_meta_get_info (void);
+
+GST_VIDEO_BAD_API
+GstVideoAnalyseMeta * gst_buffer_add_video_analyse_meta (GstBuffer * buffer);
+
+G_END_DECLS
+
+#endif /* __GST_VIDEO_ANALYSE_META_H__ */
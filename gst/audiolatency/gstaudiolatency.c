@@ -23,10 +23,11 @@
  * @title: audiolatency
  *
  * Measures the audio latency between the source pad and the sink pad by
- * outputting period ticks on the source pad and measuring how long they take to
- * arrive on the sink pad.
+ * outputting periodic probes on the source pad and measuring how long they
+ * take to arrive on the sink pad.
  *
- * The ticks have a period of 1 second, so this element can only measure
+ * The probes are short chirps sent every #GstAudioLatency:probe-interval
+ * milliseconds (1 second by default), so this element can only measure
  * latencies smaller than that.
  *
  * ## Example pipeline
@@ -49,12 +50,31 @@
  * "average-latency" fields in the GstStructure.
  *
  * The average latency is a running average of the last 5 measurements.
+ *
+ * By default a probe is detected when its amplitude crosses a fixed
+ * threshold, which requires the loopback to keep the signal loud. Setting
+ * #GstAudioLatency:detection to correlation instead matches the received
+ * signal against the probe waveform with a normalized cross-correlation, which
+ * does not depend on the gain (or polarity) of the loopback path.
+ *
+ * To tune for the tail rather than the average, set
+ * #GstAudioLatency:stats-interval. A "latency-stats" element message is then
+ * posted for every interval, with the number of probes "sent" and "received",
+ * the "min", "max" and "average" latencies and their "p50", "p90" and "p99"
+ * percentiles, all in microseconds, and a "histogram" array counting the
+ * latencies in 1 millisecond buckets.
+ *
+ * The loopback does not have to be a device: anything that plays back what
+ * comes out of the source pad in real time and feeds it into the sink pad
+ * will do, such as an appsink whose samples are pushed into an appsrc.
  */
 
 #ifdef HAVE_CONFIG_H
 #include "config.h"
 #endif
 
+#include <math.h>
+
 #include "gstaudiolatency.h"
 
 #define AUDIOLATENCY_CAPS "audio/x-raw, " \
@@ -82,14 +102,52 @@ static GstStaticPadTemplate sink_template = GST_STATIC_PAD_TEMPLATE ("sink",
 G_DEFINE_TYPE (GstAudioLatency, gst_audiolatency, GST_TYPE_BIN);
 
 #define DEFAULT_PRINT_LATENCY   FALSE
+#define DEFAULT_PROBE_INTERVAL  1000
+#define DEFAULT_DETECTION       GST_AUDIOLATENCY_DETECTION_THRESHOLD
+#define DEFAULT_STATS_INTERVAL  0
 enum
 {
   PROP_0,
   PROP_PRINT_LATENCY,
   PROP_LAST_LATENCY,
-  PROP_AVERAGE_LATENCY
+  PROP_AVERAGE_LATENCY,
+  PROP_PROBE_INTERVAL,
+  PROP_DETECTION,
+  PROP_STATS_INTERVAL
 };
 
+/* The probe is a linear chirp, whose autocorrelation has a single sharp
+ * peak */
+#define PROBE_DURATION_MS 5
+#define PROBE_AMPLITUDE 0.8
+#define PROBE_START_FREQ 1000.0
+#define PROBE_END_FREQ 4000.0
+
+/* Normalized cross-correlation above which the probe is detected */
+#define CORRELATION_THRESHOLD 0.6
+/* Below this energy the window is considered silent */
+#define MIN_ENERGY 1e-9
+
+#define GST_TYPE_AUDIOLATENCY_DETECTION (gst_audiolatency_detection_get_type ())
+static GType
+gst_audiolatency_detection_get_type (void)
+{
+  static GType detection_type = 0;
+  static const GEnumValue detection[] = {
+    {GST_AUDIOLATENCY_DETECTION_THRESHOLD,
+        "Amplitude crossing a fixed threshold", "threshold"},
+    {GST_AUDIOLATENCY_DETECTION_CORRELATION,
+        "Normalized cross-correlation with the probe", "correlation"},
+    {0, NULL, NULL},
+  };
+
+  if (!detection_type) {
+    detection_type =
+        g_enum_register_static ("GstAudioLatencyDetection", detection);
+  }
+  return detection_type;
+}
+
 static gint64 gst_audiolatency_get_latency (GstAudioLatency * self);
 static gint64 gst_audiolatency_get_average_latency (GstAudioLatency * self);
 static GstFlowReturn gst_audiolatency_sink_chain (GstPad * pad,
@@ -113,6 +171,15 @@ gst_audiolatency_get_property (GObject * object,
     case PROP_AVERAGE_LATENCY:
       g_value_set_int64 (value, gst_audiolatency_get_average_latency (self));
       break;
+    case PROP_PROBE_INTERVAL:
+      g_value_set_int (value, self->probe_interval);
+      break;
+    case PROP_DETECTION:
+      g_value_set_enum (value, self->detection);
+      break;
+    case PROP_STATS_INTERVAL:
+      g_value_set_int (value, self->stats_interval);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -129,12 +196,36 @@ gst_audiolatency_set_property (GObject * object,
     case PROP_PRINT_LATENCY:
       self->print_latency = g_value_get_boolean (value);
       break;
+    case PROP_PROBE_INTERVAL:
+      self->probe_interval = g_value_get_int (value);
+      break;
+    case PROP_DETECTION:
+      self->detection = g_value_get_enum (value);
+      break;
+    case PROP_STATS_INTERVAL:
+      GST_OBJECT_LOCK (self);
+      self->stats_interval = g_value_get_int (value);
+      self->interval_start = 0;
+      GST_OBJECT_UNLOCK (self);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
   }
 }
 
+static void
+gst_audiolatency_finalize (GObject * object)
+{
+  GstAudioLatency *self = GST_AUDIOLATENCY (object);
+
+  g_free (self->probe_template);
+  g_array_free (self->window, TRUE);
+  g_array_free (self->interval_latencies, TRUE);
+
+  G_OBJECT_CLASS (parent_class)->finalize (object);
+}
+
 static void
 gst_audiolatency_class_init (GstAudioLatencyClass * klass)
 {
@@ -143,6 +234,7 @@ gst_audiolatency_class_init (GstAudioLatencyClass * klass)
 
   gobject_class->get_property = gst_audiolatency_get_property;
   gobject_class->set_property = gst_audiolatency_set_property;
+  gobject_class->finalize = gst_audiolatency_finalize;
 
   g_object_class_install_property (gobject_class, PROP_PRINT_LATENCY,
       g_param_spec_boolean ("print-latency", "Print latencies",
@@ -159,6 +251,24 @@ gst_audiolatency_class_init (GstAudioLatencyClass * klass)
           "The running average latency, in microseconds", 0,
           G_USEC_PER_SEC, 0, G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
 
+  g_object_class_install_property (gobject_class, PROP_PROBE_INTERVAL,
+      g_param_spec_int ("probe-interval", "Probe interval",
+          "Time between two probes, in milliseconds. Only latencies smaller "
+          "than this can be measured", 10, 1000, DEFAULT_PROBE_INTERVAL,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_DETECTION,
+      g_param_spec_enum ("detection", "Detection",
+          "How probes are detected on the sink pad",
+          GST_TYPE_AUDIOLATENCY_DETECTION, DEFAULT_DETECTION,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_STATS_INTERVAL,
+      g_param_spec_int ("stats-interval", "Statistics interval",
+          "Interval at which latency-stats messages are posted, in "
+          "milliseconds (0 = disabled)", 0, G_MAXINT, DEFAULT_STATS_INTERVAL,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
   gst_element_class_add_static_pad_template (gstelement_class, &src_template);
   gst_element_class_add_static_pad_template (gstelement_class, &sink_template);
 
@@ -174,9 +284,14 @@ gst_audiolatency_init (GstAudioLatency * self)
   GstPad *srcpad;
   GstPadTemplate *templ;
 
-  self->send_pts = 0;
   self->recv_pts = 0;
+  self->probe_pos = G_MAXINT;
+  self->window = g_array_new (FALSE, FALSE, sizeof (gfloat));
+  self->interval_latencies = g_array_new (FALSE, FALSE, sizeof (gint64));
   self->print_latency = DEFAULT_PRINT_LATENCY;
+  self->probe_interval = DEFAULT_PROBE_INTERVAL;
+  self->detection = DEFAULT_DETECTION;
+  self->stats_interval = DEFAULT_STATS_INTERVAL;
 
   /* Setup sinkpad */
   self->sinkpad = gst_pad_new_from_static_template (&sink_template, "sink");
@@ -186,7 +301,8 @@ gst_audiolatency_init (GstAudioLatency * self)
 
   /* Setup srcpad */
   self->audiosrc = gst_element_factory_make ("audiotestsrc", NULL);
-  g_object_set (self->audiosrc, "wave", 8, "samplesperbuffer", 240, NULL);
+  /* Silence, the probes are written into it by the pad probe */
+  g_object_set (self->audiosrc, "wave", 4, "samplesperbuffer", 240, NULL);
   gst_bin_add (GST_BIN (self), self->audiosrc);
 
   templ = gst_static_pad_template_get (&src_template);
@@ -254,6 +370,8 @@ gst_audiolatency_set_latency (GstAudioLatency * self, gint64 latency)
 
   GST_OBJECT_LOCK (self);
   self->latencies[self->next_latency_idx] = latency;
+  if (self->stats_interval > 0)
+    g_array_append_val (self->interval_latencies, latency);
 
   /* Increment index, with wrap-around */
   self->next_latency_idx += 1;
@@ -274,6 +392,263 @@ gst_audiolatency_set_latency (GstAudioLatency * self, gint64 latency)
               "average-latency", G_TYPE_INT64, avg_latency, NULL)));
 }
 
+static gint
+compare_latencies (gconstpointer a, gconstpointer b)
+{
+  gint64 la = *(const gint64 *) a, lb = *(const gint64 *) b;
+
+  return (la > lb) - (la < lb);
+}
+
+/* Nearest-rank percentile of the @n sorted @latencies */
+static gint64
+percentile (const gint64 * latencies, guint n, guint p)
+{
+  guint rank = (n * p + 99) / 100;
+
+  return latencies[CLAMP (rank, 1, n) - 1];
+}
+
+/* Posts the latency-stats message once the current stats interval is over.
+ * Called from the sink streaming thread. */
+static void
+gst_audiolatency_update_stats (GstAudioLatency * self, gint64 now)
+{
+  GstStructure *s;
+  GValue histogram = G_VALUE_INIT;
+  GValue v = G_VALUE_INIT;
+  gint64 *latencies, min = 0, max = 0, average = 0, p50 = 0, p90 = 0, p99 = 0;
+  guint ii, n, sent, n_buckets, *buckets;
+
+  GST_OBJECT_LOCK (self);
+  if (self->stats_interval == 0) {
+    GST_OBJECT_UNLOCK (self);
+    return;
+  }
+
+  if (self->interval_start == 0) {
+    self->interval_start = now;
+    self->interval_sent = 0;
+    g_array_set_size (self->interval_latencies, 0);
+    GST_OBJECT_UNLOCK (self);
+    return;
+  }
+
+  if (now - self->interval_start < (gint64) self->stats_interval * 1000) {
+    GST_OBJECT_UNLOCK (self);
+    return;
+  }
+
+  g_array_sort (self->interval_latencies, compare_latencies);
+  latencies = (gint64 *) self->interval_latencies->data;
+  n = self->interval_latencies->len;
+  sent = self->interval_sent;
+
+  g_value_init (&histogram, GST_TYPE_ARRAY);
+  g_value_init (&v, G_TYPE_UINT);
+
+  if (n > 0) {
+    min = latencies[0];
+    max = latencies[n - 1];
+    for (ii = 0; ii < n; ii++)
+      average += latencies[ii];
+    average /= n;
+    p50 = percentile (latencies, n, 50);
+    p90 = percentile (latencies, n, 90);
+    p99 = percentile (latencies, n, 99);
+
+    n_buckets = max / 1000 + 1;
+    buckets = g_new0 (guint, n_buckets);
+    for (ii = 0; ii < n; ii++)
+      buckets[latencies[ii] / 1000]++;
+    for (ii = 0; ii < n_buckets; ii++) {
+      g_value_set_uint (&v, buckets[ii]);
+      gst_value_array_append_value (&histogram, &v);
+    }
+    g_free (buckets);
+  }
+
+  self->interval_start = now;
+  self->interval_sent = 0;
+  g_array_set_size (self->interval_latencies, 0);
+
+  if (self->print_latency)
+    g_print ("%u/%u probes, latency min: %" G_GINT64_FORMAT "us, average: %"
+        G_GINT64_FORMAT "us, p50: %" G_GINT64_FORMAT "us, p90: %"
+        G_GINT64_FORMAT "us, p99: %" G_GINT64_FORMAT "us, max: %"
+        G_GINT64_FORMAT "us\n", n, sent, min, average, p50, p90, p99, max);
+  GST_OBJECT_UNLOCK (self);
+
+  s = gst_structure_new ("latency-stats", "sent", G_TYPE_UINT, sent,
+      "received", G_TYPE_UINT, n, "min", G_TYPE_INT64, min,
+      "max", G_TYPE_INT64, max, "average", G_TYPE_INT64, average,
+      "p50", G_TYPE_INT64, p50, "p90", G_TYPE_INT64, p90,
+      "p99", G_TYPE_INT64, p99, NULL);
+  gst_structure_take_value (s, "histogram", &histogram);
+  g_value_unset (&v);
+
+  gst_element_post_message (GST_ELEMENT (self),
+      gst_message_new_element (GST_OBJECT (self), s));
+}
+
+static gint
+gst_audiolatency_probe_len (gint rate)
+{
+  return MAX (rate * PROBE_DURATION_MS / 1000, 16);
+}
+
+/* Sample @pos of the probe at @rate. The chirp starts at its full amplitude,
+ * so threshold detection fires on its first sample. */
+static gfloat
+gst_audiolatency_probe_sample (gint pos, gint rate)
+{
+  gdouble f0 = PROBE_START_FREQ;
+  gdouble f1 = MIN (PROBE_END_FREQ, rate / 4.0);
+  gdouble d = gst_audiolatency_probe_len (rate) / (gdouble) rate;
+  gdouble t = pos / (gdouble) rate;
+
+  return PROBE_AMPLITUDE * cos (2 * G_PI * (f0 * t + (f1 - f0) * t * t /
+          (2 * d)));
+}
+
+static gboolean
+get_format (GstPad * pad, gint * rate, gint * channels)
+{
+  const GstStructure *s;
+  GstCaps *caps;
+  gboolean ret;
+
+  caps = gst_pad_get_current_caps (pad);
+  if (!caps)
+    return FALSE;
+
+  s = gst_caps_get_structure (caps, 0);
+  ret = gst_structure_get_int (s, "rate", rate) &&
+      gst_structure_get_int (s, "channels", channels);
+  gst_caps_unref (caps);
+
+  return ret;
+}
+
+static void
+gst_audiolatency_add_send (GstAudioLatency * self, gint64 send_time)
+{
+  GST_OBJECT_LOCK (self);
+  self->send_times[self->next_send_idx] = send_time;
+  self->next_send_idx = (self->next_send_idx + 1) % GST_AUDIOLATENCY_NUM_SENDS;
+  self->interval_sent++;
+  GST_OBJECT_UNLOCK (self);
+}
+
+/* The most recent probe sent before @recv_time, or 0 if there is none */
+static gint64
+gst_audiolatency_find_send (GstAudioLatency * self, gint64 recv_time)
+{
+  gint64 send_time = 0;
+  gint ii;
+
+  GST_OBJECT_LOCK (self);
+  for (ii = 0; ii < GST_AUDIOLATENCY_NUM_SENDS; ii++) {
+    if (self->send_times[ii] <= recv_time && self->send_times[ii] > send_time)
+      send_time = self->send_times[ii];
+  }
+  GST_OBJECT_UNLOCK (self);
+
+  return send_time;
+}
+
+/* Slides the probe over the first channel of @buffer, continuing from the
+ * samples kept from the previous buffers, and returns in @recv_time the time
+ * at which the best matching position started. The peak is only reported once
+ * a whole probe length went by without a better match, which may be in a
+ * later buffer. */
+static gboolean
+gst_audiolatency_correlate (GstAudioLatency * self, GstBuffer * buffer,
+    GstPad * pad, gint64 now, gint64 * recv_time)
+{
+  GstMapInfo minfo;
+  const gfloat *fdata;
+  gfloat *window;
+  gint rate, channels, hist, len, n, fsize, ii, p;
+  gdouble energy, dot, ncc;
+  gboolean found = FALSE;
+
+  if (!get_format (pad, &rate, &channels)) {
+    GST_WARNING_OBJECT (pad, "unknown format, can't detect probe");
+    return FALSE;
+  }
+
+  if (rate != self->template_rate) {
+    n = gst_audiolatency_probe_len (rate);
+    g_free (self->probe_template);
+    self->probe_template = g_new (gfloat, n);
+    self->template_energy = 0;
+    for (ii = 0; ii < n; ii++) {
+      self->probe_template[ii] = gst_audiolatency_probe_sample (ii, rate);
+      self->template_energy +=
+          self->probe_template[ii] * self->probe_template[ii];
+    }
+    self->template_len = n;
+    self->template_rate = rate;
+    g_array_set_size (self->window, 0);
+    self->peak_ncc = 0;
+  }
+
+  if (!gst_buffer_map (buffer, &minfo, GST_MAP_READ)) {
+    GST_WARNING_OBJECT (pad, "failed to map buffer %" GST_PTR_FORMAT, buffer);
+    return FALSE;
+  }
+
+  hist = self->window->len;
+  fdata = (const gfloat *) minfo.data;
+  fsize = minfo.size / sizeof (gfloat);
+  for (ii = 0; ii < fsize; ii += channels)
+    g_array_append_val (self->window, fdata[ii]);
+  gst_buffer_unmap (buffer, &minfo);
+
+  window = (gfloat *) self->window->data;
+  len = self->window->len;
+  n = self->template_len;
+  if (len < n)
+    return FALSE;
+
+  energy = 0;
+  for (ii = 0; ii < n - 1; ii++)
+    energy += window[ii] * window[ii];
+
+  for (p = 0; p + n <= len; p++) {
+    energy += window[p + n - 1] * window[p + n - 1];
+
+    ncc = 0;
+    if (energy > MIN_ENERGY) {
+      dot = 0;
+      for (ii = 0; ii < n; ii++)
+        dot += window[p + ii] * self->probe_template[ii];
+      /* independent of the gain, and of the polarity */
+      ncc = ABS (dot) / sqrt (energy * self->template_energy);
+    }
+
+    if (ncc > CORRELATION_THRESHOLD && ncc > self->peak_ncc) {
+      self->peak_ncc = ncc;
+      self->peak_time = now + (gint64) (p - hist) * G_USEC_PER_SEC / rate;
+      self->peak_age = 0;
+    } else if (self->peak_ncc > 0 && ++self->peak_age >= n) {
+      GST_DEBUG_OBJECT (self, "probe detected, correlation %f",
+          self->peak_ncc);
+      *recv_time = self->peak_time;
+      self->peak_ncc = 0;
+      found = TRUE;
+    }
+
+    energy -= window[p] * window[p];
+  }
+
+  /* keep what the next buffer needs to complete the last positions */
+  g_array_remove_range (self->window, 0, len - n + 1);
+
+  return found;
+}
+
 static gint64
 buffer_has_wave (GstBuffer * buffer, GstPad * pad)
 {
@@ -344,7 +719,10 @@ gst_audiolatency_src_probe (GstPad * pad, GstPadProbeInfo * info,
 {
   GstAudioLatency *self = user_data;
   GstBuffer *buffer;
-  gint64 pts, offset;
+  GstMapInfo minfo;
+  gfloat *fdata;
+  gint64 now;
+  gint ii, c, rate, channels, n_frames, probe_len, interval;
 
   if (!(info->type & GST_PAD_PROBE_TYPE_BUFFER))
     goto out;
@@ -354,28 +732,56 @@ gst_audiolatency_src_probe (GstPad * pad, GstPadProbeInfo * info,
 
   GST_TRACE ("audiotestsrc pushed out a buffer");
 
-  pts = g_get_monotonic_time ();
-  /* Ticks are once a second, so once we send something, we can skip
-   * checking ~1sec of buffers till the next one. */
-  if (self->send_pts > 0 && pts - self->send_pts <= 950 * 1000)
+  now = g_get_monotonic_time ();
+
+  if (!get_format (pad, &rate, &channels)) {
+    GST_WARNING_OBJECT (pad, "unknown format, can't send probes");
     goto out;
+  }
 
-  /* Check if buffer contains a waveform */
   buffer = gst_pad_probe_info_get_buffer (info);
-  offset = buffer_has_wave (buffer, pad);
-  if (offset < 0)
+  n_frames = gst_buffer_get_size (buffer) / (sizeof (gfloat) * channels);
+  probe_len = gst_audiolatency_probe_len (rate);
+
+  /* Nothing to write in this buffer */
+  if (self->probe_pos >= probe_len && self->samples_to_probe >= n_frames) {
+    self->samples_to_probe -= n_frames;
+    goto out;
+  }
+
+  buffer = gst_buffer_make_writable (buffer);
+  GST_PAD_PROBE_INFO_DATA (info) = buffer;
+
+  if (!gst_buffer_map (buffer, &minfo, GST_MAP_WRITE)) {
+    GST_WARNING_OBJECT (pad, "failed to map buffer %" GST_PTR_FORMAT, buffer);
     goto out;
+  }
+
+  fdata = (gfloat *) minfo.data;
+  interval = gst_util_uint64_scale_int (rate, self->probe_interval, 1000);
+  for (ii = 0; ii < n_frames; ii++) {
+    if (self->samples_to_probe <= 0) {
+      gint64 send_time = now + (gint64) ii * G_USEC_PER_SEC / rate;
+
+      GST_INFO ("send pts: %" G_GINT64_FORMAT "us (offset %d frames)",
+          send_time, ii);
+      gst_audiolatency_add_send (self, send_time);
+
+      self->probe_pos = 0;
+      self->samples_to_probe = interval;
+    }
+    self->samples_to_probe--;
 
-  pts -= offset;
-  {
-    gint64 after = 0;
-    if (self->send_pts > 0)
-      after = (pts - self->send_pts) / 1000;
-    GST_INFO ("send pts: %" G_GINT64_FORMAT "us (after %" G_GINT64_FORMAT
-        "ms, offset %" G_GINT64_FORMAT "ms)", pts, after, offset / 1000);
+    if (self->probe_pos < probe_len) {
+      gfloat value = gst_audiolatency_probe_sample (self->probe_pos, rate);
+
+      for (c = 0; c < channels; c++)
+        fdata[ii * channels + c] = value;
+      self->probe_pos++;
+    }
   }
 
-  self->send_pts = pts + offset;
+  gst_buffer_unmap (buffer, &minfo);
 
 out:
   return GST_PAD_PROBE_OK;
@@ -386,28 +792,45 @@ gst_audiolatency_sink_chain (GstPad * pad, GstObject * parent,
     GstBuffer * buffer)
 {
   GstAudioLatency *self = GST_AUDIOLATENCY (parent);
-  gint64 latency, offset, pts;
+  gint64 latency, offset, pts, send_pts, recv_pts, holdoff;
 
   /* Ignore buffers till something gets sent out by us. Fixes a bug where we'd
    * start out by printing one garbage latency value on Windows. */
-  if (self->send_pts == 0)
+  if (gst_audiolatency_find_send (self, G_MAXINT64) == 0)
     goto out;
 
   GST_TRACE_OBJECT (pad, "Got buffer %p", buffer);
 
   pts = g_get_monotonic_time ();
-  /* Ticks are once a second, so once we receive something, we can skip
-   * checking ~1sec of buffers till the next one. This way we also don't count
-   * the same tick twice for latency measurement. */
-  if (self->recv_pts > 0 && pts - self->recv_pts <= 950 * 1000)
-    goto out;
+  gst_audiolatency_update_stats (self, pts);
+
+  /* Once we receive a probe, we can skip the next ~probe-interval of buffers.
+   * This way we also don't count the same probe twice for latency
+   * measurement. */
+  holdoff = (gint64) self->probe_interval * 950;
+
+  if (self->detection == GST_AUDIOLATENCY_DETECTION_CORRELATION) {
+    /* every buffer is needed to keep the correlation window contiguous */
+    if (!gst_audiolatency_correlate (self, buffer, pad, pts, &recv_pts))
+      goto out;
+    if (self->recv_pts > 0 && recv_pts - self->recv_pts <= holdoff)
+      goto out;
+  } else {
+    if (self->recv_pts > 0 && pts - self->recv_pts <= holdoff)
+      goto out;
+
+    offset = buffer_has_wave (buffer, pad);
+    if (offset < 0)
+      goto out;
+    recv_pts = pts + offset;
+  }
 
-  offset = buffer_has_wave (buffer, pad);
-  if (offset < 0)
+  send_pts = gst_audiolatency_find_send (self, recv_pts);
+  if (send_pts == 0)
     goto out;
 
-  self->recv_pts = pts + offset;
-  latency = (self->recv_pts - self->send_pts);
+  self->recv_pts = recv_pts;
+  latency = (self->recv_pts - send_pts);
   gst_audiolatency_set_latency (self, latency);
 
   GST_INFO ("recv pts: %" G_GINT64_FORMAT "us, latency: %" G_GINT64_FORMAT "ms",
@@ -38,6 +38,13 @@ typedef struct _GstAudioLatency GstAudioLatency;
 typedef struct _GstAudioLatencyClass GstAudioLatencyClass;
 
 #define GST_AUDIOLATENCY_NUM_LATENCIES 5
+#define GST_AUDIOLATENCY_NUM_SENDS 4
+
+typedef enum
+{
+  GST_AUDIOLATENCY_DETECTION_THRESHOLD,
+  GST_AUDIOLATENCY_DETECTION_CORRELATION
+} GstAudioLatencyDetection;
 
 struct _GstAudioLatency
 {
@@ -49,13 +56,36 @@ struct _GstAudioLatency
   GstElement *audiosrc;
 
   /* measurements */
-  gint64 send_pts;
+  gint64 send_times[GST_AUDIOLATENCY_NUM_SENDS];
+  gint next_send_idx;
   gint64 recv_pts;
   gint next_latency_idx;
   gint latencies[GST_AUDIOLATENCY_NUM_LATENCIES];
 
+  /* probe generation, in the source streaming thread */
+  gint samples_to_probe;
+  gint probe_pos;
+
+  /* correlation detection, in the sink streaming thread */
+  gfloat *probe_template;
+  gint template_len;
+  gint template_rate;
+  gdouble template_energy;
+  GArray *window;
+  gdouble peak_ncc;
+  gint64 peak_time;
+  gint peak_age;
+
+  /* statistics over the current stats interval */
+  GArray *interval_latencies;
+  guint interval_sent;
+  gint64 interval_start;
+
   /* properties */
   gboolean print_latency;
+  gint probe_interval;
+  GstAudioLatencyDetection detection;
+  gint stats_interval;
 };
 
 struct _GstAudioLatencyClass
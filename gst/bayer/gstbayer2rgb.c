@@ -26,6 +26,20 @@
  * @title: bayer2rgb
  *
  * Decodes raw camera bayer (fourcc BA81) to RGB.
+ *
+ * Besides 8-bit bayer, 16-bit little and big endian samples (for example
+ * from 10 or 12-bit machine vision sensors) are accepted, and can be output
+ * at full precision as ARGB64.  Samples with fewer significant bits are
+ * expected in the low bits, with #GstBayer2RGB:input-bits telling how many
+ * of them are used.  The #GstBayer2RGB:method property selects
+ * between plain bilinear interpolation and gradient-corrected interpolation,
+ * which gives noticeably less colour fringing on edges at a higher CPU cost.
+ * The frame can be split into bands processed in parallel by setting
+ * #GstBayer2RGB:n-threads.
+ *
+ * Rows and columns beyond the edges of the image are mirrored for the
+ * interpolation, the last row is interpolated from the row above it on both
+ * sides just like the first row is from the row below it.
  */
 
 /*
@@ -99,6 +113,12 @@ enum
   GST_BAYER_2_RGB_FORMAT_RGGB
 };
 
+typedef enum
+{
+  GST_BAYER_2_RGB_METHOD_BILINEAR = 0,
+  GST_BAYER_2_RGB_METHOD_GRADIENT
+} GstBayer2RGBMethod;
+
 
 #define GST_TYPE_BAYER2RGB            (gst_bayer2rgb_get_type())
 #define GST_BAYER2RGB(obj)            (G_TYPE_CHECK_INSTANCE_CAST((obj),GST_TYPE_BAYER2RGB,GstBayer2RGB))
@@ -122,7 +142,23 @@ struct _GstBayer2RGB
   int r_off;                    /* offset for red */
   int g_off;                    /* offset for green */
   int b_off;                    /* offset for blue */
+  int a_off;                    /* offset for alpha / padding */
   int format;
+  int in_depth;                 /* bits per bayer sample, 8 or 16 */
+  gboolean in_big_endian;
+  int out_depth;                /* bits per output component, 8 or 16 */
+  int out_pstride;
+
+  /* properties */
+  GstBayer2RGBMethod method;
+  guint n_threads;
+  guint input_bits;
+
+  /* slice threading */
+  GThreadPool *pool;
+  GMutex slice_lock;
+  GCond slice_cond;
+  guint slices_pending;
 };
 
 struct _GstBayer2RGBClass
@@ -130,17 +166,61 @@ struct _GstBayer2RGBClass
   GstBaseTransformClass parent;
 };
 
+/* One horizontal band of the output image, processed by one thread */
+typedef struct
+{
+  GstBayer2RGB *filter;
+  guint8 *dest;
+  int dest_stride;
+  const guint8 *src;
+  int src_stride;
+  int start;
+  int end;
+  GstBayer2RGBMethod method;
+  int depth;                    /* significant bits per bayer sample */
+} GstBayer2RGBSlice;
+
 #define	SRC_CAPS                                 \
-  GST_VIDEO_CAPS_MAKE ("{ RGBx, xRGB, BGRx, xBGR, RGBA, ARGB, BGRA, ABGR }")
+  GST_VIDEO_CAPS_MAKE ("{ RGBx, xRGB, BGRx, xBGR, RGBA, ARGB, BGRA, ABGR, ARGB64 }")
 
-#define SINK_CAPS "video/x-bayer,format=(string){bggr,grbg,gbrg,rggb}," \
+#define SINK_CAPS "video/x-bayer,format=(string){bggr,grbg,gbrg,rggb," \
+  "bggr16le,bggr16be,grbg16le,grbg16be,gbrg16le,gbrg16be,rggb16le,rggb16be}," \
   "width=(int)[1,MAX],height=(int)[1,MAX],framerate=(fraction)[0/1,MAX]"
 
+#define DEFAULT_METHOD GST_BAYER_2_RGB_METHOD_BILINEAR
+#define DEFAULT_N_THREADS 1
+#define DEFAULT_INPUT_BITS 0
+
 enum
 {
-  PROP_0
+  PROP_0,
+  PROP_METHOD,
+  PROP_N_THREADS,
+  PROP_INPUT_BITS
 };
 
+#define GST_TYPE_BAYER2RGB_METHOD (gst_bayer2rgb_method_get_type())
+static GType
+gst_bayer2rgb_method_get_type (void)
+{
+  static GType bayer2rgb_method_type = 0;
+
+  if (!bayer2rgb_method_type) {
+    static const GEnumValue methods[] = {
+      {GST_BAYER_2_RGB_METHOD_BILINEAR, "Bilinear interpolation",
+          "bilinear"},
+      {GST_BAYER_2_RGB_METHOD_GRADIENT,
+            "Gradient-corrected linear interpolation (Malvar-He-Cutler)",
+          "gradient"},
+      {0, NULL, NULL},
+    };
+
+    bayer2rgb_method_type =
+        g_enum_register_static ("GstBayer2RGBMethod", methods);
+  }
+  return bayer2rgb_method_type;
+}
+
 GType gst_bayer2rgb_get_type (void);
 
 #define gst_bayer2rgb_parent_class parent_class
@@ -150,6 +230,7 @@ static void gst_bayer2rgb_set_property (GObject * object, guint prop_id,
     const GValue * value, GParamSpec * pspec);
 static void gst_bayer2rgb_get_property (GObject * object, guint prop_id,
     GValue * value, GParamSpec * pspec);
+static void gst_bayer2rgb_finalize (GObject * object);
 
 static gboolean gst_bayer2rgb_set_caps (GstBaseTransform * filter,
     GstCaps * incaps, GstCaps * outcaps);
@@ -160,6 +241,7 @@ static GstCaps *gst_bayer2rgb_transform_caps (GstBaseTransform * base,
     GstPadDirection direction, GstCaps * caps, GstCaps * filter);
 static gboolean gst_bayer2rgb_get_unit_size (GstBaseTransform * base,
     GstCaps * caps, gsize * size);
+static void gst_bayer2rgb_slice_func (gpointer data, gpointer user_data);
 
 
 static void
@@ -173,6 +255,22 @@ gst_bayer2rgb_class_init (GstBayer2RGBClass * klass)
 
   gobject_class->set_property = gst_bayer2rgb_set_property;
   gobject_class->get_property = gst_bayer2rgb_get_property;
+  gobject_class->finalize = gst_bayer2rgb_finalize;
+
+  g_object_class_install_property (gobject_class, PROP_METHOD,
+      g_param_spec_enum ("method", "Method", "Demosaicing method",
+          GST_TYPE_BAYER2RGB_METHOD, DEFAULT_METHOD,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+  g_object_class_install_property (gobject_class, PROP_N_THREADS,
+      g_param_spec_uint ("n-threads", "Threads",
+          "Maximum number of threads to use (0 = number of processors)", 0,
+          G_MAXUINT, DEFAULT_N_THREADS,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+  g_object_class_install_property (gobject_class, PROP_INPUT_BITS,
+      g_param_spec_uint ("input-bits", "Input bits",
+          "Number of significant low bits in 16-bit bayer samples "
+          "(0 = all 16)", 0, 16, DEFAULT_INPUT_BITS,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
   gst_element_class_set_static_metadata (gstelement_class,
       "Bayer to RGB decoder for cameras", "Filter/Converter/Video",
@@ -202,17 +300,51 @@ gst_bayer2rgb_class_init (GstBayer2RGBClass * klass)
 static void
 gst_bayer2rgb_init (GstBayer2RGB * filter)
 {
+  filter->method = DEFAULT_METHOD;
+  filter->n_threads = DEFAULT_N_THREADS;
+  filter->input_bits = DEFAULT_INPUT_BITS;
+  g_mutex_init (&filter->slice_lock);
+  g_cond_init (&filter->slice_cond);
+
   gst_bayer2rgb_reset (filter);
   gst_base_transform_set_in_place (GST_BASE_TRANSFORM (filter), TRUE);
 }
 
-/* No properties are implemented, so only a warning is produced */
+static void
+gst_bayer2rgb_finalize (GObject * object)
+{
+  GstBayer2RGB *filter = GST_BAYER2RGB (object);
+
+  if (filter->pool)
+    g_thread_pool_free (filter->pool, FALSE, TRUE);
+  g_mutex_clear (&filter->slice_lock);
+  g_cond_clear (&filter->slice_cond);
+
+  G_OBJECT_CLASS (parent_class)->finalize (object);
+}
+
 static void
 gst_bayer2rgb_set_property (GObject * object, guint prop_id,
     const GValue * value, GParamSpec * pspec)
 {
+  GstBayer2RGB *filter = GST_BAYER2RGB (object);
 
   switch (prop_id) {
+    case PROP_METHOD:
+      GST_OBJECT_LOCK (filter);
+      filter->method = g_value_get_enum (value);
+      GST_OBJECT_UNLOCK (filter);
+      break;
+    case PROP_N_THREADS:
+      GST_OBJECT_LOCK (filter);
+      filter->n_threads = g_value_get_uint (value);
+      GST_OBJECT_UNLOCK (filter);
+      break;
+    case PROP_INPUT_BITS:
+      GST_OBJECT_LOCK (filter);
+      filter->input_bits = g_value_get_uint (value);
+      GST_OBJECT_UNLOCK (filter);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -223,14 +355,72 @@ static void
 gst_bayer2rgb_get_property (GObject * object, guint prop_id,
     GValue * value, GParamSpec * pspec)
 {
+  GstBayer2RGB *filter = GST_BAYER2RGB (object);
 
   switch (prop_id) {
+    case PROP_METHOD:
+      GST_OBJECT_LOCK (filter);
+      g_value_set_enum (value, filter->method);
+      GST_OBJECT_UNLOCK (filter);
+      break;
+    case PROP_N_THREADS:
+      GST_OBJECT_LOCK (filter);
+      g_value_set_uint (value, filter->n_threads);
+      GST_OBJECT_UNLOCK (filter);
+      break;
+    case PROP_INPUT_BITS:
+      GST_OBJECT_LOCK (filter);
+      g_value_set_uint (value, filter->input_bits);
+      GST_OBJECT_UNLOCK (filter);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
   }
 }
 
+/* Parses a bayer format string such as "grbg" or "rggb16le" */
+static gboolean
+gst_bayer2rgb_parse_format (const gchar * format, int *pattern, int *depth,
+    gboolean * big_endian)
+{
+  if (format == NULL || strlen (format) < 4)
+    return FALSE;
+
+  if (g_str_has_prefix (format, "bggr")) {
+    *pattern = GST_BAYER_2_RGB_FORMAT_BGGR;
+  } else if (g_str_has_prefix (format, "gbrg")) {
+    *pattern = GST_BAYER_2_RGB_FORMAT_GBRG;
+  } else if (g_str_has_prefix (format, "grbg")) {
+    *pattern = GST_BAYER_2_RGB_FORMAT_GRBG;
+  } else if (g_str_has_prefix (format, "rggb")) {
+    *pattern = GST_BAYER_2_RGB_FORMAT_RGGB;
+  } else {
+    return FALSE;
+  }
+
+  if (format[4] == '\0') {
+    *depth = 8;
+    *big_endian = FALSE;
+  } else if (g_str_equal (format + 4, "16le")) {
+    *depth = 16;
+    *big_endian = FALSE;
+  } else if (g_str_equal (format + 4, "16be")) {
+    *depth = 16;
+    *big_endian = TRUE;
+  } else {
+    return FALSE;
+  }
+
+  return TRUE;
+}
+
+static int
+gst_bayer2rgb_src_stride (int width, int depth)
+{
+  return GST_ROUND_UP_4 (width * (depth / 8));
+}
+
 static gboolean
 gst_bayer2rgb_set_caps (GstBaseTransform * base, GstCaps * incaps,
     GstCaps * outcaps)
@@ -249,23 +439,21 @@ gst_bayer2rgb_set_caps (GstBaseTransform * base, GstCaps * incaps,
   gst_structure_get_int (structure, "height", &bayer2rgb->height);
 
   format = gst_structure_get_string (structure, "format");
-  if (g_str_equal (format, "bggr")) {
-    bayer2rgb->format = GST_BAYER_2_RGB_FORMAT_BGGR;
-  } else if (g_str_equal (format, "gbrg")) {
-    bayer2rgb->format = GST_BAYER_2_RGB_FORMAT_GBRG;
-  } else if (g_str_equal (format, "grbg")) {
-    bayer2rgb->format = GST_BAYER_2_RGB_FORMAT_GRBG;
-  } else if (g_str_equal (format, "rggb")) {
-    bayer2rgb->format = GST_BAYER_2_RGB_FORMAT_RGGB;
-  } else {
+  if (!gst_bayer2rgb_parse_format (format, &bayer2rgb->format,
+          &bayer2rgb->in_depth, &bayer2rgb->in_big_endian))
     return FALSE;
-  }
 
   /* To cater for different RGB formats, we need to set params for later */
-  gst_video_info_from_caps (&info, outcaps);
+  if (!gst_video_info_from_caps (&info, outcaps))
+    return FALSE;
   bayer2rgb->r_off = GST_VIDEO_INFO_COMP_OFFSET (&info, 0);
   bayer2rgb->g_off = GST_VIDEO_INFO_COMP_OFFSET (&info, 1);
   bayer2rgb->b_off = GST_VIDEO_INFO_COMP_OFFSET (&info, 2);
+  bayer2rgb->out_depth = GST_VIDEO_INFO_COMP_DEPTH (&info, 0);
+  bayer2rgb->out_pstride = GST_VIDEO_INFO_COMP_PSTRIDE (&info, 0);
+  /* The alpha (or padding) component takes whichever slot is left over */
+  bayer2rgb->a_off = (bayer2rgb->out_depth == 16 ? 12 : 6) -
+      bayer2rgb->r_off - bayer2rgb->g_off - bayer2rgb->b_off;
 
   bayer2rgb->info = info;
 
@@ -280,6 +468,11 @@ gst_bayer2rgb_reset (GstBayer2RGB * filter)
   filter->r_off = 0;
   filter->g_off = 0;
   filter->b_off = 0;
+  filter->a_off = 0;
+  filter->in_depth = 8;
+  filter->in_big_endian = FALSE;
+  filter->out_depth = 8;
+  filter->out_pstride = 4;
   gst_video_info_init (&filter->info);
 }
 
@@ -326,19 +519,29 @@ gst_bayer2rgb_get_unit_size (GstBaseTransform * base, GstCaps * caps,
   int width;
   int height;
   const char *name;
+  const char *format;
 
   structure = gst_caps_get_structure (caps, 0);
 
   if (gst_structure_get_int (structure, "width", &width) &&
       gst_structure_get_int (structure, "height", &height)) {
     name = gst_structure_get_name (structure);
+    format = gst_structure_get_string (structure, "format");
     /* Our name must be either video/x-bayer video/x-raw */
     if (strcmp (name, "video/x-raw")) {
-      *size = GST_ROUND_UP_4 (width) * height;
+      int pattern, depth;
+      gboolean big_endian;
+
+      if (!gst_bayer2rgb_parse_format (format, &pattern, &depth, &big_endian))
+        depth = 8;
+      *size = gst_bayer2rgb_src_stride (width, depth) * height;
       return TRUE;
     } else {
-      /* For output, calculate according to format (always 32 bits) */
-      *size = width * height * 4;
+      /* For output, calculate according to format (32 or 64 bits) */
+      if (format && g_str_equal (format, "ARGB64"))
+        *size = width * height * 8;
+      else
+        *size = width * height * 4;
       return TRUE;
     }
 
@@ -381,9 +584,10 @@ typedef void (*process_func) (guint8 * d0, const guint8 * s0, const guint8 * s1,
     const guint8 * s2, const guint8 * s3, const guint8 * s4, const guint8 * s5,
     int n);
 
+/* 8-bit bilinear path, using the orc merge functions */
 static void
 gst_bayer2rgb_process (GstBayer2RGB * bayer2rgb, uint8_t * dest,
-    int dest_stride, uint8_t * src, int src_stride)
+    int dest_stride, const uint8_t * src, int src_stride, int start, int end)
 {
   int j;
   guint8 *tmp;
@@ -426,16 +630,23 @@ gst_bayer2rgb_process (GstBayer2RGB * bayer2rgb, uint8_t * dest,
   tmp = g_malloc (2 * 4 * bayer2rgb->width);
 #define LINE(x) (tmp + ((x)&7) * bayer2rgb->width)
 
-  gst_bayer2rgb_split_and_upsample_horiz (LINE (3 * 2 + 0), LINE (3 * 2 + 1),
-      src + 1 * src_stride, bayer2rgb->width);
-  j = 0;
+  /* Prime the line ring with the row above the slice (mirrored at the top
+   * edge) and the first row of the slice */
+  j = (start == 0) ? 1 : start - 1;
+  gst_bayer2rgb_split_and_upsample_horiz (LINE (start * 2 - 2),
+      LINE (start * 2 - 1), src + j * src_stride, bayer2rgb->width);
+  j = start;
   gst_bayer2rgb_split_and_upsample_horiz (LINE (j * 2 + 0), LINE (j * 2 + 1),
       src + j * src_stride, bayer2rgb->width);
 
-  for (j = 0; j < bayer2rgb->height; j++) {
+  for (j = start; j < end; j++) {
     if (j < bayer2rgb->height - 1) {
       gst_bayer2rgb_split_and_upsample_horiz (LINE ((j + 1) * 2 + 0),
           LINE ((j + 1) * 2 + 1), src + (j + 1) * src_stride, bayer2rgb->width);
+    } else if (j > 0) {
+      /* mirror the row above at the bottom edge */
+      gst_bayer2rgb_split_and_upsample_horiz (LINE ((j + 1) * 2 + 0),
+          LINE ((j + 1) * 2 + 1), src + (j - 1) * src_stride, bayer2rgb->width);
     }
 
     merge[j & 1] (dest + j * dest_stride,
@@ -443,12 +654,280 @@ gst_bayer2rgb_process (GstBayer2RGB * bayer2rgb, uint8_t * dest,
         LINE (j * 2 + 0), LINE (j * 2 + 1),
         LINE (j * 2 + 2), LINE (j * 2 + 3), bayer2rgb->width >> 1);
   }
+#undef LINE
+
+  g_free (tmp);
+}
+
+/* Reflects @x into [0, n - 1] without repeating the edge sample, which keeps
+ * the bayer phase intact */
+static inline int
+gst_bayer2rgb_mirror (int x, int n)
+{
+  if (x < 0)
+    x = -x;
+  if (x >= n)
+    x = 2 * (n - 1) - x;
+  return CLAMP (x, 0, n - 1);
+}
+
+/* Unpacks one bayer row into @line, which has two mirrored samples of
+ * padding on either side. */
+static void
+gst_bayer2rgb_unpack_line (GstBayer2RGB * filter, gint32 * line,
+    const guint8 * src, int src_stride, int row)
+{
+  const guint8 *s;
+  int i, width = filter->width;
+  gint32 *l = line + 2;
+
+  s = src + gst_bayer2rgb_mirror (row, filter->height) * src_stride;
+
+  if (filter->in_depth == 8) {
+    for (i = 0; i < width; i++)
+      l[i] = s[i];
+  } else if (filter->in_big_endian) {
+    for (i = 0; i < width; i++)
+      l[i] = GST_READ_UINT16_BE (s + 2 * i);
+  } else {
+    for (i = 0; i < width; i++)
+      l[i] = GST_READ_UINT16_LE (s + 2 * i);
+  }
+
+  l[-2] = l[gst_bayer2rgb_mirror (-2, width)];
+  l[-1] = l[gst_bayer2rgb_mirror (-1, width)];
+  l[width] = l[gst_bayer2rgb_mirror (width, width)];
+  l[width + 1] = l[gst_bayer2rgb_mirror (width + 1, width)];
+}
+
+/* Interpolates one output row from the five input rows around it.  @c1 is the
+ * plane of the non-green colour present on this row, @c2 the other one.
+ * Each loop handles one pixel class at a stride of two so that it is free of
+ * branches and can be vectorized by the compiler. */
+static void
+gst_bayer2rgb_interpolate_line (GstBayer2RGBMethod method, gint32 * c1,
+    gint32 * g, gint32 * c2, gint32 * const l[5], int x0, int width)
+{
+  const gint32 *nn = l[0], *n = l[1], *c = l[2], *s = l[3], *ss = l[4];
+  int x;
+
+  if (method == GST_BAYER_2_RGB_METHOD_GRADIENT) {
+    /* Kernels from H. S. Malvar, L. He and R. Cutler, "High-quality linear
+     * interpolation for demosaicing of Bayer-patterned color images",
+     * ICASSP 2004, scaled to a common denominator of 16. */
+    for (x = x0; x < width; x += 2) {
+      c1[x] = c[x] << 4;
+      g[x] = 8 * c[x] + 4 * (n[x] + s[x] + c[x - 1] + c[x + 1])
+          - 2 * (nn[x] + ss[x] + c[x - 2] + c[x + 2]);
+      c2[x] = 12 * c[x] + 4 * (n[x - 1] + n[x + 1] + s[x - 1] + s[x + 1])
+          - 3 * (nn[x] + ss[x] + c[x - 2] + c[x + 2]);
+    }
+    for (x = x0 ^ 1; x < width; x += 2) {
+      g[x] = c[x] << 4;
+      c1[x] = 10 * c[x] + 8 * (c[x - 1] + c[x + 1])
+          - 2 * (c[x - 2] + c[x + 2] + n[x - 1] + n[x + 1] + s[x - 1] +
+          s[x + 1]) + (nn[x] + ss[x]);
+      c2[x] = 10 * c[x] + 8 * (n[x] + s[x])
+          - 2 * (nn[x] + ss[x] + n[x - 1] + n[x + 1] + s[x - 1] + s[x + 1])
+          + (c[x - 2] + c[x + 2]);
+    }
+  } else {
+    for (x = x0; x < width; x += 2) {
+      c1[x] = c[x] << 4;
+      g[x] = (n[x] + s[x] + c[x - 1] + c[x + 1]) << 2;
+      c2[x] = (n[x - 1] + n[x + 1] + s[x - 1] + s[x + 1]) << 2;
+    }
+    for (x = x0 ^ 1; x < width; x += 2) {
+      g[x] = c[x] << 4;
+      c1[x] = (c[x - 1] + c[x + 1]) << 3;
+      c2[x] = (n[x] + s[x]) << 3;
+    }
+  }
+}
+
+/* Generic path: any method, 8 or 16 bit input, 8 or 16 bit output */
+static void
+gst_bayer2rgb_process_generic (GstBayer2RGB * filter, guint8 * dest,
+    int dest_stride, const guint8 * src, int src_stride, int start, int end,
+    GstBayer2RGBMethod method, int depth)
+{
+  int width = filter->width;
+  int i, j, x;
+  int bx, by;
+  gint32 *tmp, *ring[5], *lines[5], *r, *g, *b;
+  gint32 maxval, down, up;
+
+  /* position of the blue sample in the 2x2 bayer cell */
+  switch (filter->format) {
+    case GST_BAYER_2_RGB_FORMAT_GBRG:
+      bx = 1;
+      by = 0;
+      break;
+    case GST_BAYER_2_RGB_FORMAT_GRBG:
+      bx = 0;
+      by = 1;
+      break;
+    case GST_BAYER_2_RGB_FORMAT_RGGB:
+      bx = 1;
+      by = 1;
+      break;
+    case GST_BAYER_2_RGB_FORMAT_BGGR:
+    default:
+      bx = 0;
+      by = 0;
+      break;
+  }
+
+  /* interpolated values carry 4 extra fractional bits, which are rounded
+   * away before clamping to the significant bits and scaling those to the
+   * output depth */
+  maxval = (1 << depth) - 1;
+  down = depth - 8;
+  up = 16 - depth;
+
+  tmp = g_malloc (sizeof (gint32) * (5 * (width + 4) + 3 * width));
+  for (i = 0; i < 5; i++)
+    ring[i] = tmp + i * (width + 4);
+  r = tmp + 5 * (width + 4);
+  g = r + width;
+  b = g + width;
+
+  for (j = start - 2; j < start + 2; j++)
+    gst_bayer2rgb_unpack_line (filter, ring[(j + 5) % 5], src, src_stride, j);
+
+  for (j = start; j < end; j++) {
+    guint8 *d = dest + j * dest_stride;
+    int py = (j ^ by) & 1;
+
+    gst_bayer2rgb_unpack_line (filter, ring[(j + 2 + 5) % 5], src, src_stride,
+        j + 2);
+    for (i = 0; i < 5; i++)
+      lines[i] = ring[(j - 2 + i + 5) % 5] + 2;
+
+    if (py == 0)
+      gst_bayer2rgb_interpolate_line (method, b, g, r, lines, bx, width);
+    else
+      gst_bayer2rgb_interpolate_line (method, r, g, b, lines, bx ^ 1, width);
+
+    if (filter->out_depth == 8) {
+      for (x = 0; x < width; x++) {
+        d[filter->r_off] = CLAMP ((r[x] + 8) >> 4, 0, maxval) >> down;
+        d[filter->g_off] = CLAMP ((g[x] + 8) >> 4, 0, maxval) >> down;
+        d[filter->b_off] = CLAMP ((b[x] + 8) >> 4, 0, maxval) >> down;
+        d[filter->a_off] = 0xff;
+        d += 4;
+      }
+    } else {
+      /* the high bits are replicated into the low ones, so that the full
+       * input range maps to the full output range */
+      for (x = 0; x < width; x++) {
+        guint16 *d16 = (guint16 *) d;
+        gint32 rv = CLAMP ((r[x] + 8) >> 4, 0, maxval);
+        gint32 gv = CLAMP ((g[x] + 8) >> 4, 0, maxval);
+        gint32 bv = CLAMP ((b[x] + 8) >> 4, 0, maxval);
+
+        d16[filter->r_off / 2] = (rv << up) | (rv >> (depth - up));
+        d16[filter->g_off / 2] = (gv << up) | (gv >> (depth - up));
+        d16[filter->b_off / 2] = (bv << up) | (bv >> (depth - up));
+        d16[filter->a_off / 2] = 0xffff;
+        d += 8;
+      }
+    }
+  }
 
   g_free (tmp);
 }
 
+static void
+gst_bayer2rgb_process_slice (GstBayer2RGBSlice * slice)
+{
+  GstBayer2RGB *filter = slice->filter;
+
+  if (slice->method == GST_BAYER_2_RGB_METHOD_BILINEAR &&
+      filter->in_depth == 8 && filter->out_depth == 8) {
+    gst_bayer2rgb_process (filter, slice->dest, slice->dest_stride,
+        slice->src, slice->src_stride, slice->start, slice->end);
+  } else {
+    gst_bayer2rgb_process_generic (filter, slice->dest, slice->dest_stride,
+        slice->src, slice->src_stride, slice->start, slice->end,
+        slice->method, slice->depth);
+  }
+}
+
+static void
+gst_bayer2rgb_slice_func (gpointer data, gpointer user_data)
+{
+  GstBayer2RGB *filter = user_data;
+
+  gst_bayer2rgb_process_slice (data);
+
+  g_mutex_lock (&filter->slice_lock);
+  if (--filter->slices_pending == 0)
+    g_cond_signal (&filter->slice_cond);
+  g_mutex_unlock (&filter->slice_lock);
+}
+
+/* Splits the frame into horizontal bands of an even number of rows and
+ * processes them in parallel, the calling thread taking the first band. */
+static void
+gst_bayer2rgb_process_frame (GstBayer2RGB * filter, guint8 * dest,
+    int dest_stride, const guint8 * src, int src_stride)
+{
+  GstBayer2RGBSlice *slices;
+  GstBayer2RGBMethod method;
+  guint n_threads, n_slices, i;
+  int rows, depth;
+
+  GST_OBJECT_LOCK (filter);
+  n_threads = filter->n_threads;
+  method = filter->method;
+  depth = filter->in_depth;
+  if (depth == 16 && filter->input_bits >= 8)
+    depth = filter->input_bits;
+  GST_OBJECT_UNLOCK (filter);
+
+  if (n_threads == 0)
+    n_threads = g_get_num_processors ();
+  /* no point in bands of less than a handful of rows */
+  n_slices = MIN (n_threads, MAX (filter->height / 16, 1));
+
+  rows = GST_ROUND_UP_2 ((filter->height + n_slices - 1) / n_slices);
+  slices = g_newa (GstBayer2RGBSlice, n_slices);
+  for (i = 0; i < n_slices; i++) {
+    slices[i].filter = filter;
+    slices[i].dest = dest;
+    slices[i].dest_stride = dest_stride;
+    slices[i].src = src;
+    slices[i].src_stride = src_stride;
+    slices[i].start = MIN (i * rows, filter->height);
+    slices[i].end = MIN ((i + 1) * rows, filter->height);
+    slices[i].method = method;
+    slices[i].depth = depth;
+  }
 
+  if (n_slices > 1) {
+    if (filter->pool == NULL) {
+      filter->pool = g_thread_pool_new (gst_bayer2rgb_slice_func, filter,
+          n_slices - 1, FALSE, NULL);
+    } else if (g_thread_pool_get_max_threads (filter->pool) <
+        (gint) n_slices - 1) {
+      g_thread_pool_set_max_threads (filter->pool, n_slices - 1, NULL);
+    }
+
+    filter->slices_pending = n_slices - 1;
+    for (i = 1; i < n_slices; i++)
+      g_thread_pool_push (filter->pool, &slices[i], NULL);
+  }
 
+  gst_bayer2rgb_process_slice (&slices[0]);
+
+  if (n_slices > 1) {
+    g_mutex_lock (&filter->slice_lock);
+    while (filter->slices_pending > 0)
+      g_cond_wait (&filter->slice_cond, &filter->slice_lock);
+    g_mutex_unlock (&filter->slice_lock);
+  }
+}
 
 static GstFlowReturn
 gst_bayer2rgb_transform (GstBaseTransform * base, GstBuffer * inbuf,
@@ -470,8 +949,8 @@ gst_bayer2rgb_transform (GstBaseTransform * base, GstBuffer * inbuf,
   }
 
   output = GST_VIDEO_FRAME_PLANE_DATA (&frame, 0);
-  gst_bayer2rgb_process (filter, output, frame.info.stride[0],
-      map.data, GST_ROUND_UP_4 (filter->width));
+  gst_bayer2rgb_process_frame (filter, output, frame.info.stride[0],
+      map.data, gst_bayer2rgb_src_stride (filter->width, filter->in_depth));
 
   gst_video_frame_unmap (&frame);
   gst_buffer_unmap (inbuf, &map);
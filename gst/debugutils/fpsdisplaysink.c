@@ -23,6 +23,39 @@
  *
  * Can display the current and average framerate as a testoverlay or on stdout.
  *
+ * Besides the framerate, the latency of every buffer is measured as the time
+ * between its running time and its rendering by the video sink, on the
+ * pipeline clock, along with its jitter: how much the spacing of renderings
+ * differs from the spacing of running times.
+ *
+ * With #GstFPSDisplaySink:sync enabled, a buffer is rendered at its running
+ * time plus the configured pipeline latency, or later when it arrived late.
+ * How late is taken from the QoS events the video sink sends after rendering
+ * every buffer, so QoS has to be enabled on it, which is the default for
+ * video sinks. Without sync, buffers are rendered as soon as they arrive and
+ * their arrival at the video sink is used instead. For every update interval the
+ * minimum, average, median, 99th percentile and maximum latency, the average
+ * and maximum jitter and a cumulative jitter histogram are put in a
+ * structure that is passed to the #GstFPSDisplaySink::fps-stats signal when
+ * #GstFPSDisplaySink:signal-fps-measurements is set, and posted in an
+ * element message when #GstFPSDisplaySink:post-messages is set.
+ *
+ * The "fps-stats" structure has these fields:
+ *
+ * * "fps", "drop-rate", "average-fps" (gdouble): as for
+ *   #GstFPSDisplaySink::fps-measurements
+ * * "frames-rendered", "frames-dropped" (guint64)
+ * * "latency-min", "latency-avg", "latency-p50", "latency-p99",
+ *   "latency-max" (gint64): in nanoseconds, negative when buffers are
+ *   rendered ahead of their running time, which only happens without sync.
+ *   Only present when latencies were measured during the interval.
+ * * "jitter-avg", "jitter-max" (guint64): in nanoseconds
+ * * "jitter-histogram" (#GstValueArray of guint64): bucket 0 counts jitter
+ *   below 1us and bucket n jitter in [2^(n-1), 2^n) us
+ *
+ * For headless load tests, set #GstFPSDisplaySink:text-overlay to %FALSE and
+ * use a fakesink or fakevideosink as #GstFPSDisplaySink:video-sink.
+ *
  * ## Example launch lines
  * |[
  * gst-launch-1.0 videotestsrc ! fpsdisplaysink
@@ -47,6 +80,8 @@
 #include "config.h"
 #endif
 
+#include <string.h>
+
 #include "fpsdisplaysink.h"
 
 #define DEFAULT_SIGNAL_FPS_MEASUREMENTS FALSE
@@ -54,6 +89,7 @@
 #define DEFAULT_FONT "Sans 15"
 #define DEFAULT_SILENT FALSE
 #define DEFAULT_LAST_MESSAGE NULL
+#define DEFAULT_POST_MESSAGES FALSE
 
 /* generic templates */
 static GstStaticPadTemplate fps_display_sink_template =
@@ -71,6 +107,7 @@ enum
 {
   /* FILL ME */
   SIGNAL_FPS_MEASUREMENTS,
+  SIGNAL_FPS_STATS,
   LAST_SIGNAL
 };
 
@@ -87,7 +124,8 @@ enum
   PROP_FRAMES_DROPPED,
   PROP_FRAMES_RENDERED,
   PROP_SILENT,
-  PROP_LAST_MESSAGE
+  PROP_LAST_MESSAGE,
+  PROP_POST_MESSAGES
       /* FILL ME */
 };
 
@@ -95,11 +133,14 @@ static GstBinClass *parent_class = NULL;
 
 static GstStateChangeReturn fps_display_sink_change_state (GstElement * element,
     GstStateChange transition);
+static gboolean fps_display_sink_send_event (GstElement * element,
+    GstEvent * event);
 static void fps_display_sink_set_property (GObject * object, guint prop_id,
     const GValue * value, GParamSpec * pspec);
 static void fps_display_sink_get_property (GObject * object, guint prop_id,
     GValue * value, GParamSpec * pspec);
 static void fps_display_sink_dispose (GObject * object);
+static void fps_display_sink_finalize (GObject * object);
 static void fps_display_sink_handle_message (GstBin * bin,
     GstMessage * message);
 
@@ -121,6 +162,7 @@ fps_display_sink_class_init (GstFPSDisplaySinkClass * klass)
   gobject_klass->set_property = fps_display_sink_set_property;
   gobject_klass->get_property = fps_display_sink_get_property;
   gobject_klass->dispose = fps_display_sink_dispose;
+  gobject_klass->finalize = fps_display_sink_finalize;
 
   bin_class->handle_message = fps_display_sink_handle_message;
 
@@ -183,6 +225,20 @@ fps_display_sink_class_init (GstFPSDisplaySinkClass * klass)
           DEFAULT_SIGNAL_FPS_MEASUREMENTS,
           G_PARAM_STATIC_STRINGS | G_PARAM_READWRITE));
 
+  /**
+   * GstFPSDisplaySink:post-messages:
+   *
+   * Post an element message named "fps-stats" with the latency, jitter and
+   * framerate statistics after every update interval.
+   *
+   * Since: 1.18
+   */
+  g_object_class_install_property (gobject_klass, PROP_POST_MESSAGES,
+      g_param_spec_boolean ("post-messages", "Post Messages",
+          "Post an element message with the statistics of every update "
+          "interval", DEFAULT_POST_MESSAGES,
+          G_PARAM_STATIC_STRINGS | G_PARAM_READWRITE));
+
   pspec_last_message = g_param_spec_string ("last-message", "Last Message",
       "The message describing current status", DEFAULT_LAST_MESSAGE,
       G_PARAM_READABLE | G_PARAM_STATIC_STRINGS);
@@ -203,7 +259,23 @@ fps_display_sink_class_init (GstFPSDisplaySinkClass * klass)
       G_SIGNAL_RUN_LAST, 0, NULL, NULL, NULL,
       G_TYPE_NONE, 3, G_TYPE_DOUBLE, G_TYPE_DOUBLE, G_TYPE_DOUBLE);
 
+  /**
+   * GstFPSDisplaySink::fps-stats:
+   * @fpsdisplaysink: a #GstFPSDisplaySink
+   * @stats: a #GstStructure with the statistics of the last interval
+   *
+   * Signals the application about the measured fps, latency and jitter,
+   * see the element documentation for the fields of @stats.
+   *
+   * Since: 1.18
+   */
+  fpsdisplaysink_signals[SIGNAL_FPS_STATS] =
+      g_signal_new ("fps-stats", G_TYPE_FROM_CLASS (klass),
+      G_SIGNAL_RUN_LAST, 0, NULL, NULL, NULL,
+      G_TYPE_NONE, 1, GST_TYPE_STRUCTURE | G_SIGNAL_TYPE_STATIC_SCOPE);
+
   gstelement_klass->change_state = fps_display_sink_change_state;
+  gstelement_klass->send_event = fps_display_sink_send_event;
 
   gst_element_class_add_static_pad_template (gstelement_klass,
       &fps_display_sink_template);
@@ -214,6 +286,95 @@ fps_display_sink_class_init (GstFPSDisplaySinkClass * klass)
       "Zeeshan Ali <zeeshan.ali@nokia.com>, Stefan Kost <stefan.kost@nokia.com>");
 }
 
+static void
+fps_display_sink_reset_stats (GstFPSDisplaySink * self)
+{
+  g_array_set_size (self->latencies, 0);
+  self->last_render_time = GST_CLOCK_TIME_NONE;
+  self->last_running_time = GST_CLOCK_TIME_NONE;
+  self->jitter_sum = 0;
+  self->jitter_max = 0;
+  self->jitter_count = 0;
+}
+
+/* Records the latency and jitter of a buffer with @running_time rendered at
+ * @render_time */
+static void
+fps_display_sink_record (GstFPSDisplaySink * self, GstClockTime running_time,
+    GstClockTime render_time)
+{
+  GstClockTime jitter;
+  GstClockTimeDiff latency;
+  guint bucket;
+
+  latency = GST_CLOCK_DIFF (running_time, render_time);
+  g_array_append_val (self->latencies, latency);
+
+  if (GST_CLOCK_TIME_IS_VALID (self->last_render_time)) {
+    jitter = ABS (GST_CLOCK_DIFF (self->last_render_time, render_time) -
+        GST_CLOCK_DIFF (self->last_running_time, running_time));
+
+    self->jitter_sum += jitter;
+    self->jitter_max = MAX (self->jitter_max, jitter);
+    self->jitter_count++;
+
+    bucket = g_bit_storage (jitter / GST_USECOND);
+    if (jitter < GST_USECOND)
+      bucket = 0;
+    self->jitter_histogram[MIN (bucket, FPS_DISPLAY_SINK_JITTER_BUCKETS - 1)]++;
+  }
+
+  self->last_render_time = render_time;
+  self->last_running_time = running_time;
+}
+
+/* Without sync, a buffer with @pts arriving now is rendered right away */
+static void
+fps_display_sink_measure_arrival (GstFPSDisplaySink * self, GstClockTime pts)
+{
+  GstClock *clock;
+  GstClockTime running_time, arrival;
+
+  if (self->segment.format != GST_FORMAT_TIME || !GST_CLOCK_TIME_IS_VALID (pts))
+    return;
+
+  running_time = gst_segment_to_running_time (&self->segment, GST_FORMAT_TIME,
+      pts);
+  if (!GST_CLOCK_TIME_IS_VALID (running_time))
+    return;
+
+  clock = gst_element_get_clock (GST_ELEMENT_CAST (self));
+  if (clock == NULL)
+    return;
+  arrival = gst_clock_get_time (clock) -
+      gst_element_get_base_time (GST_ELEMENT_CAST (self));
+  gst_object_unref (clock);
+
+  fps_display_sink_record (self, running_time, arrival);
+}
+
+/* With sync, the video sink sends a QoS event after rendering every buffer,
+ * with its running time and how late it was rendered against its running
+ * time plus the latency */
+static void
+fps_display_sink_measure_qos (GstFPSDisplaySink * self, GstEvent * event)
+{
+  GstClockTimeDiff diff;
+  GstClockTime timestamp, latency;
+
+  gst_event_parse_qos (event, NULL, NULL, &diff, &timestamp);
+  if (!GST_CLOCK_TIME_IS_VALID (timestamp))
+    return;
+
+  GST_OBJECT_LOCK (self);
+  latency = self->latency;
+  GST_OBJECT_UNLOCK (self);
+
+  /* early buffers were waited for */
+  fps_display_sink_record (self, timestamp,
+      timestamp + latency + MAX (diff, 0));
+}
+
 static GstPadProbeReturn
 on_video_sink_data_flow (GstPad * pad, GstPadProbeInfo * info,
     gpointer user_data)
@@ -221,9 +382,24 @@ on_video_sink_data_flow (GstPad * pad, GstPadProbeInfo * info,
   GstMiniObject *mini_obj = GST_PAD_PROBE_INFO_DATA (info);
   GstFPSDisplaySink *self = GST_FPS_DISPLAY_SINK (user_data);
 
-  if (GST_IS_BUFFER (mini_obj)) {
+  if (GST_IS_EVENT (mini_obj)) {
+    GstEvent *event = GST_EVENT_CAST (mini_obj);
+
+    if (GST_EVENT_TYPE (event) == GST_EVENT_SEGMENT) {
+      gst_event_copy_segment (event, &self->segment);
+      self->last_render_time = GST_CLOCK_TIME_NONE;
+    } else if (GST_EVENT_TYPE (event) == GST_EVENT_FLUSH_STOP) {
+      gst_segment_init (&self->segment, GST_FORMAT_UNDEFINED);
+      self->last_render_time = GST_CLOCK_TIME_NONE;
+    } else if (GST_EVENT_TYPE (event) == GST_EVENT_QOS && self->sync) {
+      fps_display_sink_measure_qos (self, event);
+    }
+  } else if (GST_IS_BUFFER (mini_obj)) {
     GstClockTime ts;
 
+    if (!self->sync)
+      fps_display_sink_measure_arrival (self, GST_BUFFER_PTS (mini_obj));
+
     /* assume the frame is going to be rendered. If it isnt', we'll get a qos
      * message and reset ->frames_rendered from there.
      */
@@ -336,11 +512,70 @@ fps_display_sink_init (GstFPSDisplaySink * self,
   self->min_fps = -1;
   self->silent = DEFAULT_SILENT;
   self->last_message = g_strdup (DEFAULT_LAST_MESSAGE);
+  self->post_messages = DEFAULT_POST_MESSAGES;
+
+  self->latencies = g_array_new (FALSE, FALSE, sizeof (GstClockTimeDiff));
+  gst_segment_init (&self->segment, GST_FORMAT_UNDEFINED);
 
   self->ghost_pad = gst_ghost_pad_new_no_target ("sink", GST_PAD_SINK);
   gst_element_add_pad (GST_ELEMENT (self), self->ghost_pad);
 }
 
+static gint
+compare_latency (gconstpointer a, gconstpointer b)
+{
+  GstClockTimeDiff la = *(const GstClockTimeDiff *) a;
+  GstClockTimeDiff lb = *(const GstClockTimeDiff *) b;
+
+  return la < lb ? -1 : la > lb ? 1 : 0;
+}
+
+static GstStructure *
+fps_display_sink_build_stats (GstFPSDisplaySink * self, gdouble rr,
+    gdouble dr, gdouble average_fps, guint64 frames_rendered,
+    guint64 frames_dropped)
+{
+  GstStructure *s;
+  GValue histogram = G_VALUE_INIT;
+  GValue v = G_VALUE_INIT;
+  guint i, n = self->latencies->len;
+
+  s = gst_structure_new ("fps-stats", "fps", G_TYPE_DOUBLE, rr,
+      "drop-rate", G_TYPE_DOUBLE, dr, "average-fps", G_TYPE_DOUBLE,
+      average_fps, "frames-rendered", G_TYPE_UINT64, frames_rendered,
+      "frames-dropped", G_TYPE_UINT64, frames_dropped, NULL);
+
+  if (n > 0) {
+    GstClockTimeDiff *lat = (GstClockTimeDiff *) self->latencies->data;
+    GstClockTimeDiff sum = 0;
+
+    g_array_sort (self->latencies, compare_latency);
+    for (i = 0; i < n; i++)
+      sum += lat[i];
+
+    gst_structure_set (s, "latency-min", G_TYPE_INT64, lat[0],
+        "latency-avg", G_TYPE_INT64, sum / (GstClockTimeDiff) n,
+        "latency-p50", G_TYPE_INT64, lat[(n - 1) / 2],
+        "latency-p99", G_TYPE_INT64, lat[(n - 1) * 99 / 100],
+        "latency-max", G_TYPE_INT64, lat[n - 1], NULL);
+  }
+
+  gst_structure_set (s, "jitter-avg", G_TYPE_UINT64,
+      self->jitter_count ? self->jitter_sum / self->jitter_count : 0,
+      "jitter-max", G_TYPE_UINT64, self->jitter_max, NULL);
+
+  g_value_init (&histogram, GST_TYPE_ARRAY);
+  g_value_init (&v, G_TYPE_UINT64);
+  for (i = 0; i < FPS_DISPLAY_SINK_JITTER_BUCKETS; i++) {
+    g_value_set_uint64 (&v, self->jitter_histogram[i]);
+    gst_value_array_append_value (&histogram, &v);
+  }
+  gst_structure_take_value (s, "jitter-histogram", &histogram);
+  g_value_unset (&v);
+
+  return s;
+}
+
 static gboolean
 display_current_fps (gpointer data)
 {
@@ -384,6 +619,32 @@ display_current_fps (gpointer data)
         average_fps);
   }
 
+  if (self->signal_measurements || self->post_messages) {
+    GstStructure *stats;
+
+    stats = fps_display_sink_build_stats (self, rr, dr, average_fps,
+        frames_rendered, frames_dropped);
+
+    if (self->signal_measurements)
+      g_signal_emit (G_OBJECT (self),
+          fpsdisplaysink_signals[SIGNAL_FPS_STATS], 0, stats);
+
+    if (self->post_messages)
+      gst_element_post_message (GST_ELEMENT_CAST (self),
+          gst_message_new_element (GST_OBJECT_CAST (self), stats));
+    else
+      gst_structure_free (stats);
+  }
+
+  /* the latencies are per interval, the jitter histogram cumulative */
+  g_array_set_size (self->latencies, 0);
+  self->jitter_sum = 0;
+  self->jitter_max = 0;
+  self->jitter_count = 0;
+
+  if (self->silent && !self->use_text_overlay)
+    goto done;
+
   /* Display on a single line to make it easier to read and import
    * into, for example, excel..  note: it would be nice to show
    * timestamp too.. need to check if there is a sane way to log
@@ -414,6 +675,7 @@ display_current_fps (gpointer data)
     g_object_notify_by_pspec ((GObject *) self, pspec_last_message);
   }
 
+done:
   self->last_frames_rendered = frames_rendered;
   self->last_frames_dropped = frames_dropped;
   self->last_ts = current_ts;
@@ -437,6 +699,13 @@ fps_display_sink_start (GstFPSDisplaySink * self)
   /* init time stamps */
   self->last_ts = self->start_ts = self->interval_ts = GST_CLOCK_TIME_NONE;
 
+  gst_segment_init (&self->segment, GST_FORMAT_UNDEFINED);
+  GST_OBJECT_LOCK (self);
+  self->latency = 0;
+  GST_OBJECT_UNLOCK (self);
+  fps_display_sink_reset_stats (self);
+  memset (self->jitter_histogram, 0, sizeof (self->jitter_histogram));
+
   GST_DEBUG_OBJECT (self, "Use text-overlay? %d", self->use_text_overlay);
 
   if (self->use_text_overlay) {
@@ -525,6 +794,16 @@ fps_display_sink_dispose (GObject * object)
   G_OBJECT_CLASS (parent_class)->dispose (object);
 }
 
+static void
+fps_display_sink_finalize (GObject * object)
+{
+  GstFPSDisplaySink *self = GST_FPS_DISPLAY_SINK (object);
+
+  g_array_free (self->latencies, TRUE);
+
+  G_OBJECT_CLASS (parent_class)->finalize (object);
+}
+
 static void
 fps_display_sink_set_property (GObject * object, guint prop_id,
     const GValue * value, GParamSpec * pspec)
@@ -570,6 +849,9 @@ fps_display_sink_set_property (GObject * object, guint prop_id,
     case PROP_SILENT:
       self->silent = g_value_get_boolean (value);
       break;
+    case PROP_POST_MESSAGES:
+      self->post_messages = g_value_get_boolean (value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -613,6 +895,9 @@ fps_display_sink_get_property (GObject * object, guint prop_id,
     case PROP_SILENT:
       g_value_set_boolean (value, self->silent);
       break;
+    case PROP_POST_MESSAGES:
+      g_value_set_boolean (value, self->post_messages);
+      break;
     case PROP_LAST_MESSAGE:
       GST_OBJECT_LOCK (self);
       g_value_set_string (value, self->last_message);
@@ -674,6 +959,28 @@ fps_display_sink_change_state (GstElement * element, GstStateChange transition)
   return ret;
 }
 
+/* The pipeline configures its latency by sending an event to its sinks,
+ * which does not go through the pads */
+static gboolean
+fps_display_sink_send_event (GstElement * element, GstEvent * event)
+{
+  GstFPSDisplaySink *self = GST_FPS_DISPLAY_SINK (element);
+
+  if (GST_EVENT_TYPE (event) == GST_EVENT_LATENCY) {
+    GstClockTime latency;
+
+    gst_event_parse_latency (event, &latency);
+    GST_DEBUG_OBJECT (self, "latency %" GST_TIME_FORMAT,
+        GST_TIME_ARGS (latency));
+
+    GST_OBJECT_LOCK (self);
+    self->latency = latency;
+    GST_OBJECT_UNLOCK (self);
+  }
+
+  return GST_ELEMENT_CLASS (parent_class)->send_event (element, event);
+}
+
 static void
 fps_display_sink_handle_message (GstBin * bin, GstMessage * message)
 {
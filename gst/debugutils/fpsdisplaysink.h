@@ -37,6 +37,9 @@ G_BEGIN_DECLS
 
 GType fps_display_sink_get_type (void);
 
+/* log2 buckets of the jitter histogram, in microseconds */
+#define FPS_DISPLAY_SINK_JITTER_BUCKETS 24
+
 typedef struct _GstFPSDisplaySink GstFPSDisplaySink;
 typedef struct _GstFPSDisplaySinkClass GstFPSDisplaySinkClass;
 
@@ -59,10 +62,22 @@ struct _GstFPSDisplaySink
   GstClockTime interval_ts;
   guint data_probe_id;
 
+  /* latency and jitter, only touched from the streaming thread */
+  GstSegment segment;
+  GstClockTime latency;  /* configured by the pipeline */
+  GArray *latencies;  /* GstClockTimeDiff, current interval */
+  GstClockTime last_render_time;
+  GstClockTime last_running_time;
+  GstClockTime jitter_sum;
+  GstClockTime jitter_max;
+  guint jitter_count;
+  guint64 jitter_histogram[FPS_DISPLAY_SINK_JITTER_BUCKETS];
+
   /* properties */
   gboolean sync;
   gboolean use_text_overlay;
   gboolean signal_measurements;
+  gboolean post_messages;
   GstClockTime fps_update_interval;
   gdouble max_fps;
   gdouble min_fps;
@@ -17,10 +17,39 @@
  * Boston, MA 02110-1301, USA.
  */
 
+/**
+ * SECTION:element-checksumsink
+ *
+ * checksumsink computes a checksum for every buffer it receives and prints
+ * it together with the buffer timestamp, one line per buffer.
+ *
+ * Besides the GLib checksums, the fast non-cryptographic XXH64 hash is
+ * available. For raw video, #GstChecksumSink:mode selects whether only the
+ * visible pixels are hashed, ignoring stride padding, either as one
+ * checksum for the whole frame or as one per plane. With
+ * #GstChecksumSink:threads set, checksums are computed by a pool of worker
+ * threads and still reported in buffer order.
+ *
+ * Lines are written to #GstChecksumSink:location if set, or to stdout. With
+ * #GstChecksumSink:post-messages enabled, an element message named
+ * "checksum" is posted for every buffer with the frame number in "frame",
+ * the timestamp in "pts" and the checksums of the line in "checksum", and
+ * nothing is printed to stdout.
+ *
+ * <refsect2>
+ * <title>Example pipeline</title>
+ * |[
+ * gst-launch-1.0 videotestsrc num-buffers=100 ! checksumsink hash=xxh64 mode=planes threads=4
+ * ]|
+ * </refsect2>
+ */
+
 #ifdef HAVE_CONFIG_H
 #include "config.h"
 #endif
 
+#include <string.h>
+#include <glib/gstdio.h>
 #include <gst/gst.h>
 #include <gst/base/gstbasesink.h>
 #include "gstchecksumsink.h"
@@ -34,13 +63,28 @@ static void gst_checksum_sink_finalize (GObject * object);
 
 static gboolean gst_checksum_sink_start (GstBaseSink * sink);
 static gboolean gst_checksum_sink_stop (GstBaseSink * sink);
+static gboolean gst_checksum_sink_set_caps (GstBaseSink * sink,
+    GstCaps * caps);
+static gboolean gst_checksum_sink_event (GstBaseSink * sink, GstEvent * event);
 static GstFlowReturn
 gst_checksum_sink_render (GstBaseSink * sink, GstBuffer * buffer);
 
+#define DEFAULT_HASH G_CHECKSUM_SHA1
+#define DEFAULT_MODE GST_CHECKSUM_SINK_MODE_BUFFER
+#define DEFAULT_THREADS 0
+#define DEFAULT_POST_MESSAGES FALSE
+
+/* buffers queued per worker thread before render blocks */
+#define JOBS_PER_THREAD 4
+
 enum
 {
   PROP_0,
   PROP_HASH,
+  PROP_MODE,
+  PROP_THREADS,
+  PROP_LOCATION,
+  PROP_POST_MESSAGES,
 };
 
 static GstStaticPadTemplate gst_checksum_sink_sink_template =
@@ -49,6 +93,335 @@ GST_STATIC_PAD_TEMPLATE ("sink",
     GST_PAD_ALWAYS,
     GST_STATIC_CAPS_ANY);
 
+/* XXH64, streaming variant */
+
+#define XXH_PRIME64_1 G_GUINT64_CONSTANT (0x9E3779B185EBCA87)
+#define XXH_PRIME64_2 G_GUINT64_CONSTANT (0xC2B2AE3D27D4EB4F)
+#define XXH_PRIME64_3 G_GUINT64_CONSTANT (0x165667B19E3779F9)
+#define XXH_PRIME64_4 G_GUINT64_CONSTANT (0x85EBCA77C2B2AE63)
+#define XXH_PRIME64_5 G_GUINT64_CONSTANT (0x27D4EB2F165667C5)
+
+typedef struct
+{
+  guint64 total_len;
+  guint64 v[4];
+  guint8 mem[32];
+  gsize memsize;
+} Xxh64State;
+
+static inline guint64
+xxh64_rotl (guint64 x, guint r)
+{
+  return (x << r) | (x >> (64 - r));
+}
+
+static inline guint64
+xxh64_round (guint64 acc, guint64 input)
+{
+  acc += input * XXH_PRIME64_2;
+  acc = xxh64_rotl (acc, 31);
+  return acc * XXH_PRIME64_1;
+}
+
+static inline guint64
+xxh64_merge_round (guint64 acc, guint64 val)
+{
+  acc ^= xxh64_round (0, val);
+  return acc * XXH_PRIME64_1 + XXH_PRIME64_4;
+}
+
+static inline void
+xxh64_stripe (Xxh64State * state, const guint8 * p)
+{
+  state->v[0] = xxh64_round (state->v[0], GST_READ_UINT64_LE (p));
+  state->v[1] = xxh64_round (state->v[1], GST_READ_UINT64_LE (p + 8));
+  state->v[2] = xxh64_round (state->v[2], GST_READ_UINT64_LE (p + 16));
+  state->v[3] = xxh64_round (state->v[3], GST_READ_UINT64_LE (p + 24));
+}
+
+static void
+xxh64_init (Xxh64State * state)
+{
+  state->total_len = 0;
+  state->v[0] = XXH_PRIME64_1 + XXH_PRIME64_2;
+  state->v[1] = XXH_PRIME64_2;
+  state->v[2] = 0;
+  state->v[3] = -XXH_PRIME64_1;
+  state->memsize = 0;
+}
+
+static void
+xxh64_update (Xxh64State * state, const guint8 * data, gsize len)
+{
+  state->total_len += len;
+
+  if (state->memsize + len < 32) {
+    memcpy (state->mem + state->memsize, data, len);
+    state->memsize += len;
+    return;
+  }
+
+  if (state->memsize > 0) {
+    gsize fill = 32 - state->memsize;
+
+    memcpy (state->mem + state->memsize, data, fill);
+    xxh64_stripe (state, state->mem);
+    data += fill;
+    len -= fill;
+  }
+
+  for (; len >= 32; data += 32, len -= 32)
+    xxh64_stripe (state, data);
+
+  memcpy (state->mem, data, len);
+  state->memsize = len;
+}
+
+static guint64
+xxh64_digest (const Xxh64State * state)
+{
+  const guint8 *p = state->mem;
+  gsize len = state->memsize;
+  guint64 h;
+
+  if (state->total_len >= 32) {
+    h = xxh64_rotl (state->v[0], 1) + xxh64_rotl (state->v[1], 7) +
+        xxh64_rotl (state->v[2], 12) + xxh64_rotl (state->v[3], 18);
+    h = xxh64_merge_round (h, state->v[0]);
+    h = xxh64_merge_round (h, state->v[1]);
+    h = xxh64_merge_round (h, state->v[2]);
+    h = xxh64_merge_round (h, state->v[3]);
+  } else {
+    h = state->v[2] + XXH_PRIME64_5;
+  }
+  h += state->total_len;
+
+  for (; len >= 8; p += 8, len -= 8) {
+    h ^= xxh64_round (0, GST_READ_UINT64_LE (p));
+    h = xxh64_rotl (h, 27) * XXH_PRIME64_1 + XXH_PRIME64_4;
+  }
+  if (len >= 4) {
+    h ^= (guint64) GST_READ_UINT32_LE (p) * XXH_PRIME64_1;
+    h = xxh64_rotl (h, 23) * XXH_PRIME64_2 + XXH_PRIME64_3;
+    p += 4;
+    len -= 4;
+  }
+  for (; len > 0; p++, len--) {
+    h ^= *p * XXH_PRIME64_5;
+    h = xxh64_rotl (h, 11) * XXH_PRIME64_1;
+  }
+
+  h ^= h >> 33;
+  h *= XXH_PRIME64_2;
+  h ^= h >> 29;
+  h *= XXH_PRIME64_3;
+  h ^= h >> 32;
+
+  return h;
+}
+
+/* A GChecksum, or XXH64 when checksum is NULL */
+typedef struct
+{
+  GChecksum *checksum;
+  Xxh64State xxh64;
+} GstChecksumSinkHasher;
+
+static void
+hasher_init (GstChecksumSinkHasher * hasher, gint hash)
+{
+  if (hash == GST_CHECKSUM_SINK_HASH_XXH64) {
+    hasher->checksum = NULL;
+    xxh64_init (&hasher->xxh64);
+  } else {
+    hasher->checksum = g_checksum_new (hash);
+  }
+}
+
+static void
+hasher_update (GstChecksumSinkHasher * hasher, const guint8 * data, gsize len)
+{
+  if (hasher->checksum)
+    g_checksum_update (hasher->checksum, data, len);
+  else
+    xxh64_update (&hasher->xxh64, data, len);
+}
+
+/* Appends the hex digest to @str and frees the hasher's resources */
+static void
+hasher_finish (GstChecksumSinkHasher * hasher, GString * str)
+{
+  if (hasher->checksum) {
+    g_string_append (str, g_checksum_get_string (hasher->checksum));
+    g_checksum_free (hasher->checksum);
+    hasher->checksum = NULL;
+  } else {
+    g_string_append_printf (str, "%016" G_GINT64_MODIFIER "x",
+        xxh64_digest (&hasher->xxh64));
+  }
+}
+
+/* One buffer to checksum, with the settings it was rendered with */
+typedef struct
+{
+  GstBuffer *buffer;
+  guint64 frame;
+  gint hash;
+  GstChecksumSinkMode mode;
+  GstVideoInfo vinfo;
+  gboolean have_vinfo;
+
+  gchar *result;
+} GstChecksumSinkJob;
+
+static void
+gst_checksum_sink_job_free (GstChecksumSinkJob * job)
+{
+  gst_buffer_unref (job->buffer);
+  g_free (job->result);
+  g_slice_free (GstChecksumSinkJob, job);
+}
+
+/* Hashes the visible pixels of @plane row by row. Formats without a
+ * per-pixel layout, like v210, are hashed including the row padding. */
+static void
+hash_plane (GstChecksumSinkHasher * hasher, GstVideoFrame * frame,
+    guint plane)
+{
+  const guint8 *data = GST_VIDEO_FRAME_PLANE_DATA (frame, plane);
+  gint stride = GST_VIDEO_FRAME_PLANE_STRIDE (frame, plane);
+  gsize row_size;
+  guint comp, n_rows, i;
+
+  /* the first component stored in the plane gives its geometry */
+  for (comp = 0; comp < GST_VIDEO_FRAME_N_COMPONENTS (frame); comp++)
+    if (GST_VIDEO_FRAME_COMP_PLANE (frame, comp) == plane)
+      break;
+  if (comp == GST_VIDEO_FRAME_N_COMPONENTS (frame))
+    return;
+
+  n_rows = GST_VIDEO_FRAME_COMP_HEIGHT (frame, comp);
+  if (GST_VIDEO_FRAME_COMP_PSTRIDE (frame, comp) > 0)
+    row_size = GST_VIDEO_FRAME_COMP_WIDTH (frame, comp) *
+        GST_VIDEO_FRAME_COMP_PSTRIDE (frame, comp);
+  else
+    row_size = ABS (stride);
+
+  for (i = 0; i < n_rows; i++)
+    hasher_update (hasher, data + (gssize) i * stride, row_size);
+}
+
+/* Returns the space separated checksums of @job, NULL if unmappable */
+static gchar *
+gst_checksum_sink_compute (GstChecksumSinkJob * job)
+{
+  GstChecksumSinkHasher hasher;
+  GString *str = g_string_sized_new (64);
+
+  if (job->mode != GST_CHECKSUM_SINK_MODE_BUFFER && job->have_vinfo) {
+    GstVideoFrame frame;
+    guint i;
+
+    if (!gst_video_frame_map (&frame, &job->vinfo, job->buffer,
+            GST_MAP_READ)) {
+      g_string_free (str, TRUE);
+      return NULL;
+    }
+
+    if (job->mode == GST_CHECKSUM_SINK_MODE_FRAME)
+      hasher_init (&hasher, job->hash);
+
+    for (i = 0; i < GST_VIDEO_FRAME_N_PLANES (&frame); i++) {
+      if (job->mode == GST_CHECKSUM_SINK_MODE_PLANES) {
+        if (i > 0)
+          g_string_append_c (str, ' ');
+        hasher_init (&hasher, job->hash);
+      }
+
+      hash_plane (&hasher, &frame, i);
+
+      if (job->mode == GST_CHECKSUM_SINK_MODE_PLANES)
+        hasher_finish (&hasher, str);
+    }
+
+    if (job->mode == GST_CHECKSUM_SINK_MODE_FRAME)
+      hasher_finish (&hasher, str);
+
+    gst_video_frame_unmap (&frame);
+  } else {
+    GstMapInfo map;
+
+    if (!gst_buffer_map (job->buffer, &map, GST_MAP_READ)) {
+      g_string_free (str, TRUE);
+      return NULL;
+    }
+
+    hasher_init (&hasher, job->hash);
+    hasher_update (&hasher, map.data, map.size);
+    hasher_finish (&hasher, str);
+
+    gst_buffer_unmap (job->buffer, &map);
+  }
+
+  return g_string_free (str, FALSE);
+}
+
+static void
+gst_checksum_sink_output (GstChecksumSink * checksumsink,
+    GstChecksumSinkJob * job)
+{
+  GstClockTime pts = GST_BUFFER_TIMESTAMP (job->buffer);
+
+  if (checksumsink->file) {
+    fprintf (checksumsink->file, "%" GST_TIME_FORMAT " %s\n",
+        GST_TIME_ARGS (pts), job->result);
+  } else if (!checksumsink->post_messages) {
+    g_print ("%" GST_TIME_FORMAT " %s\n", GST_TIME_ARGS (pts), job->result);
+  }
+
+  if (checksumsink->post_messages) {
+    GstStructure *s;
+
+    s = gst_structure_new ("checksum", "frame", G_TYPE_UINT64, job->frame,
+        "pts", G_TYPE_UINT64, pts, "checksum", G_TYPE_STRING, job->result,
+        NULL);
+    gst_element_post_message (GST_ELEMENT_CAST (checksumsink),
+        gst_message_new_element (GST_OBJECT_CAST (checksumsink), s));
+  }
+}
+
+static void
+gst_checksum_sink_worker (gpointer data, gpointer user_data)
+{
+  GstChecksumSinkJob *job = data;
+  GstChecksumSink *checksumsink = user_data;
+  gchar *result;
+
+  result = gst_checksum_sink_compute (job);
+
+  g_mutex_lock (&checksumsink->lock);
+  job->result = result ? result : g_strdup ("(unmappable)");
+
+  /* report all finished jobs at the head of the queue, in order */
+  while ((job = g_queue_peek_head (&checksumsink->jobs)) && job->result) {
+    g_queue_pop_head (&checksumsink->jobs);
+    gst_checksum_sink_output (checksumsink, job);
+    gst_checksum_sink_job_free (job);
+  }
+  g_cond_broadcast (&checksumsink->cond);
+  g_mutex_unlock (&checksumsink->lock);
+}
+
+/* Waits until all queued buffers were reported */
+static void
+gst_checksum_sink_drain (GstChecksumSink * checksumsink)
+{
+  g_mutex_lock (&checksumsink->lock);
+  while (!g_queue_is_empty (&checksumsink->jobs))
+    g_cond_wait (&checksumsink->cond, &checksumsink->lock);
+  g_mutex_unlock (&checksumsink->lock);
+}
+
 /* class initialization */
 
 #define GST_TYPE_CHECKSUM_SINK_HASH (gst_checksum_sink_hash_get_type ())
@@ -63,6 +436,7 @@ gst_checksum_sink_hash_get_type (void)
       {G_CHECKSUM_SHA1, "SHA-1", "sha1"},
       {G_CHECKSUM_SHA256, "SHA-256", "sha256"},
       {G_CHECKSUM_SHA512, "SHA-512", "sha512"},
+      {GST_CHECKSUM_SINK_HASH_XXH64, "XXH64 (non-cryptographic)", "xxh64"},
       {0, NULL, NULL},
     };
 
@@ -71,6 +445,27 @@ gst_checksum_sink_hash_get_type (void)
   return gtype;
 }
 
+#define GST_TYPE_CHECKSUM_SINK_MODE (gst_checksum_sink_mode_get_type ())
+static GType
+gst_checksum_sink_mode_get_type (void)
+{
+  static GType gtype = 0;
+
+  if (gtype == 0) {
+    static const GEnumValue values[] = {
+      {GST_CHECKSUM_SINK_MODE_BUFFER, "Whole buffer", "buffer"},
+      {GST_CHECKSUM_SINK_MODE_FRAME,
+          "Visible video pixels, one checksum per frame", "frame"},
+      {GST_CHECKSUM_SINK_MODE_PLANES,
+          "Visible video pixels, one checksum per plane", "planes"},
+      {0, NULL, NULL},
+    };
+
+    gtype = g_enum_register_static ("GstChecksumSinkMode", values);
+  }
+  return gtype;
+}
+
 #define gst_checksum_sink_parent_class parent_class
 G_DEFINE_TYPE (GstChecksumSink, gst_checksum_sink, GST_TYPE_BASE_SINK);
 
@@ -87,6 +482,8 @@ gst_checksum_sink_class_init (GstChecksumSinkClass * klass)
   gobject_class->finalize = gst_checksum_sink_finalize;
   base_sink_class->start = GST_DEBUG_FUNCPTR (gst_checksum_sink_start);
   base_sink_class->stop = GST_DEBUG_FUNCPTR (gst_checksum_sink_stop);
+  base_sink_class->set_caps = GST_DEBUG_FUNCPTR (gst_checksum_sink_set_caps);
+  base_sink_class->event = GST_DEBUG_FUNCPTR (gst_checksum_sink_event);
   base_sink_class->render = GST_DEBUG_FUNCPTR (gst_checksum_sink_render);
 
   gst_element_class_add_static_pad_template (element_class,
@@ -94,9 +491,33 @@ gst_checksum_sink_class_init (GstChecksumSinkClass * klass)
 
   g_object_class_install_property (gobject_class, PROP_HASH,
       g_param_spec_enum ("hash", "Hash", "Checksum type",
-          gst_checksum_sink_hash_get_type (), G_CHECKSUM_SHA1,
+          gst_checksum_sink_hash_get_type (), DEFAULT_HASH,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_MODE,
+      g_param_spec_enum ("mode", "Mode",
+          "What to checksum (frame and planes need raw video caps)",
+          gst_checksum_sink_mode_get_type (), DEFAULT_MODE,
           G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+  g_object_class_install_property (gobject_class, PROP_THREADS,
+      g_param_spec_uint ("threads", "Threads",
+          "Number of worker threads computing checksums "
+          "(0 = compute on the streaming thread)", 0, 64, DEFAULT_THREADS,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS |
+          GST_PARAM_MUTABLE_READY));
+
+  g_object_class_install_property (gobject_class, PROP_LOCATION,
+      g_param_spec_string ("location", "Location",
+          "File to write the checksums to (NULL = stdout)", NULL,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS |
+          GST_PARAM_MUTABLE_READY));
+
+  g_object_class_install_property (gobject_class, PROP_POST_MESSAGES,
+      g_param_spec_boolean ("post-messages", "Post Messages",
+          "Post an element message with the checksums of every buffer",
+          DEFAULT_POST_MESSAGES, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
   gst_element_class_set_static_metadata (element_class, "Checksum sink",
       "Debug/Sink", "Calculates a checksum for buffers",
       "David Schleef <ds@schleef.org>");
@@ -106,7 +527,14 @@ static void
 gst_checksum_sink_init (GstChecksumSink * checksumsink)
 {
   gst_base_sink_set_sync (GST_BASE_SINK (checksumsink), FALSE);
-  checksumsink->hash = G_CHECKSUM_SHA1;
+  checksumsink->hash = DEFAULT_HASH;
+  checksumsink->mode = DEFAULT_MODE;
+  checksumsink->n_threads = DEFAULT_THREADS;
+  checksumsink->post_messages = DEFAULT_POST_MESSAGES;
+
+  g_mutex_init (&checksumsink->lock);
+  g_cond_init (&checksumsink->cond);
+  g_queue_init (&checksumsink->jobs);
 }
 
 static void
@@ -119,6 +547,19 @@ gst_checksum_sink_set_property (GObject * object, guint prop_id,
     case PROP_HASH:
       checksumsink->hash = g_value_get_enum (value);
       break;
+    case PROP_MODE:
+      checksumsink->mode = g_value_get_enum (value);
+      break;
+    case PROP_THREADS:
+      checksumsink->n_threads = g_value_get_uint (value);
+      break;
+    case PROP_LOCATION:
+      g_free (checksumsink->location);
+      checksumsink->location = g_value_dup_string (value);
+      break;
+    case PROP_POST_MESSAGES:
+      checksumsink->post_messages = g_value_get_boolean (value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -135,6 +576,18 @@ gst_checksum_sink_get_property (GObject * object, guint prop_id,
     case PROP_HASH:
       g_value_set_enum (value, checksumsink->hash);
       break;
+    case PROP_MODE:
+      g_value_set_enum (value, checksumsink->mode);
+      break;
+    case PROP_THREADS:
+      g_value_set_uint (value, checksumsink->n_threads);
+      break;
+    case PROP_LOCATION:
+      g_value_set_string (value, checksumsink->location);
+      break;
+    case PROP_POST_MESSAGES:
+      g_value_set_boolean (value, checksumsink->post_messages);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -150,36 +603,119 @@ gst_checksum_sink_dispose (GObject * object)
 static void
 gst_checksum_sink_finalize (GObject * object)
 {
+  GstChecksumSink *checksumsink = GST_CHECKSUM_SINK (object);
+
+  g_free (checksumsink->location);
+  g_mutex_clear (&checksumsink->lock);
+  g_cond_clear (&checksumsink->cond);
+
   G_OBJECT_CLASS (parent_class)->finalize (object);
 }
 
 static gboolean
 gst_checksum_sink_start (GstBaseSink * sink)
 {
+  GstChecksumSink *checksumsink = GST_CHECKSUM_SINK (sink);
+
+  if (checksumsink->location) {
+    checksumsink->file = g_fopen (checksumsink->location, "w");
+    if (checksumsink->file == NULL) {
+      GST_ELEMENT_ERROR (checksumsink, RESOURCE, OPEN_WRITE,
+          ("Could not open file \"%s\" for writing.", checksumsink->location),
+          GST_ERROR_SYSTEM);
+      return FALSE;
+    }
+  }
+
+  if (checksumsink->n_threads > 0)
+    checksumsink->pool = g_thread_pool_new (gst_checksum_sink_worker,
+        checksumsink, checksumsink->n_threads, FALSE, NULL);
+
+  checksumsink->have_vinfo = FALSE;
+  checksumsink->n_frames = 0;
+
   return TRUE;
 }
 
 static gboolean
 gst_checksum_sink_stop (GstBaseSink * sink)
 {
+  GstChecksumSink *checksumsink = GST_CHECKSUM_SINK (sink);
+
+  /* finishes the queued buffers, which are all reported then */
+  if (checksumsink->pool) {
+    g_thread_pool_free (checksumsink->pool, FALSE, TRUE);
+    checksumsink->pool = NULL;
+  }
+
+  if (checksumsink->file) {
+    fclose (checksumsink->file);
+    checksumsink->file = NULL;
+  }
+
+  return TRUE;
+}
+
+static gboolean
+gst_checksum_sink_set_caps (GstBaseSink * sink, GstCaps * caps)
+{
+  GstChecksumSink *checksumsink = GST_CHECKSUM_SINK (sink);
+
+  /* anything that is not raw video is checksummed as whole buffers */
+  checksumsink->have_vinfo =
+      gst_video_info_from_caps (&checksumsink->vinfo, caps) &&
+      !GST_VIDEO_FORMAT_INFO_IS_TILED (checksumsink->vinfo.finfo);
+
   return TRUE;
 }
 
+static gboolean
+gst_checksum_sink_event (GstBaseSink * sink, GstEvent * event)
+{
+  GstChecksumSink *checksumsink = GST_CHECKSUM_SINK (sink);
+
+  /* report everything before the EOS message is posted */
+  if (GST_EVENT_TYPE (event) == GST_EVENT_EOS)
+    gst_checksum_sink_drain (checksumsink);
+
+  return GST_BASE_SINK_CLASS (parent_class)->event (sink, event);
+}
+
 static GstFlowReturn
 gst_checksum_sink_render (GstBaseSink * sink, GstBuffer * buffer)
 {
-  gchar *s;
-  GstMapInfo map;
+  GstChecksumSinkJob *job;
   GstChecksumSink *checksumsink;
 
   checksumsink = GST_CHECKSUM_SINK (sink);
-  gst_buffer_map (buffer, &map, GST_MAP_READ);
-  s = g_compute_checksum_for_data (checksumsink->hash, map.data, map.size);
-  gst_buffer_unmap (buffer, &map);
-  g_print ("%" GST_TIME_FORMAT " %s\n",
-      GST_TIME_ARGS (GST_BUFFER_TIMESTAMP (buffer)), s);
 
-  g_free (s);
+  job = g_slice_new0 (GstChecksumSinkJob);
+  job->buffer = gst_buffer_ref (buffer);
+  job->frame = checksumsink->n_frames++;
+  job->hash = checksumsink->hash;
+  job->mode = checksumsink->mode;
+  job->have_vinfo = checksumsink->have_vinfo;
+  if (job->have_vinfo)
+    job->vinfo = checksumsink->vinfo;
+
+  if (checksumsink->pool == NULL) {
+    job->result = gst_checksum_sink_compute (job);
+    if (job->result == NULL)
+      job->result = g_strdup ("(unmappable)");
+    gst_checksum_sink_output (checksumsink, job);
+    gst_checksum_sink_job_free (job);
+
+    return GST_FLOW_OK;
+  }
+
+  g_mutex_lock (&checksumsink->lock);
+  while (g_queue_get_length (&checksumsink->jobs) >=
+      checksumsink->n_threads * JOBS_PER_THREAD)
+    g_cond_wait (&checksumsink->cond, &checksumsink->lock);
+  g_queue_push_tail (&checksumsink->jobs, job);
+  g_mutex_unlock (&checksumsink->lock);
+
+  g_thread_pool_push (checksumsink->pool, job, NULL);
 
   return GST_FLOW_OK;
 }
@@ -20,8 +20,10 @@
 #ifndef _GST_CHECKSUM_SINK_H_
 #define _GST_CHECKSUM_SINK_H_
 
+#include <stdio.h>
 #include <gst/gst.h>
 #include <gst/base/gstbasesink.h>
+#include <gst/video/video.h>
 
 G_BEGIN_DECLS
 
@@ -34,10 +36,34 @@ G_BEGIN_DECLS
 typedef struct _GstChecksumSink GstChecksumSink;
 typedef struct _GstChecksumSinkClass GstChecksumSinkClass;
 
+/* Non-GLib hash types, numbered well clear of GChecksumType */
+#define GST_CHECKSUM_SINK_HASH_XXH64 100
+
+typedef enum {
+  GST_CHECKSUM_SINK_MODE_BUFFER,
+  GST_CHECKSUM_SINK_MODE_FRAME,
+  GST_CHECKSUM_SINK_MODE_PLANES,
+} GstChecksumSinkMode;
+
 struct _GstChecksumSink
 {
   GstBaseSink base_checksumsink;
-  GChecksumType hash;
+  gint hash;
+  GstChecksumSinkMode mode;
+  guint n_threads;
+  gchar *location;
+  gboolean post_messages;
+
+  FILE *file;
+  GstVideoInfo vinfo;
+  gboolean have_vinfo;
+  guint64 n_frames;
+
+  /* checksums computed by the worker threads, in buffer order */
+  GThreadPool *pool;
+  GMutex lock;
+  GCond cond;
+  GQueue jobs;
 };
 
 struct _GstChecksumSinkClass
@@ -33,6 +33,26 @@
  * This element is currently intended for transcoding pipelines,
  * although may be useful in other contexts.
  *
+ * All watchdog instances of a process share a single timer thread, so
+ * monitoring many pipelines does not cost one thread each. Buffers only
+ * move the deadlines of their watchdog forward and do not wake up that
+ * thread.
+ *
+ * Besides the fatal timeout, the watchdog tracks the buffer rate, the
+ * longest gap between two buffers and timestamp discontinuities, available
+ * through the #GstWatchdog:stats property, and reports problems with element
+ * messages before escalating to an error:
+ *
+ * * "watchdog-stall" when no buffer was seen for
+ *   #GstWatchdog:warning-timeout, with the stall "duration" in nanoseconds
+ * * "watchdog-slowdown" when buffers still flow but their "rate", measured
+ *   over #GstWatchdog:rate-window, is below #GstWatchdog:min-rate
+ * * "watchdog-discontinuity" when a buffer timestamp is off from the
+ *   previous timestamp plus duration by more than
+ *   #GstWatchdog:discont-threshold, with the difference in "offset"
+ * * "watchdog-recovered" once buffers flow again at the expected rate, with
+ *   the "reason" ("stall" or "slowdown") that is over
+ *
  * ## Example launch line
  * |[
  * gst-launch-1.0 -v fakesrc ! watchdog ! fakesink
@@ -68,16 +88,34 @@ static GstFlowReturn gst_watchdog_transform_ip (GstBaseTransform * trans,
     GstBuffer * buf);
 static void gst_watchdog_feed (GstWatchdog * watchdog, gpointer mini_object,
     gboolean force);
+static void gst_watchdog_reset_stats (GstWatchdog * watchdog);
 
 static GstStateChangeReturn
 gst_watchdog_change_state (GstElement * element, GstStateChange transition);
 
+#define DEFAULT_WARNING_TIMEOUT 0
+#define DEFAULT_MIN_RATE 0.0
+#define DEFAULT_RATE_WINDOW 1000
+#define DEFAULT_DISCONT_THRESHOLD 0
+
 enum
 {
   PROP_0,
-  PROP_TIMEOUT
+  PROP_TIMEOUT,
+  PROP_WARNING_TIMEOUT,
+  PROP_MIN_RATE,
+  PROP_RATE_WINDOW,
+  PROP_DISCONT_THRESHOLD,
+  PROP_STATS
 };
 
+/* The timer thread shared by all instances */
+static GMutex shared_lock;
+static guint shared_refcount;
+static GMainContext *shared_context;
+static GMainLoop *shared_loop;
+static GThread *shared_thread;
+
 /* class initialization */
 
 G_DEFINE_TYPE_WITH_CODE (GstWatchdog, gst_watchdog, GST_TYPE_BASE_TRANSFORM,
@@ -122,11 +160,50 @@ gst_watchdog_class_init (GstWatchdogClass * klass)
           "received. 0 means disabled.", 0, G_MAXINT, 1000,
           G_PARAM_CONSTRUCT | G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+  g_object_class_install_property (gobject_class, PROP_WARNING_TIMEOUT,
+      g_param_spec_int ("warning-timeout", "Warning Timeout",
+          "Time (in ms) without buffers after which a watchdog-stall "
+          "message is posted. 0 means disabled.", 0, G_MAXINT,
+          DEFAULT_WARNING_TIMEOUT,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_MIN_RATE,
+      g_param_spec_double ("min-rate", "Minimum Rate",
+          "Buffers per second below which a watchdog-slowdown message is "
+          "posted. 0 means disabled.", 0, G_MAXDOUBLE, DEFAULT_MIN_RATE,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_RATE_WINDOW,
+      g_param_spec_int ("rate-window", "Rate Window",
+          "Time (in ms) over which the buffer rate is measured", 1, G_MAXINT,
+          DEFAULT_RATE_WINDOW, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_DISCONT_THRESHOLD,
+      g_param_spec_int ("discont-threshold", "Discontinuity Threshold",
+          "Timestamp difference (in ms) from the expected one above which a "
+          "watchdog-discontinuity message is posted. 0 means disabled.", 0,
+          G_MAXINT, DEFAULT_DISCONT_THRESHOLD,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_STATS,
+      g_param_spec_boxed ("stats", "Statistics",
+          "Buffer count, rate (buffers per second over the last window), "
+          "longest gap between buffers (in ns), discontinuities, stalls and "
+          "slowdowns seen", GST_TYPE_STRUCTURE,
+          G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
 }
 
 static void
 gst_watchdog_init (GstWatchdog * watchdog)
 {
+  watchdog->warning_timeout = DEFAULT_WARNING_TIMEOUT;
+  watchdog->min_rate = DEFAULT_MIN_RATE;
+  watchdog->rate_window = DEFAULT_RATE_WINDOW;
+  watchdog->discont_threshold = DEFAULT_DISCONT_THRESHOLD;
+  watchdog->deadline = -1;
+  watchdog->warning_deadline = -1;
+
+  gst_watchdog_reset_stats (watchdog);
 }
 
 static void
@@ -144,6 +221,27 @@ gst_watchdog_set_property (GObject * object, guint property_id,
       gst_watchdog_feed (watchdog, NULL, FALSE);
       GST_OBJECT_UNLOCK (watchdog);
       break;
+    case PROP_WARNING_TIMEOUT:
+      GST_OBJECT_LOCK (watchdog);
+      watchdog->warning_timeout = g_value_get_int (value);
+      gst_watchdog_feed (watchdog, NULL, FALSE);
+      GST_OBJECT_UNLOCK (watchdog);
+      break;
+    case PROP_MIN_RATE:
+      GST_OBJECT_LOCK (watchdog);
+      watchdog->min_rate = g_value_get_double (value);
+      GST_OBJECT_UNLOCK (watchdog);
+      break;
+    case PROP_RATE_WINDOW:
+      GST_OBJECT_LOCK (watchdog);
+      watchdog->rate_window = g_value_get_int (value);
+      GST_OBJECT_UNLOCK (watchdog);
+      break;
+    case PROP_DISCONT_THRESHOLD:
+      GST_OBJECT_LOCK (watchdog);
+      watchdog->discont_threshold = g_value_get_int (value);
+      GST_OBJECT_UNLOCK (watchdog);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
       break;
@@ -162,6 +260,29 @@ gst_watchdog_get_property (GObject * object, guint property_id,
     case PROP_TIMEOUT:
       g_value_set_int (value, watchdog->timeout);
       break;
+    case PROP_WARNING_TIMEOUT:
+      g_value_set_int (value, watchdog->warning_timeout);
+      break;
+    case PROP_MIN_RATE:
+      g_value_set_double (value, watchdog->min_rate);
+      break;
+    case PROP_RATE_WINDOW:
+      g_value_set_int (value, watchdog->rate_window);
+      break;
+    case PROP_DISCONT_THRESHOLD:
+      g_value_set_int (value, watchdog->discont_threshold);
+      break;
+    case PROP_STATS:
+      GST_OBJECT_LOCK (watchdog);
+      g_value_take_boxed (value, gst_structure_new ("watchdog-stats",
+              "buffers", G_TYPE_UINT64, watchdog->n_buffers,
+              "rate", G_TYPE_DOUBLE, watchdog->rate,
+              "max-gap", G_TYPE_UINT64, watchdog->max_gap * GST_USECOND,
+              "discontinuities", G_TYPE_UINT64, watchdog->n_discont,
+              "stalls", G_TYPE_UINT64, watchdog->n_stalls,
+              "slowdowns", G_TYPE_UINT64, watchdog->n_slowdowns, NULL));
+      GST_OBJECT_UNLOCK (watchdog);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
       break;
@@ -171,47 +292,263 @@ gst_watchdog_get_property (GObject * object, guint property_id,
 static gpointer
 gst_watchdog_thread (gpointer user_data)
 {
-  GstWatchdog *watchdog = GST_WATCHDOG (user_data);
+  GMainLoop *main_loop = user_data;
 
-  GST_DEBUG_OBJECT (watchdog, "thread starting");
+  GST_DEBUG ("thread starting");
 
-  g_main_loop_run (watchdog->main_loop);
+  g_main_loop_run (main_loop);
 
-  GST_DEBUG_OBJECT (watchdog, "thread exiting");
+  GST_DEBUG ("thread exiting");
 
   return NULL;
 }
 
 static gboolean
-gst_watchdog_trigger (gpointer ptr)
+gst_watchdog_quit_mainloop (gpointer ptr)
 {
-  GstWatchdog *watchdog = GST_WATCHDOG (ptr);
+  GMainLoop *main_loop = ptr;
 
-  GST_DEBUG_OBJECT (watchdog, "watchdog triggered");
+  GST_DEBUG ("watchdog quit");
 
-  GST_ELEMENT_ERROR (watchdog, STREAM, FAILED, ("Watchdog triggered"),
-      ("Watchdog triggered"));
+  g_main_loop_quit (main_loop);
 
   return FALSE;
 }
 
+/* Returns a reference to the context of the shared timer thread, which is
+ * started by the first user */
+static GMainContext *
+gst_watchdog_acquire_context (void)
+{
+  GMainContext *context;
+
+  g_mutex_lock (&shared_lock);
+  if (shared_refcount++ == 0) {
+    shared_context = g_main_context_new ();
+    shared_loop = g_main_loop_new (shared_context, TRUE);
+    shared_thread = g_thread_new ("watchdog", gst_watchdog_thread,
+        shared_loop);
+  }
+  context = g_main_context_ref (shared_context);
+  g_mutex_unlock (&shared_lock);
+
+  return context;
+}
+
+/* Drops @context, stopping the shared timer thread with its last user. Must
+ * not be called with an object lock held, as the timer callbacks post
+ * messages. */
+static void
+gst_watchdog_release_context (GMainContext * context)
+{
+  g_mutex_lock (&shared_lock);
+  if (--shared_refcount == 0) {
+    GSource *quit_source;
+
+    /* dispatch an idle event that trigger g_main_loop_quit to avoid race
+     * between g_main_loop_run and g_main_loop_quit */
+    quit_source = g_idle_source_new ();
+    g_source_set_callback (quit_source, gst_watchdog_quit_mainloop,
+        shared_loop, NULL);
+    g_source_attach (quit_source, shared_context);
+    g_source_unref (quit_source);
+
+    g_thread_join (shared_thread);
+    shared_thread = NULL;
+
+    g_main_loop_unref (shared_loop);
+    shared_loop = NULL;
+
+    g_main_context_unref (shared_context);
+    shared_context = NULL;
+  }
+  g_mutex_unlock (&shared_lock);
+
+  g_main_context_unref (context);
+}
+
+/* Call with OBJECT_LOCK taken */
+static void
+gst_watchdog_reset_stats (GstWatchdog * watchdog)
+{
+  watchdog->n_buffers = 0;
+  watchdog->last_arrival = -1;
+  watchdog->max_gap = 0;
+  watchdog->window_start = -1;
+  watchdog->window_buffers = 0;
+  watchdog->rate = 0.0;
+  watchdog->next_pts = GST_CLOCK_TIME_NONE;
+  watchdog->n_discont = 0;
+  watchdog->n_stalls = 0;
+  watchdog->n_slowdowns = 0;
+  watchdog->stalled = FALSE;
+  watchdog->slow = FALSE;
+}
+
+static void
+gst_watchdog_post (GstWatchdog * watchdog, GstStructure * s)
+{
+  GST_INFO_OBJECT (watchdog, "%" GST_PTR_FORMAT, s);
+
+  gst_element_post_message (GST_ELEMENT_CAST (watchdog),
+      gst_message_new_element (GST_OBJECT_CAST (watchdog), s));
+}
+
+/* Updates the statistics with @buf arriving now and returns the messages to
+ * post once the object lock is released. Call with OBJECT_LOCK taken. */
+static GSList *
+gst_watchdog_track (GstWatchdog * watchdog, GstBuffer * buf)
+{
+  GSList *messages = NULL;
+  gint64 now = g_get_monotonic_time ();
+  GstClockTime pts = GST_BUFFER_PTS (buf);
+
+  watchdog->n_buffers++;
+
+  if (watchdog->last_arrival >= 0) {
+    gint64 gap = now - watchdog->last_arrival;
+
+    watchdog->max_gap = MAX (watchdog->max_gap, gap);
+
+    if (watchdog->stalled) {
+      watchdog->stalled = FALSE;
+      messages = g_slist_prepend (messages,
+          gst_structure_new ("watchdog-recovered", "reason", G_TYPE_STRING,
+              "stall", "duration", G_TYPE_UINT64, gap * GST_USECOND, NULL));
+    }
+  }
+  watchdog->last_arrival = now;
+
+  /* rate over the last window, so buffers trickling in are told apart from
+   * no buffers at all */
+  if (watchdog->window_start < 0) {
+    watchdog->window_start = now;
+    watchdog->window_buffers = 0;
+  } else if (now - watchdog->window_start >=
+      (gint64) watchdog->rate_window * 1000) {
+    watchdog->rate = watchdog->window_buffers * (gdouble) G_USEC_PER_SEC /
+        (now - watchdog->window_start);
+    watchdog->window_start = now;
+    watchdog->window_buffers = 0;
+
+    if (watchdog->min_rate > 0 && watchdog->rate < watchdog->min_rate) {
+      if (!watchdog->slow) {
+        watchdog->slow = TRUE;
+        watchdog->n_slowdowns++;
+        messages = g_slist_prepend (messages,
+            gst_structure_new ("watchdog-slowdown", "rate", G_TYPE_DOUBLE,
+                watchdog->rate, NULL));
+      }
+    } else if (watchdog->slow) {
+      watchdog->slow = FALSE;
+      messages = g_slist_prepend (messages,
+          gst_structure_new ("watchdog-recovered", "reason", G_TYPE_STRING,
+              "slowdown", "rate", G_TYPE_DOUBLE, watchdog->rate, NULL));
+    }
+  }
+  watchdog->window_buffers++;
+
+  if (GST_CLOCK_TIME_IS_VALID (pts)) {
+    if (watchdog->discont_threshold > 0 &&
+        GST_CLOCK_TIME_IS_VALID (watchdog->next_pts)) {
+      GstClockTimeDiff offset = GST_CLOCK_DIFF (watchdog->next_pts, pts);
+
+      if (ABS (offset) > watchdog->discont_threshold * GST_MSECOND) {
+        watchdog->n_discont++;
+        messages = g_slist_prepend (messages,
+            gst_structure_new ("watchdog-discontinuity", "offset",
+                G_TYPE_INT64, offset, NULL));
+      }
+    }
+
+    watchdog->next_pts = pts;
+    if (GST_BUFFER_DURATION_IS_VALID (buf))
+      watchdog->next_pts += GST_BUFFER_DURATION (buf);
+  }
+
+  return g_slist_reverse (messages);
+}
+
+/* Call with OBJECT_LOCK taken */
+static gint64
+gst_watchdog_next_deadline (GstWatchdog * watchdog)
+{
+  if (watchdog->warning_deadline >= 0 && (watchdog->deadline < 0 ||
+          watchdog->warning_deadline < watchdog->deadline))
+    return watchdog->warning_deadline;
+
+  return watchdog->deadline;
+}
+
 static gboolean
-gst_watchdog_quit_mainloop (gpointer ptr)
+gst_watchdog_source_dispatch (GSource * source, GSourceFunc callback,
+    gpointer user_data)
+{
+  return callback (user_data);
+}
+
+static GSourceFuncs gst_watchdog_source_funcs = {
+  NULL,                         /* prepare */
+  NULL,                         /* check */
+  gst_watchdog_source_dispatch,
+  NULL
+};
+
+/* Runs on the timer thread once the ready time of the source is reached.
+ * Buffers only push the deadlines back without waking up the thread, so
+ * they are checked again here and the source is rearmed for the next one. */
+static gboolean
+gst_watchdog_check (gpointer ptr)
 {
   GstWatchdog *watchdog = GST_WATCHDOG (ptr);
+  GSource *source = g_main_current_source ();
+  gint64 now = g_get_monotonic_time ();
+  GstClockTime duration = 0;
+  gboolean warn = FALSE, trigger = FALSE;
 
-  GST_DEBUG_OBJECT (watchdog, "watchdog quit");
+  GST_OBJECT_LOCK (watchdog);
+  if (watchdog->warning_deadline >= 0 && now >= watchdog->warning_deadline) {
+    watchdog->warning_deadline = -1;
+    watchdog->stalled = TRUE;
+    watchdog->n_stalls++;
+    duration = watchdog->warning_timeout * GST_MSECOND;
+    warn = TRUE;
+  }
+
+  if (watchdog->deadline >= 0 && now >= watchdog->deadline) {
+    watchdog->deadline = -1;
+    watchdog->warning_deadline = -1;
+    trigger = TRUE;
+  }
 
-  g_main_loop_quit (watchdog->main_loop);
+  if (!g_source_is_destroyed (source))
+    g_source_set_ready_time (source, gst_watchdog_next_deadline (watchdog));
+  GST_OBJECT_UNLOCK (watchdog);
 
-  return FALSE;
+  if (warn) {
+    GST_DEBUG_OBJECT (watchdog, "watchdog warning triggered");
+
+    gst_watchdog_post (watchdog, gst_structure_new ("watchdog-stall",
+            "duration", G_TYPE_UINT64, duration, NULL));
+  }
+
+  if (trigger) {
+    GST_DEBUG_OBJECT (watchdog, "watchdog triggered");
+
+    GST_ELEMENT_ERROR (watchdog, STREAM, FAILED, ("Watchdog triggered"),
+        ("Watchdog triggered"));
+  }
+
+  return G_SOURCE_CONTINUE;
 }
 
 /*  Call with OBJECT_LOCK taken */
 static void
 gst_watchdog_feed (GstWatchdog * watchdog, gpointer mini_object, gboolean force)
 {
-  if (watchdog->source) {
+  gint64 now, ready_time, current;
+
+  if (watchdog->deadline >= 0) {
     if (watchdog->waiting_for_flush_start) {
       if (mini_object && GST_IS_EVENT (mini_object) &&
           GST_EVENT_TYPE (mini_object) == GST_EVENT_FLUSH_START) {
@@ -238,40 +575,73 @@ gst_watchdog_feed (GstWatchdog * watchdog, gpointer mini_object, gboolean force)
         force = TRUE;
       }
     }
-    g_source_destroy (watchdog->source);
-    g_source_unref (watchdog->source);
-    watchdog->source = NULL;
-
   }
 
-  if (watchdog->timeout == 0) {
+  watchdog->deadline = -1;
+  watchdog->warning_deadline = -1;
+
+  if (watchdog->timeout == 0 && watchdog->warning_timeout == 0) {
     GST_LOG_OBJECT (watchdog, "Timeout is 0 => nothing to do");
-  } else if (watchdog->main_context == NULL) {
-    GST_LOG_OBJECT (watchdog, "No maincontext => nothing to do");
+  } else if (watchdog->source == NULL) {
+    GST_LOG_OBJECT (watchdog, "No timer source => nothing to do");
   } else if ((GST_STATE (watchdog) != GST_STATE_PLAYING) && force == FALSE) {
     GST_LOG_OBJECT (watchdog,
         "Not in playing and force is FALSE => Nothing to do");
   } else {
-    watchdog->source = g_timeout_source_new (watchdog->timeout);
-    g_source_set_callback (watchdog->source, gst_watchdog_trigger,
-        gst_object_ref (watchdog), gst_object_unref);
-    g_source_attach (watchdog->source, watchdog->main_context);
+    now = g_get_monotonic_time ();
+
+    if (watchdog->timeout > 0)
+      watchdog->deadline = now + (gint64) watchdog->timeout * 1000;
+
+    /* a warning after the error would never be seen */
+    if (watchdog->warning_timeout > 0 && !watchdog->stalled &&
+        (watchdog->timeout == 0 ||
+            watchdog->warning_timeout < watchdog->timeout))
+      watchdog->warning_deadline =
+          now + (gint64) watchdog->warning_timeout * 1000;
+
+    /* the timer thread is only woken up when the next deadline moved
+     * earlier, later ones are picked up when the source dispatches */
+    ready_time = gst_watchdog_next_deadline (watchdog);
+    current = g_source_get_ready_time (watchdog->source);
+    if (ready_time >= 0 && (current < 0 || ready_time < current))
+      g_source_set_ready_time (watchdog->source, ready_time);
   }
 }
 
+/* Call with OBJECT_LOCK taken. The source wakes up once more at its current
+ * ready time and finds nothing to do. */
+static void
+gst_watchdog_disarm (GstWatchdog * watchdog)
+{
+  watchdog->deadline = -1;
+  watchdog->warning_deadline = -1;
+}
+
 static gboolean
 gst_watchdog_start (GstBaseTransform * trans)
 {
   GstWatchdog *watchdog = GST_WATCHDOG (trans);
 
+  GMainContext *context;
+  GSource *source;
+
   GST_DEBUG_OBJECT (watchdog, "start");
-  GST_OBJECT_LOCK (watchdog);
 
-  watchdog->main_context = g_main_context_new ();
-  watchdog->main_loop = g_main_loop_new (watchdog->main_context, TRUE);
-  watchdog->thread = g_thread_new ("watchdog", gst_watchdog_thread, watchdog);
+  context = gst_watchdog_acquire_context ();
+
+  source = g_source_new (&gst_watchdog_source_funcs, sizeof (GSource));
+  g_source_set_callback (source, gst_watchdog_check,
+      gst_object_ref (watchdog), gst_object_unref);
+  g_source_attach (source, context);
 
+  GST_OBJECT_LOCK (watchdog);
+  watchdog->main_context = context;
+  watchdog->source = source;
+  gst_watchdog_disarm (watchdog);
+  gst_watchdog_reset_stats (watchdog);
   GST_OBJECT_UNLOCK (watchdog);
+
   return TRUE;
 }
 
@@ -279,35 +649,28 @@ static gboolean
 gst_watchdog_stop (GstBaseTransform * trans)
 {
   GstWatchdog *watchdog = GST_WATCHDOG (trans);
-  GSource *quit_source;
+  GMainContext *context;
+  GSource *source;
 
   GST_DEBUG_OBJECT (watchdog, "stop");
   GST_OBJECT_LOCK (watchdog);
 
-  if (watchdog->source) {
-    g_source_destroy (watchdog->source);
-    g_source_unref (watchdog->source);
-    watchdog->source = NULL;
-  }
+  gst_watchdog_disarm (watchdog);
 
-  /* dispatch an idle event that trigger g_main_loop_quit to avoid race
-   * between g_main_loop_run and g_main_loop_quit */
-  quit_source = g_idle_source_new ();
-  g_source_set_callback (quit_source, gst_watchdog_quit_mainloop, watchdog,
-      NULL);
-  g_source_attach (quit_source, watchdog->main_context);
-  g_source_unref (quit_source);
+  source = watchdog->source;
+  watchdog->source = NULL;
+  context = watchdog->main_context;
+  watchdog->main_context = NULL;
 
-  g_thread_join (watchdog->thread);
-  watchdog->thread = NULL;
+  GST_OBJECT_UNLOCK (watchdog);
 
-  g_main_loop_unref (watchdog->main_loop);
-  watchdog->main_loop = NULL;
+  if (source) {
+    g_source_destroy (source);
+    g_source_unref (source);
+  }
 
-  g_main_context_unref (watchdog->main_context);
-  watchdog->main_context = NULL;
+  gst_watchdog_release_context (context);
 
-  GST_OBJECT_UNLOCK (watchdog);
   return TRUE;
 }
 
@@ -319,6 +682,11 @@ gst_watchdog_sink_event (GstBaseTransform * trans, GstEvent * event)
   GST_DEBUG_OBJECT (watchdog, "sink_event");
 
   GST_OBJECT_LOCK (watchdog);
+  if (GST_EVENT_TYPE (event) == GST_EVENT_SEGMENT ||
+      GST_EVENT_TYPE (event) == GST_EVENT_FLUSH_STOP) {
+    /* timestamps are not expected to continue across these */
+    watchdog->next_pts = GST_CLOCK_TIME_NONE;
+  }
   gst_watchdog_feed (watchdog, event, FALSE);
   GST_OBJECT_UNLOCK (watchdog);
 
@@ -359,13 +727,19 @@ static GstFlowReturn
 gst_watchdog_transform_ip (GstBaseTransform * trans, GstBuffer * buf)
 {
   GstWatchdog *watchdog = GST_WATCHDOG (trans);
+  GSList *messages, *l;
 
   GST_DEBUG_OBJECT (watchdog, "transform_ip");
 
   GST_OBJECT_LOCK (watchdog);
+  messages = gst_watchdog_track (watchdog, buf);
   gst_watchdog_feed (watchdog, buf, FALSE);
   GST_OBJECT_UNLOCK (watchdog);
 
+  for (l = messages; l; l = l->next)
+    gst_watchdog_post (watchdog, l->data);
+  g_slist_free (messages);
+
   return GST_FLOW_OK;
 }
 
@@ -403,13 +777,11 @@ gst_watchdog_change_state (GstElement * element, GstStateChange transition)
       GST_OBJECT_UNLOCK (watchdog);
       break;
     case GST_STATE_CHANGE_PLAYING_TO_PAUSED:
-      /* Disable the timer */
+      /* Disable the timers */
       GST_OBJECT_LOCK (watchdog);
-      if (watchdog->source) {
-        g_source_destroy (watchdog->source);
-        g_source_unref (watchdog->source);
-        watchdog->source = NULL;
-      }
+      gst_watchdog_disarm (watchdog);
+      watchdog->last_arrival = -1;
+      watchdog->window_start = -1;
       GST_OBJECT_UNLOCK (watchdog);
       break;
     default:
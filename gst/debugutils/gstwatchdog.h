@@ -40,15 +40,36 @@ struct _GstWatchdog
 
   /* properties */
   int timeout;
+  int warning_timeout;
+  gdouble min_rate;
+  int rate_window;
+  int discont_threshold;
 
+  /* shared by all watchdogs of the process */
   GMainContext *main_context;
-  GMainLoop *main_loop;
-  GThread *thread;
+  /* attached between start and stop, dispatched at the earliest deadline */
   GSource *source;
+  /* monotonic times (in us) of the error and the warning, -1 if disarmed */
+  gint64 deadline;
+  gint64 warning_deadline;
 
   gboolean waiting_for_a_buffer;
   gboolean waiting_for_flush_start;
   gboolean waiting_for_flush_stop;
+
+  /* statistics, protected by the object lock */
+  guint64 n_buffers;
+  gint64 last_arrival;
+  gint64 max_gap;
+  gint64 window_start;
+  guint window_buffers;
+  gdouble rate;
+  GstClockTime next_pts;
+  guint64 n_discont;
+  guint64 n_stalls;
+  guint64 n_slowdowns;
+  gboolean stalled;
+  gboolean slow;
 };
 
 struct _GstWatchdogClass
@@ -127,6 +127,10 @@ G_STMT_START {							\
  * as outlined in the uecp spec
  *
  * XMODEM    x^16 + x^12 + x^5 + 1
+ *
+ * The bulk of the data is processed 8 bytes at a time ("slice-by-8"), with
+ * one table per byte position giving the CRC of that byte followed by the
+ * remaining zero bytes of the slice.
  */
 
 #define POLY       0x1021
@@ -141,16 +145,33 @@ static guint16 gst_dp_crc_from_memory_maps (const GstMapInfo * maps,
 GstBuffer *
 gst_dp_payload_buffer (GstBuffer * buffer, GstDPHeaderFlag flags)
 {
-  GstBuffer *ret_buf;
+  return gst_dp_payload_buffer_full (buffer, flags, NULL);
+}
+
+/* Like gst_dp_payload_buffer(), but takes the buffer for the header from
+ * @header_pool if possible. The memory of @buffer is appended to the pooled
+ * buffer, so the pool has to drop everything but the first memory again
+ * when the buffer is released to it. */
+GstBuffer *
+gst_dp_payload_buffer_full (GstBuffer * buffer, GstDPHeaderFlag flags,
+    GstBufferPool * header_pool)
+{
+  GstBuffer *ret_buf = NULL;
   GstMapInfo map;
-  GstMemory *mem;
   guint8 *h;
   guint16 flags_mask;
   guint16 header_crc = 0, crc = 0;
   gsize buffer_size;
 
-  mem = gst_allocator_alloc (NULL, GST_DP_HEADER_LENGTH, NULL);
-  gst_memory_map (mem, &map, GST_MAP_READWRITE);
+  if (header_pool == NULL ||
+      gst_buffer_pool_acquire_buffer (header_pool, &ret_buf,
+          NULL) != GST_FLOW_OK) {
+    ret_buf = gst_buffer_new ();
+    gst_buffer_append_memory (ret_buf,
+        gst_allocator_alloc (NULL, GST_DP_HEADER_LENGTH, NULL));
+  }
+
+  gst_buffer_map (ret_buf, &map, GST_MAP_WRITE);
   h = memset (map.data, 0, map.size);
 
   /* version, flags, type */
@@ -213,12 +234,7 @@ gst_dp_payload_buffer (GstBuffer * buffer, GstDPHeaderFlag flags)
   GST_WRITE_UINT16_BE (h + 60, crc);
 
   GST_MEMDUMP ("payload header for buffer", h, GST_DP_HEADER_LENGTH);
-  gst_memory_unmap (mem, &map);
-
-  ret_buf = gst_buffer_new ();
-
-  /* header */
-  gst_buffer_append_memory (ret_buf, mem);
+  gst_buffer_unmap (ret_buf, &map);
 
   /* buffer data */
   return gst_buffer_append (ret_buf, gst_buffer_ref (buffer));
@@ -365,6 +381,53 @@ static const guint16 gst_dp_crc_table[256] = {
   0x6e17, 0x7e36, 0x4e55, 0x5e74, 0x2e93, 0x3eb2, 0x0ed1, 0x1ef0
 };
 
+static guint16 gst_dp_crc_tables[8][256];
+
+static void
+gst_dp_crc_init_tables (void)
+{
+  static gsize tables_init = 0;
+
+  if (g_once_init_enter (&tables_init)) {
+    guint i, k;
+
+    memcpy (gst_dp_crc_tables[0], gst_dp_crc_table, sizeof (gst_dp_crc_table));
+    for (k = 1; k < 8; k++) {
+      for (i = 0; i < 256; i++) {
+        guint16 prev = gst_dp_crc_tables[k - 1][i];
+
+        gst_dp_crc_tables[k][i] =
+            (guint16) ((prev << 8) ^ gst_dp_crc_table[prev >> 8]);
+      }
+    }
+    g_once_init_leave (&tables_init, 1);
+  }
+}
+
+static guint16
+gst_dp_crc_update (guint16 crc_register, const guint8 * buffer, gsize length)
+{
+  const guint16 (*t)[256] = (const guint16 (*)[256]) gst_dp_crc_tables;
+
+  gst_dp_crc_init_tables ();
+
+  while (length >= 8) {
+    crc_register = t[7][buffer[0] ^ (crc_register >> 8)] ^
+        t[6][buffer[1] ^ (crc_register & 0xff)] ^
+        t[5][buffer[2]] ^ t[4][buffer[3]] ^ t[3][buffer[4]] ^
+        t[2][buffer[5]] ^ t[1][buffer[6]] ^ t[0][buffer[7]];
+    buffer += 8;
+    length -= 8;
+  }
+
+  while (length-- > 0) {
+    crc_register = (guint16) ((crc_register << 8) ^
+        t[0][((crc_register >> 8) & 0x00ff) ^ *buffer++]);
+  }
+
+  return crc_register;
+}
+
 /**
  * gst_dp_crc:
  * @buffer: array of bytes
@@ -387,10 +450,8 @@ gst_dp_crc (const guint8 * buffer, guint length)
   g_assert (buffer != NULL);
 
   /* calc CRC */
-  for (; length--;) {
-    crc_register = (guint16) ((crc_register << 8) ^
-        gst_dp_crc_table[((crc_register >> 8) & 0x00ff) ^ *buffer++]);
-  }
+  crc_register = gst_dp_crc_update (crc_register, buffer, length);
+
   return (0xffff ^ crc_register);
 }
 
@@ -407,15 +468,8 @@ gst_dp_crc_from_memory_maps (const GstMapInfo * maps, guint n_maps)
 
   /* calc CRC */
   while (n_maps > 0) {
-    guint8 *buffer = maps->data;
-    gsize length = maps->size;
-
-    total_length += length;
-
-    while (length-- > 0) {
-      crc_register = (guint16) ((crc_register << 8) ^
-          gst_dp_crc_table[((crc_register >> 8) & 0x00ff) ^ *buffer++]);
-    }
+    total_length += maps->size;
+    crc_register = gst_dp_crc_update (crc_register, maps->data, maps->size);
     --n_maps;
     ++maps;
   }
@@ -475,6 +529,17 @@ gst_dp_header_payload_type (const guint8 * header)
 
 /*** DEPACKETIZING FUNCTIONS ***/
 
+static void
+gst_dp_buffer_set_header_fields (GstBuffer * buffer, const guint8 * header)
+{
+  GST_BUFFER_TIMESTAMP (buffer) = GST_DP_HEADER_TIMESTAMP (header);
+  GST_BUFFER_DTS (buffer) = GST_DP_HEADER_DTS (header);
+  GST_BUFFER_DURATION (buffer) = GST_DP_HEADER_DURATION (header);
+  GST_BUFFER_OFFSET (buffer) = GST_DP_HEADER_OFFSET (header);
+  GST_BUFFER_OFFSET_END (buffer) = GST_DP_HEADER_OFFSET_END (header);
+  GST_BUFFER_FLAGS (buffer) = GST_DP_HEADER_BUFFER_FLAGS (header);
+}
+
 /**
  * gst_dp_buffer_from_header:
  * @header_length: the length of the packet header
@@ -508,16 +573,42 @@ gst_dp_buffer_from_header (guint header_length, const guint8 * header,
       gst_buffer_new_allocate (allocator,
       (guint) GST_DP_HEADER_PAYLOAD_LENGTH (header), allocation_params);
 
-  GST_BUFFER_TIMESTAMP (buffer) = GST_DP_HEADER_TIMESTAMP (header);
-  GST_BUFFER_DTS (buffer) = GST_DP_HEADER_DTS (header);
-  GST_BUFFER_DURATION (buffer) = GST_DP_HEADER_DURATION (header);
-  GST_BUFFER_OFFSET (buffer) = GST_DP_HEADER_OFFSET (header);
-  GST_BUFFER_OFFSET_END (buffer) = GST_DP_HEADER_OFFSET_END (header);
-  GST_BUFFER_FLAGS (buffer) = GST_DP_HEADER_BUFFER_FLAGS (header);
+  gst_dp_buffer_set_header_fields (buffer, header);
 
   return buffer;
 }
 
+/**
+ * gst_dp_buffer_from_payload:
+ * @header_length: the length of the packet header
+ * @header: the byte array of the packet header
+ * @payload: (transfer full): a #GstBuffer holding the packet payload
+ *
+ * Turns @payload into the buffer described by the given header, without
+ * copying its data. @payload is typically a sub-buffer of the incoming GDP
+ * stream.
+ *
+ * This function does not check the header passed to it, use
+ * gst_dp_validate_header() first if the header data is unchecked.
+ *
+ * Returns: A writable #GstBuffer sharing the memory of @payload.
+ */
+GstBuffer *
+gst_dp_buffer_from_payload (guint header_length, const guint8 * header,
+    GstBuffer * payload)
+{
+  g_return_val_if_fail (header != NULL, NULL);
+  g_return_val_if_fail (header_length >= GST_DP_HEADER_LENGTH, NULL);
+  g_return_val_if_fail (GST_DP_HEADER_PAYLOAD_TYPE (header) ==
+      GST_DP_PAYLOAD_BUFFER, NULL);
+  g_return_val_if_fail (GST_IS_BUFFER (payload), NULL);
+
+  payload = gst_buffer_make_writable (payload);
+  gst_dp_buffer_set_header_fields (payload, header);
+
+  return payload;
+}
+
 /**
  * gst_dp_caps_from_packet:
  * @header_length: the length of the packet header
@@ -26,6 +26,7 @@
 #include <gst/gstbuffer.h>
 #include <gst/gstevent.h>
 #include <gst/gstcaps.h>
+#include <gst/gstbufferpool.h>
 
 G_BEGIN_DECLS
 
@@ -81,6 +82,9 @@ GstBuffer *     gst_dp_buffer_from_header       (guint header_length,
                                                 const guint8 * header,
                                                 GstAllocator * allocator,
                                                 GstAllocationParams * allocation_params);
+GstBuffer *     gst_dp_buffer_from_payload      (guint header_length,
+                                                const guint8 * header,
+                                                GstBuffer * payload);
 GstCaps *       gst_dp_caps_from_packet         (guint header_length,
                                                 const guint8 * header,
                                                 const guint8 * payload);
@@ -92,6 +96,10 @@ GstEvent *      gst_dp_event_from_packet        (guint header_length,
 GstBuffer *     gst_dp_payload_buffer           (GstBuffer      * buffer,
                                                  GstDPHeaderFlag  flags);
 
+GstBuffer *     gst_dp_payload_buffer_full      (GstBuffer      * buffer,
+                                                 GstDPHeaderFlag  flags,
+                                                 GstBufferPool  * header_pool);
+
 GstBuffer *     gst_dp_payload_caps             (const GstCaps  * caps,
                                                  GstDPHeaderFlag  flags);
 
@@ -87,6 +87,7 @@ static void gst_gdp_depay_set_property (GObject * object, guint prop_id,
 static void gst_gdp_depay_get_property (GObject * object, guint prop_id,
     GValue * value, GParamSpec * pspec);
 static void gst_gdp_depay_decide_allocation (GstGDPDepay * depay);
+static GstBuffer *gst_gdp_depay_take_payload (GstGDPDepay * depay);
 
 static void
 gst_gdp_depay_class_init (GstGDPDepayClass * klass)
@@ -141,9 +142,11 @@ gst_gdp_depay_init (GstGDPDepay * gdpdepay)
   gst_element_add_pad (GST_ELEMENT (gdpdepay), gdpdepay->srcpad);
 
   gdpdepay->adapter = gst_adapter_new ();
+  gdpdepay->header = g_malloc (GST_DP_HEADER_LENGTH);
 
   gdpdepay->allocator = NULL;
   gst_allocation_params_init (&gdpdepay->allocation_params);
+  gdpdepay->zero_copy = TRUE;
 }
 
 static void
@@ -297,19 +300,16 @@ gst_gdp_depay_chain (GstPad * pad, GstObject * parent, GstBuffer * buffer)
           goto done;
 
         GST_LOG_OBJECT (this, "reading GDP header from adapter");
-        header = gst_adapter_take (this->adapter, GST_DP_HEADER_LENGTH);
-        if (!gst_dp_validate_header (GST_DP_HEADER_LENGTH, header)) {
-          g_free (header);
+        header = this->header;
+        gst_adapter_copy (this->adapter, header, 0, GST_DP_HEADER_LENGTH);
+        gst_adapter_flush (this->adapter, GST_DP_HEADER_LENGTH);
+        if (!gst_dp_validate_header (GST_DP_HEADER_LENGTH, header))
           goto header_validate_error;
-        }
 
-        /* store types and payload length. Also store the header, which we need
-         * to make the payload. */
+        /* store types and payload length. The header stays around as we need
+         * it to make the payload. */
         this->payload_length = gst_dp_header_payload_length (header);
         this->payload_type = gst_dp_header_payload_type (header);
-        /* free previous header and store new one. */
-        g_free (this->header);
-        this->header = header;
 
         GST_LOG_OBJECT (this,
             "read GDP header, payload size %d, payload type %d, switching to state PAYLOAD",
@@ -362,23 +362,10 @@ gst_gdp_depay_chain (GstPad * pad, GstObject * parent, GstBuffer * buffer)
           goto no_caps;
 
         GST_LOG_OBJECT (this, "reading GDP buffer from adapter");
-        buf =
-            gst_dp_buffer_from_header (GST_DP_HEADER_LENGTH, this->header,
-            this->allocator, &this->allocation_params);
+        buf = gst_gdp_depay_take_payload (this);
         if (!buf)
           goto buffer_failed;
 
-        /* now take the payload if there is any */
-        if (this->payload_length > 0) {
-          GstMapInfo map;
-
-          gst_buffer_map (buf, &map, GST_MAP_WRITE);
-          gst_adapter_copy (this->adapter, map.data, 0, this->payload_length);
-          gst_buffer_unmap (buf, &map);
-
-          gst_adapter_flush (this->adapter, this->payload_length);
-        }
-
         if (GST_BUFFER_TIMESTAMP (buf) > -this->ts_offset)
           GST_BUFFER_TIMESTAMP (buf) += this->ts_offset;
         else
@@ -538,6 +525,7 @@ gst_gdp_depay_change_state (GstElement * element, GstStateChange transition)
         gst_object_unref (this->allocator);
       this->allocator = NULL;
       gst_allocation_params_init (&this->allocation_params);
+      this->zero_copy = TRUE;
       break;
     default:
       break;
@@ -545,6 +533,58 @@ gst_gdp_depay_change_state (GstElement * element, GstStateChange transition)
   return ret;
 }
 
+/* Returns the payload of the current buffer packet. The payload is taken as
+ * a sub-buffer of the incoming data when downstream can use system memory
+ * at the alignment it ends up at, and copied into memory allocated as
+ * negotiated otherwise. */
+static GstBuffer *
+gst_gdp_depay_take_payload (GstGDPDepay * this)
+{
+  GstBuffer *payload = NULL, *buf;
+  GstMapInfo map;
+
+  if (this->payload_length > 0 && this->zero_copy) {
+    gboolean aligned;
+
+    payload = gst_adapter_take_buffer (this->adapter, this->payload_length);
+
+    if (!gst_memory_map (gst_buffer_peek_memory (payload, 0), &map,
+            GST_MAP_READ)) {
+      gst_buffer_unref (payload);
+      return NULL;
+    }
+    aligned = ((guintptr) map.data & this->allocation_params.align) == 0;
+    gst_memory_unmap (map.memory, &map);
+
+    if (aligned)
+      return gst_dp_buffer_from_payload (GST_DP_HEADER_LENGTH, this->header,
+          payload);
+
+    GST_LOG_OBJECT (this, "payload not aligned to %" G_GSIZE_FORMAT
+        " bytes, copying", this->allocation_params.align + 1);
+  }
+
+  buf = gst_dp_buffer_from_header (GST_DP_HEADER_LENGTH, this->header,
+      this->allocator, &this->allocation_params);
+
+  if (payload) {
+    if (buf) {
+      gst_buffer_map (buf, &map, GST_MAP_WRITE);
+      gst_buffer_extract (payload, 0, map.data, map.size);
+      gst_buffer_unmap (buf, &map);
+    }
+    gst_buffer_unref (payload);
+  } else if (buf && this->payload_length > 0) {
+    gst_buffer_map (buf, &map, GST_MAP_WRITE);
+    gst_adapter_copy (this->adapter, map.data, 0, this->payload_length);
+    gst_buffer_unmap (buf, &map);
+
+    gst_adapter_flush (this->adapter, this->payload_length);
+  }
+
+  return buf;
+}
+
 static void
 gst_gdp_depay_decide_allocation (GstGDPDepay * gdpdepay)
 {
@@ -583,6 +623,12 @@ gst_gdp_depay_decide_allocation (GstGDPDepay * gdpdepay)
   gdpdepay->allocator = allocator;
   gdpdepay->allocation_params = params;
 
+  /* payloads can be passed on as part of the incoming buffers as long as
+   * downstream does not ask for special memory */
+  gdpdepay->zero_copy = allocator == NULL ||
+      g_strcmp0 (allocator->mem_type, GST_ALLOCATOR_SYSMEM) == 0;
+  GST_DEBUG_OBJECT (gdpdepay, "zero-copy payloads: %d", gdpdepay->zero_copy);
+
   gst_caps_unref (caps);
   gst_query_unref (query);
 }
@@ -71,6 +71,7 @@ struct _GstGDPDepay
 
   GstAllocator *allocator;
   GstAllocationParams allocation_params;
+  gboolean zero_copy;
 };
 
 struct _GstGDPDepayClass
@@ -66,6 +66,55 @@ enum
   PROP_CRC_PAYLOAD
 };
 
+/* Pool for the buffers carrying the GDP header of payloaded buffers.
+ * gst_dp_payload_buffer_full() appends the memory of the payloaded buffer to
+ * them, which is removed again when they are released so that the header
+ * memory can be reused for the next buffer. */
+typedef GstBufferPool GstGDPHeaderPool;
+typedef GstBufferPoolClass GstGDPHeaderPoolClass;
+
+static GType gst_gdp_header_pool_get_type (void);
+G_DEFINE_TYPE (GstGDPHeaderPool, gst_gdp_header_pool, GST_TYPE_BUFFER_POOL);
+
+static void
+gst_gdp_header_pool_reset_buffer (GstBufferPool * pool, GstBuffer * buffer)
+{
+  if (gst_buffer_n_memory (buffer) > 1) {
+    gst_buffer_remove_memory_range (buffer, 1, -1);
+    GST_BUFFER_FLAG_UNSET (buffer, GST_BUFFER_FLAG_TAG_MEMORY);
+  }
+
+  GST_BUFFER_POOL_CLASS (gst_gdp_header_pool_parent_class)->reset_buffer (pool,
+      buffer);
+}
+
+static void
+gst_gdp_header_pool_class_init (GstGDPHeaderPoolClass * klass)
+{
+  klass->reset_buffer = gst_gdp_header_pool_reset_buffer;
+}
+
+static void
+gst_gdp_header_pool_init (GstGDPHeaderPool * pool)
+{
+}
+
+static GstBufferPool *
+gst_gdp_header_pool_new (void)
+{
+  GstBufferPool *pool;
+  GstStructure *config;
+
+  pool = g_object_new (gst_gdp_header_pool_get_type (), NULL);
+  gst_object_ref_sink (pool);
+
+  config = gst_buffer_pool_get_config (pool);
+  gst_buffer_pool_config_set_params (config, NULL, GST_DP_HEADER_LENGTH, 0, 0);
+  gst_buffer_pool_set_config (pool, config);
+
+  return pool;
+}
+
 #define _do_init \
     GST_DEBUG_CATEGORY_INIT (gst_gdp_pay_debug, "gdppay", 0, \
     "GDP payloader");
@@ -146,6 +195,8 @@ gst_gdp_pay_init (GstGDPPay * gdppay)
   gdppay->crc_payload = DEFAULT_CRC_PAYLOAD;
   gdppay->header_flag = gdppay->crc_header | gdppay->crc_payload;
   gdppay->offset = 0;
+
+  gdppay->header_pool = gst_gdp_header_pool_new ();
 }
 
 static void
@@ -154,6 +205,7 @@ gst_gdp_pay_finalize (GObject * gobject)
   GstGDPPay *this = GST_GDP_PAY (gobject);
 
   gst_gdp_pay_reset (this);
+  gst_object_unref (this->header_pool);
 
   GST_CALL_PARENT (G_OBJECT_CLASS, finalize, (gobject));
 }
@@ -203,7 +255,8 @@ gst_gdp_buffer_from_caps (GstGDPPay * this, GstCaps * caps)
 static GstBuffer *
 gst_gdp_pay_buffer_from_buffer (GstGDPPay * this, GstBuffer * buffer)
 {
-  return gst_dp_payload_buffer (buffer, this->header_flag);
+  return gst_dp_payload_buffer_full (buffer, this->header_flag,
+      this->header_pool);
 }
 
 static GstBuffer *
@@ -691,6 +744,7 @@ gst_gdp_pay_change_state (GstElement * element, GstStateChange transition)
 
   switch (transition) {
     case GST_STATE_CHANGE_READY_TO_PAUSED:
+      gst_buffer_pool_set_active (this->header_pool, TRUE);
       break;
     default:
       break;
@@ -701,6 +755,8 @@ gst_gdp_pay_change_state (GstElement * element, GstStateChange transition)
   switch (transition) {
     case GST_STATE_CHANGE_PAUSED_TO_READY:
       gst_gdp_pay_reset (this);
+      /* buffers still in flight are freed instead of being released */
+      gst_buffer_pool_set_active (this->header_pool, FALSE);
       break;
     default:
       break;
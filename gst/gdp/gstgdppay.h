@@ -65,6 +65,8 @@ struct _GstGDPPay
   gboolean crc_header;
   gboolean crc_payload;
   GstDPHeaderFlag header_flag;
+
+  GstBufferPool *header_pool;
 };
 
 struct _GstGDPPayClass
@@ -35,6 +35,11 @@
  * See the gstintertest.c example in the gst-plugins-bad source code for
  * more details.
  *
+ * Samples are handed over to interaudiosrc through a lock-free ring that
+ * holds #GstInterAudioSrc:buffer-time of audio. When the ring is full, the
+ * new samples are dropped. If interaudiosrc starts after the caps were
+ * negotiated, it replaces the ring with one of its own buffer-time.
+ *
  */
 
 #ifdef HAVE_CONFIG_H
@@ -63,8 +68,6 @@ static gboolean gst_inter_audio_sink_start (GstBaseSink * sink);
 static gboolean gst_inter_audio_sink_stop (GstBaseSink * sink);
 static gboolean gst_inter_audio_sink_set_caps (GstBaseSink * sink,
     GstCaps * caps);
-static gboolean gst_inter_audio_sink_event (GstBaseSink * sink,
-    GstEvent * event);
 static GstFlowReturn gst_inter_audio_sink_render (GstBaseSink * sink,
     GstBuffer * buffer);
 static gboolean gst_inter_audio_sink_query (GstBaseSink * sink,
@@ -115,7 +118,6 @@ gst_inter_audio_sink_class_init (GstInterAudioSinkClass * klass)
       GST_DEBUG_FUNCPTR (gst_inter_audio_sink_get_times);
   base_sink_class->start = GST_DEBUG_FUNCPTR (gst_inter_audio_sink_start);
   base_sink_class->stop = GST_DEBUG_FUNCPTR (gst_inter_audio_sink_stop);
-  base_sink_class->event = GST_DEBUG_FUNCPTR (gst_inter_audio_sink_event);
   base_sink_class->set_caps = GST_DEBUG_FUNCPTR (gst_inter_audio_sink_set_caps);
   base_sink_class->render = GST_DEBUG_FUNCPTR (gst_inter_audio_sink_render);
   base_sink_class->query = GST_DEBUG_FUNCPTR (gst_inter_audio_sink_query);
@@ -130,7 +132,6 @@ static void
 gst_inter_audio_sink_init (GstInterAudioSink * interaudiosink)
 {
   interaudiosink->channel = g_strdup (DEFAULT_CHANNEL);
-  interaudiosink->input_adapter = gst_adapter_new ();
 }
 
 void
@@ -173,7 +174,6 @@ gst_inter_audio_sink_finalize (GObject * object)
 
   /* clean up object here */
   g_free (interaudiosink->channel);
-  gst_object_unref (interaudiosink->input_adapter);
 
   G_OBJECT_CLASS (gst_inter_audio_sink_parent_class)->finalize (object);
 }
@@ -226,14 +226,27 @@ gst_inter_audio_sink_stop (GstBaseSink * sink)
   GST_DEBUG_OBJECT (interaudiosink, "stop");
 
   g_mutex_lock (&interaudiosink->surface->mutex);
-  gst_adapter_clear (interaudiosink->surface->audio_adapter);
+  /* the source might have replaced our ring with a resized one that we did
+   * not pick up yet */
+  if (interaudiosink->surface->audio_ring && interaudiosink->ring) {
+    gst_inter_audio_ring_unref (interaudiosink->surface->audio_ring);
+    interaudiosink->surface->audio_ring = NULL;
+  }
   memset (&interaudiosink->surface->audio_info, 0, sizeof (GstAudioInfo));
   g_mutex_unlock (&interaudiosink->surface->mutex);
 
   gst_inter_surface_unref (interaudiosink->surface);
   interaudiosink->surface = NULL;
 
-  gst_adapter_clear (interaudiosink->input_adapter);
+  if (interaudiosink->ring) {
+    gst_inter_audio_ring_unref (interaudiosink->ring);
+    interaudiosink->ring = NULL;
+  }
+
+  if (interaudiosink->overruns > 0)
+    GST_INFO_OBJECT (interaudiosink, "dropped %" G_GUINT64_FORMAT " samples "
+        "because the ring was full", interaudiosink->overruns);
+  interaudiosink->overruns = 0;
 
   return TRUE;
 }
@@ -242,104 +255,89 @@ static gboolean
 gst_inter_audio_sink_set_caps (GstBaseSink * sink, GstCaps * caps)
 {
   GstInterAudioSink *interaudiosink = GST_INTER_AUDIO_SINK (sink);
+  GstInterSurface *surface = interaudiosink->surface;
   GstAudioInfo info;
+  guint64 buffer_time, period_time;
 
   if (!gst_audio_info_from_caps (&info, caps)) {
     GST_ERROR_OBJECT (sink, "Failed to parse caps %" GST_PTR_FORMAT, caps);
     return FALSE;
   }
 
-  g_mutex_lock (&interaudiosink->surface->mutex);
-  interaudiosink->surface->audio_info = info;
-  interaudiosink->info = info;
-  /* TODO: Ideally we would drain the source here */
-  gst_adapter_clear (interaudiosink->surface->audio_adapter);
-  g_mutex_unlock (&interaudiosink->surface->mutex);
+  g_mutex_lock (&surface->mutex);
+  buffer_time = surface->audio_buffer_time;
+  period_time = surface->audio_period_time;
 
-  return TRUE;
-}
+  if (buffer_time < period_time) {
+    GST_ERROR_OBJECT (interaudiosink,
+        "Buffer time smaller than period time (%" GST_TIME_FORMAT " < %"
+        GST_TIME_FORMAT ")", GST_TIME_ARGS (buffer_time),
+        GST_TIME_ARGS (period_time));
+    g_mutex_unlock (&surface->mutex);
+    return FALSE;
+  }
 
-static gboolean
-gst_inter_audio_sink_event (GstBaseSink * sink, GstEvent * event)
-{
-  GstInterAudioSink *interaudiosink = GST_INTER_AUDIO_SINK (sink);
+  surface->audio_info = info;
+  interaudiosink->info = info;
 
-  switch (GST_EVENT_TYPE (event)) {
-    case GST_EVENT_EOS:{
-      GstBuffer *tmp;
-      guint n;
+  /* the source plays out what is left in the previous ring before it
+   * switches to the new one */
+  if (interaudiosink->ring)
+    gst_inter_audio_ring_unref (interaudiosink->ring);
+  interaudiosink->ring = gst_inter_audio_ring_new (&info, buffer_time);
+  if (surface->audio_ring)
+    gst_inter_audio_ring_unref (surface->audio_ring);
+  g_atomic_pointer_set (&surface->audio_ring,
+      gst_inter_audio_ring_ref (interaudiosink->ring));
+  g_mutex_unlock (&surface->mutex);
 
-      if ((n = gst_adapter_available (interaudiosink->input_adapter)) > 0) {
-        g_mutex_lock (&interaudiosink->surface->mutex);
-        tmp = gst_adapter_take_buffer (interaudiosink->input_adapter, n);
-        gst_adapter_push (interaudiosink->surface->audio_adapter, tmp);
-        g_mutex_unlock (&interaudiosink->surface->mutex);
-      }
-      break;
-    }
-    default:
-      break;
-  }
-
-  return GST_BASE_SINK_CLASS (parent_class)->event (sink, event);
+  return TRUE;
 }
 
 static GstFlowReturn
 gst_inter_audio_sink_render (GstBaseSink * sink, GstBuffer * buffer)
 {
   GstInterAudioSink *interaudiosink = GST_INTER_AUDIO_SINK (sink);
-  guint n, bpf;
-  guint64 period_time, buffer_time;
-  guint64 period_samples, buffer_samples;
+  GstInterSurface *surface = interaudiosink->surface;
+  GstMapInfo map;
+  guint written;
 
   GST_DEBUG_OBJECT (interaudiosink, "render %" G_GSIZE_FORMAT,
       gst_buffer_get_size (buffer));
-  bpf = interaudiosink->info.bpf;
 
-  g_mutex_lock (&interaudiosink->surface->mutex);
+  if (!interaudiosink->ring) {
+    GST_ELEMENT_ERROR (interaudiosink, CORE, NEGOTIATION, (NULL),
+        ("No caps set before the first buffer"));
+    return GST_FLOW_NOT_NEGOTIATED;
+  }
 
-  buffer_time = interaudiosink->surface->audio_buffer_time;
-  period_time = interaudiosink->surface->audio_period_time;
+  /* a source that started after us resized the ring */
+  if (G_UNLIKELY (g_atomic_pointer_get (&surface->audio_ring) !=
+          interaudiosink->ring)) {
+    g_mutex_lock (&surface->mutex);
+    if (surface->audio_ring) {
+      GST_DEBUG_OBJECT (interaudiosink, "switching to the resized ring");
+      gst_inter_audio_ring_unref (interaudiosink->ring);
+      interaudiosink->ring = gst_inter_audio_ring_ref (surface->audio_ring);
+    }
+    g_mutex_unlock (&surface->mutex);
+  }
 
-  if (buffer_time < period_time) {
-    GST_ERROR_OBJECT (interaudiosink,
-        "Buffer time smaller than period time (%" GST_TIME_FORMAT " < %"
-        GST_TIME_FORMAT ")", GST_TIME_ARGS (buffer_time),
-        GST_TIME_ARGS (period_time));
-    g_mutex_unlock (&interaudiosink->surface->mutex);
+  if (!gst_buffer_map (buffer, &map, GST_MAP_READ)) {
+    GST_ELEMENT_ERROR (interaudiosink, RESOURCE, READ, (NULL),
+        ("Failed to map buffer"));
     return GST_FLOW_ERROR;
   }
 
-  buffer_samples =
-      gst_util_uint64_scale (buffer_time, interaudiosink->info.rate,
-      GST_SECOND);
-  period_samples =
-      gst_util_uint64_scale (period_time, interaudiosink->info.rate,
-      GST_SECOND);
-
-  n = gst_adapter_available (interaudiosink->surface->audio_adapter) / bpf;
-  while (n > buffer_samples) {
-    GST_DEBUG_OBJECT (interaudiosink, "flushing %" GST_TIME_FORMAT,
-        GST_TIME_ARGS (period_time));
-    gst_adapter_flush (interaudiosink->surface->audio_adapter,
-        period_samples * bpf);
-    n -= period_samples;
+  written = gst_inter_audio_ring_write (interaudiosink->ring, map.data,
+      map.size - map.size % interaudiosink->info.bpf);
+  if (written < map.size) {
+    GST_DEBUG_OBJECT (interaudiosink, "ring full, dropping %" G_GSIZE_FORMAT
+        " bytes", map.size - written);
+    interaudiosink->overruns += (map.size - written) / interaudiosink->info.bpf;
   }
 
-  n = gst_adapter_available (interaudiosink->input_adapter);
-  if (period_samples * bpf > gst_buffer_get_size (buffer) + n) {
-    gst_adapter_push (interaudiosink->input_adapter, gst_buffer_ref (buffer));
-  } else {
-    GstBuffer *tmp;
-
-    if (n > 0) {
-      tmp = gst_adapter_take_buffer (interaudiosink->input_adapter, n);
-      gst_adapter_push (interaudiosink->surface->audio_adapter, tmp);
-    }
-    gst_adapter_push (interaudiosink->surface->audio_adapter,
-        gst_buffer_ref (buffer));
-  }
-  g_mutex_unlock (&interaudiosink->surface->mutex);
+  gst_buffer_unmap (buffer, &map);
 
   return GST_FLOW_OK;
 }
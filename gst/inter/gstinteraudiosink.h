@@ -41,8 +41,9 @@ struct _GstInterAudioSink
   GstInterSurface *surface;
   char *channel;
 
-  GstAdapter *input_adapter;
+  GstInterAudioRing *ring;
   GstAudioInfo info;
+  guint64 overruns;
 };
 
 struct _GstInterAudioSinkClass
@@ -33,6 +33,13 @@
  * See the gstintertest.c example in the gst-plugins-bad source code for
  * more details.
  *
+ * Samples are read from a lock-free ring filled by interaudiosink. Output
+ * starts once #GstInterAudioSrc:latency-time of audio is queued, and the
+ * queued amount is then kept around that value by dropping or repeating
+ * single samples, which compensates for the drift between the clocks of
+ * both pipelines. When the format changes, the samples still queued in the
+ * previous format are played out before switching to the new one.
+ *
  */
 
 #ifdef HAVE_CONFIG_H
@@ -139,7 +146,8 @@ gst_inter_audio_src_class_init (GstInterAudioSrcClass * klass)
 
   g_object_class_install_property (gobject_class, PROP_LATENCY_TIME,
       g_param_spec_uint64 ("latency-time", "Latency Time",
-          "Latency as reported by the source",
+          "Latency as reported by the source, and amount of audio kept "
+          "queued to absorb jitter",
           1, G_MAXUINT64, DEFAULT_AUDIO_LATENCY_TIME,
           G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
@@ -276,6 +284,7 @@ static gboolean
 gst_inter_audio_src_start (GstBaseSrc * src)
 {
   GstInterAudioSrc *interaudiosrc = GST_INTER_AUDIO_SRC (src);
+  GstInterAudioRing *ring;
 
   GST_DEBUG_OBJECT (interaudiosrc, "start");
 
@@ -287,6 +296,19 @@ gst_inter_audio_src_start (GstBaseSrc * src)
   interaudiosrc->surface->audio_buffer_time = interaudiosrc->buffer_time;
   interaudiosrc->surface->audio_latency_time = interaudiosrc->latency_time;
   interaudiosrc->surface->audio_period_time = interaudiosrc->period_time;
+
+  /* the sink negotiated before we started and sized the ring with another
+   * buffer-time. Whatever it queued since is stale, so replace the ring and
+   * let the sink pick up the new one with its next buffer */
+  ring = interaudiosrc->surface->audio_ring;
+  if (ring && ring->buffer_time != interaudiosrc->buffer_time) {
+    GST_DEBUG_OBJECT (interaudiosrc, "resizing ring from %" GST_TIME_FORMAT
+        " to %" GST_TIME_FORMAT, GST_TIME_ARGS (ring->buffer_time),
+        GST_TIME_ARGS (interaudiosrc->buffer_time));
+    g_atomic_pointer_set (&interaudiosrc->surface->audio_ring,
+        gst_inter_audio_ring_new (&ring->info, interaudiosrc->buffer_time));
+    gst_inter_audio_ring_unref (ring);
+  }
   g_mutex_unlock (&interaudiosrc->surface->mutex);
 
   return TRUE;
@@ -302,6 +324,11 @@ gst_inter_audio_src_stop (GstBaseSrc * src)
   gst_inter_surface_unref (interaudiosrc->surface);
   interaudiosrc->surface = NULL;
 
+  if (interaudiosrc->ring) {
+    gst_inter_audio_ring_unref (interaudiosrc->ring);
+    interaudiosrc->ring = NULL;
+  }
+
   return TRUE;
 }
 
@@ -330,27 +357,107 @@ gst_inter_audio_src_get_times (GstBaseSrc * src, GstBuffer * buffer,
   }
 }
 
+/* Reads up to @n_samples from the ring into @data and returns how many
+ * were written. When more or less than latency-time is queued on average,
+ * a few samples are dropped or the last one is repeated. */
+static guint
+gst_inter_audio_src_read_ring (GstInterAudioSrc * interaudiosrc,
+    guint8 * data, guint n_samples)
+{
+  GstInterAudioRing *ring = interaudiosrc->ring;
+  guint bpf = GST_AUDIO_INFO_BPF (&ring->info);
+  guint fill, target, max_correction, stretch = 0, n, i;
+
+  fill = gst_inter_audio_ring_get_fill (ring) / bpf;
+  target = gst_util_uint64_scale (interaudiosrc->latency_time,
+      GST_AUDIO_INFO_RATE (&ring->info), GST_SECOND);
+
+  if (!interaudiosrc->primed) {
+    if (fill < target)
+      return 0;
+    GST_DEBUG_OBJECT (interaudiosrc, "%u samples queued, starting output",
+        fill);
+    interaudiosrc->primed = TRUE;
+    interaudiosrc->fill_avg = fill;
+  }
+
+  interaudiosrc->fill_avg += ((gdouble) fill - interaudiosrc->fill_avg) / 16;
+
+  /* correct by at most 0.5% of the samples to keep it inaudible, and only
+   * when the average is more than a period away from the target */
+  max_correction = MAX (n_samples / 200, 1);
+  if (interaudiosrc->fill_avg > target + n_samples) {
+    n = gst_inter_audio_ring_skip (ring, max_correction * bpf) / bpf;
+    GST_LOG_OBJECT (interaudiosrc, "%u samples queued on average, dropped %u",
+        (guint) interaudiosrc->fill_avg, n);
+    fill -= n;
+    interaudiosrc->fill_avg -= n;
+  } else if (interaudiosrc->fill_avg + n_samples < target && fill > 0) {
+    stretch = MIN (max_correction, n_samples - 1);
+    GST_LOG_OBJECT (interaudiosrc, "%u samples queued on average, "
+        "repeating %u", (guint) interaudiosrc->fill_avg, stretch);
+  }
+
+  n = MIN (fill, n_samples - stretch);
+  n = gst_inter_audio_ring_read (ring, data, n * bpf) / bpf;
+  if (n > 0) {
+    for (i = 0; i < stretch; i++)
+      memcpy (data + (n + i) * bpf, data + (n - 1) * bpf, bpf);
+    n += stretch;
+  }
+
+  if (n < n_samples) {
+    GST_DEBUG_OBJECT (interaudiosrc, "underrun, %u samples missing",
+        n_samples - n);
+    interaudiosrc->primed = FALSE;
+  }
+
+  return n;
+}
+
 static GstFlowReturn
 gst_inter_audio_src_create (GstBaseSrc * src, guint64 offset, guint size,
     GstBuffer ** buf)
 {
   GstInterAudioSrc *interaudiosrc = GST_INTER_AUDIO_SRC (src);
+  GstInterSurface *surface = interaudiosrc->surface;
   GstCaps *caps;
   GstBuffer *buffer;
+  GstMapInfo map;
   guint n, bpf;
-  guint64 period_time;
   guint64 period_samples;
+  gboolean draining = FALSE;
 
   GST_DEBUG_OBJECT (interaudiosrc, "create");
 
-  buffer = NULL;
   caps = NULL;
 
-  g_mutex_lock (&interaudiosrc->surface->mutex);
-  if (interaudiosrc->surface->audio_info.finfo) {
-    if (!gst_audio_info_is_equal (&interaudiosrc->surface->audio_info,
-            &interaudiosrc->info)) {
-      caps = gst_audio_info_to_caps (&interaudiosrc->surface->audio_info);
+  /* When the sink switched to a new ring, first play out what is left in
+   * the old one. The sink does not write to it anymore, so this ends. */
+  if (g_atomic_pointer_get (&surface->audio_ring) != interaudiosrc->ring &&
+      interaudiosrc->ring && gst_audio_info_is_equal (&interaudiosrc->info,
+          &interaudiosrc->ring->info) &&
+      gst_inter_audio_ring_get_fill (interaudiosrc->ring) >=
+      interaudiosrc->info.bpf) {
+    GST_LOG_OBJECT (interaudiosrc, "draining the previous ring");
+    draining = TRUE;
+  }
+
+  /* the surface mutex is only needed when the sink side switched to a new
+   * ring, the samples themselves are read without locking */
+  if (!draining &&
+      g_atomic_pointer_get (&surface->audio_ring) != interaudiosrc->ring) {
+    g_mutex_lock (&surface->mutex);
+    if (interaudiosrc->ring)
+      gst_inter_audio_ring_unref (interaudiosrc->ring);
+    interaudiosrc->ring = surface->audio_ring ?
+        gst_inter_audio_ring_ref (surface->audio_ring) : NULL;
+    g_mutex_unlock (&surface->mutex);
+
+    interaudiosrc->primed = FALSE;
+    if (interaudiosrc->ring && !gst_audio_info_is_equal (&interaudiosrc->info,
+            &interaudiosrc->ring->info)) {
+      caps = gst_audio_info_to_caps (&interaudiosrc->ring->info);
       interaudiosrc->timestamp_offset +=
           gst_util_uint64_scale (interaudiosrc->n_samples, GST_SECOND,
           interaudiosrc->info.rate);
@@ -358,56 +465,49 @@ gst_inter_audio_src_create (GstBaseSrc * src, guint64 offset, guint size,
     }
   }
 
-  bpf = interaudiosrc->surface->audio_info.bpf;
-  period_time = interaudiosrc->surface->audio_period_time;
-  period_samples =
-      gst_util_uint64_scale (period_time, interaudiosrc->info.rate, GST_SECOND);
-
-  if (bpf > 0)
-    n = gst_adapter_available (interaudiosrc->surface->audio_adapter) / bpf;
-  else
-    n = 0;
-
-  if (n > period_samples)
-    n = period_samples;
-  if (n > 0) {
-    buffer = gst_adapter_take_buffer (interaudiosrc->surface->audio_adapter,
-        n * bpf);
-  } else {
-    buffer = gst_buffer_new ();
-    GST_BUFFER_FLAG_SET (buffer, GST_BUFFER_FLAG_GAP);
-  }
-  g_mutex_unlock (&interaudiosrc->surface->mutex);
-
   if (caps) {
     gboolean ret = gst_base_src_set_caps (src, caps);
-    gst_caps_unref (caps);
     if (!ret) {
       GST_ERROR_OBJECT (src, "Failed to set caps %" GST_PTR_FORMAT, caps);
-      if (buffer)
-        gst_buffer_unref (buffer);
+      gst_caps_unref (caps);
       return GST_FLOW_NOT_NEGOTIATED;
     }
+    gst_caps_unref (caps);
   }
 
-  buffer = gst_buffer_make_writable (buffer);
-
   bpf = interaudiosrc->info.bpf;
-  if (n < period_samples) {
-    GstMapInfo map;
-    GstMemory *mem;
+  period_samples = gst_util_uint64_scale (interaudiosrc->period_time,
+      interaudiosrc->info.rate, GST_SECOND);
+  period_samples = MAX (period_samples, 1);
+
+  buffer = gst_buffer_new_allocate (NULL, period_samples * bpf, NULL);
+  if (!gst_buffer_map (buffer, &map, GST_MAP_WRITE)) {
+    gst_buffer_unref (buffer);
+    GST_ELEMENT_ERROR (src, RESOURCE, WRITE, (NULL), ("Failed to map buffer"));
+    return GST_FLOW_ERROR;
+  }
 
+  n = 0;
+  if (draining)
+    n = gst_inter_audio_ring_read (interaudiosrc->ring, map.data,
+        period_samples * bpf) / bpf;
+  else if (interaudiosrc->ring &&
+      gst_audio_info_is_equal (&interaudiosrc->info,
+          &interaudiosrc->ring->info))
+    n = gst_inter_audio_src_read_ring (interaudiosrc, map.data,
+        period_samples);
+
+  if (n < period_samples) {
     GST_DEBUG_OBJECT (interaudiosrc,
         "creating %" G_GUINT64_FORMAT " samples of silence",
         period_samples - n);
-    mem = gst_allocator_alloc (NULL, (period_samples - n) * bpf, NULL);
-    if (gst_memory_map (mem, &map, GST_MAP_WRITE)) {
-      gst_audio_format_fill_silence (interaudiosrc->info.finfo, map.data,
-          map.size);
-      gst_memory_unmap (mem, &map);
-    }
-    gst_buffer_prepend_memory (buffer, mem);
+    gst_audio_format_fill_silence (interaudiosrc->info.finfo,
+        map.data + n * bpf, (period_samples - n) * bpf);
   }
+  gst_buffer_unmap (buffer, &map);
+
+  if (n == 0)
+    GST_BUFFER_FLAG_SET (buffer, GST_BUFFER_FLAG_GAP);
   n = period_samples;
 
   GST_BUFFER_OFFSET (buffer) = interaudiosrc->n_samples;
@@ -46,6 +46,11 @@ struct _GstInterAudioSrc
   GstClockTime timestamp_offset;
   GstAudioInfo info;
   guint64 buffer_time, latency_time, period_time;
+
+  /* the ring we read from, and the state of the drift compensation */
+  GstInterAudioRing *ring;
+  gboolean primed;
+  gdouble fill_avg;
 };
 
 struct _GstInterAudioSrcClass
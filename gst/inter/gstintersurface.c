@@ -48,7 +48,6 @@ gst_inter_surface_get (const char *name)
   surface->ref_count = 1;
   surface->name = g_strdup (name);
   g_mutex_init (&surface->mutex);
-  surface->audio_adapter = gst_adapter_new ();
   surface->audio_buffer_time = DEFAULT_AUDIO_BUFFER_TIME;
   surface->audio_latency_time = DEFAULT_AUDIO_LATENCY_TIME;
   surface->audio_period_time = DEFAULT_AUDIO_PERIOD_TIME;
@@ -79,10 +78,210 @@ gst_inter_surface_unref (GstInterSurface * surface)
 
     g_mutex_clear (&surface->mutex);
     gst_buffer_replace (&surface->video_buffer, NULL);
+    gst_inter_surface_video_frames_clear (surface);
+    g_free (surface->video_frames);
     gst_buffer_replace (&surface->sub_buffer, NULL);
-    gst_object_unref (surface->audio_adapter);
+    if (surface->audio_ring)
+      gst_inter_audio_ring_unref (surface->audio_ring);
     g_free (surface->name);
     g_free (surface);
   }
   g_mutex_unlock (&mutex);
 }
+
+void
+gst_inter_surface_video_frames_init (GstInterSurface * surface, guint size)
+{
+  gst_inter_surface_video_frames_clear (surface);
+
+  if (size != surface->video_frames_size) {
+    g_free (surface->video_frames);
+    surface->video_frames = g_new0 (GstInterVideoFrame, size);
+    surface->video_frames_size = size;
+  }
+  surface->video_frames_overwritten = 0;
+}
+
+void
+gst_inter_surface_video_frames_clear (GstInterSurface * surface)
+{
+  GstBuffer *buffer;
+
+  while ((buffer = gst_inter_surface_video_frames_pop (surface)))
+    gst_buffer_unref (buffer);
+  gst_object_replace ((GstObject **) & surface->video_frames_clock, NULL);
+}
+
+/* Takes ownership of @buffer. When the ring is full, the oldest frame is
+ * dropped to make room. */
+void
+gst_inter_surface_video_frames_push (GstInterSurface * surface,
+    GstBuffer * buffer, GstClockTime time)
+{
+  GstInterVideoFrame *frame;
+
+  g_return_if_fail (surface->video_frames_size > 0);
+
+  if (surface->video_frames_len == surface->video_frames_size) {
+    gst_buffer_unref (gst_inter_surface_video_frames_pop (surface));
+    surface->video_frames_overwritten++;
+  }
+
+  frame = &surface->video_frames[(surface->video_frames_head +
+          surface->video_frames_len) % surface->video_frames_size];
+  frame->buffer = buffer;
+  frame->time = time;
+  surface->video_frames_len++;
+}
+
+GstInterVideoFrame *
+gst_inter_surface_video_frames_peek (GstInterSurface * surface)
+{
+  if (surface->video_frames_len == 0)
+    return NULL;
+
+  return &surface->video_frames[surface->video_frames_head];
+}
+
+GstBuffer *
+gst_inter_surface_video_frames_pop (GstInterSurface * surface)
+{
+  GstInterVideoFrame *frame;
+  GstBuffer *buffer;
+
+  frame = gst_inter_surface_video_frames_peek (surface);
+  if (!frame)
+    return NULL;
+
+  buffer = frame->buffer;
+  frame->buffer = NULL;
+  surface->video_frames_head =
+      (surface->video_frames_head + 1) % surface->video_frames_size;
+  surface->video_frames_len--;
+
+  return buffer;
+}
+
+/* Creates a ring big enough for @buffer_time of audio in the format
+ * described by @info */
+GstInterAudioRing *
+gst_inter_audio_ring_new (const GstAudioInfo * info, guint64 buffer_time)
+{
+  GstInterAudioRing *ring;
+  guint64 samples;
+
+  g_return_val_if_fail (GST_AUDIO_INFO_BPF (info) > 0, NULL);
+
+  samples = gst_util_uint64_scale_ceil (buffer_time,
+      GST_AUDIO_INFO_RATE (info), GST_SECOND);
+  samples = CLAMP (samples, 1, G_MAXINT / 2 / GST_AUDIO_INFO_BPF (info));
+
+  ring = g_new0 (GstInterAudioRing, 1);
+  ring->ref_count = 1;
+  ring->info = *info;
+  ring->buffer_time = buffer_time;
+  ring->size = samples * GST_AUDIO_INFO_BPF (info);
+  ring->data = g_malloc (ring->size);
+
+  return ring;
+}
+
+GstInterAudioRing *
+gst_inter_audio_ring_ref (GstInterAudioRing * ring)
+{
+  g_atomic_int_inc (&ring->ref_count);
+
+  return ring;
+}
+
+void
+gst_inter_audio_ring_unref (GstInterAudioRing * ring)
+{
+  if (g_atomic_int_dec_and_test (&ring->ref_count)) {
+    g_free (ring->data);
+    g_free (ring);
+  }
+}
+
+/* Number of bytes written and not read yet. Exact for the reader, a lower
+ * bound of the free space for the writer. */
+guint
+gst_inter_audio_ring_get_fill (GstInterAudioRing * ring)
+{
+  guint write_pos = g_atomic_int_get (&ring->write_pos);
+  guint read_pos = g_atomic_int_get (&ring->read_pos);
+
+  if (write_pos >= read_pos)
+    return write_pos - read_pos;
+  else
+    return write_pos + 2 * ring->size - read_pos;
+}
+
+/* Positions run over twice the size of the ring, so that a full ring can be
+ * told apart from an empty one */
+static inline guint
+gst_inter_audio_ring_advance (GstInterAudioRing * ring, guint pos, guint size)
+{
+  return (pos + size) % (2 * ring->size);
+}
+
+/* Writer side: copies as much of @data as fits and returns the number of
+ * bytes written */
+guint
+gst_inter_audio_ring_write (GstInterAudioRing * ring, const guint8 * data,
+    guint size)
+{
+  guint write_pos = ring->write_pos;
+  guint offset, len;
+
+  size = MIN (size, ring->size - gst_inter_audio_ring_get_fill (ring));
+  if (size == 0)
+    return 0;
+
+  offset = write_pos % ring->size;
+  len = MIN (size, ring->size - offset);
+  memcpy (ring->data + offset, data, len);
+  memcpy (ring->data, data + len, size - len);
+
+  /* publishes the samples to the reader */
+  g_atomic_int_set (&ring->write_pos,
+      gst_inter_audio_ring_advance (ring, write_pos, size));
+
+  return size;
+}
+
+/* Reader side: copies up to @size bytes into @data and returns how many
+ * were read */
+guint
+gst_inter_audio_ring_read (GstInterAudioRing * ring, guint8 * data,
+    guint size)
+{
+  guint read_pos = ring->read_pos;
+  guint offset, len;
+
+  size = MIN (size, gst_inter_audio_ring_get_fill (ring));
+  if (size == 0)
+    return 0;
+
+  offset = read_pos % ring->size;
+  len = MIN (size, ring->size - offset);
+  memcpy (data, ring->data + offset, len);
+  memcpy (data + len, ring->data, size - len);
+
+  /* gives the space back to the writer */
+  g_atomic_int_set (&ring->read_pos,
+      gst_inter_audio_ring_advance (ring, read_pos, size));
+
+  return size;
+}
+
+/* Reader side: drops up to @size bytes and returns how many were dropped */
+guint
+gst_inter_audio_ring_skip (GstInterAudioRing * ring, guint size)
+{
+  size = MIN (size, gst_inter_audio_ring_get_fill (ring));
+  g_atomic_int_set (&ring->read_pos,
+      gst_inter_audio_ring_advance (ring, ring->read_pos, size));
+
+  return size;
+}
@@ -27,6 +27,34 @@
 G_BEGIN_DECLS
 
 typedef struct _GstInterSurface GstInterSurface;
+typedef struct _GstInterVideoFrame GstInterVideoFrame;
+typedef struct _GstInterAudioRing GstInterAudioRing;
+
+struct _GstInterVideoFrame
+{
+  GstBuffer *buffer;
+  /* clock time at which the frame was rendered */
+  GstClockTime time;
+};
+
+/* Single producer, single consumer ring of audio samples. Only
+ * interaudiosink writes and moves write_pos, only interaudiosrc reads and
+ * moves read_pos. Both are byte offsets modulo twice the size and are
+ * accessed atomically, so neither side needs the surface mutex to move
+ * samples. */
+struct _GstInterAudioRing
+{
+  gint ref_count;
+
+  GstAudioInfo info;
+  /* buffer-time the ring was sized for */
+  guint64 buffer_time;
+  guint8 *data;
+  guint size;
+
+  guint write_pos;
+  guint read_pos;
+};
 
 struct _GstInterSurface
 {
@@ -38,6 +66,16 @@ struct _GstInterSurface
   /* video */
   GstVideoInfo video_info;
   int video_buffer_count;
+  /* frames rendered but not taken by the src yet, oldest first. Only used
+   * instead of video_buffer when there is room for more than one frame */
+  GstInterVideoFrame *video_frames;
+  guint video_frames_size;
+  guint video_frames_head;
+  guint video_frames_len;
+  /* frames replaced before the src could take them */
+  guint64 video_frames_overwritten;
+  /* clock of the sink pipeline, which the frame times are on */
+  GstClock *video_frames_clock;
 
   /* audio */
   GstAudioInfo audio_info;
@@ -47,7 +85,9 @@ struct _GstInterSurface
 
   GstBuffer *video_buffer;
   GstBuffer *sub_buffer;
-  GstAdapter *audio_adapter;
+  /* replaced under the mutex when the format or the buffer-time of the src
+   * changes, each side keeps a reference to the ring it is using */
+  GstInterAudioRing *audio_ring;
 };
 
 #define DEFAULT_AUDIO_BUFFER_TIME  (GST_SECOND)
@@ -58,6 +98,27 @@ struct _GstInterSurface
 GstInterSurface * gst_inter_surface_get (const char *name);
 void gst_inter_surface_unref (GstInterSurface *surface);
 
+GstInterAudioRing * gst_inter_audio_ring_new (const GstAudioInfo *info,
+    guint64 buffer_time);
+GstInterAudioRing * gst_inter_audio_ring_ref (GstInterAudioRing *ring);
+void gst_inter_audio_ring_unref (GstInterAudioRing *ring);
+guint gst_inter_audio_ring_get_fill (GstInterAudioRing *ring);
+guint gst_inter_audio_ring_write (GstInterAudioRing *ring,
+    const guint8 *data, guint size);
+guint gst_inter_audio_ring_read (GstInterAudioRing *ring, guint8 *data,
+    guint size);
+guint gst_inter_audio_ring_skip (GstInterAudioRing *ring, guint size);
+
+/* must be called with the surface mutex held */
+void gst_inter_surface_video_frames_init (GstInterSurface *surface,
+    guint size);
+void gst_inter_surface_video_frames_clear (GstInterSurface *surface);
+void gst_inter_surface_video_frames_push (GstInterSurface *surface,
+    GstBuffer *buffer, GstClockTime time);
+GstInterVideoFrame * gst_inter_surface_video_frames_peek (
+    GstInterSurface *surface);
+GstBuffer * gst_inter_surface_video_frames_pop (GstInterSurface *surface);
+
 
 G_END_DECLS
 
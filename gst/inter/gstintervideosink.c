@@ -34,6 +34,16 @@
  * See the gstintertest.c example in the gst-plugins-bad source code for
  * more details.
  *
+ * By default only the last rendered frame is kept for intervideosrc. With
+ * #GstInterVideoSink:max-frames set to more than one, the last frames are
+ * kept together with the time at which they were rendered, and
+ * intervideosrc picks the one that matches the running time of each frame
+ * it outputs. This avoids dropping or repeating frames when the two
+ * pipelines jitter against each other. The rendering times are only
+ * comparable when both pipelines use the same clock, for example by
+ * setting the clock of one on the other with gst_pipeline_use_clock().
+ * Otherwise intervideosrc always outputs the newest frame.
+ *
  */
 
 #ifdef HAVE_CONFIG_H
@@ -66,10 +76,12 @@ static GstFlowReturn gst_inter_video_sink_show_frame (GstVideoSink * sink,
 enum
 {
   PROP_0,
-  PROP_CHANNEL
+  PROP_CHANNEL,
+  PROP_MAX_FRAMES
 };
 
 #define DEFAULT_CHANNEL ("default")
+#define DEFAULT_MAX_FRAMES 1
 
 /* pad templates */
 static GstStaticPadTemplate gst_inter_video_sink_sink_template =
@@ -118,12 +130,20 @@ gst_inter_video_sink_class_init (GstInterVideoSinkClass * klass)
       g_param_spec_string ("channel", "Channel",
           "Channel name to match inter src and sink elements",
           DEFAULT_CHANNEL, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_MAX_FRAMES,
+      g_param_spec_uint ("max-frames", "Max frames",
+          "Maximum number of frames kept for the inter src, which then "
+          "selects them by running time (1 = only keep the last one)",
+          1, 64, DEFAULT_MAX_FRAMES,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 }
 
 static void
 gst_inter_video_sink_init (GstInterVideoSink * intervideosink)
 {
   intervideosink->channel = g_strdup (DEFAULT_CHANNEL);
+  intervideosink->max_frames = DEFAULT_MAX_FRAMES;
 }
 
 void
@@ -137,6 +157,9 @@ gst_inter_video_sink_set_property (GObject * object, guint property_id,
       g_free (intervideosink->channel);
       intervideosink->channel = g_value_dup_string (value);
       break;
+    case PROP_MAX_FRAMES:
+      intervideosink->max_frames = g_value_get_uint (value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
       break;
@@ -153,6 +176,9 @@ gst_inter_video_sink_get_property (GObject * object, guint property_id,
     case PROP_CHANNEL:
       g_value_set_string (value, intervideosink->channel);
       break;
+    case PROP_MAX_FRAMES:
+      g_value_set_uint (value, intervideosink->max_frames);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
       break;
@@ -199,6 +225,8 @@ gst_inter_video_sink_start (GstBaseSink * sink)
   intervideosink->surface = gst_inter_surface_get (intervideosink->channel);
   g_mutex_lock (&intervideosink->surface->mutex);
   memset (&intervideosink->surface->video_info, 0, sizeof (GstVideoInfo));
+  gst_inter_surface_video_frames_init (intervideosink->surface,
+      intervideosink->max_frames);
   g_mutex_unlock (&intervideosink->surface->mutex);
 
   return TRUE;
@@ -214,6 +242,7 @@ gst_inter_video_sink_stop (GstBaseSink * sink)
     gst_buffer_unref (intervideosink->surface->video_buffer);
   }
   intervideosink->surface->video_buffer = NULL;
+  gst_inter_surface_video_frames_clear (intervideosink->surface);
   memset (&intervideosink->surface->video_info, 0, sizeof (GstVideoInfo));
   g_mutex_unlock (&intervideosink->surface->mutex);
 
@@ -246,17 +275,45 @@ static GstFlowReturn
 gst_inter_video_sink_show_frame (GstVideoSink * sink, GstBuffer * buffer)
 {
   GstInterVideoSink *intervideosink = GST_INTER_VIDEO_SINK (sink);
+  GstInterSurface *surface = intervideosink->surface;
 
   GST_DEBUG_OBJECT (intervideosink, "render ts %" GST_TIME_FORMAT,
       GST_TIME_ARGS (GST_BUFFER_PTS (buffer)));
 
-  g_mutex_lock (&intervideosink->surface->mutex);
-  if (intervideosink->surface->video_buffer) {
-    gst_buffer_unref (intervideosink->surface->video_buffer);
+  g_mutex_lock (&surface->mutex);
+  if (surface->video_frames_size > 1) {
+    GstClockTime time;
+
+    /* both pipelines may have different base times, so keep the clock time
+     * of the frame for intervideosrc to compare with its own */
+    time = gst_segment_to_running_time (&GST_BASE_SINK (sink)->segment,
+        GST_FORMAT_TIME, GST_BUFFER_PTS (buffer));
+    if (GST_CLOCK_TIME_IS_VALID (time))
+      time += gst_element_get_base_time (GST_ELEMENT (sink));
+
+    if (G_UNLIKELY (surface->video_frames_clock !=
+            GST_ELEMENT_CLOCK (sink))) {
+      GstClock *clock = gst_element_get_clock (GST_ELEMENT (sink));
+
+      gst_object_replace ((GstObject **) & surface->video_frames_clock,
+          (GstObject *) clock);
+      if (clock)
+        gst_object_unref (clock);
+    }
+
+    gst_inter_surface_video_frames_push (surface, gst_buffer_ref (buffer),
+        time);
+  } else {
+    if (surface->video_buffer) {
+      /* replaced before intervideosrc could output it */
+      if (surface->video_buffer_count == 0)
+        surface->video_frames_overwritten++;
+      gst_buffer_unref (surface->video_buffer);
+    }
+    surface->video_buffer = gst_buffer_ref (buffer);
   }
-  intervideosink->surface->video_buffer = gst_buffer_ref (buffer);
-  intervideosink->surface->video_buffer_count = 0;
-  g_mutex_unlock (&intervideosink->surface->mutex);
+  surface->video_buffer_count = 0;
+  g_mutex_unlock (&surface->mutex);
 
   return GST_FLOW_OK;
 }
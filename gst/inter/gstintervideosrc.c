@@ -32,6 +32,15 @@
  * The intersubsrc element cannot be used effectively with gst-launch-1.0,
  * as it requires a second pipeline in the application to send subtitles.
  *
+ * When the intervideosink keeps more than one frame (see
+ * #GstInterVideoSink:max-frames), each output frame is the newest one that
+ * was rendered at its running time or before. This needs both pipelines to
+ * use the same clock, otherwise the newest frame is output every time.
+ * Frames are shared with the sink pipeline, not copied. The
+ * #GstInterVideoSrc:frames-dropped and #GstInterVideoSrc:frames-duplicated
+ * properties count the frames that were never output and the frames that
+ * were output more than once.
+ *
  */
 
 #ifdef HAVE_CONFIG_H
@@ -71,7 +80,9 @@ enum
 {
   PROP_0,
   PROP_CHANNEL,
-  PROP_TIMEOUT
+  PROP_TIMEOUT,
+  PROP_FRAMES_DROPPED,
+  PROP_FRAMES_DUPLICATED
 };
 
 #define DEFAULT_CHANNEL ("default")
@@ -130,6 +141,17 @@ gst_inter_video_src_class_init (GstInterVideoSrcClass * klass)
           "Timeout after which to start outputting black frames",
           0, G_MAXUINT64, DEFAULT_TIMEOUT,
           G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_FRAMES_DROPPED,
+      g_param_spec_uint64 ("frames-dropped", "Frames dropped",
+          "Number of frames rendered by the inter sink that were never output",
+          0, G_MAXUINT64, 0, G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_FRAMES_DUPLICATED,
+      g_param_spec_uint64 ("frames-duplicated", "Frames duplicated",
+          "Number of times a frame was output again because no new one was "
+          "available", 0, G_MAXUINT64, 0,
+          G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
 }
 
 static void
@@ -175,6 +197,16 @@ gst_inter_video_src_get_property (GObject * object, guint property_id,
     case PROP_TIMEOUT:
       g_value_set_uint64 (value, intervideosrc->timeout);
       break;
+    case PROP_FRAMES_DROPPED:
+      GST_OBJECT_LOCK (intervideosrc);
+      g_value_set_uint64 (value, intervideosrc->frames_dropped);
+      GST_OBJECT_UNLOCK (intervideosrc);
+      break;
+    case PROP_FRAMES_DUPLICATED:
+      GST_OBJECT_LOCK (intervideosrc);
+      g_value_set_uint64 (value, intervideosrc->frames_duplicated);
+      GST_OBJECT_UNLOCK (intervideosrc);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
       break;
@@ -276,6 +308,12 @@ gst_inter_video_src_start (GstBaseSrc * src)
   intervideosrc->surface = gst_inter_surface_get (intervideosrc->channel);
   intervideosrc->timestamp_offset = 0;
   intervideosrc->n_frames = 0;
+  intervideosrc->warned_clock = FALSE;
+
+  GST_OBJECT_LOCK (intervideosrc);
+  intervideosrc->frames_dropped = 0;
+  intervideosrc->frames_duplicated = 0;
+  GST_OBJECT_UNLOCK (intervideosrc);
 
   return TRUE;
 }
@@ -290,6 +328,7 @@ gst_inter_video_src_stop (GstBaseSrc * src)
   gst_inter_surface_unref (intervideosrc->surface);
   intervideosrc->surface = NULL;
   gst_buffer_replace (&intervideosrc->black_frame, NULL);
+  gst_buffer_replace (&intervideosrc->last_frame, NULL);
 
   return TRUE;
 }
@@ -319,14 +358,44 @@ gst_inter_video_src_get_times (GstBaseSrc * src, GstBuffer * buffer,
   }
 }
 
+/* Takes the newest frame that was rendered at @target or before, dropping
+ * the older ones. Frames rendered after @target are left for the next
+ * calls, unless there is no previous frame to repeat instead. Must be
+ * called with the surface mutex held. */
+static GstBuffer *
+gst_inter_video_src_take_frame (GstInterVideoSrc * intervideosrc,
+    GstClockTime target, guint64 * dropped)
+{
+  GstInterSurface *surface = intervideosrc->surface;
+  GstInterVideoFrame *frame;
+  GstBuffer *buffer = NULL;
+
+  while ((frame = gst_inter_surface_video_frames_peek (surface))) {
+    if (GST_CLOCK_TIME_IS_VALID (target)
+        && GST_CLOCK_TIME_IS_VALID (frame->time) && frame->time > target
+        && (buffer || intervideosrc->last_frame))
+      break;
+
+    if (buffer) {
+      gst_buffer_unref (buffer);
+      (*dropped)++;
+    }
+    buffer = gst_inter_surface_video_frames_pop (surface);
+  }
+
+  return buffer;
+}
+
 static GstFlowReturn
 gst_inter_video_src_create (GstBaseSrc * src, guint64 offset, guint size,
     GstBuffer ** buf)
 {
   GstInterVideoSrc *intervideosrc = GST_INTER_VIDEO_SRC (src);
+  GstInterSurface *surface = intervideosrc->surface;
   GstCaps *caps;
   GstBuffer *buffer;
   guint64 frames;
+  guint64 dropped = 0, duplicated = 0;
   gboolean is_gap = FALSE;
 
   GST_DEBUG_OBJECT (intervideosrc, "create");
@@ -360,25 +429,83 @@ gst_inter_video_src_create (GstBaseSrc * src, guint64 offset, guint size,
     }
   }
 
-  if (intervideosrc->surface->video_buffer) {
-    /* We have a buffer to push */
-    buffer = gst_buffer_ref (intervideosrc->surface->video_buffer);
+  if (surface->video_frames_size > 1) {
+    GstClockTime target = GST_CLOCK_TIME_NONE;
+    gboolean same_clock;
+
+    /* rendering times on another clock cannot be compared with ours */
+    same_clock = surface->video_frames_clock == NULL ||
+        surface->video_frames_clock == GST_ELEMENT_CLOCK (src);
+    if (!same_clock && !intervideosrc->warned_clock) {
+      GST_WARNING_OBJECT (intervideosrc, "sink pipeline uses another clock, "
+          "outputting the newest frames");
+      intervideosrc->warned_clock = TRUE;
+    }
+
+    if (same_clock && GST_VIDEO_INFO_FPS_N (&intervideosrc->info) > 0) {
+      GstClockTime duration;
+
+      /* the clock time at which the frame we are creating will be shown,
+       * give or take half a frame */
+      duration = gst_util_uint64_scale (GST_SECOND,
+          GST_VIDEO_INFO_FPS_D (&intervideosrc->info),
+          GST_VIDEO_INFO_FPS_N (&intervideosrc->info));
+      target = gst_segment_to_running_time (&src->segment, GST_FORMAT_TIME,
+          intervideosrc->timestamp_offset +
+          gst_util_uint64_scale (GST_SECOND * intervideosrc->n_frames,
+              GST_VIDEO_INFO_FPS_D (&intervideosrc->info),
+              GST_VIDEO_INFO_FPS_N (&intervideosrc->info)));
+      if (GST_CLOCK_TIME_IS_VALID (target))
+        target += gst_element_get_base_time (GST_ELEMENT (src)) + duration / 2;
+    }
+
+    buffer = gst_inter_video_src_take_frame (intervideosrc, target, &dropped);
+    if (buffer) {
+      gst_buffer_replace (&intervideosrc->last_frame, buffer);
+    } else if (intervideosrc->last_frame) {
+      /* This is a repeat of the last frame */
+      buffer = gst_buffer_ref (intervideosrc->last_frame);
+      is_gap = TRUE;
+      duplicated++;
+    } else if (surface->video_buffer_count > frames + 1) {
+      /* This is a repeat of a black frame */
+      is_gap = TRUE;
+    }
 
     /* Can only be true if timeout > 0 */
-    if (intervideosrc->surface->video_buffer_count == frames) {
-      gst_buffer_unref (intervideosrc->surface->video_buffer);
-      intervideosrc->surface->video_buffer = NULL;
+    if (surface->video_buffer_count == frames)
+      gst_buffer_replace (&intervideosrc->last_frame, NULL);
+  } else {
+    if (surface->video_buffer) {
+      /* We have a buffer to push */
+      buffer = gst_buffer_ref (surface->video_buffer);
+
+      /* Can only be true if timeout > 0 */
+      if (surface->video_buffer_count == frames) {
+        gst_buffer_unref (surface->video_buffer);
+        surface->video_buffer = NULL;
+      }
     }
-  }
 
-  if (intervideosrc->surface->video_buffer_count != 0 &&
-      intervideosrc->surface->video_buffer_count != (frames + 1)) {
-    /* This is a repeat of the stored buffer or of a black frame */
-    is_gap = TRUE;
+    if (surface->video_buffer_count != 0 &&
+        surface->video_buffer_count != (frames + 1)) {
+      /* This is a repeat of the stored buffer or of a black frame */
+      is_gap = TRUE;
+      if (buffer)
+        duplicated++;
+    }
   }
 
-  intervideosrc->surface->video_buffer_count++;
-  g_mutex_unlock (&intervideosrc->surface->mutex);
+  dropped += surface->video_frames_overwritten;
+  surface->video_frames_overwritten = 0;
+
+  surface->video_buffer_count++;
+  g_mutex_unlock (&surface->mutex);
+
+  GST_OBJECT_LOCK (intervideosrc);
+  intervideosrc->frames_dropped += dropped;
+  intervideosrc->frames_duplicated += duplicated;
+  GST_OBJECT_UNLOCK (intervideosrc);
 
   if (caps) {
     gboolean ret;
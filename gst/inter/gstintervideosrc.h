@@ -48,6 +48,12 @@ struct _GstInterVideoSrc
   GstBuffer *black_frame;
   int n_frames;
   GstClockTime timestamp_offset;
+
+  /* last frame taken from the surface, for repeating it */
+  GstBuffer *last_frame;
+  guint64 frames_dropped;
+  guint64 frames_duplicated;
+  gboolean warned_clock;
 };
 
 struct _GstInterVideoSrcClass
@@ -50,6 +50,11 @@
  * 30000/1001 2:3:2:3... pattern telecined stream suitable for displaying film
  * content on NTSC.
  *
+ * Frames that map to exactly one output frame are pushed without copying
+ * their data.  Output frames woven from the fields of two input frames are
+ * allocated from an internal buffer pool, and the weave can be spread over
+ * several threads with the #GstInterlace:n-threads property.
+ *
  */
 
 
@@ -105,6 +110,21 @@ struct _GstInterlace
   int fields_since_timebase;
   guint pattern_offset;         /* initial offset into the pattern */
   gboolean passthrough;
+
+  /* output buffers for woven frames */
+  GstBufferPool *pool;
+
+  /* line table, indexed by plane, computed from the caps */
+  gint plane_start[GST_VIDEO_MAX_PLANES];
+  gint plane_lines[GST_VIDEO_MAX_PLANES];
+  gint total_lines;
+
+  /* weave threading */
+  guint n_threads;
+  GThreadPool *workers;
+  GMutex weave_lock;
+  GCond weave_cond;
+  guint weaves_pending;
 };
 
 struct _GstInterlaceClass
@@ -118,9 +138,12 @@ enum
   PROP_TOP_FIELD_FIRST,
   PROP_PATTERN,
   PROP_PATTERN_OFFSET,
-  PROP_ALLOW_RFF
+  PROP_ALLOW_RFF,
+  PROP_N_THREADS
 };
 
+#define DEFAULT_N_THREADS 1
+
 typedef enum
 {
   GST_INTERLACE_PATTERN_1_1,
@@ -243,6 +266,12 @@ gst_interlace_class_init (GstInterlaceClass * klass)
           "Allow generation of buffers with RFF flag set, i.e., duration of 3 fields",
           FALSE, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+  g_object_class_install_property (object_class, PROP_N_THREADS,
+      g_param_spec_uint ("n-threads", "Threads",
+          "Maximum number of threads used to weave fields "
+          "(0 = number of processors)", 0, G_MAXUINT, DEFAULT_N_THREADS,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
   gst_element_class_set_static_metadata (element_class,
       "Interlace filter", "Filter/Video",
       "Creates an interlaced video from progressive frames",
@@ -259,6 +288,18 @@ gst_interlace_class_init (GstInterlaceClass * klass)
 static void
 gst_interlace_finalize (GObject * obj)
 {
+  GstInterlace *interlace = GST_INTERLACE (obj);
+
+  if (interlace->workers)
+    g_thread_pool_free (interlace->workers, FALSE, TRUE);
+  g_mutex_clear (&interlace->weave_lock);
+  g_cond_clear (&interlace->weave_cond);
+
+  if (interlace->pool) {
+    gst_buffer_pool_set_active (interlace->pool, FALSE);
+    gst_object_unref (interlace->pool);
+  }
+
   G_OBJECT_CLASS (parent_class)->finalize (obj);
 }
 
@@ -295,6 +336,9 @@ gst_interlace_init (GstInterlace * interlace)
   interlace->allow_rff = FALSE;
   interlace->pattern = GST_INTERLACE_PATTERN_2_3;
   interlace->pattern_offset = 0;
+  interlace->n_threads = DEFAULT_N_THREADS;
+  g_mutex_init (&interlace->weave_lock);
+  g_cond_init (&interlace->weave_cond);
   gst_interlace_reset (interlace);
 }
 
@@ -368,6 +412,52 @@ gst_interlace_decorate_buffer (GstInterlace * interlace, GstBuffer * buf,
   }
 }
 
+/* Builds the table of lines to weave, all planes concatenated */
+static void
+gst_interlace_setup_lines (GstInterlace * interlace)
+{
+  GstVideoInfo *info = &interlace->info;
+  gint i, n_planes;
+
+  n_planes = GST_VIDEO_INFO_N_PLANES (info);
+
+  interlace->total_lines = 0;
+  for (i = 0; i < GST_VIDEO_MAX_PLANES; i++) {
+    interlace->plane_start[i] = interlace->total_lines;
+    interlace->plane_lines[i] =
+        (i < n_planes) ? GST_VIDEO_INFO_COMP_HEIGHT (info, i) : 0;
+    interlace->total_lines += interlace->plane_lines[i];
+  }
+}
+
+static gboolean
+gst_interlace_setup_pool (GstInterlace * interlace, GstCaps * caps)
+{
+  GstStructure *config;
+
+  if (interlace->pool) {
+    gst_buffer_pool_set_active (interlace->pool, FALSE);
+    gst_object_unref (interlace->pool);
+  }
+
+  interlace->pool = gst_video_buffer_pool_new ();
+  config = gst_buffer_pool_get_config (interlace->pool);
+  gst_buffer_pool_config_set_params (config, caps,
+      GST_VIDEO_INFO_SIZE (&interlace->info), 0, 0);
+  gst_buffer_pool_config_add_option (config,
+      GST_BUFFER_POOL_OPTION_VIDEO_META);
+
+  if (!gst_buffer_pool_set_config (interlace->pool, config) ||
+      !gst_buffer_pool_set_active (interlace->pool, TRUE)) {
+    GST_ERROR_OBJECT (interlace, "failed to set up buffer pool");
+    gst_object_unref (interlace->pool);
+    interlace->pool = NULL;
+    return FALSE;
+  }
+
+  return TRUE;
+}
+
 static gboolean
 gst_interlace_setcaps (GstInterlace * interlace, GstCaps * caps)
 {
@@ -419,6 +509,9 @@ gst_interlace_setcaps (GstInterlace * interlace, GstCaps * caps)
   gst_caps_unref (othercaps);
 
   interlace->info = info;
+  gst_interlace_setup_lines (interlace);
+  if (ret && !interlace->passthrough)
+    ret = gst_interlace_setup_pool (interlace, caps);
 
   return ret;
 
@@ -785,60 +878,178 @@ gst_interlace_src_query (GstPad * pad, GstObject * parent, GstQuery * query)
   return ret;
 }
 
+typedef struct
+{
+  GstInterlace *interlace;
+  GstVideoFrame *dframe;
+  /* frames supplying the lines of parity field_index, and the others */
+  GstVideoFrame *first;
+  GstVideoFrame *second;
+  gint field_index;
+  /* range of lines in the concatenated line table */
+  gint start;
+  gint end;
+} GstInterlaceWeaveJob;
+
 static void
-copy_field (GstInterlace * interlace, GstBuffer * dest, GstBuffer * src,
-    int field_index)
+gst_interlace_weave_plane_lines (GstVideoFrame * dframe,
+    GstVideoFrame * sframe, gint plane, gint first, gint last)
 {
-  GstVideoInfo *info = &interlace->info;
-  gint i, j, n_planes;
   guint8 *d, *s;
-  GstVideoFrame dframe, sframe;
+  gint j, ds, ss, cwidth;
 
-  if (!gst_video_frame_map (&dframe, info, dest, GST_MAP_WRITE))
-    goto dest_map_failed;
+  ds = GST_VIDEO_FRAME_PLANE_STRIDE (dframe, plane);
+  ss = GST_VIDEO_FRAME_PLANE_STRIDE (sframe, plane);
+  cwidth = MIN (ABS (ss), ABS (ds));
+
+  d = (guint8 *) GST_VIDEO_FRAME_PLANE_DATA (dframe, plane) + first * ds;
+  s = (guint8 *) GST_VIDEO_FRAME_PLANE_DATA (sframe, plane) + first * ss;
+
+  for (j = first; j < last; j += 2) {
+    memcpy (d, s, cwidth);
+    d += ds * 2;
+    s += ss * 2;
+  }
+}
 
-  if (!gst_video_frame_map (&sframe, info, src, GST_MAP_READ))
-    goto src_map_failed;
+static void
+gst_interlace_weave_lines (GstInterlaceWeaveJob * job)
+{
+  GstInterlace *interlace = job->interlace;
+  gint i, n_planes;
 
-  n_planes = GST_VIDEO_FRAME_N_PLANES (&dframe);
+  n_planes = GST_VIDEO_FRAME_N_PLANES (job->dframe);
 
   for (i = 0; i < n_planes; i++) {
-    gint cheight, cwidth;
-    gint ss, ds;
+    gint first, last;
 
-    d = GST_VIDEO_FRAME_PLANE_DATA (&dframe, i);
-    s = GST_VIDEO_FRAME_PLANE_DATA (&sframe, i);
+    first = MAX (job->start, interlace->plane_start[i]);
+    last = MIN (job->end, interlace->plane_start[i] +
+        interlace->plane_lines[i]);
+    if (first >= last)
+      continue;
 
-    ds = GST_VIDEO_FRAME_PLANE_STRIDE (&dframe, i);
-    ss = GST_VIDEO_FRAME_PLANE_STRIDE (&sframe, i);
+    first -= interlace->plane_start[i];
+    last -= interlace->plane_start[i];
 
-    d += field_index * ds;
-    s += field_index * ss;
+    /* one pass per field, each a run of strided copies */
+    gst_interlace_weave_plane_lines (job->dframe, job->first, i,
+        first + ((first ^ job->field_index) & 1), last);
+    gst_interlace_weave_plane_lines (job->dframe, job->second, i,
+        first + ((first ^ job->field_index ^ 1) & 1), last);
+  }
+}
+
+static void
+gst_interlace_weave_func (gpointer data, gpointer user_data)
+{
+  GstInterlace *interlace = user_data;
 
-    cheight = GST_VIDEO_FRAME_COMP_HEIGHT (&dframe, i);
-    cwidth = MIN (ABS (ss), ABS (ds));
+  gst_interlace_weave_lines (data);
 
-    for (j = field_index; j < cheight; j += 2) {
-      memcpy (d, s, cwidth);
-      d += ds * 2;
-      s += ss * 2;
+  g_mutex_lock (&interlace->weave_lock);
+  if (--interlace->weaves_pending == 0)
+    g_cond_signal (&interlace->weave_cond);
+  g_mutex_unlock (&interlace->weave_lock);
+}
+
+/* Creates an output frame with the lines of parity @field_index taken from
+ * @first and the others from @second. The lines are split into bands that
+ * are copied in parallel, the streaming thread taking the first band. */
+static GstFlowReturn
+gst_interlace_weave (GstInterlace * interlace, GstBuffer * first,
+    GstBuffer * second, gint field_index, GstBuffer ** outbuf)
+{
+  GstVideoInfo *info = &interlace->info;
+  GstVideoFrame dframe, fframe, sframe;
+  GstInterlaceWeaveJob *jobs;
+  GstBuffer *buf = NULL;
+  GstFlowReturn ret;
+  guint n_threads, n_jobs, i;
+  gint lines;
+
+  ret = gst_buffer_pool_acquire_buffer (interlace->pool, &buf, NULL);
+  if (ret != GST_FLOW_OK)
+    return ret;
+
+  if (!gst_video_frame_map (&dframe, info, buf, GST_MAP_WRITE))
+    goto dest_map_failed;
+  if (!gst_video_frame_map (&fframe, info, first, GST_MAP_READ))
+    goto first_map_failed;
+  if (!gst_video_frame_map (&sframe, info, second, GST_MAP_READ))
+    goto second_map_failed;
+
+  GST_OBJECT_LOCK (interlace);
+  n_threads = interlace->n_threads;
+  GST_OBJECT_UNLOCK (interlace);
+
+  if (n_threads == 0)
+    n_threads = g_get_num_processors ();
+  /* don't bother splitting into bands of less than a few dozen lines */
+  n_jobs = MIN (n_threads, MAX (interlace->total_lines / 64, 1));
+  lines = GST_ROUND_UP_2 ((interlace->total_lines + n_jobs - 1) / n_jobs);
+
+  jobs = g_newa (GstInterlaceWeaveJob, n_jobs);
+  for (i = 0; i < n_jobs; i++) {
+    jobs[i].interlace = interlace;
+    jobs[i].dframe = &dframe;
+    jobs[i].first = &fframe;
+    jobs[i].second = &sframe;
+    jobs[i].field_index = field_index;
+    jobs[i].start = MIN (i * lines, interlace->total_lines);
+    jobs[i].end = MIN ((i + 1) * lines, interlace->total_lines);
+  }
+
+  if (n_jobs > 1) {
+    if (interlace->workers == NULL) {
+      interlace->workers = g_thread_pool_new (gst_interlace_weave_func,
+          interlace, n_jobs - 1, FALSE, NULL);
+    } else if (g_thread_pool_get_max_threads (interlace->workers) <
+        (gint) n_jobs - 1) {
+      g_thread_pool_set_max_threads (interlace->workers, n_jobs - 1, NULL);
     }
+
+    interlace->weaves_pending = n_jobs - 1;
+    for (i = 1; i < n_jobs; i++)
+      g_thread_pool_push (interlace->workers, &jobs[i], NULL);
+  }
+
+  gst_interlace_weave_lines (&jobs[0]);
+
+  if (n_jobs > 1) {
+    g_mutex_lock (&interlace->weave_lock);
+    while (interlace->weaves_pending > 0)
+      g_cond_wait (&interlace->weave_cond, &interlace->weave_lock);
+    g_mutex_unlock (&interlace->weave_lock);
   }
 
-  gst_video_frame_unmap (&dframe);
   gst_video_frame_unmap (&sframe);
-  return;
+  gst_video_frame_unmap (&fframe);
+  gst_video_frame_unmap (&dframe);
+
+  *outbuf = buf;
+  return GST_FLOW_OK;
 
 dest_map_failed:
   {
     GST_ERROR_OBJECT (interlace, "failed to map dest");
-    return;
+    gst_buffer_unref (buf);
+    return GST_FLOW_ERROR;
   }
-src_map_failed:
+first_map_failed:
   {
     GST_ERROR_OBJECT (interlace, "failed to map src");
     gst_video_frame_unmap (&dframe);
-    return;
+    gst_buffer_unref (buf);
+    return GST_FLOW_ERROR;
+  }
+second_map_failed:
+  {
+    GST_ERROR_OBJECT (interlace, "failed to map src");
+    gst_video_frame_unmap (&fframe);
+    gst_video_frame_unmap (&dframe);
+    gst_buffer_unref (buf);
+    return GST_FLOW_ERROR;
   }
 }
 
@@ -920,18 +1131,19 @@ gst_interlace_chain (GstPad * pad, GstObject * parent, GstBuffer * buffer)
     if (interlace->stored_fields > 0) {
       GST_DEBUG ("1 field from stored, 1 from current");
 
-      output_buffer = gst_buffer_new_and_alloc (gst_buffer_get_size (buffer));
-      /* take the first field from the stored frame */
-      copy_field (interlace, output_buffer, interlace->stored_frame,
-          interlace->field_index);
+      /* take the first field from the stored frame and the second field
+       * from the incoming buffer */
+      ret = gst_interlace_weave (interlace, interlace->stored_frame, buffer,
+          interlace->field_index, &output_buffer);
+      if (ret != GST_FLOW_OK) {
+        GST_DEBUG_OBJECT (interlace, "Failed to weave fields");
+        break;
+      }
       interlace->stored_fields--;
-      /* take the second field from the incoming buffer */
-      copy_field (interlace, output_buffer, buffer, interlace->field_index ^ 1);
       current_fields--;
       n_output_fields = 2;
       interlaced = TRUE;
     } else {
-      output_buffer = gst_buffer_make_writable (gst_buffer_ref (buffer));
       if (num_fields >= 3 && interlace->allow_rff) {
         GST_DEBUG ("3 fields from current");
         /* take both fields from incoming buffer */
@@ -943,6 +1155,14 @@ gst_interlace_chain (GstPad * pad, GstObject * parent, GstBuffer * buffer)
         current_fields -= 2;
         n_output_fields = 2;
       }
+
+      if (current_fields == 0) {
+        /* last use of the incoming buffer, hand it on as is */
+        output_buffer = gst_buffer_make_writable (buffer);
+        buffer = NULL;
+      } else {
+        output_buffer = gst_buffer_make_writable (gst_buffer_ref (buffer));
+      }
     }
     num_fields -= n_output_fields;
 
@@ -981,7 +1201,7 @@ gst_interlace_chain (GstPad * pad, GstObject * parent, GstBuffer * buffer)
   if (current_fields > 0) {
     interlace->stored_frame = buffer;
     interlace->stored_fields = current_fields;
-  } else {
+  } else if (buffer) {
     gst_buffer_unref (buffer);
   }
   return ret;
@@ -1006,6 +1226,11 @@ gst_interlace_set_property (GObject * object,
     case PROP_ALLOW_RFF:
       interlace->allow_rff = g_value_get_boolean (value);
       break;
+    case PROP_N_THREADS:
+      GST_OBJECT_LOCK (interlace);
+      interlace->n_threads = g_value_get_uint (value);
+      GST_OBJECT_UNLOCK (interlace);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -1031,6 +1256,11 @@ gst_interlace_get_property (GObject * object,
     case PROP_ALLOW_RFF:
       g_value_set_boolean (value, interlace->allow_rff);
       break;
+    case PROP_N_THREADS:
+      GST_OBJECT_LOCK (interlace);
+      g_value_set_uint (value, interlace->n_threads);
+      GST_OBJECT_UNLOCK (interlace);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -1040,7 +1270,8 @@ gst_interlace_get_property (GObject * object,
 static GstStateChangeReturn
 gst_interlace_change_state (GstElement * element, GstStateChange transition)
 {
-  //GstInterlace *interlace = GST_INTERLACE (element);
+  GstInterlace *interlace = GST_INTERLACE (element);
+  GstStateChangeReturn ret;
 
   switch (transition) {
     case GST_STATE_CHANGE_PAUSED_TO_READY:
@@ -1050,7 +1281,22 @@ gst_interlace_change_state (GstElement * element, GstStateChange transition)
       break;
   }
 
-  return GST_ELEMENT_CLASS (parent_class)->change_state (element, transition);
+  ret = GST_ELEMENT_CLASS (parent_class)->change_state (element, transition);
+
+  switch (transition) {
+    case GST_STATE_CHANGE_PAUSED_TO_READY:
+      /* streaming has stopped, a new pool is set up with the next caps */
+      if (interlace->pool) {
+        gst_buffer_pool_set_active (interlace->pool, FALSE);
+        gst_object_unref (interlace->pool);
+        interlace->pool = NULL;
+      }
+      break;
+    default:
+      break;
+  }
+
+  return ret;
 }
 
 static gboolean
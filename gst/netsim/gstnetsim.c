@@ -28,6 +28,7 @@
 #endif
 
 #include "gstnetsim.h"
+#include <stdio.h>
 #include <string.h>
 #include <math.h>
 #include <float.h>
@@ -66,6 +67,7 @@ enum
   PROP_MAX_KBPS,
   PROP_MAX_BUCKET_SIZE,
   PROP_ALLOW_REORDERING,
+  PROP_TRACE_FILE,
 };
 
 /* these numbers are nothing but wild guesses and dont reflect any reality */
@@ -79,6 +81,15 @@ enum
 #define DEFAULT_MAX_KBPS -1
 #define DEFAULT_MAX_BUCKET_SIZE -1
 #define DEFAULT_ALLOW_REORDERING TRUE
+#define DEFAULT_TRACE_FILE NULL
+
+/* room for this many delayed buffers is allocated upfront */
+#define DELAYED_PREALLOC 1024
+
+/* a delivery opportunity of a Mahimahi trace lets one MTU sized packet
+ * through, and the bucket of such traces holds one when max-bucket-size is
+ * unlimited */
+#define TRACE_MTU_BITS (1500 * 8)
 
 static GstStaticPadTemplate gst_net_sim_sink_template =
 GST_STATIC_PAD_TEMPLATE ("sink",
@@ -98,8 +109,7 @@ static gboolean
 gst_net_sim_source_dispatch (GSource * source,
     GSourceFunc callback, gpointer user_data)
 {
-  callback (user_data);
-  return FALSE;
+  return callback (user_data);
 }
 
 GSourceFuncs gst_net_sim_source_funcs = {
@@ -109,6 +119,106 @@ GSourceFuncs gst_net_sim_source_funcs = {
   NULL                          /* finalize */
 };
 
+static inline gboolean
+delayed_buffer_before (const GstNetSimDelayedBuffer * a,
+    const GstNetSimDelayedBuffer * b)
+{
+  if (a->ready_time != b->ready_time)
+    return a->ready_time < b->ready_time;
+  return a->seqnum < b->seqnum;
+}
+
+static void
+delayed_heap_push (GArray * heap, const GstNetSimDelayedBuffer * item)
+{
+  GstNetSimDelayedBuffer *items;
+  guint i, parent;
+
+  g_array_append_vals (heap, item, 1);
+  items = (GstNetSimDelayedBuffer *) heap->data;
+
+  for (i = heap->len - 1; i > 0; i = parent) {
+    parent = (i - 1) / 2;
+    if (!delayed_buffer_before (&items[i], &items[parent]))
+      break;
+    items[i] = items[parent];
+    items[parent] = *item;
+  }
+}
+
+static void
+delayed_heap_pop (GArray * heap, GstNetSimDelayedBuffer * item)
+{
+  GstNetSimDelayedBuffer *items = (GstNetSimDelayedBuffer *) heap->data;
+  GstNetSimDelayedBuffer tmp;
+  guint i, child;
+
+  *item = items[0];
+  items[0] = items[heap->len - 1];
+  g_array_set_size (heap, heap->len - 1);
+
+  for (i = 0; (child = 2 * i + 1) < heap->len; i = child) {
+    if (child + 1 < heap->len &&
+        delayed_buffer_before (&items[child + 1], &items[child]))
+      child++;
+    if (!delayed_buffer_before (&items[child], &items[i]))
+      break;
+    tmp = items[i];
+    items[i] = items[child];
+    items[child] = tmp;
+  }
+}
+
+static void
+gst_net_sim_clear_delayed (GstNetSim * netsim)
+{
+  GstNetSimDelayedBuffer item;
+
+  while (netsim->delayed->len > 0) {
+    delayed_heap_pop (netsim->delayed, &item);
+    gst_buffer_unref (item.buf);
+  }
+}
+
+/* Called from the main loop when the earliest delayed buffer is due. All
+ * buffers that are due by now get pushed together as one list. */
+static gboolean
+gst_net_sim_push_delayed (GstNetSim * netsim)
+{
+  GstBufferList *list = NULL;
+  GstNetSimDelayedBuffer item;
+  gint64 now = g_get_monotonic_time ();
+
+  g_mutex_lock (&netsim->loop_mutex);
+  while (netsim->delayed->len > 0 &&
+      g_array_index (netsim->delayed, GstNetSimDelayedBuffer,
+          0).ready_time <= now) {
+    delayed_heap_pop (netsim->delayed, &item);
+    if (list == NULL)
+      list = gst_buffer_list_new ();
+    gst_buffer_list_add (list, item.buf);
+  }
+  g_source_set_ready_time (netsim->delay_source, netsim->delayed->len > 0 ?
+      g_array_index (netsim->delayed, GstNetSimDelayedBuffer, 0).ready_time :
+      -1);
+  g_mutex_unlock (&netsim->loop_mutex);
+
+  if (list == NULL)
+    return G_SOURCE_CONTINUE;
+
+  GST_DEBUG_OBJECT (netsim, "Pushing %u delayed buffers now",
+      gst_buffer_list_length (list));
+  if (gst_buffer_list_length (list) == 1) {
+    gst_pad_push (netsim->srcpad,
+        gst_buffer_ref (gst_buffer_list_get (list, 0)));
+    gst_buffer_list_unref (list);
+  } else {
+    gst_pad_push_list (netsim->srcpad, list);
+  }
+
+  return G_SOURCE_CONTINUE;
+}
+
 static void
 gst_net_sim_loop (GstNetSim * netsim)
 {
@@ -147,6 +257,10 @@ _main_loop_quit_and_remove_source (gpointer user_data)
   return FALSE;                 /* Remove source */
 }
 
+static void gst_net_sim_trace_clear (GstNetSim * netsim);
+static gboolean gst_net_sim_trace_load (GstNetSim * netsim,
+    const gchar * filename, GError ** error);
+
 static gboolean
 gst_net_sim_src_activatemode (GstPad * pad, GstObject * parent,
     GstPadMode mode, gboolean active)
@@ -154,11 +268,40 @@ gst_net_sim_src_activatemode (GstPad * pad, GstObject * parent,
   GstNetSim *netsim = GST_NET_SIM (parent);
   gboolean result = FALSE;
 
+  if (active) {
+    GError *err = NULL;
+    gchar *trace_file;
+
+    GST_OBJECT_LOCK (netsim);
+    trace_file = g_strdup (netsim->trace_file);
+    GST_OBJECT_UNLOCK (netsim);
+
+    gst_net_sim_trace_clear (netsim);
+    if (trace_file && !gst_net_sim_trace_load (netsim, trace_file, &err)) {
+      GST_ELEMENT_ERROR (netsim, RESOURCE, READ,
+          ("Could not load trace file \"%s\".", trace_file),
+          ("%s", err->message));
+      g_clear_error (&err);
+      g_free (trace_file);
+      return FALSE;
+    }
+    if (trace_file && netsim->max_bucket_size == -1 &&
+        netsim->trace_opportunities->len > 0)
+      netsim->bucket_size = TRACE_MTU_BITS;
+    g_free (trace_file);
+  }
+
   g_mutex_lock (&netsim->loop_mutex);
   if (active) {
     if (netsim->main_loop == NULL) {
       GMainContext *main_context = g_main_context_new ();
       netsim->main_loop = g_main_loop_new (main_context, FALSE);
+
+      netsim->delay_source = g_source_new (&gst_net_sim_source_funcs,
+          sizeof (GSource));
+      g_source_set_callback (netsim->delay_source,
+          (GSourceFunc) gst_net_sim_push_delayed, netsim, NULL);
+      g_source_attach (netsim->delay_source, main_context);
       g_main_context_unref (main_context);
 
       GST_TRACE_OBJECT (netsim, "ACT: Starting task on srcpad");
@@ -198,6 +341,11 @@ gst_net_sim_src_activatemode (GstPad * pad, GstObject * parent,
       GST_TRACE_OBJECT (netsim, "DEACT: Stopping task on srcpad");
       result = gst_pad_stop_task (netsim->srcpad);
       GST_TRACE_OBJECT (netsim, "DEACT: Mainloop and GstTask stopped");
+
+      g_source_destroy (netsim->delay_source);
+      g_source_unref (netsim->delay_source);
+      netsim->delay_source = NULL;
+      gst_net_sim_clear_delayed (netsim);
     }
   }
   g_mutex_unlock (&netsim->loop_mutex);
@@ -205,39 +353,6 @@ gst_net_sim_src_activatemode (GstPad * pad, GstObject * parent,
   return result;
 }
 
-typedef struct
-{
-  GstPad *pad;
-  GstBuffer *buf;
-} PushBufferCtx;
-
-static inline PushBufferCtx *
-push_buffer_ctx_new (GstPad * pad, GstBuffer * buf)
-{
-  PushBufferCtx *ctx = g_slice_new (PushBufferCtx);
-  ctx->pad = gst_object_ref (pad);
-  ctx->buf = gst_buffer_ref (buf);
-  return ctx;
-}
-
-static inline void
-push_buffer_ctx_free (PushBufferCtx * ctx)
-{
-  if (G_LIKELY (ctx != NULL)) {
-    gst_buffer_unref (ctx->buf);
-    gst_object_unref (ctx->pad);
-    g_slice_free (PushBufferCtx, ctx);
-  }
-}
-
-static gboolean
-push_buffer_ctx_push (PushBufferCtx * ctx)
-{
-  GST_DEBUG_OBJECT (ctx->pad, "Pushing buffer now");
-  gst_pad_push (ctx->pad, gst_buffer_ref (ctx->buf));
-  return FALSE;
-}
-
 static gint
 get_random_value_uniform (GRand * rand_seed, gint32 min_value, gint32 max_value)
 {
@@ -327,18 +442,16 @@ get_random_value_gamma (GRand * rand_seed, gint32 low, gint32 high,
 }
 
 static GstFlowReturn
-gst_net_sim_delay_buffer (GstNetSim * netsim, GstBuffer * buf)
+gst_net_sim_delay_buffer (GstNetSim * netsim, GstBuffer * buf,
+    gint base_delay)
 {
   GstFlowReturn ret = GST_FLOW_OK;
+  gboolean delayed = FALSE;
+  gint delay = 0;
 
   g_mutex_lock (&netsim->loop_mutex);
   if (netsim->main_loop != NULL && netsim->delay_probability > 0 &&
       g_rand_double (netsim->rand_seed) < netsim->delay_probability) {
-    gint delay;
-    PushBufferCtx *ctx;
-    GSource *source;
-    gint64 ready_time, now_time;
-
     switch (netsim->delay_distribution) {
       case DISTRIBUTION_UNIFORM:
         delay = get_random_value_uniform (netsim->rand_seed, netsim->min_delay,
@@ -359,10 +472,18 @@ gst_net_sim_delay_buffer (GstNetSim * netsim, GstBuffer * buf)
 
     if (delay < 0)
       delay = 0;
+    delayed = TRUE;
+  }
 
-    ctx = push_buffer_ctx_new (netsim->srcpad, buf);
+  if (netsim->main_loop != NULL && base_delay > 0) {
+    delay += base_delay;
+    delayed = TRUE;
+  }
+
+  if (delayed) {
+    GstNetSimDelayedBuffer item;
+    gint64 ready_time, now_time;
 
-    source = g_source_new (&gst_net_sim_source_funcs, sizeof (GSource));
     now_time = g_get_monotonic_time ();
     ready_time = now_time + delay * 1000;
     if (!netsim->allow_reordering && ready_time < netsim->last_ready_time)
@@ -372,11 +493,15 @@ gst_net_sim_delay_buffer (GstNetSim * netsim, GstBuffer * buf)
     GST_DEBUG_OBJECT (netsim, "Delaying packet by %" G_GINT64_FORMAT "ms",
         (ready_time - now_time) / 1000);
 
-    g_source_set_ready_time (source, ready_time);
-    g_source_set_callback (source, (GSourceFunc) push_buffer_ctx_push,
-        ctx, (GDestroyNotify) push_buffer_ctx_free);
-    g_source_attach (source, g_main_loop_get_context (netsim->main_loop));
-    g_source_unref (source);
+    item.ready_time = ready_time;
+    item.seqnum = netsim->delayed_seqnum++;
+    item.buf = gst_buffer_ref (buf);
+    delayed_heap_push (netsim->delayed, &item);
+
+    /* only wake up the loop when the new buffer is the first one due */
+    if (g_array_index (netsim->delayed, GstNetSimDelayedBuffer,
+            0).seqnum == item.seqnum)
+      g_source_set_ready_time (netsim->delay_source, ready_time);
   } else {
     ret = gst_pad_push (netsim->srcpad, gst_buffer_ref (buf));
   }
@@ -385,28 +510,194 @@ gst_net_sim_delay_buffer (GstNetSim * netsim, GstBuffer * buf)
   return ret;
 }
 
-static gint
-gst_net_sim_get_tokens (GstNetSim * netsim)
+static GstClockTime
+gst_net_sim_get_time (GstNetSim * netsim)
 {
-  gint tokens = 0;
-  GstClockTimeDiff elapsed_time = 0;
   GstClockTime current_time = 0;
-  GstClockTimeDiff token_time;
   GstClock *clock;
 
-  /* check for umlimited kbps and fill up the bucket if that is the case,
-   * if not, calculate the number of tokens to add based on the elapsed time */
-  if (netsim->max_kbps == -1)
-    return netsim->max_bucket_size * 1000 - netsim->bucket_size;
-
-  /* get the current time */
   clock = gst_element_get_clock (GST_ELEMENT_CAST (netsim));
   if (clock == NULL) {
     GST_WARNING_OBJECT (netsim, "No clock, can't get the time");
   } else {
     current_time = gst_clock_get_time (clock);
+    gst_object_unref (clock);
+  }
+
+  return current_time;
+}
+
+static void
+gst_net_sim_trace_clear (GstNetSim * netsim)
+{
+  g_clear_pointer (&netsim->trace_opportunities, g_array_unref);
+  g_clear_pointer (&netsim->trace_steps, g_array_unref);
+  netsim->trace_period = 0;
+}
+
+/* Each line of a trace is either a single timestamp in ms, a delivery
+ * opportunity for one MTU sized packet as in Mahimahi traces, or
+ * "<ms> <kbps> <delay-ms> <loss-probability>" changing the conditions from
+ * that time on. The last timestamp is the period after which the trace
+ * starts over. */
+static gboolean
+gst_net_sim_trace_load (GstNetSim * netsim, const gchar * filename,
+    GError ** error)
+{
+  gchar *contents;
+  gchar **lines;
+  guint64 last_ms = 0;
+  guint i;
+  gboolean ret = TRUE;
+
+  if (!g_file_get_contents (filename, &contents, NULL, error))
+    return FALSE;
+
+  netsim->trace_opportunities = g_array_new (FALSE, FALSE,
+      sizeof (GstClockTime));
+  netsim->trace_steps = g_array_new (FALSE, FALSE,
+      sizeof (GstNetSimTraceStep));
+
+  lines = g_strsplit (contents, "\n", -1);
+  g_free (contents);
+
+  for (i = 0; lines[i] != NULL; i++) {
+    gchar *line = g_strstrip (lines[i]);
+    GstNetSimTraceStep step;
+    guint64 ms;
+    gint n;
+
+    if (*line == '\0' || *line == '#')
+      continue;
+
+    n = sscanf (line, "%" G_GUINT64_FORMAT " %d %d %lf", &ms, &step.kbps,
+        &step.delay, &step.loss);
+    if ((n != 1 && n != 4) || ms < last_ms || (n == 4 && (step.kbps < -1 ||
+                step.loss < 0.0 || step.loss > 1.0))) {
+      g_set_error (error, G_FILE_ERROR, G_FILE_ERROR_INVAL,
+          "Invalid line %u in trace '%s': %s", i + 1, filename, line);
+      ret = FALSE;
+      break;
+    }
+    last_ms = ms;
+
+    if (n == 1) {
+      GstClockTime time = ms * GST_MSECOND;
+
+      g_array_append_val (netsim->trace_opportunities, time);
+    } else {
+      step.time = ms * GST_MSECOND;
+      g_array_append_val (netsim->trace_steps, step);
+    }
+  }
+  g_strfreev (lines);
+
+  if (ret && last_ms == 0) {
+    g_set_error (error, G_FILE_ERROR, G_FILE_ERROR_INVAL,
+        "Trace '%s' does not last any time", filename);
+    ret = FALSE;
+  }
+
+  if (!ret) {
+    gst_net_sim_trace_clear (netsim);
+    return FALSE;
+  }
+
+  netsim->trace_period = last_ms * GST_MSECOND;
+  netsim->trace_start = GST_CLOCK_TIME_NONE;
+  netsim->trace_loop_start = 0;
+  netsim->trace_index = 0;
+
+  GST_INFO_OBJECT (netsim, "Loaded trace '%s': %u delivery opportunities, "
+      "%u steps, period %" GST_TIME_FORMAT, filename,
+      netsim->trace_opportunities->len, netsim->trace_steps->len,
+      GST_TIME_ARGS (netsim->trace_period));
+
+  return TRUE;
+}
+
+static GstClockTime
+gst_net_sim_trace_elapsed (GstNetSim * netsim, GstClockTime current_time)
+{
+  if (!GST_CLOCK_TIME_IS_VALID (netsim->trace_start))
+    netsim->trace_start = current_time;
+
+  if (current_time < netsim->trace_start)
+    return 0;
+
+  return current_time - netsim->trace_start;
+}
+
+/* The step in effect at @current_time, the one before the first step of a
+ * period being the last step of the previous period */
+static const GstNetSimTraceStep *
+gst_net_sim_trace_get_step (GstNetSim * netsim, GstClockTime current_time)
+{
+  GstNetSimTraceStep *steps;
+  GstClockTime pos;
+  guint lo, hi, mid;
+
+  if (netsim->trace_steps == NULL || netsim->trace_steps->len == 0)
+    return NULL;
+
+  steps = (GstNetSimTraceStep *) netsim->trace_steps->data;
+  pos = gst_net_sim_trace_elapsed (netsim, current_time) %
+      netsim->trace_period;
+
+  lo = 0;
+  hi = netsim->trace_steps->len;
+  while (lo < hi) {
+    mid = (lo + hi) / 2;
+    if (steps[mid].time <= pos)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+
+  return &steps[lo == 0 ? netsim->trace_steps->len - 1 : lo - 1];
+}
+
+/* Tokens for the delivery opportunities passed since the last call */
+static gint
+gst_net_sim_trace_get_tokens (GstNetSim * netsim, GstClockTime current_time)
+{
+  GstClockTime *times = (GstClockTime *) netsim->trace_opportunities->data;
+  guint n_times = netsim->trace_opportunities->len;
+  GstClockTime elapsed;
+  guint64 count = 0, loops;
+
+  elapsed = gst_net_sim_trace_elapsed (netsim, current_time);
+
+  /* finish the current period and skip over the whole ones that passed */
+  if (elapsed >= netsim->trace_loop_start + netsim->trace_period) {
+    loops = (elapsed - netsim->trace_loop_start) / netsim->trace_period;
+    count += n_times - netsim->trace_index + (loops - 1) * n_times;
+    netsim->trace_loop_start += loops * netsim->trace_period;
+    netsim->trace_index = 0;
+  }
+
+  while (netsim->trace_index < n_times &&
+      netsim->trace_loop_start + times[netsim->trace_index] <= elapsed) {
+    netsim->trace_index++;
+    count++;
   }
 
+  return MIN (count, G_MAXINT / TRACE_MTU_BITS) * TRACE_MTU_BITS;
+}
+
+static gint
+gst_net_sim_get_tokens (GstNetSim * netsim, GstClockTime current_time,
+    gint max_kbps, gsize max_tokens)
+{
+  gint tokens = 0;
+  GstClockTimeDiff elapsed_time = 0;
+  GstClockTimeDiff token_time;
+
+  /* check for umlimited kbps and fill up the bucket if that is the case,
+   * if not, calculate the number of tokens to add based on the elapsed time */
+  if (max_kbps == -1)
+    return max_tokens - netsim->bucket_size;
+
   /* get the elapsed time */
   if (GST_CLOCK_TIME_IS_VALID (netsim->prev_time)) {
     if (current_time < netsim->prev_time) {
@@ -420,39 +711,52 @@ gst_net_sim_get_tokens (GstNetSim * netsim)
 
   /* calculate number of tokens and how much time is "spent" by these tokens */
   tokens =
-      gst_util_uint64_scale_int (elapsed_time, netsim->max_kbps * 1000,
-      GST_SECOND);
-  token_time =
-      gst_util_uint64_scale_int (GST_SECOND, tokens, netsim->max_kbps * 1000);
+      gst_util_uint64_scale_int (elapsed_time, max_kbps * 1000, GST_SECOND);
+  token_time = gst_util_uint64_scale_int (GST_SECOND, tokens, max_kbps * 1000);
 
   /* increment the time with how much we spent in terms of whole tokens */
   netsim->prev_time += token_time;
-  gst_object_unref (clock);
   return tokens;
 }
 
 static gboolean
-gst_net_sim_token_bucket (GstNetSim * netsim, GstBuffer * buf)
+gst_net_sim_token_bucket (GstNetSim * netsim, GstBuffer * buf,
+    GstClockTime current_time, const GstNetSimTraceStep * step)
 {
-  gsize buffer_size;
+  gsize buffer_size, max_tokens;
+  gboolean opportunities;
   gint tokens;
 
-  /* with an unlimited bucket-size, we have nothing to do */
-  if (netsim->max_bucket_size == -1)
+  opportunities = netsim->trace_period > 0 &&
+      netsim->trace_opportunities->len > 0;
+
+  /* with an unlimited bucket-size and no trace, we have nothing to do. With
+   * a trace of kbps steps, the bucket is unbounded and only the average
+   * rate is limited. */
+  if (netsim->max_bucket_size != -1)
+    max_tokens = netsim->max_bucket_size * 1000;
+  else if (opportunities)
+    max_tokens = TRACE_MTU_BITS;
+  else if (netsim->trace_period > 0)
+    max_tokens = G_MAXINT;
+  else
     return TRUE;
 
   /* get buffer size in bits */
   buffer_size = gst_buffer_get_size (buf) * 8;
-  tokens = gst_net_sim_get_tokens (netsim);
+  if (opportunities)
+    tokens = gst_net_sim_trace_get_tokens (netsim, current_time);
+  else
+    tokens = gst_net_sim_get_tokens (netsim, current_time,
+        step ? step->kbps : netsim->max_kbps, max_tokens);
 
   netsim->bucket_size = MIN (G_MAXINT, netsim->bucket_size + tokens);
   GST_LOG_OBJECT (netsim,
       "Adding %d tokens to bucket (contains %" G_GSIZE_FORMAT " tokens)",
       tokens, netsim->bucket_size);
 
-  if (netsim->max_bucket_size != -1 && netsim->bucket_size >
-      netsim->max_bucket_size * 1000)
-    netsim->bucket_size = netsim->max_bucket_size * 1000;
+  if (netsim->bucket_size > max_tokens)
+    netsim->bucket_size = max_tokens;
 
   if (buffer_size > netsim->bucket_size) {
     GST_DEBUG_OBJECT (netsim,
@@ -473,11 +777,26 @@ gst_net_sim_chain (GstPad * pad, GstObject * parent, GstBuffer * buf)
 {
   GstNetSim *netsim = GST_NET_SIM (parent);
   GstFlowReturn ret = GST_FLOW_OK;
+  const GstNetSimTraceStep *step = NULL;
+  GstClockTime current_time = 0;
+  gint base_delay = 0;
+
+  if (netsim->max_bucket_size != -1 || netsim->trace_period > 0)
+    current_time = gst_net_sim_get_time (netsim);
+
+  if (netsim->trace_period > 0) {
+    step = gst_net_sim_trace_get_step (netsim, current_time);
+    if (step)
+      base_delay = step->delay;
+  }
 
-  if (!gst_net_sim_token_bucket (netsim, buf))
+  if (!gst_net_sim_token_bucket (netsim, buf, current_time, step))
     goto done;
 
-  if (netsim->drop_packets > 0) {
+  if (step && step->loss > 0 &&
+      g_rand_double (netsim->rand_seed) < step->loss) {
+    GST_DEBUG_OBJECT (netsim, "Dropping packet as the trace says");
+  } else if (netsim->drop_packets > 0) {
     netsim->drop_packets--;
     GST_DEBUG_OBJECT (netsim, "Dropping packet (%d left)",
         netsim->drop_packets);
@@ -489,10 +808,10 @@ gst_net_sim_chain (GstPad * pad, GstObject * parent, GstBuffer * buf)
       g_rand_double (netsim->rand_seed) <
       (gdouble) netsim->duplicate_probability) {
     GST_DEBUG_OBJECT (netsim, "Duplicating packet");
-    gst_net_sim_delay_buffer (netsim, buf);
-    ret = gst_net_sim_delay_buffer (netsim, buf);
+    gst_net_sim_delay_buffer (netsim, buf, base_delay);
+    ret = gst_net_sim_delay_buffer (netsim, buf, base_delay);
   } else {
-    ret = gst_net_sim_delay_buffer (netsim, buf);
+    ret = gst_net_sim_delay_buffer (netsim, buf, base_delay);
   }
 
 done:
@@ -540,6 +859,12 @@ gst_net_sim_set_property (GObject * object,
     case PROP_ALLOW_REORDERING:
       netsim->allow_reordering = g_value_get_boolean (value);
       break;
+    case PROP_TRACE_FILE:
+      GST_OBJECT_LOCK (netsim);
+      g_free (netsim->trace_file);
+      netsim->trace_file = g_value_dup_string (value);
+      GST_OBJECT_UNLOCK (netsim);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -583,6 +908,11 @@ gst_net_sim_get_property (GObject * object,
     case PROP_ALLOW_REORDERING:
       g_value_set_boolean (value, netsim->allow_reordering);
       break;
+    case PROP_TRACE_FILE:
+      GST_OBJECT_LOCK (netsim);
+      g_value_set_string (value, netsim->trace_file);
+      GST_OBJECT_UNLOCK (netsim);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -606,6 +936,9 @@ gst_net_sim_init (GstNetSim * netsim)
   netsim->rand_seed = g_rand_new ();
   netsim->main_loop = NULL;
   netsim->prev_time = GST_CLOCK_TIME_NONE;
+  netsim->delayed = g_array_sized_new (FALSE, FALSE,
+      sizeof (GstNetSimDelayedBuffer), DELAYED_PREALLOC);
+  netsim->trace_start = GST_CLOCK_TIME_NONE;
 
   GST_OBJECT_FLAG_SET (netsim->sinkpad,
       GST_PAD_FLAG_PROXY_CAPS | GST_PAD_FLAG_PROXY_ALLOCATION);
@@ -622,6 +955,9 @@ gst_net_sim_finalize (GObject * object)
   GstNetSim *netsim = GST_NET_SIM (object);
 
   g_rand_free (netsim->rand_seed);
+  g_array_unref (netsim->delayed);
+  gst_net_sim_trace_clear (netsim);
+  g_free (netsim->trace_file);
   g_mutex_clear (&netsim->loop_mutex);
   g_cond_clear (&netsim->start_cond);
 
@@ -755,6 +1091,29 @@ gst_net_sim_class_init (GstNetSimClass * klass)
           DEFAULT_ALLOW_REORDERING,
           G_PARAM_READWRITE | G_PARAM_CONSTRUCT | G_PARAM_STATIC_STRINGS));
 
+  /**
+   * GstNetSim:trace-file:
+   *
+   * A file with network conditions to replay in a loop, read when the
+   * element goes to PAUSED. Each line holds either a single time in ms, a
+   * delivery opportunity for one 1500 byte packet as in Mahimahi cellular
+   * traces, or "<ms> <kbps> <delay-ms> <loss>", setting the bandwidth
+   * (-1 = unlimited), an additional delay and a loss probability from that
+   * time on. The last time in the file is the length of the loop. Lines
+   * starting with '#' are ignored.
+   *
+   * Delivery opportunities take the place of "max-kbps" in the token bucket,
+   * which holds one packet unless "max-bucket-size" is set. Bandwidth steps
+   * do so too, with a bucket that is only bounded by "max-bucket-size".
+   *
+   * Since: 1.18
+   */
+  g_object_class_install_property (gobject_class, PROP_TRACE_FILE,
+      g_param_spec_string ("trace-file", "Trace File",
+          "File with bandwidth, delay and loss traces to replay",
+          DEFAULT_TRACE_FILE,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
   GST_DEBUG_CATEGORY_INIT (netsim_debug, "netsim", 0, "Network simulator");
 }
 
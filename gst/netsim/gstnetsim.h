@@ -60,6 +60,23 @@ typedef struct
   gdouble z1;
 } NormalDistributionState;
 
+/* A buffer waiting in the delay queue */
+typedef struct
+{
+  gint64 ready_time;
+  guint64 seqnum;
+  GstBuffer *buf;
+} GstNetSimDelayedBuffer;
+
+/* One line of a trace, applying from @time until the next step */
+typedef struct
+{
+  GstClockTime time;
+  gint kbps;
+  gint delay;
+  gdouble loss;
+} GstNetSimTraceStep;
+
 struct _GstNetSim
 {
   GstElement parent;
@@ -77,6 +94,20 @@ struct _GstNetSim
   NormalDistributionState delay_state;
   gint64 last_ready_time;
 
+  /* delayed buffers, a binary heap ordered by ready time and protected by
+   * loop_mutex. A single source dispatches them when due */
+  GArray *delayed;
+  guint64 delayed_seqnum;
+  GSource *delay_source;
+
+  /* trace replay, loaded on activation */
+  GArray *trace_opportunities;
+  GArray *trace_steps;
+  GstClockTime trace_period;
+  GstClockTime trace_start;
+  GstClockTime trace_loop_start;
+  guint trace_index;
+
   /* properties */
   gint min_delay;
   gint max_delay;
@@ -88,6 +119,7 @@ struct _GstNetSim
   gint max_kbps;
   gint max_bucket_size;
   gboolean allow_reordering;
+  gchar *trace_file;
 };
 
 struct _GstNetSimClass
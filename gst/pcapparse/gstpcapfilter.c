@@ -0,0 +1,485 @@
+/* GStreamer
+ *
+ * gstpcapfilter.c: packet filter expressions for pcapparse
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/* Filter expressions use a subset of the tcpdump/BPF syntax:
+ *
+ *   expr      := and-expr ( ( "or" | "||" ) and-expr )*
+ *   and-expr  := not-expr ( ( "and" | "&&" ) not-expr )*
+ *   not-expr  := ( "not" | "!" ) not-expr | "(" expr ")" | primitive
+ *   primitive := [ "src" | "dst" ] ( "host" ADDR | "net" ADDR/LEN | "port" N )
+ *              | "udp" | "tcp"
+ *
+ * Without "src" or "dst", host, net and port match either side. The parsed
+ * expression is compiled into a list of tests, each of them naming the next
+ * test to run on success and on failure like BPF jumps do, so that matching
+ * a packet never evaluates more than needed and allocates nothing. */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "gstpcapfilter.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#define IP_PROTO_UDP 17
+#define IP_PROTO_TCP 6
+
+typedef enum
+{
+  OP_PROTO,
+  OP_SRC_NET,
+  OP_DST_NET,
+  OP_NET,
+  OP_SRC_PORT,
+  OP_DST_PORT,
+  OP_PORT
+} FilterOp;
+
+/* jump targets ending the program */
+#define TARGET_ACCEPT -1
+#define TARGET_REJECT -2
+
+typedef struct
+{
+  FilterOp op;
+  guint32 value;
+  guint32 mask;
+  gint jt;
+  gint jf;
+} FilterInsn;
+
+struct _GstPcapFilter
+{
+  gint ref_count;
+  FilterInsn *insns;
+  guint n_insns;
+  gint entry;
+};
+
+typedef enum
+{
+  NODE_TEST,
+  NODE_NOT,
+  NODE_AND,
+  NODE_OR
+} NodeType;
+
+typedef struct _Node Node;
+struct _Node
+{
+  NodeType type;
+  FilterOp op;
+  guint32 value;
+  guint32 mask;
+  Node *left;
+  Node *right;
+};
+
+typedef struct
+{
+  gchar **tokens;
+  guint pos;
+  GError **error;
+} Parser;
+
+G_DEFINE_QUARK (gst-pcap-filter-error-quark, gst_pcap_filter_error);
+
+static Node *
+node_new (NodeType type, Node * left, Node * right)
+{
+  Node *node = g_slice_new0 (Node);
+
+  node->type = type;
+  node->left = left;
+  node->right = right;
+
+  return node;
+}
+
+static void
+node_free (Node * node)
+{
+  if (node == NULL)
+    return;
+
+  node_free (node->left);
+  node_free (node->right);
+  g_slice_free (Node, node);
+}
+
+static gchar **
+tokenize (const gchar * expression)
+{
+  GPtrArray *tokens = g_ptr_array_new ();
+  const gchar *p = expression;
+
+  while (*p) {
+    const gchar *start = p;
+
+    if (g_ascii_isspace (*p)) {
+      p++;
+      continue;
+    }
+
+    if (*p == '(' || *p == ')' || *p == '!') {
+      p++;
+    } else if ((p[0] == '&' && p[1] == '&') || (p[0] == '|' && p[1] == '|')) {
+      p += 2;
+    } else {
+      while (*p && !g_ascii_isspace (*p) && !strchr ("()!&|", *p))
+        p++;
+      /* a lone '&' or '|' */
+      if (p == start)
+        p++;
+    }
+    g_ptr_array_add (tokens, g_strndup (start, p - start));
+  }
+  g_ptr_array_add (tokens, NULL);
+
+  return (gchar **) g_ptr_array_free (tokens, FALSE);
+}
+
+static const gchar *
+parser_peek (Parser * parser)
+{
+  return parser->tokens[parser->pos];
+}
+
+static gboolean
+parser_accept (Parser * parser, const gchar * token)
+{
+  if (parser_peek (parser) == NULL || strcmp (parser_peek (parser), token) != 0)
+    return FALSE;
+
+  parser->pos++;
+  return TRUE;
+}
+
+static Node *
+syntax_error (Parser * parser, const gchar * expected)
+{
+  g_set_error (parser->error, GST_PCAP_FILTER_ERROR,
+      GST_PCAP_FILTER_ERROR_SYNTAX, "Expected %s at '%s'", expected,
+      parser_peek (parser) ? parser_peek (parser) : "end of expression");
+
+  return NULL;
+}
+
+static gboolean
+parse_address (const gchar * str, guint32 * addr)
+{
+  guint a, b, c, d;
+  gchar end;
+
+  if (sscanf (str, "%u.%u.%u.%u%c", &a, &b, &c, &d, &end) != 4 ||
+      a > 255 || b > 255 || c > 255 || d > 255)
+    return FALSE;
+
+  *addr = GUINT32_TO_BE ((a << 24) | (b << 16) | (c << 8) | d);
+  return TRUE;
+}
+
+static Node *
+parse_primitive (Parser * parser)
+{
+  FilterOp net_op = OP_NET, port_op = OP_PORT;
+  gboolean directed = TRUE;
+  Node *node;
+
+  if (parser_accept (parser, "src")) {
+    net_op = OP_SRC_NET;
+    port_op = OP_SRC_PORT;
+  } else if (parser_accept (parser, "dst")) {
+    net_op = OP_DST_NET;
+    port_op = OP_DST_PORT;
+  } else {
+    directed = FALSE;
+  }
+
+  node = node_new (NODE_TEST, NULL, NULL);
+
+  if (parser_accept (parser, "host")) {
+    node->op = net_op;
+    node->mask = 0xffffffff;
+    if (parser_peek (parser) == NULL ||
+        !parse_address (parser_peek (parser), &node->value))
+      goto error_address;
+    parser->pos++;
+  } else if (parser_accept (parser, "net")) {
+    gchar **parts;
+    gboolean valid;
+    gchar *end;
+    guint64 len = 32;
+
+    if (parser_peek (parser) == NULL)
+      goto error_address;
+
+    parts = g_strsplit (parser_peek (parser), "/", 2);
+    valid = parse_address (parts[0], &node->value);
+    if (valid && parts[1]) {
+      len = g_ascii_strtoull (parts[1], &end, 10);
+      valid = *parts[1] != '\0' && *end == '\0' && len <= 32;
+    }
+    g_strfreev (parts);
+    if (!valid)
+      goto error_address;
+    parser->pos++;
+
+    node->op = net_op;
+    node->mask = len == 0 ? 0 : GUINT32_TO_BE (0xffffffff << (32 - len));
+    node->value &= node->mask;
+  } else if (parser_accept (parser, "port")) {
+    guint64 port;
+    gchar *end;
+
+    if (parser_peek (parser) == NULL)
+      goto error_port;
+    port = g_ascii_strtoull (parser_peek (parser), &end, 10);
+    if (*parser_peek (parser) == '\0' || *end != '\0' || port > G_MAXUINT16)
+      goto error_port;
+    parser->pos++;
+
+    node->op = port_op;
+    node->value = port;
+  } else if (!directed && parser_accept (parser, "udp")) {
+    node->op = OP_PROTO;
+    node->value = IP_PROTO_UDP;
+  } else if (!directed && parser_accept (parser, "tcp")) {
+    node->op = OP_PROTO;
+    node->value = IP_PROTO_TCP;
+  } else {
+    node_free (node);
+    return syntax_error (parser, directed ? "'host', 'net' or 'port'" :
+        "a primitive");
+  }
+
+  return node;
+
+error_address:
+  node_free (node);
+  return syntax_error (parser, "an IPv4 address");
+
+error_port:
+  node_free (node);
+  return syntax_error (parser, "a port number");
+}
+
+static Node *parse_or (Parser * parser);
+
+static Node *
+parse_not (Parser * parser)
+{
+  Node *node;
+
+  if (parser_accept (parser, "not") || parser_accept (parser, "!")) {
+    node = parse_not (parser);
+    return node ? node_new (NODE_NOT, node, NULL) : NULL;
+  }
+
+  if (parser_accept (parser, "(")) {
+    node = parse_or (parser);
+    if (node && !parser_accept (parser, ")")) {
+      node_free (node);
+      return syntax_error (parser, "')'");
+    }
+    return node;
+  }
+
+  return parse_primitive (parser);
+}
+
+static Node *
+parse_and (Parser * parser)
+{
+  Node *left, *right;
+
+  left = parse_not (parser);
+  while (left && (parser_accept (parser, "and") ||
+          parser_accept (parser, "&&"))) {
+    right = parse_not (parser);
+    if (right == NULL) {
+      node_free (left);
+      return NULL;
+    }
+    left = node_new (NODE_AND, left, right);
+  }
+
+  return left;
+}
+
+static Node *
+parse_or (Parser * parser)
+{
+  Node *left, *right;
+
+  left = parse_and (parser);
+  while (left && (parser_accept (parser, "or") ||
+          parser_accept (parser, "||"))) {
+    right = parse_and (parser);
+    if (right == NULL) {
+      node_free (left);
+      return NULL;
+    }
+    left = node_new (NODE_OR, left, right);
+  }
+
+  return left;
+}
+
+/* Emits the tests of @node jumping to @jt when it holds and to @jf when it
+ * does not, and returns the index of the first one. Right operands are
+ * emitted before left ones so that jump targets are always known. */
+static gint
+compile (GArray * insns, const Node * node, gint jt, gint jf)
+{
+  FilterInsn insn;
+  gint right;
+
+  switch (node->type) {
+    case NODE_TEST:
+      insn.op = node->op;
+      insn.value = node->value;
+      insn.mask = node->mask;
+      insn.jt = jt;
+      insn.jf = jf;
+      g_array_append_val (insns, insn);
+      return insns->len - 1;
+    case NODE_NOT:
+      return compile (insns, node->left, jf, jt);
+    case NODE_AND:
+      right = compile (insns, node->right, jt, jf);
+      return compile (insns, node->left, right, jf);
+    case NODE_OR:
+      right = compile (insns, node->right, jt, jf);
+      return compile (insns, node->left, jt, right);
+  }
+
+  g_assert_not_reached ();
+  return TARGET_REJECT;
+}
+
+/**
+ * gst_pcap_filter_new:
+ * @expression: a filter expression
+ * @error: return location for a #GError
+ *
+ * Compiles @expression. An empty expression matches every packet.
+ *
+ * Returns: a new #GstPcapFilter, or %NULL on syntax errors
+ */
+GstPcapFilter *
+gst_pcap_filter_new (const gchar * expression, GError ** error)
+{
+  GstPcapFilter *filter;
+  Parser parser;
+  Node *root = NULL;
+  GArray *insns;
+
+  parser.tokens = tokenize (expression ? expression : "");
+  parser.pos = 0;
+  parser.error = error;
+
+  if (parser_peek (&parser) != NULL) {
+    root = parse_or (&parser);
+    if (root && parser_peek (&parser) != NULL) {
+      node_free (root);
+      root = syntax_error (&parser, "'and' or 'or'");
+    }
+    if (root == NULL) {
+      g_strfreev (parser.tokens);
+      return NULL;
+    }
+  }
+  g_strfreev (parser.tokens);
+
+  filter = g_new0 (GstPcapFilter, 1);
+  filter->ref_count = 1;
+  if (root == NULL) {
+    filter->entry = TARGET_ACCEPT;
+    return filter;
+  }
+
+  insns = g_array_new (FALSE, FALSE, sizeof (FilterInsn));
+  filter->entry = compile (insns, root, TARGET_ACCEPT, TARGET_REJECT);
+  filter->n_insns = insns->len;
+  filter->insns = (FilterInsn *) g_array_free (insns, FALSE);
+  node_free (root);
+
+  return filter;
+}
+
+GstPcapFilter *
+gst_pcap_filter_ref (GstPcapFilter * filter)
+{
+  g_atomic_int_inc (&filter->ref_count);
+
+  return filter;
+}
+
+void
+gst_pcap_filter_unref (GstPcapFilter * filter)
+{
+  if (g_atomic_int_dec_and_test (&filter->ref_count)) {
+    g_free (filter->insns);
+    g_free (filter);
+  }
+}
+
+gboolean
+gst_pcap_filter_match (const GstPcapFilter * filter,
+    const GstPcapPacketInfo * info)
+{
+  gint pc = filter->entry;
+
+  while (pc >= 0) {
+    const FilterInsn *insn = &filter->insns[pc];
+    gboolean res = FALSE;
+
+    switch (insn->op) {
+      case OP_PROTO:
+        res = info->protocol == insn->value;
+        break;
+      case OP_SRC_NET:
+        res = (info->src_ip & insn->mask) == insn->value;
+        break;
+      case OP_DST_NET:
+        res = (info->dst_ip & insn->mask) == insn->value;
+        break;
+      case OP_NET:
+        res = (info->src_ip & insn->mask) == insn->value ||
+            (info->dst_ip & insn->mask) == insn->value;
+        break;
+      case OP_SRC_PORT:
+        res = info->src_port == insn->value;
+        break;
+      case OP_DST_PORT:
+        res = info->dst_port == insn->value;
+        break;
+      case OP_PORT:
+        res = info->src_port == insn->value || info->dst_port == insn->value;
+        break;
+    }
+    pc = res ? insn->jt : insn->jf;
+  }
+
+  return pc == TARGET_ACCEPT;
+}
@@ -0,0 +1,62 @@
+/* GStreamer
+ *
+ * gstpcapfilter.h: packet filter expressions for pcapparse
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __GST_PCAP_FILTER_H__
+#define __GST_PCAP_FILTER_H__
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+#define GST_PCAP_FILTER_ERROR (gst_pcap_filter_error_quark ())
+
+typedef enum
+{
+  GST_PCAP_FILTER_ERROR_SYNTAX
+} GstPcapFilterError;
+
+/* The fields of a packet a filter can look at. Addresses are in network
+ * byte order, ports in host byte order. */
+typedef struct
+{
+  guint8 protocol;
+  guint32 src_ip;
+  guint32 dst_ip;
+  guint16 src_port;
+  guint16 dst_port;
+} GstPcapPacketInfo;
+
+typedef struct _GstPcapFilter GstPcapFilter;
+
+GQuark gst_pcap_filter_error_quark (void);
+
+GstPcapFilter * gst_pcap_filter_new (const gchar * expression,
+    GError ** error);
+
+GstPcapFilter * gst_pcap_filter_ref (GstPcapFilter * filter);
+
+void gst_pcap_filter_unref (GstPcapFilter * filter);
+
+gboolean gst_pcap_filter_match (const GstPcapFilter * filter,
+    const GstPcapPacketInfo * info);
+
+G_END_DECLS
+
+#endif /* __GST_PCAP_FILTER_H__ */
@@ -24,10 +24,18 @@
  * Extracts payloads from Ethernet-encapsulated IP packets.
  * Use #GstPcapParse:src-ip, #GstPcapParse:dst-ip,
  * #GstPcapParse:src-port and #GstPcapParse:dst-port to restrict which packets
- * should be included.
+ * should be included, or #GstPcapParse:filter for more complex rules.
  *
- * The supported data format is the classical
+ * The supported data formats are the classical
  * [libpcap file format](https://wiki.wireshark.org/Development/LibpcapFileFormat)
+ * and the [pcapng file format](https://wiki.wireshark.org/Development/PcapNg)
+ *
+ * When upstream supports it, the file is read in pull mode in large chunks
+ * and the payloads are output as sub-buffers of these chunks, without
+ * copying them.
+ *
+ * Several flows can be extracted at once by requesting additional source
+ * pads and setting the #GstPcapParsePad:filter property on each of them.
  *
  * ## Example pipelines
  * |[
@@ -35,6 +43,11 @@
  * ! ffdec_h264 ! fakesink
  * ]| Read from a pcap dump file using filesrc, extract the raw UDP packets,
  * depayload and decode them.
+ * |[
+ * gst-launch-1.0 filesrc location=multicast.pcapng ! pcapparse name=p
+ *     filter="dst host 239.0.0.1" src_0::filter="dst host 239.0.0.2"
+ *     p.src ! queue ! tsdemux ! fakesink  p.src_0 ! queue ! tsdemux ! fakesink
+ * ]| Extract two multicast MPEG-TS streams from a pcapng capture.
  *
  */
 
@@ -64,6 +77,21 @@ const guint GST_PCAPPARSE_MAGIC_NANOSECOND_NO_SWAP_ENDIAN = 0xa1b23c4d;
 const guint GST_PCAPPARSE_MAGIC_MILLISECOND_SWAP_ENDIAN = 0xd4c3b2a1;
 const guint GST_PCAPPARSE_MAGIC_NANOSECOND_SWAP_ENDIAN = 0x4d3cb2a1;
 
+/* pcapng block types and byte order magic */
+#define PCAPNG_BLOCK_SECTION_HEADER     0x0a0d0d0a
+#define PCAPNG_BLOCK_INTERFACE          0x00000001
+#define PCAPNG_BLOCK_SIMPLE_PACKET      0x00000003
+#define PCAPNG_BLOCK_ENHANCED_PACKET    0x00000006
+#define PCAPNG_BYTE_ORDER_MAGIC         0x1a2b3c4d
+#define PCAPNG_BYTE_ORDER_MAGIC_SWAPPED 0x4d3c2b1a
+#define PCAPNG_OPTION_END               0
+#define PCAPNG_OPTION_IF_TSRESOL        9
+
+/* bytes pulled at once in pull mode */
+#define DEFAULT_PULL_SIZE (4 * 1024 * 1024)
+
+/* anything bigger than this is a corrupted record */
+#define MAX_RECORD_SIZE (64 * 1024 * 1024)
 
 enum
 {
@@ -73,7 +101,14 @@ enum
   PROP_SRC_PORT,
   PROP_DST_PORT,
   PROP_CAPS,
-  PROP_TS_OFFSET
+  PROP_TS_OFFSET,
+  PROP_FILTER
+};
+
+enum
+{
+  PROP_PAD_0,
+  PROP_PAD_FILTER
 };
 
 GST_DEBUG_CATEGORY_STATIC (gst_pcap_parse_debug);
@@ -89,6 +124,20 @@ static GstStaticPadTemplate src_template = GST_STATIC_PAD_TEMPLATE ("src",
     GST_PAD_ALWAYS,
     GST_STATIC_CAPS_ANY);
 
+static GstStaticPadTemplate src_request_template =
+GST_STATIC_PAD_TEMPLATE ("src_%u",
+    GST_PAD_SRC,
+    GST_PAD_REQUEST,
+    GST_STATIC_CAPS_ANY);
+
+/* An output of one parsing run: a source pad and the filter in effect */
+typedef struct
+{
+  GstPcapParsePad *pad;
+  GstPcapFilter *filter;
+  gboolean main;
+} GstPcapParseOutput;
+
 static void gst_pcap_parse_finalize (GObject * object);
 static void gst_pcap_parse_get_property (GObject * object, guint prop_id,
     GValue * value, GParamSpec * pspec);
@@ -96,6 +145,9 @@ static void gst_pcap_parse_set_property (GObject * object, guint prop_id,
     const GValue * value, GParamSpec * pspec);
 static GstStateChangeReturn
 gst_pcap_parse_change_state (GstElement * element, GstStateChange transition);
+static GstPad *gst_pcap_parse_request_new_pad (GstElement * element,
+    GstPadTemplate * templ, const gchar * name, const GstCaps * caps);
+static void gst_pcap_parse_release_pad (GstElement * element, GstPad * pad);
 
 static void gst_pcap_parse_reset (GstPcapParse * self);
 
@@ -103,10 +155,127 @@ static GstFlowReturn gst_pcap_parse_chain (GstPad * pad,
     GstObject * parent, GstBuffer * buffer);
 static gboolean gst_pcap_sink_event (GstPad * pad,
     GstObject * parent, GstEvent * event);
+static gboolean gst_pcap_parse_sink_activate (GstPad * pad,
+    GstObject * parent);
+static gboolean gst_pcap_parse_sink_activatemode (GstPad * pad,
+    GstObject * parent, GstPadMode mode, gboolean active);
+
+G_DEFINE_TYPE (GstPcapParsePad, gst_pcap_parse_pad, GST_TYPE_PAD);
+
+/* Compiles @str and replaces @filter_str and @filter with it, keeping the
+ * current filter when it is invalid. Must be called with the object lock. */
+static void
+set_filter_from_string (GstObject * obj, gchar ** filter_str,
+    GstPcapFilter ** filter, const gchar * str)
+{
+  GstPcapFilter *new_filter = NULL;
+  GError *err = NULL;
+
+  if (str && *str) {
+    new_filter = gst_pcap_filter_new (str, &err);
+    if (new_filter == NULL) {
+      GST_WARNING_OBJECT (obj, "Ignoring invalid filter \"%s\": %s", str,
+          err->message);
+      g_clear_error (&err);
+      return;
+    }
+  }
+
+  g_free (*filter_str);
+  *filter_str = g_strdup (str);
+  if (*filter)
+    gst_pcap_filter_unref (*filter);
+  *filter = new_filter;
+}
 
+static void
+gst_pcap_parse_pad_set_property (GObject * object, guint prop_id,
+    const GValue * value, GParamSpec * pspec)
+{
+  GstPcapParsePad *pad = GST_PCAP_PARSE_PAD (object);
+
+  switch (prop_id) {
+    case PROP_PAD_FILTER:
+      GST_OBJECT_LOCK (pad);
+      set_filter_from_string (GST_OBJECT (pad), &pad->filter_str,
+          &pad->filter, g_value_get_string (value));
+      GST_OBJECT_UNLOCK (pad);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+}
+
+static void
+gst_pcap_parse_pad_get_property (GObject * object, guint prop_id,
+    GValue * value, GParamSpec * pspec)
+{
+  GstPcapParsePad *pad = GST_PCAP_PARSE_PAD (object);
+
+  switch (prop_id) {
+    case PROP_PAD_FILTER:
+      GST_OBJECT_LOCK (pad);
+      g_value_set_string (value, pad->filter_str);
+      GST_OBJECT_UNLOCK (pad);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+}
+
+static void
+gst_pcap_parse_pad_finalize (GObject * object)
+{
+  GstPcapParsePad *pad = GST_PCAP_PARSE_PAD (object);
+
+  g_free (pad->filter_str);
+  if (pad->filter)
+    gst_pcap_filter_unref (pad->filter);
+  if (pad->pending)
+    gst_buffer_list_unref (pad->pending);
+
+  G_OBJECT_CLASS (gst_pcap_parse_pad_parent_class)->finalize (object);
+}
+
+static void
+gst_pcap_parse_pad_class_init (GstPcapParsePadClass * klass)
+{
+  GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
+
+  gobject_class->finalize = gst_pcap_parse_pad_finalize;
+  gobject_class->get_property = gst_pcap_parse_pad_get_property;
+  gobject_class->set_property = gst_pcap_parse_pad_set_property;
+
+  /**
+   * GstPcapParsePad:filter:
+   *
+   * Filter expression selecting the packets output on a requested pad, see
+   * #GstPcapParse:filter. Packets are output on all pads whose filter they
+   * match.
+   *
+   * Since: 1.18
+   */
+  g_object_class_install_property (gobject_class, PROP_PAD_FILTER,
+      g_param_spec_string ("filter", "Filter",
+          "Filter expression for the packets to output on this pad", NULL,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+}
+
+static void
+gst_pcap_parse_pad_init (GstPcapParsePad * pad)
+{
+  pad->first_packet = TRUE;
+}
+
+static void gst_pcap_parse_child_proxy_init (gpointer g_iface,
+    gpointer iface_data);
 
 #define parent_class gst_pcap_parse_parent_class
-G_DEFINE_TYPE (GstPcapParse, gst_pcap_parse, GST_TYPE_ELEMENT);
+G_DEFINE_TYPE_WITH_CODE (GstPcapParse, gst_pcap_parse, GST_TYPE_ELEMENT,
+    G_IMPLEMENT_INTERFACE (GST_TYPE_CHILD_PROXY,
+        gst_pcap_parse_child_proxy_init));
 
 static void
 gst_pcap_parse_class_init (GstPcapParseClass * klass)
@@ -148,10 +317,32 @@ gst_pcap_parse_class_init (GstPcapParseClass * klass)
           "Relative timestamp offset (ns) to apply (-1 = use absolute packet time)",
           -1, G_MAXINT64, -1, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+  /**
+   * GstPcapParse:filter:
+   *
+   * Filter expression restricting the packets output on the always source
+   * pad, in addition to the address and port properties. It uses a subset
+   * of the tcpdump syntax: "host", "net" and "port" primitives optionally
+   * preceded by "src" or "dst", "udp" and "tcp", combined with "and", "or",
+   * "not" and parentheses. For example "udp and dst net 239.0.0.0/8".
+   *
+   * Since: 1.18
+   */
+  g_object_class_install_property (gobject_class, PROP_FILTER,
+      g_param_spec_string ("filter", "Filter",
+          "Filter expression for the packets to output", NULL,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
   gst_element_class_add_static_pad_template (element_class, &sink_template);
-  gst_element_class_add_static_pad_template (element_class, &src_template);
+  gst_element_class_add_static_pad_template_with_gtype (element_class,
+      &src_template, GST_TYPE_PCAP_PARSE_PAD);
+  gst_element_class_add_static_pad_template_with_gtype (element_class,
+      &src_request_template, GST_TYPE_PCAP_PARSE_PAD);
 
   element_class->change_state = gst_pcap_parse_change_state;
+  element_class->request_new_pad =
+      GST_DEBUG_FUNCPTR (gst_pcap_parse_request_new_pad);
+  element_class->release_pad = GST_DEBUG_FUNCPTR (gst_pcap_parse_release_pad);
 
   gst_element_class_set_static_metadata (element_class, "PCapParse",
       "Raw/Parser",
@@ -164,15 +355,24 @@ gst_pcap_parse_class_init (GstPcapParseClass * klass)
 static void
 gst_pcap_parse_init (GstPcapParse * self)
 {
+  GstPadTemplate *templ;
+
   self->sink_pad = gst_pad_new_from_static_template (&sink_template, "sink");
   gst_pad_set_chain_function (self->sink_pad,
       GST_DEBUG_FUNCPTR (gst_pcap_parse_chain));
   gst_pad_use_fixed_caps (self->sink_pad);
   gst_pad_set_event_function (self->sink_pad,
       GST_DEBUG_FUNCPTR (gst_pcap_sink_event));
+  gst_pad_set_activate_function (self->sink_pad,
+      GST_DEBUG_FUNCPTR (gst_pcap_parse_sink_activate));
+  gst_pad_set_activatemode_function (self->sink_pad,
+      GST_DEBUG_FUNCPTR (gst_pcap_parse_sink_activatemode));
   gst_element_add_pad (GST_ELEMENT (self), self->sink_pad);
 
-  self->src_pad = gst_pad_new_from_static_template (&src_template, "src");
+  templ = gst_static_pad_template_get (&src_template);
+  self->src_pad = g_object_new (GST_TYPE_PCAP_PARSE_PAD, "name", "src",
+      "direction", GST_PAD_SRC, "template", templ, NULL);
+  gst_object_unref (templ);
   gst_pad_use_fixed_caps (self->src_pad);
   gst_element_add_pad (GST_ELEMENT (self), self->src_pad);
 
@@ -183,6 +383,10 @@ gst_pcap_parse_init (GstPcapParse * self)
   self->offset = -1;
 
   self->adapter = gst_adapter_new ();
+  self->interfaces = g_array_new (FALSE, FALSE,
+      sizeof (GstPcapParseInterface));
+  self->flow_combiner = gst_flow_combiner_new ();
+  gst_flow_combiner_add_pad (self->flow_combiner, self->src_pad);
 
   gst_pcap_parse_reset (self);
 }
@@ -193,8 +397,13 @@ gst_pcap_parse_finalize (GObject * object)
   GstPcapParse *self = GST_PCAP_PARSE (object);
 
   g_object_unref (self->adapter);
+  g_array_unref (self->interfaces);
+  gst_flow_combiner_free (self->flow_combiner);
   if (self->caps)
     gst_caps_unref (self->caps);
+  g_free (self->filter_str);
+  if (self->filter)
+    gst_pcap_filter_unref (self->filter);
 
   G_OBJECT_CLASS (parent_class)->finalize (object);
 }
@@ -254,6 +463,12 @@ gst_pcap_parse_get_property (GObject * object, guint prop_id,
       g_value_set_int64 (value, self->offset);
       break;
 
+    case PROP_FILTER:
+      GST_OBJECT_LOCK (self);
+      g_value_set_string (value, self->filter_str);
+      GST_OBJECT_UNLOCK (self);
+      break;
+
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -308,41 +523,206 @@ gst_pcap_parse_set_property (GObject * object, guint prop_id,
       self->offset = g_value_get_int64 (value);
       break;
 
+    case PROP_FILTER:
+      GST_OBJECT_LOCK (self);
+      set_filter_from_string (GST_OBJECT (self), &self->filter_str,
+          &self->filter, g_value_get_string (value));
+      GST_OBJECT_UNLOCK (self);
+      break;
+
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
   }
 }
 
+static GstPad *
+gst_pcap_parse_request_new_pad (GstElement * element, GstPadTemplate * templ,
+    const gchar * name, const GstCaps * caps)
+{
+  GstPcapParse *self = GST_PCAP_PARSE (element);
+  GstPad *pad;
+  gchar *pad_name;
+
+  GST_OBJECT_LOCK (self);
+  if (name)
+    pad_name = g_strdup (name);
+  else
+    pad_name = g_strdup_printf ("src_%u", self->n_request_pads);
+  self->n_request_pads++;
+  GST_OBJECT_UNLOCK (self);
+
+  pad = g_object_new (GST_TYPE_PCAP_PARSE_PAD, "name", pad_name,
+      "direction", GST_PAD_SRC, "template", templ, NULL);
+  g_free (pad_name);
+  gst_pad_use_fixed_caps (pad);
+
+  GST_STREAM_LOCK (self->sink_pad);
+  gst_flow_combiner_add_pad (self->flow_combiner, pad);
+  GST_STREAM_UNLOCK (self->sink_pad);
+
+  if (GST_STATE (element) > GST_STATE_READY)
+    gst_pad_set_active (pad, TRUE);
+  gst_element_add_pad (element, pad);
+  gst_child_proxy_child_added (GST_CHILD_PROXY (self), G_OBJECT (pad),
+      GST_OBJECT_NAME (pad));
+
+  return pad;
+}
+
+static void
+gst_pcap_parse_release_pad (GstElement * element, GstPad * pad)
+{
+  GstPcapParse *self = GST_PCAP_PARSE (element);
+
+  GST_STREAM_LOCK (self->sink_pad);
+  gst_flow_combiner_remove_pad (self->flow_combiner, pad);
+  GST_STREAM_UNLOCK (self->sink_pad);
+
+  gst_child_proxy_child_removed (GST_CHILD_PROXY (self), G_OBJECT (pad),
+      GST_OBJECT_NAME (pad));
+  gst_pad_set_active (pad, FALSE);
+  gst_element_remove_pad (element, pad);
+}
+
+/* GstChildProxy implementation, to set the filter of requested pads with
+ * "src_0::filter" from gst-launch */
+static GObject *
+gst_pcap_parse_child_proxy_get_child_by_index (GstChildProxy * child_proxy,
+    guint index)
+{
+  GstPcapParse *self = GST_PCAP_PARSE (child_proxy);
+  GObject *obj;
+
+  GST_OBJECT_LOCK (self);
+  obj = g_list_nth_data (GST_ELEMENT_CAST (self)->srcpads, index);
+  if (obj)
+    gst_object_ref (obj);
+  GST_OBJECT_UNLOCK (self);
+
+  return obj;
+}
+
+static guint
+gst_pcap_parse_child_proxy_get_children_count (GstChildProxy * child_proxy)
+{
+  GstPcapParse *self = GST_PCAP_PARSE (child_proxy);
+  guint count;
+
+  GST_OBJECT_LOCK (self);
+  count = GST_ELEMENT_CAST (self)->numsrcpads;
+  GST_OBJECT_UNLOCK (self);
+
+  return count;
+}
+
+static void
+gst_pcap_parse_child_proxy_init (gpointer g_iface, gpointer iface_data)
+{
+  GstChildProxyInterface *iface = g_iface;
+
+  iface->get_child_by_index = gst_pcap_parse_child_proxy_get_child_by_index;
+  iface->get_children_count = gst_pcap_parse_child_proxy_get_children_count;
+}
+
 static void
 gst_pcap_parse_reset (GstPcapParse * self)
 {
+  GList *l;
+
   self->initialized = FALSE;
+  self->format = PCAP_PARSE_FORMAT_UNKNOWN;
   self->swap_endian = FALSE;
   self->nanosecond_timestamp = FALSE;
-  self->cur_packet_size = -1;
   self->cur_ts = GST_CLOCK_TIME_NONE;
   self->base_ts = GST_CLOCK_TIME_NONE;
-  self->newsegment_sent = FALSE;
-  self->first_packet = TRUE;
+  self->pull_offset = 0;
+  self->pull_size = DEFAULT_PULL_SIZE;
+  g_array_set_size (self->interfaces, 0);
+
+  GST_OBJECT_LOCK (self);
+  for (l = GST_ELEMENT_CAST (self)->srcpads; l; l = l->next) {
+    GstPcapParsePad *pad = l->data;
+
+    pad->newsegment_sent = FALSE;
+    pad->first_packet = TRUE;
+    if (pad->pending) {
+      gst_buffer_list_unref (pad->pending);
+      pad->pending = NULL;
+    }
+  }
+  GST_OBJECT_UNLOCK (self);
 
+  gst_flow_combiner_reset (self->flow_combiner);
   gst_adapter_clear (self->adapter);
 }
 
+/* Takes a reference on all source pads and their filters, so that pads and
+ * filters can change while a chunk of data is parsed */
+static GArray *
+gst_pcap_parse_get_outputs (GstPcapParse * self)
+{
+  GArray *outputs;
+  GList *l;
+
+  outputs = g_array_sized_new (FALSE, FALSE, sizeof (GstPcapParseOutput),
+      GST_ELEMENT_CAST (self)->numsrcpads);
+
+  GST_OBJECT_LOCK (self);
+  for (l = GST_ELEMENT_CAST (self)->srcpads; l; l = l->next) {
+    GstPcapParseOutput output;
+
+    output.pad = gst_object_ref (l->data);
+    output.main = (GstPad *) output.pad == self->src_pad;
+    if (output.main) {
+      output.filter = self->filter ? gst_pcap_filter_ref (self->filter) : NULL;
+    } else {
+      GST_OBJECT_LOCK (output.pad);
+      output.filter =
+          output.pad->filter ? gst_pcap_filter_ref (output.pad->filter) : NULL;
+      GST_OBJECT_UNLOCK (output.pad);
+    }
+    g_array_append_val (outputs, output);
+  }
+  GST_OBJECT_UNLOCK (self);
+
+  return outputs;
+}
+
+static void
+gst_pcap_parse_free_outputs (GArray * outputs)
+{
+  guint i;
+
+  for (i = 0; i < outputs->len; i++) {
+    GstPcapParseOutput *output =
+        &g_array_index (outputs, GstPcapParseOutput, i);
+
+    if (output->filter)
+      gst_pcap_filter_unref (output->filter);
+    gst_object_unref (output->pad);
+  }
+  g_array_unref (outputs);
+}
+
 static guint32
 gst_pcap_parse_read_uint32 (GstPcapParse * self, const guint8 * p)
 {
-  guint32 val = *((guint32 *) p);
+#if G_BYTE_ORDER == G_LITTLE_ENDIAN
+  return self->swap_endian ? GST_READ_UINT32_BE (p) : GST_READ_UINT32_LE (p);
+#else
+  return self->swap_endian ? GST_READ_UINT32_LE (p) : GST_READ_UINT32_BE (p);
+#endif
+}
 
-  if (self->swap_endian) {
+static guint16
+gst_pcap_parse_read_uint16 (GstPcapParse * self, const guint8 * p)
+{
 #if G_BYTE_ORDER == G_LITTLE_ENDIAN
-    return GUINT32_FROM_BE (val);
+  return self->swap_endian ? GST_READ_UINT16_BE (p) : GST_READ_UINT16_LE (p);
 #else
-    return GUINT32_FROM_LE (val);
+  return self->swap_endian ? GST_READ_UINT16_LE (p) : GST_READ_UINT16_BE (p);
 #endif
-  } else {
-    return val;
-  }
 }
 
 #define ETH_MAC_ADDRESSES_LEN    12
@@ -358,8 +738,8 @@ gst_pcap_parse_read_uint32 (GstPcapParse * self, const guint8 * p)
 
 static gboolean
 gst_pcap_parse_scan_frame (GstPcapParse * self,
-    const guint8 * buf,
-    gint buf_size, const guint8 ** payload, gint * payload_size)
+    GstPcapParseLinktype linktype, const guint8 * buf, gint buf_size,
+    GstPcapPacketInfo * info, const guint8 ** payload, gint * payload_size)
 {
   const guint8 *buf_ip = 0;
   const guint8 *buf_proto;
@@ -369,14 +749,10 @@ gst_pcap_parse_scan_frame (GstPcapParse * self,
   guint8 flags;
   guint16 fragment_offset;
   guint8 ip_protocol;
-  guint32 ip_src_addr;
-  guint32 ip_dst_addr;
-  guint16 src_port;
-  guint16 dst_port;
   guint16 len;
   guint16 ip_packet_len;
 
-  switch (self->linktype) {
+  switch (linktype) {
     case LINKTYPE_ETHER:
       if (buf_size < ETH_HEADER_LEN + IP_HEADER_MIN_LEN + UDP_HEADER_LEN)
         return FALSE;
@@ -417,7 +793,7 @@ gst_pcap_parse_scan_frame (GstPcapParse * self,
   if (eth_type != 0x800) {
     GST_ERROR_OBJECT (self,
         "Link type %d: Ethernet type %d is not supported; only type 0x800",
-        (gint) self->linktype, (gint) eth_type);
+        (gint) linktype, (gint) eth_type);
     return FALSE;
   }
 
@@ -446,14 +822,15 @@ gst_pcap_parse_scan_frame (GstPcapParse * self,
     return FALSE;
 
   /* ip info */
-  ip_src_addr = *((guint32 *) (buf_ip + 12));
-  ip_dst_addr = *((guint32 *) (buf_ip + 16));
+  info->protocol = ip_protocol;
+  info->src_ip = *((guint32 *) (buf_ip + 12));
+  info->dst_ip = *((guint32 *) (buf_ip + 16));
   buf_proto = buf_ip + ip_header_size;
   ip_packet_len = GUINT16_FROM_BE (*(guint16 *) (buf_ip + 2));
 
   /* ok for tcp and udp */
-  src_port = GUINT16_FROM_BE (*((guint16 *) (buf_proto + 0)));
-  dst_port = GUINT16_FROM_BE (*((guint16 *) (buf_proto + 2)));
+  info->src_port = GUINT16_FROM_BE (*((guint16 *) (buf_proto + 0)));
+  info->dst_port = GUINT16_FROM_BE (*((guint16 *) (buf_proto + 2)));
 
   /* extract some params and data according to protocol */
   if (ip_protocol == IP_PROTO_UDP) {
@@ -470,215 +847,661 @@ gst_pcap_parse_scan_frame (GstPcapParse * self,
     if (buf_proto + len > buf + buf_size)
       return FALSE;
 
+    /* like for UDP, the payload has to be captured completely */
+    if (ip_packet_len < ip_header_size + len ||
+        buf_ip + ip_packet_len > buf + buf_size)
+      return FALSE;
+
     /* all remaining data following tcp header is payload */
     *payload = buf_proto + len;
     *payload_size = ip_packet_len - ip_header_size - len;
   }
 
-  /* but still filter as configured */
-  if (self->src_ip >= 0 && ip_src_addr != self->src_ip)
+  return TRUE;
+}
+
+/* the address and port properties apply to the always source pad */
+static gboolean
+gst_pcap_parse_match_properties (GstPcapParse * self,
+    const GstPcapPacketInfo * info)
+{
+  if (self->src_ip >= 0 && info->src_ip != self->src_ip)
     return FALSE;
 
-  if (self->dst_ip >= 0 && ip_dst_addr != self->dst_ip)
+  if (self->dst_ip >= 0 && info->dst_ip != self->dst_ip)
     return FALSE;
 
-  if (self->src_port >= 0 && src_port != self->src_port)
+  if (self->src_port >= 0 && info->src_port != self->src_port)
     return FALSE;
 
-  if (self->dst_port >= 0 && dst_port != self->dst_port)
+  if (self->dst_port >= 0 && info->dst_port != self->dst_port)
     return FALSE;
 
   return TRUE;
 }
 
-static GstFlowReturn
-gst_pcap_parse_chain (GstPad * pad, GstObject * parent, GstBuffer * buffer)
+/* Adds the payload of the frame at @frame, which points into the mapped
+ * @buffer starting at @data, to the pending list of every output whose
+ * filter it matches. The payloads are sub-buffers of @buffer. */
+static void
+gst_pcap_parse_handle_frame (GstPcapParse * self, GArray * outputs,
+    GstBuffer * buffer, const guint8 * data, const guint8 * frame,
+    guint frame_size, GstPcapParseLinktype linktype, GstClockTime ts)
 {
-  GstPcapParse *self = GST_PCAP_PARSE (parent);
-  GstFlowReturn ret = GST_FLOW_OK;
-  GstBufferList *list = NULL;
-
-  gst_adapter_push (self->adapter, buffer);
-
-  while (ret == GST_FLOW_OK) {
-    gint avail;
-    const guint8 *data;
-
-    avail = gst_adapter_available (self->adapter);
-
-    if (self->initialized) {
-      if (self->cur_packet_size >= 0) {
-        /* Parse the Packet Data */
-        if (avail < self->cur_packet_size)
-          break;
-
-        if (self->cur_packet_size > 0) {
-          const guint8 *payload_data;
-          gint payload_size;
-
-          data = gst_adapter_map (self->adapter, self->cur_packet_size);
-
-          GST_LOG_OBJECT (self, "examining packet size %" G_GINT64_FORMAT,
-              self->cur_packet_size);
-
-          if (gst_pcap_parse_scan_frame (self, data, self->cur_packet_size,
-                  &payload_data, &payload_size)) {
-            GstBuffer *out_buf;
-            guintptr offset = payload_data - data;
-
-            gst_adapter_unmap (self->adapter);
-            gst_adapter_flush (self->adapter, offset);
-            /* we don't use _take_buffer_fast() on purpose here, we need a
-             * buffer with a single memory, since the RTP depayloaders expect
-             * the complete RTP header to be in the first memory if there are
-             * multiple ones and we can't guarantee that with _fast() */
-            if (payload_size > 0) {
-              out_buf = gst_adapter_take_buffer (self->adapter, payload_size);
-            } else {
-              out_buf = gst_buffer_new ();
-            }
-
-            /* only first packet should have DISCONT flag */
-            if (G_LIKELY (!self->first_packet)) {
-              GST_BUFFER_FLAG_UNSET (out_buf, GST_BUFFER_FLAG_DISCONT);
-            } else {
-              GST_BUFFER_FLAG_SET (out_buf, GST_BUFFER_FLAG_DISCONT);
-              self->first_packet = FALSE;
-            }
-
-            gst_adapter_flush (self->adapter,
-                self->cur_packet_size - offset - payload_size);
-
-            if (GST_CLOCK_TIME_IS_VALID (self->cur_ts)) {
-              if (!GST_CLOCK_TIME_IS_VALID (self->base_ts))
-                self->base_ts = self->cur_ts;
-              if (self->offset >= 0) {
-                self->cur_ts -= self->base_ts;
-                self->cur_ts += self->offset;
-              }
-            }
-            GST_BUFFER_TIMESTAMP (out_buf) = self->cur_ts;
-
-
-            if (list == NULL)
-              list = gst_buffer_list_new ();
-            gst_buffer_list_add (list, out_buf);
-          } else {
-            gst_adapter_unmap (self->adapter);
-            gst_adapter_flush (self->adapter, self->cur_packet_size);
-          }
-        }
-
-        self->cur_packet_size = -1;
-      } else {
-        /* Parse the Record (Packet) Header */
-        guint32 ts_sec;
-        guint32 ts_usec;
-        guint32 incl_len;
+  GstPcapPacketInfo info;
+  const guint8 *payload_data;
+  gint payload_size;
+  guint i;
+
+  GST_LOG_OBJECT (self, "examining packet size %u", frame_size);
+
+  if (!gst_pcap_parse_scan_frame (self, linktype, frame, frame_size, &info,
+          &payload_data, &payload_size))
+    return;
+
+  if (GST_CLOCK_TIME_IS_VALID (ts)) {
+    if (!GST_CLOCK_TIME_IS_VALID (self->base_ts))
+      self->base_ts = ts;
+    if (self->offset >= 0) {
+      ts -= self->base_ts;
+      ts += self->offset;
+    }
+  }
+  self->cur_ts = ts;
+
+  for (i = 0; i < outputs->len; i++) {
+    GstPcapParseOutput *output =
+        &g_array_index (outputs, GstPcapParseOutput, i);
+    GstPcapParsePad *pad = output->pad;
+    GstBuffer *out_buf;
+
+    if (output->main && !gst_pcap_parse_match_properties (self, &info))
+      continue;
+    if (output->filter && !gst_pcap_filter_match (output->filter, &info))
+      continue;
+
+    /* @buffer is a single memory, see gst_pcap_parse_merge(), so the
+     * payload is a sub-memory of it. RTP depayloaders rely on this as they
+     * expect the complete RTP header to be in the first memory */
+    if (payload_size > 0) {
+      out_buf = gst_buffer_copy_region (buffer, GST_BUFFER_COPY_MEMORY,
+          payload_data - data, payload_size);
+      if (G_UNLIKELY (out_buf == NULL)) {
+        GST_WARNING_OBJECT (self, "Failed to get payload of %d bytes",
+            payload_size);
+        continue;
+      }
+    } else {
+      out_buf = gst_buffer_new ();
+    }
 
-        /* sizeof(pcaprec_hdr_t) == 16 */
-        if (avail < 16)
-          break;
+    /* only first packet should have DISCONT flag */
+    if (G_LIKELY (!pad->first_packet)) {
+      GST_BUFFER_FLAG_UNSET (out_buf, GST_BUFFER_FLAG_DISCONT);
+    } else {
+      GST_BUFFER_FLAG_SET (out_buf, GST_BUFFER_FLAG_DISCONT);
+      pad->first_packet = FALSE;
+    }
 
-        data = gst_adapter_map (self->adapter, 16);
+    GST_BUFFER_TIMESTAMP (out_buf) = ts;
 
-        ts_sec = gst_pcap_parse_read_uint32 (self, data + 0);
-        ts_usec = gst_pcap_parse_read_uint32 (self, data + 4);
-        incl_len = gst_pcap_parse_read_uint32 (self, data + 8);
-        /* orig_len = gst_pcap_parse_read_uint32 (self, data + 12); */
+    if (pad->pending == NULL)
+      pad->pending = gst_buffer_list_new ();
+    gst_buffer_list_add (pad->pending, out_buf);
+  }
+}
 
-        gst_adapter_unmap (self->adapter);
-        gst_adapter_flush (self->adapter, 16);
+/* Parses the pcap global header. Returns the number of bytes it takes, 0
+ * if more data is needed, or -1 on errors. */
+static gint
+gst_pcap_parse_global_header (GstPcapParse * self, const guint8 * data,
+    gsize size)
+{
+  guint32 magic;
+  guint32 linktype;
+  guint16 major_version;
+
+  /* sizeof(pcap_hdr_t) == 24 */
+  if (size < 24)
+    return 0;
+
+  magic = GST_READ_UINT32_LE (data);
+  major_version = GST_READ_UINT16_LE (data + 4);
+  linktype = GST_READ_UINT32_LE (data + 20);
+
+#if G_BYTE_ORDER == G_BIG_ENDIAN
+  magic = GUINT32_SWAP_LE_BE (magic);
+  major_version = GUINT16_SWAP_LE_BE (major_version);
+  linktype = GUINT32_SWAP_LE_BE (linktype);
+#endif
 
-        self->cur_ts =
-            ts_sec * GST_SECOND +
-            ts_usec * (self->nanosecond_timestamp ? 1 : GST_USECOND);
-        self->cur_packet_size = incl_len;
-      }
-    } else {
-      /* Parse the Global Header */
-      guint32 magic;
-      guint32 linktype;
-      guint16 major_version;
+  if (magic == GST_PCAPPARSE_MAGIC_MILLISECOND_NO_SWAP_ENDIAN ||
+      magic == GST_PCAPPARSE_MAGIC_NANOSECOND_NO_SWAP_ENDIAN) {
+    self->swap_endian = FALSE;
+    if (magic == GST_PCAPPARSE_MAGIC_NANOSECOND_NO_SWAP_ENDIAN)
+      self->nanosecond_timestamp = TRUE;
+  } else if (magic == GST_PCAPPARSE_MAGIC_MILLISECOND_SWAP_ENDIAN ||
+      magic == GST_PCAPPARSE_MAGIC_NANOSECOND_SWAP_ENDIAN) {
+    self->swap_endian = TRUE;
+    if (magic == GST_PCAPPARSE_MAGIC_NANOSECOND_SWAP_ENDIAN)
+      self->nanosecond_timestamp = TRUE;
+    major_version = GUINT16_SWAP_LE_BE (major_version);
+    linktype = GUINT32_SWAP_LE_BE (linktype);
+  } else {
+    GST_ELEMENT_ERROR (self, STREAM, WRONG_TYPE, (NULL),
+        ("File is not a libpcap or pcapng file, magic is %X", magic));
+    return -1;
+  }
 
-      /* sizeof(pcap_hdr_t) == 24 */
-      if (avail < 24)
-        break;
+  if (major_version != 2) {
+    GST_ELEMENT_ERROR (self, STREAM, WRONG_TYPE, (NULL),
+        ("File is not a libpcap major version 2, but %u", major_version));
+    return -1;
+  }
+
+  if (linktype != LINKTYPE_ETHER && linktype != LINKTYPE_SLL &&
+      linktype != LINKTYPE_RAW) {
+    GST_ELEMENT_ERROR (self, STREAM, WRONG_TYPE, (NULL),
+        ("Only dumps of type Ethernet, raw IP or Linux Cooked (SLL) "
+            "understood; type %d unknown", linktype));
+    return -1;
+  }
+
+  GST_DEBUG_OBJECT (self, "linktype %u", linktype);
+  self->linktype = linktype;
+  self->format = PCAP_PARSE_FORMAT_PCAP;
+
+  return 24;
+}
+
+/* Parses one pcap record. Returns the number of bytes it takes, 0 if more
+ * data is needed, or -1 on errors. */
+static gint64
+gst_pcap_parse_record (GstPcapParse * self, GArray * outputs,
+    GstBuffer * buffer, const guint8 * data, gsize offset, gsize size)
+{
+  const guint8 *p = data + offset;
+  guint32 ts_sec;
+  guint32 ts_usec;
+  guint32 incl_len;
+  GstClockTime ts;
+
+  /* sizeof(pcaprec_hdr_t) == 16 */
+  if (size < 16)
+    return 0;
+
+  ts_sec = gst_pcap_parse_read_uint32 (self, p + 0);
+  ts_usec = gst_pcap_parse_read_uint32 (self, p + 4);
+  incl_len = gst_pcap_parse_read_uint32 (self, p + 8);
+  /* orig_len = gst_pcap_parse_read_uint32 (self, p + 12); */
+
+  if (incl_len > MAX_RECORD_SIZE) {
+    GST_ELEMENT_ERROR (self, STREAM, DECODE, (NULL),
+        ("Invalid record size %u", incl_len));
+    return -1;
+  }
+
+  if (size < 16 + (gsize) incl_len)
+    return 0;
+
+  ts = ts_sec * GST_SECOND +
+      ts_usec * (self->nanosecond_timestamp ? 1 : GST_USECOND);
+
+  if (incl_len > 0)
+    gst_pcap_parse_handle_frame (self, outputs, buffer, data, p + 16,
+        incl_len, self->linktype, ts);
+
+  return 16 + incl_len;
+}
+
+static void
+gst_pcap_parse_read_interface (GstPcapParse * self, const guint8 * block,
+    guint32 block_len)
+{
+  GstPcapParseInterface iface;
+  guint32 pos;
 
-      data = gst_adapter_map (self->adapter, 24);
-
-      magic = *((guint32 *) data);
-      major_version = *((guint16 *) (data + 4));
-      linktype = *((guint32 *) (data + 20));
-      gst_adapter_unmap (self->adapter);
-
-      if (magic == GST_PCAPPARSE_MAGIC_MILLISECOND_NO_SWAP_ENDIAN ||
-          magic == GST_PCAPPARSE_MAGIC_NANOSECOND_NO_SWAP_ENDIAN) {
-        self->swap_endian = FALSE;
-        if (magic == GST_PCAPPARSE_MAGIC_NANOSECOND_NO_SWAP_ENDIAN)
-          self->nanosecond_timestamp = TRUE;
-      } else if (magic == GST_PCAPPARSE_MAGIC_MILLISECOND_SWAP_ENDIAN ||
-          magic == GST_PCAPPARSE_MAGIC_NANOSECOND_SWAP_ENDIAN) {
-        self->swap_endian = TRUE;
-        if (magic == GST_PCAPPARSE_MAGIC_NANOSECOND_SWAP_ENDIAN)
-          self->nanosecond_timestamp = TRUE;
-        major_version = GUINT16_SWAP_LE_BE (major_version);
-        linktype = GUINT32_SWAP_LE_BE (linktype);
+  iface.linktype = gst_pcap_parse_read_uint16 (self, block + 8);
+  iface.ts_units = 1000000;
+
+  /* options follow the linktype, reserved and snaplen fields */
+  pos = 16;
+  while (pos + 4 <= block_len - 4) {
+    guint16 code = gst_pcap_parse_read_uint16 (self, block + pos);
+    guint16 len = gst_pcap_parse_read_uint16 (self, block + pos + 2);
+
+    if (code == PCAPNG_OPTION_END || pos + 4 + len > block_len - 4)
+      break;
+
+    if (code == PCAPNG_OPTION_IF_TSRESOL && len == 1) {
+      guint8 resol = block[pos + 4];
+
+      if (resol & 0x80) {
+        iface.ts_units = G_GUINT64_CONSTANT (1) << MIN (resol & 0x7f, 63);
       } else {
-        GST_ELEMENT_ERROR (self, STREAM, WRONG_TYPE, (NULL),
-            ("File is not a libpcap file, magic is %X", magic));
-        ret = GST_FLOW_ERROR;
-        goto out;
+        guint i;
+
+        iface.ts_units = 1;
+        for (i = 0; i < MIN (resol, 19); i++)
+          iface.ts_units *= 10;
       }
+    }
 
-      if (major_version != 2) {
-        GST_ELEMENT_ERROR (self, STREAM, WRONG_TYPE, (NULL),
-            ("File is not a libpcap major version 2, but %u", major_version));
-        ret = GST_FLOW_ERROR;
-        goto out;
+    pos += 4 + GST_ROUND_UP_4 (len);
+  }
+
+  GST_DEBUG_OBJECT (self, "interface %u: linktype %u, %" G_GUINT64_FORMAT
+      " units per second", self->interfaces->len, iface.linktype,
+      iface.ts_units);
+  g_array_append_val (self->interfaces, iface);
+}
+
+/* Parses one pcapng block. Returns the number of bytes it takes, 0 if more
+ * data is needed, or -1 on errors. */
+static gint64
+gst_pcap_parse_block (GstPcapParse * self, GArray * outputs,
+    GstBuffer * buffer, const guint8 * data, gsize offset, gsize size)
+{
+  const guint8 *block = data + offset;
+  GstPcapParseInterface *iface;
+  guint32 block_type, block_len, iface_id, cap_len;
+  GstClockTime ts;
+
+  if (size < 12)
+    return 0;
+
+  block_type = gst_pcap_parse_read_uint32 (self, block);
+
+  /* a section header sets the byte order of everything up to the next */
+  if (block_type == PCAPNG_BLOCK_SECTION_HEADER) {
+    guint32 magic = GST_READ_UINT32_LE (block + 8);
+
+#if G_BYTE_ORDER == G_BIG_ENDIAN
+    magic = GUINT32_SWAP_LE_BE (magic);
+#endif
+    if (magic == PCAPNG_BYTE_ORDER_MAGIC) {
+      self->swap_endian = FALSE;
+    } else if (magic == PCAPNG_BYTE_ORDER_MAGIC_SWAPPED) {
+      self->swap_endian = TRUE;
+    } else {
+      GST_ELEMENT_ERROR (self, STREAM, DECODE, (NULL),
+          ("Invalid pcapng byte order magic %X", magic));
+      return -1;
+    }
+  }
+
+  block_len = gst_pcap_parse_read_uint32 (self, block + 4);
+  if (block_len < 12 || block_len % 4 != 0 || block_len > MAX_RECORD_SIZE) {
+    GST_ELEMENT_ERROR (self, STREAM, DECODE, (NULL),
+        ("Invalid pcapng block length %u", block_len));
+    return -1;
+  }
+
+  if (size < block_len)
+    return 0;
+
+  switch (block_type) {
+    case PCAPNG_BLOCK_SECTION_HEADER:
+      GST_DEBUG_OBJECT (self, "new section, swap endian %d",
+          self->swap_endian);
+      g_array_set_size (self->interfaces, 0);
+      break;
+    case PCAPNG_BLOCK_INTERFACE:
+      if (block_len >= 20)
+        gst_pcap_parse_read_interface (self, block, block_len);
+      break;
+    case PCAPNG_BLOCK_ENHANCED_PACKET:
+      if (block_len < 32)
+        break;
+      iface_id = gst_pcap_parse_read_uint32 (self, block + 8);
+      cap_len = gst_pcap_parse_read_uint32 (self, block + 20);
+      if (iface_id >= self->interfaces->len || cap_len > block_len - 32) {
+        GST_WARNING_OBJECT (self, "Skipping invalid enhanced packet block");
+        break;
       }
+      iface = &g_array_index (self->interfaces, GstPcapParseInterface,
+          iface_id);
+      ts = ((guint64) gst_pcap_parse_read_uint32 (self, block + 12) << 32) |
+          gst_pcap_parse_read_uint32 (self, block + 16);
+      ts = gst_util_uint64_scale (ts, GST_SECOND, iface->ts_units);
+      gst_pcap_parse_handle_frame (self, outputs, buffer, data, block + 28,
+          cap_len, iface->linktype, ts);
+      break;
+    case PCAPNG_BLOCK_SIMPLE_PACKET:
+      if (block_len < 16 || self->interfaces->len == 0)
+        break;
+      cap_len = MIN (gst_pcap_parse_read_uint32 (self, block + 8),
+          block_len - 16);
+      iface = &g_array_index (self->interfaces, GstPcapParseInterface, 0);
+      gst_pcap_parse_handle_frame (self, outputs, buffer, data, block + 12,
+          cap_len, iface->linktype, GST_CLOCK_TIME_NONE);
+      break;
+    default:
+      GST_LOG_OBJECT (self, "Skipping block of type 0x%x", block_type);
+      break;
+  }
 
-      if (linktype != LINKTYPE_ETHER && linktype != LINKTYPE_SLL &&
-          linktype != LINKTYPE_RAW) {
-        GST_ELEMENT_ERROR (self, STREAM, WRONG_TYPE, (NULL),
-            ("Only dumps of type Ethernet, raw IP or Linux Cooked (SLL) "
-                "understood; type %d unknown", linktype));
-        ret = GST_FLOW_ERROR;
-        goto out;
+  return block_len;
+}
+
+/* Parses all complete records in the mapped @buffer and sets @consumed to
+ * the number of bytes they take */
+static GstFlowReturn
+gst_pcap_parse_data (GstPcapParse * self, GArray * outputs, GstBuffer * buffer,
+    const guint8 * data, gsize size, gsize * consumed)
+{
+  gsize pos = 0;
+  gint64 len;
+
+  *consumed = 0;
+
+  while (TRUE) {
+    if (!self->initialized) {
+      if (size - pos < 4)
+        break;
+
+      /* the section header starting a pcapng file is parsed as a block */
+      if (GST_READ_UINT32_LE (data + pos) == PCAPNG_BLOCK_SECTION_HEADER) {
+        GST_DEBUG_OBJECT (self, "pcapng file");
+        self->format = PCAP_PARSE_FORMAT_PCAPNG;
+        self->initialized = TRUE;
+        continue;
       }
 
-      GST_DEBUG_OBJECT (self, "linktype %u", linktype);
-      self->linktype = linktype;
+      len = gst_pcap_parse_global_header (self, data + pos, size - pos);
+      if (len > 0)
+        self->initialized = TRUE;
+    } else if (self->format == PCAP_PARSE_FORMAT_PCAPNG) {
+      len = gst_pcap_parse_block (self, outputs, buffer, data, pos,
+          size - pos);
+    } else {
+      len = gst_pcap_parse_record (self, outputs, buffer, data, pos,
+          size - pos);
+    }
+
+    if (len < 0)
+      return GST_FLOW_ERROR;
+    if (len == 0)
+      break;
+    pos += len;
+  }
+
+  *consumed = pos;
+  return GST_FLOW_OK;
+}
+
+static void
+gst_pcap_parse_clear_pending (GArray * outputs)
+{
+  guint i;
 
-      gst_adapter_flush (self->adapter, 24);
-      self->initialized = TRUE;
+  for (i = 0; i < outputs->len; i++) {
+    GstPcapParsePad *pad = g_array_index (outputs, GstPcapParseOutput, i).pad;
+
+    if (pad->pending) {
+      gst_buffer_list_unref (pad->pending);
+      pad->pending = NULL;
     }
   }
+}
 
-  if (list) {
-    if (!self->newsegment_sent && GST_CLOCK_TIME_IS_VALID (self->cur_ts)) {
+static GstFlowReturn
+gst_pcap_parse_push_pending (GstPcapParse * self, GArray * outputs)
+{
+  GstFlowReturn ret = GST_FLOW_OK;
+  guint i;
+
+  for (i = 0; i < outputs->len; i++) {
+    GstPcapParsePad *pad = g_array_index (outputs, GstPcapParseOutput, i).pad;
+    GstBufferList *list = pad->pending;
+    GstFlowReturn flow;
+
+    if (list == NULL)
+      continue;
+    pad->pending = NULL;
+
+    if (!pad->newsegment_sent) {
+      GstEvent *event;
       GstSegment segment;
 
+      /* upstream only provides a stream-start for the always pad in push
+       * mode */
+      event = gst_pad_get_sticky_event (GST_PAD (pad),
+          GST_EVENT_STREAM_START, 0);
+      if (event == NULL) {
+        gchar *stream_id = gst_pad_create_stream_id (GST_PAD (pad),
+            GST_ELEMENT_CAST (self), GST_PAD_NAME (pad));
+
+        event = gst_event_new_stream_start (stream_id);
+        gst_event_set_group_id (event, gst_util_group_id_next ());
+        gst_pad_push_event (GST_PAD (pad), event);
+        g_free (stream_id);
+      } else {
+        gst_event_unref (event);
+      }
+
       if (self->caps)
-        gst_pad_set_caps (self->src_pad, self->caps);
+        gst_pad_set_caps (GST_PAD (pad), self->caps);
       gst_segment_init (&segment, GST_FORMAT_TIME);
-      segment.start = self->base_ts;
-      gst_pad_push_event (self->src_pad, gst_event_new_segment (&segment));
-      self->newsegment_sent = TRUE;
+      if (GST_CLOCK_TIME_IS_VALID (self->base_ts))
+        segment.start = self->base_ts;
+      gst_pad_push_event (GST_PAD (pad), gst_event_new_segment (&segment));
+      pad->newsegment_sent = TRUE;
     }
 
-    ret = gst_pad_push_list (self->src_pad, list);
-    list = NULL;
+    flow = gst_pad_push_list (GST_PAD (pad), list);
+    ret = gst_flow_combiner_update_pad_flow (self->flow_combiner,
+        GST_PAD (pad), flow);
   }
 
-out:
+  return ret;
+}
 
-  if (list)
-    gst_buffer_list_unref (list);
+/* Parses @buffer, which must have a single memory, and pushes the payloads
+ * found. Bytes of an incomplete record at the end are left out. */
+static GstFlowReturn
+gst_pcap_parse_process (GstPcapParse * self, GstBuffer * buffer,
+    gsize * consumed, gsize * size)
+{
+  GstFlowReturn ret;
+  GArray *outputs;
+  GstMapInfo map;
+
+  if (!gst_buffer_map (buffer, &map, GST_MAP_READ)) {
+    GST_ELEMENT_ERROR (self, RESOURCE, READ, (NULL), ("Failed to map buffer"));
+    return GST_FLOW_ERROR;
+  }
+
+  outputs = gst_pcap_parse_get_outputs (self);
+  ret = gst_pcap_parse_data (self, outputs, buffer, map.data, map.size,
+      consumed);
+  *size = map.size;
+  gst_buffer_unmap (buffer, &map);
+
+  if (ret == GST_FLOW_OK)
+    ret = gst_pcap_parse_push_pending (self, outputs);
+  else
+    gst_pcap_parse_clear_pending (outputs);
+  gst_pcap_parse_free_outputs (outputs);
 
   return ret;
 }
 
+/* Records are parsed in place, which needs them in a single memory. Takes
+ * ownership of @buffer and returns it, or a copy merged into one memory */
+static GstBuffer *
+gst_pcap_parse_merge (GstBuffer * buffer)
+{
+  GstBuffer *merged;
+
+  if (gst_buffer_n_memory (buffer) == 1)
+    return buffer;
+
+  merged = gst_buffer_copy_region (buffer, GST_BUFFER_COPY_ALL |
+      GST_BUFFER_COPY_MERGE | GST_BUFFER_COPY_DEEP, 0, -1);
+  gst_buffer_unref (buffer);
+
+  return merged;
+}
+
+static GstFlowReturn
+gst_pcap_parse_chain (GstPad * pad, GstObject * parent, GstBuffer * buffer)
+{
+  GstPcapParse *self = GST_PCAP_PARSE (parent);
+  GstFlowReturn ret;
+  gsize consumed, size;
+
+  /* the leftover from the last buffer gets merged with the new one */
+  if (gst_adapter_available (self->adapter) > 0) {
+    gst_adapter_push (self->adapter, buffer);
+    buffer = gst_adapter_take_buffer (self->adapter,
+        gst_adapter_available (self->adapter));
+  }
+  buffer = gst_pcap_parse_merge (buffer);
+
+  ret = gst_pcap_parse_process (self, buffer, &consumed, &size);
+
+  if (ret == GST_FLOW_OK && consumed < size)
+    gst_adapter_push (self->adapter, gst_buffer_copy_region (buffer,
+            GST_BUFFER_COPY_MEMORY, consumed, size - consumed));
+  gst_buffer_unref (buffer);
+
+  return ret;
+}
+
+static void
+gst_pcap_parse_push_src_event (GstPcapParse * self, GstEvent * event)
+{
+  GstIterator *it;
+  GValue item = G_VALUE_INIT;
+  gboolean done = FALSE;
+
+  it = gst_element_iterate_src_pads (GST_ELEMENT_CAST (self));
+  while (!done) {
+    switch (gst_iterator_next (it, &item)) {
+      case GST_ITERATOR_OK:
+        gst_pad_push_event (g_value_get_object (&item),
+            gst_event_ref (event));
+        g_value_reset (&item);
+        break;
+      case GST_ITERATOR_RESYNC:
+        gst_iterator_resync (it);
+        break;
+      default:
+        done = TRUE;
+        break;
+    }
+  }
+  g_value_unset (&item);
+  gst_iterator_free (it);
+  gst_event_unref (event);
+}
+
+static void
+gst_pcap_parse_loop (GstPad * sinkpad)
+{
+  GstPcapParse *self = GST_PCAP_PARSE (GST_PAD_PARENT (sinkpad));
+  GstBuffer *buffer = NULL;
+  GstFlowReturn ret;
+  gsize consumed, size;
+
+  ret = gst_pad_pull_range (sinkpad, self->pull_offset, self->pull_size,
+      &buffer);
+  if (ret != GST_FLOW_OK)
+    goto pause;
+
+  /* filesrc hands out a single memory, but don't rely on it */
+  buffer = gst_pcap_parse_merge (buffer);
+
+  ret = gst_pcap_parse_process (self, buffer, &consumed, &size);
+  gst_buffer_unref (buffer);
+  if (ret != GST_FLOW_OK)
+    goto pause;
+
+  self->pull_offset += consumed;
+  if (consumed > 0) {
+    self->pull_size = DEFAULT_PULL_SIZE;
+  } else if (size < self->pull_size) {
+    GST_DEBUG_OBJECT (self, "truncated record at the end of the file");
+    ret = GST_FLOW_EOS;
+    goto pause;
+  } else {
+    /* a single record is bigger than what we pulled */
+    self->pull_size *= 2;
+  }
+
+  return;
+
+pause:
+  {
+    GST_LOG_OBJECT (self, "pausing task, reason %s", gst_flow_get_name (ret));
+    gst_pad_pause_task (sinkpad);
+    if (ret == GST_FLOW_EOS) {
+      gst_pcap_parse_push_src_event (self, gst_event_new_eos ());
+    } else if (ret == GST_FLOW_NOT_LINKED || ret < GST_FLOW_EOS) {
+      /* parsing errors are posted where they are found */
+      if (ret != GST_FLOW_ERROR)
+        GST_ELEMENT_FLOW_ERROR (self, ret);
+      gst_pcap_parse_push_src_event (self, gst_event_new_eos ());
+    }
+  }
+}
+
+static gboolean
+gst_pcap_parse_sink_activate (GstPad * sinkpad, GstObject * parent)
+{
+  GstQuery *query;
+  gboolean pull_mode;
+
+  query = gst_query_new_scheduling ();
+
+  if (!gst_pad_peer_query (sinkpad, query)) {
+    gst_query_unref (query);
+    goto activate_push;
+  }
+
+  pull_mode = gst_query_has_scheduling_mode_with_flags (query,
+      GST_PAD_MODE_PULL, GST_SCHEDULING_FLAG_SEEKABLE);
+  gst_query_unref (query);
+
+  if (!pull_mode)
+    goto activate_push;
+
+  GST_DEBUG_OBJECT (sinkpad, "activating pull");
+  return gst_pad_activate_mode (sinkpad, GST_PAD_MODE_PULL, TRUE);
+
+activate_push:
+  {
+    GST_DEBUG_OBJECT (sinkpad, "activating push");
+    return gst_pad_activate_mode (sinkpad, GST_PAD_MODE_PUSH, TRUE);
+  }
+}
+
+static gboolean
+gst_pcap_parse_sink_activatemode (GstPad * pad, GstObject * parent,
+    GstPadMode mode, gboolean active)
+{
+  gboolean res;
+
+  switch (mode) {
+    case GST_PAD_MODE_PUSH:
+      res = TRUE;
+      break;
+    case GST_PAD_MODE_PULL:
+      if (active) {
+        res = gst_pad_start_task (pad, (GstTaskFunction) gst_pcap_parse_loop,
+            pad, NULL);
+      } else {
+        res = gst_pad_stop_task (pad);
+      }
+      break;
+    default:
+      res = FALSE;
+      break;
+  }
+  return res;
+}
+
 static gboolean
 gst_pcap_sink_event (GstPad * pad, GstObject * parent, GstEvent * event)
 {
@@ -695,7 +1518,7 @@ gst_pcap_sink_event (GstPad * pad, GstObject * parent, GstEvent * event)
       /* Push event down the pipeline so that other elements stop flushing */
       /* fall through */
     default:
-      ret = gst_pad_push_event (self->src_pad, event);
+      ret = gst_pad_event_default (pad, parent, event);
       break;
   }
 
@@ -22,6 +22,9 @@
 
 #include <gst/gst.h>
 #include <gst/base/gstadapter.h>
+#include <gst/base/gstflowcombiner.h>
+
+#include "gstpcapfilter.h"
 
 G_BEGIN_DECLS
 
@@ -36,8 +39,14 @@ G_BEGIN_DECLS
 #define GST_IS_PCAP_PARSE_CLASS(klass) \
   (G_TYPE_CHECK_CLASS_TYPE ((klass), GST_TYPE_PCAP_PARSE))
 
+#define GST_TYPE_PCAP_PARSE_PAD (gst_pcap_parse_pad_get_type ())
+#define GST_PCAP_PARSE_PAD(obj) \
+  (G_TYPE_CHECK_INSTANCE_CAST ((obj), GST_TYPE_PCAP_PARSE_PAD, GstPcapParsePad))
+
 typedef struct _GstPcapParse      GstPcapParse;
 typedef struct _GstPcapParseClass GstPcapParseClass;
+typedef struct _GstPcapParsePad   GstPcapParsePad;
+typedef struct _GstPcapParsePadClass GstPcapParsePadClass;
 
 typedef enum
 {
@@ -45,6 +54,13 @@ typedef enum
   PCAP_PARSE_STATE_PARSING,
 } GstPcapParseState;
 
+typedef enum
+{
+  PCAP_PARSE_FORMAT_UNKNOWN,
+  PCAP_PARSE_FORMAT_PCAP,
+  PCAP_PARSE_FORMAT_PCAPNG
+} GstPcapParseFormat;
+
 typedef enum
 {
   LINKTYPE_ETHER  = 1,
@@ -52,6 +68,37 @@ typedef enum
   LINKTYPE_SLL = 113
 } GstPcapParseLinktype;
 
+/* A capture interface of a pcapng section */
+typedef struct
+{
+  GstPcapParseLinktype linktype;
+  guint64 ts_units;
+} GstPcapParseInterface;
+
+/**
+ * GstPcapParsePad:
+ *
+ * A source pad of #GstPcapParse with its own filter.
+ */
+struct _GstPcapParsePad
+{
+  GstPad pad;
+
+  /*< private >*/
+  gchar *filter_str;
+  GstPcapFilter *filter;
+
+  /* streaming state */
+  GstBufferList *pending;
+  gboolean newsegment_sent;
+  gboolean first_packet;
+};
+
+struct _GstPcapParsePadClass
+{
+  GstPadClass parent_class;
+};
+
 /**
  * GstPcapParse:
  *
@@ -73,19 +120,26 @@ struct _GstPcapParse
   gint32 dst_port;
   GstCaps *caps;
   gint64 offset;
+  gchar *filter_str;
+  GstPcapFilter *filter;
 
   /* state */
   GstAdapter * adapter;
   gboolean initialized;
+  GstPcapParseFormat format;
   gboolean swap_endian;
   gboolean nanosecond_timestamp;
-  gint64 cur_packet_size;
   GstClockTime cur_ts;
   GstClockTime base_ts;
   GstPcapParseLinktype linktype;
+  GArray *interfaces;
 
-  gboolean newsegment_sent;
-  gboolean first_packet;
+  /* pull mode */
+  guint64 pull_offset;
+  guint pull_size;
+
+  GstFlowCombiner *flow_combiner;
+  guint n_request_pads;
 };
 
 struct _GstPcapParseClass
@@ -94,6 +148,7 @@ struct _GstPcapParseClass
 };
 
 GType gst_pcap_parse_get_type (void);
+GType gst_pcap_parse_pad_get_type (void);
 
 G_END_DECLS
 
@@ -33,6 +33,13 @@
  * However, the queue may get filled up if the downstream pipeline does not
  * accept buffers quickly enough; perhaps because it is not yet PLAYING.
  *
+ * With #GstProxySrc:mode set to ring, the queue is replaced by a bounded
+ * lock-free ring of #GstProxySrc:ring-size items that proxysink writes into
+ * and that the streaming thread of proxysrc reads from directly. This avoids
+ * the locking and bookkeeping of the queue for every buffer, which mostly
+ * matters for low latency streams with small buffers. #GstProxySrc:leaky
+ * selects what happens when the queue or the ring is full.
+ *
  * ## Usage
  * 
  * |[<!-- language="C" -->
@@ -87,12 +94,60 @@ static GstStaticPadTemplate src_template = GST_STATIC_PAD_TEMPLATE ("src",
     GST_PAD_ALWAYS,
     GST_STATIC_CAPS_ANY);
 
+#define DEFAULT_MODE GST_PROXY_SRC_MODE_QUEUE
+#define DEFAULT_LEAKY GST_PROXY_SRC_LEAKY_NO
+#define DEFAULT_RING_SIZE 32
+
+/* Stands in the ring for the pending serialized query */
+static const gchar ring_query_marker;
+#define RING_QUERY_MARKER ((GstMiniObject *) &ring_query_marker)
+
 enum
 {
   PROP_0,
   PROP_PROXYSINK,
+  PROP_MODE,
+  PROP_LEAKY,
+  PROP_RING_SIZE,
 };
 
+#define GST_TYPE_PROXY_SRC_MODE (gst_proxy_src_mode_get_type ())
+static GType
+gst_proxy_src_mode_get_type (void)
+{
+  static GType mode_type = 0;
+  static const GEnumValue modes[] = {
+    {GST_PROXY_SRC_MODE_QUEUE, "Decouple through an internal queue", "queue"},
+    {GST_PROXY_SRC_MODE_RING, "Hand over through a lock-free ring", "ring"},
+    {0, NULL, NULL},
+  };
+
+  if (!mode_type)
+    mode_type = g_enum_register_static ("GstProxySrcMode", modes);
+
+  return mode_type;
+}
+
+#define GST_TYPE_PROXY_SRC_LEAKY (gst_proxy_src_leaky_get_type ())
+static GType
+gst_proxy_src_leaky_get_type (void)
+{
+  static GType leaky_type = 0;
+  static const GEnumValue leaky[] = {
+    {GST_PROXY_SRC_LEAKY_NO, "Not Leaky", "no"},
+    {GST_PROXY_SRC_LEAKY_UPSTREAM, "Leaky on upstream (new buffers)",
+        "upstream"},
+    {GST_PROXY_SRC_LEAKY_DOWNSTREAM, "Leaky on downstream (old buffers)",
+        "downstream"},
+    {0, NULL, NULL},
+  };
+
+  if (!leaky_type)
+    leaky_type = g_enum_register_static ("GstProxySrcLeaky", leaky);
+
+  return leaky_type;
+}
+
 /* We're not subclassing from basesrc because we don't want any of the special
  * handling it has for events/queries/etc. We just pass-through everything. */
 
@@ -112,6 +167,22 @@ static gboolean gst_proxy_src_send_event (GstElement * element,
     GstEvent * event);
 static gboolean gst_proxy_src_query (GstElement * element, GstQuery * query);
 static void gst_proxy_src_dispose (GObject * object);
+static void gst_proxy_src_finalize (GObject * object);
+
+static GstFlowReturn gst_proxy_src_ring_sink_chain (GstPad * pad,
+    GstObject * parent, GstBuffer * buffer);
+static GstFlowReturn gst_proxy_src_ring_sink_chain_list (GstPad * pad,
+    GstObject * parent, GstBufferList * list);
+static gboolean gst_proxy_src_ring_sink_event (GstPad * pad,
+    GstObject * parent, GstEvent * event);
+static gboolean gst_proxy_src_ring_sink_query (GstPad * pad,
+    GstObject * parent, GstQuery * query);
+static gboolean gst_proxy_src_ring_src_event (GstPad * pad,
+    GstObject * parent, GstEvent * event);
+static gboolean gst_proxy_src_ring_src_query (GstPad * pad,
+    GstObject * parent, GstQuery * query);
+static gboolean gst_proxy_src_ring_src_activate_mode (GstPad * pad,
+    GstObject * parent, GstPadMode mode, gboolean active);
 
 static void
 gst_proxy_src_get_property (GObject * object, guint prop_id, GValue * value,
@@ -123,6 +194,15 @@ gst_proxy_src_get_property (GObject * object, guint prop_id, GValue * value,
     case PROP_PROXYSINK:
       g_value_take_object (value, g_weak_ref_get (&self->proxysink));
       break;
+    case PROP_MODE:
+      g_value_set_enum (value, self->mode);
+      break;
+    case PROP_LEAKY:
+      g_value_set_enum (value, self->leaky);
+      break;
+    case PROP_RING_SIZE:
+      g_value_set_uint (value, self->ring_size);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, spec);
       break;
@@ -155,6 +235,16 @@ gst_proxy_src_set_property (GObject * object, guint prop_id,
         g_object_unref (sink);
       }
       break;
+    case PROP_MODE:
+      self->mode = g_value_get_enum (value);
+      break;
+    case PROP_LEAKY:
+      self->leaky = g_value_get_enum (value);
+      g_object_set (self->queue, "leaky", self->leaky, NULL);
+      break;
+    case PROP_RING_SIZE:
+      self->ring_size = g_value_get_uint (value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, spec);
   }
@@ -169,6 +259,7 @@ gst_proxy_src_class_init (GstProxySrcClass * klass)
   GST_DEBUG_CATEGORY_INIT (gst_proxy_src_debug, "proxysrc", 0, "proxy sink");
 
   gobject_class->dispose = gst_proxy_src_dispose;
+  gobject_class->finalize = gst_proxy_src_finalize;
 
   gobject_class->get_property = gst_proxy_src_get_property;
   gobject_class->set_property = gst_proxy_src_set_property;
@@ -177,6 +268,48 @@ gst_proxy_src_class_init (GstProxySrcClass * klass)
       g_param_spec_object ("proxysink", "Proxysink", "Matching proxysink",
           GST_TYPE_PROXY_SINK, G_PARAM_READWRITE));
 
+  /**
+   * GstProxySrc:mode:
+   *
+   * How buffers are passed from proxysink to the streaming thread of
+   * proxysrc. Takes effect the next time the element goes to PAUSED.
+   *
+   * Since: 1.18
+   */
+  g_object_class_install_property (gobject_class, PROP_MODE,
+      g_param_spec_enum ("mode", "Mode",
+          "How buffers are passed on from proxysink", GST_TYPE_PROXY_SRC_MODE,
+          DEFAULT_MODE, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS |
+          GST_PARAM_MUTABLE_READY));
+
+  /**
+   * GstProxySrc:leaky:
+   *
+   * What to do when the queue or the ring is full. Events are never dropped
+   * when leaking upstream, so they can still block proxysink.
+   *
+   * Since: 1.18
+   */
+  g_object_class_install_property (gobject_class, PROP_LEAKY,
+      g_param_spec_enum ("leaky", "Leaky",
+          "Where buffers are dropped when full", GST_TYPE_PROXY_SRC_LEAKY,
+          DEFAULT_LEAKY, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS |
+          GST_PARAM_MUTABLE_READY));
+
+  /**
+   * GstProxySrc:ring-size:
+   *
+   * Number of buffers, buffer lists and events the ring holds in ring mode,
+   * rounded up to a power of two.
+   *
+   * Since: 1.18
+   */
+  g_object_class_install_property (gobject_class, PROP_RING_SIZE,
+      g_param_spec_uint ("ring-size", "Ring Size",
+          "Number of items the ring holds in ring mode", 2, 65536,
+          DEFAULT_RING_SIZE, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS |
+          GST_PARAM_MUTABLE_READY));
+
   gstelement_class->change_state = gst_proxy_src_change_state;
   gstelement_class->send_event = gst_proxy_src_send_event;
   gstelement_class->query = gst_proxy_src_query;
@@ -232,6 +365,37 @@ gst_proxy_src_init (GstProxySrc * self)
   gst_pad_link (self->internal_srcpad, sinkpad);
   gst_object_unref (sinkpad);
 
+  /* Pads replacing the queue in ring mode. Like dummy_sinkpad, they are
+   * parented to us without being added to the element. */
+  self->ring_sinkpad = gst_pad_new ("ring_sink", GST_PAD_SINK);
+  gst_object_set_parent (GST_OBJECT (self->ring_sinkpad), GST_OBJECT (self));
+  gst_pad_set_chain_function (self->ring_sinkpad,
+      GST_DEBUG_FUNCPTR (gst_proxy_src_ring_sink_chain));
+  gst_pad_set_chain_list_function (self->ring_sinkpad,
+      GST_DEBUG_FUNCPTR (gst_proxy_src_ring_sink_chain_list));
+  gst_pad_set_event_function (self->ring_sinkpad,
+      GST_DEBUG_FUNCPTR (gst_proxy_src_ring_sink_event));
+  gst_pad_set_query_function (self->ring_sinkpad,
+      GST_DEBUG_FUNCPTR (gst_proxy_src_ring_sink_query));
+
+  self->ring_srcpad = gst_pad_new ("ring_src", GST_PAD_SRC);
+  gst_object_set_parent (GST_OBJECT (self->ring_srcpad), GST_OBJECT (self));
+  gst_pad_set_activatemode_function (self->ring_srcpad,
+      GST_DEBUG_FUNCPTR (gst_proxy_src_ring_src_activate_mode));
+  gst_pad_set_event_function (self->ring_srcpad,
+      GST_DEBUG_FUNCPTR (gst_proxy_src_ring_src_event));
+  gst_pad_set_query_function (self->ring_srcpad,
+      GST_DEBUG_FUNCPTR (gst_proxy_src_ring_src_query));
+
+  g_mutex_init (&self->ring_lock);
+  g_cond_init (&self->ring_cond);
+  self->flushing = TRUE;
+  self->srcresult = GST_FLOW_FLUSHING;
+
+  self->mode = DEFAULT_MODE;
+  self->leaky = DEFAULT_LEAKY;
+  self->ring_size = DEFAULT_RING_SIZE;
+
   gst_bin_set_suppressed_flags (GST_BIN (self),
       GST_ELEMENT_FLAG_SOURCE | GST_ELEMENT_FLAG_SINK);
   GST_OBJECT_FLAG_SET (self, GST_ELEMENT_FLAG_SOURCE);
@@ -248,11 +412,522 @@ gst_proxy_src_dispose (GObject * object)
   gst_object_unparent (GST_OBJECT (self->internal_srcpad));
   self->internal_srcpad = NULL;
 
+  if (self->ring_sinkpad) {
+    gst_object_unparent (GST_OBJECT (self->ring_sinkpad));
+    self->ring_sinkpad = NULL;
+  }
+
+  if (self->ring_srcpad) {
+    gst_object_unparent (GST_OBJECT (self->ring_srcpad));
+    self->ring_srcpad = NULL;
+  }
+
   g_weak_ref_set (&self->proxysink, NULL);
 
   G_OBJECT_CLASS (gst_proxy_src_parent_class)->dispose (object);
 }
 
+static void
+gst_proxy_src_finalize (GObject * object)
+{
+  GstProxySrc *self = GST_PROXY_SRC (object);
+
+  g_mutex_clear (&self->ring_lock);
+  g_cond_clear (&self->ring_cond);
+
+  G_OBJECT_CLASS (gst_proxy_src_parent_class)->finalize (object);
+}
+
+/* Links internal_srcpad and our srcpad either to the queue or to the ring
+ * pads, depending on the mode */
+static void
+gst_proxy_src_setup_mode (GstProxySrc * self)
+{
+  GstPad *sinkpad, *srcpad, *peer;
+
+  if (self->mode == GST_PROXY_SRC_MODE_RING) {
+    sinkpad = gst_object_ref (self->ring_sinkpad);
+    srcpad = gst_object_ref (self->ring_srcpad);
+  } else {
+    sinkpad = gst_element_get_static_pad (self->queue, "sink");
+    srcpad = gst_element_get_static_pad (self->queue, "src");
+  }
+
+  peer = gst_pad_get_peer (self->internal_srcpad);
+  if (peer != sinkpad) {
+    GST_DEBUG_OBJECT (self, "switching to %s mode",
+        self->mode == GST_PROXY_SRC_MODE_RING ? "ring" : "queue");
+    if (peer)
+      gst_pad_unlink (self->internal_srcpad, peer);
+    gst_pad_link (self->internal_srcpad, sinkpad);
+    gst_ghost_pad_set_target (GST_GHOST_PAD (self->srcpad), srcpad);
+  }
+
+  if (peer)
+    gst_object_unref (peer);
+  gst_object_unref (sinkpad);
+  gst_object_unref (srcpad);
+}
+
+static void
+gst_proxy_src_ring_wake_up (GstProxySrc * self)
+{
+  g_mutex_lock (&self->ring_lock);
+  g_cond_broadcast (&self->ring_cond);
+  g_mutex_unlock (&self->ring_lock);
+}
+
+static guint
+gst_proxy_src_ring_n_items (GstProxySrc * self)
+{
+  return (guint) g_atomic_int_get (&self->ring_write) -
+      (guint) g_atomic_int_get (&self->ring_read);
+}
+
+/* Called by the producer only */
+static gboolean
+gst_proxy_src_ring_try_push (GstProxySrc * self, GstMiniObject * item)
+{
+  guint w = (guint) self->ring_write;
+
+  if (w - (guint) g_atomic_int_get (&self->ring_read) > self->ring_mask)
+    return FALSE;
+
+  g_atomic_pointer_set (&self->ring[w & self->ring_mask], item);
+  g_atomic_int_set (&self->ring_write, w + 1);
+
+  if (g_atomic_int_get (&self->consumer_waiting))
+    gst_proxy_src_ring_wake_up (self);
+
+  return TRUE;
+}
+
+/* Called by the consumer, and by the producer to leak the oldest item. An item
+ * belongs to whoever manages to move the read index past it. */
+static GstMiniObject *
+gst_proxy_src_ring_try_pop (GstProxySrc * self)
+{
+  GstMiniObject *item;
+  guint r;
+
+  do {
+    r = (guint) g_atomic_int_get (&self->ring_read);
+    if (r == (guint) g_atomic_int_get (&self->ring_write))
+      return NULL;
+    item = g_atomic_pointer_get (&self->ring[r & self->ring_mask]);
+  } while (!g_atomic_int_compare_and_exchange (&self->ring_read, (gint) r,
+          (gint) (r + 1)));
+
+  if (g_atomic_int_get (&self->producer_waiting))
+    gst_proxy_src_ring_wake_up (self);
+
+  return item;
+}
+
+/* Completes the pending query, if any, with @result and wakes up its
+ * caller */
+static void
+gst_proxy_src_ring_finish_query (GstProxySrc * self, gboolean result)
+{
+  g_mutex_lock (&self->ring_lock);
+  if (self->pending_query) {
+    self->pending_query = NULL;
+    self->query_in_progress = FALSE;
+    self->query_handled = TRUE;
+    self->query_result = result;
+    g_cond_broadcast (&self->ring_cond);
+  }
+  g_mutex_unlock (&self->ring_lock);
+}
+
+static void
+gst_proxy_src_ring_drop (GstProxySrc * self, GstMiniObject * item)
+{
+  /* queries are owned by the thread waiting for their result, only tell it
+   * that the query was not answered */
+  if (item == RING_QUERY_MARKER) {
+    GST_LOG_OBJECT (self, "dropping serialized query");
+    gst_proxy_src_ring_finish_query (self, FALSE);
+    return;
+  }
+
+  GST_LOG_OBJECT (self, "dropping %" GST_PTR_FORMAT, item);
+
+  /* like queue, keep sticky events so that they are sent before the next
+   * buffer */
+  if (GST_IS_EVENT (item) && GST_EVENT_IS_STICKY (GST_EVENT_CAST (item)))
+    gst_pad_store_sticky_event (self->ring_srcpad, GST_EVENT_CAST (item));
+
+  gst_mini_object_unref (item);
+}
+
+static GstFlowReturn
+gst_proxy_src_ring_push (GstProxySrc * self, GstMiniObject * item,
+    gboolean droppable)
+{
+  GstFlowReturn ret;
+
+  while (!gst_proxy_src_ring_try_push (self, item)) {
+    ret = g_atomic_int_get (&self->srcresult);
+    if (ret != GST_FLOW_OK) {
+      gst_proxy_src_ring_drop (self, item);
+      return ret;
+    }
+
+    if (self->leaky == GST_PROXY_SRC_LEAKY_UPSTREAM && droppable) {
+      gst_proxy_src_ring_drop (self, item);
+      return GST_FLOW_OK;
+    }
+
+    if (self->leaky == GST_PROXY_SRC_LEAKY_DOWNSTREAM) {
+      GstMiniObject *leak = gst_proxy_src_ring_try_pop (self);
+
+      if (leak)
+        gst_proxy_src_ring_drop (self, leak);
+      continue;
+    }
+
+    g_mutex_lock (&self->ring_lock);
+    g_atomic_int_set (&self->producer_waiting, 1);
+    while (gst_proxy_src_ring_n_items (self) > self->ring_mask &&
+        g_atomic_int_get (&self->srcresult) == GST_FLOW_OK)
+      g_cond_wait (&self->ring_cond, &self->ring_lock);
+    g_atomic_int_set (&self->producer_waiting, 0);
+    g_mutex_unlock (&self->ring_lock);
+  }
+
+  return GST_FLOW_OK;
+}
+
+/* Returns NULL when flushing, the items left in the ring are then cleared
+ * by the flush or the deactivation */
+static GstMiniObject *
+gst_proxy_src_ring_pop (GstProxySrc * self)
+{
+  GstMiniObject *item;
+
+  if (g_atomic_int_get (&self->flushing))
+    return NULL;
+
+  while (!(item = gst_proxy_src_ring_try_pop (self))) {
+    gboolean flushing;
+
+    g_mutex_lock (&self->ring_lock);
+    g_atomic_int_set (&self->consumer_waiting, 1);
+    while (gst_proxy_src_ring_n_items (self) == 0 &&
+        !g_atomic_int_get (&self->flushing))
+      g_cond_wait (&self->ring_cond, &self->ring_lock);
+    g_atomic_int_set (&self->consumer_waiting, 0);
+    flushing = g_atomic_int_get (&self->flushing);
+    g_mutex_unlock (&self->ring_lock);
+
+    if (flushing)
+      return NULL;
+  }
+
+  return item;
+}
+
+/* Must only be called while neither side uses the ring */
+static void
+gst_proxy_src_ring_clear (GstProxySrc * self)
+{
+  GstMiniObject *item;
+
+  if (!self->ring)
+    return;
+
+  /* the caller of a query still in the ring already gave up on it */
+  while ((item = gst_proxy_src_ring_try_pop (self))) {
+    if (item != RING_QUERY_MARKER)
+      gst_mini_object_unref (item);
+  }
+}
+
+static void
+gst_proxy_src_ring_set_flushing (GstProxySrc * self, gboolean flushing)
+{
+  g_mutex_lock (&self->ring_lock);
+  g_atomic_int_set (&self->flushing, flushing);
+  g_atomic_int_set (&self->srcresult,
+      flushing ? GST_FLOW_FLUSHING : GST_FLOW_OK);
+  g_cond_broadcast (&self->ring_cond);
+  g_mutex_unlock (&self->ring_lock);
+}
+
+static void
+gst_proxy_src_ring_loop (GstPad * pad)
+{
+  GstProxySrc *self = GST_PROXY_SRC (GST_OBJECT_PARENT (pad));
+  GstMiniObject *item;
+  GstFlowReturn ret = GST_FLOW_OK;
+
+  item = gst_proxy_src_ring_pop (self);
+  if (!item)
+    goto flushing;
+
+  /* the marker is not a mini object, check for it first */
+  if (item == RING_QUERY_MARKER) {
+    GstQuery *query;
+
+    /* the caller keeps waiting as long as the query is in progress */
+    g_mutex_lock (&self->ring_lock);
+    query = self->pending_query;
+    if (query)
+      self->query_in_progress = TRUE;
+    g_mutex_unlock (&self->ring_lock);
+
+    if (query)
+      gst_proxy_src_ring_finish_query (self, gst_pad_peer_query (pad, query));
+  } else if (GST_IS_BUFFER (item)) {
+    ret = gst_pad_push (pad, GST_BUFFER_CAST (item));
+  } else if (GST_IS_BUFFER_LIST (item)) {
+    ret = gst_pad_push_list (pad, GST_BUFFER_LIST_CAST (item));
+  } else if (GST_IS_EVENT (item)) {
+    GstEvent *event = GST_EVENT_CAST (item);
+    gboolean is_eos = GST_EVENT_TYPE (event) == GST_EVENT_EOS;
+
+    gst_pad_push_event (pad, event);
+    if (is_eos)
+      ret = GST_FLOW_EOS;
+  }
+
+  if (ret != GST_FLOW_OK)
+    goto out_flow;
+
+  return;
+
+flushing:
+  {
+    GST_LOG_OBJECT (self, "pausing task, flushing");
+    gst_pad_pause_task (pad);
+    return;
+  }
+out_flow:
+  {
+    GST_LOG_OBJECT (self, "pausing task, reason %s", gst_flow_get_name (ret));
+    g_atomic_int_set (&self->srcresult, ret);
+    gst_pad_pause_task (pad);
+    /* wake up proxysink if it waits for space or a query */
+    gst_proxy_src_ring_wake_up (self);
+
+    if (ret == GST_FLOW_NOT_LINKED || ret < GST_FLOW_EOS) {
+      GST_ELEMENT_FLOW_ERROR (self, ret);
+      gst_pad_push_event (pad, gst_event_new_eos ());
+    }
+    return;
+  }
+}
+
+static gboolean
+gst_proxy_src_ring_start (GstProxySrc * self)
+{
+  return gst_pad_start_task (self->ring_srcpad,
+      (GstTaskFunction) gst_proxy_src_ring_loop, self->ring_srcpad, NULL);
+}
+
+static gboolean
+gst_proxy_src_ring_src_activate_mode (GstPad * pad, GstObject * parent,
+    GstPadMode mode, gboolean active)
+{
+  GstProxySrc *self = GST_PROXY_SRC (parent);
+  gboolean res;
+
+  if (mode != GST_PAD_MODE_PUSH)
+    return FALSE;
+
+  if (active) {
+    gst_proxy_src_ring_set_flushing (self, FALSE);
+    res = gst_proxy_src_ring_start (self);
+  } else {
+    gst_proxy_src_ring_set_flushing (self, TRUE);
+    res = gst_pad_stop_task (pad);
+    gst_proxy_src_ring_clear (self);
+  }
+
+  return res;
+}
+
+/* Keeps track of the buffer duration to know how much time the ring can
+ * hold for latency queries */
+static void
+gst_proxy_src_ring_track_duration (GstProxySrc * self, GstBuffer * buffer)
+{
+  GstClockTime pts = GST_BUFFER_PTS (buffer);
+  GstClockTime duration = GST_BUFFER_DURATION (buffer);
+  gint avg;
+
+  if (!GST_CLOCK_TIME_IS_VALID (duration) && GST_CLOCK_TIME_IS_VALID (pts) &&
+      GST_CLOCK_TIME_IS_VALID (self->last_pts) && pts > self->last_pts)
+    duration = pts - self->last_pts;
+  self->last_pts = pts;
+
+  if (!GST_CLOCK_TIME_IS_VALID (duration))
+    return;
+
+  duration = MIN (GST_TIME_AS_USECONDS (duration), G_MAXINT / 8);
+  avg = g_atomic_int_get (&self->avg_duration_us);
+  if (avg == 0)
+    avg = duration;
+  else
+    avg = (7 * avg + (gint) duration) / 8;
+  g_atomic_int_set (&self->avg_duration_us, MAX (avg, 1));
+}
+
+static GstFlowReturn
+gst_proxy_src_ring_sink_chain (GstPad * pad, GstObject * parent,
+    GstBuffer * buffer)
+{
+  GstProxySrc *self = GST_PROXY_SRC (parent);
+  GstFlowReturn ret;
+
+  ret = g_atomic_int_get (&self->srcresult);
+  if (ret != GST_FLOW_OK) {
+    gst_buffer_unref (buffer);
+    return ret;
+  }
+
+  gst_proxy_src_ring_track_duration (self, buffer);
+
+  return gst_proxy_src_ring_push (self, GST_MINI_OBJECT_CAST (buffer), TRUE);
+}
+
+static GstFlowReturn
+gst_proxy_src_ring_sink_chain_list (GstPad * pad, GstObject * parent,
+    GstBufferList * list)
+{
+  GstProxySrc *self = GST_PROXY_SRC (parent);
+  GstFlowReturn ret;
+
+  ret = g_atomic_int_get (&self->srcresult);
+  if (ret != GST_FLOW_OK) {
+    gst_buffer_list_unref (list);
+    return ret;
+  }
+
+  return gst_proxy_src_ring_push (self, GST_MINI_OBJECT_CAST (list), TRUE);
+}
+
+static gboolean
+gst_proxy_src_ring_sink_event (GstPad * pad, GstObject * parent,
+    GstEvent * event)
+{
+  GstProxySrc *self = GST_PROXY_SRC (parent);
+  gboolean ret;
+
+  switch (GST_EVENT_TYPE (event)) {
+    case GST_EVENT_FLUSH_START:
+      gst_proxy_src_ring_set_flushing (self, TRUE);
+      ret = gst_pad_push_event (self->ring_srcpad, event);
+      gst_pad_pause_task (self->ring_srcpad);
+      break;
+    case GST_EVENT_FLUSH_STOP:
+      gst_proxy_src_ring_clear (self);
+      self->last_pts = GST_CLOCK_TIME_NONE;
+      ret = gst_pad_push_event (self->ring_srcpad, event);
+      if (GST_PAD_MODE (self->ring_srcpad) == GST_PAD_MODE_PUSH) {
+        gst_proxy_src_ring_set_flushing (self, FALSE);
+        gst_proxy_src_ring_start (self);
+      }
+      break;
+    default:
+      if (GST_EVENT_IS_SERIALIZED (event)) {
+        ret = gst_proxy_src_ring_push (self, GST_MINI_OBJECT_CAST (event),
+            FALSE) == GST_FLOW_OK;
+      } else {
+        ret = gst_pad_push_event (self->ring_srcpad, event);
+      }
+      break;
+  }
+
+  return ret;
+}
+
+static gboolean
+gst_proxy_src_ring_sink_query (GstPad * pad, GstObject * parent,
+    GstQuery * query)
+{
+  GstProxySrc *self = GST_PROXY_SRC (parent);
+  gboolean res = FALSE;
+
+  if (!GST_QUERY_IS_SERIALIZED (query))
+    return gst_pad_peer_query (self->ring_srcpad, query);
+
+  /* serialized queries are answered by the task once everything before them
+   * was pushed. Only one can be pending as they all come from the upstream
+   * streaming thread. */
+  g_mutex_lock (&self->ring_lock);
+  self->pending_query = query;
+  self->query_in_progress = FALSE;
+  self->query_handled = FALSE;
+  g_mutex_unlock (&self->ring_lock);
+
+  gst_proxy_src_ring_push (self, RING_QUERY_MARKER, FALSE);
+
+  /* once the task started the query, it has to be waited for even when
+   * flushing, as the task still uses it */
+  g_mutex_lock (&self->ring_lock);
+  while (!self->query_handled && (self->query_in_progress ||
+          g_atomic_int_get (&self->srcresult) == GST_FLOW_OK))
+    g_cond_wait (&self->ring_cond, &self->ring_lock);
+  if (self->query_handled)
+    res = self->query_result;
+  /* a marker left in the ring now refers to nothing */
+  self->pending_query = NULL;
+  g_mutex_unlock (&self->ring_lock);
+
+  return res;
+}
+
+static gboolean
+gst_proxy_src_ring_src_event (GstPad * pad, GstObject * parent,
+    GstEvent * event)
+{
+  GstProxySrc *self = GST_PROXY_SRC (parent);
+
+  return gst_pad_push_event (self->ring_sinkpad, event);
+}
+
+static gboolean
+gst_proxy_src_ring_src_query (GstPad * pad, GstObject * parent,
+    GstQuery * query)
+{
+  GstProxySrc *self = GST_PROXY_SRC (parent);
+  gboolean res;
+
+  res = gst_pad_peer_query (self->ring_sinkpad, query);
+
+  if (res && GST_QUERY_TYPE (query) == GST_QUERY_LATENCY) {
+    GstClockTime min, max, buffered = GST_CLOCK_TIME_NONE;
+    gboolean live;
+    gint avg;
+
+    gst_query_parse_latency (query, &live, &min, &max);
+
+    /* the ring can delay buffers by as much time as it holds, like for queue
+     * this is only known once buffers with durations went through */
+    avg = g_atomic_int_get (&self->avg_duration_us);
+    if (avg > 0 && self->ring)
+      buffered = (GstClockTime) (self->ring_mask + 1) * avg * GST_USECOND;
+
+    if (GST_CLOCK_TIME_IS_VALID (buffered) && GST_CLOCK_TIME_IS_VALID (max) &&
+        self->leaky == GST_PROXY_SRC_LEAKY_NO)
+      max += buffered;
+    else if (GST_CLOCK_TIME_IS_VALID (buffered) &&
+        self->leaky != GST_PROXY_SRC_LEAKY_NO)
+      max = MIN (buffered, max);
+    else
+      max = GST_CLOCK_TIME_NONE;
+
+    GST_DEBUG_OBJECT (self, "ring holds %" GST_TIME_FORMAT ", latency min %"
+        GST_TIME_FORMAT " max %" GST_TIME_FORMAT, GST_TIME_ARGS (buffered),
+        GST_TIME_ARGS (min), GST_TIME_ARGS (max));
+    gst_query_set_latency (query, live, min, max);
+  }
+
+  return res;
+}
+
 static GstStateChangeReturn
 gst_proxy_src_change_state (GstElement * element, GstStateChange transition)
 {
@@ -261,6 +936,24 @@ gst_proxy_src_change_state (GstElement * element, GstStateChange transition)
   GstProxySrc *self = GST_PROXY_SRC (element);
   GstStateChangeReturn ret;
 
+  switch (transition) {
+    case GST_STATE_CHANGE_READY_TO_PAUSED:
+      gst_proxy_src_setup_mode (self);
+      if (self->mode == GST_PROXY_SRC_MODE_RING) {
+        guint size = 1 << g_bit_storage (self->ring_size - 1);
+
+        self->ring = g_new0 (GstMiniObject *, size);
+        self->ring_mask = size - 1;
+        self->ring_read = self->ring_write = 0;
+        self->avg_duration_us = 0;
+        self->last_pts = GST_CLOCK_TIME_NONE;
+        self->pending_query = NULL;
+      }
+      break;
+    default:
+      break;
+  }
+
   ret = gstelement_class->change_state (element, transition);
   if (ret == GST_STATE_CHANGE_FAILURE)
     return ret;
@@ -268,10 +961,22 @@ gst_proxy_src_change_state (GstElement * element, GstStateChange transition)
   switch (transition) {
     case GST_STATE_CHANGE_READY_TO_PAUSED:
       ret = GST_STATE_CHANGE_NO_PREROLL;
+      if (self->ring) {
+        gst_pad_set_active (self->ring_srcpad, TRUE);
+        gst_pad_set_active (self->ring_sinkpad, TRUE);
+      }
       gst_pad_set_active (self->internal_srcpad, TRUE);
       break;
     case GST_STATE_CHANGE_PAUSED_TO_READY:
       gst_pad_set_active (self->internal_srcpad, FALSE);
+      if (self->ring) {
+        /* wake up proxysink first, it might be waiting for space while
+         * holding the stream lock of ring_sinkpad */
+        gst_proxy_src_ring_set_flushing (self, TRUE);
+        gst_pad_set_active (self->ring_sinkpad, FALSE);
+        gst_pad_set_active (self->ring_srcpad, FALSE);
+        g_clear_pointer (&self->ring, g_free);
+      }
       break;
     default:
       break;
@@ -286,7 +991,7 @@ gst_proxy_src_send_event (GstElement * element, GstEvent * event)
   GstProxySrc *self = GST_PROXY_SRC (element);
 
   if (GST_EVENT_IS_DOWNSTREAM (event)) {
-    GstPad *sinkpad = gst_element_get_static_pad (self->queue, "sink");
+    GstPad *sinkpad = gst_pad_get_peer (self->internal_srcpad);
     gboolean ret;
 
     ret = gst_pad_send_event (sinkpad, event);
@@ -304,7 +1009,7 @@ gst_proxy_src_query (GstElement * element, GstQuery * query)
   GstProxySrc *self = GST_PROXY_SRC (element);
 
   if (GST_QUERY_IS_DOWNSTREAM (query)) {
-    GstPad *sinkpad = gst_element_get_static_pad (self->queue, "sink");
+    GstPad *sinkpad = gst_pad_get_peer (self->internal_srcpad);
     gboolean ret;
 
     ret = gst_pad_query (sinkpad, query);
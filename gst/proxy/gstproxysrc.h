@@ -33,6 +33,33 @@ G_BEGIN_DECLS
 #define GST_IS_PROXY_SRC_CLASS(klass) (G_TYPE_CHECK_CLASS_TYPE((klass) , GST_TYPE_PROXY_SRC))
 #define GST_PROXY_SRC_GET_CLASS(obj)  (G_TYPE_INSTANCE_GET_CLASS((obj) , GST_TYPE_PROXY_SRC, GstProxySrcClass))
 
+/**
+ * GstProxySrcMode:
+ * @GST_PROXY_SRC_MODE_QUEUE: buffers are decoupled through an internal queue
+ * @GST_PROXY_SRC_MODE_RING: buffers are handed over through a lock-free ring
+ *   that is read by the task of proxysrc
+ *
+ * Since: 1.18
+ */
+typedef enum {
+  GST_PROXY_SRC_MODE_QUEUE,
+  GST_PROXY_SRC_MODE_RING
+} GstProxySrcMode;
+
+/**
+ * GstProxySrcLeaky:
+ * @GST_PROXY_SRC_LEAKY_NO: block proxysink when full
+ * @GST_PROXY_SRC_LEAKY_UPSTREAM: drop new buffers when full
+ * @GST_PROXY_SRC_LEAKY_DOWNSTREAM: drop the oldest buffers when full
+ *
+ * Since: 1.18
+ */
+typedef enum {
+  GST_PROXY_SRC_LEAKY_NO,
+  GST_PROXY_SRC_LEAKY_UPSTREAM,
+  GST_PROXY_SRC_LEAKY_DOWNSTREAM
+} GstProxySrcLeaky;
+
 typedef struct _GstProxySrc GstProxySrc;
 typedef struct _GstProxySrcClass GstProxySrcClass;
 typedef struct _GstProxySrcPrivate GstProxySrcPrivate;
@@ -56,6 +83,44 @@ struct _GstProxySrc {
 
   /* The matching proxysink; queries and events are sent to its sinkpad */
   GWeakRef proxysink;
+
+  GstProxySrcMode mode;
+  GstProxySrcLeaky leaky;
+  guint ring_size;
+
+  /* Pads taking the place of the queue in ring mode, internal_srcpad is
+   * linked to ring_sinkpad and srcpad targets ring_srcpad */
+  GstPad *ring_sinkpad;
+  GstPad *ring_srcpad;
+
+  /* Single producer, single consumer ring of buffers, buffer lists, events
+   * and queries. The producer is the streaming thread of proxysink, the
+   * consumer is the task of ring_srcpad. Only the read index is ever changed
+   * by both sides, the producer advances it when leaking old items. */
+  GstMiniObject **ring;
+  guint ring_mask;
+  gint ring_read;
+  gint ring_write;
+
+  /* Only used for waking up the other side, the ring itself is lock-free */
+  GMutex ring_lock;
+  GCond ring_cond;
+  gint producer_waiting;
+  gint consumer_waiting;
+  gint flushing;
+  gint srcresult;
+
+  /* The serialized query waiting to be handled by the task, protected by
+   * ring_lock. The ring only holds a marker for it, so that a query given up
+   * by its caller on flushing is never touched again. */
+  GstQuery *pending_query;
+  gboolean query_in_progress;
+  gboolean query_handled;
+  gboolean query_result;
+
+  /* Average buffer duration for latency queries, in microseconds */
+  gint avg_duration_us;
+  GstClockTime last_pts;
 };
 
 struct _GstProxySrcClass {
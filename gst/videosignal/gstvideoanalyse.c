@@ -38,6 +38,21 @@
  *
  * * #gdouble`luma-variance`: the brightness variance of the frame.
  *
+ * When #GstVideoAnalyse:detect-frozen is %TRUE, the message also contains:
+ *
+ * * #gdouble`luma-difference`: the average absolute brightness difference
+ *   with the previous frame. Range: 0.0-1.0
+ *
+ * * #gboolean`frozen`: whether the frame was detected as a repeat of the
+ *   previous one.
+ *
+ * With a large number of streams, posting one message per frame can flood
+ * the bus. Setting #GstVideoAnalyse:meta to %TRUE attaches the same
+ * statistics, plus the optional luma histogram, to each buffer as a
+ * `GstVideoAnalyseMeta` instead, and #GstVideoAnalyse:message can then be
+ * disabled. #GstVideoAnalyse:subsample reduces the cost of the analysis by
+ * only looking at every Nth pixel of every Nth line.
+ *
  * ## Example launch line
  * |[
  * gst-launch-1.0 -m videotestsrc ! videoanalyse ! videoconvert ! ximagesink
@@ -52,8 +67,11 @@
 #include <gst/gst.h>
 #include <gst/video/video.h>
 #include <gst/video/gstvideofilter.h>
+#include <gst/video/gstvideoanalysemeta.h>
 #include "gstvideoanalyse.h"
 
+#include <string.h>
+
 GST_DEBUG_CATEGORY_STATIC (gst_video_analyse_debug_category);
 #define GST_CAT_DEFAULT gst_video_analyse_debug_category
 
@@ -66,16 +84,33 @@ static void gst_video_analyse_get_property (GObject * object,
     guint property_id, GValue * value, GParamSpec * pspec);
 static void gst_video_analyse_finalize (GObject * object);
 
+static gboolean gst_video_analyse_set_info (GstVideoFilter * filter,
+    GstCaps * incaps, GstVideoInfo * in_info, GstCaps * outcaps,
+    GstVideoInfo * out_info);
 static GstFlowReturn gst_video_analyse_transform_frame_ip (GstVideoFilter *
     filter, GstVideoFrame * frame);
 
 enum
 {
   PROP_0,
-  PROP_MESSAGE
+  PROP_MESSAGE,
+  PROP_META,
+  PROP_SUBSAMPLE,
+  PROP_HISTOGRAM,
+  PROP_DETECT_FROZEN,
+  PROP_FROZEN_THRESHOLD
 };
 
 #define DEFAULT_MESSAGE TRUE
+#define DEFAULT_META FALSE
+#define DEFAULT_SUBSAMPLE 1
+#define DEFAULT_HISTOGRAM FALSE
+#define DEFAULT_DETECT_FROZEN FALSE
+#define DEFAULT_FROZEN_THRESHOLD 0.0
+
+/* number of pixels summed in 32 bits before flushing to the 64 bits
+ * totals, so that the sum of squares can't overflow */
+#define SUM_CHUNK 8192
 
 #define VIDEO_CAPS \
     GST_VIDEO_CAPS_MAKE("{ I420, YV12, Y444, Y42B, Y41B }")
@@ -108,6 +143,7 @@ gst_video_analyse_class_init (GstVideoAnalyseClass * klass)
   gobject_class->set_property = gst_video_analyse_set_property;
   gobject_class->get_property = gst_video_analyse_get_property;
   gobject_class->finalize = gst_video_analyse_finalize;
+  video_filter_class->set_info = GST_DEBUG_FUNCPTR (gst_video_analyse_set_info);
   video_filter_class->transform_frame_ip =
       GST_DEBUG_FUNCPTR (gst_video_analyse_transform_frame_ip);
 
@@ -116,12 +152,40 @@ gst_video_analyse_class_init (GstVideoAnalyseClass * klass)
           "Post statics messages",
           DEFAULT_MESSAGE,
           G_PARAM_READWRITE | G_PARAM_CONSTRUCT | G_PARAM_STATIC_STRINGS));
-  //trans_class->passthrough_on_same_caps = TRUE;
+  g_object_class_install_property (G_OBJECT_CLASS (klass), PROP_META,
+      g_param_spec_boolean ("meta", "Meta",
+          "Attach the statistics to each buffer as a GstVideoAnalyseMeta",
+          DEFAULT_META, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+  g_object_class_install_property (G_OBJECT_CLASS (klass), PROP_SUBSAMPLE,
+      g_param_spec_uint ("subsample", "Subsample",
+          "Only analyse every Nth pixel of every Nth line", 1, G_MAXINT,
+          DEFAULT_SUBSAMPLE, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+  g_object_class_install_property (G_OBJECT_CLASS (klass), PROP_HISTOGRAM,
+      g_param_spec_boolean ("histogram", "Histogram",
+          "Compute the luma histogram of each frame (only available in the "
+          "meta)", DEFAULT_HISTOGRAM,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+  g_object_class_install_property (G_OBJECT_CLASS (klass), PROP_DETECT_FROZEN,
+      g_param_spec_boolean ("detect-frozen", "Detect Frozen",
+          "Compare each frame with the previous one to detect frozen video",
+          DEFAULT_DETECT_FROZEN, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+  g_object_class_install_property (G_OBJECT_CLASS (klass),
+      PROP_FROZEN_THRESHOLD, g_param_spec_double ("frozen-threshold",
+          "Frozen Threshold",
+          "Maximum average luma difference with the previous frame for a "
+          "frame to be considered frozen", 0.0, 1.0, DEFAULT_FROZEN_THRESHOLD,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 }
 
 static void
 gst_video_analyse_init (GstVideoAnalyse * videoanalyse)
 {
+  videoanalyse->meta = DEFAULT_META;
+  videoanalyse->subsample = DEFAULT_SUBSAMPLE;
+  videoanalyse->histogram = DEFAULT_HISTOGRAM;
+  videoanalyse->detect_frozen = DEFAULT_DETECT_FROZEN;
+  videoanalyse->frozen_threshold = DEFAULT_FROZEN_THRESHOLD;
+  videoanalyse->luma_difference = -1.0;
 }
 
 void
@@ -136,6 +200,31 @@ gst_video_analyse_set_property (GObject * object, guint property_id,
     case PROP_MESSAGE:
       videoanalyse->message = g_value_get_boolean (value);
       break;
+    case PROP_META:
+      GST_OBJECT_LOCK (videoanalyse);
+      videoanalyse->meta = g_value_get_boolean (value);
+      GST_OBJECT_UNLOCK (videoanalyse);
+      break;
+    case PROP_SUBSAMPLE:
+      GST_OBJECT_LOCK (videoanalyse);
+      videoanalyse->subsample = g_value_get_uint (value);
+      GST_OBJECT_UNLOCK (videoanalyse);
+      break;
+    case PROP_HISTOGRAM:
+      GST_OBJECT_LOCK (videoanalyse);
+      videoanalyse->histogram = g_value_get_boolean (value);
+      GST_OBJECT_UNLOCK (videoanalyse);
+      break;
+    case PROP_DETECT_FROZEN:
+      GST_OBJECT_LOCK (videoanalyse);
+      videoanalyse->detect_frozen = g_value_get_boolean (value);
+      GST_OBJECT_UNLOCK (videoanalyse);
+      break;
+    case PROP_FROZEN_THRESHOLD:
+      GST_OBJECT_LOCK (videoanalyse);
+      videoanalyse->frozen_threshold = g_value_get_double (value);
+      GST_OBJECT_UNLOCK (videoanalyse);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
       break;
@@ -154,6 +243,31 @@ gst_video_analyse_get_property (GObject * object, guint property_id,
     case PROP_MESSAGE:
       g_value_set_boolean (value, videoanalyse->message);
       break;
+    case PROP_META:
+      GST_OBJECT_LOCK (videoanalyse);
+      g_value_set_boolean (value, videoanalyse->meta);
+      GST_OBJECT_UNLOCK (videoanalyse);
+      break;
+    case PROP_SUBSAMPLE:
+      GST_OBJECT_LOCK (videoanalyse);
+      g_value_set_uint (value, videoanalyse->subsample);
+      GST_OBJECT_UNLOCK (videoanalyse);
+      break;
+    case PROP_HISTOGRAM:
+      GST_OBJECT_LOCK (videoanalyse);
+      g_value_set_boolean (value, videoanalyse->histogram);
+      GST_OBJECT_UNLOCK (videoanalyse);
+      break;
+    case PROP_DETECT_FROZEN:
+      GST_OBJECT_LOCK (videoanalyse);
+      g_value_set_boolean (value, videoanalyse->detect_frozen);
+      GST_OBJECT_UNLOCK (videoanalyse);
+      break;
+    case PROP_FROZEN_THRESHOLD:
+      GST_OBJECT_LOCK (videoanalyse);
+      g_value_set_double (value, videoanalyse->frozen_threshold);
+      GST_OBJECT_UNLOCK (videoanalyse);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
       break;
@@ -167,16 +281,30 @@ gst_video_analyse_finalize (GObject * object)
 
   GST_DEBUG_OBJECT (videoanalyse, "finalize");
 
-  /* clean up object here */
+  g_free (videoanalyse->prev_luma);
+  videoanalyse->prev_luma = NULL;
 
   G_OBJECT_CLASS (gst_video_analyse_parent_class)->finalize (object);
 }
 
+static gboolean
+gst_video_analyse_set_info (GstVideoFilter * filter, GstCaps * incaps,
+    GstVideoInfo * in_info, GstCaps * outcaps, GstVideoInfo * out_info)
+{
+  GstVideoAnalyse *videoanalyse = GST_VIDEO_ANALYSE (filter);
+
+  /* don't compare frames across a format change */
+  videoanalyse->have_prev_luma = FALSE;
+
+  return TRUE;
+}
+
 static void
 gst_video_analyse_post_message (GstVideoAnalyse * videoanalyse,
-    GstVideoFrame * frame)
+    GstVideoFrame * frame, gboolean detect_frozen)
 {
   GstBaseTransform *trans;
+  GstStructure *s;
   GstMessage *m;
   guint64 duration, timestamp, running_time, stream_time;
 
@@ -190,54 +318,207 @@ gst_video_analyse_post_message (GstVideoAnalyse * videoanalyse,
   stream_time = gst_segment_to_stream_time (&trans->segment, GST_FORMAT_TIME,
       timestamp);
 
-  m = gst_message_new_element (GST_OBJECT_CAST (videoanalyse),
-      gst_structure_new ("GstVideoAnalyse",
-          "timestamp", G_TYPE_UINT64, timestamp,
-          "stream-time", G_TYPE_UINT64, stream_time,
-          "running-time", G_TYPE_UINT64, running_time,
-          "duration", G_TYPE_UINT64, duration,
-          "luma-average", G_TYPE_DOUBLE, videoanalyse->luma_average,
-          "luma-variance", G_TYPE_DOUBLE, videoanalyse->luma_variance, NULL));
+  s = gst_structure_new ("GstVideoAnalyse",
+      "timestamp", G_TYPE_UINT64, timestamp,
+      "stream-time", G_TYPE_UINT64, stream_time,
+      "running-time", G_TYPE_UINT64, running_time,
+      "duration", G_TYPE_UINT64, duration,
+      "luma-average", G_TYPE_DOUBLE, videoanalyse->luma_average,
+      "luma-variance", G_TYPE_DOUBLE, videoanalyse->luma_variance, NULL);
+  if (detect_frozen)
+    gst_structure_set (s,
+        "luma-difference", G_TYPE_DOUBLE, videoanalyse->luma_difference,
+        "frozen", G_TYPE_BOOLEAN, videoanalyse->frozen, NULL);
+
+  m = gst_message_new_element (GST_OBJECT_CAST (videoanalyse), s);
 
   gst_element_post_message (GST_ELEMENT_CAST (videoanalyse), m);
 }
 
 static void
-gst_video_analyse_planar (GstVideoAnalyse * videoanalyse, GstVideoFrame * frame)
+gst_video_analyse_attach_meta (GstVideoAnalyse * videoanalyse,
+    GstVideoFrame * frame, gboolean histogram)
+{
+  GstVideoAnalyseMeta *meta;
+
+  if (!gst_buffer_is_writable (frame->buffer)) {
+    GST_WARNING_OBJECT (videoanalyse, "buffer not writable, no meta attached");
+    return;
+  }
+
+  meta = gst_buffer_add_video_analyse_meta (frame->buffer);
+  meta->luma_average = videoanalyse->luma_average;
+  meta->luma_variance = videoanalyse->luma_variance;
+  meta->luma_difference = videoanalyse->luma_difference;
+  meta->frozen = videoanalyse->frozen;
+  if (histogram) {
+    meta->has_histogram = TRUE;
+    memcpy (meta->histogram, videoanalyse->luma_histogram,
+        sizeof (meta->histogram));
+  }
+}
+
+/* Sums and squares of a run of contiguous pixels. The inner loop only
+ * uses 32 bits accumulators and no data dependent branches so that the
+ * compiler can vectorize it */
+static inline void
+gst_video_analyse_sum_line (const guint8 * d, gint width, guint64 * sum,
+    guint64 * sumsq)
 {
-  guint64 sum;
-  gint avg, diff;
-  gint i, j;
-  guint8 *d;
+  gint j, k, n;
+
+  for (k = 0; k < width; k += SUM_CHUNK) {
+    guint32 s = 0, sq = 0;
+
+    n = MIN (width - k, SUM_CHUNK);
+    for (j = 0; j < n; j++) {
+      guint32 v = d[k + j];
+
+      s += v;
+      sq += v * v;
+    }
+    *sum += s;
+    *sumsq += sq;
+  }
+}
+
+/* Absolute difference with the previous frame's line, which is replaced
+ * by the current one */
+static inline guint64
+gst_video_analyse_diff_line (const guint8 * d, guint8 * prev, gint width,
+    gboolean have_prev)
+{
+  guint64 diff = 0;
+  gint j, k, n;
+
+  if (have_prev) {
+    for (k = 0; k < width; k += SUM_CHUNK) {
+      guint32 s = 0;
+
+      n = MIN (width - k, SUM_CHUNK);
+      for (j = 0; j < n; j++) {
+        gint v = (gint) d[k + j] - (gint) prev[k + j];
+
+        s += ABS (v);
+      }
+      diff += s;
+    }
+  }
+  memcpy (prev, d, width);
+
+  return diff;
+}
+
+static void
+gst_video_analyse_planar (GstVideoAnalyse * videoanalyse, GstVideoFrame * frame,
+    guint subsample, gboolean histogram, gboolean detect_frozen,
+    gdouble frozen_threshold)
+{
+  guint64 sum, sumsq, diff, n, var;
+  guint64 avg;
+  gint i, j, k;
+  const guint8 *d;
+  guint8 *prev = NULL;
   gint width = frame->info.width;
   gint height = frame->info.height;
   gint stride;
+  gint cols, rows;
+  gboolean have_prev = FALSE;
+  /* spread histogram updates over 4 tables so that runs of identical
+   * pixels don't serialize on the same counter */
+  guint32 hist[4][256];
+
+  cols = (width + subsample - 1) / subsample;
+  rows = (height + subsample - 1) / subsample;
+  n = (guint64) cols * rows;
+
+  if (detect_frozen) {
+    if (videoanalyse->prev_luma_size != n) {
+      g_free (videoanalyse->prev_luma);
+      videoanalyse->prev_luma = g_malloc (n);
+      videoanalyse->prev_luma_size = n;
+      videoanalyse->have_prev_luma = FALSE;
+    }
+    prev = videoanalyse->prev_luma;
+    have_prev = videoanalyse->have_prev_luma;
+  } else {
+    videoanalyse->have_prev_luma = FALSE;
+  }
+
+  if (histogram)
+    memset (hist, 0, sizeof (hist));
 
   d = frame->data[0];
   stride = frame->info.stride[0];
-  sum = 0;
-  /* do brightness as average of pixel brightness in 0.0 to 1.0 */
-  for (i = 0; i < height; i++) {
-    for (j = 0; j < width; j++) {
-      sum += d[j];
+  sum = sumsq = diff = 0;
+  /* collect everything in a single pass over the frame */
+  for (i = 0; i < height; i += subsample) {
+    if (subsample == 1) {
+      gst_video_analyse_sum_line (d, width, &sum, &sumsq);
+
+      if (prev)
+        diff += gst_video_analyse_diff_line (d, prev, width, have_prev);
+
+      if (histogram) {
+        for (j = 0; j + 3 < width; j += 4) {
+          hist[0][d[j]]++;
+          hist[1][d[j + 1]]++;
+          hist[2][d[j + 2]]++;
+          hist[3][d[j + 3]]++;
+        }
+        for (; j < width; j++)
+          hist[0][d[j]]++;
+      }
+    } else {
+      for (j = 0, k = 0; j < width; j += subsample, k++) {
+        guint v = d[j];
+
+        sum += v;
+        sumsq += v * v;
+        if (histogram)
+          hist[k & 3][v]++;
+        if (prev) {
+          if (have_prev) {
+            gint dv = (gint) v - (gint) prev[k];
+            diff += ABS (dv);
+          }
+          prev[k] = v;
+        }
+      }
     }
-    d += stride;
+    if (prev)
+      prev += cols;
+    d += stride * subsample;
   }
-  avg = sum / (width * height);
-  videoanalyse->luma_average = sum / (255.0 * width * height);
 
-  d = frame->data[0];
-  stride = frame->info.stride[0];
-  sum = 0;
-  /* do variance */
-  for (i = 0; i < height; i++) {
-    for (j = 0; j < width; j++) {
-      diff = (avg - d[j]);
-      sum += diff * diff;
+  /* do brightness as average of pixel brightness in 0.0 to 1.0 */
+  avg = sum / n;
+  videoanalyse->luma_average = sum / (255.0 * n);
+
+  /* do variance around the integer average, as sum((avg - d)^2) expanded */
+  var = sumsq + n * avg * avg - 2 * avg * sum;
+  videoanalyse->luma_variance = var / (255.0 * 255.0 * n);
+
+  if (detect_frozen) {
+    if (have_prev) {
+      videoanalyse->luma_difference = diff / (255.0 * n);
+      videoanalyse->frozen =
+          videoanalyse->luma_difference <= frozen_threshold;
+    } else {
+      videoanalyse->luma_difference = -1.0;
+      videoanalyse->frozen = FALSE;
     }
-    d += stride;
+    videoanalyse->have_prev_luma = TRUE;
+  } else {
+    videoanalyse->luma_difference = -1.0;
+    videoanalyse->frozen = FALSE;
+  }
+
+  if (histogram) {
+    for (j = 0; j < 256; j++)
+      videoanalyse->luma_histogram[j] =
+          hist[0][j] + hist[1][j] + hist[2][j] + hist[3][j];
   }
-  videoanalyse->luma_variance = sum / (255.0 * 255.0 * width * height);
 }
 
 static GstFlowReturn
@@ -246,12 +527,28 @@ gst_video_analyse_transform_frame_ip (GstVideoFilter * filter,
 {
   GstVideoAnalyse *videoanalyse = GST_VIDEO_ANALYSE (filter);
 
+  guint subsample;
+  gboolean meta, histogram, detect_frozen;
+  gdouble frozen_threshold;
+
   GST_DEBUG_OBJECT (videoanalyse, "transform_frame_ip");
 
-  gst_video_analyse_planar (videoanalyse, frame);
+  GST_OBJECT_LOCK (videoanalyse);
+  meta = videoanalyse->meta;
+  subsample = videoanalyse->subsample;
+  histogram = videoanalyse->histogram && meta;
+  detect_frozen = videoanalyse->detect_frozen;
+  frozen_threshold = videoanalyse->frozen_threshold;
+  GST_OBJECT_UNLOCK (videoanalyse);
+
+  gst_video_analyse_planar (videoanalyse, frame, subsample, histogram,
+      detect_frozen, frozen_threshold);
+
+  if (meta)
+    gst_video_analyse_attach_meta (videoanalyse, frame, histogram);
 
   if (videoanalyse->message)
-    gst_video_analyse_post_message (videoanalyse, frame);
+    gst_video_analyse_post_message (videoanalyse, frame, detect_frozen);
 
   return GST_FLOW_OK;
 }
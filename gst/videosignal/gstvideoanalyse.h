@@ -40,9 +40,23 @@ struct _GstVideoAnalyse
 
   /* properties */
   gboolean message;
+  gboolean meta;
+  guint subsample;
+  gboolean histogram;
+  gboolean detect_frozen;
+  gdouble frozen_threshold;
+
   guint64 interval;
   gdouble luma_average;
   gdouble luma_variance;
+  gdouble luma_difference;
+  gboolean frozen;
+  guint32 luma_histogram[256];
+
+  /* analysed luma samples of the previous frame, for frozen detection */
+  guint8 *prev_luma;
+  gsize prev_luma_size;
+  gboolean have_prev_luma;
 };
 
 struct _GstVideoAnalyseClass
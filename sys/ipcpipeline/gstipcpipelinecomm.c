@@ -24,11 +24,22 @@
 #  include "config.h"
 #endif
 
+/* for memfd_create() */
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
 #include <unistd.h>
 #include <errno.h>
+#include <fcntl.h>
 #include <string.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/mman.h>
 #include <gst/base/gstbytewriter.h>
 #include <gst/gstprotection.h>
+#include <gst/allocators/allocators.h>
 #include "gstipcpipelinecomm.h"
 
 GST_DEBUG_CATEGORY_STATIC (gst_ipc_pipeline_comm_debug);
@@ -36,6 +47,9 @@ GST_DEBUG_CATEGORY_STATIC (gst_ipc_pipeline_comm_debug);
 
 #define DEFAULT_ACK_TIME (10 * G_TIME_SPAN_SECOND)
 
+/* SCM_RIGHTS never carries more than one fd per chunk, leave some margin */
+#define MAX_RECEIVED_FDS 4
+
 GQuark QUARK_ID;
 
 typedef enum
@@ -45,6 +59,12 @@ typedef enum
   ACK_TYPE_BLOCKING
 } AckType;
 
+typedef enum
+{
+  COMM_MEMORY_TYPE_FD,
+  COMM_MEMORY_TYPE_DMABUF
+} CommMemoryType;
+
 typedef enum
 {
   COMM_REQUEST_TYPE_BUFFER,
@@ -63,6 +83,10 @@ typedef struct
   GstQuery *query;
   CommRequestType type;
   GCond cond;
+  /* nobody waits for the reply of an async request, it only frees a slot
+   * in the window */
+  gboolean async;
+  guint32 epoch;
 } CommRequest;
 
 static const gchar *comm_request_ret_get_name (CommRequestType type,
@@ -82,6 +106,8 @@ comm_request_new (guint32 id, CommRequestType type, GstQuery * query)
   req->query = query;
   req->ret = comm_request_ret_get_failure_value (type);
   req->type = type;
+  req->async = FALSE;
+  req->epoch = 0;
 
   return req;
 }
@@ -186,6 +212,8 @@ gst_ipc_pipeline_comm_data_type_get_name (GstIpcPipelineCommDataType type)
       return "MESSAGE";
     case GST_IPC_PIPELINE_COMM_DATA_TYPE_GERROR_MESSAGE:
       return "GERROR_MESSAGE";
+    case GST_IPC_PIPELINE_COMM_DATA_TYPE_FD_BUFFER:
+      return "FD_BUFFER";
     default:
       return "UNKNOWN";
   }
@@ -212,6 +240,72 @@ gst_ipc_pipeline_comm_sync_fd (GstIpcPipelineComm * comm, guint32 id,
   return !comm_error;
 }
 
+/* Waits until a new request fits in the window of requests waiting for
+ * their ack. Returns GST_FLOW_FLUSHING when flushing, the result of an
+ * earlier buffer that failed, or GST_FLOW_COMM_ERROR when no ack arrived
+ * within the ack time, like for synchronous requests. */
+static GstFlowReturn
+comm_window_wait (GstIpcPipelineComm * comm)
+{
+  guint64 end_time = g_get_monotonic_time () + comm->ack_time;
+
+  while (comm->n_in_flight >= comm->max_in_flight && !comm->window_flushing
+      && comm->window_flow_ret == GST_FLOW_OK) {
+    GST_TRACE_OBJECT (comm->element, "Window full (%u in flight), waiting",
+        comm->n_in_flight);
+    if (!g_cond_wait_until (&comm->window_cond, &comm->mutex, end_time)) {
+      GST_ERROR_OBJECT (comm->element, "Timeout waiting for the ack of any "
+          "of the %u requests in flight", comm->n_in_flight);
+      /* the peer is not answering, fail until the next flush */
+      comm->window_flow_ret = GST_FLOW_COMM_ERROR;
+    }
+  }
+
+  if (comm->window_flushing)
+    return GST_FLOW_FLUSHING;
+
+  return comm->window_flow_ret;
+}
+
+static void
+comm_window_add (GstIpcPipelineComm * comm, guint32 id, CommRequestType type)
+{
+  CommRequest *req;
+
+  req = comm_request_new (id, type, NULL);
+  req->async = TRUE;
+  req->epoch = comm->window_epoch;
+  g_hash_table_insert (comm->waiting_ids, GINT_TO_POINTER (id), req);
+  comm->n_in_flight++;
+}
+
+/* Called when the ack of an async request arrived or was cancelled. Replies
+ * to requests sent before the last flush are only counted, as their result
+ * does not concern the data that is flowing now. */
+static void
+comm_window_complete (GstIpcPipelineComm * comm, CommRequest * req,
+    guint32 ret)
+{
+  g_assert (comm->n_in_flight > 0);
+  comm->n_in_flight--;
+
+  if (req->epoch == comm->window_epoch) {
+    if (req->type == COMM_REQUEST_TYPE_BUFFER) {
+      if (ret != GST_FLOW_OK && comm->window_flow_ret == GST_FLOW_OK) {
+        GST_DEBUG_OBJECT (comm->element, "Buffer %u returned %s, will be "
+            "returned for the next buffer", req->id,
+            gst_flow_get_name ((GstFlowReturn) ret));
+        comm->window_flow_ret = ret;
+      }
+    } else if (!ret) {
+      GST_WARNING_OBJECT (comm->element, "Peer failed to handle event %u",
+          req->id);
+    }
+  }
+
+  g_cond_broadcast (&comm->window_cond);
+}
+
 static gboolean
 write_to_fd_raw (GstIpcPipelineComm * comm, const void *data, size_t size)
 {
@@ -239,6 +333,53 @@ done:
   return ret;
 }
 
+/* Same as write_to_fd_raw, but also passes @fd to the other side. It is
+ * attached to the first byte, so the reader gets it at the latest together
+ * with the chunk referring to it. */
+static gboolean
+write_to_fd_raw_with_fd (GstIpcPipelineComm * comm, const void *data,
+    size_t size, int fd)
+{
+  struct msghdr msg;
+  struct iovec iov;
+  union
+  {
+    struct cmsghdr align;
+    char buf[CMSG_SPACE (sizeof (int))];
+  } control;
+  struct cmsghdr *cmsg;
+  ssize_t written;
+
+  memset (&msg, 0, sizeof (msg));
+  memset (&control, 0, sizeof (control));
+  iov.iov_base = (void *) data;
+  iov.iov_len = size;
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control.buf;
+  msg.msg_controllen = sizeof (control.buf);
+  cmsg = CMSG_FIRSTHDR (&msg);
+  cmsg->cmsg_level = SOL_SOCKET;
+  cmsg->cmsg_type = SCM_RIGHTS;
+  cmsg->cmsg_len = CMSG_LEN (sizeof (int));
+  memcpy (CMSG_DATA (cmsg), &fd, sizeof (int));
+
+  GST_TRACE_OBJECT (comm->element, "Writing %zu bytes and fd %d to fdout",
+      size, fd);
+  do {
+    written = sendmsg (comm->fdout, &msg, 0);
+  } while (written < 0 && (errno == EAGAIN || errno == EINTR));
+
+  if (written < 0) {
+    GST_ERROR_OBJECT (comm->element, "Failed to send fd: %s",
+        strerror (errno));
+    return FALSE;
+  }
+
+  return write_to_fd_raw (comm, (const unsigned char *) data + written,
+      size - written);
+}
+
 static gboolean
 write_byte_writer_to_fd (GstIpcPipelineComm * comm, GstByteWriter * bw)
 {
@@ -496,11 +637,93 @@ typedef struct
   guint64 flags;
 } CommBufferMetadata;
 
+/* Returns a file descriptor holding the contents of @buffer that can be
+ * passed to the other side, or -1 if the payload has to be sent inline.
+ * A buffer made of a single fd backed memory that does not belong to a pool
+ * is passed as is, otherwise the contents are copied to a new memfd which
+ * the caller has to close, as signalled by @owned. The memfd is sealed
+ * against size changes, so that the receiver can rely on its size.
+ * The memfd path still costs one copy per buffer, it only keeps large
+ * payloads out of the socket. A memfd cannot be reused for the next buffer
+ * as the receiver may keep its memory alive for as long as it wants. */
+static gint
+get_payload_fd (GstIpcPipelineComm * comm, GstBuffer * buffer,
+    guint8 * mem_type, guint64 * offset, gboolean * owned)
+{
+#ifdef HAVE_MEMFD_CREATE
+  gsize size;
+  gpointer data;
+  gint fd;
+#endif
+
+  if (comm->fdout != comm->fdout_checked) {
+    struct stat st;
+
+    comm->fdout_is_socket = fstat (comm->fdout, &st) == 0
+        && S_ISSOCK (st.st_mode);
+    comm->fdout_checked = comm->fdout;
+    if (!comm->fdout_is_socket)
+      GST_DEBUG_OBJECT (comm->element, "fdout is not a socket, sending "
+          "payloads inline");
+  }
+  if (!comm->fdout_is_socket)
+    return -1;
+
+  if (gst_buffer_n_memory (buffer) == 1 && buffer->pool == NULL) {
+    GstMemory *mem = gst_buffer_peek_memory (buffer, 0);
+
+    if (gst_is_fd_memory (mem)) {
+      *mem_type = gst_is_dmabuf_memory (mem) ? COMM_MEMORY_TYPE_DMABUF :
+          COMM_MEMORY_TYPE_FD;
+      *offset = mem->offset;
+      *owned = FALSE;
+      return gst_fd_memory_get_fd (mem);
+    }
+  }
+
+#ifdef HAVE_MEMFD_CREATE
+  size = gst_buffer_get_size (buffer);
+  if (size == 0)
+    return -1;
+
+  fd = memfd_create ("ipcpipeline", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+  if (fd < 0) {
+    GST_WARNING_OBJECT (comm->element, "Failed to create memfd: %s",
+        strerror (errno));
+    return -1;
+  }
+  if (ftruncate (fd, size) < 0)
+    goto copy_failed;
+  data = mmap (NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (data == MAP_FAILED)
+    goto copy_failed;
+  gst_buffer_extract (buffer, 0, data, size);
+  munmap (data, size);
+#ifdef F_ADD_SEALS
+  if (fcntl (fd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW) < 0)
+    goto copy_failed;
+#endif
+
+  *mem_type = COMM_MEMORY_TYPE_FD;
+  *offset = 0;
+  *owned = TRUE;
+  return fd;
+
+copy_failed:
+  GST_WARNING_OBJECT (comm->element, "Failed to fill memfd: %s",
+      strerror (errno));
+  close (fd);
+  return -1;
+#else
+  return -1;
+#endif
+}
+
 GstFlowReturn
 gst_ipc_pipeline_comm_write_buffer_to_fd (GstIpcPipelineComm * comm,
     GstBuffer * buffer)
 {
-  const unsigned char payload_type = GST_IPC_PIPELINE_COMM_DATA_TYPE_BUFFER;
+  unsigned char payload_type = GST_IPC_PIPELINE_COMM_DATA_TYPE_BUFFER;
   GstMapInfo map;
   guint32 ret32 = GST_FLOW_OK;
   guint32 size, n;
@@ -508,8 +731,21 @@ gst_ipc_pipeline_comm_write_buffer_to_fd (GstIpcPipelineComm * comm,
   GstFlowReturn ret;
   MetaListRepresentation repr = { comm, 0, 4, NULL };   /* starts a 4 for n_meta */
   GstByteWriter bw;
+  gint fd = -1;
+  gboolean fd_owned = FALSE;
+  guint8 mem_type = COMM_MEMORY_TYPE_FD;
+  guint64 fd_offset = 0;
 
   g_mutex_lock (&comm->mutex);
+
+  if (comm->max_in_flight > 1) {
+    ret = comm_window_wait (comm);
+    if (ret != GST_FLOW_OK) {
+      g_mutex_unlock (&comm->mutex);
+      return ret;
+    }
+  }
+
   ++comm->send_id;
 
   GST_TRACE_OBJECT (comm->element, "Writing buffer %u: %" GST_PTR_FORMAT,
@@ -527,13 +763,21 @@ gst_ipc_pipeline_comm_write_buffer_to_fd (GstIpcPipelineComm * comm,
   /* work out meta size */
   gst_buffer_foreach_meta (buffer, build_meta, &repr);
 
+  if (comm->fd_passing) {
+    fd = get_payload_fd (comm, buffer, &mem_type, &fd_offset, &fd_owned);
+    if (fd >= 0)
+      payload_type = GST_IPC_PIPELINE_COMM_DATA_TYPE_FD_BUFFER;
+  }
+
   if (!gst_byte_writer_put_uint8 (&bw, payload_type))
     goto write_failed;
   if (!gst_byte_writer_put_uint32_le (&bw, comm->send_id))
     goto write_failed;
-  size =
-      gst_buffer_get_size (buffer) + sizeof (guint32) +
-      sizeof (CommBufferMetadata) + repr.total_bytes;
+  size = sizeof (guint32) + sizeof (CommBufferMetadata) + repr.total_bytes;
+  if (fd >= 0)
+    size += 1 + sizeof (guint64);
+  else
+    size += gst_buffer_get_size (buffer);
   if (!gst_byte_writer_put_uint32_le (&bw, size))
     goto write_failed;
   if (!gst_byte_writer_put_data (&bw, (const guint8 *) &meta, sizeof (meta)))
@@ -541,15 +785,33 @@ gst_ipc_pipeline_comm_write_buffer_to_fd (GstIpcPipelineComm * comm,
   size = gst_buffer_get_size (buffer);
   if (!gst_byte_writer_put_uint32_le (&bw, size))
     goto write_failed;
-  if (!write_byte_writer_to_fd (comm, &bw))
-    goto write_failed;
 
-  if (!gst_buffer_map (buffer, &map, GST_MAP_READ))
-    goto map_failed;
-  ret = write_to_fd_raw (comm, map.data, map.size);
-  gst_buffer_unmap (buffer, &map);
-  if (!ret)
-    goto write_failed;
+  if (fd >= 0) {
+    guint8 *data;
+
+    /* only the location of the payload goes through the socket */
+    if (!gst_byte_writer_put_uint8 (&bw, mem_type))
+      goto write_failed;
+    if (!gst_byte_writer_put_uint64_le (&bw, fd_offset))
+      goto write_failed;
+
+    size = gst_byte_writer_get_size (&bw);
+    data = gst_byte_writer_reset_and_get_data (&bw);
+    ret = write_to_fd_raw_with_fd (comm, data, size, fd);
+    g_free (data);
+    if (!ret)
+      goto write_failed;
+  } else {
+    if (!write_byte_writer_to_fd (comm, &bw))
+      goto write_failed;
+
+    if (!gst_buffer_map (buffer, &map, GST_MAP_READ))
+      goto map_failed;
+    ret = write_to_fd_raw (comm, map.data, map.size);
+    gst_buffer_unmap (buffer, &map);
+    if (!ret)
+      goto write_failed;
+  }
 
   /* meta */
   gst_byte_writer_init (&bw);
@@ -588,13 +850,21 @@ gst_ipc_pipeline_comm_write_buffer_to_fd (GstIpcPipelineComm * comm,
   if (!write_byte_writer_to_fd (comm, &bw))
     goto write_failed;
 
-  if (!gst_ipc_pipeline_comm_sync_fd (comm, comm->send_id, NULL, &ret32,
-          ACK_TYPE_BLOCKING, COMM_REQUEST_TYPE_BUFFER))
-    goto wait_failed;
-  ret = ret32;
+  if (comm->max_in_flight > 1) {
+    /* errors will be returned for one of the next buffers */
+    comm_window_add (comm, comm->send_id, COMM_REQUEST_TYPE_BUFFER);
+    ret = GST_FLOW_OK;
+  } else {
+    if (!gst_ipc_pipeline_comm_sync_fd (comm, comm->send_id, NULL, &ret32,
+            ACK_TYPE_BLOCKING, COMM_REQUEST_TYPE_BUFFER))
+      goto wait_failed;
+    ret = ret32;
+  }
 
 done:
   g_mutex_unlock (&comm->mutex);
+  if (fd_owned)
+    close (fd);
   gst_byte_writer_reset (&bw);
   for (n = 0; n < repr.n_meta; ++n)
     g_free (repr.info[n].str);
@@ -620,8 +890,74 @@ map_failed:
   goto done;
 }
 
+static GstMemory *
+gst_ipc_pipeline_comm_read_fd_memory (GstIpcPipelineComm * comm,
+    guint32 buffer_data_size)
+{
+  GstMemory *mem;
+  const guint8 *payload;
+  guint8 mem_type;
+  guint64 offset;
+  off_t fd_size = -1;
+  struct stat st;
+  gint fd;
+
+  payload = gst_adapter_map (comm->adapter, 1 + sizeof (offset));
+  if (!payload)
+    return NULL;
+  mem_type = payload[0];
+  offset = GST_READ_UINT64_LE (payload + 1);
+  gst_adapter_unmap (comm->adapter);
+  gst_adapter_flush (comm->adapter, 1 + sizeof (offset));
+
+  if (g_queue_is_empty (&comm->received_fds)) {
+    GST_ERROR_OBJECT (comm->element, "Got fd buffer without an fd");
+    return NULL;
+  }
+  fd = GPOINTER_TO_INT (g_queue_pop_head (&comm->received_fds));
+
+  /* don't map beyond the end of what the peer sent, accessing it would
+   * crash. dmabufs report their size through lseek() only. */
+  if (mem_type == COMM_MEMORY_TYPE_DMABUF)
+    fd_size = lseek (fd, 0, SEEK_END);
+  else if (fstat (fd, &st) == 0)
+    fd_size = st.st_size;
+  if (fd_size < 0 || offset > (guint64) fd_size ||
+      buffer_data_size > (guint64) fd_size - offset) {
+    GST_ERROR_OBJECT (comm->element, "Payload of %u bytes at offset %"
+        G_GUINT64_FORMAT " does not fit in fd of %" G_GINT64_FORMAT " bytes",
+        buffer_data_size, offset, (gint64) fd_size);
+    close (fd);
+    return NULL;
+  }
+
+  if (mem_type == COMM_MEMORY_TYPE_DMABUF) {
+    if (!comm->dmabuf_allocator)
+      comm->dmabuf_allocator = gst_dmabuf_allocator_new ();
+    mem = gst_dmabuf_allocator_alloc (comm->dmabuf_allocator, fd,
+        offset + buffer_data_size);
+  } else {
+    if (!comm->fd_allocator)
+      comm->fd_allocator = gst_fd_allocator_new ();
+    mem = gst_fd_allocator_alloc (comm->fd_allocator, fd,
+        offset + buffer_data_size, GST_FD_MEMORY_FLAG_NONE);
+  }
+  if (!mem) {
+    close (fd);
+    return NULL;
+  }
+  gst_memory_resize (mem, offset, buffer_data_size);
+
+  /* the sender still owns the contents, writing to them would change what
+   * it sees as well */
+  GST_MINI_OBJECT_FLAG_SET (mem, GST_MEMORY_FLAG_READONLY);
+
+  return mem;
+}
+
 static GstBuffer *
-gst_ipc_pipeline_comm_read_buffer (GstIpcPipelineComm * comm, guint32 size)
+gst_ipc_pipeline_comm_read_buffer (GstIpcPipelineComm * comm, guint32 size,
+    gboolean has_fd)
 {
   GstBuffer *buffer;
   CommBufferMetadata meta;
@@ -644,13 +980,23 @@ gst_ipc_pipeline_comm_read_buffer (GstIpcPipelineComm * comm, guint32 size)
   gst_adapter_unmap (comm->adapter);
   gst_adapter_flush (comm->adapter, mapped_size);
 
-  if (buffer_data_size == 0) {
+  if (has_fd) {
+    GstMemory *mem;
+
+    mem = gst_ipc_pipeline_comm_read_fd_memory (comm, buffer_data_size);
+    if (!mem)
+      return NULL;
     buffer = gst_buffer_new ();
+    gst_buffer_append_memory (buffer, mem);
+    size -= 1 + sizeof (guint64);
+  } else if (buffer_data_size == 0) {
+    buffer = gst_buffer_new ();
+    size -= buffer_data_size;
   } else {
     buffer = gst_adapter_get_buffer (comm->adapter, buffer_data_size);
     gst_adapter_flush (comm->adapter, buffer_data_size);
+    size -= buffer_data_size;
   }
-  size -= buffer_data_size;
 
   GST_BUFFER_PTS (buffer) = meta.pts;
   GST_BUFFER_DTS (buffer) = meta.dts;
@@ -902,12 +1248,23 @@ gst_ipc_pipeline_comm_write_event_to_fd (GstIpcPipelineComm * comm,
   char *str = NULL;
   const GstStructure *structure;
   GstByteWriter bw;
+  gboolean windowed;
 
   /* we special case sink-message event as gst can't serialize/de-serialize it */
   if (GST_EVENT_TYPE (event) == GST_EVENT_SINK_MESSAGE)
     return gst_ipc_pipeline_comm_write_sink_message_event_to_fd (comm, event);
 
   g_mutex_lock (&comm->mutex);
+
+  /* serialized events are acked in order with the buffers around them, so
+   * they can share the window */
+  windowed = comm->max_in_flight > 1 && !upstream
+      && GST_EVENT_IS_SERIALIZED (event);
+  if (windowed && comm_window_wait (comm) == GST_FLOW_COMM_ERROR) {
+    g_mutex_unlock (&comm->mutex);
+    return FALSE;
+  }
+
   ++comm->send_id;
 
   GST_TRACE_OBJECT (comm->element, "Writing event %u: %" GST_PTR_FORMAT,
@@ -963,11 +1320,16 @@ gst_ipc_pipeline_comm_write_event_to_fd (GstIpcPipelineComm * comm,
 
   /* Upstream events get serialized, this is required to send seeks only
    * one at a time. */
-  if (!gst_ipc_pipeline_comm_sync_fd (comm, comm->send_id, NULL, &ret32,
-          (GST_EVENT_IS_SERIALIZED (event) || GST_EVENT_IS_UPSTREAM (event)) ?
-          ACK_TYPE_BLOCKING : ACK_TYPE_NONE, COMM_REQUEST_TYPE_EVENT))
-    goto write_failed;
-  ret = ret32;
+  if (windowed) {
+    comm_window_add (comm, comm->send_id, COMM_REQUEST_TYPE_EVENT);
+    ret = TRUE;
+  } else {
+    if (!gst_ipc_pipeline_comm_sync_fd (comm, comm->send_id, NULL, &ret32,
+            (GST_EVENT_IS_SERIALIZED (event) || GST_EVENT_IS_UPSTREAM (event)) ?
+            ACK_TYPE_BLOCKING : ACK_TYPE_NONE, COMM_REQUEST_TYPE_EVENT))
+      goto write_failed;
+    ret = ret32;
+  }
 
 done:
   g_mutex_unlock (&comm->mutex);
@@ -1600,21 +1962,37 @@ gst_ipc_pipeline_comm_init (GstIpcPipelineComm * comm, GstElement * element)
   g_mutex_init (&comm->mutex);
   comm->element = element;
   comm->fdin = comm->fdout = -1;
+  comm->fdout_checked = -1;
   comm->ack_time = DEFAULT_ACK_TIME;
+  comm->max_in_flight = 1;
+  comm->window_flow_ret = GST_FLOW_OK;
+  g_cond_init (&comm->window_cond);
   comm->waiting_ids =
       g_hash_table_new_full (g_direct_hash, g_direct_equal, NULL,
       (GDestroyNotify) comm_request_free);
   comm->adapter = gst_adapter_new ();
   comm->poll = gst_poll_new (TRUE);
   gst_poll_fd_init (&comm->pollFDin);
+  g_queue_init (&comm->received_fds);
 }
 
 void
 gst_ipc_pipeline_comm_clear (GstIpcPipelineComm * comm)
 {
+  gint fd;
+
+  while (!g_queue_is_empty (&comm->received_fds)) {
+    fd = GPOINTER_TO_INT (g_queue_pop_head (&comm->received_fds));
+    close (fd);
+  }
+  if (comm->fd_allocator)
+    gst_object_unref (comm->fd_allocator);
+  if (comm->dmabuf_allocator)
+    gst_object_unref (comm->dmabuf_allocator);
   g_hash_table_destroy (comm->waiting_ids);
   gst_object_unref (comm->adapter);
   gst_poll_free (comm->poll);
+  g_cond_clear (&comm->window_cond);
   g_mutex_clear (&comm->mutex);
 }
 
@@ -1633,20 +2011,29 @@ cancel_request (gpointer key, gpointer value, gpointer user_data,
   g_cond_signal (&req->cond);
 }
 
-static void
+static gboolean
 cancel_request_error (gpointer key, gpointer value, gpointer user_data)
 {
+  GstIpcPipelineComm *comm = (GstIpcPipelineComm *) user_data;
   CommRequest *req = (CommRequest *) value;
   GstFlowReturn fret = comm_request_ret_get_failure_value (req->type);
 
+  if (req->async) {
+    GST_TRACE_OBJECT (comm->element, "Cancelling async request %u, type %d",
+        req->id, req->type);
+    comm_window_complete (comm, req, fret);
+    return TRUE;
+  }
+
   cancel_request (key, value, user_data, fret);
+  return FALSE;
 }
 
 void
 gst_ipc_pipeline_comm_cancel (GstIpcPipelineComm * comm, gboolean cleanup)
 {
   g_mutex_lock (&comm->mutex);
-  g_hash_table_foreach (comm->waiting_ids, cancel_request_error, comm);
+  g_hash_table_foreach_remove (comm->waiting_ids, cancel_request_error, comm);
   if (cleanup) {
     g_hash_table_unref (comm->waiting_ids);
     comm->waiting_ids =
@@ -1656,6 +2043,23 @@ gst_ipc_pipeline_comm_cancel (GstIpcPipelineComm * comm, gboolean cleanup)
   g_mutex_unlock (&comm->mutex);
 }
 
+/* Makes buffers waiting for room in the window, and any later one, return
+ * FLUSHING. Leaving the flushing state forgets about errors returned for
+ * buffers sent before. */
+void
+gst_ipc_pipeline_comm_set_flushing (GstIpcPipelineComm * comm,
+    gboolean flushing)
+{
+  g_mutex_lock (&comm->mutex);
+  comm->window_flushing = flushing;
+  if (!flushing) {
+    comm->window_epoch++;
+    comm->window_flow_ret = GST_FLOW_OK;
+  }
+  g_cond_broadcast (&comm->window_cond);
+  g_mutex_unlock (&comm->mutex);
+}
+
 static gboolean
 set_field (GQuark field_id, const GValue * value, gpointer user_data)
 {
@@ -1680,6 +2084,13 @@ gst_ipc_pipeline_comm_reply_request (GstIpcPipelineComm * comm, guint32 id,
 
   GST_TRACE_OBJECT (comm->element, "Got reply %d (%s) for request %u", ret,
       comm_request_ret_get_name (req->type, ret), req->id);
+
+  if (req->async) {
+    comm_window_complete (comm, req, ret);
+    g_hash_table_remove (comm->waiting_ids, GINT_TO_POINTER (id));
+    return TRUE;
+  }
+
   req->replied = TRUE;
   req->ret = ret;
   if (query) {
@@ -1699,6 +2110,62 @@ gst_ipc_pipeline_comm_reply_request (GstIpcPipelineComm * comm, guint32 id,
   return TRUE;
 }
 
+/* Reads from fdin, collecting the file descriptors passed along with the
+ * data if it is a socket */
+static ssize_t
+read_from_fd (GstIpcPipelineComm * comm, void *data, size_t size)
+{
+  struct msghdr msg;
+  struct iovec iov;
+  union
+  {
+    struct cmsghdr align;
+    char buf[CMSG_SPACE (sizeof (int) * MAX_RECEIVED_FDS)];
+  } control;
+  struct cmsghdr *cmsg;
+  ssize_t sz;
+  gint flags = 0;
+
+  if (!comm->fdin_is_socket)
+    return read (comm->pollFDin.fd, data, size);
+
+  memset (&msg, 0, sizeof (msg));
+  iov.iov_base = data;
+  iov.iov_len = size;
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control.buf;
+  msg.msg_controllen = sizeof (control.buf);
+#ifdef MSG_CMSG_CLOEXEC
+  flags |= MSG_CMSG_CLOEXEC;
+#endif
+
+  sz = recvmsg (comm->pollFDin.fd, &msg, flags);
+  if (sz <= 0)
+    return sz;
+
+  if (msg.msg_flags & MSG_CTRUNC)
+    GST_WARNING_OBJECT (comm->element, "Some passed fds were dropped");
+
+  for (cmsg = CMSG_FIRSTHDR (&msg); cmsg; cmsg = CMSG_NXTHDR (&msg, cmsg)) {
+    guint i, n;
+
+    if (cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS)
+      continue;
+
+    n = (cmsg->cmsg_len - CMSG_LEN (0)) / sizeof (int);
+    for (i = 0; i < n; i++) {
+      gint fd;
+
+      memcpy (&fd, CMSG_DATA (cmsg) + i * sizeof (int), sizeof (int));
+      GST_TRACE_OBJECT (comm->element, "Received fd %d", fd);
+      g_queue_push_tail (&comm->received_fds, GINT_TO_POINTER (fd));
+    }
+  }
+
+  return sz;
+}
+
 static gint
 update_adapter (GstIpcPipelineComm * comm)
 {
@@ -1722,7 +2189,11 @@ again:
       gst_poll_fd_init (&comm->pollFDin);
     }
     if (comm->fdin != -1 && GST_OBJECT_PARENT (comm->element)) {
+      struct stat st;
+
       GST_DEBUG_OBJECT (comm->element, "Start watching fd %d", comm->fdin);
+      comm->fdin_is_socket = fstat (comm->fdin, &st) == 0
+          && S_ISSOCK (st.st_mode);
       comm->pollFDin.fd = comm->fdin;
       gst_poll_add_fd (comm->poll, &comm->pollFDin);
       gst_poll_fd_ctl_read (comm->poll, &comm->pollFDin, TRUE);
@@ -1745,7 +2216,7 @@ again:
       mem = gst_allocator_alloc (NULL, comm->read_chunk_size, NULL);
 
     gst_memory_map (mem, &map, GST_MAP_WRITE);
-    sz = read (comm->pollFDin.fd, map.data, map.size);
+    sz = read_from_fd (comm, map.data, map.size);
     gst_memory_unmap (mem, &map);
 
     if (sz <= 0) {
@@ -1810,6 +2281,7 @@ read_many (GstIpcPipelineComm * comm)
           case GST_IPC_PIPELINE_COMM_DATA_TYPE_STATE_LOST:
           case GST_IPC_PIPELINE_COMM_DATA_TYPE_MESSAGE:
           case GST_IPC_PIPELINE_COMM_DATA_TYPE_GERROR_MESSAGE:
+          case GST_IPC_PIPELINE_COMM_DATA_TYPE_FD_BUFFER:
             GST_TRACE_OBJECT (comm->element, "switching to state %s",
                 gst_ipc_pipeline_comm_data_type_get_name (type));
             comm->state = type;
@@ -1874,6 +2346,7 @@ read_many (GstIpcPipelineComm * comm)
         break;
       }
       case GST_IPC_PIPELINE_COMM_DATA_TYPE_BUFFER:
+      case GST_IPC_PIPELINE_COMM_DATA_TYPE_FD_BUFFER:
       {
         GstBuffer *buf;
 
@@ -1881,7 +2354,8 @@ read_many (GstIpcPipelineComm * comm)
         if (available < comm->payload_length)
           goto done;
 
-        buf = gst_ipc_pipeline_comm_read_buffer (comm, comm->payload_length);
+        buf = gst_ipc_pipeline_comm_read_buffer (comm, comm->payload_length,
+            comm->state == GST_IPC_PIPELINE_COMM_DATA_TYPE_FD_BUFFER);
         if (!buf)
           goto buffer_failed;
 
@@ -51,6 +51,7 @@ typedef enum {
   GST_IPC_PIPELINE_COMM_DATA_TYPE_STATE_LOST,
   GST_IPC_PIPELINE_COMM_DATA_TYPE_MESSAGE,
   GST_IPC_PIPELINE_COMM_DATA_TYPE_GERROR_MESSAGE,
+  GST_IPC_PIPELINE_COMM_DATA_TYPE_FD_BUFFER,
 } GstIpcPipelineCommDataType;
 
 typedef struct
@@ -76,6 +77,25 @@ typedef struct
   guint read_chunk_size;
   GstClockTime ack_time;
 
+  /* send buffer payloads as file descriptors instead of inline */
+  gboolean fd_passing;
+  gboolean fdin_is_socket;
+  /* fdout for which fdout_is_socket was found out, -1 for none */
+  int fdout_checked;
+  gboolean fdout_is_socket;
+  GQueue received_fds;
+  GstAllocator *fd_allocator;
+  GstAllocator *dmabuf_allocator;
+
+  /* how many buffers and serialized events may wait for their ack at the
+   * same time; with 1 or less, each of them waits for its own ack */
+  guint max_in_flight;
+  guint n_in_flight;
+  GCond window_cond;
+  gboolean window_flushing;
+  guint32 window_epoch;
+  GstFlowReturn window_flow_ret;
+
   void (*on_buffer) (guint32, GstBuffer *, gpointer);
   void (*on_event) (guint32, GstEvent *, gboolean, gpointer);
   void (*on_query) (guint32, GstQuery *, gboolean, gpointer);
@@ -92,6 +112,8 @@ void gst_ipc_pipeline_comm_init (GstIpcPipelineComm *comm, GstElement *e);
 void gst_ipc_pipeline_comm_clear (GstIpcPipelineComm *comm);
 void gst_ipc_pipeline_comm_cancel (GstIpcPipelineComm * comm,
     gboolean flushing);
+void gst_ipc_pipeline_comm_set_flushing (GstIpcPipelineComm * comm,
+    gboolean flushing);
 
 void gst_ipc_pipeline_comm_write_flow_ack_to_fd (GstIpcPipelineComm * comm,
     guint32 id, GstFlowReturn ret);
@@ -55,7 +55,8 @@
  * Communication with ipcpipelinesrc on the slave happens via a socket, using a
  * custom protocol. Each buffer, event, query, message or state change is
  * serialized in a "packet" and sent over the socket. The sender then
- * performs a blocking wait for a reply, if a return code is needed.
+ * performs a blocking wait for a reply, if a return code is needed (see
+ * below for the exceptions).
  *
  * All objects that contan a GstStructure (messages, queries, events) are
  * serialized by serializing the GstStructure to a string
@@ -65,8 +66,21 @@
  * serialization may occur (ex error/warning/info messages that contain a
  * GError are serialized differently).
  *
- * Buffers are transported by writing their content directly on the socket.
- * More efficient ways for memory sharing could be implemented in the future.
+ * By default, each buffer and serialized event waits for the reply of the
+ * slave before the next one is sent. Setting
+ * #GstIpcPipelineSink:max-in-flight to N allows N of them to be sent before
+ * their replies arrive, so that the round trip to the other process is no
+ * longer paid for every buffer. Flow errors are then returned for one of
+ * the buffers that follow the one that failed. Queries and state changes
+ * keep waiting for their reply.
+ *
+ * By default, buffers are transported by writing their content directly on
+ * the socket. When #GstIpcPipelineSink:fd-passing is enabled and fdout is a
+ * Unix domain socket, only the buffer headers go through the socket and the
+ * payload is passed as a file descriptor: buffers made of a single memfd or
+ * dmabuf memory that does not belong to a buffer pool are passed without any
+ * copy, anything else is copied once into a new memfd. The receiving
+ * ipcpipelinesrc maps that file descriptor instead of reading the payload.
  */
 
 #ifdef HAVE_CONFIG_H
@@ -98,11 +112,15 @@ enum
   PROP_FDOUT,
   PROP_READ_CHUNK_SIZE,
   PROP_ACK_TIME,
+  PROP_FD_PASSING,
+  PROP_MAX_IN_FLIGHT,
 };
 
 
 #define DEFAULT_READ_CHUNK_SIZE 4096
 #define DEFAULT_ACK_TIME (10 * G_TIME_SPAN_SECOND)
+#define DEFAULT_FD_PASSING FALSE
+#define DEFAULT_MAX_IN_FLIGHT 1
 
 #define _do_init \
     GST_DEBUG_CATEGORY_INIT (gst_ipc_pipeline_sink_debug, "ipcpipelinesink", 0, "ipcpipelinesink element");
@@ -174,6 +192,17 @@ gst_ipc_pipeline_sink_class_init (GstIpcPipelineSinkClass * klass)
           "Maximum time to wait for a response to a message",
           0, G_MAXUINT64, DEFAULT_ACK_TIME,
           G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+  g_object_class_install_property (gobject_class, PROP_FD_PASSING,
+      g_param_spec_boolean ("fd-passing", "FD passing",
+          "Pass buffer payloads as file descriptors instead of writing them "
+          "on the socket (only if fdout is a Unix domain socket)",
+          DEFAULT_FD_PASSING, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+  g_object_class_install_property (gobject_class, PROP_MAX_IN_FLIGHT,
+      g_param_spec_uint ("max-in-flight", "Max in flight",
+          "Maximum number of buffers and serialized events sent without "
+          "having received their reply (1 = wait for each reply)",
+          1, 65536, DEFAULT_MAX_IN_FLIGHT,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
   gst_ipc_pipeline_sink_signals[SIGNAL_DISCONNECT] =
       g_signal_new ("disconnect",
@@ -210,6 +239,8 @@ gst_ipc_pipeline_sink_init (GstIpcPipelineSink * sink)
   gst_ipc_pipeline_comm_init (&sink->comm, GST_ELEMENT (sink));
   sink->comm.read_chunk_size = DEFAULT_READ_CHUNK_SIZE;
   sink->comm.ack_time = DEFAULT_ACK_TIME;
+  sink->comm.fd_passing = DEFAULT_FD_PASSING;
+  sink->comm.max_in_flight = DEFAULT_MAX_IN_FLIGHT;
   sink->comm.fdin = -1;
   sink->comm.fdout = -1;
   sink->threads = g_thread_pool_new (pusher, sink, -1, FALSE, NULL);
@@ -264,6 +295,7 @@ gst_ipc_pipeline_sink_set_property (GObject * object, guint prop_id,
       break;
     case PROP_FDOUT:
       sink->comm.fdout = g_value_get_int (value);
+      sink->comm.fdout_checked = -1;
       break;
     case PROP_READ_CHUNK_SIZE:
       sink->comm.read_chunk_size = g_value_get_uint (value);
@@ -271,6 +303,15 @@ gst_ipc_pipeline_sink_set_property (GObject * object, guint prop_id,
     case PROP_ACK_TIME:
       sink->comm.ack_time = g_value_get_uint64 (value);
       break;
+    case PROP_FD_PASSING:
+      sink->comm.fd_passing = g_value_get_boolean (value);
+      break;
+    case PROP_MAX_IN_FLIGHT:
+      g_mutex_lock (&sink->comm.mutex);
+      sink->comm.max_in_flight = g_value_get_uint (value);
+      g_cond_broadcast (&sink->comm.window_cond);
+      g_mutex_unlock (&sink->comm.mutex);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -296,6 +337,12 @@ gst_ipc_pipeline_sink_get_property (GObject * object, guint prop_id,
     case PROP_ACK_TIME:
       g_value_set_uint64 (value, sink->comm.ack_time);
       break;
+    case PROP_FD_PASSING:
+      g_value_set_boolean (value, sink->comm.fd_passing);
+      break;
+    case PROP_MAX_IN_FLIGHT:
+      g_value_set_uint (value, sink->comm.max_in_flight);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -311,6 +358,17 @@ gst_ipc_pipeline_sink_event (GstPad * pad, GstObject * parent, GstEvent * event)
   GST_DEBUG_OBJECT (sink, "received event %p of type %s (%d)",
       event, gst_event_type_get_name (event->type), event->type);
 
+  switch (GST_EVENT_TYPE (event)) {
+    case GST_EVENT_FLUSH_START:
+      gst_ipc_pipeline_comm_set_flushing (&sink->comm, TRUE);
+      break;
+    case GST_EVENT_FLUSH_STOP:
+      gst_ipc_pipeline_comm_set_flushing (&sink->comm, FALSE);
+      break;
+    default:
+      break;
+  }
+
   ret = gst_ipc_pipeline_comm_write_event_to_fd (&sink->comm, FALSE, event);
   gst_event_unref (event);
   return ret;
@@ -401,8 +459,13 @@ static gboolean
 gst_ipc_pipeline_sink_pad_activate_mode (GstPad * pad,
     GstObject * parent, GstPadMode mode, gboolean active)
 {
+  GstIpcPipelineSink *sink = GST_IPC_PIPELINE_SINK (parent);
+
   if (mode == GST_PAD_MODE_PULL)
     return FALSE;
+
+  /* unblocks chain functions waiting for room in the window */
+  gst_ipc_pipeline_comm_set_flushing (&sink->comm, !active);
   return TRUE;
 }
 
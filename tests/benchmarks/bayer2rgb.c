@@ -0,0 +1,129 @@
+/* GStreamer
+ *
+ * bayer2rgb.c: throughput benchmark for the bayer2rgb element
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/*
+ * Pushes the same bayer frame through bayer2rgb repeatedly for every
+ * combination of input depth, output depth, demosaicing method and thread
+ * count, and prints the achieved frame rate.
+ *
+ * Usage: bayer2rgb [width height [frames]]
+ */
+
+#include <stdlib.h>
+#include <gst/gst.h>
+#include <gst/check/gstharness.h>
+
+static const struct
+{
+  const gchar *in_format;
+  const gchar *out_format;
+  gint depth;
+} formats[] = {
+  {"bggr", "BGRx", 8},
+  {"bggr16le", "BGRx", 16},
+  {"bggr16le", "ARGB64", 16},
+};
+
+static const gchar *methods[] = { "bilinear", "gradient" };
+
+static const guint threads[] = { 1, 0 };
+
+static void
+run_one (gint width, gint height, gint frames, guint f, const gchar * method,
+    guint n_threads)
+{
+  GstHarness *h;
+  GstBuffer *inbuf;
+  GstMapInfo map;
+  gint64 start, end;
+  gsize size, i;
+  gint n;
+  gdouble secs;
+
+  h = gst_harness_new ("bayer2rgb");
+  gst_util_set_object_arg (G_OBJECT (h->element), "method", method);
+  g_object_set (h->element, "n-threads", n_threads, NULL);
+
+  gst_harness_set_src_caps (h,
+      gst_caps_new_simple ("video/x-bayer", "format", G_TYPE_STRING,
+          formats[f].in_format, "width", G_TYPE_INT, width, "height",
+          G_TYPE_INT, height, "framerate", GST_TYPE_FRACTION, 60, 1, NULL));
+  gst_harness_set_sink_caps (h,
+      gst_caps_new_simple ("video/x-raw", "format", G_TYPE_STRING,
+          formats[f].out_format, "width", G_TYPE_INT, width, "height",
+          G_TYPE_INT, height, "framerate", GST_TYPE_FRACTION, 60, 1, NULL));
+
+  size = GST_ROUND_UP_4 (width * formats[f].depth / 8) * height;
+  inbuf = gst_buffer_new_and_alloc (size);
+  gst_buffer_map (inbuf, &map, GST_MAP_WRITE);
+  for (i = 0; i < size; i++)
+    map.data[i] = g_random_int ();
+  gst_buffer_unmap (inbuf, &map);
+
+  /* warm up, so that allocation and thread startup are not measured */
+  gst_harness_push (h, gst_buffer_ref (inbuf));
+  gst_buffer_unref (gst_harness_pull (h));
+
+  start = g_get_monotonic_time ();
+  for (n = 0; n < frames; n++) {
+    gst_harness_push (h, gst_buffer_ref (inbuf));
+    gst_buffer_unref (gst_harness_pull (h));
+  }
+  end = g_get_monotonic_time ();
+
+  secs = (end - start) / (gdouble) G_USEC_PER_SEC;
+  g_print ("%-9s -> %-7s %-9s threads=%-3u %8.1f fps %9.1f Mpixel/s\n",
+      formats[f].in_format, formats[f].out_format, method, n_threads,
+      frames / secs, (gdouble) width * height * frames / secs / 1e6);
+
+  gst_buffer_unref (inbuf);
+  gst_harness_teardown (h);
+}
+
+gint
+main (gint argc, gchar * argv[])
+{
+  gint width = 3840, height = 2160, frames = 100;
+  guint f, m, t;
+
+  gst_init (&argc, &argv);
+
+  if (argc >= 3) {
+    width = atoi (argv[1]);
+    height = atoi (argv[2]);
+  }
+  if (argc >= 4)
+    frames = atoi (argv[3]);
+
+  if (width < 4 || height < 4 || frames < 1) {
+    g_printerr ("Usage: %s [width height [frames]]\n", argv[0]);
+    return 1;
+  }
+
+  g_print ("%dx%d, %d frames per run, %u processors\n", width, height,
+      frames, g_get_num_processors ());
+
+  for (f = 0; f < G_N_ELEMENTS (formats); f++)
+    for (m = 0; m < G_N_ELEMENTS (methods); m++)
+      for (t = 0; t < G_N_ELEMENTS (threads); t++)
+        run_one (width, height, frames, f, methods[m], threads[t]);
+
+  return 0;
+}
@@ -0,0 +1,144 @@
+/* GStreamer
+ *
+ * ccconverter.c: microbenchmark for the ccconverter element
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/*
+ * Converts caption packets between every pair of caption formats, pushing
+ * them one buffer at a time and as buffer lists, and prints the number of
+ * packets converted per second.
+ *
+ * Usage: ccconverter [packets [list-size]]
+ */
+
+#include <stdlib.h>
+#include <gst/gst.h>
+#include <gst/check/gstharness.h>
+
+static const guint8 cea608_raw[] = { 0x80, 0x80 };
+static const guint8 cea608_s334_1a[] = { 0x80, 0x80, 0x80, 0x00, 0x80, 0x80 };
+static const guint8 cea708_cc_data[] = { 0xfc, 0x80, 0x80, 0xfe, 0x80, 0x80 };
+static const guint8 cea708_cdp[] =
+    { 0x96, 0x69, 0x13, 0x5f, 0x43, 0x00, 0x00, 0x72, 0xe2, 0xfc, 0x80, 0x80,
+  0xfe, 0x80, 0x80, 0x74, 0x00, 0x00, 0x8a
+};
+
+static const struct
+{
+  const gchar *caps;
+  const guint8 *data;
+  gsize size;
+} formats[] = {
+  {"closedcaption/x-cea-608,format=(string)raw,framerate=(fraction)30/1",
+      cea608_raw, sizeof (cea608_raw)},
+  {"closedcaption/x-cea-608,format=(string)s334-1a,framerate=(fraction)30/1",
+      cea608_s334_1a, sizeof (cea608_s334_1a)},
+  {"closedcaption/x-cea-708,format=(string)cc_data,framerate=(fraction)30/1",
+      cea708_cc_data, sizeof (cea708_cc_data)},
+  {"closedcaption/x-cea-708,format=(string)cdp,framerate=(fraction)30/1",
+      cea708_cdp, sizeof (cea708_cdp)},
+};
+
+static GstBuffer *
+make_buffer (guint in)
+{
+  return gst_buffer_new_wrapped_full (GST_MEMORY_FLAG_READONLY,
+      (gpointer) formats[in].data, formats[in].size, 0, formats[in].size,
+      NULL, NULL);
+}
+
+static void
+drain (GstHarness * h)
+{
+  GstBuffer *buf;
+
+  while ((buf = gst_harness_try_pull (h)))
+    gst_buffer_unref (buf);
+}
+
+static void
+run_one (guint in, guint out, gint packets, gint list_size)
+{
+  GstHarness *h;
+  gint64 start, end;
+  gint n;
+  gdouble single, batched;
+
+  h = gst_harness_new ("ccconverter");
+  gst_harness_set_src_caps_str (h, formats[in].caps);
+  gst_harness_set_sink_caps_str (h, formats[out].caps);
+
+  /* negotiate allocation before measuring */
+  gst_harness_push (h, make_buffer (in));
+  drain (h);
+
+  start = g_get_monotonic_time ();
+  for (n = 0; n < packets; n++) {
+    gst_harness_push (h, make_buffer (in));
+    drain (h);
+  }
+  end = g_get_monotonic_time ();
+  single = packets * (gdouble) G_USEC_PER_SEC / MAX (end - start, 1);
+
+  start = g_get_monotonic_time ();
+  for (n = 0; n < packets; n += list_size) {
+    GstBufferList *list = gst_buffer_list_new_sized (list_size);
+    gint i;
+
+    for (i = 0; i < list_size; i++)
+      gst_buffer_list_add (list, make_buffer (in));
+    gst_pad_push_list (h->srcpad, list);
+    drain (h);
+  }
+  end = g_get_monotonic_time ();
+  batched = packets * (gdouble) G_USEC_PER_SEC / MAX (end - start, 1);
+
+  g_print ("%-70s -> %-70s\n    %10.0f packets/s single, %10.0f packets/s "
+      "in lists of %d\n", formats[in].caps, formats[out].caps, single,
+      batched, list_size);
+
+  gst_harness_teardown (h);
+}
+
+gint
+main (gint argc, gchar * argv[])
+{
+  gint packets = 100000, list_size = 32;
+  guint in, out;
+
+  gst_init (&argc, &argv);
+
+  if (argc >= 2)
+    packets = atoi (argv[1]);
+  if (argc >= 3)
+    list_size = atoi (argv[2]);
+
+  if (packets < 1 || list_size < 1) {
+    g_printerr ("Usage: %s [packets [list-size]]\n", argv[0]);
+    return 1;
+  }
+
+  for (in = 0; in < G_N_ELEMENTS (formats); in++) {
+    for (out = 0; out < G_N_ELEMENTS (formats); out++) {
+      if (in != out)
+        run_one (in, out, packets, list_size);
+    }
+  }
+
+  return 0;
+}
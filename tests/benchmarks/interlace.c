@@ -0,0 +1,132 @@
+/* GStreamer
+ *
+ * interlace.c: throughput benchmark for the interlace element
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/*
+ * Pushes progressive frames through interlace for every field pattern,
+ * single threaded and with one thread per processor, and prints the input
+ * and output frame rates achieved.
+ *
+ * Usage: interlace [width height [frames [format]]]
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <gst/gst.h>
+#include <gst/check/gstharness.h>
+#include <gst/video/video.h>
+
+static void
+run_one (gint width, gint height, gint frames, const gchar * format,
+    GEnumValue * pattern, guint n_threads)
+{
+  GstHarness *h;
+  GstVideoInfo info;
+  GstCaps *caps;
+  GstBuffer *inbuf, *outbuf;
+  GstMapInfo map;
+  gint64 start, end;
+  gint n, n_out = 0;
+  gdouble secs;
+
+  h = gst_harness_new ("interlace");
+  g_object_set (h->element, "field-pattern", pattern->value,
+      "n-threads", n_threads, NULL);
+
+  caps = gst_caps_new_simple ("video/x-raw", "format", G_TYPE_STRING, format,
+      "width", G_TYPE_INT, width, "height", G_TYPE_INT, height,
+      "framerate", GST_TYPE_FRACTION, 24000, 1001, NULL);
+  gst_video_info_from_caps (&info, caps);
+  gst_harness_set_src_caps (h, caps);
+
+  inbuf = gst_buffer_new_and_alloc (GST_VIDEO_INFO_SIZE (&info));
+  gst_buffer_map (inbuf, &map, GST_MAP_WRITE);
+  memset (map.data, 0x80, map.size);
+  gst_buffer_unmap (inbuf, &map);
+
+  start = g_get_monotonic_time ();
+  for (n = 0; n < frames; n++) {
+    GstBuffer *buf = gst_buffer_copy (inbuf);
+
+    GST_BUFFER_PTS (buf) = gst_util_uint64_scale (n, GST_SECOND * 1001, 24000);
+    GST_BUFFER_DURATION (buf) = gst_util_uint64_scale (GST_SECOND, 1001, 24000);
+    gst_harness_push (h, buf);
+
+    while ((outbuf = gst_harness_try_pull (h))) {
+      gst_buffer_unref (outbuf);
+      n_out++;
+    }
+  }
+  end = g_get_monotonic_time ();
+
+  secs = (end - start) / (gdouble) G_USEC_PER_SEC;
+  g_print ("%-8s threads=%-3u %8.1f frames/s in %8.1f frames/s out\n",
+      pattern->value_nick, n_threads, frames / secs, n_out / secs);
+
+  gst_buffer_unref (inbuf);
+  gst_harness_teardown (h);
+}
+
+gint
+main (gint argc, gchar * argv[])
+{
+  gint width = 1920, height = 1080, frames = 500;
+  const gchar *format = "I420";
+  GstElement *interlace;
+  GParamSpec *pspec;
+  GEnumClass *patterns;
+  guint i;
+
+  gst_init (&argc, &argv);
+
+  if (argc >= 3) {
+    width = atoi (argv[1]);
+    height = atoi (argv[2]);
+  }
+  if (argc >= 4)
+    frames = atoi (argv[3]);
+  if (argc >= 5)
+    format = argv[4];
+
+  if (width < 2 || height < 2 || frames < 1) {
+    g_printerr ("Usage: %s [width height [frames [format]]]\n", argv[0]);
+    return 1;
+  }
+
+  interlace = gst_element_factory_make ("interlace", NULL);
+  if (!interlace) {
+    g_printerr ("interlace element not found\n");
+    return 1;
+  }
+  pspec = g_object_class_find_property (G_OBJECT_GET_CLASS (interlace),
+      "field-pattern");
+  patterns = G_PARAM_SPEC_ENUM (pspec)->enum_class;
+
+  g_print ("%dx%d %s, %d frames per run, %u processors\n", width, height,
+      format, frames, g_get_num_processors ());
+
+  for (i = 0; i < patterns->n_values; i++) {
+    run_one (width, height, frames, format, &patterns->values[i], 1);
+    run_one (width, height, frames, format, &patterns->values[i], 0);
+  }
+
+  gst_object_unref (interlace);
+
+  return 0;
+}
@@ -0,0 +1,177 @@
+/* GStreamer
+ *
+ * proxy.c: handoff latency benchmark for the proxysink and proxysrc elements
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/*
+ * Pushes small buffers at a fixed interval into a proxysink and measures the
+ * time until each of them reaches a fakesink behind the matching proxysrc,
+ * once with proxysrc in queue mode and once in ring mode. Prints the average,
+ * median, 99th percentile and maximum latency of both.
+ *
+ * Usage: proxy [n-buffers [buffer-size [interval-us [ring-size]]]]
+ */
+
+#include <stdlib.h>
+#include <gst/gst.h>
+
+static guint n_buffers = 5000;
+static guint buffer_size = 188;
+static guint interval_us = 1000;
+static guint ring_size = 32;
+
+static gint64 *latencies;
+static guint n_received;
+
+static GstPadProbeReturn
+latency_probe (GstPad * pad, GstPadProbeInfo * info, gpointer user_data)
+{
+  GstBuffer *buffer = GST_PAD_PROBE_INFO_BUFFER (info);
+
+  /* the offset carries the time the buffer was pushed into proxysink */
+  if (n_received < n_buffers)
+    latencies[n_received++] =
+        g_get_monotonic_time () - (gint64) GST_BUFFER_OFFSET (buffer);
+
+  return GST_PAD_PROBE_OK;
+}
+
+static gint
+compare_latency (gconstpointer a, gconstpointer b)
+{
+  gint64 la = *(const gint64 *) a, lb = *(const gint64 *) b;
+
+  return la < lb ? -1 : la > lb ? 1 : 0;
+}
+
+static void
+run (const gchar * mode)
+{
+  GstElement *pipe1, *pipe2, *psink, *psrc, *sink;
+  GstPad *srcpad, *sinkpad;
+  GstSegment segment;
+  GstClock *clock;
+  gint64 sum = 0;
+  guint i;
+
+  pipe1 = gst_pipeline_new (NULL);
+  psink = gst_element_factory_make ("proxysink", NULL);
+  gst_bin_add (GST_BIN (pipe1), psink);
+
+  pipe2 = gst_pipeline_new (NULL);
+  psrc = gst_element_factory_make ("proxysrc", NULL);
+  sink = gst_element_factory_make ("fakesink", NULL);
+  g_object_set (sink, "sync", FALSE, "async", FALSE, NULL);
+  gst_bin_add_many (GST_BIN (pipe2), psrc, sink, NULL);
+  gst_element_link (psrc, sink);
+
+  g_object_set (psrc, "proxysink", psink, "ring-size", ring_size, NULL);
+  gst_util_set_object_arg (G_OBJECT (psrc), "mode", mode);
+
+  clock = gst_system_clock_obtain ();
+  gst_pipeline_use_clock (GST_PIPELINE (pipe1), clock);
+  gst_pipeline_use_clock (GST_PIPELINE (pipe2), clock);
+  gst_object_unref (clock);
+  gst_element_set_base_time (pipe1, 0);
+  gst_element_set_base_time (pipe2, 0);
+
+  sinkpad = gst_element_get_static_pad (sink, "sink");
+  gst_pad_add_probe (sinkpad, GST_PAD_PROBE_TYPE_BUFFER, latency_probe, NULL,
+      NULL);
+  gst_object_unref (sinkpad);
+
+  gst_element_set_state (pipe2, GST_STATE_PLAYING);
+  gst_element_set_state (pipe1, GST_STATE_PLAYING);
+  gst_element_get_state (pipe2, NULL, NULL, GST_CLOCK_TIME_NONE);
+  gst_element_get_state (pipe1, NULL, NULL, GST_CLOCK_TIME_NONE);
+
+  /* push straight into proxysink so that only the handoff is measured */
+  srcpad = gst_pad_new ("src", GST_PAD_SRC);
+  sinkpad = gst_element_get_static_pad (psink, "sink");
+  gst_pad_set_active (srcpad, TRUE);
+  gst_pad_link (srcpad, sinkpad);
+  gst_object_unref (sinkpad);
+
+  gst_pad_push_event (srcpad, gst_event_new_stream_start ("proxy-bench"));
+  gst_pad_push_event (srcpad,
+      gst_event_new_caps (gst_caps_new_empty_simple ("application/x-bench")));
+  gst_segment_init (&segment, GST_FORMAT_TIME);
+  gst_pad_push_event (srcpad, gst_event_new_segment (&segment));
+
+  n_received = 0;
+  for (i = 0; i < n_buffers; i++) {
+    GstBuffer *buffer = gst_buffer_new_allocate (NULL, buffer_size, NULL);
+
+    GST_BUFFER_PTS (buffer) = i * interval_us * GST_USECOND;
+    GST_BUFFER_DURATION (buffer) = interval_us * GST_USECOND;
+    GST_BUFFER_OFFSET (buffer) = g_get_monotonic_time ();
+    gst_pad_push (srcpad, buffer);
+    g_usleep (interval_us);
+  }
+
+  /* give the last buffers some time to arrive */
+  for (i = 0; i < 100 && g_atomic_int_get (&n_received) < n_buffers; i++)
+    g_usleep (10000);
+
+  gst_element_set_state (pipe1, GST_STATE_NULL);
+  gst_element_set_state (pipe2, GST_STATE_NULL);
+  gst_object_unref (srcpad);
+  gst_object_unref (pipe1);
+  gst_object_unref (pipe2);
+
+  if (n_received == 0) {
+    g_print ("%-6s no buffers received\n", mode);
+    return;
+  }
+
+  qsort (latencies, n_received, sizeof (gint64), compare_latency);
+  for (i = 0; i < n_received; i++)
+    sum += latencies[i];
+
+  g_print ("%-6s %6u buffers: avg %7.1f us, median %5" G_GINT64_FORMAT
+      " us, p99 %5" G_GINT64_FORMAT " us, max %6" G_GINT64_FORMAT " us\n",
+      mode, n_received, sum / (gdouble) n_received,
+      latencies[n_received / 2], latencies[n_received * 99 / 100],
+      latencies[n_received - 1]);
+}
+
+int
+main (int argc, char *argv[])
+{
+  gst_init (&argc, &argv);
+
+  if (argc > 1)
+    n_buffers = MAX (atoi (argv[1]), 1);
+  if (argc > 2)
+    buffer_size = MAX (atoi (argv[2]), 1);
+  if (argc > 3)
+    interval_us = MAX (atoi (argv[3]), 0);
+  if (argc > 4)
+    ring_size = MAX (atoi (argv[4]), 2);
+
+  latencies = g_new (gint64, n_buffers);
+
+  g_print ("%u buffers of %u bytes every %u us, ring size %u\n", n_buffers,
+      buffer_size, interval_us, ring_size);
+  run ("queue");
+  run ("ring");
+
+  g_free (latencies);
+
+  return 0;
+}
@@ -0,0 +1,259 @@
+/* GStreamer
+ *
+ * rtp.c: packet rate benchmark for the rtpsink and rtpsrc elements
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/*
+ * Sends RTP packets through rtpsink to an rtpsrc listening on the loopback
+ * interface, at doubling packet rates and for several packet sizes. Every
+ * step is run once pushing single buffers and once pushing buffer lists of
+ * batch-size packets, so that the batched paths through rtpbin and udpsink
+ * are covered too. For every step the achieved send and receive rates, the
+ * loss and the process CPU time per received packet are printed. The CPU time
+ * includes generating the packets.
+ *
+ * Losses at high rates usually come from the receive socket buffer, see
+ * net.core.rmem_default on Linux.
+ *
+ * Usage: rtp [duration-ms [batch-size [max-rate [port]]]]
+ */
+
+#include <stdlib.h>
+#include <gst/gst.h>
+#include <gst/rtp/rtp.h>
+#ifdef G_OS_UNIX
+#include <sys/resource.h>
+#endif
+
+#define RTP_CAPS "application/x-rtp, media = (string) video, " \
+    "clock-rate = (int) 90000, encoding-name = (string) H264, " \
+    "payload = (int) 96"
+
+static guint duration_ms = 1000;
+static guint batch_size = 16;
+static guint max_rate = 160000;
+static guint port = 50004;
+
+static const guint sizes[] = { 200, 1400 };
+
+static guint n_received;
+
+static GstPadProbeReturn
+count_probe (GstPad * pad, GstPadProbeInfo * info, gpointer user_data)
+{
+  if (info->type & GST_PAD_PROBE_TYPE_BUFFER_LIST)
+    g_atomic_int_add (&n_received,
+        gst_buffer_list_length (GST_PAD_PROBE_INFO_BUFFER_LIST (info)));
+  else
+    g_atomic_int_inc (&n_received);
+
+  return GST_PAD_PROBE_OK;
+}
+
+static void
+pad_added_cb (GstElement * rtpsrc, GstPad * pad, GstElement * sink)
+{
+  GstPad *sinkpad = gst_element_get_static_pad (sink, "sink");
+
+  gst_pad_link (pad, sinkpad);
+  gst_object_unref (sinkpad);
+}
+
+static gint64
+get_cpu_time (void)
+{
+#ifdef G_OS_UNIX
+  struct rusage usage;
+
+  getrusage (RUSAGE_SELF, &usage);
+
+  return (gint64) (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) *
+      G_USEC_PER_SEC + usage.ru_utime.tv_usec + usage.ru_stime.tv_usec;
+#else
+  return 0;
+#endif
+}
+
+static GstBuffer *
+make_packet (guint size, guint rate, guint seqnum)
+{
+  GstRTPBuffer rtp = GST_RTP_BUFFER_INIT;
+  GstBuffer *buffer;
+
+  buffer = gst_rtp_buffer_allocate (size - 12, 0, 0);
+  gst_rtp_buffer_map (buffer, GST_MAP_WRITE, &rtp);
+  gst_rtp_buffer_set_payload_type (&rtp, 96);
+  gst_rtp_buffer_set_ssrc (&rtp, 0x12345678);
+  gst_rtp_buffer_set_seq (&rtp, seqnum);
+  gst_rtp_buffer_set_timestamp (&rtp, (guint64) seqnum * 90000 / rate);
+  gst_rtp_buffer_unmap (&rtp);
+
+  return buffer;
+}
+
+static void
+check_errors (GstElement * pipeline)
+{
+  GstBus *bus = gst_element_get_bus (pipeline);
+  GstMessage *msg;
+
+  while ((msg = gst_bus_pop_filtered (bus, GST_MESSAGE_ERROR))) {
+    GError *err = NULL;
+
+    gst_message_parse_error (msg, &err, NULL);
+    g_printerr ("error from %s: %s\n", GST_OBJECT_NAME (msg->src),
+        err->message);
+    g_clear_error (&err);
+    gst_message_unref (msg);
+  }
+  gst_object_unref (bus);
+}
+
+static void
+run (guint size, guint rate, gboolean lists)
+{
+  GstElement *sender, *receiver, *rtpsink, *rtpsrc, *sink;
+  GstPad *srcpad, *sinkpad;
+  GstSegment segment;
+  GstCaps *caps;
+  gchar *uri;
+  gint64 start, send_end, cpu_start, cpu;
+  guint i, j, n_sent = 0, n_batches, last;
+
+  uri = g_strdup_printf ("rtp://127.0.0.1:%u", port);
+
+  receiver = gst_pipeline_new (NULL);
+  rtpsrc = gst_element_factory_make ("rtpsrc", NULL);
+  sink = gst_element_factory_make ("fakesink", NULL);
+  g_object_set (rtpsrc, "uri", uri, "encoding-name", "H264", "latency", 0,
+      NULL);
+  g_object_set (sink, "sync", FALSE, "async", FALSE, NULL);
+  gst_bin_add_many (GST_BIN (receiver), rtpsrc, sink, NULL);
+  /* rtpsrc only gets its source pad with the first packet */
+  g_signal_connect (rtpsrc, "pad-added", G_CALLBACK (pad_added_cb), sink);
+
+  sender = gst_pipeline_new (NULL);
+  rtpsink = gst_element_factory_make ("rtpsink", NULL);
+  g_object_set (rtpsink, "uri", uri, NULL);
+  gst_bin_add (GST_BIN (sender), rtpsink);
+  g_free (uri);
+
+  sinkpad = gst_element_get_static_pad (sink, "sink");
+  gst_pad_add_probe (sinkpad,
+      GST_PAD_PROBE_TYPE_BUFFER | GST_PAD_PROBE_TYPE_BUFFER_LIST, count_probe,
+      NULL, NULL);
+  gst_object_unref (sinkpad);
+
+  /* push straight into rtpsink so that only the RTP path is measured */
+  srcpad = gst_pad_new ("src", GST_PAD_SRC);
+  sinkpad = gst_element_get_request_pad (rtpsink, "sink_%u");
+  gst_pad_set_active (srcpad, TRUE);
+  gst_pad_link (srcpad, sinkpad);
+
+  /* the sockets are bound by now, the sinks inside complete their state
+   * change only with the first packets */
+  gst_element_set_state (receiver, GST_STATE_PLAYING);
+  gst_element_set_state (sender, GST_STATE_PLAYING);
+
+  gst_pad_push_event (srcpad, gst_event_new_stream_start ("rtp-bench"));
+  caps = gst_caps_from_string (RTP_CAPS);
+  gst_pad_push_event (srcpad, gst_event_new_caps (caps));
+  gst_caps_unref (caps);
+  gst_segment_init (&segment, GST_FORMAT_TIME);
+  gst_pad_push_event (srcpad, gst_event_new_segment (&segment));
+
+  g_atomic_int_set (&n_received, 0);
+  n_batches = MAX ((guint64) rate * duration_ms / 1000 / batch_size, 1);
+  start = g_get_monotonic_time ();
+  cpu_start = get_cpu_time ();
+
+  for (i = 0; i < n_batches; i++) {
+    gint64 due = start + (gint64) i * batch_size * G_USEC_PER_SEC / rate;
+    gint64 now = g_get_monotonic_time ();
+
+    /* packets are untimestamped, the pacing is done here */
+    if (due > now)
+      g_usleep (due - now);
+
+    if (lists) {
+      GstBufferList *list = gst_buffer_list_new_sized (batch_size);
+
+      for (j = 0; j < batch_size; j++)
+        gst_buffer_list_add (list, make_packet (size, rate, n_sent++));
+      gst_pad_push_list (srcpad, list);
+    } else {
+      for (j = 0; j < batch_size; j++)
+        gst_pad_push (srcpad, make_packet (size, rate, n_sent++));
+    }
+  }
+  send_end = g_get_monotonic_time ();
+
+  /* wait until the receiver is idle */
+  do {
+    last = g_atomic_int_get (&n_received);
+    g_usleep (100000);
+  } while (g_atomic_int_get (&n_received) != last);
+  cpu = get_cpu_time () - cpu_start;
+
+  check_errors (sender);
+  check_errors (receiver);
+
+  gst_element_set_state (sender, GST_STATE_NULL);
+  gst_element_set_state (receiver, GST_STATE_NULL);
+  gst_element_release_request_pad (rtpsink, sinkpad);
+  gst_object_unref (sinkpad);
+  gst_object_unref (srcpad);
+  gst_object_unref (sender);
+  gst_object_unref (receiver);
+
+  g_print ("%-7s %5u bytes %7u pps: sent %8.0f pps, received %8.0f pps, "
+      "loss %5.2f %%, cpu %6.2f us/packet\n", lists ? "list" : "buffer",
+      size, rate, n_sent * (gdouble) G_USEC_PER_SEC / (send_end - start),
+      n_received * (gdouble) G_USEC_PER_SEC / (send_end - start),
+      100.0 * (n_sent - MIN (n_received, n_sent)) / n_sent,
+      n_received ? cpu / (gdouble) n_received : 0.0);
+}
+
+int
+main (int argc, char *argv[])
+{
+  guint i, rate;
+
+  gst_init (&argc, &argv);
+
+  if (argc > 1)
+    duration_ms = MAX (atoi (argv[1]), 1);
+  if (argc > 2)
+    batch_size = MAX (atoi (argv[2]), 1);
+  if (argc > 3)
+    max_rate = MAX (atoi (argv[3]), 1);
+  if (argc > 4)
+    port = MAX (atoi (argv[4]), 1);
+
+  g_print ("%u ms per step, batches of %u packets, up to %u pps, port %u\n",
+      duration_ms, batch_size, max_rate, port);
+
+  for (i = 0; i < G_N_ELEMENTS (sizes); i++) {
+    for (rate = MIN (10000, max_rate); rate <= max_rate; rate *= 2) {
+      run (sizes[i], rate, FALSE);
+      run (sizes[i], rate, TRUE);
+    }
+  }
+
+  return 0;
+}
@@ -0,0 +1,245 @@
+/* GStreamer
+ *
+ * sctp.c: throughput benchmark for the sctpenc and sctpdec elements
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/*
+ * Connects two SCTP associations back to back in one process, each made of
+ * an sctpenc and an sctpdec, and sends the given amount of data from one to
+ * the other as messages of the given size, spread round-robin over a number
+ * of streams and pushed either one at a time or as buffer lists. Prints the
+ * achieved throughput.
+ *
+ * Usage: sctp [message-size [total-mbytes [n-streams [batch-size]]]]
+ */
+
+#include <stdlib.h>
+#include <gst/gst.h>
+#include <gst/app/app.h>
+
+#define MAX_QUEUED_BYTES (4 * 1024 * 1024)
+
+static GMutex lock;
+static GCond cond;
+static gboolean established, done;
+static guint64 bytes_received, messages_received;
+
+static gsize message_size = 1024;
+static guint64 total_size = 256 * 1024 * 1024;
+static guint n_streams = 1;
+static guint batch_size = 1;
+
+static GstPadProbeReturn
+count_probe (GstPad * pad, GstPadProbeInfo * info, gpointer user_data)
+{
+  guint64 size, n;
+
+  if (GST_PAD_PROBE_INFO_TYPE (info) & GST_PAD_PROBE_TYPE_BUFFER_LIST) {
+    GstBufferList *list = GST_PAD_PROBE_INFO_BUFFER_LIST (info);
+
+    size = gst_buffer_list_calculate_size (list);
+    n = gst_buffer_list_length (list);
+  } else {
+    size = gst_buffer_get_size (GST_PAD_PROBE_INFO_BUFFER (info));
+    n = 1;
+  }
+
+  g_mutex_lock (&lock);
+  bytes_received += size;
+  messages_received += n;
+  if (bytes_received >= total_size) {
+    done = TRUE;
+    g_cond_signal (&cond);
+  }
+  g_mutex_unlock (&lock);
+
+  return GST_PAD_PROBE_OK;
+}
+
+static void
+on_pad_added (GstElement * dec, GstPad * pad, GstElement * pipeline)
+{
+  GstElement *sink;
+  GstPad *sinkpad;
+
+  sink = gst_element_factory_make ("fakesink", NULL);
+  g_object_set (sink, "async", FALSE, "sync", FALSE, NULL);
+  gst_bin_add (GST_BIN (pipeline), sink);
+  gst_element_sync_state_with_parent (sink);
+
+  sinkpad = gst_element_get_static_pad (sink, "sink");
+  gst_pad_link (pad, sinkpad);
+  gst_object_unref (sinkpad);
+
+  gst_pad_add_probe (pad,
+      GST_PAD_PROBE_TYPE_BUFFER | GST_PAD_PROBE_TYPE_BUFFER_LIST, count_probe,
+      NULL, NULL);
+}
+
+static void
+on_established (GstElement * enc, gboolean is_established, gpointer user_data)
+{
+  g_mutex_lock (&lock);
+  established = is_established;
+  g_cond_signal (&cond);
+  g_mutex_unlock (&lock);
+}
+
+static GstAppSrc *
+add_stream (GstElement * pipeline, GstElement * enc, guint stream_id)
+{
+  GstElement *src;
+  GstPad *srcpad, *sinkpad;
+  GstCaps *caps;
+  gchar *name;
+
+  src = gst_element_factory_make ("appsrc", NULL);
+  caps = gst_caps_new_simple ("application/data", "ordered", G_TYPE_BOOLEAN,
+      TRUE, "ppid", G_TYPE_UINT, 53, "partially-reliability", G_TYPE_STRING,
+      "none", NULL);
+  g_object_set (src, "caps", caps, "block", TRUE, "max-bytes",
+      (guint64) MAX_QUEUED_BYTES, NULL);
+  gst_caps_unref (caps);
+  gst_bin_add (GST_BIN (pipeline), src);
+
+  name = g_strdup_printf ("sink_%u", stream_id);
+  sinkpad = gst_element_get_request_pad (enc, name);
+  g_free (name);
+  srcpad = gst_element_get_static_pad (src, "src");
+  gst_pad_link (srcpad, sinkpad);
+  gst_object_unref (srcpad);
+  gst_object_unref (sinkpad);
+
+  gst_element_sync_state_with_parent (src);
+
+  return GST_APP_SRC (src);
+}
+
+int
+main (int argc, char *argv[])
+{
+  GstElement *pipeline, *enc, *dec;
+  GstAppSrc **srcs;
+  GstBuffer *message;
+  GError *err = NULL;
+  guint64 sent = 0;
+  gint64 start, end;
+  gdouble secs;
+  guint i, stream = 0;
+
+  gst_init (&argc, &argv);
+
+  if (argc > 1)
+    message_size = MAX (atoi (argv[1]), 1);
+  if (argc > 2)
+    total_size = (guint64) MAX (atoi (argv[2]), 1) * 1024 * 1024;
+  if (argc > 3)
+    n_streams = CLAMP (atoi (argv[3]), 1, 1024);
+  if (argc > 4)
+    batch_size = MAX (atoi (argv[4]), 1);
+
+  /* round to whole messages so the receiver knows when it's done */
+  total_size = (total_size + message_size - 1) / message_size * message_size;
+
+  pipeline = gst_parse_launch ("sctpenc name=enc1 sctp-association-id=1 "
+      "remote-sctp-port=5000 ! sctpdec name=dec2 sctp-association-id=2 "
+      "local-sctp-port=5000 "
+      "sctpenc name=enc2 sctp-association-id=2 remote-sctp-port=5000 ! "
+      "sctpdec name=dec1 sctp-association-id=1 local-sctp-port=5000", &err);
+  if (!pipeline) {
+    g_printerr ("Failed to create pipeline: %s\n", err->message);
+    g_clear_error (&err);
+    return 1;
+  }
+
+  enc = gst_bin_get_by_name (GST_BIN (pipeline), "enc1");
+  dec = gst_bin_get_by_name (GST_BIN (pipeline), "dec2");
+
+  g_signal_connect (enc, "sctp-association-established",
+      G_CALLBACK (on_established), NULL);
+  g_signal_connect (dec, "pad-added", G_CALLBACK (on_pad_added), pipeline);
+
+  gst_element_set_state (pipeline, GST_STATE_PLAYING);
+
+  g_mutex_lock (&lock);
+  while (!established) {
+    if (!g_cond_wait_until (&cond, &lock,
+            g_get_monotonic_time () + 10 * G_TIME_SPAN_SECOND))
+      break;
+  }
+  g_mutex_unlock (&lock);
+
+  if (!established) {
+    g_printerr ("SCTP association was not established\n");
+    gst_element_set_state (pipeline, GST_STATE_NULL);
+    return 1;
+  }
+
+  srcs = g_new (GstAppSrc *, n_streams);
+  for (i = 0; i < n_streams; i++)
+    srcs[i] = add_stream (pipeline, enc, i);
+
+  g_print ("sending %" G_GUINT64_FORMAT " bytes in messages of %"
+      G_GSIZE_FORMAT " bytes on %u streams, %u per push\n", total_size,
+      message_size, n_streams, batch_size);
+
+  message = gst_buffer_new_wrapped (g_malloc0 (message_size), message_size);
+
+  start = g_get_monotonic_time ();
+
+  while (sent < total_size) {
+    if (batch_size > 1) {
+      GstBufferList *list = gst_buffer_list_new_sized (batch_size);
+
+      for (i = 0; i < batch_size && sent < total_size; i++) {
+        gst_buffer_list_add (list, gst_buffer_ref (message));
+        sent += message_size;
+      }
+      gst_app_src_push_buffer_list (srcs[stream], list);
+    } else {
+      gst_app_src_push_buffer (srcs[stream], gst_buffer_ref (message));
+      sent += message_size;
+    }
+    stream = (stream + 1) % n_streams;
+  }
+
+  g_mutex_lock (&lock);
+  while (!done) {
+    if (!g_cond_wait_until (&cond, &lock,
+            g_get_monotonic_time () + 60 * G_TIME_SPAN_SECOND))
+      break;
+  }
+  end = g_get_monotonic_time ();
+  g_mutex_unlock (&lock);
+
+  secs = (end - start) / (gdouble) G_TIME_SPAN_SECOND;
+  g_print ("received %" G_GUINT64_FORMAT " bytes in %.3f s: %.1f MB/s, "
+      "%.0f messages/s%s\n", bytes_received, secs,
+      bytes_received / secs / (1024 * 1024), messages_received / secs,
+      done ? "" : " (incomplete)");
+
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+
+  gst_buffer_unref (message);
+  g_free (srcs);
+  gst_object_unref (enc);
+  gst_object_unref (dec);
+  gst_object_unref (pipeline);
+
+  return done ? 0 : 1;
+}
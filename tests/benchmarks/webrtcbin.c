@@ -0,0 +1,256 @@
+/* GStreamer
+ *
+ * webrtcbin.c: scaling benchmark for the webrtcbin element
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/*
+ * Creates N local loopback peer connections in one process, each made of
+ * an offering and an answering webrtcbin sending audio, and prints how long
+ * it takes until all of them are connected and how many threads the
+ * process uses then. Run it with and without the shared operations pool to
+ * compare.
+ *
+ * Usage: webrtcbin [n-connections [shared-ops-pool]]
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <gst/gst.h>
+#include <gst/sdp/sdp.h>
+#include <gst/webrtc/webrtc.h>
+
+typedef struct
+{
+  GstElement *offerer;
+  GstElement *answerer;
+  gboolean connected;
+} PeerConnection;
+
+static GMutex lock;
+static GCond cond;
+static guint n_connected;
+static gboolean failed;
+
+static gint
+get_n_threads (void)
+{
+  gchar *status, *line;
+  gint n = -1;
+
+  if (!g_file_get_contents ("/proc/self/status", &status, NULL, NULL))
+    return -1;
+
+  line = strstr (status, "Threads:");
+  if (line)
+    n = atoi (line + strlen ("Threads:"));
+  g_free (status);
+
+  return n;
+}
+
+static void
+on_answer_created (GstPromise * promise, PeerConnection * pc)
+{
+  GstWebRTCSessionDescription *answer = NULL;
+  const GstStructure *reply;
+
+  g_assert (gst_promise_wait (promise) == GST_PROMISE_RESULT_REPLIED);
+  reply = gst_promise_get_reply (promise);
+  gst_structure_get (reply, "answer",
+      GST_TYPE_WEBRTC_SESSION_DESCRIPTION, &answer, NULL);
+  gst_promise_unref (promise);
+
+  g_signal_emit_by_name (pc->offerer, "set-remote-description", answer, NULL);
+  g_signal_emit_by_name (pc->answerer, "set-local-description", answer, NULL);
+
+  gst_webrtc_session_description_free (answer);
+}
+
+static void
+on_offer_created (GstPromise * promise, PeerConnection * pc)
+{
+  GstWebRTCSessionDescription *offer = NULL;
+  const GstStructure *reply;
+
+  g_assert (gst_promise_wait (promise) == GST_PROMISE_RESULT_REPLIED);
+  reply = gst_promise_get_reply (promise);
+  gst_structure_get (reply, "offer",
+      GST_TYPE_WEBRTC_SESSION_DESCRIPTION, &offer, NULL);
+  gst_promise_unref (promise);
+
+  g_signal_emit_by_name (pc->offerer, "set-local-description", offer, NULL);
+  g_signal_emit_by_name (pc->answerer, "set-remote-description", offer, NULL);
+
+  promise = gst_promise_new_with_change_func ((GstPromiseChangeFunc)
+      on_answer_created, pc, NULL);
+  g_signal_emit_by_name (pc->answerer, "create-answer", NULL, promise);
+
+  gst_webrtc_session_description_free (offer);
+}
+
+static void
+on_negotiation_needed (GstElement * webrtc, PeerConnection * pc)
+{
+  GstPromise *promise;
+
+  promise = gst_promise_new_with_change_func ((GstPromiseChangeFunc)
+      on_offer_created, pc, NULL);
+  g_signal_emit_by_name (pc->offerer, "create-offer", NULL, promise);
+}
+
+static void
+on_ice_candidate (GstElement * webrtc, guint mlineindex, gchar * candidate,
+    GstElement * other)
+{
+  g_signal_emit_by_name (other, "add-ice-candidate", mlineindex, candidate);
+}
+
+static void
+on_ice_connection_state (GstElement * webrtc, GParamSpec * pspec,
+    PeerConnection * pc)
+{
+  GstWebRTCICEConnectionState state;
+
+  g_object_get (webrtc, "ice-connection-state", &state, NULL);
+
+  g_mutex_lock (&lock);
+  if (!pc->connected && (state == GST_WEBRTC_ICE_CONNECTION_STATE_CONNECTED
+          || state == GST_WEBRTC_ICE_CONNECTION_STATE_COMPLETED)) {
+    pc->connected = TRUE;
+    n_connected++;
+    g_cond_signal (&cond);
+  } else if (state == GST_WEBRTC_ICE_CONNECTION_STATE_FAILED) {
+    failed = TRUE;
+    g_cond_signal (&cond);
+  }
+  g_mutex_unlock (&lock);
+}
+
+static void
+on_pad_added (GstElement * webrtc, GstPad * pad, GstElement * pipeline)
+{
+  GstElement *sink;
+  GstPad *sinkpad;
+
+  if (GST_PAD_DIRECTION (pad) != GST_PAD_SRC)
+    return;
+
+  sink = gst_element_factory_make ("fakesink", NULL);
+  g_object_set (sink, "async", FALSE, "sync", FALSE, NULL);
+  gst_bin_add (GST_BIN (pipeline), sink);
+  gst_element_sync_state_with_parent (sink);
+
+  sinkpad = gst_element_get_static_pad (sink, "sink");
+  gst_pad_link (pad, sinkpad);
+  gst_object_unref (sinkpad);
+}
+
+int
+main (int argc, char *argv[])
+{
+  GstElement *pipeline;
+  PeerConnection *pcs;
+  GString *desc;
+  GError *err = NULL;
+  guint n_pcs = 16, i;
+  gboolean shared = FALSE;
+  gint64 start, end;
+  gint n_threads;
+
+  gst_init (&argc, &argv);
+
+  if (argc > 1)
+    n_pcs = MAX (atoi (argv[1]), 1);
+  if (argc > 2)
+    shared = atoi (argv[2]) != 0;
+
+  desc = g_string_new (NULL);
+  for (i = 0; i < n_pcs; i++) {
+    g_string_append_printf (desc, "audiotestsrc is-live=true wave=silence ! "
+        "opusenc ! rtpopuspay ! application/x-rtp,media=audio,payload=97,"
+        "encoding-name=OPUS ! webrtcbin name=offer%u webrtcbin name=answer%u ",
+        i, i);
+  }
+  pipeline = gst_parse_launch (desc->str, &err);
+  g_string_free (desc, TRUE);
+  if (!pipeline) {
+    g_printerr ("Failed to create pipeline: %s\n", err->message);
+    g_clear_error (&err);
+    return 1;
+  }
+
+  pcs = g_new0 (PeerConnection, n_pcs);
+  for (i = 0; i < n_pcs; i++) {
+    gchar *name;
+
+    name = g_strdup_printf ("offer%u", i);
+    pcs[i].offerer = gst_bin_get_by_name (GST_BIN (pipeline), name);
+    g_free (name);
+    name = g_strdup_printf ("answer%u", i);
+    pcs[i].answerer = gst_bin_get_by_name (GST_BIN (pipeline), name);
+    g_free (name);
+
+    g_object_set (pcs[i].offerer, "shared-ops-pool", shared, NULL);
+    g_object_set (pcs[i].answerer, "shared-ops-pool", shared, NULL);
+
+    g_signal_connect (pcs[i].offerer, "on-negotiation-needed",
+        G_CALLBACK (on_negotiation_needed), &pcs[i]);
+    g_signal_connect (pcs[i].offerer, "on-ice-candidate",
+        G_CALLBACK (on_ice_candidate), pcs[i].answerer);
+    g_signal_connect (pcs[i].answerer, "on-ice-candidate",
+        G_CALLBACK (on_ice_candidate), pcs[i].offerer);
+    g_signal_connect (pcs[i].answerer, "notify::ice-connection-state",
+        G_CALLBACK (on_ice_connection_state), &pcs[i]);
+    g_signal_connect (pcs[i].answerer, "pad-added",
+        G_CALLBACK (on_pad_added), pipeline);
+  }
+
+  g_print ("%u peer connections, %s operation threads\n", n_pcs,
+      shared ? "shared" : "dedicated");
+
+  start = g_get_monotonic_time ();
+  gst_element_set_state (pipeline, GST_STATE_PLAYING);
+
+  g_mutex_lock (&lock);
+  while (n_connected < n_pcs && !failed) {
+    if (!g_cond_wait_until (&cond, &lock,
+            g_get_monotonic_time () + 60 * G_TIME_SPAN_SECOND))
+      break;
+  }
+  end = g_get_monotonic_time ();
+  g_mutex_unlock (&lock);
+
+  n_threads = get_n_threads ();
+
+  g_print ("connected %u/%u in %.3f s%s\n", n_connected, n_pcs,
+      (end - start) / (gdouble) G_TIME_SPAN_SECOND,
+      failed ? " (ICE failed)" : "");
+  g_print ("threads in use: %d (%.1f per connection)\n", n_threads,
+      n_threads / (gdouble) n_pcs);
+
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+
+  for (i = 0; i < n_pcs; i++) {
+    gst_object_unref (pcs[i].offerer);
+    gst_object_unref (pcs[i].answerer);
+  }
+  g_free (pcs);
+  gst_object_unref (pipeline);
+
+  return (n_connected == n_pcs) ? 0 : 1;
+}
@@ -0,0 +1,313 @@
+/* GStreamer
+ *
+ * webrtcdatachannel.c: throughput benchmark for webrtcbin data channels
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/*
+ * Connects two webrtcbin in the same process, opens a data channel between
+ * them and sends the given amount of data as binary messages of the given
+ * size, either one at a time or in batches of messages. The sender stops
+ * queueing when the buffered amount reaches the high threshold and resumes
+ * once it drops below the low threshold. Prints the achieved throughput.
+ *
+ * Usage: webrtcdatachannel [message-size [total-mbytes [batch-size]]]
+ */
+
+#include <stdlib.h>
+#include <gst/gst.h>
+#include <gst/sdp/sdp.h>
+#include <gst/webrtc/webrtc.h>
+
+#define HIGH_THRESHOLD (4 * 1024 * 1024)
+#define LOW_THRESHOLD (1024 * 1024)
+
+static GstElement *offerer, *answerer;
+static GObject *send_channel;
+
+static GMutex lock;
+static GCond cond;
+static gboolean opened, done, failed, buffered_high;
+static guint64 bytes_received;
+
+static gsize message_size = 16384;
+static guint64 total_size = 256 * 1024 * 1024;
+static guint batch_size = 1;
+
+static void
+on_answer_created (GstPromise * promise, gpointer user_data)
+{
+  GstWebRTCSessionDescription *answer = NULL;
+  const GstStructure *reply;
+
+  g_assert (gst_promise_wait (promise) == GST_PROMISE_RESULT_REPLIED);
+  reply = gst_promise_get_reply (promise);
+  gst_structure_get (reply, "answer",
+      GST_TYPE_WEBRTC_SESSION_DESCRIPTION, &answer, NULL);
+  gst_promise_unref (promise);
+
+  g_signal_emit_by_name (offerer, "set-remote-description", answer, NULL);
+  g_signal_emit_by_name (answerer, "set-local-description", answer, NULL);
+
+  gst_webrtc_session_description_free (answer);
+}
+
+static void
+on_offer_created (GstPromise * promise, gpointer user_data)
+{
+  GstWebRTCSessionDescription *offer = NULL;
+  const GstStructure *reply;
+
+  g_assert (gst_promise_wait (promise) == GST_PROMISE_RESULT_REPLIED);
+  reply = gst_promise_get_reply (promise);
+  gst_structure_get (reply, "offer",
+      GST_TYPE_WEBRTC_SESSION_DESCRIPTION, &offer, NULL);
+  gst_promise_unref (promise);
+
+  g_signal_emit_by_name (offerer, "set-local-description", offer, NULL);
+  g_signal_emit_by_name (answerer, "set-remote-description", offer, NULL);
+
+  promise = gst_promise_new_with_change_func (on_answer_created, NULL, NULL);
+  g_signal_emit_by_name (answerer, "create-answer", NULL, promise);
+
+  gst_webrtc_session_description_free (offer);
+}
+
+static void
+on_negotiation_needed (GstElement * webrtc, gpointer user_data)
+{
+  GstPromise *promise;
+
+  promise = gst_promise_new_with_change_func (on_offer_created, NULL, NULL);
+  g_signal_emit_by_name (offerer, "create-offer", NULL, promise);
+}
+
+static void
+on_ice_candidate (GstElement * webrtc, guint mlineindex, gchar * candidate,
+    GstElement * other)
+{
+  g_signal_emit_by_name (other, "add-ice-candidate", mlineindex, candidate);
+}
+
+static void
+on_message_data (GObject * channel, GBytes * data, gpointer user_data)
+{
+  g_mutex_lock (&lock);
+  if (data)
+    bytes_received += g_bytes_get_size (data);
+  if (bytes_received >= total_size) {
+    done = TRUE;
+    g_cond_signal (&cond);
+  }
+  g_mutex_unlock (&lock);
+}
+
+static void
+on_data_channel (GstElement * webrtc, GObject * channel, gpointer user_data)
+{
+  g_signal_connect (channel, "on-message-data", G_CALLBACK (on_message_data),
+      NULL);
+}
+
+static void
+on_open (GObject * channel, gpointer user_data)
+{
+  g_mutex_lock (&lock);
+  opened = TRUE;
+  g_cond_signal (&cond);
+  g_mutex_unlock (&lock);
+}
+
+static void
+on_error (GObject * channel, GError * error, gpointer user_data)
+{
+  g_printerr ("Data channel error: %s\n", error ? error->message : "unknown");
+
+  g_mutex_lock (&lock);
+  failed = TRUE;
+  g_cond_signal (&cond);
+  g_mutex_unlock (&lock);
+}
+
+static void
+on_buffered_amount_high (GObject * channel, gpointer user_data)
+{
+  g_mutex_lock (&lock);
+  buffered_high = TRUE;
+  g_mutex_unlock (&lock);
+}
+
+static void
+on_buffered_amount_low (GObject * channel, gpointer user_data)
+{
+  g_mutex_lock (&lock);
+  buffered_high = FALSE;
+  g_cond_signal (&cond);
+  g_mutex_unlock (&lock);
+}
+
+static gpointer
+send_thread (gpointer user_data)
+{
+  GBytes *message = user_data;
+  GPtrArray *batch;
+  guint64 sent = 0;
+  guint i;
+
+  batch = g_ptr_array_new_with_free_func ((GDestroyNotify) g_bytes_unref);
+
+  while (sent < total_size) {
+    g_mutex_lock (&lock);
+    while (buffered_high && !failed)
+      g_cond_wait (&cond, &lock);
+    g_mutex_unlock (&lock);
+    if (failed)
+      break;
+
+    if (batch_size > 1) {
+      g_ptr_array_set_size (batch, 0);
+      for (i = 0; i < batch_size && sent < total_size; i++) {
+        g_ptr_array_add (batch, g_bytes_ref (message));
+        sent += message_size;
+      }
+      g_signal_emit_by_name (send_channel, "send-data-list", batch);
+    } else {
+      g_signal_emit_by_name (send_channel, "send-data", message);
+      sent += message_size;
+    }
+  }
+
+  g_ptr_array_unref (batch);
+
+  return NULL;
+}
+
+int
+main (int argc, char *argv[])
+{
+  GstElement *pipeline;
+  GThread *thread;
+  GBytes *message;
+  GError *err = NULL;
+  gint64 start, end;
+  gdouble secs;
+
+  gst_init (&argc, &argv);
+
+  if (argc > 1)
+    message_size = MAX (atoi (argv[1]), 1);
+  if (argc > 2)
+    total_size = (guint64) MAX (atoi (argv[2]), 1) * 1024 * 1024;
+  if (argc > 3)
+    batch_size = MAX (atoi (argv[3]), 1);
+
+  /* round to whole messages so the receiver knows when it's done */
+  total_size = (total_size + message_size - 1) / message_size * message_size;
+
+  pipeline = gst_parse_launch ("webrtcbin name=offer webrtcbin name=answer",
+      &err);
+  if (!pipeline) {
+    g_printerr ("Failed to create pipeline: %s\n", err->message);
+    g_clear_error (&err);
+    return 1;
+  }
+
+  offerer = gst_bin_get_by_name (GST_BIN (pipeline), "offer");
+  answerer = gst_bin_get_by_name (GST_BIN (pipeline), "answer");
+
+  g_signal_connect (offerer, "on-negotiation-needed",
+      G_CALLBACK (on_negotiation_needed), NULL);
+  g_signal_connect (offerer, "on-ice-candidate",
+      G_CALLBACK (on_ice_candidate), answerer);
+  g_signal_connect (answerer, "on-ice-candidate",
+      G_CALLBACK (on_ice_candidate), offerer);
+  g_signal_connect (answerer, "on-data-channel",
+      G_CALLBACK (on_data_channel), NULL);
+
+  gst_element_set_state (pipeline, GST_STATE_READY);
+
+  g_signal_emit_by_name (offerer, "create-data-channel", "benchmark", NULL,
+      &send_channel);
+  if (!send_channel) {
+    g_printerr ("Failed to create data channel\n");
+    return 1;
+  }
+  g_object_set (send_channel, "buffered-amount-high-threshold",
+      (guint64) HIGH_THRESHOLD, "buffered-amount-low-threshold",
+      (guint64) LOW_THRESHOLD, NULL);
+  g_signal_connect (send_channel, "on-open", G_CALLBACK (on_open), NULL);
+  g_signal_connect (send_channel, "on-error", G_CALLBACK (on_error), NULL);
+  g_signal_connect (send_channel, "on-buffered-amount-high",
+      G_CALLBACK (on_buffered_amount_high), NULL);
+  g_signal_connect (send_channel, "on-buffered-amount-low",
+      G_CALLBACK (on_buffered_amount_low), NULL);
+
+  gst_element_set_state (pipeline, GST_STATE_PLAYING);
+
+  g_mutex_lock (&lock);
+  while (!opened && !failed) {
+    if (!g_cond_wait_until (&cond, &lock,
+            g_get_monotonic_time () + 30 * G_TIME_SPAN_SECOND))
+      break;
+  }
+  g_mutex_unlock (&lock);
+
+  if (!opened) {
+    g_printerr ("Data channel did not open\n");
+    gst_element_set_state (pipeline, GST_STATE_NULL);
+    return 1;
+  }
+
+  g_print ("sending %" G_GUINT64_FORMAT " bytes in messages of %"
+      G_GSIZE_FORMAT " bytes, %u per send\n", total_size, message_size,
+      batch_size);
+
+  message = g_bytes_new_take (g_malloc0 (message_size), message_size);
+
+  start = g_get_monotonic_time ();
+  thread = g_thread_new ("sender", send_thread, message);
+
+  g_mutex_lock (&lock);
+  while (!done && !failed) {
+    if (!g_cond_wait_until (&cond, &lock,
+            g_get_monotonic_time () + 60 * G_TIME_SPAN_SECOND))
+      break;
+  }
+  end = g_get_monotonic_time ();
+  failed |= !done;
+  g_cond_signal (&cond);
+  g_mutex_unlock (&lock);
+
+  g_thread_join (thread);
+
+  secs = (end - start) / (gdouble) G_TIME_SPAN_SECOND;
+  g_print ("received %" G_GUINT64_FORMAT " bytes in %.3f s: %.1f MB/s, "
+      "%.0f messages/s%s\n", bytes_received, secs,
+      bytes_received / secs / (1024 * 1024),
+      bytes_received / (gdouble) message_size / secs,
+      failed ? " (incomplete)" : "");
+
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+
+  g_bytes_unref (message);
+  g_object_unref (send_channel);
+  gst_object_unref (offerer);
+  gst_object_unref (answerer);
+  gst_object_unref (pipeline);
+
+  return failed ? 1 : 0;
+}
@@ -0,0 +1,185 @@
+/* GStreamer unit test for audiolatency
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#include <gst/check/gstcheck.h>
+#include <gst/app/app.h>
+
+/* Stands in for the audio device: whatever reaches the appsink, which plays
+ * it in real time, is captured again by the appsrc */
+static GstFlowReturn
+loopback_new_sample (GstAppSink * appsink, gpointer user_data)
+{
+  GstAppSrc *appsrc = user_data;
+  GstSample *sample;
+
+  sample = gst_app_sink_pull_sample (appsink);
+  if (!sample)
+    return GST_FLOW_EOS;
+
+  gst_app_src_push_sample (appsrc, sample);
+  gst_sample_unref (sample);
+
+  return GST_FLOW_OK;
+}
+
+/* Runs audiolatency with @props over a loopback going through @output and
+ * @input, and returns its second latency-stats message */
+static GstStructure *
+run_loopback (const gchar * props, const gchar * output, const gchar * input)
+{
+  GstAppSinkCallbacks callbacks = { NULL, NULL, loopback_new_sample };
+  GstElement *pipeline, *appsrc, *appsink;
+  GstStructure *stats = NULL;
+  GError *error = NULL;
+  GstMessage *msg;
+  GstBus *bus;
+  gchar *desc;
+  guint n_stats = 0;
+
+  desc = g_strdup_printf ("audiolatency name=l probe-interval=100 "
+      "stats-interval=500 %s ! %s ! appsink name=out "
+      "appsrc name=in format=time ! %s ! l.", props, output, input);
+  pipeline = gst_parse_launch (desc, &error);
+  g_free (desc);
+  fail_unless (pipeline != NULL, "%s", error ? error->message : "");
+
+  appsrc = gst_bin_get_by_name (GST_BIN (pipeline), "in");
+  appsink = gst_bin_get_by_name (GST_BIN (pipeline), "out");
+  gst_app_sink_set_callbacks (GST_APP_SINK (appsink), &callbacks, appsrc,
+      NULL);
+
+  bus = gst_element_get_bus (pipeline);
+  fail_unless_equals_int (gst_element_set_state (pipeline, GST_STATE_PLAYING),
+      GST_STATE_CHANGE_ASYNC);
+
+  while (!stats) {
+    msg = gst_bus_timed_pop_filtered (bus, 10 * GST_SECOND,
+        GST_MESSAGE_ELEMENT | GST_MESSAGE_ERROR);
+    fail_unless (msg != NULL, "no latency-stats message");
+    fail_if (GST_MESSAGE_TYPE (msg) == GST_MESSAGE_ERROR);
+
+    /* the first interval starts before the first probe is back */
+    if (gst_message_has_name (msg, "latency-stats") && ++n_stats == 2)
+      stats = gst_structure_copy (gst_message_get_structure (msg));
+    gst_message_unref (msg);
+  }
+
+  GST_INFO ("%" GST_PTR_FORMAT, stats);
+
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  gst_object_unref (bus);
+  gst_object_unref (appsrc);
+  gst_object_unref (appsink);
+  gst_object_unref (pipeline);
+
+  return stats;
+}
+
+GST_START_TEST (test_threshold_low_gain)
+{
+  GstStructure *stats;
+  guint sent, received;
+
+  stats = run_loopback ("detection=threshold", "volume volume=0.1",
+      "identity");
+
+  /* a quiet loopback never crosses the threshold */
+  fail_unless (gst_structure_get_uint (stats, "sent", &sent));
+  fail_unless (gst_structure_get_uint (stats, "received", &received));
+  fail_unless (sent >= 4, "only %u probes sent", sent);
+  fail_unless_equals_int (received, 0);
+
+  gst_structure_free (stats);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_correlation_low_gain)
+{
+  GstStructure *stats;
+  guint sent, received;
+  gint64 min, max, p50, p99;
+  const GValue *histogram;
+
+  stats = run_loopback ("detection=correlation", "volume volume=0.1",
+      "identity");
+
+  fail_unless (gst_structure_get_uint (stats, "sent", &sent));
+  fail_unless (gst_structure_get_uint (stats, "received", &received));
+  fail_unless (received >= 3, "only %u of %u probes received", received,
+      sent);
+
+  fail_unless (gst_structure_get_int64 (stats, "min", &min));
+  fail_unless (gst_structure_get_int64 (stats, "p50", &p50));
+  fail_unless (gst_structure_get_int64 (stats, "p99", &p99));
+  fail_unless (gst_structure_get_int64 (stats, "max", &max));
+  fail_unless (min >= 0);
+  fail_unless (min <= p50 && p50 <= p99 && p99 <= max);
+  fail_unless (max < 100 * 1000);
+
+  histogram = gst_structure_get_value (stats, "histogram");
+  fail_unless (histogram != NULL);
+  fail_unless_equals_int (gst_value_array_get_size (histogram),
+      max / 1000 + 1);
+
+  gst_structure_free (stats);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_correlation_delay)
+{
+  GstStructure *stats;
+  guint received;
+  gint64 p50;
+
+  /* the queue holds back 30ms of audio on the way back */
+  stats = run_loopback ("detection=correlation", "volume volume=0.3",
+      "queue min-threshold-time=30000000");
+
+  fail_unless (gst_structure_get_uint (stats, "received", &received));
+  fail_unless (received >= 3, "only %u probes received", received);
+  fail_unless (gst_structure_get_int64 (stats, "p50", &p50));
+  fail_unless (p50 >= 25 * 1000, "latency %" G_GINT64_FORMAT "us", p50);
+  fail_unless (p50 < 100 * 1000, "latency %" G_GINT64_FORMAT "us", p50);
+
+  gst_structure_free (stats);
+}
+
+GST_END_TEST;
+
+static Suite *
+audiolatency_suite (void)
+{
+  Suite *s = suite_create ("audiolatency");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_set_timeout (tc_chain, 30);
+  tcase_add_test (tc_chain, test_threshold_low_gain);
+  tcase_add_test (tc_chain, test_correlation_low_gain);
+  tcase_add_test (tc_chain, test_correlation_delay);
+
+  return s;
+}
+
+GST_CHECK_MAIN (audiolatency);
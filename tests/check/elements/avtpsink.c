@@ -27,11 +27,17 @@ GST_START_TEST (test_properties)
   const gchar *ifname = "enp1s0";
   const gchar *address = "01:AA:BB:CC:DD:EE";
   const gint priority = 3;
+  const guint ring_frames = 16;
   gchar *str;
   gint val;
+  guint uval;
 
   element = gst_check_setup_element ("avtpsink");
 
+  /* the TX ring only helps with buffer lists, it is off by default */
+  g_object_get (G_OBJECT (element), "ring-frames", &uval, NULL);
+  fail_unless_equals_int (uval, 0);
+
   g_object_set (G_OBJECT (element), "ifname", ifname, NULL);
   g_object_get (G_OBJECT (element), "ifname", &str, NULL);
   fail_unless_equals_string (str, ifname);
@@ -46,6 +52,10 @@ GST_START_TEST (test_properties)
   g_object_get (G_OBJECT (element), "priority", &val, NULL);
   fail_unless (val, priority);
 
+  g_object_set (G_OBJECT (element), "ring-frames", ring_frames, NULL);
+  g_object_get (G_OBJECT (element), "ring-frames", &uval, NULL);
+  fail_unless_equals_int (uval, ring_frames);
+
   gst_check_teardown_element (element);
 }
 
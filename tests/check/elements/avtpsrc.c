@@ -20,13 +20,56 @@
  */
 
 #include <gst/check/gstcheck.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+
+/* The RX ring is tested without a socket, the test plays the kernel part on
+ * memory that stands in for the mapping */
+static gpointer mock_map;
+
+static int
+mock_setsockopt (int fd, int level, int name, const void *value,
+    socklen_t len)
+{
+  return 0;
+}
+
+static void *
+mock_mmap (void *addr, size_t len, int prot, int flags, int fd, off_t offset)
+{
+  mock_map = g_malloc0 (len);
+  return mock_map;
+}
+
+static int
+mock_munmap (void *addr, size_t len)
+{
+  fail_unless (addr == mock_map);
+  g_free (addr);
+  mock_map = NULL;
+  return 0;
+}
+
+#define setsockopt mock_setsockopt
+#define mmap mock_mmap
+#define munmap mock_munmap
+#include "../../../ext/avtp/gstavtpring.c"
+#undef setsockopt
+#undef mmap
+#undef munmap
+
+#define BLOCK_SIZE 4096
+#define FRAME_SIZE 256
+#define PKT_SIZE 64
 
 GST_START_TEST (test_properties)
 {
   GstElement *element;
   const gchar *ifname = "enp1s0";
   const gchar *address = "01:AA:BB:CC:DD:EE";
+  const guint ring_blocks = 8;
   gchar *str;
+  guint val;
 
   element = gst_check_setup_element ("avtpsrc");
 
@@ -40,11 +83,124 @@ GST_START_TEST (test_properties)
   fail_unless_equals_string (str, address);
   g_free (str);
 
+  g_object_set (G_OBJECT (element), "ring-blocks", ring_blocks, NULL);
+  g_object_get (G_OBJECT (element), "ring-blocks", &val, NULL);
+  fail_unless_equals_int (val, ring_blocks);
+
   gst_check_teardown_element (element);
 }
 
 GST_END_TEST;
 
+/* Hands @block over to userspace like the kernel does, with @n_pkts
+ * packets filled with @first, @first + 1, ... */
+static void
+kernel_fill_block (GstAvtpRing * ring, guint block, guint64 seq_num,
+    guint n_pkts, guint8 first)
+{
+  struct tpacket_block_desc *desc = gst_avtp_ring_get_block (ring, block);
+  guint8 *pkt;
+  guint i;
+
+  fail_unless_equals_int (desc->hdr.bh1.block_status, TP_STATUS_KERNEL);
+
+  desc->hdr.bh1.num_pkts = n_pkts;
+  desc->hdr.bh1.offset_to_first_pkt =
+      TPACKET_ALIGN (sizeof (struct tpacket_block_desc));
+  desc->hdr.bh1.seq_num = seq_num;
+
+  pkt = (guint8 *) desc + desc->hdr.bh1.offset_to_first_pkt;
+  for (i = 0; i < n_pkts; i++) {
+    struct tpacket3_hdr *hdr = (struct tpacket3_hdr *) pkt;
+
+    hdr->tp_mac = TPACKET_ALIGN (sizeof (struct tpacket3_hdr));
+    hdr->tp_snaplen = PKT_SIZE;
+    hdr->tp_next_offset = i + 1 < n_pkts ? FRAME_SIZE : 0;
+    memset (pkt + hdr->tp_mac, first + i, PKT_SIZE);
+    pkt += FRAME_SIZE;
+  }
+
+  desc->hdr.bh1.block_status = TP_STATUS_USER;
+}
+
+/* Wraps packet @i of @block like avtpsrc does */
+static GstMemory *
+wrap_packet (GstAvtpRing * ring, guint block, guint i, guint8 expected)
+{
+  struct tpacket_block_desc *desc = gst_avtp_ring_get_block (ring, block);
+  struct tpacket3_hdr *hdr;
+  GstMemory *mem;
+  GstMapInfo map;
+
+  fail_unless (i < desc->hdr.bh1.num_pkts);
+  hdr = (struct tpacket3_hdr *) ((guint8 *) desc +
+      desc->hdr.bh1.offset_to_first_pkt + i * FRAME_SIZE);
+  mem = gst_avtp_ring_wrap_packet (ring, block, (guint8 *) hdr + hdr->tp_mac,
+      hdr->tp_snaplen);
+
+  fail_unless (gst_memory_map (mem, &map, GST_MAP_READ));
+  fail_unless_equals_int (map.size, PKT_SIZE);
+  fail_unless_equals_int (map.data[0], expected);
+  fail_unless_equals_int (map.data[PKT_SIZE - 1], expected);
+  gst_memory_unmap (mem, &map);
+
+  return mem;
+}
+
+static guint32
+block_status (GstAvtpRing * ring, guint block)
+{
+  return gst_avtp_ring_get_block (ring, block)->hdr.bh1.block_status;
+}
+
+GST_START_TEST (test_rx_ring_wrap_return)
+{
+  GstAvtpRing *ring;
+  GstMemory *mem[3];
+
+  ring = gst_avtp_ring_new (-1, PACKET_RX_RING, 2, BLOCK_SIZE, FRAME_SIZE);
+  fail_unless (ring != NULL);
+
+  /* nothing to read yet */
+  fail_if (gst_avtp_ring_take_block (ring, 0));
+
+  kernel_fill_block (ring, 0, 1, 2, 10);
+  fail_unless (gst_avtp_ring_take_block (ring, 0));
+  mem[0] = wrap_packet (ring, 0, 0, 10);
+  mem[1] = wrap_packet (ring, 0, 1, 11);
+  /* the reader is done with the block, the memories still hold it */
+  gst_avtp_ring_block_unref (ring, 0);
+  fail_unless (gst_avtp_ring_block_held (ring, 0));
+  fail_unless_equals_int (block_status (ring, 0), TP_STATUS_USER);
+
+  kernel_fill_block (ring, 1, 2, 1, 20);
+  fail_unless (gst_avtp_ring_take_block (ring, 1));
+  mem[2] = wrap_packet (ring, 1, 0, 20);
+  gst_avtp_ring_block_unref (ring, 1);
+
+  /* after a full lap, the block still held downstream is not fresh */
+  fail_if (gst_avtp_ring_take_block (ring, 0));
+
+  gst_memory_unref (mem[0]);
+  fail_unless_equals_int (block_status (ring, 0), TP_STATUS_USER);
+  gst_memory_unref (mem[1]);
+  fail_if (gst_avtp_ring_block_held (ring, 0));
+  fail_unless_equals_int (block_status (ring, 0), TP_STATUS_KERNEL);
+
+  kernel_fill_block (ring, 0, 3, 1, 30);
+  fail_unless (gst_avtp_ring_take_block (ring, 0));
+  gst_avtp_ring_block_unref (ring, 0);
+  fail_unless_equals_int (block_status (ring, 0), TP_STATUS_KERNEL);
+
+  /* the mapping outlives the ring as long as memories reference it */
+  gst_avtp_ring_unref (ring);
+  fail_unless (mock_map != NULL);
+  gst_memory_unref (mem[2]);
+  fail_unless (mock_map == NULL);
+}
+
+GST_END_TEST;
+
 static Suite *
 avtpsrc_suite (void)
 {
@@ -53,6 +209,7 @@ avtpsrc_suite (void)
 
   suite_add_tcase (s, tc_chain);
   tcase_add_test (tc_chain, test_properties);
+  tcase_add_test (tc_chain, test_rx_ring_wrap_return);
 
   return s;
 }
@@ -0,0 +1,247 @@
+/* GStreamer unit test for bayer2rgb
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#include <gst/check/gstcheck.h>
+#include <gst/check/gstharness.h>
+
+#define WIDTH 16
+#define HEIGHT 16
+
+/* Value of the bayer sample at @x, @y of a bggr image */
+typedef guint (*SampleFunc) (guint x, guint y, gpointer user_data);
+
+/* Converts one WIDTHxHEIGHT frame with the given method and input-bits and
+ * returns the output buffer */
+static GstBuffer *
+convert (const gchar * in_format, const gchar * out_format, gint method,
+    guint input_bits, SampleFunc func, gpointer user_data)
+{
+  GstHarness *h = gst_harness_new ("bayer2rgb");
+  GstBuffer *inbuf, *outbuf;
+  GstMapInfo map;
+  gboolean is_16bit, big_endian;
+  guint x, y, stride;
+  gchar *caps;
+
+  is_16bit = g_str_has_suffix (in_format, "16le")
+      || g_str_has_suffix (in_format, "16be");
+  big_endian = g_str_has_suffix (in_format, "16be");
+
+  g_object_set (h->element, "method", method, "input-bits", input_bits, NULL);
+
+  caps = g_strdup_printf ("video/x-raw,format=%s,width=%d,height=%d,"
+      "framerate=25/1", out_format, WIDTH, HEIGHT);
+  gst_harness_set_sink_caps_str (h, caps);
+  g_free (caps);
+  caps = g_strdup_printf ("video/x-bayer,format=%s,width=%d,height=%d,"
+      "framerate=25/1", in_format, WIDTH, HEIGHT);
+  gst_harness_set_src_caps_str (h, caps);
+  g_free (caps);
+
+  stride = GST_ROUND_UP_4 (WIDTH * (is_16bit ? 2 : 1));
+  inbuf = gst_buffer_new_allocate (NULL, stride * HEIGHT, NULL);
+  gst_buffer_map (inbuf, &map, GST_MAP_WRITE);
+  for (y = 0; y < HEIGHT; y++) {
+    guint8 *line = map.data + y * stride;
+
+    for (x = 0; x < WIDTH; x++) {
+      guint v = func (x, y, user_data);
+
+      if (!is_16bit)
+        line[x] = v;
+      else if (big_endian)
+        GST_WRITE_UINT16_BE (line + 2 * x, v);
+      else
+        GST_WRITE_UINT16_LE (line + 2 * x, v);
+    }
+  }
+  gst_buffer_unmap (inbuf, &map);
+
+  fail_unless_equals_int (gst_harness_push (h, inbuf), GST_FLOW_OK);
+  outbuf = gst_harness_pull (h);
+  fail_unless (outbuf != NULL);
+
+  gst_harness_teardown (h);
+
+  return outbuf;
+}
+
+/* values for red, green and blue sites of the bayer pattern */
+static guint
+flat_sample (guint x, guint y, gpointer user_data)
+{
+  const guint *rgb = user_data;
+
+  if ((y & 1) == 0)
+    return (x & 1) ? rgb[1] : rgb[2];
+  else
+    return (x & 1) ? rgb[0] : rgb[1];
+}
+
+/* the same grey value for all samples of a row, increasing per row */
+static guint
+ramp_sample (guint x, guint y, gpointer user_data)
+{
+  return 40 + 10 * y;
+}
+
+GST_START_TEST (test_flat_8bit)
+{
+  guint rgb[3] = { 200, 100, 50 };
+  GstBuffer *outbuf;
+  GstMapInfo map;
+  guint i;
+
+  outbuf = convert ("bggr", "RGBx", 0, 0, flat_sample, rgb);
+  gst_buffer_map (outbuf, &map, GST_MAP_READ);
+  for (i = 0; i < WIDTH * HEIGHT; i++) {
+    fail_unless_equals_int (map.data[4 * i + 0], 200);
+    fail_unless_equals_int (map.data[4 * i + 1], 100);
+    fail_unless_equals_int (map.data[4 * i + 2], 50);
+  }
+  gst_buffer_unmap (outbuf, &map);
+  gst_buffer_unref (outbuf);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_bottom_edge)
+{
+  GstBuffer *outbuf;
+  GstMapInfo map;
+  const guint8 *last;
+  guint x;
+
+  /* The blue samples of the last row only come from the row above it,
+   * which is mirrored below it as well */
+  outbuf = convert ("bggr", "RGBx", 0, 0, ramp_sample, NULL);
+  gst_buffer_map (outbuf, &map, GST_MAP_READ);
+  last = map.data + (HEIGHT - 1) * WIDTH * 4;
+  for (x = 0; x < WIDTH; x++) {
+    fail_unless_equals_int (last[4 * x + 0], ramp_sample (x, HEIGHT - 1,
+            NULL));
+    fail_unless_equals_int (last[4 * x + 2], ramp_sample (x, HEIGHT - 2,
+            NULL));
+  }
+  gst_buffer_unmap (outbuf, &map);
+  gst_buffer_unref (outbuf);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_16bit)
+{
+  guint rgb16[3] = { 0xc812, 0x6434, 0x3256 };
+  guint rgb12[3] = { 0xc81, 0x643, 0x325 };
+  GstBuffer *outbuf;
+  GstMapInfo map;
+  guint i;
+
+  /* all 16 bits are significant by default */
+  outbuf = convert ("bggr16le", "RGBx", 0, 0, flat_sample, rgb16);
+  gst_buffer_map (outbuf, &map, GST_MAP_READ);
+  for (i = 0; i < WIDTH * HEIGHT; i++) {
+    fail_unless_equals_int (map.data[4 * i + 0], 0xc8);
+    fail_unless_equals_int (map.data[4 * i + 1], 0x64);
+    fail_unless_equals_int (map.data[4 * i + 2], 0x32);
+  }
+  gst_buffer_unmap (outbuf, &map);
+  gst_buffer_unref (outbuf);
+
+  outbuf = convert ("bggr16be", "RGBx", 0, 0, flat_sample, rgb16);
+  gst_buffer_map (outbuf, &map, GST_MAP_READ);
+  for (i = 0; i < WIDTH * HEIGHT; i++) {
+    fail_unless_equals_int (map.data[4 * i + 0], 0xc8);
+    fail_unless_equals_int (map.data[4 * i + 1], 0x64);
+    fail_unless_equals_int (map.data[4 * i + 2], 0x32);
+  }
+  gst_buffer_unmap (outbuf, &map);
+  gst_buffer_unref (outbuf);
+
+  /* 12-bit samples in the low bits scale to the full output range */
+  outbuf = convert ("bggr16le", "RGBx", 0, 12, flat_sample, rgb12);
+  gst_buffer_map (outbuf, &map, GST_MAP_READ);
+  for (i = 0; i < WIDTH * HEIGHT; i++) {
+    fail_unless_equals_int (map.data[4 * i + 0], 0xc8);
+    fail_unless_equals_int (map.data[4 * i + 1], 0x64);
+    fail_unless_equals_int (map.data[4 * i + 2], 0x32);
+  }
+  gst_buffer_unmap (outbuf, &map);
+  gst_buffer_unref (outbuf);
+
+  outbuf = convert ("bggr16le", "ARGB64", 0, 12, flat_sample, rgb12);
+  gst_buffer_map (outbuf, &map, GST_MAP_READ);
+  for (i = 0; i < WIDTH * HEIGHT; i++) {
+    const guint16 *p = (const guint16 *) (map.data + 8 * i);
+
+    fail_unless_equals_int (p[0], 0xffff);
+    fail_unless_equals_int (p[1], 0xc81c);
+    fail_unless_equals_int (p[2], 0x6436);
+    fail_unless_equals_int (p[3], 0x3253);
+  }
+  gst_buffer_unmap (outbuf, &map);
+  gst_buffer_unref (outbuf);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_gradient)
+{
+  GstBuffer *outbuf;
+  GstMapInfo map;
+  guint x, y;
+
+  /* The gradient correction vanishes on a linear ramp, so away from the
+   * edges every pixel is the exact grey value of its row */
+  outbuf = convert ("bggr", "RGBx", 1, 0, ramp_sample, NULL);
+  gst_buffer_map (outbuf, &map, GST_MAP_READ);
+  for (y = 2; y < HEIGHT - 2; y++) {
+    for (x = 2; x < WIDTH - 2; x++) {
+      const guint8 *p = map.data + (y * WIDTH + x) * 4;
+
+      fail_unless_equals_int (p[0], ramp_sample (x, y, NULL));
+      fail_unless_equals_int (p[1], ramp_sample (x, y, NULL));
+      fail_unless_equals_int (p[2], ramp_sample (x, y, NULL));
+    }
+  }
+  gst_buffer_unmap (outbuf, &map);
+  gst_buffer_unref (outbuf);
+}
+
+GST_END_TEST;
+
+static Suite *
+bayer2rgb_suite (void)
+{
+  Suite *s = suite_create ("bayer2rgb");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_flat_8bit);
+  tcase_add_test (tc_chain, test_bottom_edge);
+  tcase_add_test (tc_chain, test_16bit);
+  tcase_add_test (tc_chain, test_gradient);
+
+  return s;
+}
+
+GST_CHECK_MAIN (bayer2rgb);
@@ -231,6 +231,79 @@ GST_START_TEST (captions_type_change_and_eos)
 
 GST_END_TEST;
 
+GST_START_TEST (low_latency)
+{
+  GstHarness *h, *h2;
+  GstBuffer *buf, *outbuf;
+  GstPad *caption_pad;
+  GstVideoCaptionMeta *meta;
+  guint64 added_latency;
+
+  h = gst_harness_new_with_padnames ("cccombiner", "sink", "src");
+  g_object_set (h->element, "low-latency", TRUE, NULL);
+  h2 = gst_harness_new_with_element (h->element, NULL, NULL);
+  caption_pad = gst_element_get_request_pad (h->element, "caption");
+  gst_harness_add_element_sink_pad (h2, caption_pad);
+  gst_object_unref (caption_pad);
+
+  gst_harness_set_src_caps_str (h, "foo/bar,framerate=(fraction)25/1");
+  gst_harness_set_src_caps_str (h2, cea708_cc_data_caps.string);
+
+  /* Push a buffer and caption buffer: the video buffer should be
+   * retrievable without waiting for the next caption buffer */
+  buf = gst_buffer_new_and_alloc (128);
+  GST_BUFFER_PTS (buf) = 0;
+  GST_BUFFER_DURATION (buf) = 40 * GST_MSECOND;
+  gst_harness_push (h, buf);
+
+  buf = gst_buffer_new_and_alloc (128);
+  GST_BUFFER_PTS (buf) = 0;
+  GST_BUFFER_DURATION (buf) = 40 * GST_MSECOND;
+  gst_harness_push (h2, buf);
+
+  outbuf = gst_harness_pull (h);
+  fail_unless (outbuf != NULL);
+  fail_unless_equals_uint64 (GST_BUFFER_PTS (outbuf), 0);
+
+  meta = gst_buffer_get_video_caption_meta (outbuf);
+  fail_unless (meta != NULL);
+  fail_unless_equals_int (meta->caption_type,
+      GST_VIDEO_CAPTION_TYPE_CEA708_RAW);
+  fail_unless_equals_int (meta->size, 128);
+
+  gst_buffer_unref (outbuf);
+
+  g_object_get (h->element, "added-latency", &added_latency, NULL);
+  fail_unless_equals_uint64 (added_latency, 0);
+
+  /* A caption arriving after its video buffer was output is attached to
+   * the next video buffer instead of being dropped */
+  buf = gst_buffer_new_and_alloc (64);
+  GST_BUFFER_PTS (buf) = 20 * GST_MSECOND;
+  GST_BUFFER_DURATION (buf) = 20 * GST_MSECOND;
+  gst_harness_push (h2, buf);
+
+  buf = gst_buffer_new_and_alloc (128);
+  GST_BUFFER_PTS (buf) = 40 * GST_MSECOND;
+  GST_BUFFER_DURATION (buf) = 40 * GST_MSECOND;
+  gst_harness_push (h, buf);
+
+  outbuf = gst_harness_pull (h);
+  fail_unless (outbuf != NULL);
+  fail_unless_equals_uint64 (GST_BUFFER_PTS (outbuf), 40 * GST_MSECOND);
+
+  meta = gst_buffer_get_video_caption_meta (outbuf);
+  fail_unless (meta != NULL);
+  fail_unless_equals_int (meta->size, 64);
+
+  gst_buffer_unref (outbuf);
+
+  gst_harness_teardown (h);
+  gst_harness_teardown (h2);
+}
+
+GST_END_TEST;
+
 static Suite *
 cccombiner_suite (void)
 {
@@ -242,6 +315,7 @@ cccombiner_suite (void)
   tcase_add_test (tc, no_captions);
   tcase_add_test (tc, captions_and_eos);
   tcase_add_test (tc, captions_type_change_and_eos);
+  tcase_add_test (tc, low_latency);
 
   return s;
 }
@@ -324,6 +324,54 @@ GST_START_TEST (convert_cea708_cdp_cea708_cc_data)
 
 GST_END_TEST;
 
+GST_START_TEST (convert_buffer_list)
+{
+  const guint8 in[] = { 0xfc, 0x80, 0x80, 0xfe, 0x80, 0x80 };
+  const guint8 out[] = { 0x80, 0x80, 0x80 };
+  GstHarness *h;
+  GstBufferList *list;
+  GstBuffer *buffer;
+  guint i;
+
+  h = gst_harness_new ("ccconverter");
+
+  gst_harness_set_src_caps_str (h,
+      "closedcaption/x-cea-708,format=(string)cc_data");
+  gst_harness_set_sink_caps_str (h,
+      "closedcaption/x-cea-608,format=(string)s334-1a");
+
+  /* the first buffer negotiates the allocation */
+  buffer =
+      gst_buffer_new_wrapped_full (GST_MEMORY_FLAG_READONLY, (gpointer) in,
+      sizeof (in), 0, sizeof (in), NULL, NULL);
+  buffer = gst_harness_push_and_pull (h, buffer);
+  fail_unless (buffer != NULL);
+  gst_check_buffer_data (buffer, out, sizeof (out));
+  gst_buffer_unref (buffer);
+
+  list = gst_buffer_list_new ();
+  for (i = 0; i < 3; i++) {
+    buffer =
+        gst_buffer_new_wrapped_full (GST_MEMORY_FLAG_READONLY, (gpointer) in,
+        sizeof (in), 0, sizeof (in), NULL, NULL);
+    GST_BUFFER_PTS (buffer) = i * GST_SECOND;
+    gst_buffer_list_add (list, buffer);
+  }
+  fail_unless_equals_int (gst_pad_push_list (h->srcpad, list), GST_FLOW_OK);
+
+  for (i = 0; i < 3; i++) {
+    buffer = gst_harness_pull (h);
+    fail_unless (buffer != NULL);
+    fail_unless_equals_uint64 (GST_BUFFER_PTS (buffer), i * GST_SECOND);
+    gst_check_buffer_data (buffer, out, sizeof (out));
+    gst_buffer_unref (buffer);
+  }
+
+  gst_harness_teardown (h);
+}
+
+GST_END_TEST;
+
 static Suite *
 ccextractor_suite (void)
 {
@@ -346,6 +394,7 @@ ccextractor_suite (void)
   tcase_add_test (tc, convert_cea708_cdp_cea608_raw);
   tcase_add_test (tc, convert_cea708_cdp_cea608_s334_1a);
   tcase_add_test (tc, convert_cea708_cdp_cea708_cc_data);
+  tcase_add_test (tc, convert_buffer_list);
 
   return s;
 }
@@ -0,0 +1,331 @@
+/* GStreamer unit test for checksumsink
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#include <string.h>
+#include <gst/check/gstcheck.h>
+#include <gst/check/gstharness.h>
+#include <gst/video/video.h>
+
+#define N_THREADED_BUFFERS 32
+
+static GstHarness *
+setup_checksumsink (const gchar * props, const gchar * caps, GstBus ** bus)
+{
+  GstHarness *h;
+  gchar *launch;
+
+  launch = g_strdup_printf ("checksumsink post-messages=true %s", props);
+  h = gst_harness_new_parse (launch);
+  g_free (launch);
+
+  *bus = gst_bus_new ();
+  gst_element_set_bus (h->element, *bus);
+  gst_harness_set_src_caps_str (h, caps);
+
+  return h;
+}
+
+static void
+teardown_checksumsink (GstHarness * h, GstBus * bus)
+{
+  gst_element_set_bus (h->element, NULL);
+  gst_object_unref (bus);
+  gst_harness_teardown (h);
+}
+
+/* Pops the next checksum message and returns its checksums, checking that
+ * it is for @frame */
+static gchar *
+pop_checksum (GstBus * bus, guint64 frame)
+{
+  const GstStructure *s;
+  GstMessage *msg;
+  guint64 msg_frame;
+  gchar *checksum;
+
+  msg = gst_bus_pop_filtered (bus, GST_MESSAGE_ELEMENT);
+  fail_unless (msg != NULL, "no checksum for frame %" G_GUINT64_FORMAT,
+      frame);
+  s = gst_message_get_structure (msg);
+  fail_unless (gst_structure_has_name (s, "checksum"));
+  fail_unless (gst_structure_get_uint64 (s, "frame", &msg_frame));
+  fail_unless_equals_uint64 (msg_frame, frame);
+  checksum = g_strdup (gst_structure_get_string (s, "checksum"));
+  gst_message_unref (msg);
+
+  return checksum;
+}
+
+static gchar *
+checksum_buffer (const gchar * props, const gchar * caps, GstBuffer * buffer)
+{
+  GstHarness *h;
+  GstBus *bus;
+  gchar *checksum;
+
+  h = setup_checksumsink (props, caps, &bus);
+  fail_unless_equals_int (gst_harness_push (h, buffer), GST_FLOW_OK);
+  checksum = pop_checksum (bus, 0);
+  teardown_checksumsink (h, bus);
+
+  return checksum;
+}
+
+static gchar *
+checksum_data (const gchar * props, const gchar * data, gsize size)
+{
+  return checksum_buffer (props, "application/x-test",
+      gst_buffer_new_wrapped (g_memdup (data, size), size));
+}
+
+GST_START_TEST (test_xxh64_known_answers)
+{
+  const gchar *data = "Nobody inspects the spammish repetition";
+  gchar *checksum;
+  GstBuffer *buffer;
+
+  /* empty */
+  checksum = checksum_buffer ("hash=xxh64", "application/x-test",
+      gst_buffer_new ());
+  fail_unless_equals_string (checksum, "ef46db3751d8e999");
+  g_free (checksum);
+
+  /* shorter than one stripe */
+  checksum = checksum_data ("hash=xxh64", "a", 1);
+  fail_unless_equals_string (checksum, "d24ec4f1a98c6e5b");
+  g_free (checksum);
+  checksum = checksum_data ("hash=xxh64", "abc", 3);
+  fail_unless_equals_string (checksum, "44bc2cf5ad770999");
+  g_free (checksum);
+
+  /* one stripe and a tail */
+  checksum = checksum_data ("hash=xxh64", data, strlen (data));
+  fail_unless_equals_string (checksum, "fbcea83c8a378bf1");
+  g_free (checksum);
+
+  /* the same data split over several memories */
+  buffer = gst_buffer_new ();
+  gst_buffer_append_memory (buffer,
+      gst_memory_new_wrapped (GST_MEMORY_FLAG_READONLY, (gpointer) data,
+          strlen (data), 0, 5, NULL, NULL));
+  gst_buffer_append_memory (buffer,
+      gst_memory_new_wrapped (GST_MEMORY_FLAG_READONLY, (gpointer) data,
+          strlen (data), 5, strlen (data) - 5, NULL, NULL));
+  checksum = checksum_buffer ("hash=xxh64", "application/x-test", buffer);
+  fail_unless_equals_string (checksum, "fbcea83c8a378bf1");
+  g_free (checksum);
+}
+
+GST_END_TEST;
+
+static const guint8 plane_pattern[3][3] = {
+  {7, 31, 3}, {5, 11, 1}, {3, 13, 2}
+};
+
+/* Creates a frame of @format filled with a pattern per plane, using
+ * @strides or the default ones if NULL. The padding is filled with junk. */
+static GstBuffer *
+create_frame (GstVideoFormat format, gint width, gint height,
+    const gint * strides)
+{
+  GstVideoInfo info;
+  GstVideoFrame frame;
+  GstBuffer *buffer;
+  gsize offsets[GST_VIDEO_MAX_PLANES] = { 0, };
+  gsize size;
+  guint i, x, y;
+
+  gst_video_info_set_format (&info, format, width, height);
+
+  if (strides) {
+    size = 0;
+    for (i = 0; i < GST_VIDEO_INFO_N_PLANES (&info); i++) {
+      offsets[i] = size;
+      size += strides[i] * GST_VIDEO_INFO_COMP_HEIGHT (&info, i);
+    }
+    buffer = gst_buffer_new_allocate (NULL, size, NULL);
+    gst_buffer_add_video_meta_full (buffer, GST_VIDEO_FRAME_FLAG_NONE,
+        format, width, height, GST_VIDEO_INFO_N_PLANES (&info), offsets,
+        strides);
+  } else {
+    size = GST_VIDEO_INFO_SIZE (&info);
+    buffer = gst_buffer_new_allocate (NULL, size, NULL);
+  }
+  gst_buffer_memset (buffer, 0, 0xff, size);
+
+  fail_unless (gst_video_frame_map (&frame, &info, buffer, GST_MAP_WRITE));
+  for (i = 0; i < GST_VIDEO_FRAME_N_PLANES (&frame); i++) {
+    guint8 *data = GST_VIDEO_FRAME_PLANE_DATA (&frame, i);
+    gint stride = GST_VIDEO_FRAME_PLANE_STRIDE (&frame, i);
+
+    for (y = 0; y < GST_VIDEO_FRAME_COMP_HEIGHT (&frame, i); y++)
+      for (x = 0; x < GST_VIDEO_FRAME_COMP_WIDTH (&frame, i); x++)
+        data[y * stride + x] = x * plane_pattern[i][0] +
+            y * plane_pattern[i][1] + plane_pattern[i][2];
+  }
+  gst_video_frame_unmap (&frame);
+
+  return buffer;
+}
+
+GST_START_TEST (test_frame_ignores_stride)
+{
+  const gchar *caps = "video/x-raw,format=GRAY8,width=13,height=7";
+  const gint strides[] = { 32 };
+  GstBuffer *packed;
+  gchar *checksum;
+  guint x, y;
+
+  /* rows of 13 bytes are fed to the hash one by one */
+  checksum = checksum_buffer ("hash=xxh64 mode=frame", caps,
+      create_frame (GST_VIDEO_FORMAT_GRAY8, 13, 7, NULL));
+  fail_unless_equals_string (checksum, "fe6a8a5b41516102");
+  g_free (checksum);
+
+  checksum = checksum_buffer ("hash=xxh64 mode=frame", caps,
+      create_frame (GST_VIDEO_FORMAT_GRAY8, 13, 7, strides));
+  fail_unless_equals_string (checksum, "fe6a8a5b41516102");
+  g_free (checksum);
+
+  /* the same pixels without padding, hashed in one go */
+  packed = gst_buffer_new_allocate (NULL, 13 * 7, NULL);
+  for (y = 0; y < 7; y++)
+    for (x = 0; x < 13; x++)
+      gst_buffer_memset (packed, y * 13 + x, x * 7 + y * 31 + 3, 1);
+  checksum = checksum_buffer ("hash=xxh64 mode=buffer", "application/x-test",
+      packed);
+  fail_unless_equals_string (checksum, "fe6a8a5b41516102");
+  g_free (checksum);
+
+  /* while the whole buffer includes the padding */
+  checksum = checksum_buffer ("hash=xxh64 mode=buffer", caps,
+      create_frame (GST_VIDEO_FORMAT_GRAY8, 13, 7, strides));
+  fail_if (g_str_equal (checksum, "fe6a8a5b41516102"));
+  g_free (checksum);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_planes_ignore_stride)
+{
+  const gchar *caps = "video/x-raw,format=I420,width=10,height=6";
+  const gint strides[] = { 16, 24, 8 };
+  const gchar *expected =
+      "df20f88f6d4783bd 88941156632482db b67173fba91f7284";
+  gchar *checksum;
+
+  checksum = checksum_buffer ("hash=xxh64 mode=planes", caps,
+      create_frame (GST_VIDEO_FORMAT_I420, 10, 6, NULL));
+  fail_unless_equals_string (checksum, expected);
+  g_free (checksum);
+
+  checksum = checksum_buffer ("hash=xxh64 mode=planes", caps,
+      create_frame (GST_VIDEO_FORMAT_I420, 10, 6, strides));
+  fail_unless_equals_string (checksum, expected);
+  g_free (checksum);
+
+  /* all planes in one checksum */
+  checksum = checksum_buffer ("hash=xxh64 mode=frame", caps,
+      create_frame (GST_VIDEO_FORMAT_I420, 10, 6, strides));
+  fail_unless_equals_string (checksum, "80837f24d5fcaaef");
+  g_free (checksum);
+}
+
+GST_END_TEST;
+
+static GstBuffer *
+create_numbered_buffer (guint n)
+{
+  GstBuffer *buffer;
+
+  /* big enough for the workers to finish out of order */
+  buffer = gst_buffer_new_allocate (NULL, (n % 4 + 1) * 256 * 1024, NULL);
+  gst_buffer_memset (buffer, 0, n, gst_buffer_get_size (buffer));
+  GST_BUFFER_PTS (buffer) = n * GST_MSECOND;
+
+  return buffer;
+}
+
+static void
+run_threaded (guint n_threads)
+{
+  GstHarness *h, *ref;
+  GstBus *bus, *ref_bus;
+  gchar *props, *checksum, *expected;
+  GstMessage *msg;
+  guint i;
+
+  props = g_strdup_printf ("hash=sha1 threads=%u", n_threads);
+  h = setup_checksumsink (props, "application/x-test", &bus);
+  g_free (props);
+  ref = setup_checksumsink ("hash=sha1 threads=0", "application/x-test",
+      &ref_bus);
+
+  for (i = 0; i < N_THREADED_BUFFERS; i++) {
+    fail_unless_equals_int (gst_harness_push (h, create_numbered_buffer (i)),
+        GST_FLOW_OK);
+    fail_unless_equals_int (gst_harness_push (ref,
+            create_numbered_buffer (i)), GST_FLOW_OK);
+  }
+
+  /* every checksum is reported before the EOS is handled */
+  fail_unless (gst_harness_push_event (h, gst_event_new_eos ()));
+
+  for (i = 0; i < N_THREADED_BUFFERS; i++) {
+    checksum = pop_checksum (bus, i);
+    expected = pop_checksum (ref_bus, i);
+    fail_unless_equals_string (checksum, expected);
+    g_free (checksum);
+    g_free (expected);
+  }
+
+  msg = gst_bus_pop_filtered (bus, GST_MESSAGE_ELEMENT);
+  fail_unless (msg == NULL, "more checksums than buffers");
+
+  teardown_checksumsink (h, bus);
+  teardown_checksumsink (ref, ref_bus);
+}
+
+GST_START_TEST (test_threads_in_order)
+{
+  run_threaded (1);
+  run_threaded (4);
+}
+
+GST_END_TEST;
+
+static Suite *
+checksumsink_suite (void)
+{
+  Suite *s = suite_create ("checksumsink");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_xxh64_known_answers);
+  tcase_add_test (tc_chain, test_frame_ignores_stride);
+  tcase_add_test (tc_chain, test_planes_ignore_stride);
+  tcase_add_test (tc_chain, test_threads_in_order);
+
+  return s;
+}
+
+GST_CHECK_MAIN (checksumsink);
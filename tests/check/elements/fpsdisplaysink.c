@@ -0,0 +1,288 @@
+/* GStreamer unit test for fpsdisplaysink
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#include <gst/check/gstcheck.h>
+#include <gst/check/gstharness.h>
+#include <gst/check/gsttestclock.h>
+
+#define CAPS_STR "video/x-raw,format=RGB,width=2,height=2,framerate=100/1"
+
+/* the statistics are put out by the first buffer after this interval */
+#define UPDATE_INTERVAL_MS 500
+
+#define JITTER_BUCKETS 24
+
+static GstHarness *
+setup_fpsdisplaysink (gboolean sync, GstBus ** bus, GstElement ** video_sink)
+{
+  GstElement *element;
+  GstHarness *h;
+
+  element = gst_element_factory_make ("fpsdisplaysink", NULL);
+  fail_unless (element != NULL);
+  *video_sink = gst_element_factory_make ("fakesink", NULL);
+  g_object_set (element, "video-sink", *video_sink, "text-overlay", FALSE,
+      "silent", TRUE, "sync", sync, "post-messages", TRUE,
+      "fps-update-interval", UPDATE_INTERVAL_MS, NULL);
+
+  h = gst_harness_new_with_element (element, "sink", NULL);
+  gst_object_unref (element);
+  gst_harness_use_testclock (h);
+
+  *bus = gst_bus_new ();
+  gst_element_set_bus (h->element, *bus);
+  gst_harness_set_src_caps_str (h, CAPS_STR);
+
+  return h;
+}
+
+static void
+teardown_fpsdisplaysink (GstHarness * h, GstBus * bus)
+{
+  gst_element_set_bus (h->element, NULL);
+  gst_object_unref (bus);
+  gst_harness_teardown (h);
+}
+
+static GstBuffer *
+create_buffer (GstClockTime pts)
+{
+  GstBuffer *buffer = gst_buffer_new_allocate (NULL, 12, NULL);
+
+  GST_BUFFER_PTS (buffer) = pts;
+  GST_BUFFER_DURATION (buffer) = 10 * GST_MSECOND;
+
+  return buffer;
+}
+
+/* Waits for the update interval to pass and pushes @buffer to get the
+ * statistics out */
+static GstStructure *
+push_and_get_stats (GstHarness * h, GstBus * bus, GstBuffer * buffer)
+{
+  GstStructure *stats = NULL;
+  GstMessage *msg;
+
+  g_usleep ((UPDATE_INTERVAL_MS + 100) * 1000);
+  fail_unless_equals_int (gst_harness_push (h, buffer), GST_FLOW_OK);
+
+  while (!stats && (msg = gst_bus_pop_filtered (bus, GST_MESSAGE_ELEMENT))) {
+    if (gst_message_has_name (msg, "fps-stats"))
+      stats = gst_structure_copy (gst_message_get_structure (msg));
+    gst_message_unref (msg);
+  }
+  fail_unless (stats != NULL, "no fps-stats message");
+  GST_INFO ("%" GST_PTR_FORMAT, stats);
+
+  return stats;
+}
+
+static void
+check_latency (const GstStructure * stats, const gchar * field,
+    GstClockTimeDiff expected)
+{
+  gint64 value;
+
+  fail_unless (gst_structure_get_int64 (stats, field, &value), "no %s",
+      field);
+  fail_unless_equals_int64 (value, expected);
+}
+
+static void
+check_jitter (const GstStructure * stats, GstClockTime avg, GstClockTime max,
+    const guint64 * histogram)
+{
+  const GValue *array;
+  guint64 value;
+  guint i;
+
+  fail_unless (gst_structure_get_uint64 (stats, "jitter-avg", &value));
+  fail_unless_equals_uint64 (value, avg);
+  fail_unless (gst_structure_get_uint64 (stats, "jitter-max", &value));
+  fail_unless_equals_uint64 (value, max);
+
+  array = gst_structure_get_value (stats, "jitter-histogram");
+  fail_unless (array != NULL);
+  fail_unless_equals_int (gst_value_array_get_size (array), JITTER_BUCKETS);
+  for (i = 0; i < JITTER_BUCKETS; i++)
+    fail_unless_equals_uint64 (g_value_get_uint64 (gst_value_array_get_value
+            (array, i)), histogram[i]);
+}
+
+GST_START_TEST (test_latency_on_arrival)
+{
+  GstHarness *h;
+  GstBus *bus;
+  GstElement *video_sink;
+  GstTestClock *clock;
+  GstStructure *stats;
+  guint64 histogram[JITTER_BUCKETS] = { 0, };
+  guint64 frames;
+  guint i;
+
+  h = setup_fpsdisplaysink (FALSE, &bus, &video_sink);
+  clock = GST_TEST_CLOCK (gst_harness_get_testclock (h));
+
+  /* buffer i arrives i * 100us after its running time, so every arrival is
+   * 100us later than the spacing of the running times */
+  for (i = 0; i < 99; i++) {
+    gst_test_clock_set_time (clock, i * 10 * GST_MSECOND + i * 100 * GST_USECOND);
+    fail_unless_equals_int (gst_harness_push (h,
+            create_buffer (i * 10 * GST_MSECOND)), GST_FLOW_OK);
+  }
+  gst_test_clock_set_time (clock, 99 * 10 * GST_MSECOND + 99 * 100 *
+      GST_USECOND);
+  stats = push_and_get_stats (h, bus, create_buffer (99 * 10 * GST_MSECOND));
+
+  fail_unless (gst_structure_get_uint64 (stats, "frames-rendered", &frames));
+  fail_unless_equals_uint64 (frames, 100);
+
+  /* the latencies are 0, 100us, ... 9900us */
+  check_latency (stats, "latency-min", 0);
+  check_latency (stats, "latency-avg", 4950 * GST_USECOND);
+  check_latency (stats, "latency-p50", 4900 * GST_USECOND);
+  check_latency (stats, "latency-p99", 9800 * GST_USECOND);
+  check_latency (stats, "latency-max", 9900 * GST_USECOND);
+
+  /* 100us falls in [64, 128) */
+  histogram[7] = 99;
+  check_jitter (stats, 100 * GST_USECOND, 100 * GST_USECOND, histogram);
+
+  gst_structure_free (stats);
+  gst_object_unref (clock);
+  teardown_fpsdisplaysink (h, bus);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_jitter_buckets)
+{
+  GstHarness *h;
+  GstBus *bus;
+  GstElement *video_sink;
+  GstTestClock *clock;
+  GstStructure *stats;
+  guint64 histogram[JITTER_BUCKETS] = { 0, };
+  const GstClockTime late[] = { 0, 0, GST_USECOND, 1001 * GST_USECOND,
+    1001 * GST_USECOND + 10 * GST_SECOND
+  };
+  guint i;
+
+  h = setup_fpsdisplaysink (FALSE, &bus, &video_sink);
+  clock = GST_TEST_CLOCK (gst_harness_get_testclock (h));
+
+  for (i = 0; i < G_N_ELEMENTS (late) - 1; i++) {
+    gst_test_clock_set_time (clock, i * 10 * GST_MSECOND + late[i]);
+    fail_unless_equals_int (gst_harness_push (h,
+            create_buffer (i * 10 * GST_MSECOND)), GST_FLOW_OK);
+  }
+  gst_test_clock_set_time (clock, i * 10 * GST_MSECOND + late[i]);
+  stats = push_and_get_stats (h, bus, create_buffer (i * 10 * GST_MSECOND));
+
+  check_latency (stats, "latency-min", 0);
+  check_latency (stats, "latency-p50", GST_USECOND);
+  check_latency (stats, "latency-max", late[4]);
+
+  /* below 1us, in [1, 2) us, in [512, 1024) us and beyond the last bucket */
+  histogram[0] = 1;
+  histogram[1] = 1;
+  histogram[10] = 1;
+  histogram[JITTER_BUCKETS - 1] = 1;
+  check_jitter (stats, (GST_USECOND + 1000 * GST_USECOND + 10 * GST_SECOND) / 4,
+      10 * GST_SECOND, histogram);
+
+  gst_structure_free (stats);
+  gst_object_unref (clock);
+  teardown_fpsdisplaysink (h, bus);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_latency_on_render)
+{
+  GstHarness *h;
+  GstBus *bus;
+  GstElement *video_sink;
+  GstTestClock *clock;
+  GstStructure *stats;
+  GstPad *pad;
+  guint64 histogram[JITTER_BUCKETS] = { 0, };
+  const GstClockTimeDiff diffs[] = { -5 * GST_MSECOND, 0, GST_MSECOND,
+    GST_MSECOND, 10 * GST_MSECOND
+  };
+  guint i;
+
+  h = setup_fpsdisplaysink (TRUE, &bus, &video_sink);
+  clock = GST_TEST_CLOCK (gst_harness_get_testclock (h));
+  /* all buffers are late, so the sink never waits */
+  gst_test_clock_set_time (clock, 10 * GST_SECOND);
+
+  fail_unless (gst_element_send_event (h->element,
+          gst_event_new_latency (20 * GST_MSECOND)));
+
+  fail_unless_equals_int (gst_harness_push (h, create_buffer (0)),
+      GST_FLOW_OK);
+
+  /* what the video sink reports after rendering, early buffers are rendered
+   * at their running time plus the latency */
+  pad = gst_element_get_static_pad (video_sink, "sink");
+  for (i = 0; i < G_N_ELEMENTS (diffs); i++)
+    gst_pad_push_event (pad, gst_event_new_qos (GST_QOS_TYPE_UNDERFLOW, 1.0,
+            diffs[i], i * 10 * GST_MSECOND));
+  gst_object_unref (pad);
+
+  stats = push_and_get_stats (h, bus, create_buffer (10 * GST_MSECOND));
+
+  /* 20, 20, 21, 21 and 30ms */
+  check_latency (stats, "latency-min", 20 * GST_MSECOND);
+  check_latency (stats, "latency-avg", 22400 * GST_USECOND);
+  check_latency (stats, "latency-p50", 21 * GST_MSECOND);
+  check_latency (stats, "latency-p99", 21 * GST_MSECOND);
+  check_latency (stats, "latency-max", 30 * GST_MSECOND);
+
+  histogram[0] = 2;
+  histogram[10] = 1;
+  histogram[14] = 1;
+  check_jitter (stats, 2500 * GST_USECOND, 9 * GST_MSECOND, histogram);
+
+  gst_structure_free (stats);
+  gst_object_unref (clock);
+  teardown_fpsdisplaysink (h, bus);
+}
+
+GST_END_TEST;
+
+static Suite *
+fpsdisplaysink_suite (void)
+{
+  Suite *s = suite_create ("fpsdisplaysink");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_latency_on_arrival);
+  tcase_add_test (tc_chain, test_jitter_buckets);
+  tcase_add_test (tc_chain, test_latency_on_render);
+
+  return s;
+}
+
+GST_CHECK_MAIN (fpsdisplaysink);
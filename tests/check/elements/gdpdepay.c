@@ -277,6 +277,300 @@ GST_START_TEST (test_audio_in_one_buffer)
 
 GST_END_TEST;
 
+/* buffer payloads are passed on as sub-buffers of the GDP stream */
+GST_START_TEST (test_payload_zero_copy)
+{
+  GstCaps *caps;
+  GstElement *gdpdepay;
+  GstBuffer *buffer, *inbuffer, *outbuffer;
+  GstBuffer *caps_buf, *streamstart_buf, *segment_buf, *data_buf;
+  GstEvent *event;
+  GstSegment segment;
+  GstMapInfo inmap, outmap;
+
+  gdpdepay = setup_gdpdepay ();
+
+  fail_unless (gst_element_set_state (gdpdepay,
+          GST_STATE_PLAYING) == GST_STATE_CHANGE_SUCCESS,
+      "could not set to playing");
+
+  caps = gst_caps_new_empty_simple ("application/x-gdp");
+  gst_check_setup_events (mysrcpad, gdpdepay, caps, GST_FORMAT_BYTES);
+  gst_caps_unref (caps);
+
+  event = gst_event_new_stream_start ("s-s-id-1234");
+  streamstart_buf = gst_dp_payload_event (event, 0);
+  gst_event_unref (event);
+
+  caps = gst_caps_from_string (AUDIO_CAPS_STRING);
+  caps_buf = gst_dp_payload_caps (caps, 0);
+  gst_caps_unref (caps);
+
+  gst_segment_init (&segment, GST_FORMAT_TIME);
+  event = gst_event_new_segment (&segment);
+  segment_buf = gst_dp_payload_event (event, 0);
+  gst_event_unref (event);
+
+  buffer = gst_buffer_new_and_alloc (4);
+  gst_buffer_fill (buffer, 0, "f00d", 4);
+  GST_BUFFER_PTS (buffer) = GST_SECOND;
+  data_buf = gst_dp_payload_buffer (buffer, GST_DP_HEADER_FLAG_CRC);
+  gst_buffer_unref (buffer);
+
+  buffer = gst_buffer_append (streamstart_buf, caps_buf);
+  buffer = gst_buffer_append (buffer, segment_buf);
+  buffer = gst_buffer_append (buffer, data_buf);
+
+  /* push the whole stream in one contiguous memory */
+  gst_buffer_map (buffer, &inmap, GST_MAP_READ);
+  inbuffer = gst_buffer_new_wrapped (g_memdup (inmap.data, inmap.size),
+      inmap.size);
+  gst_buffer_unmap (buffer, &inmap);
+  gst_buffer_unref (buffer);
+
+  gst_buffer_map (inbuffer, &inmap, GST_MAP_READ);
+  fail_unless_equals_int (gst_pad_push (mysrcpad, gst_buffer_ref (inbuffer)),
+      GST_FLOW_OK);
+
+  fail_unless_equals_int (g_list_length (buffers), 1);
+  outbuffer = GST_BUFFER (buffers->data);
+  fail_unless_equals_uint64 (GST_BUFFER_PTS (outbuffer), GST_SECOND);
+  gst_buffer_map (outbuffer, &outmap, GST_MAP_READ);
+  fail_unless_equals_int (outmap.size, 4);
+  fail_unless (memcmp (outmap.data, "f00d", 4) == 0);
+  /* the payload is the last part of the input */
+  fail_unless (outmap.data == inmap.data + inmap.size - 4);
+  gst_buffer_unmap (outbuffer, &outmap);
+
+  gst_buffer_unmap (inbuffer, &inmap);
+  gst_buffer_unref (inbuffer);
+
+  fail_unless (gst_element_set_state (gdpdepay,
+          GST_STATE_NULL) == GST_STATE_CHANGE_SUCCESS, "could not set to null");
+
+  g_list_foreach (buffers, (GFunc) gst_mini_object_unref, NULL);
+  g_list_free (buffers);
+  buffers = NULL;
+  ASSERT_OBJECT_REFCOUNT (gdpdepay, "gdpdepay", 1);
+  cleanup_gdpdepay (gdpdepay);
+}
+
+GST_END_TEST;
+
+/* answers allocation queries asking for 16 bytes aligned memory */
+static gboolean
+sink_query_align (GstPad * pad, GstObject * parent, GstQuery * query)
+{
+  if (GST_QUERY_TYPE (query) == GST_QUERY_ALLOCATION) {
+    GstAllocationParams params;
+
+    gst_allocation_params_init (&params);
+    params.align = 15;
+    gst_query_add_allocation_param (query, NULL, &params);
+    return TRUE;
+  }
+
+  return gst_pad_query_default (pad, parent, query);
+}
+
+/* Returns the serialized stream-start, caps and segment followed by a
+ * buffer with @payload and @pts, in one block of @size bytes ending with
+ * the payload */
+static guint8 *
+create_gdp_stream (const guint8 * payload, gsize payload_size,
+    GstClockTime pts, gsize * size)
+{
+  GstCaps *caps;
+  GstBuffer *buffer, *data_buf;
+  GstEvent *event;
+  GstSegment segment;
+  guint8 *data;
+
+  event = gst_event_new_stream_start ("s-s-id-1234");
+  buffer = gst_dp_payload_event (event, 0);
+  gst_event_unref (event);
+
+  caps = gst_caps_from_string (AUDIO_CAPS_STRING);
+  buffer = gst_buffer_append (buffer, gst_dp_payload_caps (caps, 0));
+  gst_caps_unref (caps);
+
+  gst_segment_init (&segment, GST_FORMAT_TIME);
+  event = gst_event_new_segment (&segment);
+  buffer = gst_buffer_append (buffer, gst_dp_payload_event (event, 0));
+  gst_event_unref (event);
+
+  data_buf = gst_buffer_new_and_alloc (payload_size);
+  gst_buffer_fill (data_buf, 0, payload, payload_size);
+  GST_BUFFER_PTS (data_buf) = pts;
+  buffer = gst_buffer_append (buffer, gst_dp_payload_buffer (data_buf, 0));
+  gst_buffer_unref (data_buf);
+
+  *size = gst_buffer_get_size (buffer);
+  data = g_malloc (*size);
+  gst_buffer_extract (buffer, 0, data, *size);
+  gst_buffer_unref (buffer);
+
+  return data;
+}
+
+/* Wraps @stream in a buffer, placed so that its last @payload_size bytes
+ * start @misalign bytes after a 16 bytes boundary */
+static GstBuffer *
+wrap_stream_aligned (const guint8 * stream, gsize size, gsize payload_size,
+    guint misalign)
+{
+  guint8 *block;
+  gsize offset;
+
+  block = g_malloc (size + 16);
+  offset = (misalign - (guintptr) (block + size - payload_size)) & 15;
+  memcpy (block + offset, stream, size);
+
+  return gst_buffer_new_wrapped_full (0, block, size + 16, offset, size, block,
+      g_free);
+}
+
+static void
+check_payload_alignment (guint misalign, gboolean zero_copy)
+{
+  GstElement *gdpdepay;
+  GstCaps *caps;
+  GstBuffer *inbuffer, *outbuffer;
+  GstMapInfo inmap, outmap;
+  guint8 payload[64], *stream;
+  gsize size;
+  guint i;
+
+  for (i = 0; i < sizeof (payload); i++)
+    payload[i] = i;
+
+  gdpdepay = setup_gdpdepay ();
+  gst_pad_set_query_function (mysinkpad, sink_query_align);
+
+  fail_unless (gst_element_set_state (gdpdepay,
+          GST_STATE_PLAYING) == GST_STATE_CHANGE_SUCCESS,
+      "could not set to playing");
+
+  caps = gst_caps_new_empty_simple ("application/x-gdp");
+  gst_check_setup_events (mysrcpad, gdpdepay, caps, GST_FORMAT_BYTES);
+  gst_caps_unref (caps);
+
+  stream = create_gdp_stream (payload, sizeof (payload), GST_SECOND, &size);
+  inbuffer = wrap_stream_aligned (stream, size, sizeof (payload), misalign);
+  g_free (stream);
+
+  gst_buffer_map (inbuffer, &inmap, GST_MAP_READ);
+  fail_unless_equals_int (gst_pad_push (mysrcpad, gst_buffer_ref (inbuffer)),
+      GST_FLOW_OK);
+
+  fail_unless_equals_int (g_list_length (buffers), 1);
+  outbuffer = GST_BUFFER (buffers->data);
+  fail_unless_equals_uint64 (GST_BUFFER_PTS (outbuffer), GST_SECOND);
+  gst_buffer_map (outbuffer, &outmap, GST_MAP_READ);
+  fail_unless_equals_int (outmap.size, sizeof (payload));
+  fail_unless (memcmp (outmap.data, payload, sizeof (payload)) == 0);
+  if (zero_copy) {
+    fail_unless (outmap.data == inmap.data + inmap.size - sizeof (payload));
+  } else {
+    fail_unless (outmap.data < inmap.data
+        || outmap.data >= inmap.data + inmap.size);
+  }
+  fail_unless (((guintptr) outmap.data & 15) == 0);
+  gst_buffer_unmap (outbuffer, &outmap);
+
+  gst_buffer_unmap (inbuffer, &inmap);
+  gst_buffer_unref (inbuffer);
+
+  fail_unless (gst_element_set_state (gdpdepay,
+          GST_STATE_NULL) == GST_STATE_CHANGE_SUCCESS, "could not set to null");
+
+  g_list_foreach (buffers, (GFunc) gst_mini_object_unref, NULL);
+  g_list_free (buffers);
+  buffers = NULL;
+  ASSERT_OBJECT_REFCOUNT (gdpdepay, "gdpdepay", 1);
+  cleanup_gdpdepay (gdpdepay);
+}
+
+/* payloads at the alignment downstream asks for are still shared */
+GST_START_TEST (test_payload_aligned)
+{
+  check_payload_alignment (0, TRUE);
+}
+
+GST_END_TEST;
+
+/* others are copied into memory with the requested alignment */
+GST_START_TEST (test_payload_misaligned)
+{
+  check_payload_alignment (1, FALSE);
+  check_payload_alignment (8, FALSE);
+}
+
+GST_END_TEST;
+
+/* payloads split over several input buffers are put back together */
+GST_START_TEST (test_payload_spanning_buffers)
+{
+  GstElement *gdpdepay;
+  GstCaps *caps;
+  GstBuffer *outbuffer;
+  GstMapInfo outmap;
+  guint8 payload[64], *stream;
+  gsize size, offset, header_size;
+  guint i;
+
+  for (i = 0; i < sizeof (payload); i++)
+    payload[i] = 0xff - i;
+
+  gdpdepay = setup_gdpdepay ();
+
+  fail_unless (gst_element_set_state (gdpdepay,
+          GST_STATE_PLAYING) == GST_STATE_CHANGE_SUCCESS,
+      "could not set to playing");
+
+  caps = gst_caps_new_empty_simple ("application/x-gdp");
+  gst_check_setup_events (mysrcpad, gdpdepay, caps, GST_FORMAT_BYTES);
+  gst_caps_unref (caps);
+
+  stream = create_gdp_stream (payload, sizeof (payload), GST_SECOND, &size);
+
+  /* the headers with the first 10 bytes of the payload, then the payload in
+   * pieces of 20 bytes */
+  header_size = size - sizeof (payload);
+  for (offset = 0; offset < size;) {
+    gsize len = offset == 0 ? header_size + 10 : MIN (20, size - offset);
+    GstBuffer *inbuffer = gst_buffer_new_and_alloc (len);
+
+    gst_buffer_fill (inbuffer, 0, stream + offset, len);
+    fail_unless_equals_int (gst_pad_push (mysrcpad, inbuffer), GST_FLOW_OK);
+    offset += len;
+
+    /* nothing comes out before the last piece */
+    if (offset < size)
+      fail_unless_equals_int (g_list_length (buffers), 0);
+  }
+  g_free (stream);
+
+  fail_unless_equals_int (g_list_length (buffers), 1);
+  outbuffer = GST_BUFFER (buffers->data);
+  fail_unless_equals_uint64 (GST_BUFFER_PTS (outbuffer), GST_SECOND);
+  gst_buffer_map (outbuffer, &outmap, GST_MAP_READ);
+  fail_unless_equals_int (outmap.size, sizeof (payload));
+  fail_unless (memcmp (outmap.data, payload, sizeof (payload)) == 0);
+  gst_buffer_unmap (outbuffer, &outmap);
+
+  fail_unless (gst_element_set_state (gdpdepay,
+          GST_STATE_NULL) == GST_STATE_CHANGE_SUCCESS, "could not set to null");
+
+  g_list_foreach (buffers, (GFunc) gst_mini_object_unref, NULL);
+  g_list_free (buffers);
+  buffers = NULL;
+  ASSERT_OBJECT_REFCOUNT (gdpdepay, "gdpdepay", 1);
+  cleanup_gdpdepay (gdpdepay);
+}
+
+GST_END_TEST;
+
 static GstStaticPadTemplate shsinktemplate = GST_STATIC_PAD_TEMPLATE ("sink",
     GST_PAD_SINK,
     GST_PAD_ALWAYS,
@@ -409,6 +703,10 @@ gdpdepay_suite (void)
   suite_add_tcase (s, tc_chain);
   tcase_add_test (tc_chain, test_audio_per_byte);
   tcase_add_test (tc_chain, test_audio_in_one_buffer);
+  tcase_add_test (tc_chain, test_payload_zero_copy);
+  tcase_add_test (tc_chain, test_payload_aligned);
+  tcase_add_test (tc_chain, test_payload_misaligned);
+  tcase_add_test (tc_chain, test_payload_spanning_buffers);
   tcase_add_test (tc_chain, test_streamheader);
 
   return s;
@@ -555,6 +555,41 @@ GST_START_TEST (test_crc)
 
 GST_END_TEST;
 
+/* the table driven CRC processing 8 bytes at a time has to give the same
+ * results as processing one byte at a time */
+GST_START_TEST (test_crc_slices)
+{
+  guint8 data[256];
+  GstMapInfo maps[3];
+  guint i, length, split;
+
+  for (i = 0; i < sizeof (data); i++)
+    data[i] = g_random_int () & 0xff;
+
+  for (length = 1; length <= sizeof (data); length++) {
+    guint16 crc_register = CRC_INIT, crc;
+
+    for (i = 0; i < length; i++) {
+      crc_register = (guint16) ((crc_register << 8) ^
+          gst_dp_crc_table[((crc_register >> 8) & 0x00ff) ^ data[i]]);
+    }
+    crc = 0xffff ^ crc_register;
+
+    fail_unless_equals_int (gst_dp_crc (data, length), crc);
+
+    /* and when the data is split over several memories */
+    split = g_random_int_range (0, length + 1);
+    maps[0].data = data;
+    maps[0].size = split / 2;
+    maps[1].data = data + split / 2;
+    maps[1].size = split - split / 2;
+    maps[2].data = data + split;
+    maps[2].size = length - split;
+    fail_unless_equals_int (gst_dp_crc_from_memory_maps (maps, 3), crc);
+  }
+}
+
+GST_END_TEST;
 
 static Suite *
 gdppay_suite (void)
@@ -568,6 +603,7 @@ gdppay_suite (void)
   tcase_add_test (tc_chain, test_first_no_new_segment);
   tcase_add_test (tc_chain, test_streamheader);
   tcase_add_test (tc_chain, test_crc);
+  tcase_add_test (tc_chain, test_crc_slices);
 
   return s;
 }
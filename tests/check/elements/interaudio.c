@@ -0,0 +1,179 @@
+/* GStreamer unit test for interaudiosink/interaudiosrc
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#include <gst/check/gstcheck.h>
+
+static guint n_buffers, n_gap_buffers;
+
+static GstPadProbeReturn
+count_probe (GstPad * pad, GstPadProbeInfo * info, gpointer user_data)
+{
+  GstBuffer *buffer = GST_PAD_PROBE_INFO_BUFFER (info);
+
+  g_atomic_int_inc (&n_buffers);
+  if (GST_BUFFER_FLAG_IS_SET (buffer, GST_BUFFER_FLAG_GAP))
+    g_atomic_int_inc (&n_gap_buffers);
+
+  return GST_PAD_PROBE_OK;
+}
+
+static void
+run_pipelines (GstElement * src_pipeline, GstElement * sink_pipeline,
+    gboolean sink_first, GstClockTime duration)
+{
+  GstBus *src_bus, *sink_bus;
+  GstMessage *msg;
+  GstClockTime elapsed;
+
+  src_bus = gst_element_get_bus (src_pipeline);
+  sink_bus = gst_element_get_bus (sink_pipeline);
+
+  if (sink_first) {
+    /* let the sink negotiate and queue some samples before the source
+     * configures the surface */
+    fail_unless (gst_element_set_state (sink_pipeline, GST_STATE_PLAYING) !=
+        GST_STATE_CHANGE_FAILURE);
+    g_usleep (300 * G_USEC_PER_SEC / 1000);
+    fail_unless (gst_element_set_state (src_pipeline, GST_STATE_PLAYING) !=
+        GST_STATE_CHANGE_FAILURE);
+  } else {
+    fail_unless (gst_element_set_state (src_pipeline, GST_STATE_PLAYING) !=
+        GST_STATE_CHANGE_FAILURE);
+    fail_unless (gst_element_set_state (sink_pipeline, GST_STATE_PLAYING) !=
+        GST_STATE_CHANGE_FAILURE);
+  }
+
+  for (elapsed = 0; elapsed < duration; elapsed += 100 * GST_MSECOND) {
+    msg = gst_bus_timed_pop_filtered (src_bus, 50 * GST_MSECOND,
+        GST_MESSAGE_ERROR);
+    fail_unless (msg == NULL, "unexpected error on the source pipeline");
+    msg = gst_bus_timed_pop_filtered (sink_bus, 50 * GST_MSECOND,
+        GST_MESSAGE_ERROR);
+    fail_unless (msg == NULL, "unexpected error on the sink pipeline");
+  }
+
+  gst_element_set_state (sink_pipeline, GST_STATE_NULL);
+  gst_element_set_state (src_pipeline, GST_STATE_NULL);
+
+  gst_object_unref (src_bus);
+  gst_object_unref (sink_bus);
+}
+
+GST_START_TEST (test_small_periods)
+{
+  GstElement *src_pipeline, *sink_pipeline, *sink;
+  GstPad *pad;
+  guint n;
+
+  n_buffers = n_gap_buffers = 0;
+
+  src_pipeline =
+      gst_parse_launch ("interaudiosrc channel=stress period-time=1000000 "
+      "latency-time=5000000 buffer-time=50000000 ! "
+      "audio/x-raw,format=S16LE,rate=48000,channels=2 ! "
+      "fakesink name=sink sync=true", NULL);
+  fail_unless (src_pipeline != NULL);
+  sink_pipeline =
+      gst_parse_launch ("audiotestsrc is-live=true samplesperbuffer=48 ! "
+      "audio/x-raw,format=S16LE,rate=48000,channels=2 ! "
+      "interaudiosink channel=stress", NULL);
+  fail_unless (sink_pipeline != NULL);
+
+  sink = gst_bin_get_by_name (GST_BIN (src_pipeline), "sink");
+  pad = gst_element_get_static_pad (sink, "sink");
+  gst_pad_add_probe (pad, GST_PAD_PROBE_TYPE_BUFFER, count_probe, NULL, NULL);
+  gst_object_unref (pad);
+  gst_object_unref (sink);
+
+  run_pipelines (src_pipeline, sink_pipeline, FALSE, GST_SECOND);
+
+  /* about 1000 periods of 1ms each, most of them with real samples once the
+   * ring got filled up to the latency */
+  n = g_atomic_int_get (&n_buffers);
+  GST_INFO ("%u buffers, %u gaps", n, g_atomic_int_get (&n_gap_buffers));
+  fail_unless (n >= 500, "only %u buffers", n);
+  fail_unless (g_atomic_int_get (&n_gap_buffers) < n / 2);
+
+  gst_object_unref (src_pipeline);
+  gst_object_unref (sink_pipeline);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_sink_started_first)
+{
+  GstElement *src_pipeline, *sink_pipeline, *sink;
+  GstPad *pad;
+  guint n, n_gaps;
+
+  n_buffers = n_gap_buffers = 0;
+
+  /* the sink sizes the ring with the default buffer-time of one second, the
+   * source only allows 100ms and has to replace it when it starts */
+  src_pipeline =
+      gst_parse_launch ("interaudiosrc channel=late period-time=10000000 "
+      "latency-time=20000000 buffer-time=100000000 ! "
+      "audio/x-raw,format=S16LE,rate=48000,channels=2 ! "
+      "fakesink name=sink sync=true", NULL);
+  fail_unless (src_pipeline != NULL);
+  sink_pipeline =
+      gst_parse_launch ("audiotestsrc is-live=true samplesperbuffer=480 ! "
+      "audio/x-raw,format=S16LE,rate=48000,channels=2 ! "
+      "interaudiosink channel=late", NULL);
+  fail_unless (sink_pipeline != NULL);
+
+  sink = gst_bin_get_by_name (GST_BIN (src_pipeline), "sink");
+  pad = gst_element_get_static_pad (sink, "sink");
+  gst_pad_add_probe (pad, GST_PAD_PROBE_TYPE_BUFFER, count_probe, NULL, NULL);
+  gst_object_unref (pad);
+  gst_object_unref (sink);
+
+  run_pipelines (src_pipeline, sink_pipeline, TRUE, GST_SECOND);
+
+  /* about 100 periods of 10ms, with audio flowing after the first few */
+  n = g_atomic_int_get (&n_buffers);
+  n_gaps = g_atomic_int_get (&n_gap_buffers);
+  GST_INFO ("%u buffers, %u gaps", n, n_gaps);
+  fail_unless (n >= 50, "only %u buffers", n);
+  fail_unless (n_gaps < n / 2, "%u of %u buffers are gaps", n_gaps, n);
+
+  gst_object_unref (src_pipeline);
+  gst_object_unref (sink_pipeline);
+}
+
+GST_END_TEST;
+
+static Suite *
+interaudio_suite (void)
+{
+  Suite *s = suite_create ("interaudio");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_set_timeout (tc_chain, 30);
+  tcase_add_test (tc_chain, test_small_periods);
+  tcase_add_test (tc_chain, test_sink_started_first);
+
+  return s;
+}
+
+GST_CHECK_MAIN (interaudio);
@@ -0,0 +1,183 @@
+/* GStreamer unit test for intervideosink/intervideosrc
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#include <gst/check/gstcheck.h>
+
+static guint n_buffers;
+
+static GstPadProbeReturn
+count_probe (GstPad * pad, GstPadProbeInfo * info, gpointer user_data)
+{
+  g_atomic_int_inc (&n_buffers);
+
+  return GST_PAD_PROBE_OK;
+}
+
+/* Runs a producer at @producer_fps into a consumer at @consumer_fps for two
+ * seconds, both on the system clock, and returns the counters of the
+ * intervideosrc */
+static void
+run_pipelines (gint producer_fps, gint consumer_fps, guint max_frames,
+    guint64 * dropped, guint64 * duplicated)
+{
+  GstElement *src_pipeline, *sink_pipeline, *src, *sink;
+  GstClock *clock;
+  GstBus *src_bus, *sink_bus;
+  GstMessage *msg;
+  GstPad *pad;
+  gchar *desc;
+  guint i;
+
+  n_buffers = 0;
+
+  desc = g_strdup_printf ("videotestsrc is-live=true ! "
+      "video/x-raw,format=I420,width=64,height=48,framerate=%d/1 ! "
+      "intervideosink channel=rates max-frames=%u", producer_fps, max_frames);
+  sink_pipeline = gst_parse_launch (desc, NULL);
+  g_free (desc);
+  fail_unless (sink_pipeline != NULL);
+
+  desc = g_strdup_printf ("intervideosrc name=src channel=rates ! "
+      "video/x-raw,framerate=%d/1 ! fakesink name=sink sync=true",
+      consumer_fps);
+  src_pipeline = gst_parse_launch (desc, NULL);
+  g_free (desc);
+  fail_unless (src_pipeline != NULL);
+
+  /* the rendering times of the frames are compared across the pipelines */
+  clock = gst_system_clock_obtain ();
+  gst_pipeline_use_clock (GST_PIPELINE (sink_pipeline), clock);
+  gst_pipeline_use_clock (GST_PIPELINE (src_pipeline), clock);
+  gst_object_unref (clock);
+
+  sink = gst_bin_get_by_name (GST_BIN (src_pipeline), "sink");
+  pad = gst_element_get_static_pad (sink, "sink");
+  gst_pad_add_probe (pad, GST_PAD_PROBE_TYPE_BUFFER, count_probe, NULL, NULL);
+  gst_object_unref (pad);
+  gst_object_unref (sink);
+
+  src_bus = gst_element_get_bus (src_pipeline);
+  sink_bus = gst_element_get_bus (sink_pipeline);
+
+  fail_unless (gst_element_set_state (sink_pipeline, GST_STATE_PLAYING) !=
+      GST_STATE_CHANGE_FAILURE);
+  fail_unless (gst_element_set_state (src_pipeline, GST_STATE_PLAYING) !=
+      GST_STATE_CHANGE_FAILURE);
+
+  for (i = 0; i < 20; i++) {
+    msg = gst_bus_timed_pop_filtered (src_bus, 50 * GST_MSECOND,
+        GST_MESSAGE_ERROR);
+    fail_unless (msg == NULL, "unexpected error on the source pipeline");
+    msg = gst_bus_timed_pop_filtered (sink_bus, 50 * GST_MSECOND,
+        GST_MESSAGE_ERROR);
+    fail_unless (msg == NULL, "unexpected error on the sink pipeline");
+  }
+
+  src = gst_bin_get_by_name (GST_BIN (src_pipeline), "src");
+  g_object_get (src, "frames-dropped", dropped, "frames-duplicated",
+      duplicated, NULL);
+  gst_object_unref (src);
+
+  gst_element_set_state (src_pipeline, GST_STATE_NULL);
+  gst_element_set_state (sink_pipeline, GST_STATE_NULL);
+
+  GST_INFO ("%d fps into %d fps: %u frames, %" G_GUINT64_FORMAT " dropped, %"
+      G_GUINT64_FORMAT " duplicated", producer_fps, consumer_fps,
+      g_atomic_int_get (&n_buffers), *dropped, *duplicated);
+  fail_unless (g_atomic_int_get (&n_buffers) >= consumer_fps);
+
+  gst_object_unref (src_bus);
+  gst_object_unref (sink_bus);
+  gst_object_unref (src_pipeline);
+  gst_object_unref (sink_pipeline);
+}
+
+GST_START_TEST (test_same_rate)
+{
+  guint64 dropped, duplicated;
+
+  /* with a few frames queued, the jitter between the pipelines does not
+   * cost any frames */
+  run_pipelines (25, 25, 4, &dropped, &duplicated);
+  fail_unless (dropped <= 3, "%" G_GUINT64_FORMAT " frames dropped", dropped);
+  fail_unless (duplicated <= 3, "%" G_GUINT64_FORMAT " frames duplicated",
+      duplicated);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_faster_producer)
+{
+  guint64 dropped, duplicated;
+
+  /* every other frame of the producer is never output */
+  run_pipelines (50, 25, 4, &dropped, &duplicated);
+  fail_unless (dropped >= 30, "only %" G_GUINT64_FORMAT " frames dropped",
+      dropped);
+  fail_unless (duplicated <= 3, "%" G_GUINT64_FORMAT " frames duplicated",
+      duplicated);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_slower_producer)
+{
+  guint64 dropped, duplicated;
+
+  /* 15 of the 25 frames per second are repeats */
+  run_pipelines (10, 25, 4, &dropped, &duplicated);
+  fail_unless (duplicated >= 20, "only %" G_GUINT64_FORMAT
+      " frames duplicated", duplicated);
+  fail_unless (dropped <= 3, "%" G_GUINT64_FORMAT " frames dropped", dropped);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_single_frame)
+{
+  guint64 dropped, duplicated;
+
+  /* the default only keeps the last frame, which is still counted */
+  run_pipelines (50, 25, 1, &dropped, &duplicated);
+  fail_unless (dropped >= 30, "only %" G_GUINT64_FORMAT " frames dropped",
+      dropped);
+}
+
+GST_END_TEST;
+
+static Suite *
+intervideo_suite (void)
+{
+  Suite *s = suite_create ("intervideo");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_set_timeout (tc_chain, 30);
+  tcase_add_test (tc_chain, test_same_rate);
+  tcase_add_test (tc_chain, test_faster_producer);
+  tcase_add_test (tc_chain, test_slower_producer);
+  tcase_add_test (tc_chain, test_single_frame);
+
+  return s;
+}
+
+GST_CHECK_MAIN (intervideo);
@@ -1,5 +1,7 @@
 #include <gst/check/gstharness.h>
 #include <gst/check/gstcheck.h>
+#include <glib/gstdio.h>
+#include <unistd.h>
 
 GST_START_TEST (netsim_stress)
 {
@@ -49,6 +51,147 @@ GST_START_TEST (netsim_stress_delayed)
 
 GST_END_TEST;
 
+GST_START_TEST (netsim_delay_keeps_order)
+{
+  GstHarness *h = gst_harness_new_parse ("netsim delay-probability=1.0 "
+      "min-delay=5 max-delay=20 allow-reordering=false");
+  GstBuffer *buf;
+  guint i;
+
+  gst_harness_set_src_caps_str (h, "mycaps");
+
+  for (i = 0; i < 200; i++) {
+    buf = gst_harness_create_buffer (h, 100);
+    GST_BUFFER_OFFSET (buf) = i;
+    fail_unless_equals_int (gst_harness_push (h, buf), GST_FLOW_OK);
+  }
+
+  for (i = 0; i < 200; i++) {
+    buf = gst_harness_pull (h);
+    fail_unless (buf != NULL);
+    fail_unless_equals_uint64 (GST_BUFFER_OFFSET (buf), i);
+    gst_buffer_unref (buf);
+  }
+
+  gst_harness_teardown (h);
+}
+
+GST_END_TEST;
+
+static gchar *
+write_trace (const gchar * contents)
+{
+  gchar *filename;
+  gint fd;
+
+  fd = g_file_open_tmp ("netsim-trace-XXXXXX", &filename, NULL);
+  fail_unless (fd >= 0);
+  close (fd);
+  fail_unless (g_file_set_contents (filename, contents, -1, NULL));
+
+  return filename;
+}
+
+static GstHarness *
+harness_new_with_trace (const gchar * filename)
+{
+  GstHarness *h;
+  gchar *launch;
+
+  launch = g_strdup_printf ("netsim trace-file=\"%s\"", filename);
+  h = gst_harness_new_parse (launch);
+  g_free (launch);
+  gst_harness_set_src_caps_str (h, "mycaps");
+
+  return h;
+}
+
+static void
+push_mtu_buffers (GstHarness * h, guint n)
+{
+  while (n--)
+    fail_unless_equals_int (gst_harness_push (h,
+            gst_harness_create_buffer (h, 1500)), GST_FLOW_OK);
+}
+
+GST_START_TEST (netsim_trace_delivery_opportunities)
+{
+  gchar *filename = write_trace ("# opportunities at 10 and 20ms\n10\n20\n");
+  GstHarness *h = harness_new_with_trace (filename);
+
+  /* the bucket starts with room for one packet */
+  gst_harness_set_time (h, 0);
+  push_mtu_buffers (h, 2);
+  fail_unless_equals_int (gst_harness_buffers_received (h), 1);
+
+  gst_harness_set_time (h, 10 * GST_MSECOND);
+  push_mtu_buffers (h, 2);
+  fail_unless_equals_int (gst_harness_buffers_received (h), 2);
+
+  /* the trace loops, and unused opportunities are lost */
+  gst_harness_set_time (h, 45 * GST_MSECOND);
+  push_mtu_buffers (h, 2);
+  fail_unless_equals_int (gst_harness_buffers_received (h), 3);
+
+  gst_harness_set_time (h, 50 * GST_MSECOND);
+  push_mtu_buffers (h, 2);
+  fail_unless_equals_int (gst_harness_buffers_received (h), 4);
+
+  gst_harness_teardown (h);
+  g_unlink (filename);
+  g_free (filename);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (netsim_trace_kbps)
+{
+  /* 120 kbps let one 1500 byte packet through every 100ms */
+  gchar *filename = write_trace ("0 120 0 0.0\n1000 120 0 0.0\n");
+  GstHarness *h = harness_new_with_trace (filename);
+
+  gst_harness_set_time (h, 0);
+  push_mtu_buffers (h, 1);
+  fail_unless_equals_int (gst_harness_buffers_received (h), 0);
+
+  /* unlike for delivery opportunities, the bucket is not limited to one
+   * packet */
+  gst_harness_set_time (h, 500 * GST_MSECOND);
+  push_mtu_buffers (h, 6);
+  fail_unless_equals_int (gst_harness_buffers_received (h), 5);
+
+  gst_harness_teardown (h);
+  g_unlink (filename);
+  g_free (filename);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (netsim_trace_loss)
+{
+  gchar *filename = write_trace ("0 -1 0 0.0\n100 -1 0 1.0\n200 -1 0 0.0\n");
+  GstHarness *h = harness_new_with_trace (filename);
+
+  gst_harness_set_time (h, 0);
+  push_mtu_buffers (h, 10);
+  fail_unless_equals_int (gst_harness_buffers_received (h), 10);
+
+  gst_harness_set_time (h, 150 * GST_MSECOND);
+  push_mtu_buffers (h, 10);
+  fail_unless_equals_int (gst_harness_buffers_received (h), 10);
+
+  /* back at the start of the trace */
+  gst_harness_set_time (h, 250 * GST_MSECOND);
+  push_mtu_buffers (h, 10);
+  fail_unless_equals_int (gst_harness_buffers_received (h), 20);
+
+  gst_harness_teardown (h);
+  g_unlink (filename);
+  g_free (filename);
+}
+
+GST_END_TEST;
+
 static Suite *
 netsim_suite (void)
 {
@@ -58,6 +201,10 @@ netsim_suite (void)
   suite_add_tcase (s, (tc_chain = tcase_create ("general")));
   tcase_add_test (tc_chain, netsim_stress);
   tcase_add_test (tc_chain, netsim_stress_delayed);
+  tcase_add_test (tc_chain, netsim_delay_keeps_order);
+  tcase_add_test (tc_chain, netsim_trace_delivery_opportunities);
+  tcase_add_test (tc_chain, netsim_trace_kbps);
+  tcase_add_test (tc_chain, netsim_trace_loss);
 
   return s;
 }
@@ -1,6 +1,8 @@
 #include "parser.h"
 #include <gst/check/gstcheck.h>
 #include <gst/check/gstharness.h>
+#include <glib/gstdio.h>
+#include <unistd.h>
 
 static GstStaticPadTemplate srctemplate = GST_STATIC_PAD_TEMPLATE ("src",
     GST_PAD_SRC,
@@ -115,6 +117,273 @@ GST_START_TEST (test_parse_zerosize_frames)
 
 GST_END_TEST;
 
+/* the frame of zerosize_data, 127.0.0.1:53923 -> 127.0.0.1:5004 */
+#define ZEROSIZE_FRAME_OFFSET 40
+
+static GstBuffer *
+create_zerosize_buffer (void)
+{
+  return gst_buffer_new_wrapped (g_memdup (zerosize_data,
+          sizeof (zerosize_data)), sizeof (zerosize_data));
+}
+
+static guint
+count_output (const gchar * filter, const gchar * pad_filter)
+{
+  GstHarness *h, *h2 = NULL;
+  GstElement *element;
+  guint n;
+
+  h = gst_harness_new ("pcapparse");
+  if (filter)
+    gst_util_set_object_arg (G_OBJECT (h->element), "filter", filter);
+  if (pad_filter) {
+    GstPad *pad;
+
+    element = gst_object_ref (h->element);
+    h2 = gst_harness_new_with_element (element, NULL, "src_%u");
+    gst_object_unref (element);
+    pad = gst_pad_get_peer (h2->sinkpad);
+    g_object_set (pad, "filter", pad_filter, NULL);
+    gst_object_unref (pad);
+  }
+
+  gst_harness_set_src_caps_str (h, "raw/x-pcap");
+  fail_unless_equals_int (gst_harness_push (h, create_zerosize_buffer ()),
+      GST_FLOW_OK);
+
+  if (h2) {
+    n = gst_harness_buffers_received (h2);
+    fail_unless_equals_int (gst_harness_buffers_received (h), 0);
+    gst_harness_teardown (h2);
+  } else {
+    n = gst_harness_buffers_received (h);
+  }
+  gst_harness_teardown (h);
+
+  return n;
+}
+
+GST_START_TEST (test_parse_filter)
+{
+  fail_unless_equals_int (count_output ("udp and dst port 5004", NULL), 1);
+  fail_unless_equals_int (count_output ("tcp or dst port 5005", NULL), 0);
+  fail_unless_equals_int (count_output (
+          "src net 127.0.0.0/8 and not (port 1 or port 2)", NULL), 1);
+  fail_unless_equals_int (count_output ("dst host 127.0.0.2", NULL), 0);
+  /* invalid filters are ignored */
+  fail_unless_equals_int (count_output ("dst port", NULL), 1);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_parse_request_pads)
+{
+  fail_unless_equals_int (count_output ("dst port 1", "dst port 5004"),
+      1);
+  fail_unless_equals_int (count_output ("dst port 1", "dst port 5005"),
+      0);
+}
+
+GST_END_TEST;
+
+static void
+append_uint32_le (GByteArray * array, guint32 val)
+{
+  guint8 data[4];
+
+  GST_WRITE_UINT32_LE (data, val);
+  g_byte_array_append (array, data, 4);
+}
+
+GST_START_TEST (test_parse_pcapng)
+{
+  static const guint8 zero[4] = { 0, };
+  const guint frame_size = sizeof (zerosize_data) - ZEROSIZE_FRAME_OFFSET;
+  GByteArray *data = g_byte_array_new ();
+  GstBuffer *out_buf;
+  GstHarness *h;
+
+  /* section header: byte order, version 1.0, unknown section length */
+  append_uint32_le (data, 0x0a0d0d0a);
+  append_uint32_le (data, 28);
+  append_uint32_le (data, 0x1a2b3c4d);
+  append_uint32_le (data, 0x00000001);
+  append_uint32_le (data, 0xffffffff);
+  append_uint32_le (data, 0xffffffff);
+  append_uint32_le (data, 28);
+
+  /* interface description: ethernet, microsecond timestamps */
+  append_uint32_le (data, 0x00000001);
+  append_uint32_le (data, 20);
+  append_uint32_le (data, 0x00000001);
+  append_uint32_le (data, 0x0000ffff);
+  append_uint32_le (data, 20);
+
+  /* an unknown block to skip */
+  append_uint32_le (data, 0x00000bad);
+  append_uint32_le (data, 16);
+  append_uint32_le (data, 0);
+  append_uint32_le (data, 16);
+
+  /* enhanced packet at 1s */
+  append_uint32_le (data, 0x00000006);
+  append_uint32_le (data, 28 + GST_ROUND_UP_4 (frame_size) + 4);
+  append_uint32_le (data, 0);
+  append_uint32_le (data, 0);
+  append_uint32_le (data, 1000000);
+  append_uint32_le (data, frame_size);
+  append_uint32_le (data, frame_size);
+  g_byte_array_append (data, zerosize_data + ZEROSIZE_FRAME_OFFSET,
+      frame_size);
+  g_byte_array_append (data, zero, GST_ROUND_UP_4 (frame_size) - frame_size);
+  append_uint32_le (data, 28 + GST_ROUND_UP_4 (frame_size) + 4);
+
+  h = gst_harness_new ("pcapparse");
+  gst_harness_set_src_caps_str (h, "raw/x-pcap");
+
+  /* split the data to parse blocks across buffers */
+  gst_harness_push (h, gst_buffer_new_wrapped (g_memdup (data->data, 30), 30));
+  gst_harness_push (h, gst_buffer_new_wrapped (g_memdup (data->data + 30,
+              data->len - 30), data->len - 30));
+
+  out_buf = gst_harness_pull (h);
+  fail_unless_equals_int (gst_buffer_get_size (out_buf), 0);
+  fail_unless_equals_uint64 (GST_BUFFER_PTS (out_buf), GST_SECOND);
+  gst_buffer_unref (out_buf);
+
+  gst_harness_teardown (h);
+  g_byte_array_unref (data);
+}
+
+GST_END_TEST;
+
+static GstPadProbeReturn
+count_buffers_probe (GstPad * pad, GstPadProbeInfo * info, gpointer user_data)
+{
+  guint *count = user_data;
+
+  if (GST_PAD_PROBE_INFO_TYPE (info) & GST_PAD_PROBE_TYPE_BUFFER_LIST)
+    *count += gst_buffer_list_length (GST_PAD_PROBE_INFO_BUFFER_LIST (info));
+  else
+    *count += 1;
+
+  return GST_PAD_PROBE_OK;
+}
+
+/* Parses @data from a file, read in pull mode, and returns the number of
+ * buffers output */
+static guint
+count_pull_mode_output (GByteArray * data)
+{
+  GstElement *pipeline, *sink;
+  GstMessage *msg;
+  gchar *filename, *launch;
+  GstPad *pad;
+  guint count = 0;
+  gint fd;
+
+  fd = g_file_open_tmp ("pcapparse-XXXXXX.pcap", &filename, NULL);
+  fail_unless (fd >= 0);
+  close (fd);
+  fail_unless (g_file_set_contents (filename, (const gchar *) data->data,
+          data->len, NULL));
+
+  launch = g_strdup_printf ("filesrc location=\"%s\" ! pcapparse ! "
+      "fakesink name=sink", filename);
+  pipeline = gst_parse_launch (launch, NULL);
+  g_free (launch);
+  fail_unless (pipeline != NULL);
+
+  sink = gst_bin_get_by_name (GST_BIN (pipeline), "sink");
+  pad = gst_element_get_static_pad (sink, "sink");
+  gst_pad_add_probe (pad,
+      GST_PAD_PROBE_TYPE_BUFFER | GST_PAD_PROBE_TYPE_BUFFER_LIST,
+      count_buffers_probe, &count, NULL);
+  gst_object_unref (pad);
+  gst_object_unref (sink);
+
+  fail_unless (gst_element_set_state (pipeline, GST_STATE_PLAYING) !=
+      GST_STATE_CHANGE_FAILURE);
+  msg = gst_bus_timed_pop_filtered (GST_ELEMENT_BUS (pipeline),
+      10 * GST_SECOND, GST_MESSAGE_EOS | GST_MESSAGE_ERROR);
+  fail_unless (msg != NULL);
+  fail_unless_equals_int (GST_MESSAGE_TYPE (msg), GST_MESSAGE_EOS);
+  gst_message_unref (msg);
+
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+
+  gst_object_unref (pipeline);
+  g_unlink (filename);
+  g_free (filename);
+
+  return count;
+}
+
+GST_START_TEST (test_parse_pull_mode)
+{
+  const guint n_frames = 10000;
+  const guint frame_size = sizeof (zerosize_data) - 24;
+  GByteArray *data;
+  guint i;
+
+  data = g_byte_array_new ();
+  g_byte_array_append (data, zerosize_data, 24);
+  for (i = 0; i < n_frames; i++)
+    g_byte_array_append (data, zerosize_data + 24, frame_size);
+
+  fail_unless_equals_int (count_pull_mode_output (data), n_frames);
+  g_byte_array_unref (data);
+}
+
+GST_END_TEST;
+
+/* 127.0.0.1:5004 -> 127.0.0.1:5005 TCP frame with 10 bytes of payload
+ * captured, while the IP header claims 960 bytes of it */
+static const guint8 truncated_tcp_frame[] = {
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x40, 0x00, 0x00, 0x00, 0xf6, 0x03, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x08, 0x00, 0x45, 0x00,
+  0x03, 0xe8, 0x00, 0x00, 0x40, 0x00, 0x40, 0x06,
+  0x00, 0x00, 0x7f, 0x00, 0x00, 0x01, 0x7f, 0x00,
+  0x00, 0x01, 0x13, 0x8c, 0x13, 0x8d, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x50, 0x18,
+  0xff, 0xff, 0x00, 0x00, 0x00, 0x00, 0xaa, 0xaa,
+  0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa
+};
+
+GST_START_TEST (test_parse_truncated_tcp)
+{
+  /* pcapparse pulls 4 MiB at once */
+  const guint pull_size = 4 * 1024 * 1024;
+  const guint frame_size = sizeof (zerosize_data) - 24;
+  guint n_before, n_after = 100;
+  GByteArray *data;
+  guint i;
+
+  /* put the TCP frame at the end of the first chunk, so that the payload
+   * it claims reaches into the next one */
+  n_before = (pull_size - 24 - sizeof (truncated_tcp_frame)) / frame_size;
+
+  data = g_byte_array_new ();
+  g_byte_array_append (data, zerosize_data, 24);
+  for (i = 0; i < n_before; i++)
+    g_byte_array_append (data, zerosize_data + 24, frame_size);
+  g_byte_array_append (data, truncated_tcp_frame,
+      sizeof (truncated_tcp_frame));
+  fail_unless (data->len <= pull_size);
+  fail_unless (data->len + 960 > pull_size);
+  for (i = 0; i < n_after; i++)
+    g_byte_array_append (data, zerosize_data + 24, frame_size);
+
+  /* only the TCP frame is dropped */
+  fail_unless_equals_int (count_pull_mode_output (data), n_before + n_after);
+  g_byte_array_unref (data);
+}
+
+GST_END_TEST;
+
 static Suite *
 pcapparse_suite (void)
 {
@@ -133,6 +402,11 @@ pcapparse_suite (void)
   suite_add_tcase (s, tc_chain);
   tcase_add_test (tc_chain, test_parse_frames_with_eth_padding);
   tcase_add_test (tc_chain, test_parse_zerosize_frames);
+  tcase_add_test (tc_chain, test_parse_filter);
+  tcase_add_test (tc_chain, test_parse_request_pads);
+  tcase_add_test (tc_chain, test_parse_pcapng);
+  tcase_add_test (tc_chain, test_parse_pull_mode);
+  tcase_add_test (tc_chain, test_parse_truncated_tcp);
 
   return s;
 }
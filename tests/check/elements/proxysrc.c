@@ -0,0 +1,393 @@
+/* GStreamer unit test for proxysrc in ring mode
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#include <gst/check/gstcheck.h>
+
+static GstStaticPadTemplate srctemplate = GST_STATIC_PAD_TEMPLATE ("src",
+    GST_PAD_SRC, GST_PAD_ALWAYS, GST_STATIC_CAPS_ANY);
+static GstStaticPadTemplate sinktemplate = GST_STATIC_PAD_TEMPLATE ("sink",
+    GST_PAD_SINK, GST_PAD_ALWAYS, GST_STATIC_CAPS_ANY);
+
+static GstElement *proxysink, *proxysrc;
+static GstPad *mysrcpad, *mysinkpad;
+
+/* protect everything below */
+static GMutex test_lock;
+static GCond test_cond;
+/* while set, the streaming thread of proxysrc blocks in our chain function */
+static gboolean gate_closed;
+static gboolean in_chain;
+/* PTS, in units of 10ms, of the buffers received downstream */
+static GArray *received;
+static guint received_at_drain;
+
+static GstFlowReturn
+sink_chain (GstPad * pad, GstObject * parent, GstBuffer * buffer)
+{
+  guint n = GST_BUFFER_PTS (buffer) / (10 * GST_MSECOND);
+
+  g_mutex_lock (&test_lock);
+  g_array_append_val (received, n);
+  in_chain = TRUE;
+  g_cond_broadcast (&test_cond);
+  while (gate_closed)
+    g_cond_wait (&test_cond, &test_lock);
+  in_chain = FALSE;
+  g_mutex_unlock (&test_lock);
+
+  gst_buffer_unref (buffer);
+
+  return GST_FLOW_OK;
+}
+
+static gboolean
+sink_query (GstPad * pad, GstObject * parent, GstQuery * query)
+{
+  if (GST_QUERY_TYPE (query) == GST_QUERY_DRAIN) {
+    g_mutex_lock (&test_lock);
+    received_at_drain = received->len;
+    g_mutex_unlock (&test_lock);
+    return TRUE;
+  }
+
+  return gst_pad_query_default (pad, parent, query);
+}
+
+static gboolean
+src_query (GstPad * pad, GstObject * parent, GstQuery * query)
+{
+  if (GST_QUERY_TYPE (query) == GST_QUERY_LATENCY) {
+    gst_query_set_latency (query, TRUE, 5 * GST_MSECOND, 100 * GST_MSECOND);
+    return TRUE;
+  }
+
+  return gst_pad_query_default (pad, parent, query);
+}
+
+static void
+setup_ring (const gchar * leaky, guint ring_size)
+{
+  GstPad *pad;
+  GstSegment segment;
+
+  received = g_array_new (FALSE, FALSE, sizeof (guint));
+  received_at_drain = 0;
+  gate_closed = FALSE;
+  in_chain = FALSE;
+
+  proxysink = gst_check_setup_element ("proxysink");
+  proxysrc = gst_check_setup_element ("proxysrc");
+  g_object_set (proxysrc, "proxysink", proxysink, "ring-size", ring_size,
+      NULL);
+  gst_util_set_object_arg (G_OBJECT (proxysrc), "mode", "ring");
+  gst_util_set_object_arg (G_OBJECT (proxysrc), "leaky", leaky);
+
+  mysrcpad = gst_pad_new_from_static_template (&srctemplate, "src");
+  gst_pad_set_query_function (mysrcpad, src_query);
+  pad = gst_element_get_static_pad (proxysink, "sink");
+  fail_unless_equals_int (gst_pad_link (mysrcpad, pad), GST_PAD_LINK_OK);
+  gst_object_unref (pad);
+
+  mysinkpad = gst_pad_new_from_static_template (&sinktemplate, "sink");
+  gst_pad_set_chain_function (mysinkpad, sink_chain);
+  gst_pad_set_query_function (mysinkpad, sink_query);
+  pad = gst_element_get_static_pad (proxysrc, "src");
+  fail_unless_equals_int (gst_pad_link (pad, mysinkpad), GST_PAD_LINK_OK);
+  gst_object_unref (pad);
+
+  gst_pad_set_active (mysrcpad, TRUE);
+  gst_pad_set_active (mysinkpad, TRUE);
+  fail_unless (gst_element_set_state (proxysrc, GST_STATE_PLAYING) !=
+      GST_STATE_CHANGE_FAILURE);
+  fail_unless (gst_element_set_state (proxysink, GST_STATE_PLAYING) !=
+      GST_STATE_CHANGE_FAILURE);
+
+  gst_pad_push_event (mysrcpad, gst_event_new_stream_start ("test"));
+  gst_segment_init (&segment, GST_FORMAT_TIME);
+  gst_pad_push_event (mysrcpad, gst_event_new_segment (&segment));
+}
+
+static void
+cleanup_ring (void)
+{
+  g_mutex_lock (&test_lock);
+  gate_closed = FALSE;
+  g_cond_broadcast (&test_cond);
+  g_mutex_unlock (&test_lock);
+
+  gst_element_set_state (proxysink, GST_STATE_NULL);
+  gst_element_set_state (proxysrc, GST_STATE_NULL);
+
+  gst_pad_set_active (mysrcpad, FALSE);
+  gst_pad_set_active (mysinkpad, FALSE);
+  gst_object_unref (mysrcpad);
+  gst_object_unref (mysinkpad);
+  gst_check_teardown_element (proxysrc);
+  gst_check_teardown_element (proxysink);
+
+  g_array_free (received, TRUE);
+}
+
+static void
+push_buffer (guint n)
+{
+  GstBuffer *buffer = gst_buffer_new ();
+
+  GST_BUFFER_PTS (buffer) = n * 10 * GST_MSECOND;
+  GST_BUFFER_DURATION (buffer) = 10 * GST_MSECOND;
+  fail_unless_equals_int (gst_pad_push (mysrcpad, buffer), GST_FLOW_OK);
+}
+
+static void
+close_gate (void)
+{
+  g_mutex_lock (&test_lock);
+  gate_closed = TRUE;
+  g_mutex_unlock (&test_lock);
+}
+
+static void
+open_gate (void)
+{
+  g_mutex_lock (&test_lock);
+  gate_closed = FALSE;
+  g_cond_broadcast (&test_cond);
+  g_mutex_unlock (&test_lock);
+}
+
+static void
+wait_in_chain (void)
+{
+  g_mutex_lock (&test_lock);
+  while (!in_chain)
+    g_cond_wait (&test_cond, &test_lock);
+  g_mutex_unlock (&test_lock);
+}
+
+static void
+wait_received (guint n)
+{
+  g_mutex_lock (&test_lock);
+  while (received->len < n)
+    g_cond_wait (&test_cond, &test_lock);
+  g_mutex_unlock (&test_lock);
+}
+
+static void
+check_received (const guint * expected, guint n)
+{
+  guint i;
+
+  wait_received (n);
+
+  g_mutex_lock (&test_lock);
+  fail_unless_equals_int (received->len, n);
+  for (i = 0; i < n; i++)
+    fail_unless_equals_int (g_array_index (received, guint, i), expected[i]);
+  g_mutex_unlock (&test_lock);
+}
+
+GST_START_TEST (test_ring_passthrough)
+{
+  GstQuery *query;
+  guint i;
+
+  setup_ring ("no", 4);
+
+  for (i = 0; i < 20; i++)
+    push_buffer (i);
+
+  /* the drain query is only answered once everything before it went out */
+  query = gst_query_new_drain ();
+  fail_unless (gst_pad_peer_query (mysrcpad, query));
+  gst_query_unref (query);
+
+  g_mutex_lock (&test_lock);
+  fail_unless_equals_int (received_at_drain, 20);
+  fail_unless_equals_int (received->len, 20);
+  for (i = 0; i < 20; i++)
+    fail_unless_equals_int (g_array_index (received, guint, i), i);
+  g_mutex_unlock (&test_lock);
+
+  cleanup_ring ();
+}
+
+GST_END_TEST;
+
+static void
+run_leaky (const gchar * leaky, const guint * expected)
+{
+  guint i;
+
+  setup_ring (leaky, 4);
+
+  /* hold buffer 0 downstream, then overfill the ring of 4 */
+  close_gate ();
+  push_buffer (0);
+  wait_in_chain ();
+  for (i = 1; i <= 10; i++)
+    push_buffer (i);
+  open_gate ();
+
+  /* everything left in the ring goes out before the next buffer */
+  wait_received (5);
+  push_buffer (11);
+
+  check_received (expected, 6);
+
+  cleanup_ring ();
+}
+
+GST_START_TEST (test_ring_leaky_upstream)
+{
+  static const guint expected[] = { 0, 1, 2, 3, 4, 11 };
+
+  run_leaky ("upstream", expected);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_ring_leaky_downstream)
+{
+  static const guint expected[] = { 0, 7, 8, 9, 10, 11 };
+
+  run_leaky ("downstream", expected);
+}
+
+GST_END_TEST;
+
+static gpointer
+drain_thread (gpointer user_data)
+{
+  GstQuery *query = gst_query_new_drain ();
+  gboolean res;
+
+  res = gst_pad_peer_query (mysrcpad, query);
+  /* the query is gone now, proxysrc must not touch it anymore */
+  gst_query_unref (query);
+
+  return GINT_TO_POINTER (res);
+}
+
+static gpointer
+flush_start_thread (gpointer user_data)
+{
+  /* returns only once the streaming thread is out of our chain function */
+  gst_pad_push_event (mysrcpad, gst_event_new_flush_start ());
+
+  return NULL;
+}
+
+GST_START_TEST (test_ring_flush_serialized_query)
+{
+  static const guint expected[] = { 0, 2 };
+  GThread *query_thread, *flush_thread;
+  GstSegment segment;
+  GstQuery *query;
+
+  setup_ring ("no", 4);
+
+  /* the drain query waits in the ring behind buffer 1 */
+  close_gate ();
+  push_buffer (0);
+  wait_in_chain ();
+  push_buffer (1);
+  query_thread = g_thread_new ("drain", drain_thread, NULL);
+  g_usleep (G_USEC_PER_SEC / 20);
+
+  /* flushing gives up on the query while it is still in the ring */
+  flush_thread = g_thread_new ("flush", flush_start_thread, NULL);
+  fail_if (GPOINTER_TO_INT (g_thread_join (query_thread)));
+
+  open_gate ();
+  g_thread_join (flush_thread);
+
+  gst_pad_push_event (mysrcpad, gst_event_new_flush_stop (TRUE));
+  gst_segment_init (&segment, GST_FORMAT_TIME);
+  gst_pad_push_event (mysrcpad, gst_event_new_segment (&segment));
+  push_buffer (2);
+
+  query = gst_query_new_drain ();
+  fail_unless (gst_pad_peer_query (mysrcpad, query));
+  gst_query_unref (query);
+
+  check_received (expected, G_N_ELEMENTS (expected));
+  fail_unless_equals_int (received_at_drain, 2);
+
+  cleanup_ring ();
+}
+
+GST_END_TEST;
+
+static void
+check_latency (const gchar * leaky, GstClockTime expected_max)
+{
+  GstQuery *query;
+  GstClockTime min, max;
+  gboolean live;
+  guint i;
+
+  setup_ring (leaky, 4);
+
+  for (i = 0; i < 8; i++)
+    push_buffer (i);
+  wait_received (8);
+
+  query = gst_query_new_latency ();
+  fail_unless (gst_pad_peer_query (mysinkpad, query));
+  gst_query_parse_latency (query, &live, &min, &max);
+  gst_query_unref (query);
+
+  fail_unless (live);
+  fail_unless_equals_uint64 (min, 5 * GST_MSECOND);
+  fail_unless_equals_uint64 (max, expected_max);
+
+  cleanup_ring ();
+}
+
+GST_START_TEST (test_ring_latency)
+{
+  /* 4 buffers of 10ms can wait in the ring */
+  check_latency ("no", 140 * GST_MSECOND);
+  /* when leaking, nothing waits longer than the ring holds */
+  check_latency ("downstream", 40 * GST_MSECOND);
+}
+
+GST_END_TEST;
+
+static Suite *
+proxysrc_suite (void)
+{
+  Suite *s = suite_create ("proxysrc");
+  TCase *tc_chain = tcase_create ("ring");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_ring_passthrough);
+  tcase_add_test (tc_chain, test_ring_leaky_upstream);
+  tcase_add_test (tc_chain, test_ring_leaky_downstream);
+  tcase_add_test (tc_chain, test_ring_flush_serialized_query);
+  tcase_add_test (tc_chain, test_ring_latency);
+
+  return s;
+}
+
+GST_CHECK_MAIN (proxysrc);
@@ -0,0 +1,167 @@
+/* GStreamer unit test for sctpenc/sctpdec
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#include <gst/check/gstcheck.h>
+
+#define SEND_BUFFER_SIZE 8192
+#define MESSAGE_SIZE 1024
+#define N_MESSAGES 200
+
+static GMutex lock;
+static GCond cond;
+static gboolean established;
+static guint n_received;
+
+static void
+on_association_established (GstElement * enc, gboolean is_established,
+    gpointer user_data)
+{
+  g_mutex_lock (&lock);
+  established = is_established;
+  g_cond_signal (&cond);
+  g_mutex_unlock (&lock);
+}
+
+static GstPadProbeReturn
+count_probe (GstPad * pad, GstPadProbeInfo * info, gpointer user_data)
+{
+  guint n = 1;
+
+  if (GST_PAD_PROBE_INFO_TYPE (info) & GST_PAD_PROBE_TYPE_BUFFER_LIST)
+    n = gst_buffer_list_length (GST_PAD_PROBE_INFO_BUFFER_LIST (info));
+
+  g_mutex_lock (&lock);
+  n_received += n;
+  g_cond_signal (&cond);
+  g_mutex_unlock (&lock);
+
+  return GST_PAD_PROBE_OK;
+}
+
+static void
+on_pad_added (GstElement * dec, GstPad * pad, GstBin * pipeline)
+{
+  GstElement *sink;
+  GstPad *sinkpad;
+
+  sink = gst_element_factory_make ("fakesink", NULL);
+  g_object_set (sink, "async", FALSE, NULL);
+  gst_bin_add (pipeline, sink);
+
+  sinkpad = gst_element_get_static_pad (sink, "sink");
+  gst_pad_add_probe (sinkpad,
+      GST_PAD_PROBE_TYPE_BUFFER | GST_PAD_PROBE_TYPE_BUFFER_LIST, count_probe,
+      NULL, NULL);
+  fail_unless_equals_int (gst_pad_link (pad, sinkpad), GST_PAD_LINK_OK);
+  gst_object_unref (sinkpad);
+
+  gst_element_sync_state_with_parent (sink);
+}
+
+GST_START_TEST (test_send_buffer_full)
+{
+  GstElement *pipeline, *enc, *dec;
+  GstPad *srcpad, *sinkpad;
+  GstSegment segment;
+  gint64 end_time;
+  guint i;
+
+  established = FALSE;
+  n_received = 0;
+
+  /* Two associations talking to each other, the second one only carries
+   * the acknowledgements back to the first one */
+  pipeline = gst_parse_launch ("sctpenc name=enc sctp-association-id=1 "
+      "send-buffer-size=" G_STRINGIFY (SEND_BUFFER_SIZE) " ! "
+      "sctpdec name=dec sctp-association-id=2 "
+      "sctpenc sctp-association-id=2 ! sctpdec sctp-association-id=1", NULL);
+  fail_unless (pipeline != NULL);
+
+  enc = gst_bin_get_by_name (GST_BIN (pipeline), "enc");
+  dec = gst_bin_get_by_name (GST_BIN (pipeline), "dec");
+  g_signal_connect (enc, "sctp-association-established",
+      G_CALLBACK (on_association_established), NULL);
+  g_signal_connect (dec, "pad-added", G_CALLBACK (on_pad_added), pipeline);
+
+  fail_unless (gst_element_set_state (pipeline, GST_STATE_PLAYING) !=
+      GST_STATE_CHANGE_FAILURE);
+
+  end_time = g_get_monotonic_time () + 5 * G_TIME_SPAN_SECOND;
+  g_mutex_lock (&lock);
+  while (!established && g_cond_wait_until (&cond, &lock, end_time));
+  fail_unless (established, "association not established");
+  g_mutex_unlock (&lock);
+
+  sinkpad = gst_element_get_request_pad (enc, "sink_0");
+  fail_unless (sinkpad != NULL);
+  srcpad = gst_pad_new ("src", GST_PAD_SRC);
+  gst_pad_set_active (srcpad, TRUE);
+  fail_unless_equals_int (gst_pad_link (srcpad, sinkpad), GST_PAD_LINK_OK);
+
+  gst_segment_init (&segment, GST_FORMAT_BYTES);
+  fail_unless (gst_pad_push_event (srcpad,
+          gst_event_new_stream_start ("sctp")));
+  fail_unless (gst_pad_push_event (srcpad, gst_event_new_segment (&segment)));
+
+  /* Many times the send buffer, so the pad blocks on a full send buffer
+   * and has to be woken up by the association to resend the rest */
+  for (i = 0; i < N_MESSAGES; i++) {
+    GstBuffer *buf = gst_buffer_new_allocate (NULL, MESSAGE_SIZE, NULL);
+
+    gst_buffer_memset (buf, 0, i, MESSAGE_SIZE);
+    fail_unless_equals_int (gst_pad_push (srcpad, buf), GST_FLOW_OK);
+  }
+
+  end_time = g_get_monotonic_time () + 10 * G_TIME_SPAN_SECOND;
+  g_mutex_lock (&lock);
+  while (n_received < N_MESSAGES
+      && g_cond_wait_until (&cond, &lock, end_time));
+  fail_unless_equals_int (n_received, N_MESSAGES);
+  g_mutex_unlock (&lock);
+
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+
+  gst_pad_unlink (srcpad, sinkpad);
+  gst_element_release_request_pad (enc, sinkpad);
+  gst_object_unref (sinkpad);
+  gst_object_unref (srcpad);
+  gst_object_unref (dec);
+  gst_object_unref (enc);
+  gst_object_unref (pipeline);
+}
+
+GST_END_TEST;
+
+static Suite *
+sctp_suite (void)
+{
+  Suite *s = suite_create ("sctp");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_set_timeout (tc_chain, 30);
+  tcase_add_test (tc_chain, test_send_buffer_full);
+
+  return s;
+}
+
+GST_CHECK_MAIN (sctp);
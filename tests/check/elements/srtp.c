@@ -31,6 +31,15 @@
 
 #include <gst/check/gstharness.h>
 
+#ifdef HAVE_SRTP2
+# include <srtp2/srtp.h>
+#else
+# include <srtp/srtp.h>
+#endif
+
+/* room srtpenc asks to be left after the payload, as in gstsrtpenc.c */
+#define SRTP_TRAILER_ROOM (SRTP_MAX_TRAILER_LEN + 10)
+
 GST_START_TEST (test_create_and_unref)
 {
   GstElement *e;
@@ -207,6 +216,145 @@ GST_START_TEST (test_roc)
 
 GST_END_TEST;
 
+static GstBuffer *
+create_rtp_packet (guint16 seqnum, gsize padding)
+{
+  GstAllocationParams params;
+  GstBuffer *buf;
+  GstMapInfo map;
+
+  gst_allocation_params_init (&params);
+  params.padding = padding;
+  buf = gst_buffer_new_allocate (NULL, 172, &params);
+
+  gst_buffer_map (buf, &map, GST_MAP_WRITE);
+  memset (map.data, 0, map.size);
+  map.data[0] = 0x80;
+  map.data[1] = 8;
+  GST_WRITE_UINT16_BE (map.data + 2, seqnum);
+  GST_WRITE_UINT32_BE (map.data + 4, seqnum * 160);
+  GST_WRITE_UINT32_BE (map.data + 8, 1356955624);
+  gst_buffer_unmap (buf, &map);
+
+  return buf;
+}
+
+GST_START_TEST (test_srtpenc_in_place)
+{
+  GstHarness *h;
+  GstBuffer *buf, *outbuf;
+  GstBufferList *list;
+  GstQuery *query;
+  GstAllocationParams params;
+  GstCaps *caps;
+  GstBuffer *key;
+  GstBuffer *inbufs[8];
+  gsize padding;
+  guint i;
+
+  h = gst_harness_new_with_padnames ("srtpenc", "rtp_sink_0", "rtp_src_0");
+  key = gst_buffer_new_wrapped (g_malloc0 (30), 30);
+  g_object_set (h->element, "key", key, NULL);
+  gst_buffer_unref (key);
+  gst_harness_set_src_caps_str (h, "application/x-rtp, payload=(int)8, "
+      "ssrc=(uint)1356955624");
+
+  /* upstream is asked to leave room for the authentication tag */
+  caps = gst_caps_from_string ("application/x-rtp");
+  query = gst_query_new_allocation (caps, FALSE);
+  fail_unless (gst_pad_peer_query (h->srcpad, query));
+  fail_unless (gst_query_get_n_allocation_params (query) > 0);
+  gst_query_parse_nth_allocation_param (query, 0, NULL, &params);
+  padding = params.padding;
+  fail_unless_equals_int (padding, SRTP_TRAILER_ROOM);
+  gst_query_unref (query);
+  gst_caps_unref (caps);
+
+  /* a packet with the advertised tail room is protected without a copy */
+  buf = create_rtp_packet (1, padding);
+  outbuf = gst_harness_push_and_pull (h, buf);
+  fail_unless (outbuf == buf);
+  fail_unless_equals_int (gst_buffer_get_size (outbuf), 172 + 10);
+  gst_buffer_unref (outbuf);
+
+  /* one with less is copied */
+  buf = create_rtp_packet (2, padding - 1);
+  outbuf = gst_harness_push_and_pull (h, buf);
+  fail_unless (outbuf != buf);
+  fail_unless_equals_int (gst_buffer_get_size (outbuf), 172 + 10);
+  gst_buffer_unref (outbuf);
+
+  /* lists are protected as a whole, in place where there is room */
+  list = gst_buffer_list_new ();
+  for (i = 0; i < 8; i++) {
+    inbufs[i] = create_rtp_packet (3 + i, (i % 2) ? padding : 0);
+    gst_buffer_list_add (list, inbufs[i]);
+  }
+  fail_unless_equals_int (gst_pad_push_list (h->srcpad, list), GST_FLOW_OK);
+
+  for (i = 0; i < 8; i++) {
+    outbuf = gst_harness_pull (h);
+    fail_unless (outbuf != NULL);
+    fail_unless_equals_int (gst_buffer_get_size (outbuf), 172 + 10);
+    if (i % 2)
+      fail_unless (outbuf == inbufs[i]);
+    gst_buffer_unref (outbuf);
+  }
+
+  gst_harness_teardown (h);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_srtpdec_buffer_list)
+{
+  GstHarness *enc, *dec;
+  GstBufferList *list;
+  GstBuffer *buf, *key;
+  guint i;
+
+  enc = gst_harness_new_with_padnames ("srtpenc", "rtp_sink_0", "rtp_src_0");
+  key = gst_buffer_new_wrapped (g_malloc0 (30), 30);
+  g_object_set (enc->element, "key", key, NULL);
+  gst_buffer_unref (key);
+  gst_harness_set_src_caps_str (enc, "application/x-rtp, payload=(int)8, "
+      "ssrc=(uint)1356955624");
+
+  dec = gst_harness_new_with_padnames ("srtpdec", "rtp_sink", "rtp_src");
+  gst_harness_set_src_caps_str (dec, "application/x-srtp, payload=(int)8, "
+      "ssrc=(uint)1356955624, srtp-key=(buffer)"
+      "000000000000000000000000000000000000000000000000000000000000, "
+      "srtp-cipher=(string)aes-128-icm, srtp-auth=(string)hmac-sha1-80, "
+      "srtcp-cipher=(string)aes-128-icm, srtcp-auth=(string)hmac-sha1-80");
+
+  list = gst_buffer_list_new ();
+  for (i = 0; i < 8; i++) {
+    buf = gst_harness_push_and_pull (enc, create_rtp_packet (i, 0));
+    fail_unless (buf != NULL);
+    gst_buffer_list_add (list, buf);
+  }
+
+  /* the list is decrypted as a whole and the packets come out in order */
+  fail_unless_equals_int (gst_pad_push_list (dec->srcpad, list), GST_FLOW_OK);
+
+  for (i = 0; i < 8; i++) {
+    GstMapInfo map;
+
+    buf = gst_harness_pull (dec);
+    fail_unless (buf != NULL);
+    gst_buffer_map (buf, &map, GST_MAP_READ);
+    fail_unless_equals_int (map.size, 172);
+    fail_unless_equals_int (GST_READ_UINT16_BE (map.data + 2), i);
+    gst_buffer_unmap (buf, &map);
+    gst_buffer_unref (buf);
+  }
+
+  gst_harness_teardown (enc);
+  gst_harness_teardown (dec);
+}
+
+GST_END_TEST;
+
 #ifdef HAVE_SRTP2
 
 GST_START_TEST (test_simple_mki)
@@ -352,6 +500,8 @@ srtp_suite (void)
   tcase_add_test (tc_chain, test_create_and_unref);
   tcase_add_test (tc_chain, test_play);
   tcase_add_test (tc_chain, test_roc);
+  tcase_add_test (tc_chain, test_srtpenc_in_place);
+  tcase_add_test (tc_chain, test_srtpdec_buffer_list);
 #ifdef HAVE_SRTP2
   tcase_add_test (tc_chain, test_simple_mki);
   tcase_add_test (tc_chain, test_srtpdec_multiple_mki);
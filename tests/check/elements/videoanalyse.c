@@ -0,0 +1,266 @@
+/* GStreamer unit test for videoanalyse
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#include <math.h>
+
+#include <gst/check/gstcheck.h>
+#include <gst/check/gstharness.h>
+#include <gst/video/gstvideoanalysemeta.h>
+
+#define WIDTH 320
+#define HEIGHT 240
+#define CAPS_STR "video/x-raw,format=I420,width=320,height=240,framerate=25/1"
+
+static GstBuffer *
+create_frame (guint8 luma)
+{
+  gsize size = WIDTH * HEIGHT * 3 / 2;
+  GstBuffer *buf = gst_buffer_new_and_alloc (size);
+  GstMapInfo map;
+
+  gst_buffer_map (buf, &map, GST_MAP_WRITE);
+  memset (map.data, luma, WIDTH * HEIGHT);
+  memset (map.data + WIDTH * HEIGHT, 128, size - WIDTH * HEIGHT);
+  gst_buffer_unmap (buf, &map);
+
+  return buf;
+}
+
+/* Vertical stripes of luma 0, 51, 102 and 153, moved @shift columns to the
+ * left */
+static GstBuffer *
+create_stripes (guint shift)
+{
+  gsize size = WIDTH * HEIGHT * 3 / 2;
+  GstBuffer *buf = gst_buffer_new_and_alloc (size);
+  GstMapInfo map;
+  guint x, y;
+
+  gst_buffer_map (buf, &map, GST_MAP_WRITE);
+  for (y = 0; y < HEIGHT; y++)
+    for (x = 0; x < WIDTH; x++)
+      map.data[y * WIDTH + x] = ((x + shift) % 4) * 51;
+  memset (map.data + WIDTH * HEIGHT, 128, size - WIDTH * HEIGHT);
+  gst_buffer_unmap (buf, &map);
+
+  return buf;
+}
+
+static const GstStructure *
+pop_stats (GstBus * bus, GstMessage ** msg)
+{
+  *msg = gst_bus_pop_filtered (bus, GST_MESSAGE_ELEMENT);
+  fail_unless (*msg != NULL);
+
+  return gst_message_get_structure (*msg);
+}
+
+GST_START_TEST (test_luma_stats)
+{
+  GstHarness *h;
+  GstBus *bus;
+  GstMessage *msg;
+  const GstStructure *s;
+  GstBuffer *buf;
+  gdouble average, variance;
+  guint subsample;
+
+  for (subsample = 1; subsample <= 3; subsample++) {
+    h = gst_harness_new ("videoanalyse");
+    g_object_set (h->element, "subsample", subsample, NULL);
+    bus = gst_bus_new ();
+    gst_element_set_bus (h->element, bus);
+    gst_harness_set_src_caps_str (h, CAPS_STR);
+
+    buf = gst_harness_push_and_pull (h, create_frame (51));
+    gst_buffer_unref (buf);
+
+    s = pop_stats (bus, &msg);
+    fail_unless (gst_structure_get_double (s, "luma-average", &average));
+    fail_unless (gst_structure_get_double (s, "luma-variance", &variance));
+    fail_unless_equals_float (average, 0.2);
+    fail_unless_equals_float (variance, 0.0);
+    fail_if (gst_structure_has_field (s, "frozen"));
+    gst_message_unref (msg);
+
+    gst_element_set_bus (h->element, NULL);
+    gst_object_unref (bus);
+    gst_harness_teardown (h);
+  }
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_frozen_and_meta)
+{
+  GstHarness *h;
+  GstBus *bus;
+  GstMessage *msg;
+  const GstStructure *s;
+  GstBuffer *buf;
+  GstVideoAnalyseMeta *meta;
+  gboolean frozen;
+  gdouble difference;
+
+  h = gst_harness_new ("videoanalyse");
+  g_object_set (h->element, "detect-frozen", TRUE, "meta", TRUE,
+      "histogram", TRUE, NULL);
+  bus = gst_bus_new ();
+  gst_element_set_bus (h->element, bus);
+  gst_harness_set_src_caps_str (h, CAPS_STR);
+
+  /* first frame has nothing to compare with */
+  buf = gst_harness_push_and_pull (h, create_frame (100));
+  meta = gst_buffer_get_video_analyse_meta (buf);
+  fail_unless (meta != NULL);
+  fail_if (meta->frozen);
+  fail_unless_equals_float (meta->luma_difference, -1.0);
+  fail_unless (meta->has_histogram);
+  fail_unless_equals_int (meta->histogram[100], WIDTH * HEIGHT);
+  gst_buffer_unref (buf);
+  s = pop_stats (bus, &msg);
+  fail_unless (gst_structure_get_boolean (s, "frozen", &frozen));
+  fail_if (frozen);
+  gst_message_unref (msg);
+
+  /* identical frame is frozen */
+  buf = gst_harness_push_and_pull (h, create_frame (100));
+  meta = gst_buffer_get_video_analyse_meta (buf);
+  fail_unless (meta != NULL);
+  fail_unless (meta->frozen);
+  gst_buffer_unref (buf);
+  s = pop_stats (bus, &msg);
+  fail_unless (gst_structure_get_boolean (s, "frozen", &frozen));
+  fail_unless (gst_structure_get_double (s, "luma-difference", &difference));
+  fail_unless (frozen);
+  fail_unless_equals_float (difference, 0.0);
+  gst_message_unref (msg);
+
+  /* a changed frame is not */
+  buf = gst_harness_push_and_pull (h, create_frame (151));
+  gst_buffer_unref (buf);
+  s = pop_stats (bus, &msg);
+  fail_unless (gst_structure_get_boolean (s, "frozen", &frozen));
+  fail_unless (gst_structure_get_double (s, "luma-difference", &difference));
+  fail_if (frozen);
+  fail_unless_equals_float (difference, 0.2);
+  gst_message_unref (msg);
+
+  gst_element_set_bus (h->element, NULL);
+  gst_object_unref (bus);
+  gst_harness_teardown (h);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_stripes)
+{
+  GstHarness *h;
+  GstBus *bus;
+  GstMessage *msg;
+  const GstStructure *s;
+  GstBuffer *buf;
+  GstVideoAnalyseMeta *meta;
+  gdouble average, variance, difference;
+  gboolean frozen;
+
+  h = gst_harness_new ("videoanalyse");
+  g_object_set (h->element, "detect-frozen", TRUE, "meta", TRUE,
+      "histogram", TRUE, NULL);
+  bus = gst_bus_new ();
+  gst_element_set_bus (h->element, bus);
+  gst_harness_set_src_caps_str (h, CAPS_STR);
+
+  /* the variance is taken around the integer average 76, the squared
+   * distances of the 4 values sum up to 13006 */
+  buf = gst_harness_push_and_pull (h, create_stripes (0));
+  meta = gst_buffer_get_video_analyse_meta (buf);
+  fail_unless (meta != NULL);
+  fail_unless (fabs (meta->luma_average - 76.5 / 255.0) < 1e-9);
+  fail_unless (fabs (meta->luma_variance - 13006 / (4 * 255.0 * 255.0)) <
+      1e-9);
+  fail_unless_equals_int (meta->histogram[0], WIDTH * HEIGHT / 4);
+  fail_unless_equals_int (meta->histogram[51], WIDTH * HEIGHT / 4);
+  fail_unless_equals_int (meta->histogram[102], WIDTH * HEIGHT / 4);
+  fail_unless_equals_int (meta->histogram[153], WIDTH * HEIGHT / 4);
+  fail_unless_equals_int (meta->histogram[1], 0);
+  gst_buffer_unref (buf);
+  s = pop_stats (bus, &msg);
+  fail_unless (gst_structure_get_double (s, "luma-variance", &variance));
+  fail_unless_equals_float (variance, meta->luma_variance);
+  gst_message_unref (msg);
+
+  /* same average, but every pixel changed: 51 for three of the columns and
+   * 153 for the fourth */
+  buf = gst_harness_push_and_pull (h, create_stripes (1));
+  meta = gst_buffer_get_video_analyse_meta (buf);
+  fail_unless (meta != NULL);
+  fail_unless (fabs (meta->luma_average - 76.5 / 255.0) < 1e-9);
+  fail_unless (fabs (meta->luma_difference - 76.5 / 255.0) < 1e-9);
+  fail_if (meta->frozen);
+  gst_buffer_unref (buf);
+  s = pop_stats (bus, &msg);
+  fail_unless (gst_structure_get_boolean (s, "frozen", &frozen));
+  fail_unless (gst_structure_get_double (s, "luma-difference", &difference));
+  fail_if (frozen);
+  fail_unless (fabs (difference - 76.5 / 255.0) < 1e-9);
+  gst_message_unref (msg);
+
+  /* every other column only sees luma 51 and 153 */
+  g_object_set (h->element, "subsample", 2, NULL);
+  buf = gst_harness_push_and_pull (h, create_stripes (1));
+  meta = gst_buffer_get_video_analyse_meta (buf);
+  fail_unless (meta != NULL);
+  fail_unless_equals_int (meta->histogram[51], WIDTH * HEIGHT / 8);
+  fail_unless_equals_int (meta->histogram[153], WIDTH * HEIGHT / 8);
+  fail_unless_equals_int (meta->histogram[0], 0);
+  fail_unless_equals_int (meta->histogram[102], 0);
+  gst_buffer_unref (buf);
+  s = pop_stats (bus, &msg);
+  fail_unless (gst_structure_get_double (s, "luma-average", &average));
+  fail_unless (gst_structure_get_double (s, "luma-variance", &variance));
+  fail_unless (fabs (average - 102 / 255.0) < 1e-9);
+  fail_unless (fabs (variance - 51 * 51 / (255.0 * 255.0)) < 1e-9);
+  gst_message_unref (msg);
+
+  gst_element_set_bus (h->element, NULL);
+  gst_object_unref (bus);
+  gst_harness_teardown (h);
+}
+
+GST_END_TEST;
+
+static Suite *
+videoanalyse_suite (void)
+{
+  Suite *s = suite_create ("videoanalyse");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_luma_stats);
+  tcase_add_test (tc_chain, test_frozen_and_meta);
+  tcase_add_test (tc_chain, test_stripes);
+
+  return s;
+}
+
+GST_CHECK_MAIN (videoanalyse);
@@ -0,0 +1,301 @@
+/* GStreamer unit test for watchdog
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#include <gst/check/gstcheck.h>
+#include <gst/check/gstharness.h>
+
+static GstHarness *
+setup_watchdog (const gchar * launch, GstBus ** bus)
+{
+  GstHarness *h;
+
+  h = gst_harness_new_parse (launch);
+  *bus = gst_bus_new ();
+  gst_element_set_bus (h->element, *bus);
+  gst_harness_set_src_caps_str (h, "application/x-test");
+
+  return h;
+}
+
+static void
+teardown_watchdog (GstHarness * h, GstBus * bus)
+{
+  gst_element_set_bus (h->element, NULL);
+  gst_object_unref (bus);
+  gst_harness_teardown (h);
+}
+
+static GstBuffer *
+create_buffer (GstClockTime pts, GstClockTime duration)
+{
+  GstBuffer *buffer = gst_buffer_new ();
+
+  GST_BUFFER_PTS (buffer) = pts;
+  GST_BUFFER_DURATION (buffer) = duration;
+
+  return buffer;
+}
+
+/* Returns the structure of the next element message called @name, skipping
+ * the other element messages, or NULL if none came within @timeout */
+static GstStructure *
+wait_for_message (GstBus * bus, const gchar * name, GstClockTime timeout)
+{
+  GstStructure *s = NULL;
+  GstMessage *msg;
+
+  while (!s && (msg = gst_bus_timed_pop_filtered (bus, timeout,
+              GST_MESSAGE_ELEMENT))) {
+    if (gst_message_has_name (msg, name))
+      s = gst_structure_copy (gst_message_get_structure (msg));
+    gst_message_unref (msg);
+  }
+
+  return s;
+}
+
+static guint64
+get_stat (GstElement * element, const gchar * field)
+{
+  GstStructure *stats;
+  guint64 value;
+
+  g_object_get (element, "stats", &stats, NULL);
+  fail_unless (gst_structure_get_uint64 (stats, field, &value));
+  gst_structure_free (stats);
+
+  return value;
+}
+
+GST_START_TEST (test_stall_and_recovery)
+{
+  GstHarness *h;
+  GstBus *bus;
+  GstStructure *s;
+  const gchar *reason;
+  guint64 duration;
+
+  h = setup_watchdog ("watchdog timeout=0 warning-timeout=50", &bus);
+
+  fail_unless_equals_int (gst_harness_push (h, create_buffer (0,
+              GST_MSECOND)), GST_FLOW_OK);
+
+  s = wait_for_message (bus, "watchdog-stall", GST_SECOND);
+  fail_unless (s != NULL, "no stall reported");
+  fail_unless (gst_structure_get_uint64 (s, "duration", &duration));
+  fail_unless_equals_uint64 (duration, 50 * GST_MSECOND);
+  gst_structure_free (s);
+
+  /* only reported once per stall */
+  fail_unless (wait_for_message (bus, "watchdog-stall",
+          200 * GST_MSECOND) == NULL);
+
+  fail_unless_equals_int (gst_harness_push (h, create_buffer (GST_MSECOND,
+              GST_MSECOND)), GST_FLOW_OK);
+  s = wait_for_message (bus, "watchdog-recovered", 0);
+  fail_unless (s != NULL, "no recovery reported");
+  reason = gst_structure_get_string (s, "reason");
+  fail_unless_equals_string (reason, "stall");
+  fail_unless (gst_structure_get_uint64 (s, "duration", &duration));
+  fail_unless (duration >= 250 * GST_MSECOND);
+  gst_structure_free (s);
+
+  fail_unless_equals_uint64 (get_stat (h->element, "buffers"), 2);
+  fail_unless_equals_uint64 (get_stat (h->element, "stalls"), 1);
+  fail_unless (get_stat (h->element, "max-gap") >= 250 * GST_MSECOND);
+
+  teardown_watchdog (h, bus);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_fed_by_buffers)
+{
+  GstHarness *h;
+  GstBus *bus;
+  GstMessage *msg;
+  guint i;
+
+  h = setup_watchdog ("watchdog timeout=100", &bus);
+
+  /* buffers every 10ms keep pushing the deadline back */
+  for (i = 0; i < 30; i++) {
+    fail_unless_equals_int (gst_harness_push (h, create_buffer (i *
+                10 * GST_MSECOND, 10 * GST_MSECOND)), GST_FLOW_OK);
+    g_usleep (10 * 1000);
+  }
+  msg = gst_bus_pop_filtered (bus, GST_MESSAGE_ERROR);
+  fail_unless (msg == NULL, "watchdog triggered while fed");
+
+  msg = gst_bus_timed_pop_filtered (bus, GST_SECOND, GST_MESSAGE_ERROR);
+  fail_unless (msg != NULL, "watchdog did not trigger");
+  gst_message_unref (msg);
+
+  teardown_watchdog (h, bus);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_slowdown)
+{
+  GstHarness *h;
+  GstBus *bus;
+  GstStructure *s;
+  const gchar *reason;
+  gdouble rate;
+  guint i;
+
+  h = setup_watchdog ("watchdog timeout=0 min-rate=50 rate-window=100",
+      &bus);
+
+  /* 20 buffers per second */
+  for (i = 0; i < 8; i++) {
+    fail_unless_equals_int (gst_harness_push (h, create_buffer (i *
+                50 * GST_MSECOND, 50 * GST_MSECOND)), GST_FLOW_OK);
+    g_usleep (50 * 1000);
+  }
+
+  s = wait_for_message (bus, "watchdog-slowdown", 0);
+  fail_unless (s != NULL, "no slowdown reported");
+  fail_unless (gst_structure_get_double (s, "rate", &rate));
+  fail_unless (rate < 50, "rate %f", rate);
+  gst_structure_free (s);
+  /* only reported once per slowdown */
+  fail_unless (wait_for_message (bus, "watchdog-slowdown", 0) == NULL);
+
+  /* 200 buffers per second */
+  for (i = 0; i < 50; i++) {
+    fail_unless_equals_int (gst_harness_push (h, create_buffer (GST_SECOND +
+                i * 5 * GST_MSECOND, 5 * GST_MSECOND)), GST_FLOW_OK);
+    g_usleep (5 * 1000);
+  }
+
+  s = wait_for_message (bus, "watchdog-recovered", 0);
+  fail_unless (s != NULL, "no recovery reported");
+  reason = gst_structure_get_string (s, "reason");
+  fail_unless_equals_string (reason, "slowdown");
+  fail_unless (gst_structure_get_double (s, "rate", &rate));
+  fail_unless (rate >= 50, "rate %f", rate);
+  gst_structure_free (s);
+
+  fail_unless_equals_uint64 (get_stat (h->element, "slowdowns"), 1);
+
+  teardown_watchdog (h, bus);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_discontinuity)
+{
+  GstHarness *h;
+  GstBus *bus;
+  GstStructure *s;
+  gint64 offset;
+
+  h = setup_watchdog ("watchdog timeout=0 discont-threshold=10", &bus);
+
+  fail_unless_equals_int (gst_harness_push (h, create_buffer (0,
+              20 * GST_MSECOND)), GST_FLOW_OK);
+  /* within the threshold */
+  fail_unless_equals_int (gst_harness_push (h, create_buffer (25 * GST_MSECOND,
+              20 * GST_MSECOND)), GST_FLOW_OK);
+  fail_unless (wait_for_message (bus, "watchdog-discontinuity", 0) == NULL);
+
+  /* 55ms after the end of the previous buffer */
+  fail_unless_equals_int (gst_harness_push (h,
+          create_buffer (100 * GST_MSECOND, 20 * GST_MSECOND)), GST_FLOW_OK);
+  s = wait_for_message (bus, "watchdog-discontinuity", 0);
+  fail_unless (s != NULL, "no discontinuity reported");
+  fail_unless (gst_structure_get_int64 (s, "offset", &offset));
+  fail_unless_equals_int64 (offset, 55 * GST_MSECOND);
+  gst_structure_free (s);
+
+  /* and backwards */
+  fail_unless_equals_int (gst_harness_push (h, create_buffer (0,
+              20 * GST_MSECOND)), GST_FLOW_OK);
+  s = wait_for_message (bus, "watchdog-discontinuity", 0);
+  fail_unless (s != NULL, "no discontinuity reported");
+  fail_unless (gst_structure_get_int64 (s, "offset", &offset));
+  fail_unless_equals_int64 (offset, -120 * GST_MSECOND);
+  gst_structure_free (s);
+
+  fail_unless_equals_uint64 (get_stat (h->element, "discontinuities"), 2);
+
+  teardown_watchdog (h, bus);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_shared_thread)
+{
+  GstHarness *h1, *h2;
+  GstBus *bus1, *bus2;
+  GstStructure *s;
+
+  h1 = setup_watchdog ("watchdog timeout=0 warning-timeout=50", &bus1);
+  h2 = setup_watchdog ("watchdog timeout=0 warning-timeout=50", &bus2);
+
+  gst_harness_push (h1, create_buffer (0, GST_MSECOND));
+  gst_harness_push (h2, create_buffer (0, GST_MSECOND));
+  s = wait_for_message (bus1, "watchdog-stall", GST_SECOND);
+  fail_unless (s != NULL);
+  gst_structure_free (s);
+  s = wait_for_message (bus2, "watchdog-stall", GST_SECOND);
+  fail_unless (s != NULL);
+  gst_structure_free (s);
+
+  /* the thread keeps running for the remaining user */
+  teardown_watchdog (h1, bus1);
+  gst_harness_push (h2, create_buffer (GST_MSECOND, GST_MSECOND));
+  s = wait_for_message (bus2, "watchdog-stall", GST_SECOND);
+  fail_unless (s != NULL, "no stall after the other watchdog stopped");
+  gst_structure_free (s);
+  teardown_watchdog (h2, bus2);
+
+  /* and is started again for a new one */
+  h1 = setup_watchdog ("watchdog timeout=0 warning-timeout=50", &bus1);
+  gst_harness_push (h1, create_buffer (0, GST_MSECOND));
+  s = wait_for_message (bus1, "watchdog-stall", GST_SECOND);
+  fail_unless (s != NULL, "no stall after restarting the thread");
+  gst_structure_free (s);
+  teardown_watchdog (h1, bus1);
+}
+
+GST_END_TEST;
+
+static Suite *
+watchdog_suite (void)
+{
+  Suite *s = suite_create ("watchdog");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_stall_and_recovery);
+  tcase_add_test (tc_chain, test_fed_by_buffers);
+  tcase_add_test (tc_chain, test_slowdown);
+  tcase_add_test (tc_chain, test_discontinuity);
+  tcase_add_test (tc_chain, test_shared_thread);
+
+  return s;
+}
+
+GST_CHECK_MAIN (watchdog);
@@ -1294,6 +1294,22 @@ validate_remote_outbound_rtp_stats (const GstStructure * s,
   g_free (local_id);
 }
 
+static void
+validate_transport_stats (const GstStructure * s)
+{
+  guint64 packets_sent, packets_received, bytes_sent, bytes_received;
+
+  fail_unless (gst_structure_get (s,
+          "packets-sent", G_TYPE_UINT64, &packets_sent,
+          "packets-received", G_TYPE_UINT64, &packets_received,
+          "bytes-sent", G_TYPE_UINT64, &bytes_sent,
+          "bytes-received", G_TYPE_UINT64, &bytes_received, NULL));
+
+  /* no empty packets go over the wire */
+  fail_unless (bytes_sent >= packets_sent);
+  fail_unless (bytes_received >= packets_received);
+}
+
 static gboolean
 validate_stats_foreach (GQuark field_id, const GValue * value,
     const GstStructure * stats)
@@ -1325,6 +1341,7 @@ validate_stats_foreach (GQuark field_id, const GValue * value,
   } else if (type == GST_WEBRTC_STATS_DATA_CHANNEL) {
   } else if (type == GST_WEBRTC_STATS_STREAM) {
   } else if (type == GST_WEBRTC_STATS_TRANSPORT) {
+    validate_transport_stats (s);
   } else if (type == GST_WEBRTC_STATS_CANDIDATE_PAIR) {
   } else if (type == GST_WEBRTC_STATS_LOCAL_CANDIDATE) {
   } else if (type == GST_WEBRTC_STATS_REMOTE_CANDIDATE) {
@@ -1381,6 +1398,68 @@ GST_START_TEST (test_session_stats)
 
 GST_END_TEST;
 
+static gboolean
+check_stats_type_foreach (GQuark field_id, const GValue * value,
+    gpointer user_data)
+{
+  GstWebRTCStatsType expected = GPOINTER_TO_INT (user_data);
+  GstWebRTCStatsType type;
+  const GstStructure *s;
+
+  fail_unless (GST_VALUE_HOLDS_STRUCTURE (value));
+  s = gst_value_get_structure (value);
+  fail_unless (gst_structure_get (s, "type", GST_TYPE_WEBRTC_STATS_TYPE,
+          &type, NULL));
+  fail_unless_equals_int (type, expected);
+
+  return TRUE;
+}
+
+GST_START_TEST (test_session_stats_filtered)
+{
+  struct test_webrtc *t = test_webrtc_new ();
+  const gchar *pc_types[] = { "peer-connection", NULL };
+  const gchar *codec_types[] = { "codec", NULL };
+  const GstStructure *reply;
+  GstStructure *snapshot;
+  GstPromise *p;
+
+  t->on_negotiation_needed = NULL;
+  test_validate_sdp (t, NULL, NULL);
+
+  /* nothing has been generated yet */
+  g_signal_emit_by_name (t->webrtc1, "get-stats-snapshot", NULL, NULL,
+      &snapshot);
+  fail_unless (snapshot != NULL);
+  fail_unless_equals_int (gst_structure_n_fields (snapshot), 0);
+  gst_structure_free (snapshot);
+
+  p = gst_promise_new ();
+  g_signal_emit_by_name (t->webrtc1, "get-stats-filtered", NULL, pc_types, p);
+  fail_unless_equals_int (gst_promise_wait (p), GST_PROMISE_RESULT_REPLIED);
+  reply = gst_promise_get_reply (p);
+  fail_unless_equals_int (gst_structure_n_fields (reply), 1);
+  gst_structure_foreach (reply, check_stats_type_foreach,
+      GINT_TO_POINTER (GST_WEBRTC_STATS_PEER_CONNECTION));
+  validate_stats (reply);
+
+  /* the snapshot returns the same reports without updating them */
+  g_signal_emit_by_name (t->webrtc1, "get-stats-snapshot", NULL, NULL,
+      &snapshot);
+  fail_unless (gst_structure_is_equal (snapshot, reply));
+  gst_structure_free (snapshot);
+  gst_promise_unref (p);
+
+  g_signal_emit_by_name (t->webrtc1, "get-stats-snapshot", NULL, codec_types,
+      &snapshot);
+  fail_unless_equals_int (gst_structure_n_fields (snapshot), 0);
+  gst_structure_free (snapshot);
+
+  test_webrtc_free (t);
+}
+
+GST_END_TEST;
+
 GST_START_TEST (test_add_transceiver)
 {
   struct test_webrtc *t = test_webrtc_new ();
@@ -1769,6 +1848,90 @@ GST_START_TEST (test_data_channel_transfer_data)
 
 GST_END_TEST;
 
+static void
+on_message_data_list (GObject * channel, GBytes * data, struct test_webrtc *t)
+{
+  GQueue *expected = g_object_get_data (channel, "expected");
+  GBytes *next = g_queue_pop_head (expected);
+
+  fail_unless (next != NULL);
+  g_assert_cmpbytes (data, next);
+  g_bytes_unref (next);
+
+  if (g_queue_is_empty (expected))
+    test_webrtc_signal_state (t, STATE_CUSTOM);
+}
+
+static void
+_free_bytes_queue (GQueue * queue)
+{
+  g_queue_free_full (queue, (GDestroyNotify) g_bytes_unref);
+}
+
+static void
+have_data_channel_transfer_data_list (struct test_webrtc *t,
+    GstElement * element, GObject * our, gpointer user_data)
+{
+  GObject *other = user_data;
+  GPtrArray *list = g_ptr_array_new_with_free_func ((GDestroyNotify)
+      g_bytes_unref);
+  GQueue *expected = g_queue_new ();
+  guint i;
+
+  for (i = 0; i < 3; i++) {
+    GBytes *data = g_bytes_new_static (test_string, strlen (test_string) - i);
+
+    g_ptr_array_add (list, data);
+    g_queue_push_tail (expected, g_bytes_ref (data));
+  }
+
+  g_object_set_data_full (our, "expected", expected,
+      (GDestroyNotify) _free_bytes_queue);
+  g_signal_connect (our, "on-message-data", G_CALLBACK (on_message_data_list),
+      t);
+
+  g_signal_connect (other, "on-error",
+      G_CALLBACK (on_channel_error_not_reached), NULL);
+  g_signal_emit_by_name (other, "send-data-list", list);
+  g_ptr_array_unref (list);
+}
+
+GST_START_TEST (test_data_channel_transfer_data_list)
+{
+  struct test_webrtc *t = test_webrtc_new ();
+  GObject *channel = NULL;
+  VAL_SDP_INIT (offer, on_sdp_has_datachannel, NULL, NULL);
+  VAL_SDP_INIT (answer, on_sdp_has_datachannel, NULL, NULL);
+
+  t->on_negotiation_needed = NULL;
+  t->on_ice_candidate = NULL;
+  t->on_data_channel = have_data_channel_transfer_data_list;
+
+  fail_if (gst_element_set_state (t->webrtc1,
+          GST_STATE_READY) == GST_STATE_CHANGE_FAILURE);
+  fail_if (gst_element_set_state (t->webrtc2,
+          GST_STATE_READY) == GST_STATE_CHANGE_FAILURE);
+
+  g_signal_emit_by_name (t->webrtc1, "create-data-channel", "label", NULL,
+      &channel);
+  g_assert_nonnull (channel);
+  t->data_channel_data = channel;
+  g_signal_connect (channel, "on-error",
+      G_CALLBACK (on_channel_error_not_reached), NULL);
+
+  fail_if (gst_element_set_state (t->webrtc1,
+          GST_STATE_PLAYING) == GST_STATE_CHANGE_FAILURE);
+  fail_if (gst_element_set_state (t->webrtc2,
+          GST_STATE_PLAYING) == GST_STATE_CHANGE_FAILURE);
+
+  test_validate_sdp_full (t, &offer, &answer, 1 << STATE_CUSTOM, FALSE);
+
+  g_object_unref (channel);
+  test_webrtc_free (t);
+}
+
+GST_END_TEST;
+
 static void
 have_data_channel_create_data_channel (struct test_webrtc *t,
     GstElement * element, GObject * our, gpointer user_data)
@@ -2755,6 +2918,7 @@ webrtcbin_suite (void)
   if (nicesrc && nicesink && dtlssrtpenc && dtlssrtpdec) {
     tcase_add_test (tc, test_sdp_no_media);
     tcase_add_test (tc, test_session_stats);
+    tcase_add_test (tc, test_session_stats_filtered);
     tcase_add_test (tc, test_audio);
     tcase_add_test (tc, test_audio_video);
     tcase_add_test (tc, test_media_direction);
@@ -2778,6 +2942,7 @@ webrtcbin_suite (void)
       tcase_add_test (tc, test_data_channel_remote_notify);
       tcase_add_test (tc, test_data_channel_transfer_string);
       tcase_add_test (tc, test_data_channel_transfer_data);
+      tcase_add_test (tc, test_data_channel_transfer_data_list);
       tcase_add_test (tc, test_data_channel_create_after_negotiate);
       tcase_add_test (tc, test_data_channel_low_threshold);
       tcase_add_test (tc, test_data_channel_max_message_size);
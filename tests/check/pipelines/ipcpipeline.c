@@ -56,6 +56,18 @@ pipe2 (int pipedes[2], int flags)
 }
 #endif
 
+static int
+socketpair_nonblock (int sv[2])
+{
+  if (socketpair (PF_UNIX, SOCK_STREAM, 0, sv) < 0)
+    return -1;
+  if (fcntl (sv[0], F_SETFL, O_NONBLOCK) < 0)
+    return -1;
+  if (fcntl (sv[1], F_SETFL, O_NONBLOCK) < 0)
+    return -1;
+  return 0;
+}
+
 /* This enum contains flags that are used to configure the setup that
  * test_base() will do internally */
 typedef enum
@@ -71,6 +83,8 @@ typedef enum
   TEST_FEATURE_ERROR_SINK = 0x80,       /* generates error message in the slave */
   TEST_FEATURE_LONG_DURATION = 0x100,   /* bigger num-buffers in {audio,video}testsrc */
   TEST_FEATURE_FILTER_SINK_CAPS = 0x200,        /* plugs capsfilter before fakesink */
+  TEST_FEATURE_FD_PASSING = 0x2000,     /* buffers are passed as fds over sockets */
+  TEST_FEATURE_WINDOWED_ACKS = 0x4000,  /* several buffers wait for their ack */
 
   /* Source selection; Use only one of those, do not combine! */
   TEST_FEATURE_TEST_SOURCE = 0x400,
@@ -542,6 +556,20 @@ create_test_source (gboolean live, int fdina, int fdouta, int fdinv, int fdoutv,
   return pipeline;
 }
 
+static void
+configure_ipcpipelinesink (const GValue * v, gpointer user_data)
+{
+  GObject *sink = g_value_get_object (v);
+  TestFeatures features = GPOINTER_TO_UINT (user_data);
+
+  if (!g_object_class_find_property (G_OBJECT_GET_CLASS (sink), "fd-passing"))
+    return;
+  if (features & TEST_FEATURE_FD_PASSING)
+    g_object_set (sink, "fd-passing", TRUE, NULL);
+  if (features & TEST_FEATURE_WINDOWED_ACKS)
+    g_object_set (sink, "max-in-flight", 8, NULL);
+}
+
 static GstElement *
 create_source (TestFeatures features, int fdina, int fdouta, int fdinv,
     int fdoutv, test_data * td)
@@ -568,6 +596,17 @@ create_source (TestFeatures features, int fdina, int fdouta, int fdinv,
   td->two_streams = has_video;
   td->p = pipeline;
 
+  if (pipeline && (features & (TEST_FEATURE_FD_PASSING |
+              TEST_FEATURE_WINDOWED_ACKS))) {
+    GstIterator *it;
+
+    it = gst_bin_iterate_sinks (GST_BIN (pipeline));
+    while (gst_iterator_foreach (it, configure_ipcpipelinesink,
+            GUINT_TO_POINTER (features)) == GST_ITERATOR_RESYNC)
+      gst_iterator_resync (it);
+    gst_iterator_free (it);
+  }
+
   if (pipeline)
     gst_bus_add_watch (GST_ELEMENT_BUS (pipeline), master_bus_msg, td);
 
@@ -791,9 +830,15 @@ test_base (const char *name, TestFeatures features,
 
   weak_refs = NULL;
 
-  FAIL_IF (pipe2 (pipesfa, O_NONBLOCK) < 0);
+  if (features & TEST_FEATURE_FD_PASSING) {
+    /* fds can only be passed over Unix domain sockets */
+    FAIL_IF (socketpair_nonblock (pipesfa) < 0);
+    FAIL_IF (socketpair_nonblock (pipesfv) < 0);
+  } else {
+    FAIL_IF (pipe2 (pipesfa, O_NONBLOCK) < 0);
+    FAIL_IF (pipe2 (pipesfv, O_NONBLOCK) < 0);
+  }
   FAIL_IF (pipe2 (pipesba, O_NONBLOCK) < 0);
-  FAIL_IF (pipe2 (pipesfv, O_NONBLOCK) < 0);
   FAIL_IF (pipe2 (pipesbv, O_NONBLOCK) < 0);
   FAIL_IF (socketpair (PF_UNIX, SOCK_STREAM, 0, ctlsock) < 0);
 
@@ -1254,6 +1299,30 @@ GST_START_TEST (test_live_av_2_play_pause)
 
 GST_END_TEST;
 
+GST_START_TEST (test_live_av_fd_passing_play_pause)
+{
+  play_pause_master_data md = PLAY_PAUSE_MASTER_DATA_INIT;
+  play_pause_slave_data sd = PLAY_PAUSE_SLAVE_DATA_INIT;
+
+  TEST_BASE (TEST_FEATURE_LIVE_AV_SOURCE | TEST_FEATURE_FD_PASSING,
+      play_pause_source, setup_sink_play_pause, check_success_source_play_pause,
+      check_success_sink_play_pause, NULL, &md, &sd);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_live_av_windowed_acks_play_pause)
+{
+  play_pause_master_data md = PLAY_PAUSE_MASTER_DATA_INIT;
+  play_pause_slave_data sd = PLAY_PAUSE_SLAVE_DATA_INIT;
+
+  TEST_BASE (TEST_FEATURE_LIVE_AV_SOURCE | TEST_FEATURE_WINDOWED_ACKS,
+      play_pause_source, setup_sink_play_pause, check_success_source_play_pause,
+      check_success_sink_play_pause, NULL, &md, &sd);
+}
+
+GST_END_TEST;
+
 /**** flushing seek test ****/
 
 typedef struct
@@ -1564,6 +1633,20 @@ GST_START_TEST (test_live_av_2_flushing_seek)
 
 GST_END_TEST;
 
+GST_START_TEST (test_live_av_windowed_acks_flushing_seek)
+{
+  flushing_seek_input_data id = FLUSHING_SEEK_INPUT_DATA_INIT;
+  flushing_seek_master_data md = FLUSHING_SEEK_MASTER_DATA_INIT;
+  flushing_seek_slave_data sd = FLUSHING_SEEK_SLAVE_DATA_INIT;
+
+  TEST_BASE (TEST_FEATURE_LIVE_AV_SOURCE | TEST_FEATURE_WINDOWED_ACKS,
+      flushing_seek_source, setup_sink_flushing_seek,
+      check_success_source_flushing_seek, check_success_sink_flushing_seek, &id,
+      &md, &sd);
+}
+
+GST_END_TEST;
+
 GST_START_TEST (test_empty_flushing_seek_in_pause)
 {
   flushing_seek_input_data id = FLUSHING_SEEK_INPUT_DATA_INIT_PAUSED;
@@ -5826,6 +5909,8 @@ ipcpipeline_suite (void)
     tcase_add_test (tc_chain, test_live_a_play_pause);
     tcase_add_test (tc_chain, test_live_av_play_pause);
     tcase_add_test (tc_chain, test_live_av_2_play_pause);
+    tcase_add_test (tc_chain, test_live_av_fd_passing_play_pause);
+    tcase_add_test (tc_chain, test_live_av_windowed_acks_play_pause);
   }
 
   /* flushing_seek tests perform a flushing seek in PLAYING
@@ -5839,6 +5924,7 @@ ipcpipeline_suite (void)
     tcase_add_test (tc_chain, test_live_a_flushing_seek);
     tcase_add_test (tc_chain, test_live_av_flushing_seek);
     tcase_add_test (tc_chain, test_live_av_2_flushing_seek);
+    tcase_add_test (tc_chain, test_live_av_windowed_acks_flushing_seek);
   }
 
   /* flushing_seek_in_pause tests perform a flushing seek in
@@ -0,0 +1,216 @@
+/* GStreamer
+ *
+ * benchmark for the ipcpipelinesrc/ipcpipelinesink elements
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/*
+ * This program pushes the given number of buffers of the given size from
+ * a master pipeline through ipcpipelinesink to a slave pipeline in a forked
+ * process, which drops them in a fakesink. It prints the throughput and the
+ * time spent per buffer in ipcpipelinesink, which is the full round trip to
+ * the slave when max-in-flight is 1.
+ *
+ * Usage: ipc-bench [n-buffers [buffer-size [max-in-flight [fd-passing]]]]
+ */
+
+#define _GNU_SOURCE
+#include <unistd.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <gst/gst.h>
+
+static GMainLoop *loop = NULL;
+
+static guint n_buffers = 10000;
+static guint buffer_size = 4096;
+static guint max_in_flight = 1;
+static gboolean fd_passing = FALSE;
+
+static gint64 start_time = -1, end_time = -1, last_time = -1;
+static gint64 max_interval;
+static guint n_seen;
+
+static GstPadProbeReturn
+buffer_probe (GstPad * pad, GstPadProbeInfo * info, gpointer user_data)
+{
+  gint64 now = g_get_monotonic_time ();
+
+  /* the source produces buffers immediately, so the time between two
+   * buffers reaching the sink is the time the sink spent on the first */
+  if (last_time >= 0)
+    max_interval = MAX (max_interval, now - last_time);
+  else
+    start_time = now;
+  last_time = now;
+  n_seen++;
+
+  return GST_PAD_PROBE_OK;
+}
+
+static gboolean
+master_bus_msg (GstBus * bus, GstMessage * msg, gpointer data)
+{
+  GstPipeline *pipeline = data;
+
+  switch (GST_MESSAGE_TYPE (msg)) {
+    case GST_MESSAGE_ERROR:{
+      GError *err;
+      gchar *dbg;
+
+      gst_message_parse_error (msg, &err, &dbg);
+      g_printerr ("ERROR: %s\n", err->message);
+      if (dbg != NULL)
+        g_printerr ("ERROR debug information: %s\n", dbg);
+      g_error_free (err);
+      g_free (dbg);
+
+      gst_element_set_state (GST_ELEMENT (pipeline), GST_STATE_NULL);
+      g_main_loop_quit (loop);
+      break;
+    }
+    case GST_MESSAGE_EOS:
+      end_time = g_get_monotonic_time ();
+      gst_element_set_state (GST_ELEMENT (pipeline), GST_STATE_NULL);
+      g_main_loop_quit (loop);
+      break;
+    default:
+      break;
+  }
+  return TRUE;
+}
+
+static void
+start_source (int fdin, int fdout)
+{
+  GstElement *pipeline;
+  GstElement *source, *ipcpipelinesink;
+  GstPad *pad;
+
+  pipeline = gst_pipeline_new (NULL);
+  gst_bus_add_watch (GST_ELEMENT_BUS (pipeline), master_bus_msg, pipeline);
+
+  source = gst_element_factory_make ("fakesrc", NULL);
+  gst_util_set_object_arg (G_OBJECT (source), "sizetype", "fixed");
+  gst_util_set_object_arg (G_OBJECT (source), "filltype", "zero");
+  g_object_set (source, "num-buffers", n_buffers, "sizemax", buffer_size,
+      NULL);
+
+  ipcpipelinesink = gst_element_factory_make ("ipcpipelinesink", NULL);
+  g_object_set (ipcpipelinesink, "fdin", fdin, "fdout", fdout,
+      "max-in-flight", max_in_flight, "fd-passing", fd_passing, NULL);
+
+  pad = gst_element_get_static_pad (ipcpipelinesink, "sink");
+  gst_pad_add_probe (pad, GST_PAD_PROBE_TYPE_BUFFER, buffer_probe, NULL, NULL);
+  gst_object_unref (pad);
+
+  gst_bin_add_many (GST_BIN (pipeline), source, ipcpipelinesink, NULL);
+  gst_element_link (source, ipcpipelinesink);
+
+  gst_element_set_state (pipeline, GST_STATE_PLAYING);
+}
+
+static void
+start_sink (int fdin, int fdout)
+{
+  GstElement *pipeline;
+  GstElement *ipcpipelinesrc, *sink;
+
+  pipeline = gst_element_factory_make ("ipcslavepipeline", NULL);
+  ipcpipelinesrc = gst_element_factory_make ("ipcpipelinesrc", NULL);
+  sink = gst_element_factory_make ("fakesink", NULL);
+  g_object_set (ipcpipelinesrc, "fdin", fdin, "fdout", fdout, NULL);
+  g_object_set (sink, "sync", FALSE, NULL);
+  gst_bin_add_many (GST_BIN (pipeline), ipcpipelinesrc, sink, NULL);
+  gst_element_link (ipcpipelinesrc, sink);
+
+  /* The state of the slave pipeline will change together with the state
+   * of the master, there is no need to call gst_element_set_state() here */
+}
+
+static void
+print_results (void)
+{
+  gdouble secs;
+
+  if (n_seen < 2 || end_time < 0) {
+    g_printerr ("Did not reach EOS (%u buffers seen)\n", n_seen);
+    return;
+  }
+
+  secs = (end_time - start_time) / (gdouble) G_TIME_SPAN_SECOND;
+  g_print ("%u buffers of %u bytes, max-in-flight %u, fd-passing %s\n",
+      n_seen, buffer_size, max_in_flight, fd_passing ? "on" : "off");
+  g_print ("%.3f s: %.0f buffers/s, %.1f MB/s\n", secs, n_seen / secs,
+      (gdouble) n_seen * buffer_size / secs / (1024 * 1024));
+  g_print ("time per buffer: avg %.1f us, max %" G_GINT64_FORMAT " us\n",
+      (last_time - start_time) / (gdouble) (n_seen - 1), max_interval);
+}
+
+int
+main (int argc, char **argv)
+{
+  int sockets[2];
+  pid_t pid;
+
+  if (argc > 1)
+    n_buffers = MAX (atoi (argv[1]), 2);
+  if (argc > 2)
+    buffer_size = MAX (atoi (argv[2]), 1);
+  if (argc > 3)
+    max_in_flight = MAX (atoi (argv[3]), 1);
+  if (argc > 4)
+    fd_passing = atoi (argv[4]) != 0;
+
+  if (socketpair (AF_UNIX, SOCK_STREAM, 0, sockets)) {
+    fprintf (stderr, "Error creating sockets: %s\n", strerror (errno));
+    return 1;
+  }
+  if (fcntl (sockets[0], F_SETFL, O_NONBLOCK) < 0 ||
+      fcntl (sockets[1], F_SETFL, O_NONBLOCK) < 0) {
+    fprintf (stderr, "Error setting O_NONBLOCK on sockets: %s\n",
+        strerror (errno));
+    return 1;
+  }
+
+  pid = fork ();
+  if (pid < 0) {
+    fprintf (stderr, "Error forking: %s\n", strerror (errno));
+    return 1;
+  }
+
+  gst_init (&argc, &argv);
+  loop = g_main_loop_new (NULL, FALSE);
+
+  if (pid > 0) {
+    start_source (sockets[0], sockets[0]);
+    g_main_loop_run (loop);
+    kill (pid, SIGTERM);
+    print_results ();
+  } else {
+    start_sink (sockets[1], sockets[1]);
+    g_main_loop_run (loop);
+  }
+
+  return (pid == 0 || end_time >= 0) ? 0 : 1;
+}